@@ -0,0 +1,88 @@
+#include "driver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ast_cache.h"
+
+static bool select_engine(const char *prg)
+{
+	const char *engine_name = getenv(MCC_PARSER_ENGINE_ENV);
+	if (engine_name) {
+		enum mcc_parser_engine engine;
+		if (!mcc_parser_engine_from_name(engine_name, &engine)) {
+			fprintf(stderr, "%s: unknown parser engine '%s'\n", prg, engine_name);
+			return false;
+		}
+		mcc_parser_set_engine(engine);
+	}
+	return true;
+}
+
+bool driver_parse_inputs(const char *prg,
+                         const char *const *inputs,
+                         size_t input_count,
+                         unsigned jobs,
+                         struct mcc_parser_result *result)
+{
+	if (!select_engine(prg)) {
+		return false;
+	}
+
+	// every input is parsed in isolation
+	size_t failed_input = 0;
+	if (input_count == 1 && strcmp("-", inputs[0]) == 0) {
+		*result = mcc_parse_file(stdin);
+
+		// the parser also accepts a lone expression, declaration or statement
+		if (result->status == MCC_PARSER_STATUS_OK && !result->program) {
+			mcc_parser_delete_result(result);
+			result->status = MCC_PARSER_STATUS_NOT_A_PROGRAM;
+		}
+	} else {
+		const char *cache_dir = getenv(MCC_AST_CACHE_DIR_ENV);
+		*result = mcc_parse_files(inputs, input_count, jobs, cache_dir, &failed_input);
+		if (result->status != MCC_PARSER_STATUS_OK && result->status != MCC_PARSER_STATUS_NOT_A_PROGRAM) {
+			fprintf(stderr, "%s: unable to parse input\n", inputs[failed_input]);
+		}
+	}
+
+	if (result->status == MCC_PARSER_STATUS_NOT_A_PROGRAM) {
+		fprintf(stderr, "%s: input is not a program\n", inputs[failed_input]);
+	}
+
+	return result->status == MCC_PARSER_STATUS_OK;
+}
+
+bool driver_parse_snippet(const char *prg, struct mcc_parser_result *result)
+{
+	if (!select_engine(prg)) {
+		return false;
+	}
+
+	*result = mcc_parse_file(stdin);
+	if (result->status != MCC_PARSER_STATUS_OK) {
+		fprintf(stderr, "-: unable to parse input\n");
+		return false;
+	}
+	return true;
+}
+
+bool driver_type_check(const char *prg, struct mcc_ast_program *program, struct mcc_type_check_result *check)
+{
+	*check = mcc_type_check(program);
+
+	switch (check->status) {
+	case MCC_TYPE_CHECK_OK:
+		return true;
+	case MCC_TYPE_CHECK_ERROR: {
+		const struct mcc_ast_source_location *sloc = &check->error_sloc;
+		fprintf(stderr, "%d:%d: error: %s\n", sloc->start_line, sloc->start_col, check->error);
+		return false;
+	}
+	default:
+		fprintf(stderr, "%s: out of memory\n", prg);
+		return false;
+	}
+}
@@ -0,0 +1,33 @@
+// Driver Infrastructure
+//
+// Front-end steps shared by the applications. Failures are reported on stderr,
+// prefixed by the program name `prg` unless they refer to a location.
+
+#ifndef MCC_DRIVER_H
+#define MCC_DRIVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "mcc/parser.h"
+#include "mcc/type_check.h"
+
+// Parses the given inputs into `result`, using the parser engine named by
+// `MCC_PARSER_ENGINE_ENV`. A single `-` denotes stdin; otherwise, up to `jobs`
+// files are parsed concurrently, consulting the AST cache configured by
+// `MCC_AST_CACHE_DIR_ENV`. Each input has to hold a program. On failure,
+// `result` holds nothing to delete.
+bool driver_parse_inputs(const char *prg,
+                         const char *const *inputs,
+                         size_t input_count,
+                         unsigned jobs,
+                         struct mcc_parser_result *result);
+
+// Parses stdin into `result` like `driver_parse_inputs`, but also accepts a
+// lone expression, declaration or statement in place of a program.
+bool driver_parse_snippet(const char *prg, struct mcc_parser_result *result);
+
+// Type checks `program` into `check`, which has to be deleted either way.
+bool driver_type_check(const char *prg, struct mcc_ast_program *program, struct mcc_type_check_result *check);
+
+#endif // MCC_DRIVER_H
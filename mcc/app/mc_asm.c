@@ -0,0 +1,175 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mcc/asm.h"
+#include "mcc/ast.h"
+#include "mcc/ast_cache.h"
+#include "mcc/parser.h"
+#include "mcc/ir.h"
+#include "mcc/ir_lower.h"
+#include "mcc/optimize.h"
+#include "mcc/type_check.h"
+
+#include "driver.h"
+
+void print_usage(const char *prg)
+{
+	printf("usage: %s [OPTIONS] <FILE>...\n\n", prg);
+	printf("Utility for printing the generated x86 assembly code of the optimized\n");
+	printf("program. Errors are reported on invalid inputs.\n\n");
+	printf("  <FILE>        Input filepath or - for stdin\n");
+	printf("\n");
+	printf("OPTIONS:\n");
+	printf("  -h            display this help message\n");
+	printf("  -c            write an ELF object file instead of assembly code\n");
+	printf("  -o <FILE>     write the output to FILE (defaults to stdout)\n");
+	printf("  -f <NAME>     limit scope to the given function\n");
+	printf("  -i <N>        inline calls of functions up to N instructions (defaults to %d, 0 disables)\n",
+	       MCC_INLINE_DEFAULT_LIMIT);
+	printf("  -m <MODE>     float code, sse (default) or x87\n");
+	printf("  -p            disable the peephole optimizer\n");
+	printf("  -r            report the hits of each peephole rule to stderr\n");
+	printf("  -s            report the spilled live intervals of each function to stderr\n");
+	printf("\n");
+	printf("ENVIRONMENT:\n");
+	printf("  %s  directory for caching parsed input files\n", MCC_AST_CACHE_DIR_ENV);
+	printf("  %s     parser engine, bison (default) or descent\n", MCC_PARSER_ENGINE_ENV);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *output = NULL;
+	const char *function = NULL;
+	bool spill_report = false;
+	bool no_peephole = false;
+	bool peephole_report = false;
+	bool write_object = false;
+	enum mcc_asm_float_mode float_mode = MCC_ASM_FLOAT_SSE;
+	struct mcc_optimize_options optimize_options = {.inline_limit = MCC_INLINE_DEFAULT_LIMIT};
+
+	int opt;
+	while ((opt = getopt(argc, argv, "chprsf:i:m:o:")) != -1) {
+		switch (opt) {
+		case 'c':
+			write_object = true;
+			break;
+
+		case 'f':
+			function = optarg;
+			break;
+
+		case 'o':
+			output = optarg;
+			break;
+
+		case 'i': {
+			char *end;
+			long value = strtol(optarg, &end, 10);
+			if (*end != '\0' || value < 0 || value > 100000) {
+				fprintf(stderr, "%s: invalid inline limit '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			optimize_options.inline_limit = (uint32_t)value;
+			break;
+		}
+
+		case 'm':
+			if (strcmp(optarg, "sse") == 0) {
+				float_mode = MCC_ASM_FLOAT_SSE;
+			} else if (strcmp(optarg, "x87") == 0) {
+				float_mode = MCC_ASM_FLOAT_X87;
+			} else {
+				fprintf(stderr, "%s: unknown float mode '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 's':
+			spill_report = true;
+			break;
+
+		case 'p':
+			no_peephole = true;
+			break;
+
+		case 'r':
+			peephole_report = true;
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *const *inputs = (const char *const *)&argv[optind];
+	size_t input_count = (size_t)(argc - optind);
+
+	// parsing phase
+	struct mcc_parser_result result;
+	if (!driver_parse_inputs(argv[0], inputs, input_count, 1, &result)) {
+		return EXIT_FAILURE;
+	}
+
+	FILE *out = output ? fopen(output, write_object ? "wb" : "w") : stdout;
+	if (!out) {
+		perror(output);
+		mcc_parser_delete_result(&result);
+		return EXIT_FAILURE;
+	}
+
+	struct mcc_type_check_result check;
+	struct mcc_ir_module module;
+	mcc_ir_module_init(&module);
+
+	int ret = EXIT_SUCCESS;
+	if (!driver_type_check(argv[0], result.program, &check)) {
+		ret = EXIT_FAILURE;
+	} else if (!mcc_ir_lower(&module, result.program, &check) ||
+	           !mcc_optimize(&module, &optimize_options, NULL)) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		ret = EXIT_FAILURE;
+	} else {
+		struct mcc_peephole_stats peephole_stats = {0};
+		struct mcc_asm_options options = {
+		    .function = function,
+		    .spill_report = spill_report ? stderr : NULL,
+		    .float_mode = float_mode,
+		    .no_peephole = no_peephole,
+		    .peephole_stats = &peephole_stats,
+		};
+		bool ok = write_object ? mcc_asm_write_object(out, &module, &options)
+		                       : mcc_asm_print(out, &module, &options);
+		if (!ok) {
+			fprintf(stderr, "%s: out of memory\n", argv[0]);
+			ret = EXIT_FAILURE;
+		} else if (peephole_report) {
+			for (int r = 0; r < MCC_PEEPHOLE_RULE_COUNT; ++r) {
+				fprintf(stderr, "%-18s %8u  %s\n", mcc_peephole_rule_name(r), peephole_stats.hits[r],
+				        mcc_peephole_rule_description(r));
+			}
+		}
+	}
+
+	if (out != stdout && fclose(out) != 0) {
+		perror(output);
+		ret = EXIT_FAILURE;
+	}
+
+	mcc_ir_module_release(&module);
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
+	return ret;
+}
@@ -1,54 +1,95 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include "mcc/ast.h"
+#include "mcc/ast_cache.h"
 #include "mcc/ast_print.h"
 #include "mcc/parser.h"
 
-void print_usage(const char *prg) {
-    printf("usage: %s <FILE>\n\n", prg);
-    printf("  <FILE>  Input filepath or - for stdin\n");
+#include "driver.h"
+
+void print_usage(const char *prg)
+{
+	printf("usage: %s [OPTIONS] <FILE>...\n\n", prg);
+	printf("Utility for printing an abstract syntax tree in the DOT format. The output\n");
+	printf("can be visualised using graphviz. Errors are reported on invalid inputs.\n\n");
+	printf("  <FILE>        Input filepath or - for stdin\n");
+	printf("\n");
+	printf("OPTIONS:\n");
+	printf("  -h            display this help message\n");
+	printf("  -o <FILE>     write the output to FILE (defaults to stdout)\n");
+	printf("\n");
+	printf("ENVIRONMENT:\n");
+	printf("  %s  directory for caching parsed input files\n", MCC_AST_CACHE_DIR_ENV);
+	printf("  %s     parser engine, bison (default) or descent\n", MCC_PARSER_ENGINE_ENV);
 }
 
-int main(int argc, char *argv[]) {
-    if (argc < 2) {
-        print_usage(argv[0]);
-        return EXIT_FAILURE;
-    }
-
-    // determine input source
-    FILE *in;
-    if (strcmp("-", argv[1]) == 0) {
-        in = stdin;
-    } else {
-        in = fopen(argv[1], "r");
-        if (!in) {
-            perror("fopen");
-            return EXIT_FAILURE;
-        }
-    }
-
-    struct mcc_ast_expression *expr = NULL;
-    struct mcc_ast_declaration *decl = NULL;
-
-    // parsing phase
-    {
-        printf("Start parsing \n");
-        struct mcc_parser_result result = mcc_parse_file(in);
-        if (result.status != MCC_PARSER_STATUS_OK) {
-            printf("NOT OK");
-            return EXIT_FAILURE;
-        }
-        printf("OK");
-        decl = result.declaration;
-        result.expression = expr;
-    }
-
-    mcc_ast_print_dot(stdout, decl);
-
-    // cleanup
-    mcc_ast_delete(expr);
-
-    return EXIT_SUCCESS;
+int main(int argc, char *argv[])
+{
+	const char *output = NULL;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "ho:")) != -1) {
+		switch (opt) {
+		case 'o':
+			output = optarg;
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *const *inputs = (const char *const *)&argv[optind];
+	size_t input_count = (size_t)(argc - optind);
+
+	// parsing phase, stdin may also hold any of the snippets the parser
+	// accepts on its own
+	struct mcc_parser_result result;
+	bool parsed = input_count == 1 && strcmp("-", inputs[0]) == 0
+	                  ? driver_parse_snippet(argv[0], &result)
+	                  : driver_parse_inputs(argv[0], inputs, input_count, 1, &result);
+	if (!parsed) {
+		return EXIT_FAILURE;
+	}
+
+	FILE *out = output ? fopen(output, "w") : stdout;
+	if (!out) {
+		perror(output);
+		mcc_parser_delete_result(&result);
+		return EXIT_FAILURE;
+	}
+
+	if (result.program) {
+		mcc_ast_print_dot(out, result.program);
+	} else if (result.statement) {
+		mcc_ast_print_dot(out, result.statement);
+	} else if (result.declaration) {
+		mcc_ast_print_dot(out, result.declaration);
+	} else if (result.expression) {
+		mcc_ast_print_dot(out, result.expression);
+	} else {
+		mcc_ast_print_dot(out, result.literal);
+	}
+
+	int ret = EXIT_SUCCESS;
+	if (out != stdout && fclose(out) != 0) {
+		perror(output);
+		ret = EXIT_FAILURE;
+	}
+
+	mcc_parser_delete_result(&result);
+	return ret;
 }
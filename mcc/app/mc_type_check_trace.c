@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "mcc/ast.h"
+#include "mcc/ast_cache.h"
+#include "mcc/parser.h"
+#include "mcc/type_check.h"
+
+#include "driver.h"
+
+void print_usage(const char *prg)
+{
+	printf("usage: %s [OPTIONS] <FILE>...\n\n", prg);
+	printf("Utility for tracing the type checking process. The type of every expression\n");
+	printf("is printed in the order in which it was computed. Errors are reported on\n");
+	printf("invalid inputs.\n\n");
+	printf("  <FILE>        Input filepath or - for stdin\n");
+	printf("\n");
+	printf("OPTIONS:\n");
+	printf("  -h            display this help message\n");
+	printf("  -o <FILE>     write the output to FILE (defaults to stdout)\n");
+	printf("  -f <NAME>     limit the trace to the given function\n");
+	printf("\n");
+	printf("ENVIRONMENT:\n");
+	printf("  %s  directory for caching parsed input files\n", MCC_AST_CACHE_DIR_ENV);
+	printf("  %s     parser engine, bison (default) or descent\n", MCC_PARSER_ENGINE_ENV);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *output = NULL;
+	const char *function = NULL;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "hf:o:")) != -1) {
+		switch (opt) {
+		case 'f':
+			function = optarg;
+			break;
+
+		case 'o':
+			output = optarg;
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (optind >= argc) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *const *inputs = (const char *const *)&argv[optind];
+	size_t input_count = (size_t)(argc - optind);
+
+	// parsing phase
+	struct mcc_parser_result result;
+	if (!driver_parse_inputs(argv[0], inputs, input_count, 1, &result)) {
+		return EXIT_FAILURE;
+	}
+
+	FILE *out = output ? fopen(output, "w") : stdout;
+	if (!out) {
+		perror(output);
+		mcc_parser_delete_result(&result);
+		return EXIT_FAILURE;
+	}
+
+	struct mcc_type_check_result check;
+	int ret = driver_type_check(argv[0], result.program, &check) ? EXIT_SUCCESS : EXIT_FAILURE;
+	mcc_type_check_trace(out, &check, function);
+
+	if (out != stdout && fclose(out) != 0) {
+		perror(output);
+		ret = EXIT_FAILURE;
+	}
+
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
+	return ret;
+}
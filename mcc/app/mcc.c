@@ -1,55 +1,395 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include "mcc/asm.h"
 #include "mcc/ast.h"
+#include "mcc/ast_cache.h"
+#include "mcc/bytecode.h"
+#include "mcc/ir.h"
+#include "mcc/ir_lower.h"
+#include "mcc/jit.h"
+#include "mcc/optimize.h"
 #include "mcc/parser.h"
+#include "mcc/type_check.h"
+
+#include "driver.h"
+
+#define MCC_BACKEND_ENV "MCC_BACKEND"
+
+// The builtins are linked into the driver as well, to be bound to programs
+// compiled in-process.
+void print(const char *msg);
+void print_nl(void);
+void print_int(long x);
+void print_float(float x);
+long read_int(void);
+float read_float(void);
+
+static const struct mcc_jit_symbol builtins[] = {
+    {"print", (void (*)(void))print},
+    {"print_nl", print_nl},
+    {"print_int", (void (*)(void))print_int},
+    {"print_float", (void (*)(void))print_float},
+    {"read_int", (void (*)(void))read_int},
+    {"read_float", (void (*)(void))read_float},
+};
+
+// the builtins compiled for the target if the build could, otherwise their
+// source compiled along with each program, see meson.build
+#ifndef MCC_BUILTINS_PATH
+#define MCC_BUILTINS_PATH "resources/mc_builtins.c"
+#endif
 
 void print_usage(const char *prg)
 {
-	printf("usage: %s <FILE>\n\n", prg);
-	printf("  <FILE>        Input filepath or - for stdin\n");
+	printf("usage: %s [OPTIONS] <FILE>...\n\n", prg);
+	printf("  <FILE>          Input filepath or - for stdin\n");
+	printf("\n");
+	printf("OPTIONS:\n");
+	printf("  -h              display this help message\n");
+	printf("  -e <FORMAT>     code passed to the back-end compiler, asm (default) or object, which is only "
+	       "linked\n");
+	printf("  -o <FILE>       output filepath (defaults to a.out)\n");
+	printf("  -r, --run       compile to memory and run the program instead, exiting with the result of main\n");
+	printf("  -b, --bytecode  interpret the program instead, like --run but on any host\n");
+	printf("  -i <N>          inline calls of functions up to N instructions (defaults to %d, 0 disables)\n",
+	       MCC_INLINE_DEFAULT_LIMIT);
+	printf("  -j <N>          parse up to N input files concurrently (defaults to 1)\n");
+	printf("\n");
+	printf("ENVIRONMENT:\n");
+	printf("  %s  directory for caching parsed input files\n", MCC_AST_CACHE_DIR_ENV);
+	printf("  %s    back-end compiler (defaults to gcc in PATH)\n", MCC_BACKEND_ENV);
+	printf("  %s     parser engine, bison (default) or descent\n", MCC_PARSER_ENGINE_ENV);
 }
 
-int main(int argc, char *argv[])
+static const char *backend_name(void)
 {
-	if (argc < 2) {
-		print_usage(argv[0]);
-		return EXIT_FAILURE;
+	const char *backend = getenv(MCC_BACKEND_ENV);
+	return backend && *backend ? backend : "gcc";
+}
+
+// Starts the back-end compiler with `args`, reading stdin from `input` unless
+// it is negative. Returns the process id, or -1 on failure.
+static pid_t spawn_backend(const char *prg, char *const args[], int input)
+{
+	pid_t pid = fork();
+	if (pid < 0) {
+		perror(prg);
+		return -1;
 	}
+	if (pid == 0) {
+		if (input >= 0 && dup2(input, STDIN_FILENO) < 0) {
+			_exit(EXIT_FAILURE);
+		}
+		execvp(args[0], args);
+		perror(args[0]);
+		_exit(EXIT_FAILURE);
+	}
+	return pid;
+}
+
+static bool wait_backend(const char *prg, pid_t pid)
+{
+	int status;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			perror(prg);
+			return false;
+		}
+	}
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+		fprintf(stderr, "%s: back-end compiler '%s' failed\n", prg, backend_name());
+		return false;
+	}
+	return true;
+}
 
-	// determine input source
-	FILE *in;
-	if (strcmp("-", argv[1]) == 0) {
-		in = stdin;
+// Assembles and links the assembly code of `module` together with the
+// builtins by piping it to the back-end compiler.
+static bool run_backend(const char *prg, const struct mcc_ir_module *module, const char *output)
+{
+	int fds[2];
+	if (pipe(fds) != 0) {
+		perror(prg);
+		return false;
+	}
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+	// the assembly code is read from stdin
+	char *const args[] = {
+	    (char *)backend_name(), "-m32", "-o", (char *)output, "-x", "assembler", "-", "-x", "none",
+	    MCC_BUILTINS_PATH, NULL,
+	};
+	pid_t pid = spawn_backend(prg, args, fds[0]);
+	close(fds[0]);
+	if (pid < 0) {
+		close(fds[1]);
+		return false;
+	}
+
+	FILE *out = fdopen(fds[1], "w");
+	bool ok = out && mcc_asm_print(out, module, NULL);
+	if (!ok) {
+		fprintf(stderr, "%s: unable to write assembly code\n", prg);
+	}
+	if (out) {
+		fclose(out);
+	} else {
+		close(fds[1]);
+	}
+
+	return wait_backend(prg, pid) && ok;
+}
+
+// Writes `module` to a temporary object file, which the back-end compiler
+// only links together with the builtins. Lacking a known suffix, the file is
+// passed to the linker as is.
+static bool run_linker(const char *prg, const struct mcc_ir_module *module, const char *output)
+{
+	const char *dir = getenv("TMPDIR");
+	if (!dir || !*dir) {
+		dir = "/tmp";
+	}
+	size_t path_size = strlen(dir) + sizeof("/mcc-XXXXXX");
+	char *path = malloc(path_size);
+	if (!path) {
+		fprintf(stderr, "%s: out of memory\n", prg);
+		return false;
+	}
+	snprintf(path, path_size, "%s/mcc-XXXXXX", dir);
+
+	int fd = mkstemp(path);
+	if (fd < 0) {
+		perror(path);
+		free(path);
+		return false;
+	}
+
+	FILE *out = fdopen(fd, "wb");
+	bool ok = out && mcc_asm_write_object(out, module, NULL);
+	if (out) {
+		ok = fclose(out) == 0 && ok;
 	} else {
-		in = fopen(argv[1], "r");
-		if (!in) {
-			perror("fopen");
+		close(fd);
+	}
+
+	if (!ok) {
+		fprintf(stderr, "%s: unable to write object file\n", prg);
+	} else {
+		char *const args[] = {
+		    (char *)backend_name(), "-m32", "-o", (char *)output, path, MCC_BUILTINS_PATH, NULL,
+		};
+		pid_t pid = spawn_backend(prg, args, -1);
+		ok = pid >= 0 && wait_backend(prg, pid);
+	}
+
+	unlink(path);
+	free(path);
+	return ok;
+}
+
+// Interprets the main function of `module`, whose result is stored in
+// `result`.
+static bool run_bytecode(const char *prg, const struct mcc_ir_module *module, int *result)
+{
+	struct mcc_bytecode bytecode;
+	enum mcc_bytecode_status status = mcc_bytecode_compile(&bytecode, module);
+	if (status == MCC_BYTECODE_OK) {
+		struct mcc_bytecode_result run;
+		status = mcc_bytecode_call(&bytecode, module, "main", stdin, stdout, &run);
+		*result = run.value;
+	}
+
+	switch (status) {
+	case MCC_BYTECODE_OK:
+		break;
+	case MCC_BYTECODE_NO_MEMORY:
+		fprintf(stderr, "%s: out of memory\n", prg);
+		break;
+	case MCC_BYTECODE_UNDEFINED_SYMBOL:
+		fprintf(stderr, "%s: undefined built-in function '%s'\n", prg, bytecode.undefined_symbol);
+		break;
+	case MCC_BYTECODE_NO_FUNCTION:
+		fprintf(stderr, "%s: no callable main function\n", prg);
+		break;
+	case MCC_BYTECODE_DIVISION_ERROR:
+		fprintf(stderr, "%s: integer division by zero or overflow\n", prg);
+		break;
+	case MCC_BYTECODE_OUT_OF_BOUNDS:
+		fprintf(stderr, "%s: array access out of bounds\n", prg);
+		break;
+	case MCC_BYTECODE_STACK_OVERFLOW:
+		fprintf(stderr, "%s: stack overflow\n", prg);
+		break;
+	}
+
+	mcc_bytecode_release(&bytecode);
+	return status == MCC_BYTECODE_OK;
+}
+
+// Compiles `module` to machine code in memory and calls its main function,
+// whose result is stored in `result`. Hosts which cannot run machine code
+// interpret the module instead.
+static bool run_in_process(const char *prg, const struct mcc_ir_module *module, int *result)
+{
+	struct mcc_jit jit;
+	enum mcc_jit_status status = mcc_jit_compile(&jit, module, builtins, sizeof(builtins) / sizeof(*builtins));
+	switch (status) {
+	case MCC_JIT_OK:
+		break;
+	case MCC_JIT_NO_MEMORY:
+		fprintf(stderr, "%s: out of memory\n", prg);
+		return false;
+	case MCC_JIT_UNSUPPORTED:
+		return run_bytecode(prg, module, result);
+	case MCC_JIT_UNDEFINED_SYMBOL:
+		fprintf(stderr, "%s: undefined built-in function '%s'\n", prg, jit.undefined_symbol);
+		return false;
+	}
+
+	bool ok = mcc_jit_call(&jit, module, "main", result);
+	if (!ok) {
+		fprintf(stderr, "%s: no callable main function\n", prg);
+	}
+	mcc_jit_release(&jit);
+	return ok;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned jobs = 1;
+	bool object = false;
+	bool run = false;
+	bool interpret = false;
+	const char *output = "a.out";
+	struct mcc_optimize_options optimize_options = {.inline_limit = MCC_INLINE_DEFAULT_LIMIT};
+
+	static const struct option long_options[] = {
+	    {"bytecode", no_argument, NULL, 'b'},
+	    {"run", no_argument, NULL, 'r'},
+	    {NULL, 0, NULL, 0},
+	};
+
+	int opt;
+	while ((opt = getopt_long(argc, argv, "bhe:i:j:o:r", long_options, NULL)) != -1) {
+		switch (opt) {
+		case 'e':
+			if (strcmp(optarg, "asm") == 0) {
+				object = false;
+			} else if (strcmp(optarg, "object") == 0) {
+				object = true;
+			} else {
+				fprintf(stderr, "%s: unknown output format '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'i': {
+			char *end;
+			long value = strtol(optarg, &end, 10);
+			if (*end != '\0' || value < 0 || value > 100000) {
+				fprintf(stderr, "%s: invalid inline limit '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			optimize_options.inline_limit = (uint32_t)value;
+			break;
+		}
+
+		case 'j': {
+			char *end;
+			long value = strtol(optarg, &end, 10);
+			if (*end != '\0' || value < 1 || value > 1024) {
+				fprintf(stderr, "%s: invalid number of jobs '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			jobs = (unsigned)value;
+			break;
+		}
+
+		case 'o':
+			output = optarg;
+			break;
+
+		case 'r':
+			run = true;
+			break;
+
+		case 'b':
+			interpret = true;
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
 			return EXIT_FAILURE;
 		}
 	}
 
-	struct mcc_ast_expression *expr = NULL;
+	if (optind >= argc) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const char *const *inputs = (const char *const *)&argv[optind];
+	size_t input_count = (size_t)(argc - optind);
+
+	struct mcc_parser_result result;
+	struct mcc_ast_program *program = NULL;
 
 	// parsing phase
 	{
-		struct mcc_parser_result result = mcc_parse_file(in);
-		fclose(in);
-		if (result.status != MCC_PARSER_STATUS_OK) {
+		if (!driver_parse_inputs(argv[0], inputs, input_count, jobs, &result)) {
 			return EXIT_FAILURE;
 		}
-		expr = result.expression;
+		program = result.program;
+	}
+
+	int ret = EXIT_SUCCESS;
+
+	// semantic checks
+	struct mcc_type_check_result check;
+	if (!driver_type_check(argv[0], program, &check)) {
+		ret = EXIT_FAILURE;
 	}
 
-	// TODO:
-	// - run semantic checks
-	// - create three-address code
-	// - output assembly code
-	// - invoke backend compiler
+	// three-address code
+	struct mcc_ir_module module;
+	mcc_ir_module_init(&module);
+	if (ret == EXIT_SUCCESS &&
+	    (!mcc_ir_lower(&module, program, &check) || !mcc_optimize(&module, &optimize_options, NULL))) {
+		fprintf(stderr, "%s: out of memory\n", argv[0]);
+		ret = EXIT_FAILURE;
+	}
+
+	if (ret == EXIT_SUCCESS && interpret) {
+		// bytecode interpreted right away
+		int result;
+		ret = run_bytecode(argv[0], &module, &result) ? result : EXIT_FAILURE;
+	} else if (ret == EXIT_SUCCESS && run) {
+		// machine code run right away
+		int result;
+		ret = run_in_process(argv[0], &module, &result) ? result : EXIT_FAILURE;
+	} else if (ret == EXIT_SUCCESS &&
+	           !(object ? run_linker(argv[0], &module, output) : run_backend(argv[0], &module, output))) {
+		// assembly code, assembled and linked by the back-end compiler, or
+		// an object file which it only links
+		ret = EXIT_FAILURE;
+	}
 
 	// cleanup
-	mcc_ast_delete(expr);
+	mcc_ir_module_release(&module);
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
 
-	return EXIT_SUCCESS;
+	return ret;
 }
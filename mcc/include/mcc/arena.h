@@ -0,0 +1,51 @@
+// Arena Allocator
+//
+// A simple bump allocator used for AST nodes. Memory is handed out from large
+// chunks and is never freed individually; instead, the whole arena is released
+// at once. Releasing is therefore proportional to the number of chunks, not to
+// the number of allocations.
+//
+// An arena is not thread-safe by itself. Each parse owns its own arena, hence
+// independent parses may run concurrently.
+
+#ifndef MCC_ARENA_H
+#define MCC_ARENA_H
+
+#include <stddef.h>
+
+struct mcc_arena_chunk;
+
+struct mcc_arena {
+	struct mcc_arena_chunk *head;
+};
+
+void mcc_arena_init(struct mcc_arena *arena);
+
+// Returns NULL if no memory could be obtained. The returned memory is suitably
+// aligned for any object type and is *not* zero-initialised.
+void *mcc_arena_alloc(struct mcc_arena *arena, size_t size);
+
+char *mcc_arena_strdup(struct mcc_arena *arena, const char *str);
+
+// Moves all chunks of `src` into `dst`; allocations from `src` stay valid and
+// are now owned by `dst`. `src` is left empty.
+void mcc_arena_merge(struct mcc_arena *dst, struct mcc_arena *src);
+
+// Frees every allocation made from the arena and resets it to the empty state.
+void mcc_arena_release(struct mcc_arena *arena);
+
+struct mcc_arena_stats {
+	// number of chunks, i.e. heap allocations made by the arena
+	size_t chunks;
+
+	// bytes handed out, including alignment padding
+	size_t used;
+
+	// bytes obtained from the heap, excluding chunk headers
+	size_t reserved;
+};
+
+// Walks the chunks of the arena, hence takes time proportional to their number.
+void mcc_arena_stats(const struct mcc_arena *arena, struct mcc_arena_stats *stats);
+
+#endif // MCC_ARENA_H
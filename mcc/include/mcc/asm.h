@@ -0,0 +1,69 @@
+// x86 Assembly Code Generation
+//
+// Translates an IR module to 32-bit x86 assembly in AT&T syntax, as accepted
+// by the GNU assembler (`gcc -m32`). Functions follow the cdecl calling
+// convention: arguments are passed on the stack, results are returned in
+// `eax` or, for floats, on top of the x87 stack. The stack is kept aligned to
+// 16 bytes at calls.
+//
+// Virtual registers are kept in `ebx`, `esi` and `edi`, assigned by linear
+// scan (see `mcc/regalloc.h`); the remaining ones live in the stack frame.
+// `eax`, `ecx` and `edx` serve as scratch registers within an instruction.
+// Constants are emitted to `.rodata`.
+//
+// Float arithmetic uses scalar SSE2 instructions by default, with floats kept
+// in `xmm2` to `xmm7` and `xmm0` and `xmm1` as scratch registers. As these are
+// not preserved across calls, floats live across a call stay in the frame.
+// Only results passed by cdecl on the x87 stack are moved through it. The x87
+// mode keeps all floats in the frame and computes on the x87 stack.
+//
+// Vectors introduced by the vectorizer (see `mcc/vectorize.h`) share the
+// registers of floats and take 16 bytes in the frame. They are processed with
+// packed SSE2 instructions in both modes, the x87 mode keeping them in the
+// frame as well.
+//
+// The code of each function is collected and cleaned up by the peephole
+// optimizer before it is printed. Instead of printing it, the code can be
+// encoded into an object file directly (see `mcc/object.h`).
+
+#ifndef MCC_ASM_H
+#define MCC_ASM_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "mcc/ir.h"
+#include "mcc/peephole.h"
+
+enum mcc_asm_float_mode {
+	MCC_ASM_FLOAT_SSE,
+	MCC_ASM_FLOAT_X87,
+};
+
+struct mcc_asm_options {
+	// only this function is printed if not NULL
+	const char *function;
+
+	// if not NULL, the register allocation of each function is summarised
+	// here, one line per function
+	FILE *spill_report;
+
+	enum mcc_asm_float_mode float_mode;
+
+	// the peephole optimizer (see `mcc/peephole.h`) is skipped if set
+	bool no_peephole;
+
+	// if not NULL, the hits of the peephole rules are added here
+	struct mcc_peephole_stats *peephole_stats;
+};
+
+// Prints the assembly code of `module`; `options` may be NULL. Returns false
+// if memory could not be obtained.
+bool mcc_asm_print(FILE *out, const struct mcc_ir_module *module, const struct mcc_asm_options *options);
+
+// Writes the code of `module` as an ELF relocatable object file; `options`
+// may be NULL. Returns false if memory could not be obtained or writing
+// failed.
+bool mcc_asm_write_object(FILE *out, const struct mcc_ir_module *module, const struct mcc_asm_options *options);
+
+#endif // MCC_ASM_H
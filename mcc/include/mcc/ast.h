@@ -9,22 +9,32 @@
 //
 // Also note that this makes excessive use of C11's *anonymous structs and
 // unions* feature.
+//
+// All nodes are allocated from an arena (see `mcc/arena.h`) which is passed to
+// every constructor. There are no functions for deleting individual nodes;
+// releasing the arena frees the whole tree at once.
 
 // library to support boolean data type
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifndef MCC_AST_H
 #define MCC_AST_H
 
+#include "mcc/arena.h"
+
 // Forward Declarations
 struct mcc_ast_expression;
 struct mcc_ast_literal;
 struct mcc_ast_statement;
 struct mcc_ast_identifier;
+struct mcc_ast_argument;
 
 
 // ------------------------------------------------------------------- AST Node
 
+// Lines and columns start at 1. The end position is exclusive: it denotes the
+// character following the node.
 struct mcc_ast_source_location {
 	int start_line;
 	int start_col;
@@ -82,7 +92,8 @@ enum mcc_ast_expression_type {
 	MCC_AST_EXPRESSION_TYPE_UNARY_OP,
 	MCC_AST_EXPRESSION_TYPE_PARENTH,
 	MCC_AST_EXPRESSION_TYPE_IDENTIFIER,
-
+	MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT,
+	MCC_AST_EXPRESSION_TYPE_CALL,
 };
 
 
@@ -90,6 +101,11 @@ struct mcc_ast_expression {
 	struct mcc_ast_node node;
 
 	enum mcc_ast_expression_type type;
+
+	// Position of this expression in the type checker's side array (see
+	// `mcc/type_check.h`). Not set by the constructors; only valid once the
+	// enclosing program has been checked. Occupies what would be padding.
+	uint32_t type_index;
 	union {
 		// MCC_AST_EXPRESSION_TYPE_LITERAL
 		struct mcc_ast_literal *literal;
@@ -102,65 +118,103 @@ struct mcc_ast_expression {
 			struct mcc_ast_expression *rhs;
 		};
 
-        // MCC_AST_EXPRESSION_TYPE_UNARY_OP
+		// MCC_AST_EXPRESSION_TYPE_UNARY_OP uses `up` and `rhs` of the above
+
 		// MCC_AST_EXPRESSION_TYPE_PARENTH
 		struct mcc_ast_expression *expression;
 
+		// MCC_AST_EXPRESSION_TYPE_IDENTIFIER
 		struct mcc_ast_identifier *identifier;
+
+		// MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT
+		struct {
+			struct mcc_ast_identifier *array;
+			struct mcc_ast_expression *index;
+		};
+
+		// MCC_AST_EXPRESSION_TYPE_CALL
+		struct {
+			struct mcc_ast_identifier *function;
+
+			// NULL for an empty argument list
+			struct mcc_ast_argument *arguments;
+		};
 	};
 };
 
 
-struct mcc_ast_expression *mcc_ast_new_expression_literal(struct mcc_ast_literal *literal);
+struct mcc_ast_expression *mcc_ast_new_expression_literal(struct mcc_arena *arena, struct mcc_ast_literal *literal);
 
-struct mcc_ast_expression *mcc_ast_new_expression_binary_op(enum mcc_ast_binary_op op,
+struct mcc_ast_expression *mcc_ast_new_expression_binary_op(struct mcc_arena *arena,
+                                                            enum mcc_ast_binary_op op,
                                                             struct mcc_ast_expression *lhs,
                                                             struct mcc_ast_expression *rhs);
 
-struct mcc_ast_expression *mcc_ast_new_exprssion_unary_op( enum mcc_ast_unary_op op,
-														   struct mcc_ast_expression *rhs);
+struct mcc_ast_expression *mcc_ast_new_expression_unary_op(struct mcc_arena *arena,
+                                                           enum mcc_ast_unary_op op,
+                                                           struct mcc_ast_expression *rhs);
 
-struct mcc_ast_expression *mcc_ast_new_expression_parenth(struct mcc_ast_expression *expression);
+struct mcc_ast_expression *mcc_ast_new_expression_parenth(struct mcc_arena *arena,
+                                                          struct mcc_ast_expression *expression);
 
-// struct mcc_ast_expression *mcc_ast_new_expression_call(struct mcc_ast_identifier *identifier,
-// 													   struct mcc_ast_argument *argument );
+struct mcc_ast_expression *mcc_ast_new_expression_identifier(struct mcc_arena *arena,
+                                                             struct mcc_ast_identifier *identifier);
 
-void mcc_ast_delete_expression(struct mcc_ast_expression *expression);
+struct mcc_ast_expression *mcc_ast_new_expression_array_element(struct mcc_arena *arena,
+                                                                struct mcc_ast_identifier *array,
+                                                                struct mcc_ast_expression *index);
 
-// ------------------------------------------------------------------- Arguments
+// `arguments` may be NULL for an empty argument list.
+struct mcc_ast_expression *mcc_ast_new_expression_call(struct mcc_arena *arena,
+                                                       struct mcc_ast_identifier *function,
+                                                       struct mcc_ast_argument *arguments);
 
-// struct mcc_ast_arguments{
+// ------------------------------------------------------------------- Arguments
 
-// 	struct mcc_ast_node;
-// 	struct mcc_ast_arguments *next_arg;
-// 	struct mcc_ast_expression *expression;
-// }
+struct mcc_ast_argument {
+	struct mcc_ast_node node;
+	struct mcc_ast_argument *next;
+	struct mcc_ast_expression *expression;
+};
 
+struct mcc_ast_argument *mcc_ast_new_argument(struct mcc_arena *arena, struct mcc_ast_expression *expression);
 
 
 // ------------------------------------------------------------------- Identifier
 
+// Identifier names are interned (see `mcc/intern.h`): two identifiers denote
+// the same name if and only if their `i_value` pointers are equal.
 struct mcc_ast_identifier {
 
 	struct mcc_ast_node node;
-	char *i_value;
+	const char *i_value;
 };
 
-struct mcc_ast_identifier *mcc_ast_new_identifier(char *value);
+struct mcc_ast_identifier *mcc_ast_new_identifier(struct mcc_arena *arena, const char *value);
+
+// Like `mcc_ast_new_identifier`, but `value` need not be NUL-terminated.
+struct mcc_ast_identifier *mcc_ast_new_identifier_n(struct mcc_arena *arena, const char *value, size_t len);
 
 
 // ------------------------------------------------------------------- Declaration
 
 struct mcc_ast_declaration {
-	struct mcc_ast_node *node;
+	struct mcc_ast_node node;
 
 	enum mcc_ast_data_type type;
 
+	// NULL unless an array is declared
+	struct mcc_ast_literal *array_size;
+
 	struct mcc_ast_identifier *identifier;
 
 };
 
-struct mcc_ast_declaration *mcc_ast_new_declaration(enum mcc_ast_data_type type, struct mcc_ast_identifier *ident);
+// `array_size` is NULL for scalars.
+struct mcc_ast_declaration *mcc_ast_new_declaration(struct mcc_arena *arena,
+                                                    enum mcc_ast_data_type type,
+                                                    struct mcc_ast_literal *array_size,
+                                                    struct mcc_ast_identifier *ident);
 
 
 // ------------------------------------------------------------------- Statements
@@ -172,14 +226,13 @@ enum mcc_ast_statement_type {
 	MCC_AST_STATEMENT_TYPE_DECL,
 	MCC_AST_STATEMENT_TYPE_ASSGN,
 	MCC_AST_STATEMENT_TYPE_COMPOUND,
-	// MCC_AST_STATEMENT_TYPE_BLOCK
+	MCC_AST_STATEMENT_TYPE_RETURN,
 };
 
 struct mcc_ast_statement_list {
-   	struct mcc_ast_node node;
+	struct mcc_ast_node node;
 	struct mcc_ast_statement *statement;
 	struct mcc_ast_statement_list *next;
-	
 };
 
 struct mcc_ast_statement {
@@ -190,10 +243,7 @@ struct mcc_ast_statement {
     union {
         struct mcc_ast_expression *expression;
 
-		struct {
-            enum mcc_ast_data_type data_type;
-            struct mcc_ast_identifier *id_decl;
-        };
+		struct mcc_ast_declaration *declaration;
 
 		struct {
 			struct mcc_ast_expression *if_condition;
@@ -208,37 +258,51 @@ struct mcc_ast_statement {
 
 		struct {
 			struct mcc_ast_identifier *id_assgn;
+
+			// array index, NULL when assigning to a scalar
 			struct mcc_ast_expression *lhs_assgn;
+
 			struct mcc_ast_expression *rhs_assgn;
 		};
 
+		// NULL for an empty block
         struct mcc_ast_statement_list *compound_statement;
+
+		// NULL for a bare `return;`
+		struct mcc_ast_expression *return_value;
     };
 };
 
-struct mcc_ast_statement *mcc_ast_new_statement_expression (struct mcc_ast_expression *expression);
+struct mcc_ast_statement *mcc_ast_new_statement_expression(struct mcc_arena *arena,
+                                                           struct mcc_ast_expression *expression);
 
-struct mcc_ast_statement *mcc_ast_new_statement_if(struct mcc_ast_expression *condition,
+struct mcc_ast_statement *mcc_ast_new_statement_if(struct mcc_arena *arena,
+                                                   struct mcc_ast_expression *condition,
 												   struct mcc_ast_statement *if_stmt,
                                                    struct mcc_ast_statement *else_stmt);
 
-struct mcc_ast_statement *mcc_ast_new_statement_while(struct mcc_ast_expression *condition,
+struct mcc_ast_statement *mcc_ast_new_statement_while(struct mcc_arena *arena,
+                                                      struct mcc_ast_expression *condition,
 												   	  struct mcc_ast_statement *while_stmt);
 
-struct mcc_ast_statement *mcc_ast_new_statement_assignment(struct mcc_ast_identifier *id_assgn,
+// `lhs_assgn` is the array index, NULL when assigning to a scalar.
+struct mcc_ast_statement *mcc_ast_new_statement_assignment(struct mcc_arena *arena,
+                                                           struct mcc_ast_identifier *id_assgn,
 														   struct mcc_ast_expression *lhs_assgn,
 														   struct mcc_ast_expression *rhs_assgn );
 
-struct mcc_ast_statement *mcc_ast_new_statement_declaration(enum mcc_ast_data_type data_type,
-															struct mcc_ast_identifier *identifier);
-
-struct mcc_ast_statement *mcc_ast_new_statement_statement_list(struct mcc_ast_statement_list *statement_list,
-                                                                struct mcc_ast_statement *next_statement);
+struct mcc_ast_statement *mcc_ast_new_statement_declaration(struct mcc_arena *arena,
+                                                            struct mcc_ast_declaration *declaration);
 
+// `statement_list` may be NULL for an empty block.
+struct mcc_ast_statement *mcc_ast_new_statement_compound(struct mcc_arena *arena,
+                                                         struct mcc_ast_statement_list *statement_list);
 
+// `value` may be NULL.
+struct mcc_ast_statement *mcc_ast_new_statement_return(struct mcc_arena *arena, struct mcc_ast_expression *value);
 
-
-struct mcc_ast_statement mcc_ast_new_block_statement();
+struct mcc_ast_statement_list *mcc_ast_new_statement_list(struct mcc_arena *arena,
+                                                          struct mcc_ast_statement *statement);
 
 // ------------------------------------------------------------------- Literals
 
@@ -268,15 +332,13 @@ struct mcc_ast_literal {
 	};
 };
 
-struct mcc_ast_literal *mcc_ast_new_literal_int(long value);
-
-struct mcc_ast_literal *mcc_ast_new_literal_float(double value);
+struct mcc_ast_literal *mcc_ast_new_literal_int(struct mcc_arena *arena, long value);
 
-struct mcc_ast_literal *mcc_ast_new_literal_string(char* value);
+struct mcc_ast_literal *mcc_ast_new_literal_float(struct mcc_arena *arena, double value);
 
-struct mcc_ast_literal *mcc_ast_new_literal_bool(bool value);
+struct mcc_ast_literal *mcc_ast_new_literal_string(struct mcc_arena *arena, char* value);
 
-void mcc_ast_delete_literal(struct mcc_ast_literal *literal);
+struct mcc_ast_literal *mcc_ast_new_literal_bool(struct mcc_arena *arena, bool value);
 
 void mcc_ast_empty_node();
 
@@ -294,23 +356,20 @@ struct mcc_ast_function_def {
 
 	struct mcc_ast_identifier *identifier;
 
+	// NULL for an empty parameter list
 	struct mcc_ast_parameter *parameter;
 
 	struct mcc_ast_statement *compund_statement;
-};
-
-struct mcc_ast_function_def *mcc_ast_new_function_def( enum mcc_ast_data_type type,
-														struct mcc_ast_identifier *identifier,
-														struct mcc_ast_parameter *parameter,
-														struct mcc_ast_statement *compound_statement);
-
-
-
-struct mcc_ast_function *mcc_ast_function_to_def(struct mcc_ast_function *function,
-                                                 struct mcc_ast_function_def *function_def);
 
+	// next function definition of the program
+	struct mcc_ast_function_def *next;
+};
 
-struct mcc_ast_function *mcc_ast_function_def(struct mcc_ast_function_def *function_def);
+struct mcc_ast_function_def *mcc_ast_new_function_def(struct mcc_arena *arena,
+                                                      enum mcc_ast_data_type type,
+                                                      struct mcc_ast_identifier *identifier,
+                                                      struct mcc_ast_parameter *parameter,
+                                                      struct mcc_ast_statement *compound_statement);
 
 // -------------------------------------------------------------------- Parameter
 
@@ -322,32 +381,30 @@ struct mcc_ast_parameter {
 };
 
 struct mcc_ast_parameter *
-mcc_ast_new_parameter(struct mcc_ast_declaration *declaration);
-
-void mcc_ast_delete_parameter(struct mcc_ast_parameter *parameter);
+mcc_ast_new_parameter(struct mcc_arena *arena, struct mcc_ast_declaration *declaration);
 
 
 // -------------------------------------------------------------------- Program
 
 struct mcc_ast_program {
 	struct mcc_ast_node node;
+
+	// first function definition, linked via `next`
 	struct mcc_ast_function_def *function_def;
+
+	// internal, allows appending in constant time
+	struct mcc_ast_function_def *last_function_def;
 };
 
+// `function_def` may be NULL, yielding an empty program.
 struct mcc_ast_program *
-mcc_ast_new_program(struct mcc_ast_function_def *function_def);
-
-void mcc_ast_delete_program(struct mcc_ast_program *program);
-
-// -------------------------------------------------------------------- Utility
-
-// clang-format off
+mcc_ast_new_program(struct mcc_arena *arena, struct mcc_ast_function_def *function_def);
 
-#define mcc_ast_delete(x) _Generic((x), \
-		struct mcc_ast_expression *: mcc_ast_delete_expression, \
-		struct mcc_ast_literal *:    mcc_ast_delete_literal \
-	)(x)
+void mcc_ast_add_function_def(struct mcc_ast_program *program, struct mcc_ast_function_def *function_def);
 
-// clang-format on
+// Moves all function definitions of `other` to the end of `program`, leaving
+// `other` empty. Both programs may live in different arenas; the caller has
+// to keep both arenas alive (see `mcc_arena_merge`).
+void mcc_ast_merge_programs(struct mcc_ast_program *program, struct mcc_ast_program *other);
 
 #endif // MCC_AST_H
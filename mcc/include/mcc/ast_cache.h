@@ -0,0 +1,56 @@
+// AST Cache
+//
+// A persistent, content-addressed cache for parsed programs. The key of an
+// entry is a hash of the source text; an entry holds a binary image of the
+// whole AST.
+//
+// The image is a relocatable copy of the in-memory nodes: pointers are stored
+// as offsets into the image, accompanied by a table of their positions.
+// Loading an entry is therefore a single read into the result's arena plus
+// one fixup pass over that table, no re-parsing is involved. Identifier names
+// are re-interned while fixing up, hence the loaded tree behaves exactly like
+// a freshly parsed one.
+//
+// Images depend on the layout of the AST structs. Each image records a
+// fingerprint of that layout; entries written by an incompatible build are
+// treated as misses.
+//
+// Entries are written to a temporary file which is then renamed into place.
+// Several processes (or threads) may thus share one cache directory: readers
+// never observe partially written entries and concurrent writers of the same
+// entry simply replace each other's identical result.
+
+#ifndef MCC_AST_CACHE_H
+#define MCC_AST_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mcc/ast.h"
+#include "mcc/parser.h"
+
+// Name of the environment variable the drivers read the cache directory from.
+// Caching is disabled if it is unset or empty.
+#define MCC_AST_CACHE_DIR_ENV "MCC_CACHE_DIR"
+
+struct mcc_ast_cache_key {
+	uint64_t hash[2];
+};
+
+void mcc_ast_cache_compute_key(struct mcc_ast_cache_key *key, const char *data, size_t len);
+
+// Loads the entry for `key` from `dir` into `result`, whose arena receives the
+// nodes. Returns false on a miss, including unreadable or incompatible
+// entries; `result` is left untouched in that case.
+bool mcc_ast_cache_load(const char *dir, const struct mcc_ast_cache_key *key, struct mcc_parser_result *result);
+
+// Stores `program` as the entry for `key` in `dir`, creating the directory if
+// needed. Returns false if the entry could not be written.
+bool mcc_ast_cache_store(const char *dir, const struct mcc_ast_cache_key *key, const struct mcc_ast_program *program);
+
+// Like `mcc_parse_buffer`, but tries the cache in `dir` first and stores the
+// parsed program on a miss. `dir` may be NULL to bypass the cache.
+struct mcc_parser_result mcc_ast_cache_parse_buffer(const char *dir, char *data, size_t len);
+
+#endif // MCC_AST_CACHE_H
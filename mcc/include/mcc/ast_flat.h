@@ -0,0 +1,148 @@
+// Flat AST Representation
+//
+// An alternative, compact layout for expression trees. Instead of individually
+// allocated nodes linked by pointers, nodes are stored in contiguous typed
+// arrays and refer to their children by 32-bit indices (`mcc_ast_flat_ref`).
+//
+// An expression record is 12 bytes, compared to 48 bytes for a
+// `mcc_ast_expression` (plus 32 bytes for each `mcc_ast_literal`). Source
+// locations are kept in side tables parallel to the node arrays so that
+// traversals which do not need them never touch that memory.
+//
+// Nodes are appended bottom-up: children always have a smaller index than
+// their parent. A flat AST obtained from `mcc_ast_flat_from_expression`
+// therefore stores every subtree contiguously in post-order.
+//
+// Existing users of `mcc_ast_visitor` and the DOT printer can work on a flat
+// AST by converting it back with `mcc_ast_flat_to_expression`.
+
+#ifndef MCC_AST_FLAT_H
+#define MCC_AST_FLAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/arena.h"
+#include "mcc/ast.h"
+#include "mcc/ast_visit.h"
+
+typedef uint32_t mcc_ast_flat_ref;
+
+#define MCC_AST_FLAT_NONE UINT32_MAX
+
+// ---------------------------------------------------------------------- Nodes
+
+struct mcc_ast_flat_expression {
+	// enum mcc_ast_expression_type
+	uint8_t type;
+
+	// enum mcc_ast_binary_op or enum mcc_ast_unary_op
+	uint8_t op;
+
+	// MCC_AST_EXPRESSION_TYPE_LITERAL:       index into `literals`
+	// MCC_AST_EXPRESSION_TYPE_IDENTIFIER:    index into `identifiers`
+	// MCC_AST_EXPRESSION_TYPE_BINARY_OP:     lhs
+	// MCC_AST_EXPRESSION_TYPE_UNARY_OP:      operand
+	// MCC_AST_EXPRESSION_TYPE_PARENTH:       inner expression
+	// MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT: array, index into `identifiers`
+	// MCC_AST_EXPRESSION_TYPE_CALL:          function, index into `identifiers`
+	mcc_ast_flat_ref a;
+
+	// MCC_AST_EXPRESSION_TYPE_BINARY_OP:     rhs
+	// MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT: index expression
+	// MCC_AST_EXPRESSION_TYPE_CALL:          index into `arguments`, or
+	//                                        MCC_AST_FLAT_NONE without arguments
+	mcc_ast_flat_ref b;
+};
+
+struct mcc_ast_flat_literal {
+	enum mcc_ast_literal_type type;
+	union {
+		long i_value;
+		double f_value;
+		const char *s_value;
+		bool b_value;
+	};
+};
+
+// ------------------------------------------------------------------ Container
+
+struct mcc_ast_flat {
+	struct mcc_ast_flat_expression *expressions;
+	struct mcc_ast_source_location *expression_slocs;
+	uint32_t expression_count;
+	uint32_t expression_capacity;
+
+	struct mcc_ast_flat_literal *literals;
+	struct mcc_ast_source_location *literal_slocs;
+	uint32_t literal_count;
+	uint32_t literal_capacity;
+
+	// Strings are borrowed, they must outlive the flat AST.
+	const char **identifiers;
+	struct mcc_ast_source_location *identifier_slocs;
+	uint32_t identifier_count;
+	uint32_t identifier_capacity;
+
+	// Argument lists of calls, each one is its length followed by the
+	// argument expressions.
+	mcc_ast_flat_ref *arguments;
+	uint32_t argument_count;
+	uint32_t argument_capacity;
+};
+
+void mcc_ast_flat_init(struct mcc_ast_flat *flat);
+
+void mcc_ast_flat_delete(struct mcc_ast_flat *flat);
+
+// Node constructors return MCC_AST_FLAT_NONE if memory could not be obtained.
+
+mcc_ast_flat_ref mcc_ast_flat_add_literal(struct mcc_ast_flat *flat,
+                                          const struct mcc_ast_flat_literal *literal,
+                                          const struct mcc_ast_source_location *sloc);
+
+mcc_ast_flat_ref mcc_ast_flat_add_identifier(struct mcc_ast_flat *flat,
+                                             const char *name,
+                                             const struct mcc_ast_source_location *sloc);
+
+// Returns the index of the list of `count` argument expressions in
+// `arguments`.
+mcc_ast_flat_ref mcc_ast_flat_add_arguments(struct mcc_ast_flat *flat, const mcc_ast_flat_ref *refs, uint32_t count);
+
+mcc_ast_flat_ref mcc_ast_flat_add_expression(struct mcc_ast_flat *flat,
+                                             const struct mcc_ast_flat_expression *expression,
+                                             const struct mcc_ast_source_location *sloc);
+
+// ----------------------------------------------------------------- Conversion
+
+// Appends the given expression tree and returns the index of its root.
+mcc_ast_flat_ref mcc_ast_flat_from_expression(struct mcc_ast_flat *flat, struct mcc_ast_expression *expression);
+
+// Materialises the subtree rooted at `root` as regular AST nodes allocated
+// from `arena`. Returns NULL if memory could not be obtained.
+struct mcc_ast_expression *
+mcc_ast_flat_to_expression(const struct mcc_ast_flat *flat, mcc_ast_flat_ref root, struct mcc_arena *arena);
+
+// ------------------------------------------------------------------- Visiting
+
+typedef void (*mcc_ast_flat_visit_cb)(const struct mcc_ast_flat *flat, mcc_ast_flat_ref expression, void *userdata);
+
+struct mcc_ast_flat_visitor {
+	enum mcc_ast_visit_order order;
+
+	void *userdata;
+
+	mcc_ast_flat_visit_cb expression;
+};
+
+// Depth-first traversal of the subtree rooted at `root`. Uses an explicit
+// stack, hence the tree depth is not limited by the native stack. Returns
+// false if memory for the stack could not be obtained.
+bool mcc_ast_flat_visit(const struct mcc_ast_flat *flat, mcc_ast_flat_ref root, struct mcc_ast_flat_visitor *visitor);
+
+// Visits every expression of the flat AST in storage order. For a tree built
+// by `mcc_ast_flat_from_expression` this is a post-order traversal at the cost
+// of a linear scan.
+void mcc_ast_flat_visit_all(const struct mcc_ast_flat *flat, struct mcc_ast_flat_visitor *visitor);
+
+#endif // MCC_AST_FLAT_H
@@ -22,12 +22,19 @@ void mcc_ast_print_dot_literal(FILE *out, struct mcc_ast_literal *literal);
 
 void mcc_ast_print_dot_declaration(FILE *out, struct mcc_ast_declaration *declaration);
 
+void mcc_ast_print_dot_function_def(FILE *out, struct mcc_ast_function_def *function_def);
+
+void mcc_ast_print_dot_program(FILE *out, struct mcc_ast_program *program);
+
 // clang-format off
 
 #define mcc_ast_print_dot(out, x) _Generic((x), \
 		struct mcc_ast_expression *: 	mcc_ast_print_dot_expression, \
 		struct mcc_ast_literal *:    	mcc_ast_print_dot_literal, \
-		struct mcc_ast_declaration *:	mcc_ast_print_dot_declaration \
+		struct mcc_ast_declaration *:	mcc_ast_print_dot_declaration, \
+		struct mcc_ast_statement *:	mcc_ast_print_dot_statement, \
+		struct mcc_ast_function_def *:	mcc_ast_print_dot_function_def, \
+		struct mcc_ast_program *:	mcc_ast_print_dot_program \
 	)(out, x)
 
 // clang-format on
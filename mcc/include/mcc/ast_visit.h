@@ -5,15 +5,26 @@
 // Instantiate the `mcc_ast_visitor` struct with the desired configuration and
 // callbacks. Use this instance with the functions declared below. Each
 // callback is optional, just set it to NULL.
+//
+// Traversal does not recurse; pending nodes are kept on an explicit work list
+// so arbitrarily deep trees (e.g. long `a + b + c + ...` chains) can be
+// visited without growing the native stack. Callbacks may start a nested
+// traversal with the same visitor.
 
 #ifndef MCC_AST_VISIT_H
 #define MCC_AST_VISIT_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #include "mcc/ast.h"
 
 enum mcc_ast_visit_traversal {
     MCC_AST_VISIT_DEPTH_FIRST,
-    // TODO: MCC_AST_VISIT_BREADTH_FIRST,
+
+    // Level by level, children left to right. Each node is visited once, its
+    // callbacks are invoked as for pre-order; `order` is ignored.
+    MCC_AST_VISIT_BREADTH_FIRST,
 };
 
 enum mcc_ast_visit_order {
@@ -27,12 +38,27 @@ typedef void (*mcc_ast_visit_literal_cb)(struct mcc_ast_literal *, void *userdat
 typedef void (*mcc_ast_visit_declaration_cb)(struct mcc_ast_declaration *, void *userdata);
 typedef void (*mcc_ast_visit_identifier_cb)(struct mcc_ast_identifier *, void *userdata);
 typedef void (*mcc_ast_visit_statement_cb)(struct mcc_ast_statement *, void *userdata);
-typedef void (*mcc_ast_visit_parameters_cb)(struct mcc_ast_parameters *, void *userdata);
+typedef void (*mcc_ast_visit_function_def_cb)(struct mcc_ast_function_def *, void *userdata);
+typedef void (*mcc_ast_visit_program_cb)(struct mcc_ast_program *, void *userdata);
+
+// Work list backing a traversal. Zero-initialize it, then point
+// `mcc_ast_visitor.stack` to it to reuse its storage across traversals. Free
+// it with `mcc_ast_visit_stack_release`.
+struct mcc_ast_visit_stack {
+    struct mcc_ast_visit_frame *frames;
+    size_t count;
+    size_t capacity;
+};
+
+void mcc_ast_visit_stack_release(struct mcc_ast_visit_stack *stack);
 
 struct mcc_ast_visitor {
     enum mcc_ast_visit_traversal traversal;
     enum mcc_ast_visit_order order;
 
+    // Optional, a temporary work list is used when NULL.
+    struct mcc_ast_visit_stack *stack;
+
     // This will be passed to every callback along with the corresponding AST
     // node. Use it to share data while traversing the tree.
     void *userdata;
@@ -42,13 +68,19 @@ struct mcc_ast_visitor {
     mcc_ast_visit_expression_cb expression_binary_op;
     mcc_ast_visit_expression_cb expression_unary_op;
     mcc_ast_visit_expression_cb expression_parenth;
+    mcc_ast_visit_expression_cb expression_array_element;
+    mcc_ast_visit_expression_cb expression_call;
 
+    mcc_ast_visit_statement_cb statement;
+    mcc_ast_visit_statement_cb statement_expression;
+    // `statement_if` is invoked for if statements without else branch only
     mcc_ast_visit_statement_cb statement_if;
     mcc_ast_visit_statement_cb statement_if_else;
     mcc_ast_visit_statement_cb statement_assignment;
     mcc_ast_visit_statement_cb statement_while;
     mcc_ast_visit_statement_cb statement_compound;
     mcc_ast_visit_statement_cb statement_declaration;
+    mcc_ast_visit_statement_cb statement_return;
 
     mcc_ast_visit_literal_cb literal;
     mcc_ast_visit_literal_cb literal_int;
@@ -58,22 +90,63 @@ struct mcc_ast_visitor {
 
     mcc_ast_visit_declaration_cb declaration;
     mcc_ast_visit_identifier_cb identifier;
-    mcc_ast_visit_parameters_cb parameters;
-
+    mcc_ast_visit_function_def_cb function_def;
+    mcc_ast_visit_program_cb program;
 };
 
-void mcc_ast_visit_expression(struct mcc_ast_expression *expression, struct mcc_ast_visitor *visitor);
+// The visit functions return false if the work list could not be grown; the
+// traversal is incomplete in that case.
+
+bool mcc_ast_visit_expression(struct mcc_ast_expression *expression, struct mcc_ast_visitor *visitor);
+
+bool mcc_ast_visit_literal(struct mcc_ast_literal *literal, struct mcc_ast_visitor *visitor);
 
-void mcc_ast_visit_literal(struct mcc_ast_literal *literal, struct mcc_ast_visitor *visitor);
+bool mcc_ast_visit_declaration(struct mcc_ast_declaration *declaration, struct mcc_ast_visitor *visitor);
 
-void mcc_ast_visit_declaration(struct mcc_ast_declaration *declaration, struct mcc_ast_visitor *visitor);
+bool mcc_ast_visit_identifier(struct mcc_ast_identifier *identifier, struct mcc_ast_visitor *visitor);
 
-void mcc_ast_visit_identifier(struct mcc_ast_identifier *identifier, struct mcc_ast_visitor *visitor);
+bool mcc_ast_visit_statement(struct mcc_ast_statement *statement, struct mcc_ast_visitor *visitor);
 
-void mcc_ast_visit_parameters(struct mcc_ast_parameters *parameters, struct mcc_ast_visitor *visitor);
+// Function definitions visit their identifier, the declarations of their
+// parameters and their body; programs visit their function definitions.
+bool mcc_ast_visit_function_def(struct mcc_ast_function_def *function_def, struct mcc_ast_visitor *visitor);
 
-//void mcc_ast_visit_function(struct mcc_ast_function *function, struct mcc_ast_visitor *visitor);
+bool mcc_ast_visit_program(struct mcc_ast_program *program, struct mcc_ast_visitor *visitor);
 
+// Fused Traversal
+//
+// Runs `count` visitors in a single traversal, so independent analyses share
+// one walk over the tree. Each node is handed to every visitor having a
+// callback for it, in the given order; visitors without one are skipped. Each
+// visitor receives the same callback sequence as in a traversal on its own,
+// depth-first visitors may mix pre- and post-order.
+//
+// All visitors must use the same traversal. The work list of the first
+// visitor is used.
+
+bool mcc_ast_visit_expression_fused(struct mcc_ast_expression *expression,
+                                    struct mcc_ast_visitor *const *visitors,
+                                    size_t count);
+
+bool mcc_ast_visit_literal_fused(struct mcc_ast_literal *literal,
+                                 struct mcc_ast_visitor *const *visitors,
+                                 size_t count);
+
+bool mcc_ast_visit_declaration_fused(struct mcc_ast_declaration *declaration,
+                                     struct mcc_ast_visitor *const *visitors,
+                                     size_t count);
+
+bool mcc_ast_visit_statement_fused(struct mcc_ast_statement *statement,
+                                   struct mcc_ast_visitor *const *visitors,
+                                   size_t count);
+
+bool mcc_ast_visit_function_def_fused(struct mcc_ast_function_def *function_def,
+                                      struct mcc_ast_visitor *const *visitors,
+                                      size_t count);
+
+bool mcc_ast_visit_program_fused(struct mcc_ast_program *program,
+                                 struct mcc_ast_visitor *const *visitors,
+                                 size_t count);
 
 
 // clang-format off
@@ -82,9 +155,21 @@ void mcc_ast_visit_parameters(struct mcc_ast_parameters *parameters, struct mcc_
 		struct mcc_ast_expression *: 	mcc_ast_visit_expression, \
 		struct mcc_ast_literal *:    	mcc_ast_visit_literal, \
 		struct mcc_ast_declaration *:   mcc_ast_visit_declaration, \
-		struct mcc_ast_identifier *:	mcc_ast_visit_identifier \
+		struct mcc_ast_identifier *:	mcc_ast_visit_identifier, \
+		struct mcc_ast_statement *:	mcc_ast_visit_statement, \
+		struct mcc_ast_function_def *:	mcc_ast_visit_function_def, \
+		struct mcc_ast_program *:	mcc_ast_visit_program \
 	)(x, visitor)
 
+#define mcc_ast_visit_fused(x, visitors, count) _Generic((x), \
+		struct mcc_ast_expression *: 	mcc_ast_visit_expression_fused, \
+		struct mcc_ast_literal *:    	mcc_ast_visit_literal_fused, \
+		struct mcc_ast_declaration *:   mcc_ast_visit_declaration_fused, \
+		struct mcc_ast_statement *:	mcc_ast_visit_statement_fused, \
+		struct mcc_ast_function_def *:	mcc_ast_visit_function_def_fused, \
+		struct mcc_ast_program *:	mcc_ast_visit_program_fused \
+	)(x, visitors, count)
+
 // clang-format on
 
 #endif // MCC_AST_VISIT_H
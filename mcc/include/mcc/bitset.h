@@ -0,0 +1,67 @@
+// Dense Bitsets
+//
+// Sets of small, dense integers (virtual registers, definitions, blocks)
+// stored as arrays of 64-bit words. The caller owns the storage, hence many
+// sets of the same size can share one allocation; see the dataflow framework.
+//
+// Operations on whole sets process one word at a time. Bits beyond the size
+// of a set are kept zero by all operations.
+
+#ifndef MCC_BITSET_H
+#define MCC_BITSET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint64_t mcc_bitset_word;
+
+#define MCC_BITSET_WORD_BITS 64
+
+// Number of words required for a set of `bits` elements.
+#define MCC_BITSET_WORDS(bits) ((uint32_t)(((uint64_t)(bits) + MCC_BITSET_WORD_BITS - 1) / MCC_BITSET_WORD_BITS))
+
+#define MCC_BITSET_MASK(bit) ((mcc_bitset_word)1 << ((bit) % MCC_BITSET_WORD_BITS))
+
+#define MCC_BITSET_TEST(set, bit) (((set)[(bit) / MCC_BITSET_WORD_BITS] & MCC_BITSET_MASK(bit)) != 0)
+#define MCC_BITSET_SET(set, bit) ((set)[(bit) / MCC_BITSET_WORD_BITS] |= MCC_BITSET_MASK(bit))
+#define MCC_BITSET_CLEAR(set, bit) ((set)[(bit) / MCC_BITSET_WORD_BITS] &= ~MCC_BITSET_MASK(bit))
+
+// Returned by `mcc_bitset_next` when no further bit is set.
+#define MCC_BITSET_END UINT32_MAX
+
+// Empties the set.
+void mcc_bitset_clear_all(mcc_bitset_word *set, uint32_t words);
+
+// Adds all elements 0 .. bits-1 to the set.
+void mcc_bitset_fill(mcc_bitset_word *set, uint32_t bits);
+
+void mcc_bitset_copy(mcc_bitset_word *dst, const mcc_bitset_word *src, uint32_t words);
+
+bool mcc_bitset_equal(const mcc_bitset_word *a, const mcc_bitset_word *b, uint32_t words);
+
+// dst |= src
+void mcc_bitset_union(mcc_bitset_word *dst, const mcc_bitset_word *src, uint32_t words);
+
+// dst &= src
+void mcc_bitset_intersect(mcc_bitset_word *dst, const mcc_bitset_word *src, uint32_t words);
+
+// dst &= ~src
+void mcc_bitset_difference(mcc_bitset_word *dst, const mcc_bitset_word *src, uint32_t words);
+
+// dst = gen | (src & ~kill), the transfer function of gen/kill problems.
+// Returns whether dst changed.
+bool mcc_bitset_transfer(mcc_bitset_word *dst,
+                         const mcc_bitset_word *gen,
+                         const mcc_bitset_word *src,
+                         const mcc_bitset_word *kill,
+                         uint32_t words);
+
+uint32_t mcc_bitset_count(const mcc_bitset_word *set, uint32_t words);
+
+// Returns the smallest element >= `from`, or MCC_BITSET_END. Iterate with
+//
+//     for (uint32_t i = mcc_bitset_next(set, words, 0); i != MCC_BITSET_END;
+//          i = mcc_bitset_next(set, words, i + 1))
+uint32_t mcc_bitset_next(const mcc_bitset_word *set, uint32_t words, uint32_t from);
+
+#endif // MCC_BITSET_H
@@ -0,0 +1,130 @@
+// Bytecode Interpreter
+//
+// Runs programs without any back-end: an IR module is translated to a compact
+// register-based bytecode, which is interpreted by a single dispatch loop.
+// This works on every host, and it serves as a reference when testing the
+// optimizer, as unoptimized and optimized modules must behave alike.
+//
+// Instructions are sequences of 32-bit words, an opcode followed by its
+// operands. Opcodes are specialized by type (int, float, vector), hence the
+// interpreter never inspects types at run time. Jump targets are word offsets
+// into the code of the whole program.
+//
+// Each call gets a frame of 8-byte values on a value stack: the virtual
+// registers first (four values for vectors), then the local arrays with one
+// value per element, then the constants used by the function. Constants are
+// copied into the frame on entry, so every operand is just a frame index.
+// Array addresses are indices into the value stack.
+//
+// Ints wrap around at 32 bits and floats are single precision, like in the
+// x86 back-end (see `mcc/asm.h`). The built-in functions are part of the
+// interpreter; they read from and print to the given streams like the runtime
+// does (see `resources/mc_builtins.c`).
+
+#ifndef MCC_BYTECODE_H
+#define MCC_BYTECODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mcc/arena.h"
+#include "mcc/ir.h"
+
+union mcc_bytecode_value {
+	// ints and bools
+	int32_t i;
+	float f;
+	const char *s;
+
+	// index of the first element in the value stack
+	uint32_t address;
+};
+
+struct mcc_bytecode_function {
+	// word offset of the first instruction, UINT32_MAX for built-in
+	// functions
+	uint32_t entry;
+
+	uint32_t parameter_count;
+
+	// number of values of a frame
+	uint32_t frame_size;
+
+	// the frame values of the arrays, zeroed on entry
+	uint32_t array_slot;
+	uint32_t array_values;
+
+	// the frame values [constant_slot, constant_slot + constant_count) are
+	// initialized from the bytecode's constants, starting at constant_first
+	uint32_t constant_slot;
+	uint32_t constant_first;
+	uint32_t constant_count;
+};
+
+struct mcc_bytecode {
+	uint32_t *code;
+	uint32_t code_size;
+	uint32_t code_capacity;
+
+	// indexed like the functions of the module
+	struct mcc_bytecode_function *functions;
+	uint32_t function_count;
+
+	union mcc_bytecode_value *constants;
+	uint32_t constant_count;
+	uint32_t constant_capacity;
+
+	// decoded string constants
+	struct mcc_arena strings;
+
+	// name of the built-in function missing if compilation failed with
+	// MCC_BYTECODE_UNDEFINED_SYMBOL
+	const char *undefined_symbol;
+};
+
+enum mcc_bytecode_status {
+	MCC_BYTECODE_OK,
+	MCC_BYTECODE_NO_MEMORY,
+
+	// the program calls a built-in function the interpreter does not know
+	MCC_BYTECODE_UNDEFINED_SYMBOL,
+
+	// the function to call does not exist or has the wrong signature
+	MCC_BYTECODE_NO_FUNCTION,
+
+	// errors of the program, which crash it when compiled natively: integer
+	// division by zero or overflow, access outside of the value stack and
+	// exhaustion of the stack
+	MCC_BYTECODE_DIVISION_ERROR,
+	MCC_BYTECODE_OUT_OF_BOUNDS,
+	MCC_BYTECODE_STACK_OVERFLOW,
+};
+
+// Upper bound of the value stack, 128 MiB.
+#define MCC_BYTECODE_STACK_LIMIT (UINT32_C(1) << 24)
+
+// Translates all functions of `module`. `bytecode` is left empty on failure.
+enum mcc_bytecode_status mcc_bytecode_compile(struct mcc_bytecode *bytecode, const struct mcc_ir_module *module);
+
+struct mcc_bytecode_result {
+	// result of the called function, 0 for void functions
+	int value;
+
+	// number of instructions executed
+	uint64_t instructions;
+};
+
+// Interprets the function of `module` named `name`, which takes no
+// parameters and returns an int or nothing, reading from `in` and printing to
+// `out`. `result` is filled even if the program fails at run time.
+enum mcc_bytecode_status mcc_bytecode_call(const struct mcc_bytecode *bytecode,
+                                           const struct mcc_ir_module *module,
+                                           const char *name,
+                                           FILE *in,
+                                           FILE *out,
+                                           struct mcc_bytecode_result *result);
+
+void mcc_bytecode_release(struct mcc_bytecode *bytecode);
+
+#endif // MCC_BYTECODE_H
@@ -0,0 +1,71 @@
+// Control Flow Graph (CFG)
+//
+// Splits the instructions of an IR function into basic blocks. A block is a
+// range of the function's instruction array: it starts at a label or after a
+// jump or return and ends with the next jump or return or before the next
+// label. Blocks are numbered in program order, block 0 is the entry.
+//
+// Edges are stored as block indices: up to two successors per block and the
+// predecessors of all blocks in one shared array. The blocks reachable from
+// the entry are additionally listed in reverse postorder, the order in which
+// forward dataflow problems converge fastest.
+//
+// The graph refers to the function's instructions by index; it has to be
+// rebuilt when instructions are added or removed.
+
+#ifndef MCC_CFG_H
+#define MCC_CFG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/ir.h"
+
+// Reverse postorder index of blocks not reachable from the entry.
+#define MCC_CFG_UNREACHABLE UINT32_MAX
+
+struct mcc_cfg_block {
+	// instructions first .. end-1, including the leading label
+	uint32_t first;
+	uint32_t end;
+
+	// For conditional jumps, successors[0] is the fall-through and
+	// successors[1] the jump target; both coincide at most once.
+	uint32_t successors[2];
+	uint32_t successor_count;
+
+	// predecessors are mcc_cfg.predecessors[predecessor_first ..]
+	uint32_t predecessor_first;
+	uint32_t predecessor_count;
+
+	// position in mcc_cfg.rpo or MCC_CFG_UNREACHABLE
+	uint32_t rpo_index;
+};
+
+struct mcc_cfg {
+	const struct mcc_ir_function *function;
+
+	struct mcc_cfg_block *blocks;
+	uint32_t block_count;
+
+	uint32_t *predecessors;
+
+	// block starting with each label of the function
+	uint32_t *label_blocks;
+
+	// blocks reachable from the entry, in reverse postorder
+	uint32_t *rpo;
+	uint32_t rpo_count;
+};
+
+// Builds the graph of `function`. Functions without instructions (built-ins)
+// yield a graph without blocks. Returns false if memory could not be
+// obtained; `cfg` has to be released in any case.
+bool mcc_cfg_build(struct mcc_cfg *cfg, const struct mcc_ir_function *function);
+
+void mcc_cfg_release(struct mcc_cfg *cfg);
+
+// Index of the block containing instruction `index`.
+uint32_t mcc_cfg_block_of(const struct mcc_cfg *cfg, uint32_t index);
+
+#endif // MCC_CFG_H
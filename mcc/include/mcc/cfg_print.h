@@ -0,0 +1,30 @@
+// CFG Print Infrastructure
+//
+// Prints control flow graphs in the DOT format. Every function becomes a
+// cluster of boxes, one per basic block, listing the block's instructions as
+// printed by `mcc/ir_print.h`. Edges leaving a conditional jump are labelled
+// with the value of the condition that takes them.
+
+#ifndef MCC_CFG_PRINT_H
+#define MCC_CFG_PRINT_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "mcc/cfg.h"
+#include "mcc/ir.h"
+
+void mcc_cfg_print_dot_begin(FILE *out);
+
+void mcc_cfg_print_dot_end(FILE *out);
+
+// Prints the graph of one function of `module` as a cluster. Returns false
+// if memory could not be obtained.
+bool mcc_cfg_print_dot_function(FILE *out, const struct mcc_ir_module *module, const struct mcc_cfg *cfg);
+
+// Prints the graphs of all functions of `module` except the built-ins. Unless
+// `function` is NULL, only the function with that name is printed. Returns
+// false if memory could not be obtained.
+bool mcc_cfg_print_dot(FILE *out, const struct mcc_ir_module *module, const char *function);
+
+#endif // MCC_CFG_PRINT_H
@@ -0,0 +1,83 @@
+// Dataflow Framework
+//
+// A generic iterative solver for gen/kill problems over the control flow
+// graph (see `mcc/cfg.h`). A problem is defined by its direction, its meet
+// operator and the gen and kill set of every block; the solver computes the
+// in and out set of every block reachable from the entry:
+//
+//   forward:   in[b]  = meet(out[p] for all predecessors p)
+//              out[b] = gen[b] | (in[b] & ~kill[b])
+//
+//   backward:  out[b] = meet(in[s] for all successors s)
+//              in[b]  = gen[b] | (out[b] & ~kill[b])
+//
+// The entry block (forward) or blocks without successors (backward)
+// additionally meet the boundary set.
+//
+// All sets are dense bitsets of the same size, stored back to back in one
+// array per kind. Blocks are processed in reverse postorder (forward) or
+// postorder (backward); a block is only revisited after the result of one of
+// its neighbours changed.
+
+#ifndef MCC_DATAFLOW_H
+#define MCC_DATAFLOW_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/bitset.h"
+#include "mcc/cfg.h"
+
+enum mcc_dataflow_direction {
+	MCC_DATAFLOW_FORWARD,
+	MCC_DATAFLOW_BACKWARD,
+};
+
+enum mcc_dataflow_meet {
+	MCC_DATAFLOW_UNION,
+	MCC_DATAFLOW_INTERSECTION,
+};
+
+struct mcc_dataflow {
+	enum mcc_dataflow_direction direction;
+	enum mcc_dataflow_meet meet;
+
+	uint32_t bit_count;
+	uint32_t word_count;
+	uint32_t block_count;
+
+	// word_count words per block, see MCC_DATAFLOW_SET
+	mcc_bitset_word *gen;
+	mcc_bitset_word *kill;
+	mcc_bitset_word *in;
+	mcc_bitset_word *out;
+
+	mcc_bitset_word *boundary;
+
+	// blocks waiting to be processed, by position in the visiting order
+	mcc_bitset_word *pending;
+
+	// number of blocks processed by the last run of the solver
+	uint32_t visits;
+};
+
+// Set `sets` (gen, kill, in or out) of block `block`.
+#define MCC_DATAFLOW_SET(dataflow, sets, block) (&(dataflow)->sets[(size_t)(block) * (dataflow)->word_count])
+
+// Prepares a problem over sets of `bit_count` elements for the blocks of
+// `cfg`. All gen, kill and boundary sets are empty. Returns false if memory
+// could not be obtained; `dataflow` has to be released in any case.
+bool mcc_dataflow_init(struct mcc_dataflow *dataflow,
+                       const struct mcc_cfg *cfg,
+                       enum mcc_dataflow_direction direction,
+                       enum mcc_dataflow_meet meet,
+                       uint32_t bit_count);
+
+void mcc_dataflow_release(struct mcc_dataflow *dataflow);
+
+// Computes the in and out sets from the gen, kill and boundary sets. The sets
+// of unreachable blocks are left at the initial value of the meet operator:
+// empty for union, full for intersection.
+void mcc_dataflow_solve(struct mcc_dataflow *dataflow, const struct mcc_cfg *cfg);
+
+#endif // MCC_DATAFLOW_H
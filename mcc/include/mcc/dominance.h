@@ -0,0 +1,47 @@
+// Dominance
+//
+// Block a dominates block b if every path from the entry to b passes through
+// a. The immediate dominators are computed iteratively over the reverse
+// postorder of the control flow graph, following "A Simple, Fast Dominance
+// Algorithm" by Cooper, Harvey and Kennedy.
+//
+// The dominance frontier of a is the set of blocks b where the dominance of a
+// ends: a dominates a predecessor of b, but does not strictly dominate b.
+// These are the places where SSA construction inserts phi instructions.
+//
+// Blocks unreachable from the entry are ignored.
+
+#ifndef MCC_DOMINANCE_H
+#define MCC_DOMINANCE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/cfg.h"
+
+struct mcc_dominance {
+	// immediate dominator of each block; the entry is its own immediate
+	// dominator, unreachable blocks have MCC_CFG_UNREACHABLE
+	uint32_t *idom;
+
+	// children of block b in the dominator tree are
+	// children[children_first[b] .. children_first[b + 1]-1]
+	uint32_t *children_first;
+	uint32_t *children;
+
+	// frontier of block b is
+	// frontiers[frontier_first[b] .. frontier_first[b + 1]-1]
+	uint32_t *frontier_first;
+	uint32_t *frontiers;
+};
+
+// Returns false if memory could not be obtained; `dominance` has to be
+// released in any case.
+bool mcc_dominance_compute(struct mcc_dominance *dominance, const struct mcc_cfg *cfg);
+
+void mcc_dominance_release(struct mcc_dominance *dominance);
+
+// Whether block `a` dominates block `b`, both have to be reachable.
+bool mcc_dominance_dominates(const struct mcc_dominance *dominance, uint32_t a, uint32_t b);
+
+#endif // MCC_DOMINANCE_H
@@ -0,0 +1,43 @@
+// Function Inlining
+//
+// Replaces calls by copies of the called function, saving the arguments
+// passed on the stack, the call and the frame setup, and exposing the body to
+// the optimizations of the caller. Parameters become registers of the caller
+// initialized from the arguments; a return becomes a copy to the result and a
+// jump behind the inlined body.
+//
+// The cost of a function is its number of instructions, labels and no-ops
+// excluded. A call is inlined if the cost of the callee is at most the limit,
+// times one plus the number of loops the call is nested in (counting up to
+// three), as calls in loops are executed more often. Every caller may grow by
+// at most MCC_INLINE_GROWTH times the limit.
+//
+// Built-in functions have no body and are never inlined, neither are
+// functions calling themselves directly or through others. Callees are
+// processed before their callers, so their own calls are inlined already.
+
+#ifndef MCC_INLINE_H
+#define MCC_INLINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/ir.h"
+
+// Limit of the cost of inlined functions used by default.
+#define MCC_INLINE_DEFAULT_LIMIT 40
+
+// Growth of a caller by inlining, in multiples of the limit.
+#define MCC_INLINE_GROWTH 8
+
+struct mcc_inline_stats {
+	uint32_t inlined_calls;
+};
+
+// Inlines calls in the functions of `module`, which must not be in SSA form,
+// with the cost limit `limit`; 0 disables inlining. If `stats` is not NULL,
+// the counts of this run are added to it. Returns false if memory could not be
+// obtained, `module` is then left in an unspecified state.
+bool mcc_inline(struct mcc_ir_module *module, uint32_t limit, struct mcc_inline_stats *stats);
+
+#endif // MCC_INLINE_H
@@ -0,0 +1,27 @@
+// String Interning
+//
+// A global pool of canonical strings. Interning equal strings yields the very
+// same pointer, hence interned strings can be compared for equality by
+// comparing pointers.
+//
+// The pool is thread-safe. It is split into shards, each guarded by its own
+// lock, to keep contention low when several parsers run concurrently.
+//
+// Interned strings stay valid until `mcc_intern_release` is called.
+
+#ifndef MCC_INTERN_H
+#define MCC_INTERN_H
+
+#include <stddef.h>
+
+// Returns NULL if memory could not be obtained.
+const char *mcc_intern(const char *str);
+
+// Like `mcc_intern`, but `str` need not be NUL-terminated.
+const char *mcc_intern_n(const char *str, size_t len);
+
+// Frees all interned strings. Must not be called while any interned string
+// (e.g. an identifier of a live AST) is still in use.
+void mcc_intern_release(void);
+
+#endif // MCC_INTERN_H
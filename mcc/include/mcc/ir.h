@@ -0,0 +1,299 @@
+// Intermediate Representation (IR)
+//
+// A low-level three-address code. Each function stores its instructions in one
+// contiguous array of fixed-size, 16-byte records, in program order. Passes
+// iterate this array linearly; there are no per-instruction allocations and
+// no pointers between instructions.
+//
+// Operands are 32-bit values tagged with their kind in the two topmost bits:
+//
+//   - virtual registers (`t0`, `t1`, ...), numbered densely per function,
+//   - indices into the module's constant pool,
+//   - immediates, like label numbers or function indices.
+//
+// Virtual registers are not in SSA form: variables of the source program map
+// to one register each, which is assigned repeatedly. Registers
+// 0 .. parameter_count-1 hold the parameters on function entry.
+//
+// Control flow is expressed with labels and jumps; basic blocks are not made
+// explicit here (see the control flow graph).
+
+#ifndef MCC_IR_H
+#define MCC_IR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/arena.h"
+
+// ------------------------------------------------------------------- Operands
+
+typedef uint32_t mcc_ir_operand;
+
+enum mcc_ir_operand_kind {
+	MCC_IR_OPERAND_NONE,
+	MCC_IR_OPERAND_VREG,
+	MCC_IR_OPERAND_CONST,
+	MCC_IR_OPERAND_IMM,
+};
+
+#define MCC_IR_OPERAND_BITS 30
+#define MCC_IR_OPERAND_MAX ((UINT32_C(1) << MCC_IR_OPERAND_BITS) - 1)
+
+#define MCC_IR_OPERAND(kind, index) ((mcc_ir_operand)((uint32_t)(kind) << MCC_IR_OPERAND_BITS | (uint32_t)(index)))
+
+#define MCC_IR_NONE MCC_IR_OPERAND(MCC_IR_OPERAND_NONE, 0)
+#define MCC_IR_VREG(index) MCC_IR_OPERAND(MCC_IR_OPERAND_VREG, index)
+#define MCC_IR_CONST(index) MCC_IR_OPERAND(MCC_IR_OPERAND_CONST, index)
+#define MCC_IR_IMM(value) MCC_IR_OPERAND(MCC_IR_OPERAND_IMM, value)
+
+#define MCC_IR_OPERAND_KIND(operand) ((enum mcc_ir_operand_kind)((operand) >> MCC_IR_OPERAND_BITS))
+#define MCC_IR_OPERAND_INDEX(operand) ((uint32_t)(operand)&MCC_IR_OPERAND_MAX)
+
+#define MCC_IR_IS_VREG(operand) (MCC_IR_OPERAND_KIND(operand) == MCC_IR_OPERAND_VREG)
+
+// ---------------------------------------------------------------------- Types
+
+enum mcc_ir_type {
+	MCC_IR_TYPE_VOID,
+	MCC_IR_TYPE_INT,
+	MCC_IR_TYPE_FLOAT,
+	MCC_IR_TYPE_BOOL,
+
+	// pointer to a NUL-terminated string
+	MCC_IR_TYPE_STRING,
+
+	// pointer to the first element of an array
+	MCC_IR_TYPE_ADDRESS,
+
+	// four ints or floats processed at once, only introduced by the
+	// vectorizer (see `mcc/vectorize.h`)
+	MCC_IR_TYPE_INT4,
+	MCC_IR_TYPE_FLOAT4,
+};
+
+// Number of elements of vector types.
+#define MCC_IR_VECTOR_LANES 4
+
+// ---------------------------------------------------------------- Instructions
+
+// Operand usage per opcode; unused operands are MCC_IR_NONE. Unless noted
+// otherwise, `type` is the type of the result.
+enum mcc_ir_opcode {
+	MCC_IR_NOP,
+
+	// dest = a
+	MCC_IR_COPY,
+
+	// dest = the operand of the edge control arrived from, in SSA form only;
+	// the operands are function->phi_operands[a .. a+b-1] (a and b IMM), one
+	// per predecessor of the basic block in the order of the control flow
+	// graph
+	MCC_IR_PHI,
+
+	// dest = a <op> b, for int and float; lane by lane for float vectors and,
+	// with ADD and SUB only, for int vectors
+	MCC_IR_ADD,
+	MCC_IR_SUB,
+	MCC_IR_MUL,
+	MCC_IR_DIV,
+
+	// dest = -a
+	MCC_IR_NEG,
+
+	// dest = a <op> b, dest is a bool and `type` is the type of a and b
+	MCC_IR_EQ,
+	MCC_IR_NE,
+	MCC_IR_LT,
+	MCC_IR_GT,
+	MCC_IR_LE,
+	MCC_IR_GE,
+
+	// dest = a <op> b, dest = !a, for bools
+	MCC_IR_AND,
+	MCC_IR_OR,
+	MCC_IR_NOT,
+
+	// dest = address of the local array with index a (IMM), `type` is the
+	// element type
+	MCC_IR_ARRAY,
+
+	// dest = a[b], a is an address and `type` is the element type
+	MCC_IR_LOAD,
+
+	// dest[a] = b; note that dest is *read*, it holds the address
+	MCC_IR_STORE,
+
+	// dest = a in every lane, `type` is the vector type
+	MCC_IR_SPLAT,
+
+	// dest = a[b .. b+3], a is an address and `type` is the vector type
+	MCC_IR_VLOAD,
+
+	// dest[a .. a+3] = b, dest is read as for MCC_IR_STORE
+	MCC_IR_VSTORE,
+
+	// a (IMM) is the label number
+	MCC_IR_LABEL,
+
+	// goto a (IMM label)
+	MCC_IR_JUMP,
+
+	// if a is false goto b (IMM label)
+	MCC_IR_JUMP_IF_FALSE,
+
+	// if a is true goto b (IMM label)
+	MCC_IR_JUMP_IF_TRUE,
+
+	// passes a as the next argument of the following call, arguments are
+	// passed in order; `type` is the type of a
+	MCC_IR_ARG,
+
+	// dest = call of the function with index a (IMM) taking b (IMM)
+	// arguments; dest is MCC_IR_NONE for void functions
+	MCC_IR_CALL,
+
+	// return a; a is MCC_IR_NONE for void functions
+	MCC_IR_RETURN,
+};
+
+struct mcc_ir_instruction {
+	// enum mcc_ir_opcode
+	uint8_t opcode;
+
+	// enum mcc_ir_type
+	uint8_t type;
+
+	// reserved for passes, zero after construction
+	uint16_t flags;
+
+	mcc_ir_operand dest;
+	mcc_ir_operand a;
+	mcc_ir_operand b;
+};
+
+// Upper bound of the number of registers read by one instruction.
+#define MCC_IR_MAX_USES 3
+
+// Returns the virtual register written by `instruction`, or MCC_IR_NONE.
+mcc_ir_operand mcc_ir_defined_vreg(const struct mcc_ir_instruction *instruction);
+
+// Stores the virtual registers read by `instruction` in `uses` and returns
+// their number. The operands of phi instructions are not included.
+uint32_t mcc_ir_used_vregs(const struct mcc_ir_instruction *instruction, mcc_ir_operand uses[MCC_IR_MAX_USES]);
+
+// -------------------------------------------------------------- Constant Pool
+
+struct mcc_ir_constant {
+	enum mcc_ir_type type;
+	union {
+		// MCC_IR_TYPE_INT
+		long i_value;
+
+		// MCC_IR_TYPE_FLOAT
+		double f_value;
+
+		// MCC_IR_TYPE_BOOL
+		bool b_value;
+
+		// MCC_IR_TYPE_STRING, owned by the module
+		const char *s_value;
+	};
+};
+
+// ------------------------------------------------------------------ Functions
+
+struct mcc_ir_array {
+	enum mcc_ir_type element_type;
+	uint32_t size;
+};
+
+struct mcc_ir_function {
+	// interned, see `mcc/intern.h`
+	const char *name;
+
+	enum mcc_ir_type return_type;
+
+	// built-in functions are provided by the runtime, they have no body
+	bool builtin;
+
+	uint32_t parameter_count;
+
+	struct mcc_ir_instruction *instructions;
+	uint32_t instruction_count;
+	uint32_t instruction_capacity;
+
+	// type of each virtual register, enum mcc_ir_type
+	uint8_t *vreg_types;
+	uint32_t vreg_count;
+	uint32_t vreg_capacity;
+
+	// local arrays
+	struct mcc_ir_array *arrays;
+	uint32_t array_count;
+	uint32_t array_capacity;
+
+	uint32_t label_count;
+
+	// operands of the phi instructions, see MCC_IR_PHI
+	mcc_ir_operand *phi_operands;
+	uint32_t phi_operand_count;
+	uint32_t phi_operand_capacity;
+};
+
+// --------------------------------------------------------------------- Module
+
+struct mcc_ir_module {
+	// built-ins first, then the functions of the program in source order
+	struct mcc_ir_function *functions;
+	uint32_t function_count;
+	uint32_t function_capacity;
+
+	struct mcc_ir_constant *constants;
+	uint32_t constant_count;
+	uint32_t constant_capacity;
+
+	// open addressing table of constant indices + 1, 0 marks a free slot
+	uint32_t *constant_slots;
+	uint32_t constant_slot_capacity;
+
+	// strings of the constant pool
+	struct mcc_arena arena;
+};
+
+void mcc_ir_module_init(struct mcc_ir_module *module);
+
+void mcc_ir_module_release(struct mcc_ir_module *module);
+
+// Construction functions return MCC_IR_OPERAND_MAX or false if memory could
+// not be obtained. Pointers into the arrays of a module or function are
+// invalidated when elements are added.
+
+// Adds a function without instructions and returns its index.
+uint32_t mcc_ir_add_function(struct mcc_ir_module *module, const char *name, enum mcc_ir_type return_type);
+
+// Returns the pool index of `constant`, adding it unless an equal constant is
+// already present. Strings are copied.
+uint32_t mcc_ir_add_constant(struct mcc_ir_module *module, const struct mcc_ir_constant *constant);
+
+// String constants keep the escape sequences of the source, which are
+// interpreted like the assembler does. Writes the decoded NUL-terminated
+// string to `out`, which needs at most the size of `string`.
+void mcc_ir_decode_string(char *out, const char *string);
+
+uint32_t mcc_ir_new_vreg(struct mcc_ir_function *function, enum mcc_ir_type type);
+
+uint32_t mcc_ir_new_label(struct mcc_ir_function *function);
+
+uint32_t mcc_ir_add_array(struct mcc_ir_function *function, enum mcc_ir_type element_type, uint32_t size);
+
+bool mcc_ir_emit(struct mcc_ir_function *function, const struct mcc_ir_instruction *instruction);
+
+// Reserves `count` phi operands, set to MCC_IR_NONE, and returns the index of
+// the first one. On failure, returns MCC_IR_OPERAND_MAX and adds none.
+uint32_t mcc_ir_add_phi_operands(struct mcc_ir_function *function, uint32_t count);
+
+// Returns the index of the function called `name`, or MCC_IR_OPERAND_MAX.
+uint32_t mcc_ir_find_function(const struct mcc_ir_module *module, const char *name);
+
+#endif // MCC_IR_H
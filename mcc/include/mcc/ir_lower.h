@@ -0,0 +1,30 @@
+// AST to IR Lowering
+//
+// Translates a type-checked program to three-address code (see `mcc/ir.h`).
+//
+// Every scalar variable and parameter is mapped to one virtual register,
+// every local array to an array slot whose address is taken at its
+// declaration. Expressions are lowered in one post-order traversal each; the
+// value of an expression is looked up by its `type_index`, hence deep
+// expression trees do not grow the native stack.
+//
+// Built-in functions are added to the module before the functions of the
+// program; every function ends with a `return`.
+
+#ifndef MCC_IR_LOWER_H
+#define MCC_IR_LOWER_H
+
+#include <stdbool.h>
+
+#include "mcc/ast.h"
+#include "mcc/ir.h"
+#include "mcc/type_check.h"
+
+// Appends the functions of `program` to the empty `module`. `types` must be
+// the successful result of checking `program`. Returns false if memory could
+// not be obtained, `module` has to be released in any case.
+bool mcc_ir_lower(struct mcc_ir_module *module,
+                  struct mcc_ast_program *program,
+                  const struct mcc_type_check_result *types);
+
+#endif // MCC_IR_LOWER_H
@@ -0,0 +1,40 @@
+// IR Print Infrastructure
+//
+// Prints three-address code in a textual form, one instruction per line:
+//
+//     function int fib(int t0)
+//         t1 = lt int t0, 2
+//         ifz t1 goto L0
+//         return int t0
+//     L0:
+//         ...
+//
+// Operands are printed as virtual registers (`t3`), labels (`L0`) and the
+// values of constants; every line corresponds to one instruction record.
+
+#ifndef MCC_IR_PRINT_H
+#define MCC_IR_PRINT_H
+
+#include <stdio.h>
+
+#include "mcc/ir.h"
+
+const char *mcc_ir_print_opcode(enum mcc_ir_opcode opcode);
+
+const char *mcc_ir_print_type(enum mcc_ir_type type);
+
+void mcc_ir_print_operand(FILE *out, const struct mcc_ir_module *module, mcc_ir_operand operand);
+
+// `function` is the function containing `instruction`.
+void mcc_ir_print_instruction(FILE *out,
+                              const struct mcc_ir_module *module,
+                              const struct mcc_ir_function *function,
+                              const struct mcc_ir_instruction *instruction);
+
+void mcc_ir_print_function(FILE *out, const struct mcc_ir_module *module, const struct mcc_ir_function *function);
+
+// Prints all functions of `module` except the built-ins. Unless `function` is
+// NULL, only the function with that name is printed.
+void mcc_ir_print(FILE *out, const struct mcc_ir_module *module, const char *function);
+
+#endif // MCC_IR_PRINT_H
@@ -0,0 +1,77 @@
+// Just-in-Time Compilation
+//
+// Compiles an IR module to x86-64 machine code in an executable mapping of
+// the compiler process, so that programs run without an assembler, linker
+// or 32-bit runtime. Built-in functions are bound to functions of the host
+// process by name and called through the System V ABI.
+//
+// Code generation is kept simple as it is meant for quick runs: every
+// virtual register lives in a frame slot, 8 bytes wide or 16 for vectors.
+// Each instruction loads its operands into scratch registers and stores its
+// result. Ints stay 32 bits wide like in the x86 backend (see `mcc/asm.h`).
+// Floats use scalar SSE, matching its default float mode. Strings and array
+// addresses are 64-bit pointers.
+//
+// Compiled functions pass their arguments in 8-byte slots on the stack, the
+// first at the lowest address. They return results in `eax` or `xmm0`. They
+// preserve the registers the System V ABI requires, so functions without
+// parameters can be called from C.
+//
+// Only x86-64 hosts are supported; elsewhere compilation fails.
+
+#ifndef MCC_JIT_H
+#define MCC_JIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mcc/ir.h"
+
+// A function of the host process bound to a built-in function.
+struct mcc_jit_symbol {
+	const char *name;
+	void (*address)(void);
+};
+
+enum mcc_jit_status {
+	MCC_JIT_OK,
+	MCC_JIT_NO_MEMORY,
+
+	// the host is not x86-64 or refuses executable memory
+	MCC_JIT_UNSUPPORTED,
+
+	// a built-in function called by the program has no symbol
+	MCC_JIT_UNDEFINED_SYMBOL,
+};
+
+struct mcc_jit {
+	// executable mapping of `size` bytes
+	uint8_t *code;
+	size_t size;
+
+	// offset of each function of the module in `code`, UINT32_MAX for
+	// built-in functions
+	uint32_t *function_offsets;
+	uint32_t function_count;
+
+	// name of the missing symbol if compilation failed with
+	// MCC_JIT_UNDEFINED_SYMBOL
+	const char *undefined_symbol;
+};
+
+// Compiles all functions of `module`, binding built-in functions to the
+// `symbol_count` entries of `symbols`. `jit` is left empty on failure.
+enum mcc_jit_status mcc_jit_compile(struct mcc_jit *jit,
+                                    const struct mcc_ir_module *module,
+                                    const struct mcc_jit_symbol *symbols,
+                                    uint32_t symbol_count);
+
+// Calls the function of `module` named `name`, which takes no parameters and
+// returns an int or nothing. `result` receives the int result, or 0. Returns
+// false if there is no such function.
+bool mcc_jit_call(const struct mcc_jit *jit, const struct mcc_ir_module *module, const char *name, int *result);
+
+void mcc_jit_release(struct mcc_jit *jit);
+
+#endif // MCC_JIT_H
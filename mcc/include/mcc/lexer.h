@@ -0,0 +1,91 @@
+// Lexer
+//
+// A hand-written scanner for mC, used by the recursive descent parser. It
+// recognises exactly the tokens of `scanner.l`, including their source
+// locations, but works directly on an in-memory buffer: a token merely refers
+// to its text in the input, nothing is copied or allocated.
+//
+// Whitespace and comments are skipped. Characters not starting any token
+// yield `MCC_TOKEN_INVALID`.
+
+#ifndef MCC_LEXER_H
+#define MCC_LEXER_H
+
+#include <stddef.h>
+
+#include "mcc/ast.h"
+
+enum mcc_token_type {
+	MCC_TOKEN_EOF,
+	MCC_TOKEN_INVALID,
+
+	MCC_TOKEN_INT_LITERAL,
+	MCC_TOKEN_FLOAT_LITERAL,
+	MCC_TOKEN_STRING_LITERAL,
+	MCC_TOKEN_BOOL_LITERAL,
+	MCC_TOKEN_IDENTIFIER,
+
+	MCC_TOKEN_LPARENTH,
+	MCC_TOKEN_RPARENTH,
+	MCC_TOKEN_LBRACKET,
+	MCC_TOKEN_RBRACKET,
+	MCC_TOKEN_LBRACE,
+	MCC_TOKEN_RBRACE,
+
+	MCC_TOKEN_ASSIGNMENT,
+	MCC_TOKEN_PLUS,
+	MCC_TOKEN_MINUS,
+	MCC_TOKEN_ASTER,
+	MCC_TOKEN_SLASH,
+	MCC_TOKEN_LESS,
+	MCC_TOKEN_GREATER,
+	MCC_TOKEN_LESS_EQ,
+	MCC_TOKEN_GREATER_EQ,
+	MCC_TOKEN_EQUALS,
+	MCC_TOKEN_NOT_EQUALS,
+	MCC_TOKEN_SEMICOLON,
+	MCC_TOKEN_COMMA,
+	MCC_TOKEN_NOT,
+	MCC_TOKEN_AND,
+	MCC_TOKEN_OR,
+
+	MCC_TOKEN_BOOL_TYPE,
+	MCC_TOKEN_INT_TYPE,
+	MCC_TOKEN_FLOAT_TYPE,
+	MCC_TOKEN_STRING_TYPE,
+	MCC_TOKEN_VOID_TYPE,
+
+	MCC_TOKEN_IF,
+	MCC_TOKEN_ELSE,
+	MCC_TOKEN_WHILE,
+	MCC_TOKEN_FOR,
+	MCC_TOKEN_RETURN,
+};
+
+struct mcc_token {
+	enum mcc_token_type type;
+
+	// Points into the input, not NUL-terminated. For string literals, this
+	// includes the quotes.
+	const char *text;
+	size_t len;
+
+	struct mcc_ast_source_location sloc;
+};
+
+struct mcc_lexer {
+	const char *pos;
+	const char *end;
+
+	// position of `pos`
+	int line;
+	int col;
+};
+
+void mcc_lexer_init(struct mcc_lexer *lexer, const char *data, size_t len);
+
+// Scans the next token. Once the input is exhausted, `MCC_TOKEN_EOF` is
+// returned repeatedly.
+void mcc_lexer_next(struct mcc_lexer *lexer, struct mcc_token *token);
+
+#endif // MCC_LEXER_H
@@ -0,0 +1,23 @@
+// Liveness Analysis
+//
+// A virtual register is live at a point of a function if its value may be
+// read later on without being written before. This is a backward problem over
+// sets of virtual registers: gen holds the registers read in a block before
+// being written there, kill the registers written in a block.
+//
+// After the analysis, the in and out sets of the dataflow problem hold the
+// registers live on entry and exit of each block.
+
+#ifndef MCC_LIVENESS_H
+#define MCC_LIVENESS_H
+
+#include <stdbool.h>
+
+#include "mcc/cfg.h"
+#include "mcc/dataflow.h"
+
+// Solves liveness for the function of `cfg`. Returns false if memory could
+// not be obtained; `dataflow` has to be released in any case.
+bool mcc_liveness_compute(struct mcc_dataflow *dataflow, const struct mcc_cfg *cfg);
+
+#endif // MCC_LIVENESS_H
@@ -0,0 +1,31 @@
+// Memory-Mapped Input Files
+//
+// Maps a regular file into memory such that it can be handed directly to
+// `mcc_parse_buffer`: the mapping is private (writes are not carried through
+// to the file) and the content is followed by two NUL bytes.
+//
+// Only pages touched by the scanner are read; pages modified in place are
+// copied on write by the kernel.
+
+#ifndef MCC_MAPPED_FILE_H
+#define MCC_MAPPED_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct mcc_mapped_file {
+	char *data;
+	size_t len;
+
+	// internal
+	size_t map_len;
+	bool is_mapped;
+};
+
+// Returns false and sets `errno` on failure. Files which are not regular files
+// (e.g. pipes) cannot be mapped, `errno` is set to ENODEV in this case.
+bool mcc_mapped_file_open(struct mcc_mapped_file *file, const char *path);
+
+void mcc_mapped_file_close(struct mcc_mapped_file *file);
+
+#endif // MCC_MAPPED_FILE_H
@@ -0,0 +1,83 @@
+// x86 Object Files
+//
+// Encodes the code produced by the backend (see `mcc/asm.h`) as 32-bit x86
+// machine code and writes it as an ELF relocatable object file, which the
+// linker accepts in place of the output of the assembler.
+//
+// Functions are added as instruction lists (see `mcc/peephole.h`), in the AT&T
+// syntax printed for the assembler; only the instructions emitted by the
+// backend are known. Jumps to labels within a function are resolved right
+// away and always take 32-bit displacements. Code refers to data labels and
+// functions by name; these references are resolved when the file is written,
+// those to functions not added become undefined symbols for the linker.
+//
+// The file has the sections `.text`, `.rodata` and `.note.GNU-stack`, the
+// latter marking the stack as not executable, like the text output does.
+
+#ifndef MCC_OBJECT_H
+#define MCC_OBJECT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "mcc/peephole.h"
+
+struct mcc_object_buffer {
+	uint8_t *data;
+	uint32_t size;
+	uint32_t capacity;
+};
+
+struct mcc_object_symbol {
+	char *name;
+
+	// offset in .text for functions, in .rodata otherwise
+	uint32_t offset;
+	uint32_t size;
+	bool function;
+};
+
+struct mcc_object_relocation {
+	// offset of the 32-bit field in .text, which holds the addend
+	uint32_t offset;
+	char *symbol;
+
+	// relative to the end of the field, as for calls, otherwise absolute
+	bool relative;
+};
+
+struct mcc_object {
+	struct mcc_object_buffer text;
+	struct mcc_object_buffer rodata;
+
+	struct mcc_object_symbol *symbols;
+	uint32_t symbol_count;
+	uint32_t symbol_capacity;
+
+	struct mcc_object_relocation *relocations;
+	uint32_t relocation_count;
+	uint32_t relocation_capacity;
+};
+
+void mcc_object_init(struct mcc_object *object);
+
+void mcc_object_release(struct mcc_object *object);
+
+// Encodes `code` as the global function `name`. Returns false if memory could
+// not be obtained.
+bool mcc_object_add_function(struct mcc_object *object, const char *name, const struct mcc_peephole_code *code);
+
+// Appends `size` bytes of read-only data at `label`, aligned to `alignment`
+// bytes. Returns false if memory could not be obtained.
+bool mcc_object_add_data(struct mcc_object *object,
+                         const char *label,
+                         const void *data,
+                         uint32_t size,
+                         uint32_t alignment);
+
+// Writes `object` as an ELF relocatable file. Returns false if memory could
+// not be obtained or writing failed.
+bool mcc_object_write(FILE *out, const struct mcc_object *object);
+
+#endif // MCC_OBJECT_H
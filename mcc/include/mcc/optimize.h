@@ -0,0 +1,43 @@
+// IR Optimization
+//
+// Runs the optimization passes over all functions of a module. First, calls
+// are inlined (see `mcc/inline.h`). Then recursive tail calls of each
+// function are turned into loops (see `mcc/tail_call.h`) and the function is
+// converted into SSA form (see `mcc/ssa.h`), constants are propagated and
+// dead branches removed (see `mcc/sccp.h`), then the function is converted
+// back. Finally, element-wise loops over arrays are vectorized (see
+// `mcc/vectorize.h`); the result is ordinary three-address code for the
+// backends, using vector types only where the vectorizer introduced them.
+
+#ifndef MCC_OPTIMIZE_H
+#define MCC_OPTIMIZE_H
+
+#include <stdbool.h>
+
+#include "mcc/inline.h"
+#include "mcc/ir.h"
+#include "mcc/sccp.h"
+#include "mcc/tail_call.h"
+#include "mcc/vectorize.h"
+
+struct mcc_optimize_options {
+	// cost limit of inlined functions, 0 disables inlining
+	uint32_t inline_limit;
+};
+
+struct mcc_optimize_stats {
+	struct mcc_inline_stats inlining;
+	struct mcc_tail_call_stats tail_calls;
+	struct mcc_sccp_stats sccp;
+	struct mcc_vectorize_stats vectorize;
+};
+
+// Optimizes the functions of `module` in place. Without `options`, the
+// defaults are used. If `stats` is not NULL, it is filled with the counts of
+// all passes. Returns false if memory could not be obtained, `module` is then
+// left in an unspecified state.
+bool mcc_optimize(struct mcc_ir_module *module,
+                  const struct mcc_optimize_options *options,
+                  struct mcc_optimize_stats *stats);
+
+#endif // MCC_OPTIMIZE_H
@@ -4,34 +4,139 @@
 //
 // It tries to convert a given text input to an AST. On success, ownership of
 // the AST is transferred to the caller via the `mcc_parser_result` struct.
+//
+// All nodes of the AST live in the arena owned by the result. Use
+// `mcc_parser_delete_result` to free the whole tree at once. On failure, the
+// arena has already been released and the node pointers are NULL.
 
 #ifndef MCC_PARSER_H
 #define MCC_PARSER_H
 
+#include <stdbool.h>
 #include <stdio.h>
 
 #include "mcc/ast.h"
+#include "mcc/mapped_file.h"
 
 enum mcc_parser_status {
 	MCC_PARSER_STATUS_OK,
 	MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM,
 	MCC_PARSER_STATUS_UNKNOWN_ERROR,
+
+	// the input is an expression, declaration or statement, reported where
+	// a program is expected
+	MCC_PARSER_STATUS_NOT_A_PROGRAM,
 };
 
 struct mcc_parser_result {
 	enum mcc_parser_status status;
 
+	struct mcc_arena arena;
+
 	struct mcc_ast_expression *expression;
 	struct mcc_ast_literal *literal;
 	struct mcc_ast_declaration *declaration;
 	struct mcc_ast_statement *statement;
+	struct mcc_ast_program *program;
 
-	
+	// Input files mapped by `mcc_parse_files`. The AST may refer to them,
+	// they are released together with the arena.
+	struct mcc_mapped_file *inputs;
+	size_t input_count;
+
+	// Bytes of the arena held by nodes `mcc_parse_incremental` replaced.
+	size_t dead_bytes;
 };
 
 struct mcc_parser_result mcc_parse_string(const char *input);
 
 struct mcc_parser_result mcc_parse_file(FILE *input);
 
+// Parses `len` bytes at `data` without copying them. The buffer must be
+// writable and followed by two NUL bytes (`data[len]` and `data[len + 1]`),
+// as the scanner works on it in place. String literals of the resulting AST
+// point into the buffer, hence it must outlive the AST.
+//
+// See `mcc/mapped_file.h` for obtaining such a buffer from a file.
+struct mcc_parser_result mcc_parse_buffer(char *data, size_t len);
+
+// Parses each of the given files in isolation and merges the resulting
+// programs into one. Up to `jobs` files are parsed concurrently. The order of
+// function definitions in the merged program follows the order of `paths`,
+// regardless of `jobs`.
+//
+// Unless `cache_dir` is NULL, the AST cache in that directory is consulted for
+// each file (see `mcc/ast_cache.h`).
+//
+// Each file has to hold a program. On failure, the status of the first
+// failing file (in the order of `paths`) is reported and `failed_input` is set
+// to its index.
+struct mcc_parser_result
+mcc_parse_files(const char *const *paths, size_t count, unsigned jobs, const char *cache_dir, size_t *failed_input);
+
+void mcc_parser_delete_result(struct mcc_parser_result *result);
+
+// ------------------------------------------------------- Incremental Parsing
+
+// An edit of the text a result was parsed from: the text from `start` up to
+// `old_end` has been replaced by text ending at `new_end`. Positions use the
+// coordinates of source locations, ends are exclusive. `old_end` equals
+// `start` for an insertion, `new_end` equals `start` for a deletion.
+struct mcc_parser_edit {
+	int start_line;
+	int start_col;
+	int old_end_line;
+	int old_end_col;
+	int new_end_line;
+	int new_end_col;
+};
+
+// Parses `input`, which is the text `previous` was parsed from with `edit`
+// applied. Only the text between the function definitions enclosing the edit
+// is scanned and parsed again; all other function definitions of `previous`
+// are reused, keeping their addresses. Source locations of the ones following
+// the edit are shifted in place.
+//
+// `previous` must hold a program obtained from `mcc_parse_string`,
+// `mcc_parse_file` or this function, since reused string literals are not
+// copied. It is consumed: its arena moves to the returned result and
+// `previous` is left empty.
+//
+// Nodes of replaced function definitions remain allocated in the arena. Once
+// they take up more of it than the tree itself, all of `input` is parsed from
+// scratch instead, releasing them. Hence the memory held during a long
+// editing session stays proportional to the size of the tree.
+//
+// If the edited text cannot be parsed on its own, like a comment opened there
+// which ends further down, all of `input` is parsed. Either way, the returned
+// tree equals the one `mcc_parse_string(input)` builds, including source
+// locations.
+struct mcc_parser_result
+mcc_parse_incremental(struct mcc_parser_result *previous, const char *input, const struct mcc_parser_edit *edit);
+
+// ------------------------------------------------------------------- Engines
+
+// Two interchangeable parser implementations back the functions above: the
+// LALR parser generated from `parser.y`, and a hand-written recursive descent
+// parser. Both accept the same language and build identical ASTs, including
+// source locations.
+enum mcc_parser_engine {
+	MCC_PARSER_ENGINE_BISON,
+	MCC_PARSER_ENGINE_DESCENT,
+};
+
+// Name of the environment variable the applications read the engine from.
+#define MCC_PARSER_ENGINE_ENV "MCC_PARSER"
+
+// Selects the engine used by all subsequent parses, the default is
+// `MCC_PARSER_ENGINE_BISON`. This is process-wide and may be called while
+// other threads are parsing.
+void mcc_parser_set_engine(enum mcc_parser_engine engine);
+
+enum mcc_parser_engine mcc_parser_get_engine(void);
+
+// Looks up an engine by its name, `bison` or `descent`. Returns false for
+// unknown names.
+bool mcc_parser_engine_from_name(const char *name, enum mcc_parser_engine *engine);
 
 #endif // MCC_PARSER_H
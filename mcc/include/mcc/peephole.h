@@ -0,0 +1,90 @@
+// Peephole Optimization
+//
+// Rewrites short windows of the x86 code produced by the backend (see
+// `mcc/asm.h`) before it is printed. Selecting instructions for each IR
+// instruction in isolation leaves moves through scratch registers, bools
+// materialized only to be tested by the next branch, and stack adjustments
+// undone right away between calls.
+//
+// The code of a function is kept as a list of instructions, each a mnemonic
+// with its operands in AT&T syntax, and labels. Rules are listed in a table
+// and matched at every instruction; a rule applies to straight-line code
+// only, except those about jumps. As rules create opportunities for others,
+// the list is rescanned until no rule applies.
+//
+// Rules may depend on a register or the flags being overwritten before they
+// are read again. This is decided by a liveness analysis over the list, which
+// knows the effects of the instructions of the backend; other instructions
+// are assumed to read all their operands and the flags. Frame slots are not
+// tracked, stores to memory are never removed.
+
+#ifndef MCC_PEEPHOLE_H
+#define MCC_PEEPHOLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define MCC_PEEPHOLE_MAX_OPERANDS 3
+
+enum mcc_peephole_rule {
+	MCC_PEEPHOLE_COMPARE_BRANCH,
+	MCC_PEEPHOLE_COMPARE_OPERAND,
+	MCC_PEEPHOLE_COMPARE_ZERO,
+	MCC_PEEPHOLE_MOVE_BACK,
+	MCC_PEEPHOLE_DEAD_RESULT,
+	MCC_PEEPHOLE_FOLD_OPERATION,
+	MCC_PEEPHOLE_ZERO_REGISTER,
+	MCC_PEEPHOLE_STACK_ADJUSTMENT,
+	MCC_PEEPHOLE_JUMP_NEXT,
+	MCC_PEEPHOLE_BRANCH_OVER,
+	MCC_PEEPHOLE_RULE_COUNT,
+};
+
+struct mcc_peephole_stats {
+	// applications of each rule
+	uint32_t hits[MCC_PEEPHOLE_RULE_COUNT];
+};
+
+struct mcc_peephole_instruction {
+	// the mnemonic, or the name of a label, followed by the operands, each
+	// terminated by '\0'
+	char *text;
+	const char *operands[MCC_PEEPHOLE_MAX_OPERANDS];
+	uint8_t operand_count;
+	bool label;
+};
+
+struct mcc_peephole_code {
+	struct mcc_peephole_instruction *instructions;
+	uint32_t instruction_count;
+	uint32_t instruction_capacity;
+};
+
+void mcc_peephole_code_init(struct mcc_peephole_code *code);
+
+// Removes all instructions of `code`, keeping its memory.
+void mcc_peephole_code_clear(struct mcc_peephole_code *code);
+
+void mcc_peephole_code_release(struct mcc_peephole_code *code);
+
+// Appends a line of code, which is either an instruction with its operands
+// separated by commas, or a label followed by a colon. Returns false if
+// memory could not be obtained.
+bool mcc_peephole_append(struct mcc_peephole_code *code, const char *line);
+
+// Prints `code` as assembly, one line per instruction or label.
+void mcc_peephole_print(FILE *out, const struct mcc_peephole_code *code);
+
+// Applies the rules to `code` until none applies anymore. If `stats` is not
+// NULL, the hits of this run are added to it. Returns false if memory could
+// not be obtained, `code` then stays valid and keeps the same meaning.
+bool mcc_peephole_optimize(struct mcc_peephole_code *code, struct mcc_peephole_stats *stats);
+
+// Short name of `rule`, as listed in reports.
+const char *mcc_peephole_rule_name(enum mcc_peephole_rule rule);
+
+// One-line description of the rewrite made by `rule`.
+const char *mcc_peephole_rule_description(enum mcc_peephole_rule rule);
+
+#endif // MCC_PEEPHOLE_H
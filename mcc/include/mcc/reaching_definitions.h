@@ -0,0 +1,46 @@
+// Reaching Definitions
+//
+// A definition is an instruction writing a virtual register; it reaches a
+// point of the function if some path leads from it to that point without
+// another write to the same register. This is a forward problem over sets of
+// definitions.
+//
+// Definitions are numbered densely: the parameters come first, they are
+// defined on function entry, followed by the defining instructions in program
+// order.
+
+#ifndef MCC_REACHING_DEFINITIONS_H
+#define MCC_REACHING_DEFINITIONS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/cfg.h"
+#include "mcc/dataflow.h"
+
+// Instruction index of the definitions of parameters.
+#define MCC_REACHING_DEFINITIONS_PARAMETER UINT32_MAX
+
+struct mcc_reaching_definitions {
+	// in and out sets hold the definitions reaching entry and exit of each
+	// block
+	struct mcc_dataflow dataflow;
+
+	// defining instruction and defined register of each definition
+	uint32_t *instructions;
+	uint32_t *vregs;
+	uint32_t definition_count;
+
+	// definitions of register v are
+	// vreg_definitions[vreg_first[v] .. vreg_first[v + 1]-1]
+	uint32_t *vreg_first;
+	uint32_t *vreg_definitions;
+};
+
+// Solves reaching definitions for the function of `cfg`. Returns false if
+// memory could not be obtained; `definitions` has to be released in any case.
+bool mcc_reaching_definitions_compute(struct mcc_reaching_definitions *definitions, const struct mcc_cfg *cfg);
+
+void mcc_reaching_definitions_release(struct mcc_reaching_definitions *definitions);
+
+#endif // MCC_REACHING_DEFINITIONS_H
@@ -0,0 +1,71 @@
+// Linear-Scan Register Allocation
+//
+// Assigns the virtual registers of an IR function to the registers of a
+// target, following "Linear Scan Register Allocation" by Poletto and Sarkar.
+//
+// Instructions are numbered in program order. The live interval of a
+// register spans from its first to its last occurrence, extended to the
+// bounds of the blocks where it is live on entry or exit (see
+// `mcc/liveness.h`); holes are not tracked. Intervals are visited by start;
+// when no register is free, the interval ending last is spilled, it then
+// lives on the stack for its whole lifetime.
+//
+// Registers are grouped into classes, each virtual register is allocated in
+// the class of its type. Registers which are not preserved across calls are
+// only assigned to intervals not spanning a call.
+
+#ifndef MCC_REGALLOC_H
+#define MCC_REGALLOC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/cfg.h"
+#include "mcc/ir.h"
+
+// Location of virtual registers without a register.
+#define MCC_REGALLOC_STACK UINT8_MAX
+
+// Location of virtual registers which are never read or written.
+#define MCC_REGALLOC_UNUSED (UINT8_MAX - 1)
+
+#define MCC_REGALLOC_MAX_CLASSES 2
+#define MCC_REGALLOC_MAX_REGISTERS 16
+
+struct mcc_regalloc_class {
+	uint32_t register_count;
+
+	// bit r is set if register r keeps its value across calls
+	uint32_t call_preserved;
+};
+
+struct mcc_regalloc_target {
+	struct mcc_regalloc_class classes[MCC_REGALLOC_MAX_CLASSES];
+
+	// class of each enum mcc_ir_type
+	uint8_t type_classes[MCC_IR_TYPE_FLOAT4 + 1];
+};
+
+struct mcc_regalloc {
+	// register of each virtual register within its class, or one of
+	// MCC_REGALLOC_STACK and MCC_REGALLOC_UNUSED
+	uint8_t *locations;
+
+	// bit r of used_registers[c] is set if register r of class c is assigned
+	uint32_t used_registers[MCC_REGALLOC_MAX_CLASSES];
+
+	// intervals of classes with registers, and those of them spilled
+	uint32_t interval_count;
+	uint32_t spill_count;
+};
+
+// Allocates the registers of the function of `cfg` for `target`. Returns
+// false if memory could not be obtained; `allocation` has to be released in
+// any case.
+bool mcc_regalloc_compute(struct mcc_regalloc *allocation,
+                          const struct mcc_cfg *cfg,
+                          const struct mcc_regalloc_target *target);
+
+void mcc_regalloc_release(struct mcc_regalloc *allocation);
+
+#endif // MCC_REGALLOC_H
@@ -0,0 +1,44 @@
+// Sparse Conditional Constant Propagation (SCCP)
+//
+// Finds the registers holding the same constant on every execution and the
+// edges which are never taken, following Wegman and Zadeck. Each register
+// starts out as undetermined and is lowered to a constant or to varying as
+// the instructions writing it are evaluated; only blocks reached along edges
+// known to be taken are evaluated, so constants flowing through phis in loops
+// are found as well.
+//
+// The function is then rewritten: instructions computing constants become
+// NOPs and their uses read the constant instead, conditional jumps on
+// constants become unconditional jumps or NOPs and blocks never reached are
+// emptied. Copies of registers are propagated alike: their uses read the
+// source register.
+
+#ifndef MCC_SCCP_H
+#define MCC_SCCP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/ir.h"
+#include "mcc/ssa.h"
+
+struct mcc_sccp_stats {
+	// instructions replaced by a constant
+	uint32_t folded_constants;
+
+	// conditional jumps replaced by a jump or removed
+	uint32_t removed_branches;
+
+	// blocks found never to be executed
+	uint32_t unreachable_blocks;
+
+	// copies of registers replaced by their source
+	uint32_t propagated_copies;
+};
+
+// Runs SCCP on the function of `ssa`, which has to be in SSA form. Folded
+// constants are added to `module`. If `stats` is not NULL, the counts of this
+// run are added to it. Returns false if memory could not be obtained.
+bool mcc_sccp(struct mcc_ir_module *module, struct mcc_ssa *ssa, struct mcc_sccp_stats *stats);
+
+#endif // MCC_SCCP_H
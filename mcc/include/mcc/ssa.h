@@ -0,0 +1,59 @@
+// Static Single Assignment (SSA) Form
+//
+// Converts an IR function into SSA form, where every virtual register is
+// written by exactly one instruction, and back. Construction follows Cytron
+// et al.: phi instructions are placed at the iterated dominance frontiers of
+// the blocks writing a register, pruned to the blocks where the register is
+// live; then registers are renamed in a preorder walk of the dominator tree.
+//
+// Every write gets a fresh register. The registers of the original function
+// remain as the values on function entry: the parameters, or undefined for
+// locals read before being written.
+//
+// While in SSA form the control flow graph of `mcc_ssa` must be kept, since
+// phi operands are ordered by its predecessor lists; passes may turn
+// instructions into NOPs and mark edges as never taken, but must not move
+// instructions. Destruction first merges phi operands into the register of
+// their phi wherever their values are never live at the same time, then
+// replaces the remaining phis with copies at the end of the predecessors,
+// splitting critical edges, and drops all NOPs.
+
+#ifndef MCC_SSA_H
+#define MCC_SSA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/bitset.h"
+#include "mcc/cfg.h"
+#include "mcc/ir.h"
+
+struct mcc_ssa {
+	struct mcc_ir_function *function;
+
+	struct mcc_cfg cfg;
+
+	// registers below this are the values on function entry
+	uint32_t entry_vreg_count;
+
+	// edge to successor s of block b may be taken if bit 2*b+s is set
+	mcc_bitset_word *executable_edges;
+
+	uint32_t phi_count;
+};
+
+#define MCC_SSA_EDGE(block, successor) (2 * (block) + (successor))
+
+// Converts `function` into SSA form. Blocks unreachable from the entry are
+// removed; if the entry has predecessors, a new, empty entry is put in front.
+// Returns false if memory could not be obtained, `function` is then left in
+// an unspecified state. `ssa` has to be released in any case.
+bool mcc_ssa_construct(struct mcc_ssa *ssa, struct mcc_ir_function *function);
+
+// Converts the function of `ssa` out of SSA form. Returns false if memory
+// could not be obtained.
+bool mcc_ssa_destruct(struct mcc_ssa *ssa);
+
+void mcc_ssa_release(struct mcc_ssa *ssa);
+
+#endif // MCC_SSA_H
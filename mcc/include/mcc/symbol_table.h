@@ -0,0 +1,126 @@
+// Symbol Table
+//
+// Maps names to their declarations while walking a program, modelling nested
+// scopes and shadowing.
+//
+// All scopes share one open-addressing hash table keyed by the interned name.
+// A name's entry refers to the innermost visible symbol, which in turn refers
+// to the symbol it shadows. Declarations are recorded in an undo log; leaving
+// a scope walks its part of the log and restores the shadowed symbols. Hence
+// neither entering nor leaving a scope copies anything, and looking up a name
+// takes constant time regardless of how deeply it is nested.
+//
+// Symbols are allocated from the table's arena and stay valid until the table
+// is released, also after their scope has been left.
+
+#ifndef MCC_SYMBOL_TABLE_H
+#define MCC_SYMBOL_TABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "mcc/arena.h"
+#include "mcc/ast.h"
+
+enum mcc_symbol_kind {
+	MCC_SYMBOL_KIND_VARIABLE,
+	MCC_SYMBOL_KIND_PARAMETER,
+	MCC_SYMBOL_KIND_FUNCTION,
+	MCC_SYMBOL_KIND_BUILTIN,
+};
+
+struct mcc_symbol {
+	enum mcc_symbol_kind kind;
+
+	// interned, see `mcc/intern.h`
+	const char *name;
+
+	// nesting depth of the declaring scope, the outermost scope has depth 0
+	unsigned depth;
+
+	union {
+		// MCC_SYMBOL_KIND_VARIABLE, MCC_SYMBOL_KIND_PARAMETER
+		struct mcc_ast_declaration *declaration;
+
+		// MCC_SYMBOL_KIND_FUNCTION, MCC_SYMBOL_KIND_BUILTIN
+		struct mcc_ast_function_def *function_def;
+	};
+
+	// symbol of the same name hidden by this one, NULL if none
+	const struct mcc_symbol *shadowed;
+};
+
+enum mcc_symbol_table_status {
+	MCC_SYMBOL_TABLE_OK,
+
+	// the name is already declared in the current scope
+	MCC_SYMBOL_TABLE_DUPLICATE,
+
+	MCC_SYMBOL_TABLE_NO_MEMORY,
+};
+
+struct mcc_symbol_table_entry {
+	const char *name;
+
+	// innermost visible symbol, NULL once all its scopes have been left
+	const struct mcc_symbol *symbol;
+};
+
+struct mcc_symbol_table {
+	struct mcc_arena arena;
+
+	// open addressing with linear probing, capacity is a power of two
+	struct mcc_symbol_table_entry *entries;
+	size_t entry_count;
+	size_t entry_capacity;
+
+	// symbols in order of declaration, truncated when leaving a scope
+	const struct mcc_symbol **log;
+	size_t log_count;
+	size_t log_capacity;
+
+	// start of each open scope in the log
+	size_t *scopes;
+	unsigned depth;
+	size_t scope_capacity;
+};
+
+// Initializes an empty table with a single (outermost) scope open.
+void mcc_symbol_table_init(struct mcc_symbol_table *table);
+
+// Frees the table and all its symbols.
+void mcc_symbol_table_release(struct mcc_symbol_table *table);
+
+// Returns false if memory could not be obtained.
+bool mcc_symbol_table_push_scope(struct mcc_symbol_table *table);
+
+// Leaves the innermost scope, which must not be the outermost one.
+void mcc_symbol_table_pop_scope(struct mcc_symbol_table *table);
+
+// Declares a symbol in the current scope. On success `symbol` (optional) is set
+// to the new symbol. If the name is already declared in the current scope,
+// nothing is declared and `symbol` is set to the existing symbol instead.
+enum mcc_symbol_table_status mcc_symbol_table_declare_variable(struct mcc_symbol_table *table,
+                                                               enum mcc_symbol_kind kind,
+                                                               struct mcc_ast_declaration *declaration,
+                                                               const struct mcc_symbol **symbol);
+
+enum mcc_symbol_table_status mcc_symbol_table_declare_function(struct mcc_symbol_table *table,
+                                                               enum mcc_symbol_kind kind,
+                                                               struct mcc_ast_function_def *function_def,
+                                                               const struct mcc_symbol **symbol);
+
+// Declares the built-in functions (`print`, `read_int`, …) in the current
+// scope. Their definitions are synthesized in the table's arena and have an
+// empty body.
+enum mcc_symbol_table_status mcc_symbol_table_declare_builtins(struct mcc_symbol_table *table);
+
+// Returns the innermost visible symbol named `name`, NULL if there is none.
+// `name` must be interned, e.g. the value of an identifier.
+const struct mcc_symbol *mcc_symbol_table_lookup(const struct mcc_symbol_table *table, const char *name);
+
+// Symbols declared in the current scope, in order of declaration. The pointer
+// is invalidated by the next declaration.
+const struct mcc_symbol *const *mcc_symbol_table_scope(const struct mcc_symbol_table *table, size_t *count);
+
+#endif // MCC_SYMBOL_TABLE_H
@@ -0,0 +1,27 @@
+// Symbol Table Print Infrastructure
+//
+// Builds the symbol tables of a program scope by scope and prints them in a
+// human-readable form. Parameters share the scope of the function body, each
+// nested compound statement opens a new scope.
+
+#ifndef MCC_SYMBOL_TABLE_PRINT_H
+#define MCC_SYMBOL_TABLE_PRINT_H
+
+#include <stdio.h>
+
+#include "mcc/ast.h"
+#include "mcc/symbol_table.h"
+
+// Prints the symbols of every scope of `program`, including the built-in
+// functions. Unless `function` is NULL, only the scopes of the function with
+// that name are printed.
+//
+// Stops at the first name declared twice in the same scope and returns
+// MCC_SYMBOL_TABLE_DUPLICATE; `duplicate` (optional) is then set to the
+// identifier of the second declaration.
+enum mcc_symbol_table_status mcc_symbol_table_print(FILE *out,
+                                                    struct mcc_ast_program *program,
+                                                    const char *function,
+                                                    struct mcc_ast_identifier **duplicate);
+
+#endif // MCC_SYMBOL_TABLE_PRINT_H
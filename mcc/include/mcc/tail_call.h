@@ -0,0 +1,46 @@
+// Tail Call Elimination
+//
+// Turns calls of a function to itself into jumps back to its start, so that
+// recursion runs in a loop instead of growing the stack. A call is a tail
+// call if its result is returned right away:
+//
+//   t = call f, n          ->   parameters = arguments
+//   return t                    goto start
+//
+// Calls whose result is combined with another value x before it is returned
+// are rewritten as well, by keeping the combined values in an accumulator
+// register a. A return of v then returns `a op v`:
+//
+//   t = call f, n          ->   a = op a, x
+//   u = op t, x                 parameters = arguments
+//   return u                    goto start
+//
+// This relies on `op` being associative and commutative, which holds exactly
+// for `add` and `mul` on ints, wrapping around, and for `and` and `or` on
+// bools; as mC does not convert between types, float arithmetic, which is
+// not associative, is never reordered. All such calls of a function must use
+// the same operation, a is initialized with its identity.
+
+#ifndef MCC_TAIL_CALL_H
+#define MCC_TAIL_CALL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/ir.h"
+
+struct mcc_tail_call_stats {
+	// tail calls turned into jumps
+	uint32_t tail_calls;
+
+	// calls turned into jumps by accumulating their operand
+	uint32_t accumulated_calls;
+};
+
+// Eliminates the recursive tail calls of the function with index `function`
+// in `module`, which must not be in SSA form. If `stats` is not NULL, the
+// counts of this run are added to it. Returns false if memory could not be
+// obtained, the function is then left in an unspecified state.
+bool mcc_tail_call_eliminate(struct mcc_ir_module *module, uint32_t function, struct mcc_tail_call_stats *stats);
+
+#endif // MCC_TAIL_CALL_H
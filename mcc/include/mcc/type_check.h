@@ -0,0 +1,94 @@
+// Type Checker
+//
+// Computes the type of every expression of a program and checks the typing
+// rules of statements and calls.
+//
+// Function bodies are walked statement by statement, resolving names with a
+// `mcc_symbol_table`. Each expression tree is traversed once in post-order;
+// the type of a node is derived from the already computed types of its
+// operands and appended to a side array. The expression itself only records
+// its position in that array (`mcc_ast_expression.type_index`), hence types
+// are never re-derived and later passes look them up in constant time.
+//
+// The side array grows geometrically and the traversal reuses one work list
+// for the whole program, so checking allocates no memory per node and runs in
+// time linear in the size of the program.
+//
+// Checking stops at the first error.
+
+#ifndef MCC_TYPE_CHECK_H
+#define MCC_TYPE_CHECK_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "mcc/ast.h"
+
+struct mcc_type {
+	enum mcc_ast_data_type base;
+
+	// number of elements, -1 for scalars
+	long array_size;
+};
+
+// Type of one expression, entries are stored in post-order.
+struct mcc_type_check_entry {
+	struct mcc_ast_expression *expression;
+	struct mcc_type type;
+};
+
+// Entries of one function definition, `first` indexes
+// `mcc_type_check_result.entries`.
+struct mcc_type_check_function {
+	struct mcc_ast_function_def *function_def;
+	size_t first;
+	size_t count;
+};
+
+enum mcc_type_check_status {
+	MCC_TYPE_CHECK_OK,
+	MCC_TYPE_CHECK_ERROR,
+	MCC_TYPE_CHECK_NO_MEMORY,
+};
+
+struct mcc_type_check_result {
+	enum mcc_type_check_status status;
+
+	struct mcc_type_check_entry *entries;
+	size_t entry_count;
+	size_t entry_capacity;
+
+	// in program order, up to the erroneous function
+	struct mcc_type_check_function *functions;
+	size_t function_count;
+	size_t function_capacity;
+
+	// MCC_TYPE_CHECK_ERROR: location and description of the error
+	struct mcc_ast_source_location error_sloc;
+	char error[160];
+};
+
+// Checks `program` and annotates its expressions. On MCC_TYPE_CHECK_ERROR,
+// the entries of all expressions typed before the error are kept.
+//
+// The result must be freed with `mcc_type_check_delete_result`, whatever its
+// status. It refers to the AST, which has to outlive it.
+struct mcc_type_check_result mcc_type_check(struct mcc_ast_program *program);
+
+void mcc_type_check_delete_result(struct mcc_type_check_result *result);
+
+// Type of an expression of a successfully checked program.
+const struct mcc_type *mcc_type_check_type_of(const struct mcc_type_check_result *result,
+                                              const struct mcc_ast_expression *expression);
+
+// Writes a textual representation of `type`, e.g. `float[4]`, to `buf`.
+// Returns the number of characters that would have been written, as
+// `snprintf` does.
+int mcc_type_format(char *buf, size_t size, const struct mcc_type *type);
+
+// Prints the type of every expression in post-order, grouped by function.
+// Unless `function` is NULL, only the expressions of the function with that
+// name are printed.
+void mcc_type_check_trace(FILE *out, const struct mcc_type_check_result *result, const char *function);
+
+#endif // MCC_TYPE_CHECK_H
@@ -0,0 +1,48 @@
+// Loop Vectorization
+//
+// Rewrites element-wise loops over arrays to process four elements per
+// iteration with vector instructions. Loops of this shape are recognised in
+// three-address code out of SSA form, N being a constant:
+//
+//   L0: t = lt int i, N
+//       ifz t goto L1
+//       ...                  straight-line body
+//       i = add int i, 1     possibly through copies
+//       goto L0
+//   L1:
+//
+// The body may only load and store elements at index i of loop-invariant
+// addresses and compute on the loaded values and loop-invariant operands with
+// the arithmetic supported for vectors (see MCC_IR_ADD). Values computed in
+// one iteration must not be read in a later one or after the loop.
+//
+// As iteration i only accesses elements i, the lanes of four consecutive
+// iterations are independent, even if addresses alias. The vector loop is
+// placed in front of the original loop, which then runs the remaining
+// iterations:
+//
+//   L2: t' = lt int i, N-3
+//       ifz t' goto L0
+//       ...                  vector body
+//       i = add int i, 4
+//       goto L2
+
+#ifndef MCC_VECTORIZE_H
+#define MCC_VECTORIZE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mcc/ir.h"
+
+struct mcc_vectorize_stats {
+	uint32_t vectorized_loops;
+};
+
+// Vectorizes the loops of `function`, adding constants to `module`. If
+// `stats` is not NULL, the counts of this run are added to it. Returns false
+// if memory could not be obtained, `function` is then left in an unspecified
+// state.
+bool mcc_vectorize(struct mcc_ir_module *module, struct mcc_ir_function *function, struct mcc_vectorize_stats *stats);
+
+#endif // MCC_VECTORIZE_H
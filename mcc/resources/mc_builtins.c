@@ -1,11 +1,19 @@
 #include <stdio.h>
 
-void __attribute__((cdecl)) print(const char *msg);
-void __attribute__((cdecl)) print_nl(void);
-void __attribute__((cdecl)) print_int(long x);
-void __attribute__((cdecl)) print_float(float x);
-long __attribute__((cdecl)) read_int(void);
-float __attribute__((cdecl)) read_float(void);
+// the driver links the builtins for running programs in-process (mcc --run)
+// on x86-64, where cdecl is not a distinct calling convention
+#ifdef __i386__
+#define MC_CDECL __attribute__((cdecl))
+#else
+#define MC_CDECL
+#endif
+
+void MC_CDECL print(const char *msg);
+void MC_CDECL print_nl(void);
+void MC_CDECL print_int(long x);
+void MC_CDECL print_float(float x);
+long MC_CDECL read_int(void);
+float MC_CDECL read_float(void);
 
 void print(const char *msg)
 {
@@ -0,0 +1,137 @@
+#include "mcc/arena.h"
+
+#include <assert.h>
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Default payload size of a chunk. Requests larger than this get a dedicated
+// chunk of their own.
+#define CHUNK_SIZE (64 * 1024)
+
+#define ALIGN_UP(x) (((x) + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1))
+
+struct mcc_arena_chunk {
+	struct mcc_arena_chunk *next;
+	size_t size;
+	size_t used;
+	max_align_t data[];
+};
+
+static struct mcc_arena_chunk *new_chunk(size_t size)
+{
+	struct mcc_arena_chunk *chunk = malloc(sizeof(*chunk) + size);
+	if (!chunk) {
+		return NULL;
+	}
+
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+void mcc_arena_init(struct mcc_arena *arena)
+{
+	assert(arena);
+
+	arena->head = NULL;
+}
+
+void *mcc_arena_alloc(struct mcc_arena *arena, size_t size)
+{
+	assert(arena);
+
+	size = ALIGN_UP(size);
+
+	struct mcc_arena_chunk *chunk = arena->head;
+	if (!chunk || chunk->size - chunk->used < size) {
+		chunk = new_chunk(size > CHUNK_SIZE ? size : CHUNK_SIZE);
+		if (!chunk) {
+			return NULL;
+		}
+
+		// Keep the current chunk in front if the new one is a dedicated
+		// oversized chunk; the remainder of the current one stays usable.
+		if (arena->head && size > CHUNK_SIZE) {
+			chunk->next = arena->head->next;
+			arena->head->next = chunk;
+		} else {
+			chunk->next = arena->head;
+			arena->head = chunk;
+		}
+	}
+
+	void *ptr = (char *)chunk->data + chunk->used;
+	chunk->used += size;
+	return ptr;
+}
+
+char *mcc_arena_strdup(struct mcc_arena *arena, const char *str)
+{
+	assert(arena);
+	assert(str);
+
+	size_t len = strlen(str) + 1;
+
+	char *copy = mcc_arena_alloc(arena, len);
+	if (!copy) {
+		return NULL;
+	}
+
+	memcpy(copy, str, len);
+	return copy;
+}
+
+void mcc_arena_merge(struct mcc_arena *dst, struct mcc_arena *src)
+{
+	assert(dst);
+	assert(src);
+
+	if (!src->head) {
+		return;
+	}
+
+	// Append behind the current head of `dst` so its free space stays in use.
+	struct mcc_arena_chunk *tail = src->head;
+	while (tail->next) {
+		tail = tail->next;
+	}
+
+	if (dst->head) {
+		tail->next = dst->head->next;
+		dst->head->next = src->head;
+	} else {
+		dst->head = src->head;
+	}
+
+	src->head = NULL;
+}
+
+void mcc_arena_release(struct mcc_arena *arena)
+{
+	assert(arena);
+
+	struct mcc_arena_chunk *chunk = arena->head;
+	while (chunk) {
+		struct mcc_arena_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+
+	arena->head = NULL;
+}
+
+void mcc_arena_stats(const struct mcc_arena *arena, struct mcc_arena_stats *stats)
+{
+	assert(arena);
+	assert(stats);
+
+	*stats = (struct mcc_arena_stats){0};
+
+	for (const struct mcc_arena_chunk *chunk = arena->head; chunk; chunk = chunk->next) {
+		stats->chunks++;
+		stats->used += chunk->used;
+		stats->reserved += chunk->size;
+	}
+}
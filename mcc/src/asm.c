@@ -0,0 +1,1176 @@
+#include "mcc/asm.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/bitset.h"
+#include "mcc/cfg.h"
+#include "mcc/object.h"
+#include "mcc/regalloc.h"
+#include "utils/reserve.h"
+
+// ------------------------------------------------------------------- Target
+
+enum register_class {
+	CLASS_GENERAL,
+	CLASS_FLOAT,
+};
+
+// callee-saved, the caller-saved ones are scratch registers
+static const char *const general_registers[] = {"%ebx", "%esi", "%edi"};
+
+// all caller-saved, xmm0 and xmm1 are scratch registers
+static const char *const float_registers[] = {"%xmm2", "%xmm3", "%xmm4", "%xmm5", "%xmm6", "%xmm7"};
+
+// floats live in the frame and pass through the x87 stack
+static const struct mcc_regalloc_target x87_target = {
+    .classes =
+        {
+            [CLASS_GENERAL] = {.register_count = 3, .call_preserved = 0x7},
+            [CLASS_FLOAT] = {.register_count = 0},
+        },
+    .type_classes =
+        {
+            [MCC_IR_TYPE_FLOAT] = CLASS_FLOAT,
+            [MCC_IR_TYPE_INT4] = CLASS_FLOAT,
+            [MCC_IR_TYPE_FLOAT4] = CLASS_FLOAT,
+        },
+};
+
+static const struct mcc_regalloc_target sse_target = {
+    .classes =
+        {
+            [CLASS_GENERAL] = {.register_count = 3, .call_preserved = 0x7},
+            [CLASS_FLOAT] = {.register_count = 6, .call_preserved = 0},
+        },
+    .type_classes =
+        {
+            [MCC_IR_TYPE_FLOAT] = CLASS_FLOAT,
+            [MCC_IR_TYPE_INT4] = CLASS_FLOAT,
+            [MCC_IR_TYPE_FLOAT4] = CLASS_FLOAT,
+        },
+};
+
+// Stack slots, array elements and arguments are 4 bytes each.
+#define SLOT_SIZE 4
+
+// Vectors take the slots of all their lanes.
+#define VECTOR_SLOT_SIZE (SLOT_SIZE * MCC_IR_VECTOR_LANES)
+
+// The stack is aligned to this at calls.
+#define STACK_ALIGNMENT 16
+
+// ------------------------------------------------------------------ Emitter
+
+struct codegen {
+	// the code is encoded into `object` if not NULL, printed to `out`
+	// otherwise
+	FILE *out;
+	struct mcc_object *object;
+	const struct mcc_asm_options *options;
+	const struct mcc_ir_module *module;
+	const struct mcc_ir_function *function;
+	uint32_t function_index;
+
+	bool sse;
+	const struct mcc_regalloc_target *target;
+	struct mcc_regalloc allocation;
+
+	// frame offsets from ebp of the registers on the stack and of the arrays
+	int32_t *offsets;
+	int32_t *array_offsets;
+
+	// callee-saved registers pushed in the prologue
+	uint32_t saved_count;
+
+	// frame slot moving floats between SSE and x87 registers
+	int32_t transfer_offset;
+
+	// stack reserved for the arguments of the next call, arguments stored
+	uint32_t argument_bytes;
+	uint32_t argument_count;
+
+	// constants to be emitted to .rodata, and whether the mask flipping the
+	// sign of floats is needed
+	mcc_bitset_word *used_constants;
+	bool uses_sign_mask;
+
+	// code of the function, collected for the peephole optimizer, and the
+	// line being emitted
+	struct mcc_peephole_code code;
+	char *line;
+	size_t line_length;
+	size_t line_capacity;
+	bool failed;
+};
+
+static bool in_register(const struct codegen *cg, mcc_ir_operand operand)
+{
+	return MCC_IR_IS_VREG(operand) && cg->allocation.locations[MCC_IR_OPERAND_INDEX(operand)] < MCC_REGALLOC_UNUSED;
+}
+
+static bool is_float_register(const struct codegen *cg, mcc_ir_operand operand)
+{
+	return in_register(cg, operand) &&
+	       cg->target->type_classes[cg->function->vreg_types[MCC_IR_OPERAND_INDEX(operand)]] == CLASS_FLOAT;
+}
+
+static const char *register_of(const struct codegen *cg, mcc_ir_operand operand)
+{
+	assert(in_register(cg, operand));
+	uint8_t location = cg->allocation.locations[MCC_IR_OPERAND_INDEX(operand)];
+	return is_float_register(cg, operand) ? float_registers[location] : general_registers[location];
+}
+
+static const struct mcc_ir_constant *constant_of(const struct codegen *cg, mcc_ir_operand operand)
+{
+	if (MCC_IR_OPERAND_KIND(operand) != MCC_IR_OPERAND_CONST) {
+		return NULL;
+	}
+	return &cg->module->constants[MCC_IR_OPERAND_INDEX(operand)];
+}
+
+// Whether `operand` is encoded in the instruction; float constants are read
+// from memory.
+static bool is_immediate(const struct codegen *cg, mcc_ir_operand operand)
+{
+	const struct mcc_ir_constant *constant = constant_of(cg, operand);
+	return constant && constant->type != MCC_IR_TYPE_FLOAT;
+}
+
+static bool same_location(const struct codegen *cg, mcc_ir_operand a, mcc_ir_operand b)
+{
+	if (a == b) {
+		return true;
+	}
+	return in_register(cg, a) && in_register(cg, b) && register_of(cg, a) == register_of(cg, b);
+}
+
+// Appends to the line being emitted.
+static void append(struct codegen *cg, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+
+	if (!reserve_wide((void **)&cg->line, &cg->line_capacity, cg->line_length, (size_t)length + 1, 1)) {
+		cg->failed = true;
+		return;
+	}
+
+	va_start(args, format);
+	vsnprintf(cg->line + cg->line_length, cg->line_capacity - cg->line_length, format, args);
+	va_end(args);
+	cg->line_length += (size_t)length;
+}
+
+// Adds the line being emitted to the code of the function.
+static void end_line(struct codegen *cg)
+{
+	if (!cg->failed && !mcc_peephole_append(&cg->code, cg->line)) {
+		cg->failed = true;
+	}
+	cg->line_length = 0;
+}
+
+static void print_operand(struct codegen *cg, mcc_ir_operand operand)
+{
+	uint32_t index = MCC_IR_OPERAND_INDEX(operand);
+
+	if (MCC_IR_IS_VREG(operand)) {
+		if (in_register(cg, operand)) {
+			append(cg, "%s", register_of(cg, operand));
+		} else {
+			append(cg, "%d(%%ebp)", (int)cg->offsets[index]);
+		}
+		return;
+	}
+
+	const struct mcc_ir_constant *constant = constant_of(cg, operand);
+	assert(constant);
+	switch (constant->type) {
+	case MCC_IR_TYPE_INT:
+		append(cg, "$%ld", (long)(int32_t)constant->i_value);
+		break;
+	case MCC_IR_TYPE_BOOL:
+		append(cg, "$%d", constant->b_value ? 1 : 0);
+		break;
+	case MCC_IR_TYPE_STRING:
+		MCC_BITSET_SET(cg->used_constants, index);
+		append(cg, "$.LC%u", index);
+		break;
+	case MCC_IR_TYPE_FLOAT:
+		MCC_BITSET_SET(cg->used_constants, index);
+		append(cg, ".LC%u", index);
+		break;
+	default:
+		assert(false);
+	}
+}
+
+// Emits one instruction. Besides %d, %u, %s and %%, the format takes %o for
+// an operand and %l for a label operand.
+static void emit(struct codegen *cg, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+
+	for (const char *c = format; *c; ++c) {
+		if (*c != '%') {
+			size_t length = strcspn(c, "%");
+			append(cg, "%.*s", (int)length, c);
+			c += length - 1;
+			continue;
+		}
+
+		switch (*++c) {
+		case 'd':
+			append(cg, "%d", va_arg(args, int));
+			break;
+		case 'u':
+			append(cg, "%u", va_arg(args, unsigned));
+			break;
+		case 's':
+			append(cg, "%s", va_arg(args, const char *));
+			break;
+		case 'o':
+			print_operand(cg, va_arg(args, mcc_ir_operand));
+			break;
+		case 'l': {
+			mcc_ir_operand label = va_arg(args, mcc_ir_operand);
+			append(cg, ".L%u_%u", cg->function_index, MCC_IR_OPERAND_INDEX(label));
+			break;
+		}
+		default:
+			append(cg, "%c", *c);
+		}
+	}
+	end_line(cg);
+
+	va_end(args);
+}
+
+// ------------------------------------------------------------------- Moves
+
+// Loads `src` into the register `reg` unless it is there already.
+static void load(struct codegen *cg, const char *reg, mcc_ir_operand src)
+{
+	if (!in_register(cg, src) || strcmp(register_of(cg, src), reg) != 0) {
+		emit(cg, "movl %o, %s", src, reg);
+	}
+}
+
+// Stores the register `reg` to `dest` unless it is there already.
+static void store(struct codegen *cg, mcc_ir_operand dest, const char *reg)
+{
+	if (!in_register(cg, dest) || strcmp(register_of(cg, dest), reg) != 0) {
+		emit(cg, "movl %s, %o", reg, dest);
+	}
+}
+
+// Copies 4 bytes; floats outside of SSE registers are moved by their bits.
+static void copy(struct codegen *cg, mcc_ir_operand dest, mcc_ir_operand src)
+{
+	if (same_location(cg, dest, src)) {
+		return;
+	}
+	if (is_float_register(cg, dest) && is_float_register(cg, src)) {
+		// movss between registers would merge with the old value of dest
+		emit(cg, "movaps %o, %o", src, dest);
+		return;
+	}
+	if (is_float_register(cg, dest) || is_float_register(cg, src)) {
+		emit(cg, "movss %o, %o", src, dest);
+		return;
+	}
+	if (in_register(cg, dest) || in_register(cg, src) || is_immediate(cg, src)) {
+		emit(cg, "movl %o, %o", src, dest);
+		return;
+	}
+	load(cg, "%eax", src);
+	store(cg, dest, "%eax");
+}
+
+// Returns the register holding the result of an instruction writing `dest`:
+// its own register or `scratch`, which has to be stored afterwards.
+static const char *result_register(const struct codegen *cg, mcc_ir_operand dest, const char *scratch)
+{
+	return in_register(cg, dest) ? register_of(cg, dest) : scratch;
+}
+
+// ------------------------------------------------------------ Instructions
+
+static void emit_int_binary(struct codegen *cg, const struct mcc_ir_instruction *instruction, const char *mnemonic)
+{
+	bool commutative = instruction->opcode != MCC_IR_SUB;
+
+	// computed in place unless that overwrites b before it is read
+	if (in_register(cg, instruction->dest)) {
+		const char *dest = register_of(cg, instruction->dest);
+		if (!same_location(cg, instruction->dest, instruction->b)) {
+			load(cg, dest, instruction->a);
+			emit(cg, "%s %o, %s", mnemonic, instruction->b, dest);
+			return;
+		}
+		if (commutative) {
+			emit(cg, "%s %o, %s", mnemonic, instruction->a, dest);
+			return;
+		}
+	}
+
+	load(cg, "%eax", instruction->a);
+	emit(cg, "%s %o, %%eax", mnemonic, instruction->b);
+	store(cg, instruction->dest, "%eax");
+}
+
+static void emit_int_division(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	load(cg, "%eax", instruction->a);
+	emit(cg, "cltd");
+	if (is_immediate(cg, instruction->b)) {
+		emit(cg, "movl %o, %%ecx", instruction->b);
+		emit(cg, "idivl %%ecx");
+	} else {
+		emit(cg, "idivl %o", instruction->b);
+	}
+	store(cg, instruction->dest, "%eax");
+}
+
+static void emit_int_unary(struct codegen *cg, const struct mcc_ir_instruction *instruction, const char *operation)
+{
+	const char *dest = result_register(cg, instruction->dest, "%eax");
+	load(cg, dest, instruction->a);
+	emit(cg, "%s %s", operation, dest);
+	store(cg, instruction->dest, dest);
+}
+
+static const char *condition_code(enum mcc_ir_opcode opcode)
+{
+	switch (opcode) {
+	case MCC_IR_EQ:
+		return "e";
+	case MCC_IR_NE:
+		return "ne";
+	case MCC_IR_LT:
+		return "l";
+	case MCC_IR_GT:
+		return "g";
+	case MCC_IR_LE:
+		return "le";
+	default:
+		return "ge";
+	}
+}
+
+static void emit_int_comparison(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	load(cg, "%eax", instruction->a);
+	emit(cg, "cmpl %o, %%eax", instruction->b);
+	emit(cg, "set%s %%al", condition_code(instruction->opcode));
+	emit(cg, "movzbl %%al, %%eax");
+	store(cg, instruction->dest, "%eax");
+}
+
+static void emit_float_binary(struct codegen *cg, const struct mcc_ir_instruction *instruction, const char *mnemonic)
+{
+	emit(cg, "flds %o", instruction->a);
+	emit(cg, "%s %o", mnemonic, instruction->b);
+	emit(cg, "fstps %o", instruction->dest);
+}
+
+// Stores the result of a float comparison from the flags set like an unsigned
+// comparison, with parity set if unordered; lt and le are expected swapped.
+// Unordered operands, NaNs, compare false except for `ne`.
+static void store_float_condition(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	switch (instruction->opcode) {
+	case MCC_IR_EQ:
+		emit(cg, "sete %%al");
+		emit(cg, "setnp %%cl");
+		emit(cg, "andb %%cl, %%al");
+		break;
+	case MCC_IR_NE:
+		emit(cg, "setne %%al");
+		emit(cg, "setp %%cl");
+		emit(cg, "orb %%cl, %%al");
+		break;
+	case MCC_IR_LT:
+	case MCC_IR_GT:
+		emit(cg, "seta %%al");
+		break;
+	default:
+		emit(cg, "setae %%al");
+	}
+	emit(cg, "movzbl %%al, %%eax");
+	store(cg, instruction->dest, "%eax");
+}
+
+static void emit_float_comparison(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	// fucomip compares st(0) with st(1) like unsigned integers; lt and le
+	// swap the operands to test above, which is false if unordered
+	enum mcc_ir_opcode opcode = instruction->opcode;
+	bool swap = opcode == MCC_IR_LT || opcode == MCC_IR_LE;
+	emit(cg, "flds %o", swap ? instruction->a : instruction->b);
+	emit(cg, "flds %o", swap ? instruction->b : instruction->a);
+	emit(cg, "fucomip %%st(1), %%st");
+	emit(cg, "fstp %%st(0)");
+
+	store_float_condition(cg, instruction);
+}
+
+// Loads the float `src` into the SSE register `reg` unless it is there already.
+static void load_float(struct codegen *cg, const char *reg, mcc_ir_operand src)
+{
+	if (!in_register(cg, src)) {
+		emit(cg, "movss %o, %s", src, reg);
+	} else if (strcmp(register_of(cg, src), reg) != 0) {
+		emit(cg, "movaps %o, %s", src, reg);
+	}
+}
+
+static void store_float(struct codegen *cg, mcc_ir_operand dest, const char *reg)
+{
+	if (!in_register(cg, dest)) {
+		emit(cg, "movss %s, %o", reg, dest);
+	} else if (strcmp(register_of(cg, dest), reg) != 0) {
+		emit(cg, "movaps %s, %o", reg, dest);
+	}
+}
+
+static void emit_sse_binary(struct codegen *cg, const struct mcc_ir_instruction *instruction, const char *mnemonic)
+{
+	bool commutative = instruction->opcode == MCC_IR_ADD || instruction->opcode == MCC_IR_MUL;
+
+	if (in_register(cg, instruction->dest)) {
+		const char *dest = register_of(cg, instruction->dest);
+		if (!same_location(cg, instruction->dest, instruction->b)) {
+			load_float(cg, dest, instruction->a);
+			emit(cg, "%s %o, %s", mnemonic, instruction->b, dest);
+			return;
+		}
+		if (commutative) {
+			emit(cg, "%s %o, %s", mnemonic, instruction->a, dest);
+			return;
+		}
+	}
+
+	load_float(cg, "%xmm0", instruction->a);
+	emit(cg, "%s %o, %%xmm0", mnemonic, instruction->b);
+	store_float(cg, instruction->dest, "%xmm0");
+}
+
+static void emit_sse_negation(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	const char *dest = result_register(cg, instruction->dest, "%xmm0");
+	load_float(cg, dest, instruction->a);
+	emit(cg, "xorps .Lsign_mask, %s", dest);
+	store_float(cg, instruction->dest, dest);
+	cg->uses_sign_mask = true;
+}
+
+static void emit_sse_comparison(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	// ucomiss sets the flags like an unsigned comparison of its second
+	// operand with the first; lt and le swap them to test above
+	enum mcc_ir_opcode opcode = instruction->opcode;
+	bool swap = opcode == MCC_IR_LT || opcode == MCC_IR_LE;
+	mcc_ir_operand left = swap ? instruction->b : instruction->a;
+	mcc_ir_operand right = swap ? instruction->a : instruction->b;
+
+	const char *reg = "%xmm0";
+	if (in_register(cg, left)) {
+		reg = register_of(cg, left);
+	} else {
+		load_float(cg, reg, left);
+	}
+	emit(cg, "ucomiss %o, %s", right, reg);
+
+	store_float_condition(cg, instruction);
+}
+
+static void emit_array(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	const char *dest = result_register(cg, instruction->dest, "%eax");
+	emit(cg, "leal %d(%%ebp), %s", (int)cg->array_offsets[MCC_IR_OPERAND_INDEX(instruction->a)], dest);
+	store(cg, instruction->dest, dest);
+}
+
+// Prints the address of element `index` of the array at `address` to a
+// buffer of 32 characters; `scratch` may be used for the address, `ecx` is
+// used for the index.
+static void element_address(struct codegen *cg,
+                            char *buffer,
+                            mcc_ir_operand address,
+                            mcc_ir_operand index,
+                            const char *scratch)
+{
+	const char *base = scratch;
+	if (in_register(cg, address)) {
+		base = register_of(cg, address);
+	} else {
+		load(cg, scratch, address);
+	}
+
+	if (is_immediate(cg, index)) {
+		snprintf(buffer, 32, "%ld(%s)", (long)(int32_t)constant_of(cg, index)->i_value * SLOT_SIZE, base);
+		return;
+	}
+
+	const char *offset = "%ecx";
+	if (in_register(cg, index)) {
+		offset = register_of(cg, index);
+	} else {
+		load(cg, offset, index);
+	}
+	snprintf(buffer, 32, "(%s,%s,%d)", base, offset, SLOT_SIZE);
+}
+
+static void emit_load(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	char element[32];
+	element_address(cg, element, instruction->a, instruction->b, "%eax");
+
+	if (is_float_register(cg, instruction->dest)) {
+		emit(cg, "movss %s, %o", element, instruction->dest);
+		return;
+	}
+	const char *dest = result_register(cg, instruction->dest, "%edx");
+	emit(cg, "movl %s, %s", element, dest);
+	store(cg, instruction->dest, dest);
+}
+
+static void emit_store(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	char element[32];
+	element_address(cg, element, instruction->dest, instruction->a, "%eax");
+
+	if (is_float_register(cg, instruction->b)) {
+		emit(cg, "movss %o, %s", instruction->b, element);
+	} else if (in_register(cg, instruction->b) || is_immediate(cg, instruction->b)) {
+		emit(cg, "movl %o, %s", instruction->b, element);
+	} else {
+		load(cg, "%edx", instruction->b);
+		emit(cg, "movl %%edx, %s", element);
+	}
+}
+
+// Vector registers are copied whole; movups accepts unaligned frame slots.
+static void load_vector(struct codegen *cg, const char *reg, mcc_ir_operand src)
+{
+	if (!in_register(cg, src)) {
+		emit(cg, "movups %o, %s", src, reg);
+	} else if (strcmp(register_of(cg, src), reg) != 0) {
+		emit(cg, "movaps %o, %s", src, reg);
+	}
+}
+
+static void store_vector(struct codegen *cg, mcc_ir_operand dest, const char *reg)
+{
+	if (!in_register(cg, dest)) {
+		emit(cg, "movups %s, %o", reg, dest);
+	} else if (strcmp(register_of(cg, dest), reg) != 0) {
+		emit(cg, "movaps %s, %o", reg, dest);
+	}
+}
+
+static void emit_vector_copy(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	const char *dest = result_register(cg, instruction->dest, "%xmm0");
+	load_vector(cg, dest, instruction->a);
+	store_vector(cg, instruction->dest, dest);
+}
+
+static void emit_splat(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	const char *dest = result_register(cg, instruction->dest, "%xmm0");
+	mcc_ir_operand scalar = instruction->a;
+
+	if (instruction->type == MCC_IR_TYPE_FLOAT4) {
+		if (is_float_register(cg, scalar)) {
+			emit(cg, "movaps %o, %s", scalar, dest);
+		} else {
+			emit(cg, "movss %o, %s", scalar, dest);
+		}
+		emit(cg, "shufps $0, %s, %s", dest, dest);
+	} else {
+		// movd takes no immediates
+		if (is_immediate(cg, scalar)) {
+			load(cg, "%eax", scalar);
+			emit(cg, "movd %%eax, %s", dest);
+		} else {
+			emit(cg, "movd %o, %s", scalar, dest);
+		}
+		emit(cg, "pshufd $0, %s, %s", dest, dest);
+	}
+	store_vector(cg, instruction->dest, dest);
+}
+
+static void emit_vector_binary(struct codegen *cg, const struct mcc_ir_instruction *instruction, const char *mnemonic)
+{
+	// packed instructions only take aligned memory operands
+	const char *b = "%xmm1";
+	if (in_register(cg, instruction->b)) {
+		b = register_of(cg, instruction->b);
+	} else {
+		load_vector(cg, b, instruction->b);
+	}
+
+	const char *dest = "%xmm0";
+	if (in_register(cg, instruction->dest) && !same_location(cg, instruction->dest, instruction->b)) {
+		dest = register_of(cg, instruction->dest);
+	}
+	load_vector(cg, dest, instruction->a);
+	emit(cg, "%s %s, %s", mnemonic, b, dest);
+	store_vector(cg, instruction->dest, dest);
+}
+
+static void emit_vector_load(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	char element[32];
+	element_address(cg, element, instruction->a, instruction->b, "%eax");
+
+	const char *dest = result_register(cg, instruction->dest, "%xmm0");
+	emit(cg, "movups %s, %s", element, dest);
+	store_vector(cg, instruction->dest, dest);
+}
+
+static void emit_vector_store(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	char element[32];
+	element_address(cg, element, instruction->dest, instruction->a, "%eax");
+
+	const char *value = "%xmm0";
+	if (in_register(cg, instruction->b)) {
+		value = register_of(cg, instruction->b);
+	} else {
+		load_vector(cg, value, instruction->b);
+	}
+	emit(cg, "movups %s, %s", value, element);
+}
+
+static void emit_conditional_jump(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	bool on_true = instruction->opcode == MCC_IR_JUMP_IF_TRUE;
+
+	const struct mcc_ir_constant *constant = constant_of(cg, instruction->a);
+	if (constant) {
+		if (constant->b_value == on_true) {
+			emit(cg, "jmp %l", instruction->b);
+		}
+		return;
+	}
+
+	if (in_register(cg, instruction->a)) {
+		emit(cg, "testl %o, %o", instruction->a, instruction->a);
+	} else {
+		emit(cg, "cmpl $0, %o", instruction->a);
+	}
+	emit(cg, "%s %l", on_true ? "jne" : "je", instruction->b);
+}
+
+// The arguments of a call are stored in a block reserved by the first one.
+static void emit_argument(struct codegen *cg, uint32_t index)
+{
+	const struct mcc_ir_instruction *instruction = &cg->function->instructions[index];
+
+	if (cg->argument_count == 0) {
+		uint32_t count = 0;
+		while (cg->function->instructions[index + count].opcode == MCC_IR_ARG) {
+			++count;
+		}
+		assert(cg->function->instructions[index + count].opcode == MCC_IR_CALL);
+
+		cg->argument_bytes = (count * SLOT_SIZE + STACK_ALIGNMENT - 1) / STACK_ALIGNMENT * STACK_ALIGNMENT;
+		emit(cg, "subl $%u, %%esp", cg->argument_bytes);
+	}
+
+	unsigned offset = cg->argument_count++ * SLOT_SIZE;
+	if (is_float_register(cg, instruction->a)) {
+		emit(cg, "movss %o, %u(%%esp)", instruction->a, offset);
+	} else if (in_register(cg, instruction->a) || is_immediate(cg, instruction->a)) {
+		emit(cg, "movl %o, %u(%%esp)", instruction->a, offset);
+	} else {
+		load(cg, "%eax", instruction->a);
+		emit(cg, "movl %%eax, %u(%%esp)", offset);
+	}
+}
+
+static void emit_call(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	emit(cg, "call %s", cg->module->functions[MCC_IR_OPERAND_INDEX(instruction->a)].name);
+	if (cg->argument_bytes) {
+		emit(cg, "addl $%u, %%esp", cg->argument_bytes);
+	}
+	cg->argument_bytes = 0;
+	cg->argument_count = 0;
+
+	// float results are returned on the x87 stack
+	if (instruction->type == MCC_IR_TYPE_FLOAT) {
+		if (is_float_register(cg, instruction->dest)) {
+			emit(cg, "fstps %d(%%ebp)", (int)cg->transfer_offset);
+			emit(cg, "movss %d(%%ebp), %o", (int)cg->transfer_offset, instruction->dest);
+		} else if (instruction->dest != MCC_IR_NONE) {
+			emit(cg, "fstps %o", instruction->dest);
+		} else {
+			emit(cg, "fstp %%st(0)");
+		}
+	} else if (instruction->dest != MCC_IR_NONE) {
+		store(cg, instruction->dest, "%eax");
+	}
+}
+
+static void emit_epilogue(struct codegen *cg)
+{
+	if (cg->saved_count) {
+		emit(cg, "leal %d(%%ebp), %%esp", -(int)(cg->saved_count * SLOT_SIZE));
+		for (uint32_t r = sizeof(general_registers) / sizeof(*general_registers); r-- > 0;) {
+			if (cg->allocation.used_registers[CLASS_GENERAL] & (UINT32_C(1) << r)) {
+				emit(cg, "popl %s", general_registers[r]);
+			}
+		}
+	} else {
+		emit(cg, "movl %%ebp, %%esp");
+	}
+	emit(cg, "popl %%ebp");
+	emit(cg, "ret");
+}
+
+static void emit_return(struct codegen *cg, const struct mcc_ir_instruction *instruction)
+{
+	if (instruction->a != MCC_IR_NONE) {
+		if (is_float_register(cg, instruction->a)) {
+			emit(cg, "movss %o, %d(%%ebp)", instruction->a, (int)cg->transfer_offset);
+			emit(cg, "flds %d(%%ebp)", (int)cg->transfer_offset);
+		} else if (cg->function->return_type == MCC_IR_TYPE_FLOAT) {
+			emit(cg, "flds %o", instruction->a);
+		} else {
+			load(cg, "%eax", instruction->a);
+		}
+	}
+	emit_epilogue(cg);
+}
+
+static void emit_instruction(struct codegen *cg, uint32_t index)
+{
+	const struct mcc_ir_instruction *instruction = &cg->function->instructions[index];
+	bool is_float = instruction->type == MCC_IR_TYPE_FLOAT;
+	bool is_vector = instruction->type == MCC_IR_TYPE_INT4 || instruction->type == MCC_IR_TYPE_FLOAT4;
+	bool is_int_vector = instruction->type == MCC_IR_TYPE_INT4;
+	void (*float_binary)(struct codegen *, const struct mcc_ir_instruction *, const char *) =
+	    cg->sse ? emit_sse_binary : emit_float_binary;
+
+	switch ((enum mcc_ir_opcode)instruction->opcode) {
+	case MCC_IR_NOP:
+	case MCC_IR_PHI:
+		// phis are gone after destruction of the SSA form
+		assert(instruction->opcode == MCC_IR_NOP);
+		break;
+	case MCC_IR_COPY:
+		if (is_vector) {
+			emit_vector_copy(cg, instruction);
+		} else {
+			copy(cg, instruction->dest, instruction->a);
+		}
+		break;
+	case MCC_IR_ADD:
+		if (is_vector) {
+			emit_vector_binary(cg, instruction, is_int_vector ? "paddd" : "addps");
+		} else if (is_float) {
+			float_binary(cg, instruction, cg->sse ? "addss" : "fadds");
+		} else {
+			emit_int_binary(cg, instruction, "addl");
+		}
+		break;
+	case MCC_IR_SUB:
+		if (is_vector) {
+			emit_vector_binary(cg, instruction, is_int_vector ? "psubd" : "subps");
+		} else if (is_float) {
+			float_binary(cg, instruction, cg->sse ? "subss" : "fsubs");
+		} else {
+			emit_int_binary(cg, instruction, "subl");
+		}
+		break;
+	case MCC_IR_MUL:
+		if (is_vector) {
+			// SSE2 has no packed 32-bit multiply, int vectors are not multiplied
+			emit_vector_binary(cg, instruction, "mulps");
+		} else if (is_float) {
+			float_binary(cg, instruction, cg->sse ? "mulss" : "fmuls");
+		} else {
+			emit_int_binary(cg, instruction, "imull");
+		}
+		break;
+	case MCC_IR_DIV:
+		if (is_vector) {
+			emit_vector_binary(cg, instruction, "divps");
+		} else if (is_float) {
+			float_binary(cg, instruction, cg->sse ? "divss" : "fdivs");
+		} else {
+			emit_int_division(cg, instruction);
+		}
+		break;
+	case MCC_IR_NEG:
+		if (is_float && cg->sse) {
+			emit_sse_negation(cg, instruction);
+		} else if (is_float) {
+			emit(cg, "flds %o", instruction->a);
+			emit(cg, "fchs");
+			emit(cg, "fstps %o", instruction->dest);
+		} else {
+			emit_int_unary(cg, instruction, "negl");
+		}
+		break;
+	case MCC_IR_EQ:
+	case MCC_IR_NE:
+	case MCC_IR_LT:
+	case MCC_IR_GT:
+	case MCC_IR_LE:
+	case MCC_IR_GE:
+		if (is_float) {
+			cg->sse ? emit_sse_comparison(cg, instruction) : emit_float_comparison(cg, instruction);
+		} else {
+			emit_int_comparison(cg, instruction);
+		}
+		break;
+	case MCC_IR_AND:
+		emit_int_binary(cg, instruction, "andl");
+		break;
+	case MCC_IR_OR:
+		emit_int_binary(cg, instruction, "orl");
+		break;
+	case MCC_IR_NOT:
+		emit_int_unary(cg, instruction, "xorl $1,");
+		break;
+	case MCC_IR_ARRAY:
+		emit_array(cg, instruction);
+		break;
+	case MCC_IR_LOAD:
+		emit_load(cg, instruction);
+		break;
+	case MCC_IR_STORE:
+		emit_store(cg, instruction);
+		break;
+	case MCC_IR_SPLAT:
+		emit_splat(cg, instruction);
+		break;
+	case MCC_IR_VLOAD:
+		emit_vector_load(cg, instruction);
+		break;
+	case MCC_IR_VSTORE:
+		emit_vector_store(cg, instruction);
+		break;
+	case MCC_IR_LABEL:
+		append(cg, ".L%u_%u:", cg->function_index, MCC_IR_OPERAND_INDEX(instruction->a));
+		end_line(cg);
+		break;
+	case MCC_IR_JUMP:
+		emit(cg, "jmp %l", instruction->a);
+		break;
+	case MCC_IR_JUMP_IF_FALSE:
+	case MCC_IR_JUMP_IF_TRUE:
+		emit_conditional_jump(cg, instruction);
+		break;
+	case MCC_IR_ARG:
+		emit_argument(cg, index);
+		break;
+	case MCC_IR_CALL:
+		emit_call(cg, instruction);
+		break;
+	case MCC_IR_RETURN:
+		emit_return(cg, instruction);
+		break;
+	}
+}
+
+// ----------------------------------------------------------------- Functions
+
+// Lays out the stack frame below the saved registers: a slot for each
+// register without a register, then the arrays. Parameters stay in the
+// caller's frame. Returns the bytes to reserve, keeping calls aligned.
+static uint32_t layout_frame(struct codegen *cg)
+{
+	const struct mcc_ir_function *function = cg->function;
+
+	cg->saved_count = 0;
+	for (uint32_t r = 0; r < sizeof(general_registers) / sizeof(*general_registers); ++r) {
+		cg->saved_count += (cg->allocation.used_registers[CLASS_GENERAL] >> r) & 1;
+	}
+
+	// above ebp are the saved ebp and the return address
+	int32_t offset = -(int32_t)(cg->saved_count * SLOT_SIZE);
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		if (v < function->parameter_count) {
+			cg->offsets[v] = (int32_t)(2 + v) * SLOT_SIZE;
+		} else if (cg->allocation.locations[v] == MCC_REGALLOC_STACK) {
+			bool vector = function->vreg_types[v] == MCC_IR_TYPE_INT4 ||
+			              function->vreg_types[v] == MCC_IR_TYPE_FLOAT4;
+			offset -= vector ? VECTOR_SLOT_SIZE : SLOT_SIZE;
+			cg->offsets[v] = offset;
+		}
+	}
+	if (cg->sse) {
+		offset -= SLOT_SIZE;
+		cg->transfer_offset = offset;
+	}
+	for (uint32_t a = 0; a < function->array_count; ++a) {
+		offset -= (int32_t)(function->arrays[a].size * SLOT_SIZE);
+		cg->array_offsets[a] = offset;
+	}
+
+	// the return address and ebp are on the stack as well
+	uint32_t pushed = (2 + cg->saved_count) * SLOT_SIZE;
+	uint32_t size = (uint32_t)-offset - cg->saved_count * SLOT_SIZE;
+	while ((pushed + size) % STACK_ALIGNMENT != 0) {
+		size += SLOT_SIZE;
+	}
+	return size;
+}
+
+static void emit_prologue(struct codegen *cg, uint32_t frame_size)
+{
+	const struct mcc_ir_function *function = cg->function;
+
+	if (!cg->object) {
+		fprintf(cg->out, "\t.globl %s\n", function->name);
+		fprintf(cg->out, "\t.type %s, @function\n", function->name);
+		fprintf(cg->out, "%s:\n", function->name);
+	}
+
+	emit(cg, "pushl %%ebp");
+	emit(cg, "movl %%esp, %%ebp");
+	for (uint32_t r = 0; r < sizeof(general_registers) / sizeof(*general_registers); ++r) {
+		if (cg->allocation.used_registers[CLASS_GENERAL] & (UINT32_C(1) << r)) {
+			emit(cg, "pushl %s", general_registers[r]);
+		}
+	}
+	if (frame_size) {
+		emit(cg, "subl $%u, %%esp", frame_size);
+	}
+
+	for (uint32_t p = 0; p < function->parameter_count; ++p) {
+		if (in_register(cg, MCC_IR_VREG(p))) {
+			const char *move = is_float_register(cg, MCC_IR_VREG(p)) ? "movss" : "movl";
+			emit(cg, "%s %d(%%ebp), %s", move, (int)cg->offsets[p], register_of(cg, MCC_IR_VREG(p)));
+		}
+	}
+}
+
+static bool print_function(struct codegen *cg)
+{
+	const struct mcc_asm_options *options = cg->options;
+	const struct mcc_ir_function *function = cg->function;
+
+	struct mcc_cfg cfg;
+	bool ok = mcc_cfg_build(&cfg, function) && mcc_regalloc_compute(&cg->allocation, &cfg, cg->target);
+	mcc_cfg_release(&cfg);
+
+	cg->offsets = malloc((function->vreg_count + 1) * sizeof(*cg->offsets));
+	cg->array_offsets = malloc((function->array_count + 1) * sizeof(*cg->array_offsets));
+	if (ok && cg->offsets && cg->array_offsets) {
+		if (options && options->spill_report) {
+			fprintf(options->spill_report, "%s: %u of %u intervals spilled\n", function->name,
+			        cg->allocation.spill_count, cg->allocation.interval_count);
+		}
+
+		mcc_peephole_code_clear(&cg->code);
+		emit_prologue(cg, layout_frame(cg));
+		for (uint32_t i = 0; i < function->instruction_count; ++i) {
+			emit_instruction(cg, i);
+		}
+
+		if (!cg->failed && !(options && options->no_peephole)) {
+			cg->failed = !mcc_peephole_optimize(&cg->code, options ? options->peephole_stats : NULL);
+		}
+		if (cg->failed) {
+			ok = false;
+		} else if (cg->object) {
+			ok = mcc_object_add_function(cg->object, function->name, &cg->code);
+		} else {
+			mcc_peephole_print(cg->out, &cg->code);
+			fprintf(cg->out, "\t.size %s, .-%s\n\n", function->name, function->name);
+			ok = true;
+		}
+	} else {
+		ok = false;
+	}
+
+	mcc_regalloc_release(&cg->allocation);
+	free(cg->offsets);
+	free(cg->array_offsets);
+	return ok;
+}
+
+// ------------------------------------------------------------------ Constants
+
+// String literals keep their escape sequences, which are those of C and the
+// assembler; only raw control characters need escaping.
+static void print_string(FILE *out, const char *string)
+{
+	fputc('"', out);
+	for (const unsigned char *c = (const unsigned char *)string; *c; ++c) {
+		if (*c < 0x20 || *c == 0x7f) {
+			fprintf(out, "\\%03o", *c);
+		} else {
+			fputc(*c, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void print_constants(const struct codegen *cg)
+{
+	FILE *out = cg->out;
+	uint32_t words = MCC_BITSET_WORDS(cg->module->constant_count);
+	if (mcc_bitset_next(cg->used_constants, words, 0) == MCC_BITSET_END && !cg->uses_sign_mask) {
+		return;
+	}
+
+	fputs("\t.section .rodata\n", out);
+	if (cg->uses_sign_mask) {
+		// xorps reads all 16 bytes, aligned
+		fputs("\t.align 16\n.Lsign_mask:\n\t.long 0x80000000, 0, 0, 0\n", out);
+	}
+	for (uint32_t c = mcc_bitset_next(cg->used_constants, words, 0); c != MCC_BITSET_END;
+	     c = mcc_bitset_next(cg->used_constants, words, c + 1)) {
+		const struct mcc_ir_constant *constant = &cg->module->constants[c];
+		if (constant->type == MCC_IR_TYPE_FLOAT) {
+			float value = (float)constant->f_value;
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			fprintf(out, "\t.align 4\n.LC%u:\n\t.long %u\n", c, bits);
+		} else {
+			fprintf(out, ".LC%u:\n\t.string ", c);
+			print_string(out, constant->s_value);
+			fputc('\n', out);
+		}
+	}
+}
+
+static bool add_constants(const struct codegen *cg)
+{
+	bool ok = true;
+	if (cg->uses_sign_mask) {
+		static const uint32_t sign_mask[] = {0x80000000, 0, 0, 0};
+		uint8_t data[sizeof(sign_mask)];
+		for (uint32_t i = 0; i < sizeof(data); ++i) {
+			data[i] = (uint8_t)(sign_mask[i / 4] >> (8 * (i % 4)));
+		}
+		ok = mcc_object_add_data(cg->object, ".Lsign_mask", data, sizeof(data), 16);
+	}
+
+	uint32_t words = MCC_BITSET_WORDS(cg->module->constant_count);
+	for (uint32_t c = mcc_bitset_next(cg->used_constants, words, 0); ok && c != MCC_BITSET_END;
+	     c = mcc_bitset_next(cg->used_constants, words, c + 1)) {
+		const struct mcc_ir_constant *constant = &cg->module->constants[c];
+		char label[32];
+		snprintf(label, sizeof(label), ".LC%u", c);
+		if (constant->type == MCC_IR_TYPE_FLOAT) {
+			float value = (float)constant->f_value;
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			uint8_t data[4];
+			for (uint32_t i = 0; i < sizeof(data); ++i) {
+				data[i] = (uint8_t)(bits >> (8 * i));
+			}
+			ok = mcc_object_add_data(cg->object, label, data, sizeof(data), 4);
+		} else {
+			char *string = malloc(strlen(constant->s_value) + 1);
+			if (string) {
+				mcc_ir_decode_string(string, constant->s_value);
+				ok = mcc_object_add_data(cg->object, label, string, (uint32_t)strlen(string) + 1, 1);
+			}
+			ok = ok && string;
+			free(string);
+		}
+	}
+	return ok;
+}
+
+// Generates the code of the functions of `module` selected by `options`.
+static bool generate(struct codegen *cg)
+{
+	const struct mcc_ir_module *module = cg->module;
+	const struct mcc_asm_options *options = cg->options;
+
+	bool ok = true;
+	for (uint32_t i = 0; ok && i < module->function_count; ++i) {
+		const struct mcc_ir_function *function = &module->functions[i];
+		if (function->builtin) {
+			continue;
+		}
+		if (options && options->function && strcmp(options->function, function->name) != 0) {
+			continue;
+		}
+
+		cg->function = function;
+		cg->function_index = i;
+		ok = print_function(cg);
+	}
+	return ok;
+}
+
+static bool init_codegen(struct codegen *cg,
+                         const struct mcc_ir_module *module,
+                         const struct mcc_asm_options *options)
+{
+	bool sse = !options || options->float_mode == MCC_ASM_FLOAT_SSE;
+	*cg = (struct codegen){
+	    .options = options,
+	    .module = module,
+	    .sse = sse,
+	    .target = sse ? &sse_target : &x87_target,
+	    .used_constants = calloc(MCC_BITSET_WORDS(module->constant_count) + 1, sizeof(*cg->used_constants)),
+	};
+	return cg->used_constants;
+}
+
+static void release_codegen(struct codegen *cg)
+{
+	mcc_peephole_code_release(&cg->code);
+	free(cg->line);
+	free(cg->used_constants);
+}
+
+bool mcc_asm_print(FILE *out, const struct mcc_ir_module *module, const struct mcc_asm_options *options)
+{
+	assert(out);
+	assert(module);
+
+	struct codegen cg;
+	if (!init_codegen(&cg, module, options)) {
+		return false;
+	}
+	cg.out = out;
+
+	fputs("\t.text\n", out);
+	bool ok = generate(&cg);
+	print_constants(&cg);
+	fputs("\t.section .note.GNU-stack,\"\",@progbits\n", out);
+
+	release_codegen(&cg);
+	return ok;
+}
+
+bool mcc_asm_write_object(FILE *out, const struct mcc_ir_module *module, const struct mcc_asm_options *options)
+{
+	assert(out);
+	assert(module);
+
+	struct codegen cg;
+	struct mcc_object object;
+	if (!init_codegen(&cg, module, options)) {
+		return false;
+	}
+	mcc_object_init(&object);
+	cg.object = &object;
+
+	bool ok = generate(&cg) && add_constants(&cg) && mcc_object_write(out, &object);
+
+	mcc_object_release(&object);
+	release_codegen(&cg);
+	return ok;
+}
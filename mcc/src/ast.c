@@ -3,16 +3,18 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
+
+#include "mcc/intern.h"
 
 
 // ---------------------------------------------------------------- Expressions
 
-struct mcc_ast_expression *mcc_ast_new_expression_literal(struct mcc_ast_literal *literal)
+struct mcc_ast_expression *mcc_ast_new_expression_literal(struct mcc_arena *arena, struct mcc_ast_literal *literal)
 {
+	assert(arena);
 	assert(literal);
 
-	struct mcc_ast_expression *expr = malloc(sizeof(*expr));
+	struct mcc_ast_expression *expr = mcc_arena_alloc(arena, sizeof(*expr));
 	if (!expr) {
 		return NULL;
 	}
@@ -22,14 +24,16 @@ struct mcc_ast_expression *mcc_ast_new_expression_literal(struct mcc_ast_literal
 	return expr;
 }
 
-struct mcc_ast_expression *mcc_ast_new_expression_binary_op(enum mcc_ast_binary_op op,
+struct mcc_ast_expression *mcc_ast_new_expression_binary_op(struct mcc_arena *arena,
+                                                            enum mcc_ast_binary_op op,
                                                             struct mcc_ast_expression *lhs,
                                                             struct mcc_ast_expression *rhs)
 {
+	assert(arena);
 	assert(lhs);
 	assert(rhs);
 
-	struct mcc_ast_expression *expr = malloc(sizeof(*expr));
+	struct mcc_ast_expression *expr = mcc_arena_alloc(arena, sizeof(*expr));
 	if (!expr) {
 		return NULL;
 	}
@@ -41,13 +45,14 @@ struct mcc_ast_expression *mcc_ast_new_expression_binary_op(enum mcc_ast_binary_
 	return expr;
 }
 
-struct mcc_ast_expression *mcc_ast_new_expression_unary_op(enum mcc_ast_unary_op op,
+struct mcc_ast_expression *mcc_ast_new_expression_unary_op(struct mcc_arena *arena,
+                                                           enum mcc_ast_unary_op op,
 														   struct mcc_ast_expression *rhs)
 {
-
+	assert(arena);
 	assert(rhs);
 
-	struct mcc_ast_expression *expr = malloc(sizeof(*expr));
+	struct mcc_ast_expression *expr = mcc_arena_alloc(arena, sizeof(*expr));
 	if(!expr) {
 		return NULL;
 	}
@@ -60,11 +65,13 @@ struct mcc_ast_expression *mcc_ast_new_expression_unary_op(enum mcc_ast_unary_op
 
 }
 
-struct mcc_ast_expression *mcc_ast_new_expression_parenth(struct mcc_ast_expression *expression)
+struct mcc_ast_expression *mcc_ast_new_expression_parenth(struct mcc_arena *arena,
+                                                          struct mcc_ast_expression *expression)
 {
+	assert(arena);
 	assert(expression);
 
-	struct mcc_ast_expression *expr = malloc(sizeof(*expr));
+	struct mcc_ast_expression *expr = mcc_arena_alloc(arena, sizeof(*expr));
 	if (!expr) {
 		return NULL;
 	}
@@ -74,33 +81,83 @@ struct mcc_ast_expression *mcc_ast_new_expression_parenth(struct mcc_ast_express
 	return expr;
 }
 
-void mcc_ast_delete_expression(struct mcc_ast_expression *expression)
+struct mcc_ast_expression *mcc_ast_new_expression_identifier(struct mcc_arena *arena,
+                                                             struct mcc_ast_identifier *identifier)
 {
-	assert(expression);
+	assert(arena);
+	assert(identifier);
+
+	struct mcc_ast_expression *expr = mcc_arena_alloc(arena, sizeof(*expr));
+	if (!expr) {
+		return NULL;
+	}
 
-	switch (expression->type) {
-	case MCC_AST_EXPRESSION_TYPE_LITERAL:
-		mcc_ast_delete_literal(expression->literal);
-		break;
+	expr->type = MCC_AST_EXPRESSION_TYPE_IDENTIFIER;
+	expr->identifier = identifier;
+	return expr;
+}
+
+struct mcc_ast_expression *mcc_ast_new_expression_array_element(struct mcc_arena *arena,
+                                                                struct mcc_ast_identifier *array,
+                                                                struct mcc_ast_expression *index)
+{
+	assert(arena);
+	assert(array);
+	assert(index);
+
+	struct mcc_ast_expression *expr = mcc_arena_alloc(arena, sizeof(*expr));
+	if (!expr) {
+		return NULL;
+	}
 
-	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
-		mcc_ast_delete_expression(expression->lhs);
-		mcc_ast_delete_expression(expression->rhs);
-		break;
+	expr->type = MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT;
+	expr->array = array;
+	expr->index = index;
+	return expr;
+}
+
+struct mcc_ast_expression *mcc_ast_new_expression_call(struct mcc_arena *arena,
+                                                       struct mcc_ast_identifier *function,
+                                                       struct mcc_ast_argument *arguments)
+{
+	assert(arena);
+	assert(function);
+
+	struct mcc_ast_expression *expr = mcc_arena_alloc(arena, sizeof(*expr));
+	if (!expr) {
+		return NULL;
+	}
+
+	expr->type = MCC_AST_EXPRESSION_TYPE_CALL;
+	expr->function = function;
+	expr->arguments = arguments;
+	return expr;
+}
+
+// ------------------------------------------------------------------- Arguments
+
+struct mcc_ast_argument *mcc_ast_new_argument(struct mcc_arena *arena, struct mcc_ast_expression *expression)
+{
+	assert(arena);
+	assert(expression);
 
-	case MCC_AST_EXPRESSION_TYPE_PARENTH:
-		mcc_ast_delete_expression(expression->expression);
-		break;
+	struct mcc_ast_argument *arg = mcc_arena_alloc(arena, sizeof(*arg));
+	if (!arg) {
+		return NULL;
 	}
 
-	free(expression);
+	arg->expression = expression;
+	arg->next = NULL;
+	return arg;
 }
 
 // ------------------------------------------------------------------- Literals
 
-struct mcc_ast_literal *mcc_ast_new_literal_int(long value)
+struct mcc_ast_literal *mcc_ast_new_literal_int(struct mcc_arena *arena, long value)
 {
-	struct mcc_ast_literal *lit = malloc(sizeof(*lit));
+	assert(arena);
+
+	struct mcc_ast_literal *lit = mcc_arena_alloc(arena, sizeof(*lit));
 	if (!lit) {
 		return NULL;
 	}
@@ -110,9 +167,11 @@ struct mcc_ast_literal *mcc_ast_new_literal_int(long value)
 	return lit;
 }
 
-struct mcc_ast_literal *mcc_ast_new_literal_float(double value)
+struct mcc_ast_literal *mcc_ast_new_literal_float(struct mcc_arena *arena, double value)
 {
-	struct mcc_ast_literal *lit = malloc(sizeof(*lit));
+	assert(arena);
+
+	struct mcc_ast_literal *lit = mcc_arena_alloc(arena, sizeof(*lit));
 	if (!lit) {
 		return NULL;
 	}
@@ -122,9 +181,11 @@ struct mcc_ast_literal *mcc_ast_new_literal_float(double value)
 	return lit;
 }
 
-struct mcc_ast_literal *mcc_ast_new_literal_string(char* value)
+struct mcc_ast_literal *mcc_ast_new_literal_string(struct mcc_arena *arena, char* value)
 {
-	struct mcc_ast_literal *lit = malloc(sizeof(*lit));
+	assert(arena);
+
+	struct mcc_ast_literal *lit = mcc_arena_alloc(arena, sizeof(*lit));
 
 
 	if (!lit) {
@@ -137,9 +198,11 @@ struct mcc_ast_literal *mcc_ast_new_literal_string(char* value)
 	return lit;
 }
 
-struct mcc_ast_literal *mcc_ast_new_literal_bool(bool value)
+struct mcc_ast_literal *mcc_ast_new_literal_bool(struct mcc_arena *arena, bool value)
 {
-	struct mcc_ast_literal *lit = malloc(sizeof(*lit));
+	assert(arena);
+
+	struct mcc_ast_literal *lit = mcc_arena_alloc(arena, sizeof(*lit));
 
 	if (!lit) {
 		return NULL;
@@ -153,67 +216,86 @@ struct mcc_ast_literal *mcc_ast_new_literal_bool(bool value)
 
 
 
-void mcc_ast_delete_literal(struct mcc_ast_literal *literal)
-{
-	assert(literal);
-	free(literal);
-}
-
 // ------------------------------------------------------------------- Identifier
 
-struct mcc_ast_identifier *mcc_ast_new_identifier(char *value)
+struct mcc_ast_identifier *mcc_ast_new_identifier(struct mcc_arena *arena, const char *value)
 {
-	struct mcc_ast_identifier *id = malloc(sizeof(*id));
+	assert(arena);
+	assert(value);
+
+	struct mcc_ast_identifier *id = mcc_arena_alloc(arena, sizeof(*id));
 	if (!id) {
 		return NULL;
 	}
 
-	char *str = malloc((strlen(value) + 1) * sizeof(char));
-	strcpy(str, value);
+	id->i_value = mcc_intern(value);
+	if (!id->i_value) {
+		return NULL;
+	}
 
-	id->i_value = str;
 	return id;
 }
 
-void mcc_ast_delete_identifier(struct mcc_ast_identifier *identifier)
+struct mcc_ast_identifier *mcc_ast_new_identifier_n(struct mcc_arena *arena, const char *value, size_t len)
 {
-	assert(identifier);
-	free(identifier->i_value);
-	free(identifier);
+	assert(arena);
+	assert(value);
+
+	struct mcc_ast_identifier *id = mcc_arena_alloc(arena, sizeof(*id));
+	if (!id) {
+		return NULL;
+	}
+
+	id->i_value = mcc_intern_n(value, len);
+	if (!id->i_value) {
+		return NULL;
+	}
+
+	return id;
 }
 
 // ------------------------------------------------------------------- Declaration
 
-struct mcc_ast_declaration *mcc_ast_new_declaration(enum mcc_ast_data_type type, struct mcc_ast_identifier *identifier)
+struct mcc_ast_declaration *mcc_ast_new_declaration(struct mcc_arena *arena,
+                                                    enum mcc_ast_data_type type,
+                                                    struct mcc_ast_literal *array_size,
+                                                    struct mcc_ast_identifier *identifier)
 {
+    assert(arena);
     assert(identifier);
 
-    struct mcc_ast_declaration *decl= malloc(sizeof(*decl));
+    struct mcc_ast_declaration *decl = mcc_arena_alloc(arena, sizeof(*decl));
+    if (!decl)
+        return NULL;
 
     decl -> type = type;
+    decl -> array_size = array_size;
     decl -> identifier = identifier;
 
-
     return decl;
 }
 
 
 // ------------------------------------------------------------------- Statements
 
-struct mcc_ast_statement *construct_statement()
+static struct mcc_ast_statement *construct_statement(struct mcc_arena *arena)
 {
-    struct mcc_ast_statement *stmt = malloc(sizeof(*stmt));
+    struct mcc_ast_statement *stmt = mcc_arena_alloc(arena, sizeof(*stmt));
     if (!stmt)
         return NULL;
 
     return stmt;
 }
 
-struct mcc_ast_statement *mcc_ast_new_statement_expression(struct mcc_ast_expression *expression)
+struct mcc_ast_statement *mcc_ast_new_statement_expression(struct mcc_arena *arena,
+                                                           struct mcc_ast_expression *expression)
 {
+	assert(arena);
 	assert(expression);
 
-	struct mcc_ast_statement *stmt = construct_statement();
+	struct mcc_ast_statement *stmt = construct_statement(arena);
+	if (!stmt)
+		return NULL;
 
 	stmt -> type = MMC_AST_STATEMENT_TYPE_EXPRESSION;
 	stmt -> expression = expression;
@@ -221,48 +303,54 @@ struct mcc_ast_statement *mcc_ast_new_statement_expression(struct mcc_ast_expres
 }
 
 
-struct mcc_ast_statement *mcc_ast_new_statement_if(struct mcc_ast_expression *condition,
+struct mcc_ast_statement *mcc_ast_new_statement_if(struct mcc_arena *arena,
+                                                   struct mcc_ast_expression *condition,
                                                    struct mcc_ast_statement *if_stmt,
                                                    struct mcc_ast_statement *else_stmt)
 {
+    assert(arena);
     assert(condition);
     assert(if_stmt);
-    assert(else_stmt);
 
-    struct mcc_ast_statement *stmt = construct_statement();
+    struct mcc_ast_statement *stmt = construct_statement(arena);
+    if (!stmt)
+        return NULL;
 
     stmt -> type = MCC_AST_STATEMENT_TYPE_IF;
+    stmt -> if_condition = condition;
     stmt -> if_stmt = if_stmt;
-    if (else_stmt) {
-        stmt -> else_stmt = else_stmt;
-    }
+    stmt -> else_stmt = else_stmt;
 
     return stmt;
 }
 
-struct mcc_ast_statement *mcc_ast_new_statement_declaration(enum mcc_ast_data_type data_type,
-                                                            struct mcc_ast_identifier *identifier)
+struct mcc_ast_statement *mcc_ast_new_statement_declaration(struct mcc_arena *arena,
+                                                            struct mcc_ast_declaration *declaration)
 {
-    assert(identifier);
-
-    printf("Parse declaration");
+    assert(arena);
+    assert(declaration);
 
-    struct mcc_ast_statement *stmt = construct_statement();
+    struct mcc_ast_statement *stmt = construct_statement(arena);
+    if (!stmt)
+        return NULL;
 
     stmt -> type = MCC_AST_STATEMENT_TYPE_DECL;
-    stmt -> data_type = data_type;
-    stmt -> id_decl = identifier;
+    stmt -> declaration = declaration;
 
     return stmt;
 }
 
-struct mcc_ast_statement *mcc_ast_new_statement_while(struct mcc_ast_expression *condition,
+struct mcc_ast_statement *mcc_ast_new_statement_while(struct mcc_arena *arena,
+                                                      struct mcc_ast_expression *condition,
                                                       struct mcc_ast_statement *while_stmt)
 {
+    assert(arena);
     assert(condition);
     assert(while_stmt);
 
-    struct mcc_ast_statement *stmt = construct_statement();
+    struct mcc_ast_statement *stmt = construct_statement(arena);
+    if (!stmt)
+        return NULL;
 
     stmt -> type = MCC_AST_STATEMENT_TYPE_WHILE;
     stmt -> while_condition = condition;
@@ -274,15 +362,18 @@ struct mcc_ast_statement *mcc_ast_new_statement_while(struct mcc_ast_expression
 
 
 
-struct mcc_ast_statement *mcc_ast_new_statement_assignment(struct mcc_ast_identifier *id_assgn,
+struct mcc_ast_statement *mcc_ast_new_statement_assignment(struct mcc_arena *arena,
+                                                           struct mcc_ast_identifier *id_assgn,
                                                            struct mcc_ast_expression *lhs_assgn,
                                                            struct mcc_ast_expression *rhs_assgn)
 {
+    assert(arena);
     assert(id_assgn);
-    assert(lhs_assgn);
     assert(rhs_assgn);
 
-    struct mcc_ast_statement *stmt = construct_statement();
+    struct mcc_ast_statement *stmt = construct_statement(arena);
+    if (!stmt)
+        return NULL;
 
     stmt -> type = MCC_AST_STATEMENT_TYPE_ASSGN;
     stmt -> id_assgn = id_assgn;
@@ -292,92 +383,148 @@ struct mcc_ast_statement *mcc_ast_new_statement_assignment(struct mcc_ast_identi
     return stmt;
 }
 
-void mcc_ast_empty_node() {
-}
-
-// ------------------------------------------------------------------- Function Definition / calls
-
-struct mcc_ast_function_def *mcc_ast_new_function_def( enum mcc_ast_data_type type, 
-														struct mcc_ast_identifier *identifier,
-														struct mcc_ast_parameter *parameter,
-														struct mcc_ast_statement *compound_statement)
+struct mcc_ast_statement *mcc_ast_new_statement_compound(struct mcc_arena *arena,
+                                                         struct mcc_ast_statement_list *statement_list)
 {
-	assert(type);
-	assert(identifier);
-	assert(parameter);
-	assert(compound_statement);
-
-
-
-	struct mcc_ast_function_def *type_function= malloc(sizeof(type_function));
-
+    assert(arena);
 
-	switch (type_function -> type){
+    struct mcc_ast_statement *stmt = construct_statement(arena);
+    if (!stmt)
+        return NULL;
 
-		case (MCC_AST_LITERAL_TYPE_INT):
-		  type_function -> type = MCC_AST_LITERAL_TYPE_INT;
-		case (MCC_AST_LITERAL_TYPE_FLOAT):
-			type_function -> type = MCC_AST_LITERAL_TYPE_FLOAT;
-		case(MCC_AST_LITERAL_TYPE_BOOL):
-			type_function ->  type = MCC_AST_LITERAL_TYPE_BOOL;
-		case (MCC_AST_LITERAL_TYPE_STRING):
-			type_function ->  type = MCC_AST_LITERAL_TYPE_STRING;
+    stmt -> type = MCC_AST_STATEMENT_TYPE_COMPOUND;
+    stmt -> compound_statement = statement_list;
 
-	};
+    return stmt;
+}
 
-	type_function -> parameter = parameter;
-	type_function -> identifier = identifier;
-	type_function -> compund_statement = compound_statement;
+struct mcc_ast_statement *mcc_ast_new_statement_return(struct mcc_arena *arena, struct mcc_ast_expression *value)
+{
+    assert(arena);
 
+    struct mcc_ast_statement *stmt = construct_statement(arena);
+    if (!stmt)
+        return NULL;
 
-	return type_function;
+    stmt -> type = MCC_AST_STATEMENT_TYPE_RETURN;
+    stmt -> return_value = value;
 
+    return stmt;
 }
 
-
-struct mcc_ast_function *mcc_ast_function_to_def(struct mcc_ast_function *function, struct mcc_ast_function_def *function_def)
+struct mcc_ast_statement_list *mcc_ast_new_statement_list(struct mcc_arena *arena,
+                                                          struct mcc_ast_statement *statement)
 {
-	assert(function);
-	assert(function_def);
+    assert(arena);
+    assert(statement);
 
+    struct mcc_ast_statement_list *list = mcc_arena_alloc(arena, sizeof(*list));
+    if (!list)
+        return NULL;
 
-	memcpy(function , function_def, sizeof(function));
-	free(function);
+    list -> statement = statement;
+    list -> next = NULL;
 
-	return function;
+    return list;
+}
 
+void mcc_ast_empty_node() {
 }
 
-struct mcc_ast_function *mcc_ast_new_function(struct mcc_ast_function *function)
-{
-	assert(function);
+// ------------------------------------------------------------------- Function Definition / calls
 
+struct mcc_ast_function_def *mcc_ast_new_function_def(struct mcc_arena *arena,
+                                                      enum mcc_ast_data_type type,
+                                                      struct mcc_ast_identifier *identifier,
+                                                      struct mcc_ast_parameter *parameter,
+                                                      struct mcc_ast_statement *compound_statement)
+{
+	assert(arena);
+	assert(identifier);
+	assert(compound_statement);
 
-	struct mcc_ast_function *func = malloc(sizeof(func));
-	return func;
+	struct mcc_ast_function_def *function_def = mcc_arena_alloc(arena, sizeof(*function_def));
+	if (!function_def) {
+		return NULL;
+	}
 
+	function_def->type = type;
+	function_def->identifier = identifier;
+	function_def->parameter = parameter;
+	function_def->compund_statement = compound_statement;
+	function_def->next = NULL;
+	return function_def;
 }
 
 // ------------------------------------------------------------------- Parameters
 
-struct mcc_ast_parameter *mcc_ast_new_parameter(struct mcc_ast_declaration *declaration)
+struct mcc_ast_parameter *mcc_ast_new_parameter(struct mcc_arena *arena, struct mcc_ast_declaration *declaration)
 {
+	assert(arena);
 	assert(declaration);
 
-	struct mcc_ast_parameter *param = malloc(sizeof(*param));
-	assert(param);
+	struct mcc_ast_parameter *param = mcc_arena_alloc(arena, sizeof(*param));
+	if (!param) {
+		return NULL;
+	}
 
 	param->declaration = declaration;
 	param->next = NULL;
 	return param;
 }
 
-void mcc_ast_delete_parameter(struct mcc_ast_parameter *parameter)
+// ------------------------------------------------------------------- Program
+
+struct mcc_ast_program *mcc_ast_new_program(struct mcc_arena *arena, struct mcc_ast_function_def *function_def)
+{
+	assert(arena);
+
+	struct mcc_ast_program *program = mcc_arena_alloc(arena, sizeof(*program));
+	if (!program) {
+		return NULL;
+	}
+
+	// programs span several inputs when merged, they have no location
+	program->node.sloc = (struct mcc_ast_source_location){0};
+	program->function_def = NULL;
+	program->last_function_def = NULL;
+
+	if (function_def) {
+		mcc_ast_add_function_def(program, function_def);
+	}
+	return program;
+}
+
+void mcc_ast_add_function_def(struct mcc_ast_program *program, struct mcc_ast_function_def *function_def)
 {
-	assert(parameter);
-	free(parameter->declaration);
-	if (parameter->next != NULL) {
-		mcc_ast_delete_parameter(parameter->next);
+	assert(program);
+	assert(function_def);
+	assert(!function_def->next);
+
+	if (program->last_function_def) {
+		program->last_function_def->next = function_def;
+	} else {
+		program->function_def = function_def;
 	}
-	free(parameter);
-}
\ No newline at end of file
+	program->last_function_def = function_def;
+}
+
+void mcc_ast_merge_programs(struct mcc_ast_program *program, struct mcc_ast_program *other)
+{
+	assert(program);
+	assert(other);
+
+	if (!other->function_def) {
+		return;
+	}
+
+	if (program->last_function_def) {
+		program->last_function_def->next = other->function_def;
+	} else {
+		program->function_def = other->function_def;
+	}
+	program->last_function_def = other->last_function_def;
+
+	other->function_def = NULL;
+	other->last_function_def = NULL;
+}
@@ -0,0 +1,892 @@
+#include "mcc/ast_cache.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdalign.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mcc/intern.h"
+#include "utils/reserve.h"
+
+// Bump whenever the image format changes. Changes of the AST structs are
+// caught by the layout fingerprint.
+#define IMAGE_VERSION 2
+
+#define IMAGE_MAGIC "MCCAST\0\0"
+
+// Nodes are placed in the image with the same alignment the arena uses.
+#define ALIGN_UP(x) (((x) + alignof(max_align_t) - 1) & ~(uint64_t)(alignof(max_align_t) - 1))
+
+// An image file consists of
+//
+//   header        (padded to HEADER_SIZE)
+//   data          node copies and strings; offset 0 is reserved for NULL
+//   relocs        uint64_t offsets of pointer fields within data, each holding
+//                 the data offset of its target
+//   strings       uint64_t data offsets of the distinct identifier names
+//   name relocs   pairs of uint64_t: offset of an `i_value` field within data
+//                 and the index of its name in strings
+struct image_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t layout;
+	struct mcc_ast_cache_key key;
+	uint64_t data_size;
+	uint64_t reloc_count;
+	uint64_t string_count;
+	uint64_t name_reloc_count;
+	uint64_t root;
+};
+
+#define HEADER_SIZE ALIGN_UP(sizeof(struct image_header))
+
+// ------------------------------------------------------------------- Hashing
+
+static uint64_t hash_fnv1a(const void *data, size_t len)
+{
+	const unsigned char *bytes = data;
+
+	uint64_t hash = 0xcbf29ce484222325u;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3u;
+	}
+	return hash;
+}
+
+static uint64_t mix64(uint64_t x)
+{
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9u;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebu;
+	x ^= x >> 31;
+	return x;
+}
+
+// Word-wise hash, independent of FNV-1a; together they form a 128-bit key.
+static uint64_t hash_words(const char *data, size_t len)
+{
+	uint64_t hash = mix64(len ^ 0x9e3779b97f4a7c15u);
+
+	for (size_t i = 0; i < len; i += sizeof(uint64_t)) {
+		uint64_t word = 0;
+		memcpy(&word, data + i, len - i < sizeof(word) ? len - i : sizeof(word));
+		hash = mix64(hash ^ word) + 0x9e3779b97f4a7c15u;
+	}
+	return mix64(hash);
+}
+
+void mcc_ast_cache_compute_key(struct mcc_ast_cache_key *key, const char *data, size_t len)
+{
+	assert(key);
+	assert(data || len == 0);
+
+	key->hash[0] = hash_fnv1a(data, len);
+	key->hash[1] = hash_words(data, len);
+}
+
+// Images copy the AST structs verbatim, hence they are only valid for builds
+// sharing the same struct layout.
+static uint64_t layout_fingerprint(void)
+{
+	const uint64_t layout[] = {
+	    IMAGE_VERSION,
+	    sizeof(void *),
+	    sizeof(struct mcc_ast_node),
+	    sizeof(struct mcc_ast_program),
+	    offsetof(struct mcc_ast_program, function_def),
+	    sizeof(struct mcc_ast_function_def),
+	    offsetof(struct mcc_ast_function_def, identifier),
+	    offsetof(struct mcc_ast_function_def, parameter),
+	    offsetof(struct mcc_ast_function_def, compund_statement),
+	    offsetof(struct mcc_ast_function_def, next),
+	    sizeof(struct mcc_ast_parameter),
+	    offsetof(struct mcc_ast_parameter, next),
+	    offsetof(struct mcc_ast_parameter, declaration),
+	    sizeof(struct mcc_ast_declaration),
+	    offsetof(struct mcc_ast_declaration, array_size),
+	    offsetof(struct mcc_ast_declaration, identifier),
+	    sizeof(struct mcc_ast_identifier),
+	    offsetof(struct mcc_ast_identifier, i_value),
+	    sizeof(struct mcc_ast_statement_list),
+	    offsetof(struct mcc_ast_statement_list, statement),
+	    offsetof(struct mcc_ast_statement_list, next),
+	    sizeof(struct mcc_ast_statement),
+	    offsetof(struct mcc_ast_statement, expression),
+	    offsetof(struct mcc_ast_statement, declaration),
+	    offsetof(struct mcc_ast_statement, if_stmt),
+	    offsetof(struct mcc_ast_statement, else_stmt),
+	    offsetof(struct mcc_ast_statement, while_stmt),
+	    offsetof(struct mcc_ast_statement, lhs_assgn),
+	    offsetof(struct mcc_ast_statement, rhs_assgn),
+	    sizeof(struct mcc_ast_expression),
+	    offsetof(struct mcc_ast_expression, lhs),
+	    offsetof(struct mcc_ast_expression, rhs),
+	    offsetof(struct mcc_ast_expression, expression),
+	    offsetof(struct mcc_ast_expression, index),
+	    offsetof(struct mcc_ast_expression, arguments),
+	    sizeof(struct mcc_ast_argument),
+	    offsetof(struct mcc_ast_argument, next),
+	    offsetof(struct mcc_ast_argument, expression),
+	    sizeof(struct mcc_ast_literal),
+	    offsetof(struct mcc_ast_literal, i_value),
+	};
+	return hash_fnv1a(layout, sizeof(layout));
+}
+
+// ------------------------------------------------------------------- Writing
+
+enum kind {
+	KIND_PROGRAM,
+	KIND_FUNCTION_DEF,
+	KIND_PARAMETER,
+	KIND_DECLARATION,
+	KIND_IDENTIFIER,
+	KIND_STATEMENT,
+	KIND_STATEMENT_LIST,
+	KIND_EXPRESSION,
+	KIND_ARGUMENT,
+	KIND_LITERAL,
+	KIND_STRING,
+};
+
+struct buffer {
+	char *data;
+	size_t len;
+	size_t capacity;
+};
+
+// A pointer field at data offset `field` which has to be set to the image of
+// `node` once it has been written.
+struct pending {
+	uint64_t field;
+	enum kind kind;
+	const void *node;
+};
+
+// Maps an interned name to its index in the strings section.
+struct name_slot {
+	const char *name;
+	uint64_t index;
+};
+
+struct writer {
+	struct buffer data;
+	struct buffer relocs;
+	struct buffer strings;
+	struct buffer name_relocs;
+
+	struct pending *stack;
+	size_t stack_len;
+	size_t stack_capacity;
+
+	struct name_slot *names;
+	size_t names_capacity;
+	size_t name_count;
+
+	bool failed;
+};
+
+// Appends `len` zero bytes and returns their offset.
+static uint64_t buffer_append(struct writer *w, struct buffer *buf, size_t len)
+{
+	if (w->failed) {
+		return 0;
+	}
+
+	if (!reserve_wide((void **)&buf->data, &buf->capacity, buf->len, len, 1)) {
+		w->failed = true;
+		return 0;
+	}
+
+	uint64_t offset = buf->len;
+	memset(buf->data + offset, 0, len);
+	buf->len += len;
+	return offset;
+}
+
+static void buffer_append_u64(struct writer *w, struct buffer *buf, uint64_t value)
+{
+	uint64_t offset = buffer_append(w, buf, sizeof(value));
+	if (!w->failed) {
+		memcpy(buf->data + offset, &value, sizeof(value));
+	}
+}
+
+static void *node_at(struct writer *w, uint64_t offset)
+{
+	return w->data.data + offset;
+}
+
+static uint64_t append_node(struct writer *w, size_t size)
+{
+	return buffer_append(w, &w->data, ALIGN_UP(size));
+}
+
+static void schedule(struct writer *w, uint64_t field, enum kind kind, const void *node)
+{
+	if (!node || w->failed) {
+		return;
+	}
+
+	if (!reserve_wide((void **)&w->stack, &w->stack_capacity, w->stack_len, 1, sizeof(*w->stack))) {
+		w->failed = true;
+		return;
+	}
+
+	w->stack[w->stack_len++] = (struct pending){
+	    .field = field,
+	    .kind = kind,
+	    .node = node,
+	};
+}
+
+static bool grow_names(struct writer *w)
+{
+	size_t capacity = w->names_capacity ? w->names_capacity * 2 : 256;
+	struct name_slot *names = calloc(capacity, sizeof(*names));
+	if (!names) {
+		return false;
+	}
+
+	for (size_t i = 0; i < w->names_capacity; ++i) {
+		if (!w->names[i].name) {
+			continue;
+		}
+		size_t slot = (size_t)mix64((uintptr_t)w->names[i].name) & (capacity - 1);
+		while (names[slot].name) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		names[slot] = w->names[i];
+	}
+
+	free(w->names);
+	w->names = names;
+	w->names_capacity = capacity;
+	return true;
+}
+
+// Records that the `i_value` field at `field` refers to `name`. Each distinct
+// name is written once; interned names can be told apart by their address.
+static void link_name(struct writer *w, uint64_t field, const char *name)
+{
+	if (w->failed) {
+		return;
+	}
+
+	if (2 * (w->name_count + 1) > w->names_capacity && !grow_names(w)) {
+		w->failed = true;
+		return;
+	}
+
+	size_t slot = (size_t)mix64((uintptr_t)name) & (w->names_capacity - 1);
+	while (w->names[slot].name && w->names[slot].name != name) {
+		slot = (slot + 1) & (w->names_capacity - 1);
+	}
+
+	if (!w->names[slot].name) {
+		size_t len = strlen(name) + 1;
+		uint64_t offset = append_node(w, len);
+		if (w->failed) {
+			return;
+		}
+		memcpy(node_at(w, offset), name, len);
+
+		w->names[slot] = (struct name_slot){
+		    .name = name,
+		    .index = w->name_count++,
+		};
+		buffer_append_u64(w, &w->strings, offset);
+	}
+
+	buffer_append_u64(w, &w->name_relocs, field);
+	buffer_append_u64(w, &w->name_relocs, w->names[slot].index);
+}
+
+#define FIELD(offset, type, member) ((offset) + offsetof(type, member))
+
+// Writes a copy of `node` to the image and schedules its children. Only the
+// members relevant for the node's type are copied; everything else stays zero.
+static uint64_t emit(struct writer *w, enum kind kind, const void *node)
+{
+	uint64_t off;
+
+	switch (kind) {
+	case KIND_PROGRAM: {
+		const struct mcc_ast_program *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_program *dst = node_at(w, off);
+		dst->node = src->node;
+
+		// `last_function_def` is restored when loading
+		schedule(w, FIELD(off, struct mcc_ast_program, function_def), KIND_FUNCTION_DEF, src->function_def);
+		break;
+	}
+
+	case KIND_FUNCTION_DEF: {
+		const struct mcc_ast_function_def *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_function_def *dst = node_at(w, off);
+		dst->node = src->node;
+		dst->type = src->type;
+
+		// `next` goes first so that long lists do not pile up on the stack
+		schedule(w, FIELD(off, struct mcc_ast_function_def, next), KIND_FUNCTION_DEF, src->next);
+		schedule(w, FIELD(off, struct mcc_ast_function_def, identifier), KIND_IDENTIFIER, src->identifier);
+		schedule(w, FIELD(off, struct mcc_ast_function_def, parameter), KIND_PARAMETER, src->parameter);
+		schedule(w, FIELD(off, struct mcc_ast_function_def, compund_statement), KIND_STATEMENT,
+		     src->compund_statement);
+		break;
+	}
+
+	case KIND_PARAMETER: {
+		const struct mcc_ast_parameter *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_parameter *dst = node_at(w, off);
+		dst->node = src->node;
+
+		schedule(w, FIELD(off, struct mcc_ast_parameter, next), KIND_PARAMETER, src->next);
+		schedule(w, FIELD(off, struct mcc_ast_parameter, declaration), KIND_DECLARATION, src->declaration);
+		break;
+	}
+
+	case KIND_DECLARATION: {
+		const struct mcc_ast_declaration *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_declaration *dst = node_at(w, off);
+		dst->node = src->node;
+		dst->type = src->type;
+
+		schedule(w, FIELD(off, struct mcc_ast_declaration, array_size), KIND_LITERAL, src->array_size);
+		schedule(w, FIELD(off, struct mcc_ast_declaration, identifier), KIND_IDENTIFIER, src->identifier);
+		break;
+	}
+
+	case KIND_IDENTIFIER: {
+		const struct mcc_ast_identifier *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_identifier *dst = node_at(w, off);
+		dst->node = src->node;
+
+		link_name(w, FIELD(off, struct mcc_ast_identifier, i_value), src->i_value);
+		break;
+	}
+
+	case KIND_STATEMENT: {
+		const struct mcc_ast_statement *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_statement *dst = node_at(w, off);
+		dst->node = src->node;
+		dst->type = src->type;
+
+		switch (src->type) {
+		case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+			schedule(w, FIELD(off, struct mcc_ast_statement, expression), KIND_EXPRESSION, src->expression);
+			break;
+		case MCC_AST_STATEMENT_TYPE_IF:
+			schedule(w, FIELD(off, struct mcc_ast_statement, if_condition), KIND_EXPRESSION, src->if_condition);
+			schedule(w, FIELD(off, struct mcc_ast_statement, if_stmt), KIND_STATEMENT, src->if_stmt);
+			schedule(w, FIELD(off, struct mcc_ast_statement, else_stmt), KIND_STATEMENT, src->else_stmt);
+			break;
+		case MCC_AST_STATEMENT_TYPE_WHILE:
+			schedule(w, FIELD(off, struct mcc_ast_statement, while_condition), KIND_EXPRESSION,
+			     src->while_condition);
+			schedule(w, FIELD(off, struct mcc_ast_statement, while_stmt), KIND_STATEMENT, src->while_stmt);
+			break;
+		case MCC_AST_STATEMENT_TYPE_DECL:
+			schedule(w, FIELD(off, struct mcc_ast_statement, declaration), KIND_DECLARATION,
+			         src->declaration);
+			break;
+		case MCC_AST_STATEMENT_TYPE_ASSGN:
+			schedule(w, FIELD(off, struct mcc_ast_statement, id_assgn), KIND_IDENTIFIER, src->id_assgn);
+			schedule(w, FIELD(off, struct mcc_ast_statement, lhs_assgn), KIND_EXPRESSION, src->lhs_assgn);
+			schedule(w, FIELD(off, struct mcc_ast_statement, rhs_assgn), KIND_EXPRESSION, src->rhs_assgn);
+			break;
+		case MCC_AST_STATEMENT_TYPE_COMPOUND:
+			schedule(w, FIELD(off, struct mcc_ast_statement, compound_statement), KIND_STATEMENT_LIST,
+			     src->compound_statement);
+			break;
+		case MCC_AST_STATEMENT_TYPE_RETURN:
+			schedule(w, FIELD(off, struct mcc_ast_statement, return_value), KIND_EXPRESSION,
+			         src->return_value);
+			break;
+		}
+		break;
+	}
+
+	case KIND_STATEMENT_LIST: {
+		const struct mcc_ast_statement_list *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_statement_list *dst = node_at(w, off);
+		dst->node = src->node;
+
+		schedule(w, FIELD(off, struct mcc_ast_statement_list, next), KIND_STATEMENT_LIST, src->next);
+		schedule(w, FIELD(off, struct mcc_ast_statement_list, statement), KIND_STATEMENT, src->statement);
+		break;
+	}
+
+	case KIND_EXPRESSION: {
+		const struct mcc_ast_expression *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_expression *dst = node_at(w, off);
+		dst->node = src->node;
+		dst->type = src->type;
+
+		switch (src->type) {
+		case MCC_AST_STATEMENT_TYPE_EXPR:
+			break;
+		case MCC_AST_EXPRESSION_TYPE_LITERAL:
+			schedule(w, FIELD(off, struct mcc_ast_expression, literal), KIND_LITERAL, src->literal);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+			dst->op = src->op;
+			schedule(w, FIELD(off, struct mcc_ast_expression, lhs), KIND_EXPRESSION, src->lhs);
+			schedule(w, FIELD(off, struct mcc_ast_expression, rhs), KIND_EXPRESSION, src->rhs);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+			dst->up = src->up;
+			schedule(w, FIELD(off, struct mcc_ast_expression, rhs), KIND_EXPRESSION, src->rhs);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_PARENTH:
+			schedule(w, FIELD(off, struct mcc_ast_expression, expression), KIND_EXPRESSION, src->expression);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+			schedule(w, FIELD(off, struct mcc_ast_expression, identifier), KIND_IDENTIFIER, src->identifier);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+			schedule(w, FIELD(off, struct mcc_ast_expression, array), KIND_IDENTIFIER, src->array);
+			schedule(w, FIELD(off, struct mcc_ast_expression, index), KIND_EXPRESSION, src->index);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_CALL:
+			schedule(w, FIELD(off, struct mcc_ast_expression, function), KIND_IDENTIFIER, src->function);
+			schedule(w, FIELD(off, struct mcc_ast_expression, arguments), KIND_ARGUMENT, src->arguments);
+			break;
+		}
+		break;
+	}
+
+	case KIND_ARGUMENT: {
+		const struct mcc_ast_argument *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_argument *dst = node_at(w, off);
+		dst->node = src->node;
+
+		schedule(w, FIELD(off, struct mcc_ast_argument, next), KIND_ARGUMENT, src->next);
+		schedule(w, FIELD(off, struct mcc_ast_argument, expression), KIND_EXPRESSION, src->expression);
+		break;
+	}
+
+	case KIND_LITERAL: {
+		const struct mcc_ast_literal *src = node;
+		off = append_node(w, sizeof(*src));
+		if (w->failed) {
+			return 0;
+		}
+		struct mcc_ast_literal *dst = node_at(w, off);
+		dst->node = src->node;
+		dst->type = src->type;
+
+		switch (src->type) {
+		case MCC_AST_LITERAL_TYPE_INT:
+			dst->i_value = src->i_value;
+			break;
+		case MCC_AST_LITERAL_TYPE_FLOAT:
+			dst->f_value = src->f_value;
+			break;
+		case MCC_AST_LITERAL_TYPE_STRING:
+			schedule(w, FIELD(off, struct mcc_ast_literal, s_value), KIND_STRING, src->s_value);
+			break;
+		case MCC_AST_LITERAL_TYPE_BOOL:
+			dst->b_value = src->b_value;
+			break;
+		}
+		break;
+	}
+
+	case KIND_STRING: {
+		const char *src = node;
+		size_t len = strlen(src) + 1;
+		off = append_node(w, len);
+		if (w->failed) {
+			return 0;
+		}
+		memcpy(node_at(w, off), src, len);
+		break;
+	}
+
+	default:
+		assert(false);
+		return 0;
+	}
+
+	return off;
+}
+
+#undef FIELD
+
+// Serialises `program` into the buffers of `w`, returns the root offset.
+static uint64_t write_image(struct writer *w, const struct mcc_ast_program *program)
+{
+	// offset 0 denotes NULL
+	append_node(w, 1);
+
+	uint64_t root = emit(w, KIND_PROGRAM, program);
+
+	while (w->stack_len > 0 && !w->failed) {
+		struct pending p = w->stack[--w->stack_len];
+
+		uintptr_t target = (uintptr_t)emit(w, p.kind, p.node);
+		if (w->failed) {
+			break;
+		}
+
+		memcpy(w->data.data + p.field, &target, sizeof(target));
+		buffer_append_u64(w, &w->relocs, p.field);
+	}
+
+	return root;
+}
+
+static void writer_release(struct writer *w)
+{
+	free(w->data.data);
+	free(w->relocs.data);
+	free(w->strings.data);
+	free(w->name_relocs.data);
+	free(w->stack);
+	free(w->names);
+}
+
+// ------------------------------------------------------------------- Files
+
+// Returns the malloc'ed path of the entry for `key`.
+static char *entry_path(const char *dir, const struct mcc_ast_cache_key *key)
+{
+	const char *format = "%s/%016llx%016llx.ast";
+
+	int len = snprintf(NULL, 0, format, dir, (unsigned long long)key->hash[0],
+	                   (unsigned long long)key->hash[1]);
+	if (len < 0) {
+		return NULL;
+	}
+
+	char *path = malloc((size_t)len + 1);
+	if (!path) {
+		return NULL;
+	}
+
+	snprintf(path, (size_t)len + 1, format, dir, (unsigned long long)key->hash[0],
+	         (unsigned long long)key->hash[1]);
+	return path;
+}
+
+static bool write_all(int fd, const void *data, size_t len)
+{
+	const char *bytes = data;
+	while (len > 0) {
+		ssize_t n = write(fd, bytes, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		bytes += n;
+		len -= (size_t)n;
+	}
+	return true;
+}
+
+static bool read_all(int fd, void *data, size_t len)
+{
+	char *bytes = data;
+	while (len > 0) {
+		ssize_t n = read(fd, bytes, len);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			return false;
+		}
+		bytes += n;
+		len -= (size_t)n;
+	}
+	return true;
+}
+
+bool mcc_ast_cache_store(const char *dir, const struct mcc_ast_cache_key *key, const struct mcc_ast_program *program)
+{
+	assert(dir);
+	assert(key);
+	assert(program);
+
+	struct writer w = {0};
+	uint64_t root = write_image(&w, program);
+	if (w.failed) {
+		writer_release(&w);
+		return false;
+	}
+
+	struct image_header image_header = {
+	    .magic = IMAGE_MAGIC,
+	    .version = IMAGE_VERSION,
+	    .layout = layout_fingerprint(),
+	    .key = *key,
+	    .data_size = w.data.len,
+	    .reloc_count = w.relocs.len / sizeof(uint64_t),
+	    .string_count = w.strings.len / sizeof(uint64_t),
+	    .name_reloc_count = w.name_relocs.len / (2 * sizeof(uint64_t)),
+	    .root = root,
+	};
+
+	char header[HEADER_SIZE];
+	memset(header, 0, sizeof(header));
+	memcpy(header, &image_header, sizeof(image_header));
+
+	if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+		writer_release(&w);
+		return false;
+	}
+
+	char *path = entry_path(dir, key);
+	char *tmp_path = path ? malloc(strlen(path) + sizeof(".XXXXXX")) : NULL;
+	if (!tmp_path) {
+		free(path);
+		writer_release(&w);
+		return false;
+	}
+	strcpy(tmp_path, path);
+	strcat(tmp_path, ".XXXXXX");
+
+	// Write to a private file first and move it into place afterwards;
+	// rename is atomic, readers see either no entry or a complete one.
+	int fd = mkstemp(tmp_path);
+	bool ok = fd >= 0;
+	if (ok) {
+		ok = fchmod(fd, 0644) == 0 && write_all(fd, header, sizeof(header)) &&
+		     write_all(fd, w.data.data, w.data.len) && write_all(fd, w.relocs.data, w.relocs.len) &&
+		     write_all(fd, w.strings.data, w.strings.len) &&
+		     write_all(fd, w.name_relocs.data, w.name_relocs.len);
+		ok = close(fd) == 0 && ok;
+		ok = ok && rename(tmp_path, path) == 0;
+		if (!ok) {
+			unlink(tmp_path);
+		}
+	}
+
+	free(tmp_path);
+	free(path);
+	writer_release(&w);
+	return ok;
+}
+
+// ------------------------------------------------------------------- Loading
+
+static bool valid_field(uint64_t field, uint64_t data_size)
+{
+	return field >= alignof(max_align_t) && field % alignof(void *) == 0 && field <= data_size - sizeof(void *);
+}
+
+// Turns the offsets of a freshly read image into pointers. Returns the root
+// program or NULL if the image is inconsistent.
+static struct mcc_ast_program *fixup(char *image, const struct image_header *header)
+{
+	char *data = image + HEADER_SIZE;
+	uint64_t data_size = header->data_size;
+
+	const uint64_t *relocs = (const uint64_t *)(data + data_size);
+	const uint64_t *strings = relocs + header->reloc_count;
+	const uint64_t *name_relocs = strings + header->string_count;
+
+	for (uint64_t i = 0; i < header->reloc_count; ++i) {
+		if (!valid_field(relocs[i], data_size)) {
+			return NULL;
+		}
+
+		uintptr_t target;
+		memcpy(&target, data + relocs[i], sizeof(target));
+		if (target >= data_size) {
+			return NULL;
+		}
+
+		void *ptr = target ? data + target : NULL;
+		memcpy(data + relocs[i], &ptr, sizeof(ptr));
+	}
+
+	const char **names = malloc((header->string_count ? header->string_count : 1) * sizeof(*names));
+	if (!names) {
+		return NULL;
+	}
+
+	bool ok = true;
+	for (uint64_t i = 0; ok && i < header->string_count; ++i) {
+		uint64_t offset = strings[i];
+		ok = offset != 0 && offset < data_size && memchr(data + offset, '\0', data_size - offset) != NULL;
+		if (ok) {
+			names[i] = mcc_intern(data + offset);
+			ok = names[i] != NULL;
+		}
+	}
+
+	for (uint64_t i = 0; ok && i < header->name_reloc_count; ++i) {
+		uint64_t field = name_relocs[2 * i];
+		uint64_t index = name_relocs[2 * i + 1];
+
+		ok = valid_field(field, data_size) && index < header->string_count;
+		if (ok) {
+			memcpy(data + field, &names[index], sizeof(names[index]));
+		}
+	}
+
+	free(names);
+
+	if (!ok || header->root == 0 || header->root % alignof(max_align_t) != 0 ||
+	    header->root > data_size - sizeof(struct mcc_ast_program)) {
+		return NULL;
+	}
+
+	struct mcc_ast_program *program = (struct mcc_ast_program *)(data + header->root);
+
+	program->last_function_def = program->function_def;
+	while (program->last_function_def && program->last_function_def->next) {
+		program->last_function_def = program->last_function_def->next;
+	}
+
+	return program;
+}
+
+static bool valid_header(const struct image_header *header, const struct mcc_ast_cache_key *key, uint64_t size)
+{
+	if (memcmp(header->magic, IMAGE_MAGIC, sizeof(header->magic)) != 0 || header->version != IMAGE_VERSION ||
+	    header->layout != layout_fingerprint() || header->key.hash[0] != key->hash[0] ||
+	    header->key.hash[1] != key->hash[1]) {
+		return false;
+	}
+
+	uint64_t words = (size - HEADER_SIZE) / sizeof(uint64_t);
+	if (header->data_size % alignof(max_align_t) != 0 || header->data_size < alignof(max_align_t) ||
+	    header->data_size > size - HEADER_SIZE || header->reloc_count > words || header->string_count > words ||
+	    header->name_reloc_count > words) {
+		return false;
+	}
+
+	return size == HEADER_SIZE + header->data_size +
+	                   sizeof(uint64_t) * (header->reloc_count + header->string_count +
+	                                       2 * header->name_reloc_count);
+}
+
+bool mcc_ast_cache_load(const char *dir, const struct mcc_ast_cache_key *key, struct mcc_parser_result *result)
+{
+	assert(dir);
+	assert(key);
+	assert(result);
+
+	char *path = entry_path(dir, key);
+	if (!path) {
+		return false;
+	}
+
+	int fd = open(path, O_RDONLY);
+	free(path);
+	if (fd < 0) {
+		return false;
+	}
+
+	// The image is read into an arena of its own, which is only handed over
+	// to `result` once it turned out to be valid.
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct stat st;
+	char *image = NULL;
+	bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && (uint64_t)st.st_size >= HEADER_SIZE;
+	if (ok) {
+		image = mcc_arena_alloc(&arena, (size_t)st.st_size);
+		ok = image && read_all(fd, image, (size_t)st.st_size);
+	}
+	close(fd);
+
+	struct mcc_ast_program *program = NULL;
+	if (ok) {
+		const struct image_header *header = (const struct image_header *)image;
+		if (valid_header(header, key, (uint64_t)st.st_size)) {
+			program = fixup(image, header);
+		}
+	}
+
+	if (!program) {
+		mcc_arena_release(&arena);
+		return false;
+	}
+
+	mcc_arena_merge(&result->arena, &arena);
+	result->program = program;
+	return true;
+}
+
+// ------------------------------------------------------------------- Parsing
+
+struct mcc_parser_result mcc_ast_cache_parse_buffer(const char *dir, char *data, size_t len)
+{
+	assert(data);
+
+	if (!dir || !*dir) {
+		return mcc_parse_buffer(data, len);
+	}
+
+	// The scanner modifies the buffer in place, hash it beforehand.
+	struct mcc_ast_cache_key key;
+	mcc_ast_cache_compute_key(&key, data, len);
+
+	struct mcc_parser_result result = {
+	    .status = MCC_PARSER_STATUS_OK,
+	};
+	mcc_arena_init(&result.arena);
+
+	if (mcc_ast_cache_load(dir, &key, &result)) {
+		return result;
+	}
+
+	result = mcc_parse_buffer(data, len);
+
+	// Failing to populate the cache is not an error.
+	if (result.status == MCC_PARSER_STATUS_OK && result.program) {
+		mcc_ast_cache_store(dir, &key, result.program);
+	}
+
+	return result;
+}
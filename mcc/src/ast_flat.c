@@ -0,0 +1,526 @@
+#include "mcc/ast_flat.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "utils/reserve.h"
+
+void mcc_ast_flat_init(struct mcc_ast_flat *flat)
+{
+	assert(flat);
+
+	*flat = (struct mcc_ast_flat){0};
+}
+
+void mcc_ast_flat_delete(struct mcc_ast_flat *flat)
+{
+	assert(flat);
+
+	free(flat->expressions);
+	free(flat->expression_slocs);
+	free(flat->literals);
+	free(flat->literal_slocs);
+	free(flat->identifiers);
+	free(flat->identifier_slocs);
+	free(flat->arguments);
+
+	mcc_ast_flat_init(flat);
+}
+
+// ---------------------------------------------------------------------- Nodes
+
+mcc_ast_flat_ref mcc_ast_flat_add_literal(struct mcc_ast_flat *flat,
+                                          const struct mcc_ast_flat_literal *literal,
+                                          const struct mcc_ast_source_location *sloc)
+{
+	assert(flat);
+	assert(literal);
+	assert(sloc);
+
+	// Both arrays share the same count, the sloc table is grown alongside.
+	uint32_t capacity = flat->literal_capacity;
+	if (!reserve((void **)&flat->literal_slocs, &capacity, flat->literal_count, 1, sizeof(*flat->literal_slocs)) ||
+	    !reserve((void **)&flat->literals, &flat->literal_capacity, flat->literal_count, 1,
+	             sizeof(*flat->literals))) {
+		return MCC_AST_FLAT_NONE;
+	}
+
+	mcc_ast_flat_ref ref = flat->literal_count++;
+	flat->literals[ref] = *literal;
+	flat->literal_slocs[ref] = *sloc;
+	return ref;
+}
+
+mcc_ast_flat_ref mcc_ast_flat_add_identifier(struct mcc_ast_flat *flat,
+                                             const char *name,
+                                             const struct mcc_ast_source_location *sloc)
+{
+	assert(flat);
+	assert(name);
+	assert(sloc);
+
+	uint32_t capacity = flat->identifier_capacity;
+	if (!reserve((void **)&flat->identifier_slocs, &capacity, flat->identifier_count, 1,
+	             sizeof(*flat->identifier_slocs)) ||
+	    !reserve((void **)&flat->identifiers, &flat->identifier_capacity, flat->identifier_count, 1,
+	             sizeof(*flat->identifiers))) {
+		return MCC_AST_FLAT_NONE;
+	}
+
+	mcc_ast_flat_ref ref = flat->identifier_count++;
+	flat->identifiers[ref] = name;
+	flat->identifier_slocs[ref] = *sloc;
+	return ref;
+}
+
+mcc_ast_flat_ref mcc_ast_flat_add_arguments(struct mcc_ast_flat *flat, const mcc_ast_flat_ref *refs, uint32_t count)
+{
+	assert(flat);
+	assert(refs || count == 0);
+
+	mcc_ast_flat_ref ref = flat->argument_count;
+	for (uint32_t i = 0; i <= count; ++i) {
+		if (!reserve((void **)&flat->arguments, &flat->argument_capacity, flat->argument_count, 1,
+		             sizeof(*flat->arguments))) {
+			flat->argument_count = ref;
+			return MCC_AST_FLAT_NONE;
+		}
+		flat->arguments[flat->argument_count++] = i == 0 ? count : refs[i - 1];
+	}
+	return ref;
+}
+
+mcc_ast_flat_ref mcc_ast_flat_add_expression(struct mcc_ast_flat *flat,
+                                             const struct mcc_ast_flat_expression *expression,
+                                             const struct mcc_ast_source_location *sloc)
+{
+	assert(flat);
+	assert(expression);
+	assert(sloc);
+
+	uint32_t capacity = flat->expression_capacity;
+	if (!reserve((void **)&flat->expression_slocs, &capacity, flat->expression_count, 1,
+	             sizeof(*flat->expression_slocs)) ||
+	    !reserve((void **)&flat->expressions, &flat->expression_capacity, flat->expression_count, 1,
+	             sizeof(*flat->expressions))) {
+		return MCC_AST_FLAT_NONE;
+	}
+
+	mcc_ast_flat_ref ref = flat->expression_count++;
+	flat->expressions[ref] = *expression;
+	flat->expression_slocs[ref] = *sloc;
+	return ref;
+}
+
+// ----------------------------------------------------------------- Conversion
+
+// A growable stack of node references, used by the conversion and traversal.
+struct ref_stack {
+	mcc_ast_flat_ref *refs;
+	uint32_t count;
+	uint32_t capacity;
+};
+
+static bool ref_stack_push(struct ref_stack *stack, mcc_ast_flat_ref ref)
+{
+	if (!reserve((void **)&stack->refs, &stack->capacity, stack->count, 1, sizeof(*stack->refs))) {
+		return false;
+	}
+
+	stack->refs[stack->count++] = ref;
+	return true;
+}
+
+static mcc_ast_flat_ref ref_stack_pop(struct ref_stack *stack)
+{
+	assert(stack->count > 0);
+	return stack->refs[--stack->count];
+}
+
+struct from_expression_data {
+	struct mcc_ast_flat *flat;
+	struct ref_stack operands;
+	bool failed;
+};
+
+static mcc_ast_flat_ref from_literal(struct mcc_ast_flat *flat, struct mcc_ast_literal *literal)
+{
+	struct mcc_ast_flat_literal lit = {.type = literal->type};
+
+	switch (literal->type) {
+	case MCC_AST_LITERAL_TYPE_INT:
+		lit.i_value = literal->i_value;
+		break;
+	case MCC_AST_LITERAL_TYPE_FLOAT:
+		lit.f_value = literal->f_value;
+		break;
+	case MCC_AST_LITERAL_TYPE_STRING:
+		lit.s_value = literal->s_value;
+		break;
+	case MCC_AST_LITERAL_TYPE_BOOL:
+		lit.b_value = literal->b_value;
+		break;
+	}
+
+	return mcc_ast_flat_add_literal(flat, &lit, &literal->node.sloc);
+}
+
+static mcc_ast_flat_ref from_identifier(struct mcc_ast_flat *flat, struct mcc_ast_identifier *identifier)
+{
+	return mcc_ast_flat_add_identifier(flat, identifier->i_value, &identifier->node.sloc);
+}
+
+// Called in post-order, hence the operands of `expression` have already been
+// converted and sit on top of the operand stack.
+static void from_expression(struct mcc_ast_expression *expression, void *userdata)
+{
+	struct from_expression_data *data = userdata;
+	if (data->failed) {
+		return;
+	}
+
+	struct mcc_ast_flat_expression expr = {
+	    .type = expression->type,
+	    .a = MCC_AST_FLAT_NONE,
+	    .b = MCC_AST_FLAT_NONE,
+	};
+
+	switch (expression->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		expr.a = from_literal(data->flat, expression->literal);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+		expr.a = from_identifier(data->flat, expression->identifier);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		expr.op = expression->op;
+		expr.b = ref_stack_pop(&data->operands);
+		expr.a = ref_stack_pop(&data->operands);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		expr.op = expression->up;
+		expr.a = ref_stack_pop(&data->operands);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		expr.a = ref_stack_pop(&data->operands);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+		expr.a = from_identifier(data->flat, expression->array);
+		expr.b = ref_stack_pop(&data->operands);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_CALL: {
+		uint32_t count = 0;
+		for (struct mcc_ast_argument *arg = expression->arguments; arg; arg = arg->next) {
+			++count;
+		}
+
+		// the arguments are the topmost operands, in order
+		data->operands.count -= count;
+		expr.a = from_identifier(data->flat, expression->function);
+		if (count > 0) {
+			const mcc_ast_flat_ref *arguments = &data->operands.refs[data->operands.count];
+			expr.b = mcc_ast_flat_add_arguments(data->flat, arguments, count);
+			if (expr.b == MCC_AST_FLAT_NONE) {
+				data->failed = true;
+				return;
+			}
+		}
+		break;
+	}
+
+	default:
+		data->failed = true;
+		return;
+	}
+
+	if (expression->type == MCC_AST_EXPRESSION_TYPE_LITERAL ||
+	    expression->type == MCC_AST_EXPRESSION_TYPE_IDENTIFIER ||
+	    expression->type == MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT ||
+	    expression->type == MCC_AST_EXPRESSION_TYPE_CALL) {
+		if (expr.a == MCC_AST_FLAT_NONE) {
+			data->failed = true;
+			return;
+		}
+	}
+
+	mcc_ast_flat_ref ref = mcc_ast_flat_add_expression(data->flat, &expr, &expression->node.sloc);
+	if (ref == MCC_AST_FLAT_NONE || !ref_stack_push(&data->operands, ref)) {
+		data->failed = true;
+	}
+}
+
+mcc_ast_flat_ref mcc_ast_flat_from_expression(struct mcc_ast_flat *flat, struct mcc_ast_expression *expression)
+{
+	assert(flat);
+	assert(expression);
+
+	struct from_expression_data data = {
+	    .flat = flat,
+	};
+
+	struct mcc_ast_visitor visitor = {
+	    .traversal = MCC_AST_VISIT_DEPTH_FIRST,
+	    .order = MCC_AST_VISIT_POST_ORDER,
+	    .userdata = &data,
+	    .expression = from_expression,
+	};
+
+	if (!mcc_ast_visit(expression, &visitor)) {
+		data.failed = true;
+	}
+
+	mcc_ast_flat_ref root = MCC_AST_FLAT_NONE;
+	if (!data.failed) {
+		assert(data.operands.count == 1);
+		root = data.operands.refs[0];
+	}
+
+	free(data.operands.refs);
+	return root;
+}
+
+static struct mcc_ast_literal *
+to_literal(const struct mcc_ast_flat *flat, mcc_ast_flat_ref ref, struct mcc_arena *arena)
+{
+	const struct mcc_ast_flat_literal *lit = &flat->literals[ref];
+	struct mcc_ast_literal *literal = NULL;
+
+	switch (lit->type) {
+	case MCC_AST_LITERAL_TYPE_INT:
+		literal = mcc_ast_new_literal_int(arena, lit->i_value);
+		break;
+	case MCC_AST_LITERAL_TYPE_FLOAT:
+		literal = mcc_ast_new_literal_float(arena, lit->f_value);
+		break;
+	case MCC_AST_LITERAL_TYPE_STRING:
+		literal = mcc_ast_new_literal_string(arena, (char *)lit->s_value);
+		break;
+	case MCC_AST_LITERAL_TYPE_BOOL:
+		literal = mcc_ast_new_literal_bool(arena, lit->b_value);
+		break;
+	}
+
+	if (literal) {
+		literal->node.sloc = flat->literal_slocs[ref];
+	}
+	return literal;
+}
+
+static struct mcc_ast_identifier *
+to_identifier(const struct mcc_ast_flat *flat, mcc_ast_flat_ref ref, struct mcc_arena *arena)
+{
+	struct mcc_ast_identifier *identifier = mcc_ast_new_identifier(arena, flat->identifiers[ref]);
+	if (identifier) {
+		identifier->node.sloc = flat->identifier_slocs[ref];
+	}
+	return identifier;
+}
+
+struct to_expression_data {
+	struct mcc_arena *arena;
+	struct mcc_ast_expression **operands;
+	uint32_t count;
+	bool failed;
+};
+
+// Called in post-order, mirroring `from_expression`.
+static void to_expression(const struct mcc_ast_flat *flat, mcc_ast_flat_ref ref, void *userdata)
+{
+	struct to_expression_data *data = userdata;
+	if (data->failed) {
+		return;
+	}
+
+	const struct mcc_ast_flat_expression *expr = &flat->expressions[ref];
+	struct mcc_ast_expression *node = NULL;
+
+	switch (expr->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL: {
+		struct mcc_ast_literal *literal = to_literal(flat, expr->a, data->arena);
+		node = literal ? mcc_ast_new_expression_literal(data->arena, literal) : NULL;
+		break;
+	}
+
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER: {
+		struct mcc_ast_identifier *id = to_identifier(flat, expr->a, data->arena);
+		node = id ? mcc_ast_new_expression_identifier(data->arena, id) : NULL;
+		break;
+	}
+
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP: {
+		struct mcc_ast_expression *rhs = data->operands[--data->count];
+		struct mcc_ast_expression *lhs = data->operands[--data->count];
+		node = mcc_ast_new_expression_binary_op(data->arena, expr->op, lhs, rhs);
+		break;
+	}
+
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		node = mcc_ast_new_expression_unary_op(data->arena, expr->op, data->operands[--data->count]);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		node = mcc_ast_new_expression_parenth(data->arena, data->operands[--data->count]);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT: {
+		struct mcc_ast_identifier *array = to_identifier(flat, expr->a, data->arena);
+		struct mcc_ast_expression *index = data->operands[--data->count];
+		node = array ? mcc_ast_new_expression_array_element(data->arena, array, index) : NULL;
+		break;
+	}
+
+	case MCC_AST_EXPRESSION_TYPE_CALL: {
+		// the list is built back to front from the topmost operands
+		uint32_t count = expr->b == MCC_AST_FLAT_NONE ? 0 : flat->arguments[expr->b];
+		struct mcc_ast_argument *arguments = NULL;
+		for (uint32_t i = 0; i < count; ++i) {
+			struct mcc_ast_expression *expression = data->operands[--data->count];
+			struct mcc_ast_argument *argument = mcc_ast_new_argument(data->arena, expression);
+			if (!argument) {
+				data->failed = true;
+				return;
+			}
+			argument->node.sloc = expression->node.sloc;
+			argument->next = arguments;
+			arguments = argument;
+		}
+
+		struct mcc_ast_identifier *function = to_identifier(flat, expr->a, data->arena);
+		node = function ? mcc_ast_new_expression_call(data->arena, function, arguments) : NULL;
+		break;
+	}
+	}
+
+	if (!node) {
+		data->failed = true;
+		return;
+	}
+
+	node->node.sloc = flat->expression_slocs[ref];
+	data->operands[data->count++] = node;
+}
+
+struct mcc_ast_expression *
+mcc_ast_flat_to_expression(const struct mcc_ast_flat *flat, mcc_ast_flat_ref root, struct mcc_arena *arena)
+{
+	assert(flat);
+	assert(root < flat->expression_count);
+	assert(arena);
+
+	// Children precede their parents, hence the subtree has at most `root + 1`
+	// nodes which bounds the size of the operand stack.
+	struct to_expression_data data = {
+	    .arena = arena,
+	    .operands = malloc((root + 1) * sizeof(*data.operands)),
+	};
+	if (!data.operands) {
+		return NULL;
+	}
+
+	struct mcc_ast_flat_visitor visitor = {
+	    .order = MCC_AST_VISIT_POST_ORDER,
+	    .userdata = &data,
+	    .expression = to_expression,
+	};
+
+	struct mcc_ast_expression *result = NULL;
+	if (mcc_ast_flat_visit(flat, root, &visitor) && !data.failed) {
+		assert(data.count == 1);
+		result = data.operands[0];
+	}
+
+	free(data.operands);
+	return result;
+}
+
+// ------------------------------------------------------------------- Visiting
+
+bool mcc_ast_flat_visit(const struct mcc_ast_flat *flat, mcc_ast_flat_ref root, struct mcc_ast_flat_visitor *visitor)
+{
+	assert(flat);
+	assert(root < flat->expression_count);
+	assert(flat->expression_count <= UINT32_MAX >> 1);
+	assert(visitor);
+
+	// The lowest bit of a stack entry marks nodes whose children have already
+	// been pushed (post-order only).
+	struct ref_stack stack = {0};
+	if (!ref_stack_push(&stack, root << 1)) {
+		return false;
+	}
+
+	while (stack.count > 0) {
+		mcc_ast_flat_ref entry = ref_stack_pop(&stack);
+		mcc_ast_flat_ref ref = entry >> 1;
+		const struct mcc_ast_flat_expression *expr = &flat->expressions[ref];
+
+		if (entry & 1) {
+			if (visitor->expression) {
+				visitor->expression(flat, ref, visitor->userdata);
+			}
+			continue;
+		}
+
+		if (visitor->order == MCC_AST_VISIT_PRE_ORDER) {
+			if (visitor->expression) {
+				visitor->expression(flat, ref, visitor->userdata);
+			}
+		} else if (!ref_stack_push(&stack, (ref << 1) | 1)) {
+			free(stack.refs);
+			return false;
+		}
+
+		// Children are pushed last to first so that they are visited in order.
+		bool pushed = true;
+		switch (expr->type) {
+		case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+			break;
+
+		case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+			pushed = ref_stack_push(&stack, expr->b << 1);
+			break;
+
+		case MCC_AST_EXPRESSION_TYPE_CALL:
+			if (expr->b != MCC_AST_FLAT_NONE) {
+				const mcc_ast_flat_ref *arguments = &flat->arguments[expr->b + 1];
+				for (uint32_t i = flat->arguments[expr->b]; pushed && i-- > 0;) {
+					pushed = ref_stack_push(&stack, arguments[i] << 1);
+				}
+			}
+			break;
+
+		default:
+			pushed = (expr->b == MCC_AST_FLAT_NONE || ref_stack_push(&stack, expr->b << 1)) &&
+			         (expr->a == MCC_AST_FLAT_NONE || ref_stack_push(&stack, expr->a << 1));
+			break;
+		}
+		if (!pushed) {
+			free(stack.refs);
+			return false;
+		}
+	}
+
+	free(stack.refs);
+	return true;
+}
+
+void mcc_ast_flat_visit_all(const struct mcc_ast_flat *flat, struct mcc_ast_flat_visitor *visitor)
+{
+	assert(flat);
+	assert(visitor);
+
+	if (!visitor->expression) {
+		return;
+	}
+
+	for (mcc_ast_flat_ref ref = 0; ref < flat->expression_count; ++ref) {
+		visitor->expression(flat, ref, visitor->userdata);
+	}
+}
@@ -49,6 +49,8 @@ const char *mcc_ast_print_data_type(enum mcc_ast_data_type dt)
 			return "BOOL";
 		case MCC_AST_DATA_TYPE_FLOAT:
 			return "FLOAT";
+		case MCC_AST_DATA_TYPE_VOID:
+			return "VOID";
 	}
 
 	return "unknown data type";
@@ -69,6 +71,8 @@ const char *mcc_ast_print_statement(enum mcc_ast_statement_type stmt_type)
 			return "ASSGN_STMT";
 		case MCC_AST_STATEMENT_TYPE_COMPOUND:
 			return "COMPOUND_STMT";
+		case MCC_AST_STATEMENT_TYPE_RETURN:
+			return "RETURN_STMT";
 
 	}
 
@@ -138,15 +142,54 @@ static void print_dot_expression_binary_op(struct mcc_ast_expression *expression
 	print_dot_edge(out, expression, expression->rhs, "rhs");
 }
 
-static void print_dot_statement_if(struct mcc_ast_statement *statement, void *data)
+static void print_dot_expression_unary_op(struct mcc_ast_expression *expression, void *data)
 {
-	assert(statement);
+	assert(expression);
 	assert(data);
 
 	FILE *out = data;
-	print_dot_edge(out, statement, statement -> if_condition, "if_condition");
-	print_dot_edge(out, statement, statement -> if_stmt, "if_statement");
+	print_dot_node(out, expression, expression->up == MCC_AST_UNARY_OP_NOT ? "expr: !" : "expr: -");
+	print_dot_edge(out, expression, expression->rhs, "rhs");
+}
+
+// The visitor has no callback for identifier expressions alone, this one sees
+// every expression.
+static void print_dot_expression_identifier(struct mcc_ast_expression *expression, void *data)
+{
+	assert(expression);
+	assert(data);
 
+	if (expression->type != MCC_AST_EXPRESSION_TYPE_IDENTIFIER) {
+		return;
+	}
+
+	FILE *out = data;
+	print_dot_node(out, expression, "expr: id");
+	print_dot_edge(out, expression, expression->identifier, "identifier");
+}
+
+static void print_dot_expression_array_element(struct mcc_ast_expression *expression, void *data)
+{
+	assert(expression);
+	assert(data);
+
+	FILE *out = data;
+	print_dot_node(out, expression, "expr: [ ]");
+	print_dot_edge(out, expression, expression->array, "array");
+	print_dot_edge(out, expression, expression->index, "index");
+}
+
+static void print_dot_expression_call(struct mcc_ast_expression *expression, void *data)
+{
+	assert(expression);
+	assert(data);
+
+	FILE *out = data;
+	print_dot_node(out, expression, "expr: call");
+	print_dot_edge(out, expression, expression->function, "function");
+	for (struct mcc_ast_argument *argument = expression->arguments; argument; argument = argument->next) {
+		print_dot_edge(out, expression, argument->expression, "argument");
+	}
 }
 
 static void print_dot_expression_parenth(struct mcc_ast_expression *expression, void *data)
@@ -183,18 +226,136 @@ static void print_dot_literal_float(struct mcc_ast_literal *literal, void *data)
 	print_dot_node(out, literal, label);
 }
 
+static void print_dot_literal_string(struct mcc_ast_literal *literal, void *data)
+{
+	assert(literal);
+	assert(data);
+
+	// quotes and backslashes are escaped, the value is cut off if too long
+	char label[LABEL_SIZE] = {0};
+	size_t len = 0;
+	for (const char *c = literal->s_value; *c && len < sizeof(label) - 3; ++c) {
+		if (*c == '"' || *c == '\\') {
+			label[len++] = '\\';
+		}
+		label[len++] = *c;
+	}
+
+	FILE *out = data;
+	print_dot_node(out, literal, label);
+}
+
+static void print_dot_literal_bool(struct mcc_ast_literal *literal, void *data)
+{
+	assert(literal);
+	assert(data);
+
+	FILE *out = data;
+	print_dot_node(out, literal, literal->b_value ? "true" : "false");
+}
+
+static void print_dot_identifier(struct mcc_ast_identifier *identifier, void *data)
+{
+	assert(identifier);
+	assert(data);
+
+	FILE *out = data;
+	print_dot_node(out, identifier, identifier->i_value);
+}
+
 static void print_dot_declaration(struct mcc_ast_declaration *declaration, void *data)
 {
 	assert(declaration);
 	assert(data);
 
 	char label[LABEL_SIZE] = {0};
-	snprintf(label, sizeof(label), "%d", declaration->type);
+	snprintf(label, sizeof(label), "decl: %s", mcc_ast_print_data_type(declaration->type));
 
 	FILE *out = data;
 	print_dot_node(out, declaration, label);
-	print_dot_edge(out, declaration, &declaration -> type, "declaration type");
-	print_dot_edge(out, declaration, &declaration -> identifier -> i_value, "declaration ident");
+	if (declaration->array_size) {
+		print_dot_edge(out, declaration, declaration->array_size, "size");
+	}
+	print_dot_edge(out, declaration, declaration->identifier, "identifier");
+}
+
+static void print_dot_statement(struct mcc_ast_statement *statement, void *data)
+{
+	assert(statement);
+	assert(data);
+
+	FILE *out = data;
+	print_dot_node(out, statement, mcc_ast_print_statement(statement->type));
+
+	switch (statement->type) {
+		case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+			print_dot_edge(out, statement, statement->expression, "expression");
+			break;
+		case MCC_AST_STATEMENT_TYPE_IF:
+			print_dot_edge(out, statement, statement->if_condition, "condition");
+			print_dot_edge(out, statement, statement->if_stmt, "then");
+			if (statement->else_stmt) {
+				print_dot_edge(out, statement, statement->else_stmt, "else");
+			}
+			break;
+		case MCC_AST_STATEMENT_TYPE_WHILE:
+			print_dot_edge(out, statement, statement->while_condition, "condition");
+			print_dot_edge(out, statement, statement->while_stmt, "body");
+			break;
+		case MCC_AST_STATEMENT_TYPE_DECL:
+			print_dot_edge(out, statement, statement->declaration, "declaration");
+			break;
+		case MCC_AST_STATEMENT_TYPE_ASSGN:
+			print_dot_edge(out, statement, statement->id_assgn, "identifier");
+			if (statement->lhs_assgn) {
+				print_dot_edge(out, statement, statement->lhs_assgn, "index");
+			}
+			print_dot_edge(out, statement, statement->rhs_assgn, "value");
+			break;
+		case MCC_AST_STATEMENT_TYPE_COMPOUND:
+			for (struct mcc_ast_statement_list *list = statement->compound_statement; list;
+			     list = list->next) {
+				print_dot_edge(out, statement, list->statement, "statement");
+			}
+			break;
+		case MCC_AST_STATEMENT_TYPE_RETURN:
+			if (statement->return_value) {
+				print_dot_edge(out, statement, statement->return_value, "value");
+			}
+			break;
+	}
+}
+
+static void print_dot_function_def(struct mcc_ast_function_def *function_def, void *data)
+{
+	assert(function_def);
+	assert(data);
+
+	char label[LABEL_SIZE] = {0};
+	snprintf(label, sizeof(label), "function: %s", mcc_ast_print_data_type(function_def->type));
+
+	FILE *out = data;
+	print_dot_node(out, function_def, label);
+	print_dot_edge(out, function_def, function_def->identifier, "identifier");
+	for (struct mcc_ast_parameter *parameter = function_def->parameter; parameter; parameter = parameter->next) {
+		print_dot_edge(out, function_def, parameter->declaration, "parameter");
+	}
+	if (function_def->compund_statement) {
+		print_dot_edge(out, function_def, function_def->compund_statement, "body");
+	}
+}
+
+static void print_dot_program(struct mcc_ast_program *program, void *data)
+{
+	assert(program);
+	assert(data);
+
+	FILE *out = data;
+	print_dot_node(out, program, "program");
+	for (struct mcc_ast_function_def *function_def = program->function_def; function_def;
+	     function_def = function_def->next) {
+		print_dot_edge(out, program, function_def, "function");
+	}
 }
 
 // Setup an AST Visitor for printing.
@@ -208,14 +369,25 @@ static struct mcc_ast_visitor print_dot_visitor(FILE *out)
 
 	    .userdata = out,
 
+	    .expression = print_dot_expression_identifier,
 	    .expression_literal = print_dot_expression_literal,
 	    .expression_binary_op = print_dot_expression_binary_op,
+	    .expression_unary_op = print_dot_expression_unary_op,
 	    .expression_parenth = print_dot_expression_parenth,
+	    .expression_array_element = print_dot_expression_array_element,
+	    .expression_call = print_dot_expression_call,
+
+	    .statement = print_dot_statement,
 
 	    .literal_int = print_dot_literal_int,
 	    .literal_float = print_dot_literal_float,
+	    .literal_string = print_dot_literal_string,
+	    .literal_bool = print_dot_literal_bool,
 
-		.declaration = print_dot_declaration
+	    .declaration = print_dot_declaration,
+	    .identifier = print_dot_identifier,
+	    .function_def = print_dot_function_def,
+	    .program = print_dot_program,
 	};
 }
 
@@ -257,3 +429,42 @@ void mcc_ast_print_dot_declaration(FILE *out, struct mcc_ast_declaration *declar
 
 	print_dot_end(out);
 }
+
+void mcc_ast_print_dot_statement(FILE *out, struct mcc_ast_statement *statement)
+{
+	assert(out);
+	assert(statement);
+
+	print_dot_begin(out);
+
+	struct mcc_ast_visitor visitor = print_dot_visitor(out);
+	mcc_ast_visit(statement, &visitor);
+
+	print_dot_end(out);
+}
+
+void mcc_ast_print_dot_function_def(FILE *out, struct mcc_ast_function_def *function_def)
+{
+	assert(out);
+	assert(function_def);
+
+	print_dot_begin(out);
+
+	struct mcc_ast_visitor visitor = print_dot_visitor(out);
+	mcc_ast_visit(function_def, &visitor);
+
+	print_dot_end(out);
+}
+
+void mcc_ast_print_dot_program(FILE *out, struct mcc_ast_program *program)
+{
+	assert(out);
+	assert(program);
+
+	print_dot_begin(out);
+
+	struct mcc_ast_visitor visitor = print_dot_visitor(out);
+	mcc_ast_visit(program, &visitor);
+
+	print_dot_end(out);
+}
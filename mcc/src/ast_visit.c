@@ -1,134 +1,852 @@
 #include "mcc/ast_visit.h"
 
 #include <assert.h>
+#include <stdlib.h>
+
+#include "utils/reserve.h"
+
+// ------------------------------------------------------------------- Work List
+
+enum frame_kind {
+	FRAME_EXPRESSION,
+	FRAME_LITERAL,
+	FRAME_IDENTIFIER,
+	FRAME_DECLARATION,
+	FRAME_STATEMENT,
+	FRAME_FUNCTION_DEF,
+	FRAME_PROGRAM,
+
+	FRAME_KIND_COUNT,
+};
+
+// A pending node. `leave` frames are pushed below the children of a node
+// during post-order traversal and trigger its post-order callbacks once all
+// children are done.
+struct mcc_ast_visit_frame {
+	enum frame_kind kind;
+	bool leave;
+	union {
+		struct mcc_ast_expression *expression;
+		struct mcc_ast_literal *literal;
+		struct mcc_ast_identifier *identifier;
+		struct mcc_ast_declaration *declaration;
+		struct mcc_ast_statement *statement;
+		struct mcc_ast_function_def *function_def;
+		struct mcc_ast_program *program;
+	};
+};
+
+void mcc_ast_visit_stack_release(struct mcc_ast_visit_stack *stack)
+{
+	assert(stack);
 
-#define visit(node, callback, visitor) \
-	do { \
-		if (callback) { \
-			(callback)(node, (visitor)->userdata); \
-		} \
-	} while (0)
+	free(stack->frames);
+	stack->frames = NULL;
+	stack->count = 0;
+	stack->capacity = 0;
+}
 
-#define visit_if(cond, node, callback, visitor) \
-	do { \
-		if (cond) { \
-			visit(node, callback, visitor); \
-		} \
-	} while (0)
+static bool push(struct mcc_ast_visit_stack *stack, struct mcc_ast_visit_frame frame)
+{
+	if (!reserve_wide((void **)&stack->frames, &stack->capacity, stack->count, 1, sizeof(*stack->frames))) {
+		return false;
+	}
 
-#define visit_if_pre_order(node, callback, visitor) \
-	visit_if((visitor)->order == MCC_AST_VISIT_PRE_ORDER, node, callback, visitor)
+	stack->frames[stack->count++] = frame;
+	return true;
+}
 
-#define visit_if_post_order(node, callback, visitor) \
-	visit_if((visitor)->order == MCC_AST_VISIT_POST_ORDER, node, callback, visitor)
+static bool push_expression(struct mcc_ast_visit_stack *stack, struct mcc_ast_expression *expression)
+{
+	return push(stack, (struct mcc_ast_visit_frame){.kind = FRAME_EXPRESSION, .expression = expression});
+}
 
-void mcc_ast_visit_expression(struct mcc_ast_expression *expression, struct mcc_ast_visitor *visitor)
+static bool push_literal(struct mcc_ast_visit_stack *stack, struct mcc_ast_literal *literal)
 {
-	assert(expression);
-	assert(visitor);
+	return push(stack, (struct mcc_ast_visit_frame){.kind = FRAME_LITERAL, .literal = literal});
+}
 
-	visit_if_pre_order(expression, visitor->expression, visitor);
+static bool push_identifier(struct mcc_ast_visit_stack *stack, struct mcc_ast_identifier *identifier)
+{
+	return push(stack, (struct mcc_ast_visit_frame){.kind = FRAME_IDENTIFIER, .identifier = identifier});
+}
 
+static bool push_declaration(struct mcc_ast_visit_stack *stack, struct mcc_ast_declaration *declaration)
+{
+	return push(stack, (struct mcc_ast_visit_frame){.kind = FRAME_DECLARATION, .declaration = declaration});
+}
+
+static bool push_statement(struct mcc_ast_visit_stack *stack, struct mcc_ast_statement *statement)
+{
+	return push(stack, (struct mcc_ast_visit_frame){.kind = FRAME_STATEMENT, .statement = statement});
+}
+
+static bool push_function_def(struct mcc_ast_visit_stack *stack, struct mcc_ast_function_def *function_def)
+{
+	return push(stack, (struct mcc_ast_visit_frame){.kind = FRAME_FUNCTION_DEF, .function_def = function_def});
+}
+
+static bool push_expression_children(struct mcc_ast_visit_stack *stack, struct mcc_ast_expression *expression)
+{
 	switch (expression->type) {
-		case MCC_AST_EXPRESSION_TYPE_LITERAL:
-			visit_if_pre_order(expression, visitor->expression_literal, visitor);
-			mcc_ast_visit(expression->literal, visitor);
-			visit_if_post_order(expression, visitor->expression_literal, visitor);
-			break;
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		return push_literal(stack, expression->literal);
+
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		return push_expression(stack, expression->lhs) && push_expression(stack, expression->rhs);
+
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		return push_expression(stack, expression->rhs);
 
-		case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
-			visit_if_pre_order(expression, visitor->expression_binary_op, visitor);
-			mcc_ast_visit(expression->lhs, visitor);
-			mcc_ast_visit(expression->rhs, visitor);
-			visit_if_post_order(expression, visitor->expression_binary_op, visitor);
-			break;
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		return push_expression(stack, expression->expression);
 
-		case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
-			visit_if_pre_order(expression, visitor->expression_unary_op,visitor);
-			mcc_ast_visit(expression->rhs, visitor);
-			visit_if_post_order(expression, visitor->expression_unary_op, visitor);
-			break;
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+		return push_identifier(stack, expression->identifier);
 
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+		return push_identifier(stack, expression->array) && push_expression(stack, expression->index);
 
-		case MCC_AST_EXPRESSION_TYPE_PARENTH:
-			visit_if_pre_order(expression, visitor->expression_parenth, visitor);
-			mcc_ast_visit(expression->expression, visitor);
-			visit_if_post_order(expression, visitor->expression_parenth, visitor);
-			break;
+	case MCC_AST_EXPRESSION_TYPE_CALL:
+		if (!push_identifier(stack, expression->function)) {
+			return false;
+		}
+		for (struct mcc_ast_argument *arg = expression->arguments; arg; arg = arg->next) {
+			if (!push_expression(stack, arg->expression)) {
+				return false;
+			}
+		}
+		return true;
 
-		case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
-			visit_if_pre_order(expression, visitor->identifier, visitor);
-			mcc_ast_visit_identifier(expression->identifier, visitor);
-			visit_if_post_order(expression, visitor->identifier,
-								visitor);
-			break;
+	case MCC_AST_STATEMENT_TYPE_EXPR:
+		break;
 	}
 
+	return true;
+}
 
-	visit_if_post_order(expression, visitor->expression, visitor);
+static bool push_statement_children(struct mcc_ast_visit_stack *stack, struct mcc_ast_statement *statement)
+{
+	switch (statement->type) {
+	case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+		return push_expression(stack, statement->expression);
+
+	case MCC_AST_STATEMENT_TYPE_IF:
+		if (!push_expression(stack, statement->if_condition) || !push_statement(stack, statement->if_stmt)) {
+			return false;
+		}
+		return !statement->else_stmt || push_statement(stack, statement->else_stmt);
+
+	case MCC_AST_STATEMENT_TYPE_WHILE:
+		return push_expression(stack, statement->while_condition) &&
+		       push_statement(stack, statement->while_stmt);
+
+	case MCC_AST_STATEMENT_TYPE_DECL:
+		return push_declaration(stack, statement->declaration);
+
+	case MCC_AST_STATEMENT_TYPE_ASSGN:
+		if (!push_identifier(stack, statement->id_assgn)) {
+			return false;
+		}
+		if (statement->lhs_assgn && !push_expression(stack, statement->lhs_assgn)) {
+			return false;
+		}
+		return push_expression(stack, statement->rhs_assgn);
+
+	case MCC_AST_STATEMENT_TYPE_COMPOUND:
+		for (struct mcc_ast_statement_list *list = statement->compound_statement; list; list = list->next) {
+			if (!push_statement(stack, list->statement)) {
+				return false;
+			}
+		}
+		return true;
+
+	case MCC_AST_STATEMENT_TYPE_RETURN:
+		return !statement->return_value || push_expression(stack, statement->return_value);
+	}
+
+	return true;
 }
 
-void mcc_ast_visit_literal(struct mcc_ast_literal *literal, struct mcc_ast_visitor *visitor)
+static bool push_function_def_children(struct mcc_ast_visit_stack *stack, struct mcc_ast_function_def *function_def)
 {
-	assert(literal);
-	assert(visitor);
+	if (!push_identifier(stack, function_def->identifier)) {
+		return false;
+	}
+	for (struct mcc_ast_parameter *parameter = function_def->parameter; parameter; parameter = parameter->next) {
+		if (!push_declaration(stack, parameter->declaration)) {
+			return false;
+		}
+	}
+	return !function_def->compund_statement || push_statement(stack, function_def->compund_statement);
+}
 
-	visit_if_pre_order(literal, visitor->literal, visitor);
+// Pushes the children of the node of `frame`. Depth-first traversal pops
+// them, so they end up right to left when `reversed` is set; breadth-first
+// traversal dequeues them, so they stay left to right.
+static bool push_children(struct mcc_ast_visit_stack *stack, const struct mcc_ast_visit_frame *frame, bool reversed)
+{
+	size_t first = stack->count;
+	bool ok = true;
+
+	switch (frame->kind) {
+	case FRAME_EXPRESSION:
+		ok = push_expression_children(stack, frame->expression);
+		break;
+
+	case FRAME_LITERAL:
+	case FRAME_IDENTIFIER:
+	case FRAME_KIND_COUNT:
+		break;
+
+	case FRAME_DECLARATION:
+		if (frame->declaration->array_size) {
+			ok = push_literal(stack, frame->declaration->array_size);
+		}
+		ok = ok && push_identifier(stack, frame->declaration->identifier);
+		break;
+
+	case FRAME_STATEMENT:
+		ok = push_statement_children(stack, frame->statement);
+		break;
+
+	case FRAME_FUNCTION_DEF:
+		ok = push_function_def_children(stack, frame->function_def);
+		break;
+
+	case FRAME_PROGRAM:
+		for (struct mcc_ast_function_def *def = frame->program->function_def; ok && def; def = def->next) {
+			ok = push_function_def(stack, def);
+		}
+		break;
+	}
+
+	if (ok && reversed && stack->count > first) {
+		struct mcc_ast_visit_frame *frames = stack->frames;
+		for (size_t i = first, j = stack->count - 1; i < j; ++i, --j) {
+			struct mcc_ast_visit_frame tmp = frames[i];
+			frames[i] = frames[j];
+			frames[j] = tmp;
+		}
+	}
+	return ok;
+}
+
+// ------------------------------------------------------------------- Dispatch
+
+// One or more visitors are compiled into a table holding, for every callback
+// slot and phase, the callbacks to invoke. Visitors without a callback for a
+// slot do not appear in its list, so traversal only pays for callbacks that
+// are actually set.
+
+enum slot {
+	// grouped by node kind, see `dispatch_init`
+	SLOT_EXPRESSION,
+	SLOT_EXPRESSION_LITERAL,
+	SLOT_EXPRESSION_BINARY_OP,
+	SLOT_EXPRESSION_UNARY_OP,
+	SLOT_EXPRESSION_PARENTH,
+	SLOT_EXPRESSION_ARRAY_ELEMENT,
+	SLOT_EXPRESSION_CALL,
+
+	SLOT_STATEMENT,
+	SLOT_STATEMENT_EXPRESSION,
+	SLOT_STATEMENT_IF,
+	SLOT_STATEMENT_IF_ELSE,
+	SLOT_STATEMENT_WHILE,
+	SLOT_STATEMENT_DECLARATION,
+	SLOT_STATEMENT_ASSIGNMENT,
+	SLOT_STATEMENT_COMPOUND,
+	SLOT_STATEMENT_RETURN,
+
+	SLOT_LITERAL,
+	SLOT_LITERAL_INT,
+	SLOT_LITERAL_FLOAT,
+	SLOT_LITERAL_STRING,
+	SLOT_LITERAL_BOOL,
+
+	SLOT_IDENTIFIER,
+	SLOT_DECLARATION,
+	SLOT_FUNCTION_DEF,
+	SLOT_PROGRAM,
+
+	SLOT_COUNT,
+};
+
+// Pre-order callbacks run when a node is entered, post-order callbacks when it
+// is left.
+enum phase {
+	PHASE_ENTER,
+	PHASE_LEAVE,
+	PHASE_COUNT,
+};
+
+struct handler {
+	union {
+		mcc_ast_visit_expression_cb expression;
+		mcc_ast_visit_statement_cb statement;
+		mcc_ast_visit_literal_cb literal;
+		mcc_ast_visit_identifier_cb identifier;
+		mcc_ast_visit_declaration_cb declaration;
+		mcc_ast_visit_function_def_cb function_def;
+		mcc_ast_visit_program_cb program;
+	};
+	void *userdata;
+};
+
+struct dispatch {
+	// The handlers of `slot` in `phase` are found at
+	// [ranges[phase * SLOT_COUNT + slot], ranges[phase * SLOT_COUNT + slot + 1]).
+	struct handler *handlers;
+	size_t ranges[PHASE_COUNT * SLOT_COUNT + 1];
+
+	enum mcc_ast_visit_traversal traversal;
+
+	// Set for each kind of node having a callback in PHASE_LEAVE.
+	bool leave[FRAME_KIND_COUNT];
+};
+
+// Stores the callback of `visitor` for `slot` in `handler`, returns false if
+// there is none.
+static bool lookup(const struct mcc_ast_visitor *visitor, enum slot slot, struct handler *handler)
+{
+	handler->userdata = visitor->userdata;
+
+	switch (slot) {
+	case SLOT_EXPRESSION:
+		handler->expression = visitor->expression;
+		return handler->expression != NULL;
+	case SLOT_EXPRESSION_LITERAL:
+		handler->expression = visitor->expression_literal;
+		return handler->expression != NULL;
+	case SLOT_EXPRESSION_BINARY_OP:
+		handler->expression = visitor->expression_binary_op;
+		return handler->expression != NULL;
+	case SLOT_EXPRESSION_UNARY_OP:
+		handler->expression = visitor->expression_unary_op;
+		return handler->expression != NULL;
+	case SLOT_EXPRESSION_PARENTH:
+		handler->expression = visitor->expression_parenth;
+		return handler->expression != NULL;
+	case SLOT_EXPRESSION_ARRAY_ELEMENT:
+		handler->expression = visitor->expression_array_element;
+		return handler->expression != NULL;
+	case SLOT_EXPRESSION_CALL:
+		handler->expression = visitor->expression_call;
+		return handler->expression != NULL;
+	case SLOT_STATEMENT:
+		handler->statement = visitor->statement;
+		return handler->statement != NULL;
+	case SLOT_STATEMENT_EXPRESSION:
+		handler->statement = visitor->statement_expression;
+		return handler->statement != NULL;
+	case SLOT_STATEMENT_IF:
+		handler->statement = visitor->statement_if;
+		return handler->statement != NULL;
+	case SLOT_STATEMENT_IF_ELSE:
+		handler->statement = visitor->statement_if_else;
+		return handler->statement != NULL;
+	case SLOT_STATEMENT_WHILE:
+		handler->statement = visitor->statement_while;
+		return handler->statement != NULL;
+	case SLOT_STATEMENT_DECLARATION:
+		handler->statement = visitor->statement_declaration;
+		return handler->statement != NULL;
+	case SLOT_STATEMENT_ASSIGNMENT:
+		handler->statement = visitor->statement_assignment;
+		return handler->statement != NULL;
+	case SLOT_STATEMENT_COMPOUND:
+		handler->statement = visitor->statement_compound;
+		return handler->statement != NULL;
+	case SLOT_STATEMENT_RETURN:
+		handler->statement = visitor->statement_return;
+		return handler->statement != NULL;
+	case SLOT_LITERAL:
+		handler->literal = visitor->literal;
+		return handler->literal != NULL;
+	case SLOT_LITERAL_INT:
+		handler->literal = visitor->literal_int;
+		return handler->literal != NULL;
+	case SLOT_LITERAL_FLOAT:
+		handler->literal = visitor->literal_float;
+		return handler->literal != NULL;
+	case SLOT_LITERAL_STRING:
+		handler->literal = visitor->literal_string;
+		return handler->literal != NULL;
+	case SLOT_LITERAL_BOOL:
+		handler->literal = visitor->literal_bool;
+		return handler->literal != NULL;
+	case SLOT_IDENTIFIER:
+		handler->identifier = visitor->identifier;
+		return handler->identifier != NULL;
+	case SLOT_DECLARATION:
+		handler->declaration = visitor->declaration;
+		return handler->declaration != NULL;
+	case SLOT_FUNCTION_DEF:
+		handler->function_def = visitor->function_def;
+		return handler->function_def != NULL;
+	case SLOT_PROGRAM:
+		handler->program = visitor->program;
+		return handler->program != NULL;
+	case SLOT_COUNT:
+		break;
+	}
+	return false;
+}
+
+static enum phase phase_of(const struct mcc_ast_visitor *visitor, enum slot slot)
+{
+	switch (slot) {
+	// leaves, invoked once regardless of the order
+	case SLOT_LITERAL_INT:
+	case SLOT_LITERAL_FLOAT:
+	case SLOT_LITERAL_STRING:
+	case SLOT_LITERAL_BOOL:
+	case SLOT_IDENTIFIER:
+		return PHASE_ENTER;
+	default:
+		break;
+	}
+
+	if (visitor->traversal == MCC_AST_VISIT_DEPTH_FIRST && visitor->order == MCC_AST_VISIT_POST_ORDER) {
+		return PHASE_LEAVE;
+	}
+	return PHASE_ENTER;
+}
+
+// Returns true if any slot in [first, end) has a callback in PHASE_LEAVE.
+static bool has_leave(const struct dispatch *dispatch, enum slot first, enum slot end)
+{
+	return dispatch->ranges[PHASE_LEAVE * SLOT_COUNT + first] < dispatch->ranges[PHASE_LEAVE * SLOT_COUNT + end];
+}
+
+// `handlers` must have room for `count * SLOT_COUNT` entries.
+static void dispatch_init(struct dispatch *dispatch,
+                          struct handler *handlers,
+                          struct mcc_ast_visitor *const *visitors,
+                          size_t count)
+{
+	assert(count > 0);
+
+	size_t n = 0;
+	for (int phase = 0; phase < PHASE_COUNT; ++phase) {
+		for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+			dispatch->ranges[phase * SLOT_COUNT + slot] = n;
+			for (size_t i = 0; i < count; ++i) {
+				if (phase_of(visitors[i], slot) == (enum phase)phase && lookup(visitors[i], slot, &handlers[n])) {
+					++n;
+				}
+			}
+		}
+	}
+	dispatch->ranges[PHASE_COUNT * SLOT_COUNT] = n;
+
+	dispatch->handlers = handlers;
+	dispatch->traversal = visitors[0]->traversal;
+
+	// literals and identifiers are left right after being entered
+	dispatch->leave[FRAME_EXPRESSION] = has_leave(dispatch, SLOT_EXPRESSION, SLOT_STATEMENT);
+	dispatch->leave[FRAME_STATEMENT] = has_leave(dispatch, SLOT_STATEMENT, SLOT_LITERAL);
+	dispatch->leave[FRAME_LITERAL] = false;
+	dispatch->leave[FRAME_IDENTIFIER] = false;
+	dispatch->leave[FRAME_DECLARATION] = has_leave(dispatch, SLOT_DECLARATION, SLOT_FUNCTION_DEF);
+	dispatch->leave[FRAME_FUNCTION_DEF] = has_leave(dispatch, SLOT_FUNCTION_DEF, SLOT_PROGRAM);
+	dispatch->leave[FRAME_PROGRAM] = has_leave(dispatch, SLOT_PROGRAM, SLOT_COUNT);
+}
+
+#define dispatch_each(dispatch, phase, slot, member, node) \
+	do { \
+		size_t range_ = (phase)*SLOT_COUNT + (slot); \
+		for (size_t i_ = (dispatch)->ranges[range_]; i_ < (dispatch)->ranges[range_ + 1]; ++i_) { \
+			(dispatch)->handlers[i_].member(node, (dispatch)->handlers[i_].userdata); \
+		} \
+	} while (0)
+
+static enum slot expression_slot(const struct mcc_ast_expression *expression)
+{
+	switch (expression->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		return SLOT_EXPRESSION_LITERAL;
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		return SLOT_EXPRESSION_BINARY_OP;
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		return SLOT_EXPRESSION_UNARY_OP;
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		return SLOT_EXPRESSION_PARENTH;
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+		return SLOT_EXPRESSION_ARRAY_ELEMENT;
+	case MCC_AST_EXPRESSION_TYPE_CALL:
+		return SLOT_EXPRESSION_CALL;
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+	case MCC_AST_STATEMENT_TYPE_EXPR:
+		break;
+	}
+	return SLOT_COUNT;
+}
+
+static enum slot statement_slot(const struct mcc_ast_statement *statement)
+{
+	switch (statement->type) {
+	case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+		return SLOT_STATEMENT_EXPRESSION;
+	case MCC_AST_STATEMENT_TYPE_IF:
+		return statement->else_stmt ? SLOT_STATEMENT_IF_ELSE : SLOT_STATEMENT_IF;
+	case MCC_AST_STATEMENT_TYPE_WHILE:
+		return SLOT_STATEMENT_WHILE;
+	case MCC_AST_STATEMENT_TYPE_DECL:
+		return SLOT_STATEMENT_DECLARATION;
+	case MCC_AST_STATEMENT_TYPE_ASSGN:
+		return SLOT_STATEMENT_ASSIGNMENT;
+	case MCC_AST_STATEMENT_TYPE_COMPOUND:
+		return SLOT_STATEMENT_COMPOUND;
+	case MCC_AST_STATEMENT_TYPE_RETURN:
+		return SLOT_STATEMENT_RETURN;
+	}
+	return SLOT_COUNT;
+}
+
+static void visit_literal(const struct dispatch *dispatch, struct mcc_ast_literal *literal)
+{
+	dispatch_each(dispatch, PHASE_ENTER, SLOT_LITERAL, literal, literal);
 
 	switch (literal->type) {
-		case MCC_AST_LITERAL_TYPE_INT:
-			visit(literal, visitor->literal_int, visitor);
-			break;
+	case MCC_AST_LITERAL_TYPE_INT:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_LITERAL_INT, literal, literal);
+		break;
+	case MCC_AST_LITERAL_TYPE_FLOAT:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_LITERAL_FLOAT, literal, literal);
+		break;
+	case MCC_AST_LITERAL_TYPE_STRING:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_LITERAL_STRING, literal, literal);
+		break;
+	case MCC_AST_LITERAL_TYPE_BOOL:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_LITERAL_BOOL, literal, literal);
+		break;
+	}
 
-		case MCC_AST_LITERAL_TYPE_FLOAT:
-			visit(literal, visitor->literal_float, visitor);
-			break;
+	dispatch_each(dispatch, PHASE_LEAVE, SLOT_LITERAL, literal, literal);
+}
 
-		case MCC_AST_LITERAL_TYPE_STRING:
-			visit(literal, visitor->literal_string,visitor);
-			break;
+static void visit_identifier(const struct dispatch *dispatch, struct mcc_ast_identifier *identifier)
+{
+	dispatch_each(dispatch, PHASE_ENTER, SLOT_IDENTIFIER, identifier, identifier);
+}
 
-		case MCC_AST_LITERAL_TYPE_BOOL:
-			visit(literal, visitor->literal_bool,visitor);
+// Runs the pre-order callbacks of the node of `frame`. Literals and
+// identifiers are visited completely.
+static void enter(const struct dispatch *dispatch, const struct mcc_ast_visit_frame *frame)
+{
+	enum slot slot;
+
+	switch (frame->kind) {
+	case FRAME_EXPRESSION:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_EXPRESSION, expression, frame->expression);
+		slot = expression_slot(frame->expression);
+		if (slot != SLOT_COUNT) {
+			dispatch_each(dispatch, PHASE_ENTER, slot, expression, frame->expression);
+		}
+		break;
+	case FRAME_STATEMENT:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_STATEMENT, statement, frame->statement);
+		slot = statement_slot(frame->statement);
+		if (slot != SLOT_COUNT) {
+			dispatch_each(dispatch, PHASE_ENTER, slot, statement, frame->statement);
+		}
+		break;
+	case FRAME_LITERAL:
+		visit_literal(dispatch, frame->literal);
+		break;
+	case FRAME_IDENTIFIER:
+		visit_identifier(dispatch, frame->identifier);
+		break;
+	case FRAME_DECLARATION:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_DECLARATION, declaration, frame->declaration);
+		break;
+	case FRAME_FUNCTION_DEF:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_FUNCTION_DEF, function_def, frame->function_def);
+		break;
+	case FRAME_PROGRAM:
+		dispatch_each(dispatch, PHASE_ENTER, SLOT_PROGRAM, program, frame->program);
+		break;
+	case FRAME_KIND_COUNT:
+		break;
 	}
+}
 
-	visit_if_post_order(literal, visitor->literal, visitor);
+// Runs the post-order callbacks of the node of `frame`.
+static void leave(const struct dispatch *dispatch, const struct mcc_ast_visit_frame *frame)
+{
+	enum slot slot;
+
+	switch (frame->kind) {
+	case FRAME_EXPRESSION:
+		slot = expression_slot(frame->expression);
+		if (slot != SLOT_COUNT) {
+			dispatch_each(dispatch, PHASE_LEAVE, slot, expression, frame->expression);
+		}
+		dispatch_each(dispatch, PHASE_LEAVE, SLOT_EXPRESSION, expression, frame->expression);
+		break;
+	case FRAME_STATEMENT:
+		slot = statement_slot(frame->statement);
+		if (slot != SLOT_COUNT) {
+			dispatch_each(dispatch, PHASE_LEAVE, slot, statement, frame->statement);
+		}
+		dispatch_each(dispatch, PHASE_LEAVE, SLOT_STATEMENT, statement, frame->statement);
+		break;
+	case FRAME_DECLARATION:
+		dispatch_each(dispatch, PHASE_LEAVE, SLOT_DECLARATION, declaration, frame->declaration);
+		break;
+	case FRAME_FUNCTION_DEF:
+		dispatch_each(dispatch, PHASE_LEAVE, SLOT_FUNCTION_DEF, function_def, frame->function_def);
+		break;
+	case FRAME_PROGRAM:
+		dispatch_each(dispatch, PHASE_LEAVE, SLOT_PROGRAM, program, frame->program);
+		break;
+	case FRAME_LITERAL:
+	case FRAME_IDENTIFIER:
+	case FRAME_KIND_COUNT:
+		break;
+	}
 }
 
-void mcc_ast_visit_declaration(struct mcc_ast_declaration *declaration, struct mcc_ast_visitor *visitor)
+// ------------------------------------------------------------------- Traversal
+
+// Both traversals only touch the part of the work list above `base`, so a
+// callback may run a nested traversal on the same list.
+
+static bool depth_first(struct mcc_ast_visit_stack *stack, size_t base, const struct dispatch *dispatch)
+{
+	while (stack->count > base) {
+		struct mcc_ast_visit_frame frame = stack->frames[--stack->count];
+
+		if (frame.leave) {
+			leave(dispatch, &frame);
+			continue;
+		}
+
+		enter(dispatch, &frame);
+
+		if (dispatch->leave[frame.kind]) {
+			struct mcc_ast_visit_frame left = frame;
+			left.leave = true;
+			if (!push(stack, left)) {
+				return false;
+			}
+		}
+
+		if (!push_children(stack, &frame, true)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static bool breadth_first(struct mcc_ast_visit_stack *stack, size_t base, const struct dispatch *dispatch)
+{
+	size_t head = base;
+
+	while (head < stack->count) {
+		// Reclaim the consumed front of the queue before it forces a reallocation.
+		if (stack->count == stack->capacity && head > base) {
+			size_t pending = stack->count - head;
+			for (size_t i = 0; i < pending; ++i) {
+				stack->frames[base + i] = stack->frames[head + i];
+			}
+			stack->count = base + pending;
+			head = base;
+		}
+
+		struct mcc_ast_visit_frame frame = stack->frames[head++];
+
+		enter(dispatch, &frame);
+		if (!push_children(stack, &frame, false)) {
+			return false;
+		}
+	}
+
+	stack->count = base;
+	return true;
+}
+
+static bool traverse(struct mcc_ast_visit_frame root,
+                     const struct dispatch *dispatch,
+                     struct mcc_ast_visit_stack *shared)
+{
+	struct mcc_ast_visit_stack local = {0};
+	struct mcc_ast_visit_stack *stack = shared ? shared : &local;
+	size_t base = stack->count;
+
+	bool ok = push(stack, root);
+	if (ok) {
+		if (dispatch->traversal == MCC_AST_VISIT_BREADTH_FIRST) {
+			ok = breadth_first(stack, base, dispatch);
+		} else {
+			ok = depth_first(stack, base, dispatch);
+		}
+	}
+
+	// Leave the shared list as we found it, also after a failure.
+	stack->count = base;
+	if (stack == &local) {
+		mcc_ast_visit_stack_release(&local);
+	}
+	return ok;
+}
+
+// ------------------------------------------------------------------- Entry Points
+
+static bool visit(struct mcc_ast_visit_frame root, struct mcc_ast_visitor *visitor)
 {
-	assert(declaration);
 	assert(visitor);
 
-	visit_if_pre_order(declaration, visitor->declaration, visitor);
+	struct handler handlers[SLOT_COUNT];
+	struct dispatch dispatch;
+	dispatch_init(&dispatch, handlers, &visitor, 1);
 
-	mcc_ast_visit_identifier(declaration -> identifier, visitor);
+	return traverse(root, &dispatch, visitor->stack);
+}
 
+bool mcc_ast_visit_expression(struct mcc_ast_expression *expression, struct mcc_ast_visitor *visitor)
+{
+	assert(expression);
+	return visit((struct mcc_ast_visit_frame){.kind = FRAME_EXPRESSION, .expression = expression}, visitor);
+}
 
-	visit_if_post_order(declaration, visitor->declaration, visitor);
+bool mcc_ast_visit_literal(struct mcc_ast_literal *literal, struct mcc_ast_visitor *visitor)
+{
+	assert(literal);
+	assert(visitor);
+
+	struct handler handlers[SLOT_COUNT];
+	struct dispatch dispatch;
+	dispatch_init(&dispatch, handlers, &visitor, 1);
+
+	visit_literal(&dispatch, literal);
+	return true;
+}
+
+bool mcc_ast_visit_declaration(struct mcc_ast_declaration *declaration, struct mcc_ast_visitor *visitor)
+{
+	assert(declaration);
+	return visit((struct mcc_ast_visit_frame){.kind = FRAME_DECLARATION, .declaration = declaration}, visitor);
 }
 
-void mcc_ast_visit_identifier(struct mcc_ast_identifier *identifier, struct mcc_ast_visitor *visitor)
+bool mcc_ast_visit_identifier(struct mcc_ast_identifier *identifier, struct mcc_ast_visitor *visitor)
 {
 	assert(identifier);
 	assert(visitor);
 
-	visit(identifier, visitor -> identifier, visitor);
+	struct handler handler;
+	if (lookup(visitor, SLOT_IDENTIFIER, &handler)) {
+		handler.identifier(identifier, handler.userdata);
+	}
+	return true;
 }
-/*void mcc_ast_visit_parameters(struct mcc_ast_parameters *parameters, struct mcc_ast_visitor *visitor){
 
-	assert(parameters);
-	assert(visitor);
+bool mcc_ast_visit_statement(struct mcc_ast_statement *statement, struct mcc_ast_visitor *visitor)
+{
+	assert(statement);
+	return visit((struct mcc_ast_visit_frame){.kind = FRAME_STATEMENT, .statement = statement}, visitor);
+}
+
+bool mcc_ast_visit_function_def(struct mcc_ast_function_def *function_def, struct mcc_ast_visitor *visitor)
+{
+	assert(function_def);
+	return visit((struct mcc_ast_visit_frame){.kind = FRAME_FUNCTION_DEF, .function_def = function_def}, visitor);
+}
+
+bool mcc_ast_visit_program(struct mcc_ast_program *program, struct mcc_ast_visitor *visitor)
+{
+	assert(program);
+	return visit((struct mcc_ast_visit_frame){.kind = FRAME_PROGRAM, .program = program}, visitor);
+}
+
+// ------------------------------------------------------------------- Fused Traversal
+
+static struct handler *fused_dispatch(struct dispatch *dispatch, struct mcc_ast_visitor *const *visitors, size_t count)
+{
+	assert(visitors);
+	assert(count > 0);
+
+	for (size_t i = 0; i < count; ++i) {
+		assert(visitors[i]);
+		assert(visitors[i]->traversal == visitors[0]->traversal);
+	}
+
+	struct handler *handlers = malloc(count * SLOT_COUNT * sizeof(*handlers));
+	if (handlers) {
+		dispatch_init(dispatch, handlers, visitors, count);
+	}
+	return handlers;
+}
+
+static bool visit_fused(struct mcc_ast_visit_frame root, struct mcc_ast_visitor *const *visitors, size_t count)
+{
+	struct dispatch dispatch;
+	struct handler *handlers = fused_dispatch(&dispatch, visitors, count);
+	if (!handlers) {
+		return false;
+	}
 
+	bool ok = traverse(root, &dispatch, visitors[0]->stack);
+	free(handlers);
+	return ok;
+}
 
+bool mcc_ast_visit_expression_fused(struct mcc_ast_expression *expression,
+                                    struct mcc_ast_visitor *const *visitors,
+                                    size_t count)
+{
+	assert(expression);
+	return visit_fused((struct mcc_ast_visit_frame){.kind = FRAME_EXPRESSION, .expression = expression}, visitors,
+	                   count);
+}
 
-	visit_if_pre_order(parameters, visitor ->parameters, visitor);
-	mcc_ast_visit_parameters(parameters,visitor);
-	visit_if_post_order(parameters, visitor ->parameters , visitor);
+bool mcc_ast_visit_literal_fused(struct mcc_ast_literal *literal, struct mcc_ast_visitor *const *visitors, size_t count)
+{
+	assert(literal);
 
+	struct dispatch dispatch;
+	struct handler *handlers = fused_dispatch(&dispatch, visitors, count);
+	if (!handlers) {
+		return false;
+	}
 
-}*/
+	visit_literal(&dispatch, literal);
+	free(handlers);
+	return true;
+}
 
+bool mcc_ast_visit_declaration_fused(struct mcc_ast_declaration *declaration,
+                                     struct mcc_ast_visitor *const *visitors,
+                                     size_t count)
+{
+	assert(declaration);
+	return visit_fused((struct mcc_ast_visit_frame){.kind = FRAME_DECLARATION, .declaration = declaration},
+	                   visitors, count);
+}
 
+bool mcc_ast_visit_statement_fused(struct mcc_ast_statement *statement,
+                                   struct mcc_ast_visitor *const *visitors,
+                                   size_t count)
+{
+	assert(statement);
+	return visit_fused((struct mcc_ast_visit_frame){.kind = FRAME_STATEMENT, .statement = statement}, visitors,
+	                   count);
+}
 
+bool mcc_ast_visit_function_def_fused(struct mcc_ast_function_def *function_def,
+                                      struct mcc_ast_visitor *const *visitors,
+                                      size_t count)
+{
+	assert(function_def);
+	return visit_fused((struct mcc_ast_visit_frame){.kind = FRAME_FUNCTION_DEF, .function_def = function_def},
+	                   visitors, count);
+}
 
+bool mcc_ast_visit_program_fused(struct mcc_ast_program *program, struct mcc_ast_visitor *const *visitors, size_t count)
+{
+	assert(program);
+	return visit_fused((struct mcc_ast_visit_frame){.kind = FRAME_PROGRAM, .program = program}, visitors, count);
+}
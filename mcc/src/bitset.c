@@ -0,0 +1,154 @@
+#include "mcc/bitset.h"
+
+#include <assert.h>
+#include <string.h>
+
+// Index of the lowest set bit of the non-zero `word`.
+static uint32_t lowest_bit(mcc_bitset_word word)
+{
+	assert(word);
+
+#if defined(__GNUC__)
+	return (uint32_t)__builtin_ctzll(word);
+#else
+	uint32_t bit = 0;
+	while (!(word & 1)) {
+		word >>= 1;
+		++bit;
+	}
+	return bit;
+#endif
+}
+
+static uint32_t popcount(mcc_bitset_word word)
+{
+#if defined(__GNUC__)
+	return (uint32_t)__builtin_popcountll(word);
+#else
+	uint32_t count = 0;
+	for (; word; word &= word - 1) {
+		++count;
+	}
+	return count;
+#endif
+}
+
+void mcc_bitset_clear_all(mcc_bitset_word *set, uint32_t words)
+{
+	assert(set || words == 0);
+
+	if (words) {
+		memset(set, 0, words * sizeof(*set));
+	}
+}
+
+void mcc_bitset_fill(mcc_bitset_word *set, uint32_t bits)
+{
+	assert(set || bits == 0);
+
+	uint32_t full = bits / MCC_BITSET_WORD_BITS;
+	for (uint32_t i = 0; i < full; ++i) {
+		set[i] = ~(mcc_bitset_word)0;
+	}
+	if (bits % MCC_BITSET_WORD_BITS) {
+		set[full] = MCC_BITSET_MASK(bits) - 1;
+	}
+}
+
+void mcc_bitset_copy(mcc_bitset_word *dst, const mcc_bitset_word *src, uint32_t words)
+{
+	assert((dst && src) || words == 0);
+
+	if (words && dst != src) {
+		memcpy(dst, src, words * sizeof(*dst));
+	}
+}
+
+bool mcc_bitset_equal(const mcc_bitset_word *a, const mcc_bitset_word *b, uint32_t words)
+{
+	assert((a && b) || words == 0);
+
+	for (uint32_t i = 0; i < words; ++i) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void mcc_bitset_union(mcc_bitset_word *dst, const mcc_bitset_word *src, uint32_t words)
+{
+	assert((dst && src) || words == 0);
+
+	for (uint32_t i = 0; i < words; ++i) {
+		dst[i] |= src[i];
+	}
+}
+
+void mcc_bitset_intersect(mcc_bitset_word *dst, const mcc_bitset_word *src, uint32_t words)
+{
+	assert((dst && src) || words == 0);
+
+	for (uint32_t i = 0; i < words; ++i) {
+		dst[i] &= src[i];
+	}
+}
+
+void mcc_bitset_difference(mcc_bitset_word *dst, const mcc_bitset_word *src, uint32_t words)
+{
+	assert((dst && src) || words == 0);
+
+	for (uint32_t i = 0; i < words; ++i) {
+		dst[i] &= ~src[i];
+	}
+}
+
+bool mcc_bitset_transfer(mcc_bitset_word *dst,
+                         const mcc_bitset_word *gen,
+                         const mcc_bitset_word *src,
+                         const mcc_bitset_word *kill,
+                         uint32_t words)
+{
+	assert((dst && gen && src && kill) || words == 0);
+	assert((dst != gen && dst != kill) || words == 0);
+
+	// accumulate the differences instead of branching on every word
+	mcc_bitset_word changed = 0;
+	for (uint32_t i = 0; i < words; ++i) {
+		mcc_bitset_word word = gen[i] | (src[i] & ~kill[i]);
+		changed |= word ^ dst[i];
+		dst[i] = word;
+	}
+	return changed != 0;
+}
+
+uint32_t mcc_bitset_count(const mcc_bitset_word *set, uint32_t words)
+{
+	assert(set || words == 0);
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < words; ++i) {
+		count += popcount(set[i]);
+	}
+	return count;
+}
+
+uint32_t mcc_bitset_next(const mcc_bitset_word *set, uint32_t words, uint32_t from)
+{
+	assert(set || words == 0);
+
+	uint32_t i = from / MCC_BITSET_WORD_BITS;
+	if (i >= words) {
+		return MCC_BITSET_END;
+	}
+
+	// mask the bits below `from` in the first word
+	mcc_bitset_word word = set[i] & ~(MCC_BITSET_MASK(from) - 1);
+	while (!word) {
+		if (++i == words) {
+			return MCC_BITSET_END;
+		}
+		word = set[i];
+	}
+	return i * MCC_BITSET_WORD_BITS + lowest_bit(word);
+}
@@ -0,0 +1,906 @@
+#include "mcc/bytecode.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/reserve.h"
+
+// -------------------------------------------------------------------- Opcodes
+
+// Opcodes and their operand words: d is a register written, a and b are
+// registers read. Suffixes denote the type, I and F for int and float, I4 and
+// F4 for vectors; ints include bools.
+#define OPCODES(X) \
+	X(MOVE)          /* d a */ \
+	X(MOVE4)         /* d a */ \
+	X(ADD_I)         /* d a b */ \
+	X(SUB_I)         /* d a b */ \
+	X(MUL_I)         /* d a b */ \
+	X(DIV_I)         /* d a b */ \
+	X(ADD_F)         /* d a b */ \
+	X(SUB_F)         /* d a b */ \
+	X(MUL_F)         /* d a b */ \
+	X(DIV_F)         /* d a b */ \
+	X(ADD_I4)        /* d a b */ \
+	X(SUB_I4)        /* d a b */ \
+	X(ADD_F4)        /* d a b */ \
+	X(SUB_F4)        /* d a b */ \
+	X(MUL_F4)        /* d a b */ \
+	X(DIV_F4)        /* d a b */ \
+	X(NEG_I)         /* d a */ \
+	X(NEG_F)         /* d a */ \
+	X(EQ_I)          /* d a b */ \
+	X(NE_I)          /* d a b */ \
+	X(LT_I)          /* d a b */ \
+	X(GT_I)          /* d a b */ \
+	X(LE_I)          /* d a b */ \
+	X(GE_I)          /* d a b */ \
+	X(EQ_F)          /* d a b */ \
+	X(NE_F)          /* d a b */ \
+	X(LT_F)          /* d a b */ \
+	X(GT_F)          /* d a b */ \
+	X(LE_F)          /* d a b */ \
+	X(GE_F)          /* d a b */ \
+	X(AND)           /* d a b */ \
+	X(OR)            /* d a b */ \
+	X(NOT)           /* d a */ \
+	X(ARRAY)         /* d slot, the frame index of the first element */ \
+	X(LOAD)          /* d address index */ \
+	X(STORE)         /* address index value */ \
+	X(SPLAT)         /* d a */ \
+	X(VLOAD)         /* d address index */ \
+	X(VSTORE)        /* address index value */ \
+	X(JUMP)          /* target */ \
+	X(JUMP_IF_FALSE) /* a target */ \
+	X(JUMP_IF_TRUE)  /* a target */ \
+	X(CALL)          /* d function count, followed by count argument registers */ \
+	X(RETURN)        /* a */ \
+	X(RETURN_VOID)   /* */ \
+	X(PRINT)         /* a */ \
+	X(PRINT_NL)      /* */ \
+	X(PRINT_INT)     /* a */ \
+	X(PRINT_FLOAT)   /* a */ \
+	X(READ_INT)      /* d */ \
+	X(READ_FLOAT)    /* d */
+
+#define OPCODE_ENUM(name) OP_##name,
+
+enum opcode { OPCODES(OPCODE_ENUM) };
+
+// Built-in functions are instructions, see resources/mc_builtins.c.
+static const struct {
+	const char *name;
+	enum opcode opcode;
+} builtins[] = {
+    {"print", OP_PRINT},
+    {"print_nl", OP_PRINT_NL},
+    {"print_int", OP_PRINT_INT},
+    {"print_float", OP_PRINT_FLOAT},
+    {"read_int", OP_READ_INT},
+    {"read_float", OP_READ_FLOAT},
+};
+
+// ------------------------------------------------------------------ Compiler
+
+// A code word to be patched with the offset of a label.
+struct fixup {
+	uint32_t offset;
+	uint32_t label;
+};
+
+struct compiler {
+	struct mcc_bytecode *bytecode;
+	const struct mcc_ir_module *module;
+	const struct mcc_ir_function *function;
+	struct mcc_bytecode_function *target;
+
+	// decoded string of each module constant, NULL until used
+	const char **strings;
+
+	// frame slot of each module constant used by the current function,
+	// UINT32_MAX for others
+	uint32_t *constant_slots;
+
+	// per function: slot of each register and array, offset of each label
+	uint32_t *slots;
+	uint32_t *array_slots;
+	uint32_t *label_offsets;
+
+	// frame slot receiving the results of calls which are not used
+	uint32_t discard_slot;
+
+	struct fixup *fixups;
+	uint32_t fixup_count;
+	uint32_t fixup_capacity;
+
+	// arguments of the next call
+	mcc_ir_operand *arguments;
+	uint32_t argument_count;
+	uint32_t argument_capacity;
+
+	bool failed;
+};
+
+static void emit_words(struct compiler *c, const uint32_t *words, uint32_t count)
+{
+	struct mcc_bytecode *bytecode = c->bytecode;
+	if (c->failed || !reserve((void **)&bytecode->code, &bytecode->code_capacity, bytecode->code_size, count,
+	                          sizeof(*bytecode->code))) {
+		c->failed = true;
+		return;
+	}
+	memcpy(&bytecode->code[bytecode->code_size], words, count * sizeof(*words));
+	bytecode->code_size += count;
+}
+
+#define EMIT(c, ...) \
+	emit_words(c, (const uint32_t[]){__VA_ARGS__}, sizeof((const uint32_t[]){__VA_ARGS__}) / sizeof(uint32_t))
+
+static const char *decode_string(struct compiler *c, uint32_t index)
+{
+	if (!c->strings[index]) {
+		const char *string = c->module->constants[index].s_value;
+		char *decoded = mcc_arena_alloc(&c->bytecode->strings, strlen(string) + 1);
+		if (!decoded) {
+			c->failed = true;
+			return "";
+		}
+		mcc_ir_decode_string(decoded, string);
+		c->strings[index] = decoded;
+	}
+	return c->strings[index];
+}
+
+// Returns the frame slot of `operand`, adding constants to the frame.
+static uint32_t slot_of(struct compiler *c, mcc_ir_operand operand)
+{
+	if (MCC_IR_IS_VREG(operand)) {
+		return c->slots[MCC_IR_OPERAND_INDEX(operand)];
+	}
+	if (operand == MCC_IR_NONE) {
+		return c->discard_slot;
+	}
+	assert(MCC_IR_OPERAND_KIND(operand) == MCC_IR_OPERAND_CONST);
+
+	uint32_t index = MCC_IR_OPERAND_INDEX(operand);
+	if (c->constant_slots[index] != UINT32_MAX) {
+		return c->constant_slots[index];
+	}
+
+	struct mcc_bytecode *bytecode = c->bytecode;
+	if (!reserve((void **)&bytecode->constants, &bytecode->constant_capacity, bytecode->constant_count, 1,
+	             sizeof(*bytecode->constants))) {
+		c->failed = true;
+		return 0;
+	}
+
+	const struct mcc_ir_constant *constant = &c->module->constants[index];
+	union mcc_bytecode_value value = {0};
+	switch (constant->type) {
+	case MCC_IR_TYPE_FLOAT:
+		value.f = (float)constant->f_value;
+		break;
+	case MCC_IR_TYPE_BOOL:
+		value.i = constant->b_value;
+		break;
+	case MCC_IR_TYPE_STRING:
+		value.s = decode_string(c, index);
+		break;
+	default:
+		value.i = (int32_t)constant->i_value;
+	}
+	bytecode->constants[bytecode->constant_count++] = value;
+
+	c->constant_slots[index] = c->target->frame_size++;
+	++c->target->constant_count;
+	return c->constant_slots[index];
+}
+
+static void emit_jump(struct compiler *c, enum opcode opcode, mcc_ir_operand condition, mcc_ir_operand label)
+{
+	if (opcode == OP_JUMP) {
+		EMIT(c, opcode, 0);
+	} else {
+		EMIT(c, opcode, slot_of(c, condition), 0);
+	}
+	if (c->failed || !reserve((void **)&c->fixups, &c->fixup_capacity, c->fixup_count, 1, sizeof(*c->fixups))) {
+		c->failed = true;
+		return;
+	}
+	c->fixups[c->fixup_count++] = (struct fixup){c->bytecode->code_size - 1, MCC_IR_OPERAND_INDEX(label)};
+}
+
+static void emit_call(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	uint32_t index = MCC_IR_OPERAND_INDEX(instruction->a);
+	const struct mcc_ir_function *callee = &c->module->functions[index];
+
+	if (!callee->builtin) {
+		EMIT(c, OP_CALL, slot_of(c, instruction->dest), index, c->argument_count);
+		for (uint32_t i = 0; i < c->argument_count; ++i) {
+			EMIT(c, slot_of(c, c->arguments[i]));
+		}
+		c->argument_count = 0;
+		return;
+	}
+
+	for (uint32_t b = 0; b < sizeof(builtins) / sizeof(*builtins); ++b) {
+		if (strcmp(builtins[b].name, callee->name) != 0) {
+			continue;
+		}
+		if (c->argument_count) {
+			EMIT(c, builtins[b].opcode, slot_of(c, c->arguments[0]));
+		} else if (callee->return_type != MCC_IR_TYPE_VOID) {
+			EMIT(c, builtins[b].opcode, slot_of(c, instruction->dest));
+		} else {
+			EMIT(c, builtins[b].opcode);
+		}
+		c->argument_count = 0;
+		return;
+	}
+	c->bytecode->undefined_symbol = callee->name;
+}
+
+static void emit_instruction(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	// offset of the opcode for the type, int, float, int vector or float
+	// vector, in order
+	uint32_t type = 0;
+	switch ((enum mcc_ir_type)instruction->type) {
+	case MCC_IR_TYPE_FLOAT:
+		type = 1;
+		break;
+	case MCC_IR_TYPE_INT4:
+		type = 2;
+		break;
+	case MCC_IR_TYPE_FLOAT4:
+		type = 3;
+		break;
+	default:
+		break;
+	}
+
+	enum mcc_ir_opcode opcode = instruction->opcode;
+	switch (opcode) {
+	case MCC_IR_NOP:
+	case MCC_IR_PHI:
+		// phis are gone after destruction of the SSA form
+		assert(opcode == MCC_IR_NOP);
+		break;
+	case MCC_IR_COPY:
+		EMIT(c, type >= 2 ? OP_MOVE4 : OP_MOVE, slot_of(c, instruction->dest), slot_of(c, instruction->a));
+		break;
+	case MCC_IR_ADD:
+	case MCC_IR_SUB:
+	case MCC_IR_MUL:
+	case MCC_IR_DIV: {
+		static const enum opcode opcodes[][4] = {
+		    {OP_ADD_I, OP_ADD_F, OP_ADD_I4, OP_ADD_F4},
+		    {OP_SUB_I, OP_SUB_F, OP_SUB_I4, OP_SUB_F4},
+		    {OP_MUL_I, OP_MUL_F, OP_MUL_I, OP_MUL_F4},
+		    {OP_DIV_I, OP_DIV_F, OP_DIV_I, OP_DIV_F4},
+		};
+		// int vectors are only added and subtracted
+		assert(type != 2 || opcode == MCC_IR_ADD || opcode == MCC_IR_SUB);
+		EMIT(c, opcodes[opcode - MCC_IR_ADD][type], slot_of(c, instruction->dest), slot_of(c, instruction->a),
+		     slot_of(c, instruction->b));
+		break;
+	}
+	case MCC_IR_NEG:
+		EMIT(c, type == 1 ? OP_NEG_F : OP_NEG_I, slot_of(c, instruction->dest), slot_of(c, instruction->a));
+		break;
+	case MCC_IR_EQ:
+	case MCC_IR_NE:
+	case MCC_IR_LT:
+	case MCC_IR_GT:
+	case MCC_IR_LE:
+	case MCC_IR_GE: {
+		enum opcode base = type == 1 ? OP_EQ_F : OP_EQ_I;
+		EMIT(c, base + (opcode - MCC_IR_EQ), slot_of(c, instruction->dest), slot_of(c, instruction->a),
+		     slot_of(c, instruction->b));
+		break;
+	}
+	case MCC_IR_AND:
+	case MCC_IR_OR:
+		EMIT(c, opcode == MCC_IR_AND ? OP_AND : OP_OR, slot_of(c, instruction->dest),
+		     slot_of(c, instruction->a), slot_of(c, instruction->b));
+		break;
+	case MCC_IR_NOT:
+		EMIT(c, OP_NOT, slot_of(c, instruction->dest), slot_of(c, instruction->a));
+		break;
+	case MCC_IR_ARRAY:
+		EMIT(c, OP_ARRAY, slot_of(c, instruction->dest), c->array_slots[MCC_IR_OPERAND_INDEX(instruction->a)]);
+		break;
+	case MCC_IR_LOAD:
+	case MCC_IR_VLOAD:
+		EMIT(c, opcode == MCC_IR_LOAD ? OP_LOAD : OP_VLOAD, slot_of(c, instruction->dest),
+		     slot_of(c, instruction->a), slot_of(c, instruction->b));
+		break;
+	case MCC_IR_STORE:
+	case MCC_IR_VSTORE:
+		EMIT(c, opcode == MCC_IR_STORE ? OP_STORE : OP_VSTORE, slot_of(c, instruction->dest),
+		     slot_of(c, instruction->a), slot_of(c, instruction->b));
+		break;
+	case MCC_IR_SPLAT:
+		EMIT(c, OP_SPLAT, slot_of(c, instruction->dest), slot_of(c, instruction->a));
+		break;
+	case MCC_IR_LABEL:
+		c->label_offsets[MCC_IR_OPERAND_INDEX(instruction->a)] = c->bytecode->code_size;
+		break;
+	case MCC_IR_JUMP:
+		emit_jump(c, OP_JUMP, MCC_IR_NONE, instruction->a);
+		break;
+	case MCC_IR_JUMP_IF_FALSE:
+	case MCC_IR_JUMP_IF_TRUE:
+		emit_jump(c, opcode == MCC_IR_JUMP_IF_FALSE ? OP_JUMP_IF_FALSE : OP_JUMP_IF_TRUE, instruction->a,
+		          instruction->b);
+		break;
+	case MCC_IR_ARG:
+		if (!reserve((void **)&c->arguments, &c->argument_capacity, c->argument_count, 1,
+		             sizeof(*c->arguments))) {
+			c->failed = true;
+			break;
+		}
+		c->arguments[c->argument_count++] = instruction->a;
+		break;
+	case MCC_IR_CALL:
+		emit_call(c, instruction);
+		break;
+	case MCC_IR_RETURN:
+		if (instruction->a == MCC_IR_NONE) {
+			EMIT(c, OP_RETURN_VOID);
+		} else {
+			EMIT(c, OP_RETURN, slot_of(c, instruction->a));
+		}
+		break;
+	}
+}
+
+// Lays out the frame of the registers and arrays; constants are appended while
+// translating the instructions.
+static bool layout_frame(struct compiler *c)
+{
+	const struct mcc_ir_function *function = c->function;
+	struct mcc_bytecode_function *target = c->target;
+
+	c->slots = malloc((function->vreg_count + 1) * sizeof(*c->slots));
+	c->array_slots = malloc((function->array_count + 1) * sizeof(*c->array_slots));
+	c->label_offsets = malloc((function->label_count + 1) * sizeof(*c->label_offsets));
+	if (!c->slots || !c->array_slots || !c->label_offsets) {
+		return false;
+	}
+
+	uint64_t size = 0;
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		enum mcc_ir_type type = function->vreg_types[v];
+		c->slots[v] = (uint32_t)size;
+		size += type == MCC_IR_TYPE_INT4 || type == MCC_IR_TYPE_FLOAT4 ? MCC_IR_VECTOR_LANES : 1;
+	}
+	c->discard_slot = (uint32_t)size++;
+
+	target->array_slot = (uint32_t)size;
+	for (uint32_t a = 0; a < function->array_count; ++a) {
+		c->array_slots[a] = (uint32_t)size;
+		size += function->arrays[a].size;
+	}
+	target->array_values = (uint32_t)(size - target->array_slot);
+
+	// constants follow, leaving room for those of every instruction; frames
+	// too large for the stack only fail when entered
+	if (size + (uint64_t)function->instruction_count * MCC_IR_MAX_USES > UINT32_MAX / 2) {
+		return false;
+	}
+	target->frame_size = (uint32_t)size;
+	target->constant_slot = target->frame_size;
+	target->constant_first = c->bytecode->constant_count;
+	return true;
+}
+
+static void compile_function(struct compiler *c)
+{
+	const struct mcc_ir_function *function = c->function;
+	struct mcc_bytecode_function *target = c->target;
+	target->entry = c->bytecode->code_size;
+	target->parameter_count = function->parameter_count;
+
+	if (!layout_frame(c)) {
+		c->failed = true;
+	}
+
+	for (uint32_t i = 0; !c->failed && !c->bytecode->undefined_symbol && i < function->instruction_count; ++i) {
+		emit_instruction(c, &function->instructions[i]);
+	}
+
+	// void functions may end without a return
+	EMIT(c, OP_RETURN_VOID);
+
+	for (uint32_t f = 0; !c->failed && f < c->fixup_count; ++f) {
+		c->bytecode->code[c->fixups[f].offset] = c->label_offsets[c->fixups[f].label];
+	}
+	c->fixup_count = 0;
+
+	// forget the constants for the next function
+	for (uint32_t k = 0; k < c->module->constant_count; ++k) {
+		c->constant_slots[k] = UINT32_MAX;
+	}
+
+	free(c->slots);
+	free(c->array_slots);
+	free(c->label_offsets);
+	c->slots = NULL;
+	c->array_slots = NULL;
+	c->label_offsets = NULL;
+}
+
+enum mcc_bytecode_status mcc_bytecode_compile(struct mcc_bytecode *bytecode, const struct mcc_ir_module *module)
+{
+	assert(bytecode);
+	assert(module);
+
+	*bytecode = (struct mcc_bytecode){0};
+	mcc_arena_init(&bytecode->strings);
+
+	struct compiler c = {
+	    .bytecode = bytecode,
+	    .module = module,
+	    .strings = calloc(module->constant_count + 1, sizeof(*c.strings)),
+	    .constant_slots = malloc((module->constant_count + 1) * sizeof(*c.constant_slots)),
+	};
+	bytecode->functions = calloc(module->function_count + 1, sizeof(*bytecode->functions));
+	bytecode->function_count = module->function_count;
+	c.failed = !c.strings || !c.constant_slots || !bytecode->functions;
+
+	for (uint32_t k = 0; !c.failed && k < module->constant_count; ++k) {
+		c.constant_slots[k] = UINT32_MAX;
+	}
+	for (uint32_t i = 0; !c.failed && !bytecode->undefined_symbol && i < module->function_count; ++i) {
+		c.function = &module->functions[i];
+		c.target = &bytecode->functions[i];
+		c.target->entry = UINT32_MAX;
+		if (!c.function->builtin) {
+			compile_function(&c);
+		}
+	}
+
+	free(c.strings);
+	free(c.constant_slots);
+	free(c.fixups);
+	free(c.arguments);
+
+	if (c.failed) {
+		mcc_bytecode_release(bytecode);
+		return MCC_BYTECODE_NO_MEMORY;
+	}
+	if (bytecode->undefined_symbol) {
+		const char *undefined_symbol = bytecode->undefined_symbol;
+		mcc_bytecode_release(bytecode);
+		bytecode->undefined_symbol = undefined_symbol;
+		return MCC_BYTECODE_UNDEFINED_SYMBOL;
+	}
+	return MCC_BYTECODE_OK;
+}
+
+// --------------------------------------------------------------- Interpreter
+
+// Saved state of a caller.
+struct call {
+	const uint32_t *return_pc;
+	uint32_t base;
+	uint32_t frame_size;
+
+	// register receiving the result
+	uint32_t dest;
+};
+
+struct machine {
+	const struct mcc_bytecode *bytecode;
+
+	union mcc_bytecode_value *stack;
+	uint32_t stack_capacity;
+
+	struct call *calls;
+	uint32_t call_count;
+	uint32_t call_capacity;
+};
+
+// Sets up the frame of `function` at `base` of the stack, except for its
+// parameters.
+static enum mcc_bytecode_status enter(struct machine *m, const struct mcc_bytecode_function *function, uint32_t base)
+{
+	if (function->frame_size > MCC_BYTECODE_STACK_LIMIT - base) {
+		return MCC_BYTECODE_STACK_OVERFLOW;
+	}
+	uint32_t top = base + function->frame_size;
+	if (top > m->stack_capacity &&
+	    !reserve((void **)&m->stack, &m->stack_capacity, 0, top, sizeof(*m->stack))) {
+		return MCC_BYTECODE_NO_MEMORY;
+	}
+
+	union mcc_bytecode_value *frame = m->stack + base;
+	memset(frame + function->array_slot, 0, function->array_values * sizeof(*frame));
+	memcpy(frame + function->constant_slot, m->bytecode->constants + function->constant_first,
+	       function->constant_count * sizeof(*frame));
+	return MCC_BYTECODE_OK;
+}
+
+// Dispatch jumps to the handler of the next opcode directly where labels are
+// values, otherwise it goes through a switch.
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define OPCODE_LABEL(name) &&op_##name,
+#define DISPATCH_TABLE static const void *const dispatch_table[] = {OPCODES(OPCODE_LABEL)};
+#define DISPATCH_START DISPATCH()
+#define DISPATCH_LOOP
+#define DISPATCH_END
+#define CASE(name) op_##name:
+#define DISPATCH() \
+	++executed; \
+	goto *dispatch_table[*pc]
+#else
+#define DISPATCH_TABLE
+#define DISPATCH_START ++executed
+#define DISPATCH_LOOP \
+	for (;;) { \
+		switch ((enum opcode)*pc) {
+#define DISPATCH_END \
+	} \
+	}
+#define CASE(name) case OP_##name:
+#define DISPATCH() \
+	++executed; \
+	continue
+#endif
+
+// Advances past the current instruction of `size` words.
+#define NEXT(size) \
+	pc += (size); \
+	DISPATCH()
+
+#define R(n) r[pc[n]]
+
+#define WRAP(x) ((int32_t)(uint32_t)(x))
+
+#define INT_BINARY(name, op) \
+	CASE(name) \
+	R(1).i = WRAP((uint32_t)R(2).i op (uint32_t)R(3).i); \
+	NEXT(4);
+
+#define FLOAT_BINARY(name, op) \
+	CASE(name) \
+	R(1).f = R(2).f op R(3).f; \
+	NEXT(4);
+
+#define INT_VECTOR_BINARY(name, op) \
+	CASE(name) \
+	for (uint32_t lane = 0; lane < MCC_IR_VECTOR_LANES; ++lane) { \
+		r[pc[1] + lane].i = WRAP((uint32_t)r[pc[2] + lane].i op (uint32_t)r[pc[3] + lane].i); \
+	} \
+	NEXT(4);
+
+#define FLOAT_VECTOR_BINARY(name, op) \
+	CASE(name) \
+	for (uint32_t lane = 0; lane < MCC_IR_VECTOR_LANES; ++lane) { \
+		r[pc[1] + lane].f = r[pc[2] + lane].f op r[pc[3] + lane].f; \
+	} \
+	NEXT(4);
+
+#define COMPARISON(name, field, op) \
+	CASE(name) \
+	R(1).i = R(2).field op R(3).field; \
+	NEXT(4);
+
+// Interprets from the entry of `function`, whose frame is set up at the bottom
+// of the stack.
+static enum mcc_bytecode_status interpret(struct machine *m,
+                                          const struct mcc_bytecode_function *function,
+                                          FILE *in,
+                                          FILE *out,
+                                          struct mcc_bytecode_result *result)
+{
+	DISPATCH_TABLE
+
+	const struct mcc_bytecode *bytecode = m->bytecode;
+	const uint32_t *pc = bytecode->code + function->entry;
+	uint32_t base = 0;
+	uint32_t frame_size = function->frame_size;
+	union mcc_bytecode_value *r = m->stack;
+	uint64_t executed = 0;
+	enum mcc_bytecode_status status = MCC_BYTECODE_OK;
+	union mcc_bytecode_value value;
+
+	DISPATCH_START;
+
+	DISPATCH_LOOP
+
+	CASE(MOVE)
+	R(1) = R(2);
+	NEXT(3);
+
+	CASE(MOVE4)
+	memmove(&R(1), &R(2), MCC_IR_VECTOR_LANES * sizeof(*r));
+	NEXT(3);
+
+	INT_BINARY(ADD_I, +)
+	INT_BINARY(SUB_I, -)
+	INT_BINARY(MUL_I, *)
+
+	CASE(DIV_I)
+	if (R(3).i == 0 || (R(2).i == INT32_MIN && R(3).i == -1)) {
+		status = MCC_BYTECODE_DIVISION_ERROR;
+		goto done;
+	}
+	R(1).i = R(2).i / R(3).i;
+	NEXT(4);
+
+	FLOAT_BINARY(ADD_F, +)
+	FLOAT_BINARY(SUB_F, -)
+	FLOAT_BINARY(MUL_F, *)
+	FLOAT_BINARY(DIV_F, /)
+
+	INT_VECTOR_BINARY(ADD_I4, +)
+	INT_VECTOR_BINARY(SUB_I4, -)
+
+	FLOAT_VECTOR_BINARY(ADD_F4, +)
+	FLOAT_VECTOR_BINARY(SUB_F4, -)
+	FLOAT_VECTOR_BINARY(MUL_F4, *)
+	FLOAT_VECTOR_BINARY(DIV_F4, /)
+
+	CASE(NEG_I)
+	R(1).i = WRAP(-(uint32_t)R(2).i);
+	NEXT(3);
+
+	CASE(NEG_F)
+	R(1).f = -R(2).f;
+	NEXT(3);
+
+	COMPARISON(EQ_I, i, ==)
+	COMPARISON(NE_I, i, !=)
+	COMPARISON(LT_I, i, <)
+	COMPARISON(GT_I, i, >)
+	COMPARISON(LE_I, i, <=)
+	COMPARISON(GE_I, i, >=)
+
+	// unordered operands, NaNs, compare false except for `ne`, like in C
+	COMPARISON(EQ_F, f, ==)
+	COMPARISON(NE_F, f, !=)
+	COMPARISON(LT_F, f, <)
+	COMPARISON(GT_F, f, >)
+	COMPARISON(LE_F, f, <=)
+	COMPARISON(GE_F, f, >=)
+
+	CASE(AND)
+	R(1).i = R(2).i & R(3).i;
+	NEXT(4);
+
+	CASE(OR)
+	R(1).i = R(2).i | R(3).i;
+	NEXT(4);
+
+	CASE(NOT)
+	R(1).i = !R(2).i;
+	NEXT(3);
+
+	CASE(ARRAY)
+	R(1).address = base + pc[2];
+	NEXT(3);
+
+	// elements are only accessed below the top of the stack, as the program
+	// is not checked for out-of-bounds indices
+	CASE(LOAD)
+	{
+		uint32_t element = R(2).address + (uint32_t)R(3).i;
+		if (element >= base + frame_size) {
+			status = MCC_BYTECODE_OUT_OF_BOUNDS;
+			goto done;
+		}
+		R(1) = m->stack[element];
+		NEXT(4);
+	}
+
+	CASE(STORE)
+	{
+		uint32_t element = R(1).address + (uint32_t)R(2).i;
+		if (element >= base + frame_size) {
+			status = MCC_BYTECODE_OUT_OF_BOUNDS;
+			goto done;
+		}
+		m->stack[element] = R(3);
+		NEXT(4);
+	}
+
+	CASE(SPLAT)
+	value = R(2);
+	for (uint32_t lane = 0; lane < MCC_IR_VECTOR_LANES; ++lane) {
+		r[pc[1] + lane] = value;
+	}
+	NEXT(3);
+
+	CASE(VLOAD)
+	{
+		uint32_t element = R(2).address + (uint32_t)R(3).i;
+		if (element > base + frame_size - MCC_IR_VECTOR_LANES) {
+			status = MCC_BYTECODE_OUT_OF_BOUNDS;
+			goto done;
+		}
+		memcpy(&R(1), &m->stack[element], MCC_IR_VECTOR_LANES * sizeof(*r));
+		NEXT(4);
+	}
+
+	CASE(VSTORE)
+	{
+		uint32_t element = R(1).address + (uint32_t)R(2).i;
+		if (element > base + frame_size - MCC_IR_VECTOR_LANES) {
+			status = MCC_BYTECODE_OUT_OF_BOUNDS;
+			goto done;
+		}
+		memcpy(&m->stack[element], &R(3), MCC_IR_VECTOR_LANES * sizeof(*r));
+		NEXT(4);
+	}
+
+	CASE(JUMP)
+	pc = bytecode->code + pc[1];
+	DISPATCH();
+
+	CASE(JUMP_IF_FALSE)
+	pc = R(1).i ? pc + 3 : bytecode->code + pc[2];
+	DISPATCH();
+
+	CASE(JUMP_IF_TRUE)
+	pc = R(1).i ? bytecode->code + pc[2] : pc + 3;
+	DISPATCH();
+
+	CASE(CALL)
+	{
+		const struct mcc_bytecode_function *callee = &bytecode->functions[pc[2]];
+		uint32_t count = pc[3];
+		uint32_t callee_base = base + frame_size;
+
+		if (!reserve((void **)&m->calls, &m->call_capacity, m->call_count, 1, sizeof(*m->calls))) {
+			status = MCC_BYTECODE_NO_MEMORY;
+			goto done;
+		}
+		status = enter(m, callee, callee_base);
+		if (status != MCC_BYTECODE_OK) {
+			goto done;
+		}
+
+		// the stack may have moved
+		r = m->stack + base;
+		union mcc_bytecode_value *callee_r = m->stack + callee_base;
+		for (uint32_t i = 0; i < count; ++i) {
+			callee_r[i] = R(4 + i);
+		}
+
+		m->calls[m->call_count++] = (struct call){pc + 4 + count, base, frame_size, pc[1]};
+		base = callee_base;
+		frame_size = callee->frame_size;
+		r = callee_r;
+		pc = bytecode->code + callee->entry;
+		DISPATCH();
+	}
+
+	CASE(RETURN)
+	value = R(1);
+	if (m->call_count == 0) {
+		result->value = value.i;
+		goto done;
+	}
+	{
+		const struct call *call = &m->calls[--m->call_count];
+		base = call->base;
+		frame_size = call->frame_size;
+		r = m->stack + base;
+		r[call->dest] = value;
+		pc = call->return_pc;
+		DISPATCH();
+	}
+
+	CASE(RETURN_VOID)
+	if (m->call_count == 0) {
+		goto done;
+	}
+	{
+		const struct call *call = &m->calls[--m->call_count];
+		base = call->base;
+		frame_size = call->frame_size;
+		r = m->stack + base;
+		pc = call->return_pc;
+		DISPATCH();
+	}
+
+	CASE(PRINT)
+	fprintf(out, "%s", R(1).s);
+	NEXT(2);
+
+	CASE(PRINT_NL)
+	fprintf(out, "\n");
+	NEXT(1);
+
+	CASE(PRINT_INT)
+	fprintf(out, "%ld", (long)R(1).i);
+	NEXT(2);
+
+	CASE(PRINT_FLOAT)
+	fprintf(out, "%.2f", (double)R(1).f);
+	NEXT(2);
+
+	CASE(READ_INT)
+	{
+		long number = 0;
+		if (fscanf(in, "%ld", &number) != 1) {
+			number = 0;
+		}
+		R(1).i = WRAP(number);
+		NEXT(2);
+	}
+
+	CASE(READ_FLOAT)
+	{
+		float number = 0.0f;
+		if (fscanf(in, "%f", &number) != 1) {
+			number = 0.0f;
+		}
+		R(1).f = number;
+		NEXT(2);
+	}
+
+	DISPATCH_END
+
+done:
+	result->instructions = executed;
+	return status;
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+enum mcc_bytecode_status mcc_bytecode_call(const struct mcc_bytecode *bytecode,
+                                           const struct mcc_ir_module *module,
+                                           const char *name,
+                                           FILE *in,
+                                           FILE *out,
+                                           struct mcc_bytecode_result *result)
+{
+	assert(bytecode);
+	assert(module);
+	assert(name);
+	assert(in);
+	assert(out);
+	assert(result);
+
+	*result = (struct mcc_bytecode_result){0};
+
+	uint32_t index = mcc_ir_find_function(module, name);
+	if (index == MCC_IR_OPERAND_MAX || index >= bytecode->function_count ||
+	    bytecode->functions[index].entry == UINT32_MAX) {
+		return MCC_BYTECODE_NO_FUNCTION;
+	}
+	const struct mcc_ir_function *function = &module->functions[index];
+	if (function->parameter_count != 0 || function->return_type == MCC_IR_TYPE_FLOAT) {
+		return MCC_BYTECODE_NO_FUNCTION;
+	}
+
+	struct machine m = {.bytecode = bytecode};
+	enum mcc_bytecode_status status = enter(&m, &bytecode->functions[index], 0);
+	if (status == MCC_BYTECODE_OK) {
+		status = interpret(&m, &bytecode->functions[index], in, out, result);
+	}
+
+	free(m.stack);
+	free(m.calls);
+	return status;
+}
+
+void mcc_bytecode_release(struct mcc_bytecode *bytecode)
+{
+	assert(bytecode);
+
+	free(bytecode->code);
+	free(bytecode->functions);
+	free(bytecode->constants);
+	mcc_arena_release(&bytecode->strings);
+	*bytecode = (struct mcc_bytecode){0};
+}
@@ -0,0 +1,227 @@
+#include "mcc/cfg.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+static bool is_jump(enum mcc_ir_opcode opcode)
+{
+	return opcode == MCC_IR_JUMP || opcode == MCC_IR_JUMP_IF_FALSE || opcode == MCC_IR_JUMP_IF_TRUE;
+}
+
+// Whether instruction `index` starts a block.
+static bool is_leader(const struct mcc_ir_function *function, uint32_t index)
+{
+	if (index == 0 || function->instructions[index].opcode == MCC_IR_LABEL) {
+		return true;
+	}
+
+	enum mcc_ir_opcode previous = function->instructions[index - 1].opcode;
+	return is_jump(previous) || previous == MCC_IR_RETURN;
+}
+
+static bool find_blocks(struct mcc_cfg *cfg)
+{
+	const struct mcc_ir_function *function = cfg->function;
+
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		count += is_leader(function, i);
+	}
+
+	cfg->blocks = malloc(count * sizeof(*cfg->blocks));
+	cfg->label_blocks = malloc(function->label_count * sizeof(*cfg->label_blocks));
+	if ((count && !cfg->blocks) || (function->label_count && !cfg->label_blocks)) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		if (is_leader(function, i)) {
+			if (cfg->block_count) {
+				cfg->blocks[cfg->block_count - 1].end = i;
+			}
+			cfg->blocks[cfg->block_count++] = (struct mcc_cfg_block){
+			    .first = i,
+			    .end = function->instruction_count,
+			    .rpo_index = MCC_CFG_UNREACHABLE,
+			};
+		}
+		if (instruction->opcode == MCC_IR_LABEL) {
+			assert(MCC_IR_OPERAND_INDEX(instruction->a) < function->label_count);
+			cfg->label_blocks[MCC_IR_OPERAND_INDEX(instruction->a)] = cfg->block_count - 1;
+		}
+	}
+	return true;
+}
+
+static void add_successor(struct mcc_cfg_block *block, uint32_t successor)
+{
+	if (block->successor_count == 0 || block->successors[0] != successor) {
+		block->successors[block->successor_count++] = successor;
+	}
+}
+
+static void link_blocks(struct mcc_cfg *cfg)
+{
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		struct mcc_cfg_block *block = &cfg->blocks[b];
+		const struct mcc_ir_instruction *last = &cfg->function->instructions[block->end - 1];
+
+		switch (last->opcode) {
+		case MCC_IR_RETURN:
+			break;
+
+		case MCC_IR_JUMP:
+			add_successor(block, cfg->label_blocks[MCC_IR_OPERAND_INDEX(last->a)]);
+			break;
+
+		case MCC_IR_JUMP_IF_FALSE:
+		case MCC_IR_JUMP_IF_TRUE:
+			if (b + 1 < cfg->block_count) {
+				add_successor(block, b + 1);
+			}
+			add_successor(block, cfg->label_blocks[MCC_IR_OPERAND_INDEX(last->b)]);
+			break;
+
+		default:
+			if (b + 1 < cfg->block_count) {
+				add_successor(block, b + 1);
+			}
+		}
+	}
+}
+
+// Groups the predecessors by block, a counting sort over the edges.
+static bool collect_predecessors(struct mcc_cfg *cfg)
+{
+	uint32_t edge_count = 0;
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		const struct mcc_cfg_block *block = &cfg->blocks[b];
+		for (uint32_t s = 0; s < block->successor_count; ++s) {
+			++cfg->blocks[block->successors[s]].predecessor_count;
+		}
+		edge_count += block->successor_count;
+	}
+
+	cfg->predecessors = malloc(edge_count * sizeof(*cfg->predecessors));
+	if (edge_count && !cfg->predecessors) {
+		return false;
+	}
+
+	uint32_t first = 0;
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		cfg->blocks[b].predecessor_first = first;
+		first += cfg->blocks[b].predecessor_count;
+		cfg->blocks[b].predecessor_count = 0;
+	}
+
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		const struct mcc_cfg_block *block = &cfg->blocks[b];
+		for (uint32_t s = 0; s < block->successor_count; ++s) {
+			struct mcc_cfg_block *successor = &cfg->blocks[block->successors[s]];
+			cfg->predecessors[successor->predecessor_first + successor->predecessor_count++] = b;
+		}
+	}
+	return true;
+}
+
+// Depth-first search from the entry with an explicit stack, which holds each
+// block together with the number of its successors visited so far.
+static bool order_blocks(struct mcc_cfg *cfg)
+{
+	if (cfg->block_count == 0) {
+		return true;
+	}
+
+	uint32_t *stack = malloc(cfg->block_count * 2 * sizeof(*stack));
+	cfg->rpo = malloc(cfg->block_count * sizeof(*cfg->rpo));
+	if (!stack || !cfg->rpo) {
+		free(stack);
+		return false;
+	}
+
+	// blocks on the stack or finished are marked with a provisional index
+	uint32_t depth = 0;
+	uint32_t postorder_count = 0;
+	stack[depth++] = 0;
+	stack[depth++] = 0;
+	cfg->blocks[0].rpo_index = 0;
+
+	while (depth) {
+		uint32_t b = stack[depth - 2];
+		uint32_t next = stack[depth - 1];
+		const struct mcc_cfg_block *block = &cfg->blocks[b];
+
+		if (next == block->successor_count) {
+			cfg->rpo[postorder_count++] = b;
+			depth -= 2;
+			continue;
+		}
+
+		stack[depth - 1] = next + 1;
+		uint32_t successor = block->successors[next];
+		if (cfg->blocks[successor].rpo_index == MCC_CFG_UNREACHABLE) {
+			cfg->blocks[successor].rpo_index = 0;
+			stack[depth++] = successor;
+			stack[depth++] = 0;
+		}
+	}
+	free(stack);
+
+	// reverse the postorder in place
+	for (uint32_t i = 0, j = postorder_count - 1; i < j; ++i, --j) {
+		uint32_t tmp = cfg->rpo[i];
+		cfg->rpo[i] = cfg->rpo[j];
+		cfg->rpo[j] = tmp;
+	}
+	for (uint32_t i = 0; i < postorder_count; ++i) {
+		cfg->blocks[cfg->rpo[i]].rpo_index = i;
+	}
+	cfg->rpo_count = postorder_count;
+	return true;
+}
+
+bool mcc_cfg_build(struct mcc_cfg *cfg, const struct mcc_ir_function *function)
+{
+	assert(cfg);
+	assert(function);
+
+	*cfg = (struct mcc_cfg){.function = function};
+
+	if (!find_blocks(cfg)) {
+		return false;
+	}
+	link_blocks(cfg);
+	return collect_predecessors(cfg) && order_blocks(cfg);
+}
+
+void mcc_cfg_release(struct mcc_cfg *cfg)
+{
+	assert(cfg);
+
+	free(cfg->blocks);
+	free(cfg->predecessors);
+	free(cfg->label_blocks);
+	free(cfg->rpo);
+	*cfg = (struct mcc_cfg){0};
+}
+
+uint32_t mcc_cfg_block_of(const struct mcc_cfg *cfg, uint32_t index)
+{
+	assert(cfg);
+	assert(cfg->block_count);
+	assert(index < cfg->blocks[cfg->block_count - 1].end);
+
+	// binary search for the last block starting at or before `index`
+	uint32_t low = 0;
+	uint32_t high = cfg->block_count;
+	while (high - low > 1) {
+		uint32_t middle = low + (high - low) / 2;
+		if (cfg->blocks[middle].first <= index) {
+			low = middle;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
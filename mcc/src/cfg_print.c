@@ -0,0 +1,141 @@
+#include "mcc/cfg_print.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ir_print.h"
+
+void mcc_cfg_print_dot_begin(FILE *out)
+{
+	assert(out);
+
+	fprintf(out, "digraph \"CFG\" {\n"
+	             "\tnodesep=0.6\n"
+	             "\tnode [shape=box, fontname=monospace];\n");
+}
+
+void mcc_cfg_print_dot_end(FILE *out)
+{
+	assert(out);
+
+	fprintf(out, "}\n");
+}
+
+// Writes `text` as the contents of a DOT string, lines are left-justified.
+static void print_dot_escaped(FILE *out, const char *text, size_t len)
+{
+	for (size_t i = 0; i < len; ++i) {
+		switch (text[i]) {
+		case '\n':
+			fputs("\\l", out);
+			break;
+		case '"':
+		case '\\':
+			fputc('\\', out);
+			fputc(text[i], out);
+			break;
+		default:
+			fputc(text[i], out);
+		}
+	}
+}
+
+static bool print_dot_block(FILE *out, const struct mcc_ir_module *module, const struct mcc_cfg *cfg, uint32_t b)
+{
+	const struct mcc_cfg_block *block = &cfg->blocks[b];
+
+	// the instructions are printed to memory first, then escaped
+	char *text = NULL;
+	size_t len = 0;
+	FILE *buffer = open_memstream(&text, &len);
+	if (!buffer) {
+		return false;
+	}
+
+	fprintf(buffer, "B%u\n", b);
+	for (uint32_t i = block->first; i < block->end; ++i) {
+		const struct mcc_ir_instruction *instruction = &cfg->function->instructions[i];
+		if (instruction->opcode != MCC_IR_LABEL) {
+			fputs("    ", buffer);
+		}
+		mcc_ir_print_instruction(buffer, module, cfg->function, instruction);
+		fputs("\n", buffer);
+	}
+	if (fclose(buffer) != 0) {
+		free(text);
+		return false;
+	}
+
+	fprintf(out, "\t\t\"%s.B%u\" [label=\"", cfg->function->name, b);
+	print_dot_escaped(out, text, len);
+	fprintf(out, "\"%s];\n", block->rpo_index == MCC_CFG_UNREACHABLE ? ", style=dashed" : "");
+	free(text);
+	return true;
+}
+
+static void print_dot_edges(FILE *out, const struct mcc_cfg *cfg, uint32_t b)
+{
+	const struct mcc_cfg_block *block = &cfg->blocks[b];
+	const struct mcc_ir_instruction *last = &cfg->function->instructions[block->end - 1];
+	bool conditional = last->opcode == MCC_IR_JUMP_IF_FALSE || last->opcode == MCC_IR_JUMP_IF_TRUE;
+
+	for (uint32_t s = 0; s < block->successor_count; ++s) {
+		fprintf(out, "\t\t\"%s.B%u\" -> \"%s.B%u\"", cfg->function->name, b, cfg->function->name,
+		        block->successors[s]);
+
+		// the fall-through is the first of two successors
+		if (conditional && block->successor_count == 2) {
+			bool taken = s == 1;
+			bool value = last->opcode == MCC_IR_JUMP_IF_TRUE ? taken : !taken;
+			fprintf(out, " [label=\"%s\"]", value ? "true" : "false");
+		}
+		fputs(";\n", out);
+	}
+}
+
+bool mcc_cfg_print_dot_function(FILE *out, const struct mcc_ir_module *module, const struct mcc_cfg *cfg)
+{
+	assert(out);
+	assert(module);
+	assert(cfg);
+
+	const char *name = cfg->function->name;
+	fprintf(out, "\tsubgraph \"cluster_%s\" {\n", name);
+	fprintf(out, "\t\tlabel=\"%s\";\n", name);
+
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		if (!print_dot_block(out, module, cfg, b)) {
+			return false;
+		}
+	}
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		print_dot_edges(out, cfg, b);
+	}
+
+	fputs("\t}\n", out);
+	return true;
+}
+
+bool mcc_cfg_print_dot(FILE *out, const struct mcc_ir_module *module, const char *function)
+{
+	assert(out);
+	assert(module);
+
+	mcc_cfg_print_dot_begin(out);
+	for (uint32_t i = 0; i < module->function_count; ++i) {
+		const struct mcc_ir_function *f = &module->functions[i];
+		if (f->builtin || (function && strcmp(function, f->name) != 0)) {
+			continue;
+		}
+
+		struct mcc_cfg cfg;
+		bool ok = mcc_cfg_build(&cfg, f) && mcc_cfg_print_dot_function(out, module, &cfg);
+		mcc_cfg_release(&cfg);
+		if (!ok) {
+			return false;
+		}
+	}
+	mcc_cfg_print_dot_end(out);
+	return true;
+}
@@ -0,0 +1,166 @@
+#include "mcc/dataflow.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+bool mcc_dataflow_init(struct mcc_dataflow *dataflow,
+                       const struct mcc_cfg *cfg,
+                       enum mcc_dataflow_direction direction,
+                       enum mcc_dataflow_meet meet,
+                       uint32_t bit_count)
+{
+	assert(dataflow);
+	assert(cfg);
+
+	*dataflow = (struct mcc_dataflow){
+	    .direction = direction,
+	    .meet = meet,
+	    .bit_count = bit_count,
+	    .word_count = MCC_BITSET_WORDS(bit_count),
+	    .block_count = cfg->block_count,
+	};
+
+	// gen, kill, in, out of every block and the boundary in one allocation
+	size_t words = (size_t)dataflow->word_count * cfg->block_count;
+	mcc_bitset_word *sets = calloc(4 * words + dataflow->word_count + 1, sizeof(*sets));
+	dataflow->pending = calloc(MCC_BITSET_WORDS(cfg->block_count) + 1, sizeof(*dataflow->pending));
+	if (!sets || !dataflow->pending) {
+		free(sets);
+		return false;
+	}
+
+	dataflow->gen = sets;
+	dataflow->kill = sets + words;
+	dataflow->in = sets + 2 * words;
+	dataflow->out = sets + 3 * words;
+	dataflow->boundary = sets + 4 * words;
+	return true;
+}
+
+void mcc_dataflow_release(struct mcc_dataflow *dataflow)
+{
+	assert(dataflow);
+
+	free(dataflow->gen);
+	free(dataflow->pending);
+	*dataflow = (struct mcc_dataflow){0};
+}
+
+// Position of `block` in the visiting order.
+static uint32_t position(const struct mcc_dataflow *dataflow, const struct mcc_cfg *cfg, uint32_t block)
+{
+	uint32_t rpo_index = cfg->blocks[block].rpo_index;
+	assert(rpo_index != MCC_CFG_UNREACHABLE);
+	return dataflow->direction == MCC_DATAFLOW_FORWARD ? rpo_index : cfg->rpo_count - 1 - rpo_index;
+}
+
+static void meet(const struct mcc_dataflow *dataflow, mcc_bitset_word *dst, const mcc_bitset_word *src)
+{
+	if (dataflow->meet == MCC_DATAFLOW_UNION) {
+		mcc_bitset_union(dst, src, dataflow->word_count);
+	} else {
+		mcc_bitset_intersect(dst, src, dataflow->word_count);
+	}
+}
+
+// Sets `dst` to the identity of the meet operator.
+static void meet_identity(const struct mcc_dataflow *dataflow, mcc_bitset_word *dst)
+{
+	if (dataflow->meet == MCC_DATAFLOW_UNION) {
+		mcc_bitset_clear_all(dst, dataflow->word_count);
+	} else {
+		mcc_bitset_fill(dst, dataflow->bit_count);
+	}
+}
+
+// Adds the neighbours of `block` which depend on its result to the pending
+// blocks.
+static void schedule_dependents(struct mcc_dataflow *dataflow, const struct mcc_cfg *cfg, uint32_t block)
+{
+	const struct mcc_cfg_block *b = &cfg->blocks[block];
+
+	if (dataflow->direction == MCC_DATAFLOW_FORWARD) {
+		for (uint32_t s = 0; s < b->successor_count; ++s) {
+			MCC_BITSET_SET(dataflow->pending, position(dataflow, cfg, b->successors[s]));
+		}
+		return;
+	}
+
+	for (uint32_t p = 0; p < b->predecessor_count; ++p) {
+		uint32_t predecessor = cfg->predecessors[b->predecessor_first + p];
+		if (cfg->blocks[predecessor].rpo_index != MCC_CFG_UNREACHABLE) {
+			MCC_BITSET_SET(dataflow->pending, position(dataflow, cfg, predecessor));
+		}
+	}
+}
+
+// Evaluates the equations of `block`, returns whether its result changed.
+static bool process(struct mcc_dataflow *dataflow, const struct mcc_cfg *cfg, uint32_t block)
+{
+	const struct mcc_cfg_block *b = &cfg->blocks[block];
+	bool forward = dataflow->direction == MCC_DATAFLOW_FORWARD;
+
+	// `input` is the side facing the neighbours this block depends on
+	mcc_bitset_word *in = MCC_DATAFLOW_SET(dataflow, in, block);
+	mcc_bitset_word *out = MCC_DATAFLOW_SET(dataflow, out, block);
+	mcc_bitset_word *input = forward ? in : out;
+	mcc_bitset_word *output = forward ? out : in;
+
+	if (forward) {
+		if (block == 0) {
+			mcc_bitset_copy(input, dataflow->boundary, dataflow->word_count);
+		} else {
+			meet_identity(dataflow, input);
+		}
+		for (uint32_t p = 0; p < b->predecessor_count; ++p) {
+			uint32_t predecessor = cfg->predecessors[b->predecessor_first + p];
+			meet(dataflow, input, MCC_DATAFLOW_SET(dataflow, out, predecessor));
+		}
+	} else if (b->successor_count == 0) {
+		mcc_bitset_copy(input, dataflow->boundary, dataflow->word_count);
+	} else {
+		mcc_bitset_copy(input, MCC_DATAFLOW_SET(dataflow, in, b->successors[0]), dataflow->word_count);
+		for (uint32_t s = 1; s < b->successor_count; ++s) {
+			meet(dataflow, input, MCC_DATAFLOW_SET(dataflow, in, b->successors[s]));
+		}
+	}
+
+	return mcc_bitset_transfer(output, MCC_DATAFLOW_SET(dataflow, gen, block), input,
+	                           MCC_DATAFLOW_SET(dataflow, kill, block), dataflow->word_count);
+}
+
+void mcc_dataflow_solve(struct mcc_dataflow *dataflow, const struct mcc_cfg *cfg)
+{
+	assert(dataflow);
+	assert(cfg);
+	assert(dataflow->block_count == cfg->block_count);
+
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		meet_identity(dataflow, MCC_DATAFLOW_SET(dataflow, in, b));
+		meet_identity(dataflow, MCC_DATAFLOW_SET(dataflow, out, b));
+	}
+
+	// Every reachable block is processed at least once. Afterwards the pending
+	// blocks are swept in visiting order, wrapping around at the end, until
+	// none is left.
+	uint32_t pending_words = MCC_BITSET_WORDS(cfg->rpo_count);
+	mcc_bitset_fill(dataflow->pending, cfg->rpo_count);
+	dataflow->visits = 0;
+
+	uint32_t next = mcc_bitset_next(dataflow->pending, pending_words, 0);
+	while (next != MCC_BITSET_END) {
+		MCC_BITSET_CLEAR(dataflow->pending, next);
+
+		uint32_t block = dataflow->direction == MCC_DATAFLOW_FORWARD ? cfg->rpo[next]
+		                                                               : cfg->rpo[cfg->rpo_count - 1 - next];
+		++dataflow->visits;
+		if (process(dataflow, cfg, block)) {
+			schedule_dependents(dataflow, cfg, block);
+		}
+
+		next = mcc_bitset_next(dataflow->pending, pending_words, next + 1);
+		if (next == MCC_BITSET_END) {
+			next = mcc_bitset_next(dataflow->pending, pending_words, 0);
+		}
+	}
+}
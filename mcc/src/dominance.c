@@ -0,0 +1,189 @@
+#include "mcc/dominance.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+// Walks up from `a` and `b` to their nearest common dominator; blocks higher
+// up in the tree have smaller reverse postorder indices.
+static uint32_t intersect(const struct mcc_cfg *cfg, const uint32_t *idom, uint32_t a, uint32_t b)
+{
+	while (a != b) {
+		while (cfg->blocks[a].rpo_index > cfg->blocks[b].rpo_index) {
+			a = idom[a];
+		}
+		while (cfg->blocks[b].rpo_index > cfg->blocks[a].rpo_index) {
+			b = idom[b];
+		}
+	}
+	return a;
+}
+
+static void compute_idoms(struct mcc_dominance *dominance, const struct mcc_cfg *cfg)
+{
+	uint32_t *idom = dominance->idom;
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		idom[b] = MCC_CFG_UNREACHABLE;
+	}
+	if (cfg->block_count == 0) {
+		return;
+	}
+	idom[0] = 0;
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (uint32_t i = 1; i < cfg->rpo_count; ++i) {
+			uint32_t b = cfg->rpo[i];
+			const struct mcc_cfg_block *block = &cfg->blocks[b];
+
+			// start with any processed predecessor
+			uint32_t new_idom = MCC_CFG_UNREACHABLE;
+			for (uint32_t p = 0; p < block->predecessor_count; ++p) {
+				uint32_t predecessor = cfg->predecessors[block->predecessor_first + p];
+				if (idom[predecessor] == MCC_CFG_UNREACHABLE) {
+					continue;
+				}
+				new_idom = new_idom == MCC_CFG_UNREACHABLE ? predecessor
+				                                           : intersect(cfg, idom, predecessor, new_idom);
+			}
+
+			if (idom[b] != new_idom) {
+				idom[b] = new_idom;
+				changed = true;
+			}
+		}
+	}
+}
+
+// Groups the blocks by immediate dominator, a counting sort.
+static bool collect_children(struct mcc_dominance *dominance, const struct mcc_cfg *cfg)
+{
+	dominance->children_first = calloc(cfg->block_count + 2, sizeof(*dominance->children_first));
+	dominance->children = malloc((cfg->block_count + 1) * sizeof(*dominance->children));
+	if (!dominance->children_first || !dominance->children) {
+		return false;
+	}
+
+	// children_first[b + 2] counts the children of b, the prefix sums are
+	// shifted by one so that filling advances children_first[b + 1]
+	uint32_t *first = dominance->children_first;
+	for (uint32_t b = 1; b < cfg->block_count; ++b) {
+		if (dominance->idom[b] != MCC_CFG_UNREACHABLE) {
+			++first[dominance->idom[b] + 2];
+		}
+	}
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		first[b + 2] += first[b + 1];
+	}
+	for (uint32_t b = 1; b < cfg->block_count; ++b) {
+		if (dominance->idom[b] != MCC_CFG_UNREACHABLE) {
+			dominance->children[first[dominance->idom[b] + 1]++] = b;
+		}
+	}
+	return true;
+}
+
+// Adds `b` to the frontiers of the blocks from each predecessor of `b` up to,
+// excluding, the immediate dominator of `b`. Only counts if `frontiers` is
+// NULL. `last` records the last block added to each frontier to avoid
+// duplicates.
+static void walk_frontier(struct mcc_dominance *dominance,
+                          const struct mcc_cfg *cfg,
+                          uint32_t b,
+                          uint32_t *last,
+                          uint32_t *frontiers)
+{
+	const struct mcc_cfg_block *block = &cfg->blocks[b];
+	for (uint32_t p = 0; p < block->predecessor_count; ++p) {
+		uint32_t runner = cfg->predecessors[block->predecessor_first + p];
+		if (dominance->idom[runner] == MCC_CFG_UNREACHABLE) {
+			continue;
+		}
+
+		while (runner != dominance->idom[b] && last[runner] != b) {
+			last[runner] = b;
+			if (frontiers) {
+				frontiers[dominance->frontier_first[runner + 1]++] = b;
+			} else {
+				++dominance->frontier_first[runner + 2];
+			}
+			runner = dominance->idom[runner];
+		}
+	}
+}
+
+static bool collect_frontiers(struct mcc_dominance *dominance, const struct mcc_cfg *cfg)
+{
+	dominance->frontier_first = calloc(cfg->block_count + 2, sizeof(*dominance->frontier_first));
+	uint32_t *last = malloc(cfg->block_count * sizeof(*last));
+	if (!dominance->frontier_first || !last) {
+		free(last);
+		return false;
+	}
+
+	// join points are the only blocks in frontiers; count, then fill
+	for (int pass = 0; pass < 2; ++pass) {
+		for (uint32_t b = 0; b < cfg->block_count; ++b) {
+			last[b] = MCC_CFG_UNREACHABLE;
+		}
+		for (uint32_t b = 0; b < cfg->block_count; ++b) {
+			if (dominance->idom[b] != MCC_CFG_UNREACHABLE && cfg->blocks[b].predecessor_count > 1) {
+				walk_frontier(dominance, cfg, b, last, pass ? dominance->frontiers : NULL);
+			}
+		}
+
+		if (pass == 0) {
+			uint32_t *first = dominance->frontier_first;
+			for (uint32_t b = 0; b < cfg->block_count; ++b) {
+				first[b + 2] += first[b + 1];
+			}
+			dominance->frontiers = malloc((first[cfg->block_count + 1] + 1) * sizeof(*dominance->frontiers));
+			if (!dominance->frontiers) {
+				free(last);
+				return false;
+			}
+		}
+	}
+
+	free(last);
+	return true;
+}
+
+bool mcc_dominance_compute(struct mcc_dominance *dominance, const struct mcc_cfg *cfg)
+{
+	assert(dominance);
+	assert(cfg);
+
+	*dominance = (struct mcc_dominance){0};
+	dominance->idom = malloc((cfg->block_count + 1) * sizeof(*dominance->idom));
+	if (!dominance->idom) {
+		return false;
+	}
+	compute_idoms(dominance, cfg);
+	return collect_children(dominance, cfg) && collect_frontiers(dominance, cfg);
+}
+
+void mcc_dominance_release(struct mcc_dominance *dominance)
+{
+	assert(dominance);
+
+	free(dominance->idom);
+	free(dominance->children_first);
+	free(dominance->children);
+	free(dominance->frontier_first);
+	free(dominance->frontiers);
+	*dominance = (struct mcc_dominance){0};
+}
+
+bool mcc_dominance_dominates(const struct mcc_dominance *dominance, uint32_t a, uint32_t b)
+{
+	assert(dominance);
+	assert(dominance->idom[a] != MCC_CFG_UNREACHABLE);
+	assert(dominance->idom[b] != MCC_CFG_UNREACHABLE);
+
+	// the entry is the only block dominating itself immediately
+	while (b != a && dominance->idom[b] != b) {
+		b = dominance->idom[b];
+	}
+	return b == a;
+}
@@ -0,0 +1,354 @@
+#include "mcc/inline.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "mcc/bitset.h"
+
+// Loops around a call counted by the cost model.
+#define MAX_LOOP_DEPTH 3
+
+static uint32_t cost_of(const struct mcc_ir_function *function)
+{
+	uint32_t cost = 0;
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		uint8_t opcode = function->instructions[i].opcode;
+		cost += opcode != MCC_IR_NOP && opcode != MCC_IR_LABEL;
+	}
+	return cost;
+}
+
+struct inliner {
+	struct mcc_ir_module *module;
+	uint32_t limit;
+
+	// cost of each function, updated as calls are inlined into it
+	uint32_t *costs;
+
+	// functions reachable from each function through calls, a row of `words`
+	// per function
+	mcc_bitset_word *reachable;
+	uint32_t words;
+
+	// functions with bodies, callees before callers unless recursive
+	uint32_t *order;
+	uint32_t order_count;
+};
+
+static mcc_bitset_word *reachable_from(const struct inliner *in, uint32_t function)
+{
+	return &in->reachable[(size_t)function * in->words];
+}
+
+static bool is_recursive(const struct inliner *in, uint32_t function)
+{
+	return MCC_BITSET_TEST(reachable_from(in, function), function);
+}
+
+// ---------------------------------------------------------------- Call Graph
+
+static bool build_call_graph(struct inliner *in)
+{
+	const struct mcc_ir_module *module = in->module;
+	uint32_t count = module->function_count;
+
+	for (uint32_t f = 0; f < count; ++f) {
+		const struct mcc_ir_function *function = &module->functions[f];
+		for (uint32_t i = 0; i < function->instruction_count; ++i) {
+			const struct mcc_ir_instruction *instruction = &function->instructions[i];
+			assert(instruction->opcode != MCC_IR_PHI);
+			if (instruction->opcode == MCC_IR_CALL) {
+				MCC_BITSET_SET(reachable_from(in, f), MCC_IR_OPERAND_INDEX(instruction->a));
+			}
+		}
+	}
+
+	// transitive closure, Warshall's algorithm
+	for (uint32_t k = 0; k < count; ++k) {
+		for (uint32_t f = 0; f < count; ++f) {
+			if (MCC_BITSET_TEST(reachable_from(in, f), k)) {
+				mcc_bitset_union(reachable_from(in, f), reachable_from(in, k), in->words);
+			}
+		}
+	}
+
+	// depth-first postorder over the direct calls
+	uint32_t *stack = malloc((count + 1) * sizeof(*stack));
+	uint32_t *next = calloc(count + 1, sizeof(*next));
+	mcc_bitset_word *visited = calloc(in->words + 1, sizeof(*visited));
+	bool ok = stack && next && visited;
+	for (uint32_t root = 0; ok && root < count; ++root) {
+		if (MCC_BITSET_TEST(visited, root)) {
+			continue;
+		}
+		MCC_BITSET_SET(visited, root);
+		uint32_t depth = 0;
+		stack[depth++] = root;
+
+		while (depth) {
+			uint32_t f = stack[depth - 1];
+			const struct mcc_ir_function *function = &module->functions[f];
+
+			// the next callee not visited yet
+			uint32_t callee = count;
+			while (next[f] < function->instruction_count && callee == count) {
+				const struct mcc_ir_instruction *instruction = &function->instructions[next[f]++];
+				uint32_t index = MCC_IR_OPERAND_INDEX(instruction->a);
+				if (instruction->opcode == MCC_IR_CALL && !MCC_BITSET_TEST(visited, index)) {
+					callee = index;
+				}
+			}
+
+			if (callee != count) {
+				MCC_BITSET_SET(visited, callee);
+				stack[depth++] = callee;
+			} else {
+				--depth;
+				if (!function->builtin) {
+					in->order[in->order_count++] = f;
+				}
+			}
+		}
+	}
+
+	free(stack);
+	free(next);
+	free(visited);
+	return ok;
+}
+
+// ------------------------------------------------------------------ Inlining
+
+static bool emit(struct mcc_ir_function *function, struct mcc_ir_instruction instruction)
+{
+	return mcc_ir_emit(function, &instruction);
+}
+
+// Emits the body of the function called by `call` into `caller`, with the
+// arguments of the call in `arguments`.
+static bool emit_body(struct inliner *in,
+                      struct mcc_ir_function *caller,
+                      const struct mcc_ir_instruction *call,
+                      const struct mcc_ir_instruction *arguments)
+{
+	const struct mcc_ir_function *callee = &in->module->functions[MCC_IR_OPERAND_INDEX(call->a)];
+
+	uint32_t *vregs = malloc((callee->vreg_count + 1) * sizeof(*vregs));
+	uint32_t *arrays = malloc((callee->array_count + 1) * sizeof(*arrays));
+	bool ok = vregs && arrays;
+	for (uint32_t v = 0; ok && v < callee->vreg_count; ++v) {
+		vregs[v] = mcc_ir_new_vreg(caller, callee->vreg_types[v]);
+		ok = vregs[v] != MCC_IR_OPERAND_MAX;
+	}
+	for (uint32_t a = 0; ok && a < callee->array_count; ++a) {
+		arrays[a] = mcc_ir_add_array(caller, callee->arrays[a].element_type, callee->arrays[a].size);
+		ok = arrays[a] != MCC_IR_OPERAND_MAX;
+	}
+
+	// the labels of the callee follow the current ones
+	uint32_t first_label = caller->label_count;
+	for (uint32_t l = 0; ok && l < callee->label_count; ++l) {
+		ok = mcc_ir_new_label(caller) != MCC_IR_OPERAND_MAX;
+	}
+	uint32_t end = ok ? mcc_ir_new_label(caller) : MCC_IR_OPERAND_MAX;
+	ok = ok && end != MCC_IR_OPERAND_MAX;
+
+	for (uint32_t p = 0; ok && p < callee->parameter_count; ++p) {
+		ok = emit(caller, (struct mcc_ir_instruction){.opcode = MCC_IR_COPY,
+		                                              .type = callee->vreg_types[p],
+		                                              .dest = MCC_IR_VREG(vregs[p]),
+		                                              .a = arguments[p].a});
+	}
+
+	for (uint32_t i = 0; ok && i < callee->instruction_count; ++i) {
+		struct mcc_ir_instruction instruction = callee->instructions[i];
+		mcc_ir_operand *operands[] = {&instruction.dest, &instruction.a, &instruction.b};
+		for (uint32_t o = 0; o < sizeof(operands) / sizeof(*operands); ++o) {
+			if (MCC_IR_IS_VREG(*operands[o])) {
+				*operands[o] = MCC_IR_VREG(vregs[MCC_IR_OPERAND_INDEX(*operands[o])]);
+			}
+		}
+
+		switch (instruction.opcode) {
+		case MCC_IR_LABEL:
+		case MCC_IR_JUMP:
+			instruction.a = MCC_IR_IMM(first_label + MCC_IR_OPERAND_INDEX(instruction.a));
+			break;
+		case MCC_IR_JUMP_IF_FALSE:
+		case MCC_IR_JUMP_IF_TRUE:
+			instruction.b = MCC_IR_IMM(first_label + MCC_IR_OPERAND_INDEX(instruction.b));
+			break;
+		case MCC_IR_ARRAY:
+			instruction.a = MCC_IR_IMM(arrays[MCC_IR_OPERAND_INDEX(instruction.a)]);
+			break;
+		default:
+			break;
+		}
+
+		if (instruction.opcode != MCC_IR_RETURN) {
+			ok = emit(caller, instruction);
+			continue;
+		}
+
+		if (call->dest != MCC_IR_NONE && instruction.a != MCC_IR_NONE) {
+			ok = emit(caller, (struct mcc_ir_instruction){.opcode = MCC_IR_COPY,
+			                                              .type = callee->return_type,
+			                                              .dest = call->dest,
+			                                              .a = instruction.a});
+		}
+		// the last return falls through
+		if (ok && i + 1 < callee->instruction_count) {
+			ok = emit(caller, (struct mcc_ir_instruction){.opcode = MCC_IR_JUMP, .a = MCC_IR_IMM(end)});
+		}
+	}
+	ok = ok && emit(caller, (struct mcc_ir_instruction){.opcode = MCC_IR_LABEL, .a = MCC_IR_IMM(end)});
+
+	free(vregs);
+	free(arrays);
+	return ok;
+}
+
+// Computes the number of loops around each instruction of `function`, loops
+// being the ranges from a label to a jump back to it.
+static bool compute_loop_depths(const struct mcc_ir_function *function, uint32_t *depths)
+{
+	uint32_t *labels = malloc((function->label_count + 1) * sizeof(*labels));
+	if (!labels) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		depths[i] = 0;
+		if (instruction->opcode == MCC_IR_LABEL) {
+			labels[MCC_IR_OPERAND_INDEX(instruction->a)] = i;
+		}
+	}
+
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		mcc_ir_operand target;
+		switch (instruction->opcode) {
+		case MCC_IR_JUMP:
+			target = instruction->a;
+			break;
+		case MCC_IR_JUMP_IF_FALSE:
+		case MCC_IR_JUMP_IF_TRUE:
+			target = instruction->b;
+			break;
+		default:
+			continue;
+		}
+
+		uint32_t header = labels[MCC_IR_OPERAND_INDEX(target)];
+		for (uint32_t k = header; header < i && k <= i; ++k) {
+			++depths[k];
+		}
+	}
+
+	free(labels);
+	return true;
+}
+
+// Inlines the calls selected by the cost model into the function `index`.
+static bool inline_calls(struct inliner *in, uint32_t index, struct mcc_inline_stats *stats)
+{
+	struct mcc_ir_function *function = &in->module->functions[index];
+	uint32_t count = function->instruction_count;
+
+	uint32_t *depths = malloc((count + 1) * sizeof(*depths));
+	bool *selected = calloc(count + 1, sizeof(*selected));
+	bool ok = depths && selected && compute_loop_depths(function, depths);
+
+	uint32_t growth = 0;
+	uint32_t selected_count = 0;
+	for (uint32_t i = 0; ok && i < count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		if (instruction->opcode != MCC_IR_CALL) {
+			continue;
+		}
+
+		uint32_t callee = MCC_IR_OPERAND_INDEX(instruction->a);
+		uint32_t depth = depths[i] < MAX_LOOP_DEPTH ? depths[i] : MAX_LOOP_DEPTH;
+		uint32_t cost = in->costs[callee];
+		if (in->module->functions[callee].builtin || is_recursive(in, callee) ||
+		    cost > (uint64_t)in->limit * (1 + depth) ||
+		    (uint64_t)growth + cost > (uint64_t)in->limit * MCC_INLINE_GROWTH) {
+			continue;
+		}
+		growth += cost;
+		selected[i] = true;
+		++selected_count;
+	}
+
+	if (ok && selected_count) {
+		struct mcc_ir_instruction *instructions = function->instructions;
+		function->instructions = NULL;
+		function->instruction_count = 0;
+		function->instruction_capacity = 0;
+
+		for (uint32_t i = 0; ok && i < count; ++i) {
+			const struct mcc_ir_instruction *instruction = &instructions[i];
+			if (instruction->opcode == MCC_IR_ARG) {
+				// arguments directly precede their call
+				uint32_t call = i;
+				while (instructions[call].opcode == MCC_IR_ARG) {
+					++call;
+				}
+				if (selected[call]) {
+					i = call - 1;
+					continue;
+				}
+			}
+
+			if (selected[i]) {
+				uint32_t argument_count = MCC_IR_OPERAND_INDEX(instruction->b);
+				ok = emit_body(in, function, instruction, &instructions[i - argument_count]);
+			} else {
+				ok = emit(function, *instruction);
+			}
+		}
+		free(instructions);
+
+		in->costs[index] = cost_of(function);
+		if (stats) {
+			stats->inlined_calls += selected_count;
+		}
+	}
+
+	free(depths);
+	free(selected);
+	return ok;
+}
+
+bool mcc_inline(struct mcc_ir_module *module, uint32_t limit, struct mcc_inline_stats *stats)
+{
+	assert(module);
+
+	if (limit == 0) {
+		return true;
+	}
+
+	uint32_t count = module->function_count;
+	struct inliner in = {
+	    .module = module,
+	    .limit = limit,
+	    .costs = malloc((count + 1) * sizeof(*in.costs)),
+	    .words = MCC_BITSET_WORDS(count),
+	    .order = malloc((count + 1) * sizeof(*in.order)),
+	};
+	in.reachable = calloc((size_t)count * in.words + 1, sizeof(*in.reachable));
+
+	bool ok = in.costs && in.order && in.reachable && build_call_graph(&in);
+	for (uint32_t f = 0; ok && f < count; ++f) {
+		in.costs[f] = cost_of(&module->functions[f]);
+	}
+	for (uint32_t i = 0; ok && i < in.order_count; ++i) {
+		ok = inline_calls(&in, in.order[i], stats);
+	}
+
+	free(in.costs);
+	free(in.reachable);
+	free(in.order);
+	return ok;
+}
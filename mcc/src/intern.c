@@ -0,0 +1,153 @@
+#include "mcc/intern.h"
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/arena.h"
+
+// Number of shards, must be a power of two.
+#define SHARD_COUNT 16
+
+#define INITIAL_CAPACITY 256
+
+struct entry {
+	uint32_t hash;
+	uint32_t len;
+	const char *str;
+};
+
+// Each shard is an open-addressing hash table (linear probing) whose strings
+// are stored in the shard's arena.
+struct shard {
+	pthread_mutex_t lock;
+	struct entry *entries;
+	uint32_t count;
+	uint32_t capacity;
+	struct mcc_arena arena;
+};
+
+static struct shard shards[SHARD_COUNT] = {
+#define SHARD {.lock = PTHREAD_MUTEX_INITIALIZER}
+    SHARD, SHARD, SHARD, SHARD, SHARD, SHARD, SHARD, SHARD,
+    SHARD, SHARD, SHARD, SHARD, SHARD, SHARD, SHARD, SHARD,
+#undef SHARD
+};
+
+// FNV-1a
+static uint32_t hash_string(const char *str, size_t len)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= (unsigned char)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool grow(struct shard *shard)
+{
+	uint32_t capacity = shard->capacity ? shard->capacity * 2 : INITIAL_CAPACITY;
+
+	struct entry *entries = calloc(capacity, sizeof(*entries));
+	if (!entries) {
+		return false;
+	}
+
+	for (uint32_t i = 0; i < shard->capacity; ++i) {
+		struct entry *old = &shard->entries[i];
+		if (!old->str) {
+			continue;
+		}
+
+		uint32_t slot = old->hash & (capacity - 1);
+		while (entries[slot].str) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		entries[slot] = *old;
+	}
+
+	free(shard->entries);
+	shard->entries = entries;
+	shard->capacity = capacity;
+	return true;
+}
+
+static const char *lookup_or_insert(struct shard *shard, const char *str, uint32_t len, uint32_t hash)
+{
+	// keep the load factor below 3/4
+	if ((shard->count + 1) * 4 > shard->capacity * 3 && !grow(shard)) {
+		return NULL;
+	}
+
+	uint32_t slot = hash & (shard->capacity - 1);
+	for (;;) {
+		struct entry *entry = &shard->entries[slot];
+
+		if (!entry->str) {
+			char *copy = mcc_arena_alloc(&shard->arena, len + 1);
+			if (!copy) {
+				return NULL;
+			}
+			memcpy(copy, str, len);
+			copy[len] = '\0';
+
+			*entry = (struct entry){.hash = hash, .len = len, .str = copy};
+			shard->count++;
+			return copy;
+		}
+
+		if (entry->hash == hash && entry->len == len && memcmp(entry->str, str, len) == 0) {
+			return entry->str;
+		}
+
+		slot = (slot + 1) & (shard->capacity - 1);
+	}
+}
+
+const char *mcc_intern_n(const char *str, size_t len)
+{
+	assert(str);
+
+	if (len > UINT32_MAX - 1) {
+		return NULL;
+	}
+
+	uint32_t hash = hash_string(str, len);
+
+	// The upper bits select the shard, the lower bits the slot.
+	struct shard *shard = &shards[(hash >> 24) & (SHARD_COUNT - 1)];
+
+	pthread_mutex_lock(&shard->lock);
+	const char *result = lookup_or_insert(shard, str, (uint32_t)len, hash);
+	pthread_mutex_unlock(&shard->lock);
+
+	return result;
+}
+
+const char *mcc_intern(const char *str)
+{
+	assert(str);
+
+	return mcc_intern_n(str, strlen(str));
+}
+
+void mcc_intern_release(void)
+{
+	for (int i = 0; i < SHARD_COUNT; ++i) {
+		struct shard *shard = &shards[i];
+
+		pthread_mutex_lock(&shard->lock);
+
+		free(shard->entries);
+		shard->entries = NULL;
+		shard->count = 0;
+		shard->capacity = 0;
+		mcc_arena_release(&shard->arena);
+
+		pthread_mutex_unlock(&shard->lock);
+	}
+}
@@ -0,0 +1,344 @@
+#include "mcc/ir.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/reserve.h"
+
+// Indices into the arrays of a module have to fit in an operand.
+static bool reserve_indexed(void **array, uint32_t *capacity, uint32_t count, uint32_t extra, size_t size)
+{
+	return reserve_bounded(array, capacity, count, extra, size, MCC_IR_OPERAND_MAX);
+}
+
+void mcc_ir_module_init(struct mcc_ir_module *module)
+{
+	assert(module);
+
+	*module = (struct mcc_ir_module){0};
+	mcc_arena_init(&module->arena);
+}
+
+static void release_function(struct mcc_ir_function *function)
+{
+	free(function->instructions);
+	free(function->vreg_types);
+	free(function->arrays);
+	free(function->phi_operands);
+}
+
+void mcc_ir_module_release(struct mcc_ir_module *module)
+{
+	assert(module);
+
+	for (uint32_t i = 0; i < module->function_count; ++i) {
+		release_function(&module->functions[i]);
+	}
+	free(module->functions);
+	free(module->constants);
+	free(module->constant_slots);
+	mcc_arena_release(&module->arena);
+
+	mcc_ir_module_init(module);
+}
+
+// ------------------------------------------------------------------ Functions
+
+uint32_t mcc_ir_add_function(struct mcc_ir_module *module, const char *name, enum mcc_ir_type return_type)
+{
+	assert(module);
+	assert(name);
+
+	if (!reserve_indexed((void **)&module->functions, &module->function_capacity, module->function_count, 1,
+	                     sizeof(*module->functions))) {
+		return MCC_IR_OPERAND_MAX;
+	}
+
+	uint32_t index = module->function_count++;
+	module->functions[index] = (struct mcc_ir_function){
+	    .name = name,
+	    .return_type = return_type,
+	};
+	return index;
+}
+
+uint32_t mcc_ir_find_function(const struct mcc_ir_module *module, const char *name)
+{
+	assert(module);
+	assert(name);
+
+	for (uint32_t i = 0; i < module->function_count; ++i) {
+		if (strcmp(module->functions[i].name, name) == 0) {
+			return i;
+		}
+	}
+	return MCC_IR_OPERAND_MAX;
+}
+
+uint32_t mcc_ir_new_vreg(struct mcc_ir_function *function, enum mcc_ir_type type)
+{
+	assert(function);
+
+	if (!reserve_indexed((void **)&function->vreg_types, &function->vreg_capacity, function->vreg_count, 1,
+	                     sizeof(*function->vreg_types))) {
+		return MCC_IR_OPERAND_MAX;
+	}
+
+	uint32_t vreg = function->vreg_count++;
+	function->vreg_types[vreg] = (uint8_t)type;
+	return vreg;
+}
+
+uint32_t mcc_ir_new_label(struct mcc_ir_function *function)
+{
+	assert(function);
+
+	if (function->label_count == MCC_IR_OPERAND_MAX) {
+		return MCC_IR_OPERAND_MAX;
+	}
+	return function->label_count++;
+}
+
+uint32_t mcc_ir_add_array(struct mcc_ir_function *function, enum mcc_ir_type element_type, uint32_t size)
+{
+	assert(function);
+
+	if (!reserve_indexed((void **)&function->arrays, &function->array_capacity, function->array_count, 1,
+	                     sizeof(*function->arrays))) {
+		return MCC_IR_OPERAND_MAX;
+	}
+
+	uint32_t index = function->array_count++;
+	function->arrays[index] = (struct mcc_ir_array){
+	    .element_type = element_type,
+	    .size = size,
+	};
+	return index;
+}
+
+bool mcc_ir_emit(struct mcc_ir_function *function, const struct mcc_ir_instruction *instruction)
+{
+	assert(function);
+	assert(instruction);
+
+	if (!reserve_indexed((void **)&function->instructions, &function->instruction_capacity,
+	                     function->instruction_count, 1, sizeof(*function->instructions))) {
+		return false;
+	}
+
+	function->instructions[function->instruction_count++] = *instruction;
+	return true;
+}
+
+uint32_t mcc_ir_add_phi_operands(struct mcc_ir_function *function, uint32_t count)
+{
+	assert(function);
+
+	uint32_t first = function->phi_operand_count;
+	if (count > MCC_IR_OPERAND_MAX - first) {
+		return MCC_IR_OPERAND_MAX;
+	}
+
+	// all operands or none, a phi must not refer to a partial range
+	if (!reserve_indexed((void **)&function->phi_operands, &function->phi_operand_capacity, first, count,
+	                     sizeof(*function->phi_operands))) {
+		return MCC_IR_OPERAND_MAX;
+	}
+	for (uint32_t i = 0; i < count; ++i) {
+		function->phi_operands[function->phi_operand_count++] = MCC_IR_NONE;
+	}
+	return first;
+}
+
+// --------------------------------------------------------------- Instructions
+
+mcc_ir_operand mcc_ir_defined_vreg(const struct mcc_ir_instruction *instruction)
+{
+	assert(instruction);
+
+	// the address operand of a store is read
+	bool store = instruction->opcode == MCC_IR_STORE || instruction->opcode == MCC_IR_VSTORE;
+	if (store || !MCC_IR_IS_VREG(instruction->dest)) {
+		return MCC_IR_NONE;
+	}
+	return instruction->dest;
+}
+
+uint32_t mcc_ir_used_vregs(const struct mcc_ir_instruction *instruction, mcc_ir_operand uses[MCC_IR_MAX_USES])
+{
+	assert(instruction);
+	assert(uses);
+
+	uint32_t count = 0;
+	bool store = instruction->opcode == MCC_IR_STORE || instruction->opcode == MCC_IR_VSTORE;
+	if (store && MCC_IR_IS_VREG(instruction->dest)) {
+		uses[count++] = instruction->dest;
+	}
+	if (MCC_IR_IS_VREG(instruction->a)) {
+		uses[count++] = instruction->a;
+	}
+	if (MCC_IR_IS_VREG(instruction->b)) {
+		uses[count++] = instruction->b;
+	}
+	return count;
+}
+
+// -------------------------------------------------------------- Constant Pool
+
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t len)
+{
+	const unsigned char *bytes = data;
+	for (size_t i = 0; i < len; ++i) {
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static uint32_t hash_constant(const struct mcc_ir_constant *constant)
+{
+	uint32_t hash = hash_bytes(2166136261u, &constant->type, sizeof(constant->type));
+
+	switch (constant->type) {
+	case MCC_IR_TYPE_INT:
+		return hash_bytes(hash, &constant->i_value, sizeof(constant->i_value));
+	case MCC_IR_TYPE_FLOAT:
+		return hash_bytes(hash, &constant->f_value, sizeof(constant->f_value));
+	case MCC_IR_TYPE_BOOL:
+		return hash_bytes(hash, &constant->b_value, sizeof(constant->b_value));
+	case MCC_IR_TYPE_STRING:
+		return hash_bytes(hash, constant->s_value, strlen(constant->s_value));
+	case MCC_IR_TYPE_VOID:
+	case MCC_IR_TYPE_ADDRESS:
+	case MCC_IR_TYPE_INT4:
+	case MCC_IR_TYPE_FLOAT4:
+		break;
+	}
+	return hash;
+}
+
+static bool constant_equals(const struct mcc_ir_constant *a, const struct mcc_ir_constant *b)
+{
+	if (a->type != b->type) {
+		return false;
+	}
+
+	switch (a->type) {
+	case MCC_IR_TYPE_INT:
+		return a->i_value == b->i_value;
+	case MCC_IR_TYPE_FLOAT:
+		// bitwise, keeps 0.0 and -0.0 apart
+		return memcmp(&a->f_value, &b->f_value, sizeof(a->f_value)) == 0;
+	case MCC_IR_TYPE_BOOL:
+		return a->b_value == b->b_value;
+	case MCC_IR_TYPE_STRING:
+		return strcmp(a->s_value, b->s_value) == 0;
+	case MCC_IR_TYPE_VOID:
+	case MCC_IR_TYPE_ADDRESS:
+	case MCC_IR_TYPE_INT4:
+	case MCC_IR_TYPE_FLOAT4:
+		break;
+	}
+	return true;
+}
+
+// Returns the slot holding `constant` or the free slot where it belongs.
+static uint32_t *find_slot(const struct mcc_ir_module *module, const struct mcc_ir_constant *constant)
+{
+	uint32_t mask = module->constant_slot_capacity - 1;
+	for (uint32_t i = hash_constant(constant) & mask;; i = (i + 1) & mask) {
+		uint32_t *slot = &module->constant_slots[i];
+		if (*slot == 0 || constant_equals(&module->constants[*slot - 1], constant)) {
+			return slot;
+		}
+	}
+}
+
+static bool grow_slots(struct mcc_ir_module *module)
+{
+	uint32_t capacity = module->constant_slot_capacity ? module->constant_slot_capacity * 2 : 64;
+	uint32_t *slots = calloc(capacity, sizeof(*slots));
+	if (!slots) {
+		return false;
+	}
+
+	free(module->constant_slots);
+	module->constant_slots = slots;
+	module->constant_slot_capacity = capacity;
+
+	for (uint32_t i = 0; i < module->constant_count; ++i) {
+		*find_slot(module, &module->constants[i]) = i + 1;
+	}
+	return true;
+}
+
+uint32_t mcc_ir_add_constant(struct mcc_ir_module *module, const struct mcc_ir_constant *constant)
+{
+	assert(module);
+	assert(constant);
+	assert(constant->type != MCC_IR_TYPE_STRING || constant->s_value);
+
+	// keep the load factor below 1/2
+	if ((module->constant_count + 1) * 2 > module->constant_slot_capacity && !grow_slots(module)) {
+		return MCC_IR_OPERAND_MAX;
+	}
+
+	uint32_t *slot = find_slot(module, constant);
+	if (*slot) {
+		return *slot - 1;
+	}
+
+	if (!reserve_indexed((void **)&module->constants, &module->constant_capacity, module->constant_count, 1,
+	                     sizeof(*module->constants))) {
+		return MCC_IR_OPERAND_MAX;
+	}
+
+	struct mcc_ir_constant copy = *constant;
+	if (copy.type == MCC_IR_TYPE_STRING) {
+		copy.s_value = mcc_arena_strdup(&module->arena, constant->s_value);
+		if (!copy.s_value) {
+			return MCC_IR_OPERAND_MAX;
+		}
+	}
+
+	uint32_t index = module->constant_count++;
+	module->constants[index] = copy;
+	*slot = index + 1;
+	return index;
+}
+
+void mcc_ir_decode_string(char *out, const char *string)
+{
+	assert(out);
+	assert(string);
+
+	for (const char *c = string; *c;) {
+		if (*c != '\\') {
+			*out++ = *c++;
+			continue;
+		}
+
+		++c;
+		if (*c >= '0' && *c <= '7') {
+			int value = 0;
+			for (int digits = 0; digits < 3 && *c >= '0' && *c <= '7'; ++digits) {
+				value = value * 8 + (*c++ - '0');
+			}
+			*out++ = (char)value;
+		} else if (*c == 'x') {
+			int value = 0;
+			for (++c; isxdigit((unsigned char)*c); ++c) {
+				int digit = tolower((unsigned char)*c);
+				value = value * 16 + (isdigit(digit) ? digit - '0' : digit - 'a' + 10);
+			}
+			*out++ = (char)value;
+		} else if (*c) {
+			static const char escapes[] = "b\bf\fn\nr\rt\t";
+			const char *escape = strchr(escapes, *c);
+			*out++ = escape && (escape - escapes) % 2 == 0 ? escape[1] : *c;
+			++c;
+		}
+	}
+	*out = '\0';
+}
@@ -0,0 +1,582 @@
+#include "mcc/ir_lower.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "mcc/ast_visit.h"
+#include "mcc/symbol_table.h"
+
+// ------------------------------------------------------------------- Bindings
+
+// Maps declarations to virtual registers and function definitions to function
+// indices, keyed by the address of the AST node.
+struct binding {
+	const void *node;
+	uint32_t value;
+};
+
+struct bindings {
+	struct binding *slots;
+	size_t count;
+	size_t capacity;
+};
+
+static size_t hash_pointer(const void *node, size_t capacity)
+{
+	// Fibonacci hashing, the low bits of node addresses carry little entropy
+	return (size_t)(((uint64_t)(uintptr_t)node * UINT64_C(11400714819323198485)) >> 32) & (capacity - 1);
+}
+
+static struct binding *find_binding(const struct bindings *bindings, const void *node)
+{
+	for (size_t i = hash_pointer(node, bindings->capacity);; i = (i + 1) & (bindings->capacity - 1)) {
+		struct binding *binding = &bindings->slots[i];
+		if (!binding->node || binding->node == node) {
+			return binding;
+		}
+	}
+}
+
+static bool bind(struct bindings *bindings, const void *node, uint32_t value)
+{
+	// keep the load factor below 3/4
+	if ((bindings->count + 1) * 4 > bindings->capacity * 3) {
+		struct bindings grown = {.capacity = bindings->capacity ? bindings->capacity * 2 : 64};
+		grown.slots = calloc(grown.capacity, sizeof(*grown.slots));
+		if (!grown.slots) {
+			return false;
+		}
+		for (size_t i = 0; i < bindings->capacity; ++i) {
+			if (bindings->slots[i].node) {
+				*find_binding(&grown, bindings->slots[i].node) = bindings->slots[i];
+			}
+		}
+		grown.count = bindings->count;
+		free(bindings->slots);
+		*bindings = grown;
+	}
+
+	struct binding *binding = find_binding(bindings, node);
+	if (!binding->node) {
+		++bindings->count;
+	}
+	*binding = (struct binding){.node = node, .value = value};
+	return true;
+}
+
+static uint32_t lookup_binding(const struct bindings *bindings, const void *node)
+{
+	const struct binding *binding = find_binding(bindings, node);
+	assert(binding->node);
+	return binding->value;
+}
+
+// ------------------------------------------------------------------- Lowering
+
+struct lowering {
+	struct mcc_ir_module *module;
+	const struct mcc_type_check_result *types;
+
+	struct mcc_symbol_table table;
+	struct bindings bindings;
+
+	// value of each expression, indexed by `type_index`
+	mcc_ir_operand *values;
+
+	// shared by the traversals of all expression trees
+	struct mcc_ast_visit_stack stack;
+	struct mcc_ast_visitor visitor;
+
+	// index of the function being lowered
+	uint32_t function;
+
+	// cleared when running out of memory
+	bool ok;
+};
+
+static struct mcc_ir_function *current(struct lowering *lowering)
+{
+	return &lowering->module->functions[lowering->function];
+}
+
+static enum mcc_ir_type ir_type(enum mcc_ast_data_type type)
+{
+	switch (type) {
+	case MCC_AST_DATA_TYPE_INT:
+		return MCC_IR_TYPE_INT;
+	case MCC_AST_DATA_TYPE_STRING:
+		return MCC_IR_TYPE_STRING;
+	case MCC_AST_DATA_TYPE_BOOL:
+		return MCC_IR_TYPE_BOOL;
+	case MCC_AST_DATA_TYPE_FLOAT:
+		return MCC_IR_TYPE_FLOAT;
+	case MCC_AST_DATA_TYPE_VOID:
+		break;
+	}
+	return MCC_IR_TYPE_VOID;
+}
+
+static enum mcc_ir_type declaration_ir_type(const struct mcc_ast_declaration *declaration)
+{
+	return declaration->array_size ? MCC_IR_TYPE_ADDRESS : ir_type(declaration->type);
+}
+
+static enum mcc_ir_type expression_ir_type(const struct lowering *lowering, const struct mcc_ast_expression *expression)
+{
+	const struct mcc_type *type = mcc_type_check_type_of(lowering->types, expression);
+	return type->array_size >= 0 ? MCC_IR_TYPE_ADDRESS : ir_type(type->base);
+}
+
+static bool emit(struct lowering *lowering,
+                 enum mcc_ir_opcode opcode,
+                 enum mcc_ir_type type,
+                 mcc_ir_operand dest,
+                 mcc_ir_operand a,
+                 mcc_ir_operand b)
+{
+	struct mcc_ir_instruction instruction = {
+	    .opcode = (uint8_t)opcode,
+	    .type = (uint8_t)type,
+	    .dest = dest,
+	    .a = a,
+	    .b = b,
+	};
+	if (lowering->ok && !mcc_ir_emit(current(lowering), &instruction)) {
+		lowering->ok = false;
+	}
+	return lowering->ok;
+}
+
+// Returns a fresh virtual register, MCC_IR_NONE on failure.
+static mcc_ir_operand new_vreg(struct lowering *lowering, enum mcc_ir_type type)
+{
+	uint32_t vreg = mcc_ir_new_vreg(current(lowering), type);
+	if (vreg == MCC_IR_OPERAND_MAX) {
+		lowering->ok = false;
+		return MCC_IR_NONE;
+	}
+	return MCC_IR_VREG(vreg);
+}
+
+static mcc_ir_operand new_label(struct lowering *lowering)
+{
+	uint32_t label = mcc_ir_new_label(current(lowering));
+	if (label == MCC_IR_OPERAND_MAX) {
+		lowering->ok = false;
+		return MCC_IR_NONE;
+	}
+	return MCC_IR_IMM(label);
+}
+
+static mcc_ir_operand constant(struct lowering *lowering, const struct mcc_ir_constant *constant)
+{
+	uint32_t index = mcc_ir_add_constant(lowering->module, constant);
+	if (index == MCC_IR_OPERAND_MAX) {
+		lowering->ok = false;
+		return MCC_IR_NONE;
+	}
+	return MCC_IR_CONST(index);
+}
+
+// Returns the register of the variable `identifier` refers to.
+static mcc_ir_operand variable(struct lowering *lowering, const struct mcc_ast_identifier *identifier)
+{
+	const struct mcc_symbol *symbol = mcc_symbol_table_lookup(&lowering->table, identifier->i_value);
+	assert(symbol && (symbol->kind == MCC_SYMBOL_KIND_VARIABLE || symbol->kind == MCC_SYMBOL_KIND_PARAMETER));
+	return MCC_IR_VREG(lookup_binding(&lowering->bindings, symbol->declaration));
+}
+
+// ------------------------------------------------------------------- Expressions
+
+static enum mcc_ir_opcode binary_opcode(enum mcc_ast_binary_op op)
+{
+	switch (op) {
+	case MCC_AST_BINARY_OP_ADD:
+		return MCC_IR_ADD;
+	case MCC_AST_BINARY_OP_SUB:
+		return MCC_IR_SUB;
+	case MCC_AST_BINARY_OP_MUL:
+		return MCC_IR_MUL;
+	case MCC_AST_BINARY_OP_DIV:
+		return MCC_IR_DIV;
+	case MCC_AST_BINARY_OP_AND:
+		return MCC_IR_AND;
+	case MCC_AST_BINARY_OP_OR:
+		return MCC_IR_OR;
+	case MCC_AST_BINARY_OP_EQUALS:
+		return MCC_IR_EQ;
+	case MCC_AST_BINARY_OP_NOT_EQUALS:
+		return MCC_IR_NE;
+	case MCC_AST_BINARY_OP_LESS:
+		return MCC_IR_LT;
+	case MCC_AST_BINARY_OP_GREATER:
+		return MCC_IR_GT;
+	case MCC_AST_BINARY_OP_LESS_EQUALS:
+		return MCC_IR_LE;
+	case MCC_AST_BINARY_OP_GREATER_EQUALS:
+		return MCC_IR_GE;
+	}
+	return MCC_IR_NOP;
+}
+
+static mcc_ir_operand lower_literal(struct lowering *lowering, const struct mcc_ast_literal *literal)
+{
+	struct mcc_ir_constant value = {0};
+	switch (literal->type) {
+	case MCC_AST_LITERAL_TYPE_INT:
+		value.type = MCC_IR_TYPE_INT;
+		value.i_value = literal->i_value;
+		break;
+	case MCC_AST_LITERAL_TYPE_FLOAT:
+		value.type = MCC_IR_TYPE_FLOAT;
+		value.f_value = literal->f_value;
+		break;
+	case MCC_AST_LITERAL_TYPE_STRING:
+		value.type = MCC_IR_TYPE_STRING;
+		value.s_value = literal->s_value;
+		break;
+	case MCC_AST_LITERAL_TYPE_BOOL:
+		value.type = MCC_IR_TYPE_BOOL;
+		value.b_value = literal->b_value;
+		break;
+	}
+	return constant(lowering, &value);
+}
+
+static mcc_ir_operand lower_binary_op(struct lowering *lowering, struct mcc_ast_expression *expression)
+{
+	mcc_ir_operand lhs = lowering->values[expression->lhs->type_index];
+	mcc_ir_operand rhs = lowering->values[expression->rhs->type_index];
+
+	// comparisons are typed by their operands
+	enum mcc_ir_opcode opcode = binary_opcode(expression->op);
+	enum mcc_ir_type type = opcode >= MCC_IR_EQ && opcode <= MCC_IR_GE ? expression_ir_type(lowering, expression->lhs)
+	                                                                   : expression_ir_type(lowering, expression);
+
+	mcc_ir_operand dest = new_vreg(lowering, expression_ir_type(lowering, expression));
+	emit(lowering, opcode, type, dest, lhs, rhs);
+	return dest;
+}
+
+static mcc_ir_operand lower_call(struct lowering *lowering, struct mcc_ast_expression *expression)
+{
+	const struct mcc_symbol *symbol = mcc_symbol_table_lookup(&lowering->table, expression->function->i_value);
+	assert(symbol && (symbol->kind == MCC_SYMBOL_KIND_FUNCTION || symbol->kind == MCC_SYMBOL_KIND_BUILTIN));
+	uint32_t callee = lookup_binding(&lowering->bindings, symbol->function_def);
+
+	uint32_t count = 0;
+	for (const struct mcc_ast_argument *argument = expression->arguments; argument; argument = argument->next) {
+		emit(lowering, MCC_IR_ARG, expression_ir_type(lowering, argument->expression), MCC_IR_NONE,
+		     lowering->values[argument->expression->type_index], MCC_IR_NONE);
+		++count;
+	}
+
+	enum mcc_ir_type type = lowering->module->functions[callee].return_type;
+	mcc_ir_operand dest = type == MCC_IR_TYPE_VOID ? MCC_IR_NONE : new_vreg(lowering, type);
+	emit(lowering, MCC_IR_CALL, type, dest, MCC_IR_IMM(callee), MCC_IR_IMM(count));
+	return dest;
+}
+
+// Post-order callback: the values of all operands are known at this point.
+static void lower_expression(struct mcc_ast_expression *expression, void *data)
+{
+	struct lowering *lowering = data;
+	if (!lowering->ok) {
+		return;
+	}
+
+	mcc_ir_operand value = MCC_IR_NONE;
+
+	switch (expression->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		value = lower_literal(lowering, expression->literal);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		value = lower_binary_op(lowering, expression);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP: {
+		enum mcc_ir_type type = expression_ir_type(lowering, expression);
+		value = new_vreg(lowering, type);
+		emit(lowering, expression->up == MCC_AST_UNARY_OP_NOT ? MCC_IR_NOT : MCC_IR_NEG, type, value,
+		     lowering->values[expression->rhs->type_index], MCC_IR_NONE);
+		break;
+	}
+
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		value = lowering->values[expression->expression->type_index];
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+		value = variable(lowering, expression->identifier);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT: {
+		enum mcc_ir_type type = expression_ir_type(lowering, expression);
+		value = new_vreg(lowering, type);
+		emit(lowering, MCC_IR_LOAD, type, value, variable(lowering, expression->array),
+		     lowering->values[expression->index->type_index]);
+		break;
+	}
+
+	case MCC_AST_EXPRESSION_TYPE_CALL:
+		value = lower_call(lowering, expression);
+		break;
+
+	case MCC_AST_STATEMENT_TYPE_EXPR:
+		break;
+	}
+
+	lowering->values[expression->type_index] = value;
+}
+
+// Lowers the tree rooted at `expression` and returns its value.
+static mcc_ir_operand lower_expression_tree(struct lowering *lowering, struct mcc_ast_expression *expression)
+{
+	if (lowering->ok && !mcc_ast_visit(expression, &lowering->visitor)) {
+		lowering->ok = false;
+	}
+	return lowering->ok ? lowering->values[expression->type_index] : MCC_IR_NONE;
+}
+
+// ------------------------------------------------------------------- Statements
+
+static bool
+declare_variable(struct lowering *lowering, enum mcc_symbol_kind kind, struct mcc_ast_declaration *declaration)
+{
+	mcc_ir_operand vreg = new_vreg(lowering, declaration_ir_type(declaration));
+	if (!lowering->ok || !bind(&lowering->bindings, declaration, MCC_IR_OPERAND_INDEX(vreg)) ||
+	    mcc_symbol_table_declare_variable(&lowering->table, kind, declaration, NULL) != MCC_SYMBOL_TABLE_OK) {
+		lowering->ok = false;
+		return false;
+	}
+
+	if (kind == MCC_SYMBOL_KIND_VARIABLE && declaration->array_size) {
+		enum mcc_ir_type element_type = ir_type(declaration->type);
+		uint32_t array =
+		    mcc_ir_add_array(current(lowering), element_type, (uint32_t)declaration->array_size->i_value);
+		if (array == MCC_IR_OPERAND_MAX) {
+			lowering->ok = false;
+			return false;
+		}
+		return emit(lowering, MCC_IR_ARRAY, element_type, vreg, MCC_IR_IMM(array), MCC_IR_NONE);
+	}
+	return true;
+}
+
+static bool lower_statement(struct lowering *lowering, struct mcc_ast_statement *statement);
+
+static bool lower_statement_list(struct lowering *lowering, struct mcc_ast_statement_list *list)
+{
+	for (; list && lowering->ok; list = list->next) {
+		lower_statement(lowering, list->statement);
+	}
+	return lowering->ok;
+}
+
+static bool lower_if(struct lowering *lowering, struct mcc_ast_statement *statement)
+{
+	mcc_ir_operand condition = lower_expression_tree(lowering, statement->if_condition);
+	mcc_ir_operand else_label = new_label(lowering);
+	emit(lowering, MCC_IR_JUMP_IF_FALSE, MCC_IR_TYPE_BOOL, MCC_IR_NONE, condition, else_label);
+	lower_statement(lowering, statement->if_stmt);
+
+	if (!statement->else_stmt) {
+		return emit(lowering, MCC_IR_LABEL, MCC_IR_TYPE_VOID, MCC_IR_NONE, else_label, MCC_IR_NONE);
+	}
+
+	mcc_ir_operand end_label = new_label(lowering);
+	emit(lowering, MCC_IR_JUMP, MCC_IR_TYPE_VOID, MCC_IR_NONE, end_label, MCC_IR_NONE);
+	emit(lowering, MCC_IR_LABEL, MCC_IR_TYPE_VOID, MCC_IR_NONE, else_label, MCC_IR_NONE);
+	lower_statement(lowering, statement->else_stmt);
+	return emit(lowering, MCC_IR_LABEL, MCC_IR_TYPE_VOID, MCC_IR_NONE, end_label, MCC_IR_NONE);
+}
+
+static bool lower_while(struct lowering *lowering, struct mcc_ast_statement *statement)
+{
+	mcc_ir_operand head_label = new_label(lowering);
+	mcc_ir_operand end_label = new_label(lowering);
+
+	emit(lowering, MCC_IR_LABEL, MCC_IR_TYPE_VOID, MCC_IR_NONE, head_label, MCC_IR_NONE);
+	mcc_ir_operand condition = lower_expression_tree(lowering, statement->while_condition);
+	emit(lowering, MCC_IR_JUMP_IF_FALSE, MCC_IR_TYPE_BOOL, MCC_IR_NONE, condition, end_label);
+	lower_statement(lowering, statement->while_stmt);
+	emit(lowering, MCC_IR_JUMP, MCC_IR_TYPE_VOID, MCC_IR_NONE, head_label, MCC_IR_NONE);
+	return emit(lowering, MCC_IR_LABEL, MCC_IR_TYPE_VOID, MCC_IR_NONE, end_label, MCC_IR_NONE);
+}
+
+static bool lower_assignment(struct lowering *lowering, struct mcc_ast_statement *statement)
+{
+	mcc_ir_operand target = variable(lowering, statement->id_assgn);
+
+	if (statement->lhs_assgn) {
+		mcc_ir_operand index = lower_expression_tree(lowering, statement->lhs_assgn);
+		mcc_ir_operand value = lower_expression_tree(lowering, statement->rhs_assgn);
+		return emit(lowering, MCC_IR_STORE, expression_ir_type(lowering, statement->rhs_assgn), target, index,
+		            value);
+	}
+
+	mcc_ir_operand value = lower_expression_tree(lowering, statement->rhs_assgn);
+	return emit(lowering, MCC_IR_COPY, expression_ir_type(lowering, statement->rhs_assgn), target, value,
+	            MCC_IR_NONE);
+}
+
+static bool lower_statement(struct lowering *lowering, struct mcc_ast_statement *statement)
+{
+	switch (statement->type) {
+	case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+		lower_expression_tree(lowering, statement->expression);
+		return lowering->ok;
+
+	case MCC_AST_STATEMENT_TYPE_IF:
+		return lower_if(lowering, statement);
+
+	case MCC_AST_STATEMENT_TYPE_WHILE:
+		return lower_while(lowering, statement);
+
+	case MCC_AST_STATEMENT_TYPE_DECL:
+		return declare_variable(lowering, MCC_SYMBOL_KIND_VARIABLE, statement->declaration);
+
+	case MCC_AST_STATEMENT_TYPE_ASSGN:
+		return lower_assignment(lowering, statement);
+
+	case MCC_AST_STATEMENT_TYPE_COMPOUND: {
+		if (!mcc_symbol_table_push_scope(&lowering->table)) {
+			lowering->ok = false;
+			return false;
+		}
+		lower_statement_list(lowering, statement->compound_statement);
+		mcc_symbol_table_pop_scope(&lowering->table);
+		return lowering->ok;
+	}
+
+	case MCC_AST_STATEMENT_TYPE_RETURN: {
+		if (!statement->return_value) {
+			return emit(lowering, MCC_IR_RETURN, MCC_IR_TYPE_VOID, MCC_IR_NONE, MCC_IR_NONE, MCC_IR_NONE);
+		}
+		mcc_ir_operand value = lower_expression_tree(lowering, statement->return_value);
+		return emit(lowering, MCC_IR_RETURN, current(lowering)->return_type, MCC_IR_NONE, value, MCC_IR_NONE);
+	}
+	}
+	return lowering->ok;
+}
+
+// ------------------------------------------------------------------- Functions
+
+// Appends a `return` unless the function already ends with one. The value
+// returned by a non-void function falling off its end is unspecified; zero
+// is used.
+static bool terminate(struct lowering *lowering)
+{
+	const struct mcc_ir_function *function = current(lowering);
+	if (function->instruction_count > 0 &&
+	    function->instructions[function->instruction_count - 1].opcode == MCC_IR_RETURN) {
+		return true;
+	}
+
+	enum mcc_ir_type type = function->return_type;
+	struct mcc_ir_constant zero = {.type = type};
+	if (type == MCC_IR_TYPE_STRING) {
+		zero.s_value = "";
+	}
+	mcc_ir_operand value = type == MCC_IR_TYPE_VOID ? MCC_IR_NONE : constant(lowering, &zero);
+	return emit(lowering, MCC_IR_RETURN, type, MCC_IR_NONE, value, MCC_IR_NONE);
+}
+
+static bool lower_function(struct lowering *lowering, struct mcc_ast_function_def *function_def)
+{
+	lowering->function = lookup_binding(&lowering->bindings, function_def);
+
+	if (!mcc_symbol_table_push_scope(&lowering->table)) {
+		lowering->ok = false;
+		return false;
+	}
+
+	// parameter registers were allocated along with the function
+	uint32_t vreg = 0;
+	for (struct mcc_ast_parameter *p = function_def->parameter; p && lowering->ok; p = p->next) {
+		if (!bind(&lowering->bindings, p->declaration, vreg++) ||
+		    mcc_symbol_table_declare_variable(&lowering->table, MCC_SYMBOL_KIND_PARAMETER, p->declaration,
+		                                      NULL) != MCC_SYMBOL_TABLE_OK) {
+			lowering->ok = false;
+		}
+	}
+
+	// The outermost block shares the scope of the parameters.
+	lower_statement_list(lowering, function_def->compund_statement->compound_statement);
+	mcc_symbol_table_pop_scope(&lowering->table);
+
+	return lowering->ok && terminate(lowering);
+}
+
+// Adds a function for every global symbol, in declaration order.
+static bool add_functions(struct lowering *lowering)
+{
+	size_t count;
+	const struct mcc_symbol *const *symbols = mcc_symbol_table_scope(&lowering->table, &count);
+
+	for (size_t i = 0; i < count; ++i) {
+		const struct mcc_ast_function_def *function_def = symbols[i]->function_def;
+		uint32_t index = mcc_ir_add_function(lowering->module, symbols[i]->name, ir_type(function_def->type));
+		if (index == MCC_IR_OPERAND_MAX || !bind(&lowering->bindings, function_def, index)) {
+			return false;
+		}
+
+		struct mcc_ir_function *function = &lowering->module->functions[index];
+		function->builtin = symbols[i]->kind == MCC_SYMBOL_KIND_BUILTIN;
+		for (const struct mcc_ast_parameter *p = function_def->parameter; p; p = p->next) {
+			if (mcc_ir_new_vreg(function, declaration_ir_type(p->declaration)) == MCC_IR_OPERAND_MAX) {
+				return false;
+			}
+			++function->parameter_count;
+		}
+	}
+	return true;
+}
+
+bool mcc_ir_lower(struct mcc_ir_module *module,
+                  struct mcc_ast_program *program,
+                  const struct mcc_type_check_result *types)
+{
+	assert(module);
+	assert(program);
+	assert(types);
+	assert(types->status == MCC_TYPE_CHECK_OK);
+	assert(module->function_count == 0);
+
+	struct lowering lowering = {
+	    .module = module,
+	    .types = types,
+	    .visitor =
+	        {
+	            .traversal = MCC_AST_VISIT_DEPTH_FIRST,
+	            .order = MCC_AST_VISIT_POST_ORDER,
+	            .expression = lower_expression,
+	        },
+	    .ok = true,
+	};
+	lowering.visitor.stack = &lowering.stack;
+	lowering.visitor.userdata = &lowering;
+	mcc_symbol_table_init(&lowering.table);
+
+	lowering.values = malloc((types->entry_count ? types->entry_count : 1) * sizeof(*lowering.values));
+	lowering.ok = lowering.values && mcc_symbol_table_declare_builtins(&lowering.table) == MCC_SYMBOL_TABLE_OK;
+
+	for (struct mcc_ast_function_def *f = program->function_def; f && lowering.ok; f = f->next) {
+		lowering.ok = mcc_symbol_table_declare_function(&lowering.table, MCC_SYMBOL_KIND_FUNCTION, f, NULL) ==
+		              MCC_SYMBOL_TABLE_OK;
+	}
+
+	lowering.ok = lowering.ok && add_functions(&lowering);
+
+	for (struct mcc_ast_function_def *f = program->function_def; f && lowering.ok; f = f->next) {
+		lower_function(&lowering, f);
+	}
+
+	free(lowering.values);
+	free(lowering.bindings.slots);
+	mcc_ast_visit_stack_release(&lowering.stack);
+	mcc_symbol_table_release(&lowering.table);
+	return lowering.ok;
+}
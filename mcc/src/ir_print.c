@@ -0,0 +1,329 @@
+#include "mcc/ir_print.h"
+
+#include <assert.h>
+#include <string.h>
+
+const char *mcc_ir_print_opcode(enum mcc_ir_opcode opcode)
+{
+	switch (opcode) {
+	case MCC_IR_NOP:
+		return "nop";
+	case MCC_IR_COPY:
+		return "copy";
+	case MCC_IR_PHI:
+		return "phi";
+	case MCC_IR_ADD:
+		return "add";
+	case MCC_IR_SUB:
+		return "sub";
+	case MCC_IR_MUL:
+		return "mul";
+	case MCC_IR_DIV:
+		return "div";
+	case MCC_IR_NEG:
+		return "neg";
+	case MCC_IR_EQ:
+		return "eq";
+	case MCC_IR_NE:
+		return "ne";
+	case MCC_IR_LT:
+		return "lt";
+	case MCC_IR_GT:
+		return "gt";
+	case MCC_IR_LE:
+		return "le";
+	case MCC_IR_GE:
+		return "ge";
+	case MCC_IR_AND:
+		return "and";
+	case MCC_IR_OR:
+		return "or";
+	case MCC_IR_NOT:
+		return "not";
+	case MCC_IR_ARRAY:
+		return "array";
+	case MCC_IR_LOAD:
+		return "load";
+	case MCC_IR_STORE:
+		return "store";
+	case MCC_IR_SPLAT:
+		return "splat";
+	case MCC_IR_VLOAD:
+		return "vload";
+	case MCC_IR_VSTORE:
+		return "vstore";
+	case MCC_IR_LABEL:
+		return "label";
+	case MCC_IR_JUMP:
+		return "goto";
+	case MCC_IR_JUMP_IF_FALSE:
+		return "ifz";
+	case MCC_IR_JUMP_IF_TRUE:
+		return "ifnz";
+	case MCC_IR_ARG:
+		return "arg";
+	case MCC_IR_CALL:
+		return "call";
+	case MCC_IR_RETURN:
+		return "return";
+	}
+	return "?";
+}
+
+const char *mcc_ir_print_type(enum mcc_ir_type type)
+{
+	switch (type) {
+	case MCC_IR_TYPE_VOID:
+		return "void";
+	case MCC_IR_TYPE_INT:
+		return "int";
+	case MCC_IR_TYPE_FLOAT:
+		return "float";
+	case MCC_IR_TYPE_BOOL:
+		return "bool";
+	case MCC_IR_TYPE_STRING:
+		return "string";
+	case MCC_IR_TYPE_ADDRESS:
+		return "address";
+	case MCC_IR_TYPE_INT4:
+		return "int4";
+	case MCC_IR_TYPE_FLOAT4:
+		return "float4";
+	}
+	return "?";
+}
+
+static void print_string(FILE *out, const char *str)
+{
+	fputc('"', out);
+	for (; *str; ++str) {
+		switch (*str) {
+		case '\n':
+			fputs("\\n", out);
+			break;
+		case '\t':
+			fputs("\\t", out);
+			break;
+		case '"':
+		case '\\':
+			fputc('\\', out);
+			fputc(*str, out);
+			break;
+		default:
+			fputc(*str, out);
+		}
+	}
+	fputc('"', out);
+}
+
+static void print_constant(FILE *out, const struct mcc_ir_constant *constant)
+{
+	switch (constant->type) {
+	case MCC_IR_TYPE_INT:
+		fprintf(out, "%ld", constant->i_value);
+		break;
+
+	case MCC_IR_TYPE_FLOAT: {
+		// always print a decimal point to tell floats from ints
+		char buf[64];
+		snprintf(buf, sizeof(buf), "%.9g", constant->f_value);
+		fputs(buf, out);
+		if (!strpbrk(buf, ".eEn")) {
+			fputs(".0", out);
+		}
+		break;
+	}
+
+	case MCC_IR_TYPE_BOOL:
+		fputs(constant->b_value ? "true" : "false", out);
+		break;
+
+	case MCC_IR_TYPE_STRING:
+		print_string(out, constant->s_value);
+		break;
+
+	case MCC_IR_TYPE_VOID:
+	case MCC_IR_TYPE_ADDRESS:
+	case MCC_IR_TYPE_INT4:
+	case MCC_IR_TYPE_FLOAT4:
+		fputs("?", out);
+		break;
+	}
+}
+
+void mcc_ir_print_operand(FILE *out, const struct mcc_ir_module *module, mcc_ir_operand operand)
+{
+	assert(out);
+	assert(module);
+
+	uint32_t index = MCC_IR_OPERAND_INDEX(operand);
+	switch (MCC_IR_OPERAND_KIND(operand)) {
+	case MCC_IR_OPERAND_NONE:
+		fputs("_", out);
+		break;
+	case MCC_IR_OPERAND_VREG:
+		fprintf(out, "t%u", index);
+		break;
+	case MCC_IR_OPERAND_CONST:
+		assert(index < module->constant_count);
+		print_constant(out, &module->constants[index]);
+		break;
+	case MCC_IR_OPERAND_IMM:
+		fprintf(out, "%u", index);
+		break;
+	}
+}
+
+void mcc_ir_print_instruction(FILE *out,
+                              const struct mcc_ir_module *module,
+                              const struct mcc_ir_function *function,
+                              const struct mcc_ir_instruction *instruction)
+{
+	assert(out);
+	assert(module);
+	assert(function);
+	assert(instruction);
+
+	enum mcc_ir_opcode opcode = instruction->opcode;
+	const char *type = mcc_ir_print_type(instruction->type);
+
+	switch (opcode) {
+	case MCC_IR_LABEL:
+		fprintf(out, "L%u:", MCC_IR_OPERAND_INDEX(instruction->a));
+		return;
+
+	case MCC_IR_JUMP:
+		fprintf(out, "goto L%u", MCC_IR_OPERAND_INDEX(instruction->a));
+		return;
+
+	case MCC_IR_JUMP_IF_FALSE:
+	case MCC_IR_JUMP_IF_TRUE:
+		fprintf(out, "%s ", mcc_ir_print_opcode(opcode));
+		mcc_ir_print_operand(out, module, instruction->a);
+		fprintf(out, " goto L%u", MCC_IR_OPERAND_INDEX(instruction->b));
+		return;
+
+	case MCC_IR_ARRAY:
+		mcc_ir_print_operand(out, module, instruction->dest);
+		fprintf(out, " = array %s #%u", type, MCC_IR_OPERAND_INDEX(instruction->a));
+		return;
+
+	case MCC_IR_LOAD:
+	case MCC_IR_VLOAD:
+		mcc_ir_print_operand(out, module, instruction->dest);
+		fprintf(out, " = %s %s ", mcc_ir_print_opcode(opcode), type);
+		mcc_ir_print_operand(out, module, instruction->a);
+		fputs("[", out);
+		mcc_ir_print_operand(out, module, instruction->b);
+		fputs("]", out);
+		return;
+
+	case MCC_IR_STORE:
+	case MCC_IR_VSTORE:
+		fprintf(out, "%s %s ", mcc_ir_print_opcode(opcode), type);
+		mcc_ir_print_operand(out, module, instruction->dest);
+		fputs("[", out);
+		mcc_ir_print_operand(out, module, instruction->a);
+		fputs("], ", out);
+		mcc_ir_print_operand(out, module, instruction->b);
+		return;
+
+	case MCC_IR_PHI: {
+		uint32_t first = MCC_IR_OPERAND_INDEX(instruction->a);
+		uint32_t count = MCC_IR_OPERAND_INDEX(instruction->b);
+		assert(first + count <= function->phi_operand_count);
+
+		mcc_ir_print_operand(out, module, instruction->dest);
+		fprintf(out, " = phi %s [", type);
+		for (uint32_t i = 0; i < count; ++i) {
+			fputs(i ? ", " : "", out);
+			mcc_ir_print_operand(out, module, function->phi_operands[first + i]);
+		}
+		fputs("]", out);
+		return;
+	}
+
+	case MCC_IR_CALL: {
+		uint32_t callee = MCC_IR_OPERAND_INDEX(instruction->a);
+		assert(callee < module->function_count);
+		if (instruction->dest != MCC_IR_NONE) {
+			mcc_ir_print_operand(out, module, instruction->dest);
+			fputs(" = ", out);
+		}
+		fprintf(out, "call %s %s, %u", type, module->functions[callee].name, MCC_IR_OPERAND_INDEX(instruction->b));
+		return;
+	}
+
+	case MCC_IR_RETURN:
+		if (instruction->a == MCC_IR_NONE) {
+			fputs("return", out);
+			return;
+		}
+		break;
+
+	default:
+		break;
+	}
+
+	// generic form: [dest = ]opcode type a[, b]
+	if (instruction->dest != MCC_IR_NONE) {
+		mcc_ir_print_operand(out, module, instruction->dest);
+		fputs(" = ", out);
+	}
+	fprintf(out, "%s %s", mcc_ir_print_opcode(opcode), type);
+	if (instruction->a != MCC_IR_NONE) {
+		fputs(" ", out);
+		mcc_ir_print_operand(out, module, instruction->a);
+	}
+	if (instruction->b != MCC_IR_NONE) {
+		fputs(", ", out);
+		mcc_ir_print_operand(out, module, instruction->b);
+	}
+}
+
+void mcc_ir_print_function(FILE *out, const struct mcc_ir_module *module, const struct mcc_ir_function *function)
+{
+	assert(out);
+	assert(module);
+	assert(function);
+
+	fprintf(out, "function %s %s(", mcc_ir_print_type(function->return_type), function->name);
+	for (uint32_t i = 0; i < function->parameter_count; ++i) {
+		fprintf(out, "%s%s t%u", i ? ", " : "", mcc_ir_print_type(function->vreg_types[i]), i);
+	}
+	fputs(")\n", out);
+
+	for (uint32_t i = 0; i < function->array_count; ++i) {
+		const struct mcc_ir_array *array = &function->arrays[i];
+		fprintf(out, "    array #%u: %s[%u]\n", i, mcc_ir_print_type(array->element_type), array->size);
+	}
+
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		if (instruction->opcode != MCC_IR_LABEL) {
+			fputs("    ", out);
+		}
+		mcc_ir_print_instruction(out, module, function, instruction);
+		fputs("\n", out);
+	}
+}
+
+void mcc_ir_print(FILE *out, const struct mcc_ir_module *module, const char *function)
+{
+	assert(out);
+	assert(module);
+
+	bool first = true;
+	for (uint32_t i = 0; i < module->function_count; ++i) {
+		const struct mcc_ir_function *f = &module->functions[i];
+		if (f->builtin || (function && strcmp(function, f->name) != 0)) {
+			continue;
+		}
+
+		if (!first) {
+			fputs("\n", out);
+		}
+		first = false;
+		mcc_ir_print_function(out, module, f);
+	}
+}
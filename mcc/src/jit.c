@@ -0,0 +1,963 @@
+// MAP_ANONYMOUS
+#define _DEFAULT_SOURCE
+
+#include "mcc/jit.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "utils/reserve.h"
+
+#ifdef __x86_64__
+
+// ------------------------------------------------------------------- Emitter
+
+enum {
+	RAX = 0,
+	RCX = 1,
+	RDX = 2,
+	RSP = 4,
+	RBP = 5,
+	RSI = 6,
+	RDI = 7,
+};
+
+// Registers of the integer arguments of built-in functions, the first four of
+// the System V ABI which need no REX prefix.
+static const int argument_registers[] = {RDI, RSI, RDX, RCX};
+
+// Number of float arguments of built-in functions passed in SSE registers.
+#define FLOAT_ARGUMENT_REGISTERS 8
+
+#define SLOT_SIZE 8
+#define VECTOR_SLOT_SIZE 16
+#define ELEMENT_SIZE 4
+
+// Frame offset of the first parameter, above the saved rbp and the return
+// address.
+#define PARAMETER_OFFSET 16
+
+#define STACK_ALIGNMENT 16
+
+#define ALIGN(size) (((size) + STACK_ALIGNMENT - 1) / STACK_ALIGNMENT * STACK_ALIGNMENT)
+
+// A 32-bit displacement to `target`, a label, function or string depending on
+// the list holding it.
+struct fixup {
+	uint32_t offset;
+	uint32_t target;
+};
+
+struct fixups {
+	struct fixup *entries;
+	uint32_t count;
+	uint32_t capacity;
+};
+
+struct compiler {
+	const struct mcc_ir_module *module;
+	const struct mcc_ir_function *function;
+	const struct mcc_jit_symbol *symbols;
+	uint32_t symbol_count;
+
+	uint8_t *code;
+	uint32_t code_size;
+	uint32_t code_capacity;
+
+	// decoded strings, placed after the code
+	char *data;
+	uint32_t data_size;
+	uint32_t data_capacity;
+
+	// offset in `data` of each string constant, UINT32_MAX until used
+	uint32_t *string_offsets;
+
+	uint32_t *function_offsets;
+	struct fixups calls;
+	struct fixups strings;
+
+	// frame offsets from rbp of the registers and arrays of the function, and
+	// the offsets of its labels
+	int32_t *offsets;
+	int32_t *array_offsets;
+	uint32_t *label_offsets;
+	struct fixups jumps;
+
+	// the pending call: stack reserved for its arguments, arguments passed
+	// and, for built-in functions, the registers used
+	uint32_t argument_bytes;
+	uint32_t argument_count;
+	bool builtin_call;
+	uint32_t int_arguments;
+	uint32_t float_arguments;
+
+	const char *undefined_symbol;
+	bool unsupported;
+	bool failed;
+};
+
+static void emit_bytes(struct compiler *c, const uint8_t *bytes, uint32_t count)
+{
+	if (c->failed) {
+		return;
+	}
+	if (!reserve((void **)&c->code, &c->code_capacity, c->code_size, count, 1)) {
+		c->failed = true;
+		return;
+	}
+	memcpy(c->code + c->code_size, bytes, count);
+	c->code_size += count;
+}
+
+#define EMIT(c, ...) emit_bytes(c, (const uint8_t[]){__VA_ARGS__}, sizeof((const uint8_t[]){__VA_ARGS__}))
+
+static void emit_imm32(struct compiler *c, uint32_t value)
+{
+	EMIT(c, (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24));
+}
+
+static void emit_imm64(struct compiler *c, uint64_t value)
+{
+	emit_imm32(c, (uint32_t)value);
+	emit_imm32(c, (uint32_t)(value >> 32));
+}
+
+// Emits a 32-bit displacement patched later with `target`.
+static void emit_fixup(struct compiler *c, struct fixups *fixups, uint32_t target)
+{
+	if (!reserve((void **)&fixups->entries, &fixups->capacity, fixups->count, 1, sizeof(*fixups->entries))) {
+		c->failed = true;
+		return;
+	}
+	fixups->entries[fixups->count++] = (struct fixup){c->code_size, target};
+	emit_imm32(c, 0);
+}
+
+static void patch(struct compiler *c, uint32_t offset, uint32_t target)
+{
+	uint32_t displacement = target - (offset + 4);
+	for (int i = 0; i < 4; ++i) {
+		c->code[offset + i] = (uint8_t)(displacement >> (8 * i));
+	}
+}
+
+// Emits the ModRM byte addressing [rbp + offset] with `reg` in the reg field.
+static void frame_operand(struct compiler *c, int reg, int32_t offset)
+{
+	if (offset >= INT8_MIN && offset <= INT8_MAX) {
+		EMIT(c, (uint8_t)(0x45 | reg << 3), (uint8_t)offset);
+	} else {
+		EMIT(c, (uint8_t)(0x85 | reg << 3));
+		emit_imm32(c, (uint32_t)offset);
+	}
+}
+
+// Emits the ModRM and SIB bytes addressing [rax + rcx * 4].
+static void element_operand(struct compiler *c, int reg)
+{
+	EMIT(c, (uint8_t)(0x04 | reg << 3), 0x88);
+}
+
+// ------------------------------------------------------------------ Operands
+
+static const struct mcc_ir_constant *constant_of(const struct compiler *c, mcc_ir_operand operand)
+{
+	if (MCC_IR_OPERAND_KIND(operand) != MCC_IR_OPERAND_CONST) {
+		return NULL;
+	}
+	return &c->module->constants[MCC_IR_OPERAND_INDEX(operand)];
+}
+
+static int32_t offset_of(const struct compiler *c, mcc_ir_operand operand)
+{
+	assert(MCC_IR_IS_VREG(operand));
+	return c->offsets[MCC_IR_OPERAND_INDEX(operand)];
+}
+
+// Whether the register `operand` holds a 64-bit pointer.
+static bool is_pointer(const struct compiler *c, mcc_ir_operand operand)
+{
+	enum mcc_ir_type type = c->function->vreg_types[MCC_IR_OPERAND_INDEX(operand)];
+	return type == MCC_IR_TYPE_STRING || type == MCC_IR_TYPE_ADDRESS;
+}
+
+// Returns the offset of the decoded string constant `index` in the data.
+static uint32_t string_offset(struct compiler *c, uint32_t index)
+{
+	if (c->string_offsets[index] != UINT32_MAX) {
+		return c->string_offsets[index];
+	}
+
+	const char *string = c->module->constants[index].s_value;
+	uint32_t size = (uint32_t)strlen(string) + 1;
+	if (!reserve((void **)&c->data, &c->data_capacity, c->data_size, size, 1)) {
+		c->failed = true;
+		return 0;
+	}
+
+	mcc_ir_decode_string(c->data + c->data_size, string);
+	c->string_offsets[index] = c->data_size;
+	c->data_size += (uint32_t)strlen(c->data + c->data_size) + 1;
+	return c->string_offsets[index];
+}
+
+// Loads the scalar `operand` into the general register `reg`. Pointers take
+// all 64 bits, other values 32 bits, sign extended to 64 if `extend` is set;
+// floats are loaded as their bits.
+static void load(struct compiler *c, int reg, mcc_ir_operand operand, bool extend)
+{
+	const struct mcc_ir_constant *constant = constant_of(c, operand);
+	if (!constant) {
+		if (is_pointer(c, operand)) {
+			EMIT(c, 0x48, 0x8B);
+		} else if (extend) {
+			EMIT(c, 0x48, 0x63);
+		} else {
+			EMIT(c, 0x8B);
+		}
+		frame_operand(c, reg, offset_of(c, operand));
+		return;
+	}
+
+	uint32_t value;
+	switch (constant->type) {
+	case MCC_IR_TYPE_STRING:
+		// lea reg, [rip + string]
+		EMIT(c, 0x48, 0x8D, (uint8_t)(0x05 | reg << 3));
+		emit_fixup(c, &c->strings, string_offset(c, MCC_IR_OPERAND_INDEX(operand)));
+		return;
+	case MCC_IR_TYPE_FLOAT: {
+		float f = (float)constant->f_value;
+		memcpy(&value, &f, sizeof(value));
+		break;
+	}
+	case MCC_IR_TYPE_BOOL:
+		value = constant->b_value;
+		break;
+	default:
+		value = (uint32_t)(int32_t)constant->i_value;
+	}
+
+	if (extend) {
+		EMIT(c, 0x48, 0xC7, (uint8_t)(0xC0 | reg));
+	} else {
+		EMIT(c, (uint8_t)(0xB8 + reg));
+	}
+	emit_imm32(c, value);
+}
+
+static void store(struct compiler *c, mcc_ir_operand dest, int reg)
+{
+	if (is_pointer(c, dest)) {
+		EMIT(c, 0x48);
+	}
+	EMIT(c, 0x89);
+	frame_operand(c, reg, offset_of(c, dest));
+}
+
+static void load_float(struct compiler *c, int xmm, mcc_ir_operand operand)
+{
+	if (constant_of(c, operand)) {
+		// movd xmm, eax
+		load(c, RAX, operand, false);
+		EMIT(c, 0x66, 0x0F, 0x6E, (uint8_t)(0xC0 | xmm << 3));
+	} else {
+		EMIT(c, 0xF3, 0x0F, 0x10);
+		frame_operand(c, xmm, offset_of(c, operand));
+	}
+}
+
+static void store_float(struct compiler *c, mcc_ir_operand dest, int xmm)
+{
+	EMIT(c, 0xF3, 0x0F, 0x11);
+	frame_operand(c, xmm, offset_of(c, dest));
+}
+
+static void load_vector(struct compiler *c, int xmm, mcc_ir_operand operand)
+{
+	EMIT(c, 0x0F, 0x10);
+	frame_operand(c, xmm, offset_of(c, operand));
+}
+
+static void store_vector(struct compiler *c, mcc_ir_operand dest, int xmm)
+{
+	EMIT(c, 0x0F, 0x11);
+	frame_operand(c, xmm, offset_of(c, dest));
+}
+
+// Loads the address of an array into rax and the index of an element into
+// rcx, see element_operand.
+static void load_element(struct compiler *c, mcc_ir_operand address, mcc_ir_operand index)
+{
+	load(c, RAX, address, false);
+	load(c, RCX, index, true);
+}
+
+// ------------------------------------------------------------ Instructions
+
+static void emit_int_binary(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	load(c, RAX, instruction->a, false);
+	load(c, RCX, instruction->b, false);
+	switch (instruction->opcode) {
+	case MCC_IR_ADD:
+		EMIT(c, 0x01, 0xC8);
+		break;
+	case MCC_IR_SUB:
+		EMIT(c, 0x29, 0xC8);
+		break;
+	case MCC_IR_MUL:
+		EMIT(c, 0x0F, 0xAF, 0xC1);
+		break;
+	case MCC_IR_AND:
+		EMIT(c, 0x21, 0xC8);
+		break;
+	case MCC_IR_OR:
+		EMIT(c, 0x09, 0xC8);
+		break;
+	default:
+		// cdq, idiv ecx
+		EMIT(c, 0x99, 0xF7, 0xF9);
+	}
+	store(c, instruction->dest, RAX);
+}
+
+static void emit_float_binary(struct compiler *c, const struct mcc_ir_instruction *instruction, uint8_t prefix)
+{
+	uint8_t opcode;
+	switch (instruction->opcode) {
+	case MCC_IR_ADD:
+		opcode = 0x58;
+		break;
+	case MCC_IR_SUB:
+		opcode = 0x5C;
+		break;
+	case MCC_IR_MUL:
+		opcode = 0x59;
+		break;
+	default:
+		opcode = 0x5E;
+	}
+
+	if (prefix) {
+		load_float(c, 0, instruction->a);
+		load_float(c, 1, instruction->b);
+		EMIT(c, prefix, 0x0F, opcode, 0xC1);
+		store_float(c, instruction->dest, 0);
+	} else {
+		load_vector(c, 0, instruction->a);
+		load_vector(c, 1, instruction->b);
+		EMIT(c, 0x0F, opcode, 0xC1);
+		store_vector(c, instruction->dest, 0);
+	}
+}
+
+static void emit_int_vector_binary(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	load_vector(c, 0, instruction->a);
+	load_vector(c, 1, instruction->b);
+	// paddd or psubd xmm0, xmm1
+	EMIT(c, 0x66, 0x0F, instruction->opcode == MCC_IR_ADD ? 0xFE : 0xFA, 0xC1);
+	store_vector(c, instruction->dest, 0);
+}
+
+// Condition codes of setcc and jcc.
+enum {
+	CONDITION_E = 0x4,
+	CONDITION_NE = 0x5,
+	CONDITION_AE = 0x3,
+	CONDITION_A = 0x7,
+	CONDITION_P = 0xA,
+	CONDITION_NP = 0xB,
+	CONDITION_L = 0xC,
+	CONDITION_GE = 0xD,
+	CONDITION_LE = 0xE,
+	CONDITION_G = 0xF,
+};
+
+static void emit_int_comparison(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	uint8_t condition;
+	switch (instruction->opcode) {
+	case MCC_IR_EQ:
+		condition = CONDITION_E;
+		break;
+	case MCC_IR_NE:
+		condition = CONDITION_NE;
+		break;
+	case MCC_IR_LT:
+		condition = CONDITION_L;
+		break;
+	case MCC_IR_GT:
+		condition = CONDITION_G;
+		break;
+	case MCC_IR_LE:
+		condition = CONDITION_LE;
+		break;
+	default:
+		condition = CONDITION_GE;
+	}
+
+	load(c, RAX, instruction->a, false);
+	load(c, RCX, instruction->b, false);
+	// cmp eax, ecx; setcc al; movzx eax, al
+	EMIT(c, 0x39, 0xC8, 0x0F, (uint8_t)(0x90 + condition), 0xC0, 0x0F, 0xB6, 0xC0);
+	store(c, instruction->dest, RAX);
+}
+
+// Unordered operands, NaNs, compare false except for `ne`, like in the x86
+// backend.
+static void emit_float_comparison(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	// ucomiss sets the flags like an unsigned comparison; lt and le swap the
+	// operands to test above, which is false if unordered
+	enum mcc_ir_opcode opcode = instruction->opcode;
+	bool swap = opcode == MCC_IR_LT || opcode == MCC_IR_LE;
+	load_float(c, 0, swap ? instruction->b : instruction->a);
+	load_float(c, 1, swap ? instruction->a : instruction->b);
+	EMIT(c, 0x0F, 0x2E, 0xC1);
+
+	switch (opcode) {
+	case MCC_IR_EQ:
+		// sete al; setnp cl; and al, cl
+		EMIT(c, 0x0F, 0x90 + CONDITION_E, 0xC0, 0x0F, 0x90 + CONDITION_NP, 0xC1, 0x20, 0xC8);
+		break;
+	case MCC_IR_NE:
+		// setne al; setp cl; or al, cl
+		EMIT(c, 0x0F, 0x90 + CONDITION_NE, 0xC0, 0x0F, 0x90 + CONDITION_P, 0xC1, 0x08, 0xC8);
+		break;
+	case MCC_IR_LT:
+	case MCC_IR_GT:
+		EMIT(c, 0x0F, 0x90 + CONDITION_A, 0xC0);
+		break;
+	default:
+		EMIT(c, 0x0F, 0x90 + CONDITION_AE, 0xC0);
+	}
+	EMIT(c, 0x0F, 0xB6, 0xC0);
+	store(c, instruction->dest, RAX);
+}
+
+static void emit_copy(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	if (instruction->type == MCC_IR_TYPE_INT4 || instruction->type == MCC_IR_TYPE_FLOAT4) {
+		load_vector(c, 0, instruction->a);
+		store_vector(c, instruction->dest, 0);
+	} else {
+		load(c, RAX, instruction->a, false);
+		store(c, instruction->dest, RAX);
+	}
+}
+
+static void emit_negation(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	load(c, RAX, instruction->a, false);
+	if (instruction->type == MCC_IR_TYPE_FLOAT) {
+		// flip the sign bit, xor eax, 0x80000000
+		EMIT(c, 0x35, 0x00, 0x00, 0x00, 0x80);
+	} else {
+		EMIT(c, 0xF7, 0xD8);
+	}
+	store(c, instruction->dest, RAX);
+}
+
+static void emit_splat(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	if (instruction->type == MCC_IR_TYPE_FLOAT4) {
+		// shufps xmm0, xmm0, 0
+		load_float(c, 0, instruction->a);
+		EMIT(c, 0x0F, 0xC6, 0xC0, 0x00);
+	} else {
+		// movd xmm0, eax; pshufd xmm0, xmm0, 0
+		load(c, RAX, instruction->a, false);
+		EMIT(c, 0x66, 0x0F, 0x6E, 0xC0, 0x66, 0x0F, 0x70, 0xC0, 0x00);
+	}
+	store_vector(c, instruction->dest, 0);
+}
+
+static void emit_jump(struct compiler *c, uint8_t condition, mcc_ir_operand label)
+{
+	if (condition) {
+		EMIT(c, 0x0F, (uint8_t)(0x80 + condition));
+	} else {
+		EMIT(c, 0xE9);
+	}
+	emit_fixup(c, &c->jumps, MCC_IR_OPERAND_INDEX(label));
+}
+
+static void emit_conditional_jump(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	bool on_true = instruction->opcode == MCC_IR_JUMP_IF_TRUE;
+
+	const struct mcc_ir_constant *constant = constant_of(c, instruction->a);
+	if (constant) {
+		if (constant->b_value == on_true) {
+			emit_jump(c, 0, instruction->b);
+		}
+		return;
+	}
+
+	// cmp dword [rbp + offset], 0
+	EMIT(c, 0x83);
+	frame_operand(c, 7, offset_of(c, instruction->a));
+	EMIT(c, 0x00);
+	emit_jump(c, on_true ? CONDITION_NE : CONDITION_E, instruction->b);
+}
+
+static const struct mcc_jit_symbol *find_symbol(const struct compiler *c, const char *name)
+{
+	for (uint32_t s = 0; s < c->symbol_count; ++s) {
+		if (strcmp(c->symbols[s].name, name) == 0) {
+			return &c->symbols[s];
+		}
+	}
+	return NULL;
+}
+
+// Arguments of built-in functions are loaded into the registers of the
+// System V ABI, those of compiled functions are stored in a block reserved by
+// the first one.
+static void emit_argument(struct compiler *c, uint32_t index)
+{
+	const struct mcc_ir_function *function = c->function;
+	const struct mcc_ir_instruction *instruction = &function->instructions[index];
+
+	if (c->argument_count == 0) {
+		uint32_t count = 0;
+		while (function->instructions[index + count].opcode == MCC_IR_ARG) {
+			++count;
+		}
+		const struct mcc_ir_instruction *call = &function->instructions[index + count];
+		assert(call->opcode == MCC_IR_CALL);
+
+		c->builtin_call = c->module->functions[MCC_IR_OPERAND_INDEX(call->a)].builtin;
+		c->int_arguments = 0;
+		c->float_arguments = 0;
+		c->argument_bytes = 0;
+		if (!c->builtin_call) {
+			// sub rsp, bytes
+			c->argument_bytes = ALIGN(count * SLOT_SIZE);
+			EMIT(c, 0x48, 0x81, 0xEC);
+			emit_imm32(c, c->argument_bytes);
+		}
+	}
+
+	uint32_t slot = c->argument_count++;
+	if (!c->builtin_call) {
+		// mov [rsp + slot * 8], rax
+		load(c, RAX, instruction->a, false);
+		EMIT(c, 0x48, 0x89, 0x84, 0x24);
+		emit_imm32(c, slot * SLOT_SIZE);
+	} else if (instruction->type == MCC_IR_TYPE_FLOAT) {
+		if (c->float_arguments == FLOAT_ARGUMENT_REGISTERS) {
+			c->unsupported = true;
+			return;
+		}
+		load_float(c, (int)c->float_arguments++, instruction->a);
+	} else {
+		// ints are passed as long
+		if (c->int_arguments == sizeof(argument_registers) / sizeof(*argument_registers)) {
+			c->unsupported = true;
+			return;
+		}
+		load(c, argument_registers[c->int_arguments++], instruction->a, true);
+	}
+}
+
+static void emit_call(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	const struct mcc_ir_function *callee = &c->module->functions[MCC_IR_OPERAND_INDEX(instruction->a)];
+
+	if (callee->builtin) {
+		const struct mcc_jit_symbol *symbol = find_symbol(c, callee->name);
+		if (!symbol) {
+			c->undefined_symbol = callee->name;
+			return;
+		}
+
+		// mov rax, address; call rax
+		uint64_t address;
+		memcpy(&address, &symbol->address, sizeof(address));
+		EMIT(c, 0x48, 0xB8);
+		emit_imm64(c, address);
+		EMIT(c, 0xFF, 0xD0);
+	} else {
+		EMIT(c, 0xE8);
+		emit_fixup(c, &c->calls, MCC_IR_OPERAND_INDEX(instruction->a));
+		if (c->argument_bytes) {
+			// add rsp, bytes
+			EMIT(c, 0x48, 0x81, 0xC4);
+			emit_imm32(c, c->argument_bytes);
+		}
+	}
+	c->argument_count = 0;
+	c->argument_bytes = 0;
+
+	if (instruction->dest == MCC_IR_NONE) {
+		return;
+	}
+	if (instruction->type == MCC_IR_TYPE_FLOAT) {
+		store_float(c, instruction->dest, 0);
+	} else {
+		store(c, instruction->dest, RAX);
+	}
+}
+
+static void emit_return(struct compiler *c, const struct mcc_ir_instruction *instruction)
+{
+	if (instruction->a != MCC_IR_NONE) {
+		if (c->function->return_type == MCC_IR_TYPE_FLOAT) {
+			load_float(c, 0, instruction->a);
+		} else {
+			load(c, RAX, instruction->a, false);
+		}
+	}
+	// leave; ret
+	EMIT(c, 0xC9, 0xC3);
+}
+
+static void emit_instruction(struct compiler *c, uint32_t index)
+{
+	const struct mcc_ir_instruction *instruction = &c->function->instructions[index];
+	bool is_float = instruction->type == MCC_IR_TYPE_FLOAT;
+	bool is_int_vector = instruction->type == MCC_IR_TYPE_INT4;
+	bool is_float_vector = instruction->type == MCC_IR_TYPE_FLOAT4;
+
+	switch ((enum mcc_ir_opcode)instruction->opcode) {
+	case MCC_IR_NOP:
+	case MCC_IR_PHI:
+		// phis are gone after destruction of the SSA form
+		assert(instruction->opcode == MCC_IR_NOP);
+		break;
+	case MCC_IR_COPY:
+		emit_copy(c, instruction);
+		break;
+	case MCC_IR_ADD:
+	case MCC_IR_SUB:
+	case MCC_IR_MUL:
+	case MCC_IR_DIV:
+		if (is_int_vector) {
+			emit_int_vector_binary(c, instruction);
+		} else if (is_float || is_float_vector) {
+			emit_float_binary(c, instruction, is_float ? 0xF3 : 0);
+		} else {
+			emit_int_binary(c, instruction);
+		}
+		break;
+	case MCC_IR_NEG:
+		emit_negation(c, instruction);
+		break;
+	case MCC_IR_EQ:
+	case MCC_IR_NE:
+	case MCC_IR_LT:
+	case MCC_IR_GT:
+	case MCC_IR_LE:
+	case MCC_IR_GE:
+		if (is_float) {
+			emit_float_comparison(c, instruction);
+		} else {
+			emit_int_comparison(c, instruction);
+		}
+		break;
+	case MCC_IR_AND:
+	case MCC_IR_OR:
+		emit_int_binary(c, instruction);
+		break;
+	case MCC_IR_NOT:
+		// xor eax, 1
+		load(c, RAX, instruction->a, false);
+		EMIT(c, 0x83, 0xF0, 0x01);
+		store(c, instruction->dest, RAX);
+		break;
+	case MCC_IR_ARRAY:
+		// lea rax, [rbp + offset]
+		EMIT(c, 0x48, 0x8D);
+		frame_operand(c, RAX, c->array_offsets[MCC_IR_OPERAND_INDEX(instruction->a)]);
+		store(c, instruction->dest, RAX);
+		break;
+	case MCC_IR_LOAD:
+		// mov edx, [rax + rcx * 4]
+		load_element(c, instruction->a, instruction->b);
+		EMIT(c, 0x8B);
+		element_operand(c, RDX);
+		store(c, instruction->dest, RDX);
+		break;
+	case MCC_IR_STORE:
+		// mov [rax + rcx * 4], edx
+		load_element(c, instruction->dest, instruction->a);
+		load(c, RDX, instruction->b, false);
+		EMIT(c, 0x89);
+		element_operand(c, RDX);
+		break;
+	case MCC_IR_SPLAT:
+		emit_splat(c, instruction);
+		break;
+	case MCC_IR_VLOAD:
+		// movups xmm0, [rax + rcx * 4]
+		load_element(c, instruction->a, instruction->b);
+		EMIT(c, 0x0F, 0x10);
+		element_operand(c, 0);
+		store_vector(c, instruction->dest, 0);
+		break;
+	case MCC_IR_VSTORE:
+		// movups [rax + rcx * 4], xmm0
+		load_element(c, instruction->dest, instruction->a);
+		load_vector(c, 0, instruction->b);
+		EMIT(c, 0x0F, 0x11);
+		element_operand(c, 0);
+		break;
+	case MCC_IR_LABEL:
+		c->label_offsets[MCC_IR_OPERAND_INDEX(instruction->a)] = c->code_size;
+		break;
+	case MCC_IR_JUMP:
+		emit_jump(c, 0, instruction->a);
+		break;
+	case MCC_IR_JUMP_IF_FALSE:
+	case MCC_IR_JUMP_IF_TRUE:
+		emit_conditional_jump(c, instruction);
+		break;
+	case MCC_IR_ARG:
+		emit_argument(c, index);
+		break;
+	case MCC_IR_CALL:
+		emit_call(c, instruction);
+		break;
+	case MCC_IR_RETURN:
+		emit_return(c, instruction);
+		break;
+	}
+}
+
+// ----------------------------------------------------------------- Functions
+
+// Lays out the stack frame: parameters are in the caller's frame, below rbp
+// are a slot for each other register, then the arrays. Returns the bytes to
+// reserve, keeping calls aligned.
+static uint32_t layout_frame(struct compiler *c)
+{
+	const struct mcc_ir_function *function = c->function;
+
+	int32_t offset = 0;
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		if (v < function->parameter_count) {
+			c->offsets[v] = PARAMETER_OFFSET + (int32_t)(v * SLOT_SIZE);
+		} else {
+			bool vector = function->vreg_types[v] == MCC_IR_TYPE_INT4 ||
+			              function->vreg_types[v] == MCC_IR_TYPE_FLOAT4;
+			offset -= vector ? VECTOR_SLOT_SIZE : SLOT_SIZE;
+			c->offsets[v] = offset;
+		}
+	}
+	for (uint32_t a = 0; a < function->array_count; ++a) {
+		offset -= (int32_t)(function->arrays[a].size * ELEMENT_SIZE);
+		c->array_offsets[a] = offset;
+	}
+
+	return ALIGN((uint32_t)-offset);
+}
+
+static void compile_function(struct compiler *c)
+{
+	const struct mcc_ir_function *function = c->function;
+
+	c->offsets = malloc((function->vreg_count + 1) * sizeof(*c->offsets));
+	c->array_offsets = malloc((function->array_count + 1) * sizeof(*c->array_offsets));
+	c->label_offsets = malloc((function->label_count + 1) * sizeof(*c->label_offsets));
+	c->jumps.count = 0;
+	if (!c->offsets || !c->array_offsets || !c->label_offsets) {
+		c->failed = true;
+	} else {
+		// push rbp; mov rbp, rsp; sub rsp, frame
+		uint32_t frame_size = layout_frame(c);
+		EMIT(c, 0x55, 0x48, 0x89, 0xE5);
+		if (frame_size) {
+			EMIT(c, 0x48, 0x81, 0xEC);
+			emit_imm32(c, frame_size);
+		}
+
+		for (uint32_t i = 0; i < function->instruction_count && !c->failed; ++i) {
+			emit_instruction(c, i);
+		}
+		for (uint32_t j = 0; j < c->jumps.count && !c->failed; ++j) {
+			const struct fixup *jump = &c->jumps.entries[j];
+			patch(c, jump->offset, c->label_offsets[jump->target]);
+		}
+	}
+
+	free(c->offsets);
+	free(c->array_offsets);
+	free(c->label_offsets);
+}
+
+// Maps the code followed by the data, then makes the mapping executable and
+// read-only.
+static enum mcc_jit_status map_code(struct mcc_jit *jit, struct compiler *c)
+{
+	uint32_t data_offset = ALIGN(c->code_size);
+	for (uint32_t s = 0; s < c->strings.count; ++s) {
+		patch(c, c->strings.entries[s].offset, data_offset + c->strings.entries[s].target);
+	}
+	for (uint32_t f = 0; f < c->calls.count; ++f) {
+		patch(c, c->calls.entries[f].offset, c->function_offsets[c->calls.entries[f].target]);
+	}
+
+	// a module without functions still gets a page, mmap rejects empty ones
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t size = ((size_t)data_offset + c->data_size + page - 1) / page * page;
+	if (size == 0) {
+		size = page;
+	}
+	void *code = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (code == MAP_FAILED) {
+		return MCC_JIT_NO_MEMORY;
+	}
+
+	if (c->code_size) {
+		memcpy(code, c->code, c->code_size);
+	}
+	if (c->data_size) {
+		memcpy((uint8_t *)code + data_offset, c->data, c->data_size);
+	}
+	if (mprotect(code, size, PROT_READ | PROT_EXEC) != 0) {
+		munmap(code, size);
+		return MCC_JIT_UNSUPPORTED;
+	}
+
+	jit->code = code;
+	jit->size = size;
+	return MCC_JIT_OK;
+}
+
+enum mcc_jit_status mcc_jit_compile(struct mcc_jit *jit,
+                                    const struct mcc_ir_module *module,
+                                    const struct mcc_jit_symbol *symbols,
+                                    uint32_t symbol_count)
+{
+	assert(jit);
+	assert(module);
+	assert(symbols || symbol_count == 0);
+
+	*jit = (struct mcc_jit){0};
+
+	struct compiler c = {
+	    .module = module,
+	    .symbols = symbols,
+	    .symbol_count = symbol_count,
+	    .string_offsets = malloc((module->constant_count + 1) * sizeof(*c.string_offsets)),
+	    .function_offsets = malloc((module->function_count + 1) * sizeof(*c.function_offsets)),
+	};
+	c.failed = !c.string_offsets || !c.function_offsets;
+
+	for (uint32_t k = 0; !c.failed && k < module->constant_count; ++k) {
+		c.string_offsets[k] = UINT32_MAX;
+	}
+	for (uint32_t i = 0; !c.failed && i < module->function_count; ++i) {
+		c.function_offsets[i] = UINT32_MAX;
+		if (module->functions[i].builtin) {
+			continue;
+		}
+
+		// functions start aligned, padded with int3
+		while (c.code_size % STACK_ALIGNMENT != 0) {
+			EMIT(&c, 0xCC);
+		}
+		c.function_offsets[i] = c.code_size;
+		c.function = &module->functions[i];
+		compile_function(&c);
+		if (c.undefined_symbol || c.unsupported) {
+			break;
+		}
+	}
+
+	enum mcc_jit_status status = MCC_JIT_OK;
+	if (c.failed) {
+		status = MCC_JIT_NO_MEMORY;
+	} else if (c.undefined_symbol) {
+		status = MCC_JIT_UNDEFINED_SYMBOL;
+		jit->undefined_symbol = c.undefined_symbol;
+	} else if (c.unsupported) {
+		status = MCC_JIT_UNSUPPORTED;
+	} else {
+		status = map_code(jit, &c);
+	}
+
+	if (status == MCC_JIT_OK) {
+		jit->function_offsets = c.function_offsets;
+		jit->function_count = module->function_count;
+	} else {
+		free(c.function_offsets);
+	}
+	free(c.code);
+	free(c.data);
+	free(c.string_offsets);
+	free(c.calls.entries);
+	free(c.strings.entries);
+	free(c.jumps.entries);
+	return status;
+}
+
+bool mcc_jit_call(const struct mcc_jit *jit, const struct mcc_ir_module *module, const char *name, int *result)
+{
+	assert(jit);
+	assert(module);
+	assert(name);
+	assert(result);
+
+	uint32_t index = mcc_ir_find_function(module, name);
+	if (index == MCC_IR_OPERAND_MAX || index >= jit->function_count || jit->function_offsets[index] == UINT32_MAX) {
+		return false;
+	}
+	const struct mcc_ir_function *function = &module->functions[index];
+	if (function->parameter_count != 0 || function->return_type == MCC_IR_TYPE_FLOAT) {
+		return false;
+	}
+
+	// the mapping holds code, calling it is defined by POSIX like for dlsym
+	void *address = jit->code + jit->function_offsets[index];
+	int (*entry)(void);
+	memcpy(&entry, &address, sizeof(entry));
+
+	int value = entry();
+	*result = function->return_type == MCC_IR_TYPE_VOID ? 0 : value;
+	return true;
+}
+
+#else
+
+enum mcc_jit_status mcc_jit_compile(struct mcc_jit *jit,
+                                    const struct mcc_ir_module *module,
+                                    const struct mcc_jit_symbol *symbols,
+                                    uint32_t symbol_count)
+{
+	assert(jit);
+	assert(module);
+	assert(symbols || symbol_count == 0);
+
+	*jit = (struct mcc_jit){0};
+	return MCC_JIT_UNSUPPORTED;
+}
+
+bool mcc_jit_call(const struct mcc_jit *jit, const struct mcc_ir_module *module, const char *name, int *result)
+{
+	assert(jit);
+	assert(module);
+	assert(name);
+	assert(result);
+
+	return false;
+}
+
+#endif // __x86_64__
+
+void mcc_jit_release(struct mcc_jit *jit)
+{
+	assert(jit);
+
+	if (jit->code) {
+		munmap(jit->code, jit->size);
+	}
+	free(jit->function_offsets);
+	*jit = (struct mcc_jit){0};
+}
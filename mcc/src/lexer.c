@@ -0,0 +1,290 @@
+#include "mcc/lexer.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <string.h>
+
+static bool is_digit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+static bool is_alpha(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+static bool is_alpha_num(char c)
+{
+	return is_alpha(c) || is_digit(c);
+}
+
+void mcc_lexer_init(struct mcc_lexer *lexer, const char *data, size_t len)
+{
+	assert(lexer);
+	assert(data || len == 0);
+
+	*lexer = (struct mcc_lexer){
+	    .pos = data,
+	    .end = data + len,
+	    .line = 1,
+	    .col = 1,
+	};
+}
+
+// Moves over `len` characters which may contain line breaks.
+static void skip_lines(struct mcc_lexer *lexer, size_t len)
+{
+	const char *end = lexer->pos + len;
+
+	const char *newline;
+	while ((newline = memchr(lexer->pos, '\n', (size_t)(end - lexer->pos)))) {
+		lexer->line++;
+		lexer->col = 1;
+		lexer->pos = newline + 1;
+	}
+
+	lexer->col += (int)(end - lexer->pos);
+	lexer->pos = end;
+}
+
+// Returns the position of the `*/` closing a comment whose content starts at
+// `pos`, or NULL if there is none.
+static const char *find_comment_end(const char *pos, const char *end)
+{
+	while (pos < end) {
+		const char *star = memchr(pos, '*', (size_t)(end - pos));
+		if (!star || star + 1 >= end) {
+			return NULL;
+		}
+		if (star[1] == '/') {
+			return star;
+		}
+		pos = star + 1;
+	}
+	return NULL;
+}
+
+static void skip_whitespace(struct mcc_lexer *lexer)
+{
+	while (lexer->pos < lexer->end) {
+		switch (*lexer->pos) {
+		case ' ':
+		case '\t':
+		case '\r':
+			lexer->pos++;
+			lexer->col++;
+			break;
+
+		case '\n':
+			lexer->pos++;
+			lexer->line++;
+			lexer->col = 1;
+			break;
+
+		case '/': {
+			if (lexer->end - lexer->pos < 2 || lexer->pos[1] != '*') {
+				return;
+			}
+
+			// Like in the flex scanner, an unterminated comment is
+			// scanned as `/` followed by `*`.
+			const char *close = find_comment_end(lexer->pos + 2, lexer->end);
+			if (!close) {
+				return;
+			}
+			skip_lines(lexer, (size_t)(close + 2 - lexer->pos));
+			break;
+		}
+
+		default:
+			return;
+		}
+	}
+}
+
+static enum mcc_token_type keyword(const char *text, size_t len)
+{
+#define KEYWORD(str, type) \
+	if (len == sizeof(str) - 1 && memcmp(text, str, len) == 0) { \
+		return type; \
+	}
+
+	switch (len) {
+	case 2:
+		KEYWORD("if", MCC_TOKEN_IF);
+		break;
+	case 3:
+		KEYWORD("int", MCC_TOKEN_INT_TYPE);
+		KEYWORD("for", MCC_TOKEN_FOR);
+		break;
+	case 4:
+		KEYWORD("bool", MCC_TOKEN_BOOL_TYPE);
+		KEYWORD("else", MCC_TOKEN_ELSE);
+		KEYWORD("true", MCC_TOKEN_BOOL_LITERAL);
+		KEYWORD("void", MCC_TOKEN_VOID_TYPE);
+		break;
+	case 5:
+		KEYWORD("false", MCC_TOKEN_BOOL_LITERAL);
+		KEYWORD("float", MCC_TOKEN_FLOAT_TYPE);
+		KEYWORD("while", MCC_TOKEN_WHILE);
+		break;
+	case 6:
+		KEYWORD("return", MCC_TOKEN_RETURN);
+		KEYWORD("string", MCC_TOKEN_STRING_TYPE);
+		break;
+	}
+
+#undef KEYWORD
+
+	return MCC_TOKEN_IDENTIFIER;
+}
+
+// Scans the token at the current position, returns its length. Tokens other
+// than string literals never contain line breaks.
+static size_t scan(struct mcc_lexer *lexer, enum mcc_token_type *type)
+{
+	const char *pos = lexer->pos;
+	size_t left = (size_t)(lexer->end - pos);
+
+	if (left == 0) {
+		*type = MCC_TOKEN_EOF;
+		return 0;
+	}
+
+	// operators followed by an optional `=`
+	bool eq = left >= 2 && pos[1] == '=';
+
+	switch (pos[0]) {
+	case '(':
+		*type = MCC_TOKEN_LPARENTH;
+		return 1;
+	case ')':
+		*type = MCC_TOKEN_RPARENTH;
+		return 1;
+	case '[':
+		*type = MCC_TOKEN_LBRACKET;
+		return 1;
+	case ']':
+		*type = MCC_TOKEN_RBRACKET;
+		return 1;
+	case '{':
+		*type = MCC_TOKEN_LBRACE;
+		return 1;
+	case '}':
+		*type = MCC_TOKEN_RBRACE;
+		return 1;
+	case '+':
+		*type = MCC_TOKEN_PLUS;
+		return 1;
+	case '-':
+		*type = MCC_TOKEN_MINUS;
+		return 1;
+	case '*':
+		*type = MCC_TOKEN_ASTER;
+		return 1;
+	case '/':
+		*type = MCC_TOKEN_SLASH;
+		return 1;
+	case ';':
+		*type = MCC_TOKEN_SEMICOLON;
+		return 1;
+	case ',':
+		*type = MCC_TOKEN_COMMA;
+		return 1;
+
+	case '<':
+		*type = eq ? MCC_TOKEN_LESS_EQ : MCC_TOKEN_LESS;
+		return eq ? 2 : 1;
+	case '>':
+		*type = eq ? MCC_TOKEN_GREATER_EQ : MCC_TOKEN_GREATER;
+		return eq ? 2 : 1;
+	case '=':
+		*type = eq ? MCC_TOKEN_EQUALS : MCC_TOKEN_ASSIGNMENT;
+		return eq ? 2 : 1;
+	case '!':
+		*type = eq ? MCC_TOKEN_NOT_EQUALS : MCC_TOKEN_NOT;
+		return eq ? 2 : 1;
+
+	case '&':
+		if (left >= 2 && pos[1] == '&') {
+			*type = MCC_TOKEN_AND;
+			return 2;
+		}
+		*type = MCC_TOKEN_INVALID;
+		return 1;
+
+	case '|':
+		if (left >= 2 && pos[1] == '|') {
+			*type = MCC_TOKEN_OR;
+			return 2;
+		}
+		*type = MCC_TOKEN_INVALID;
+		return 1;
+
+	case '"': {
+		const char *close = memchr(pos + 1, '"', left - 1);
+		if (!close) {
+			*type = MCC_TOKEN_INVALID;
+			return 1;
+		}
+		*type = MCC_TOKEN_STRING_LITERAL;
+		return (size_t)(close + 1 - pos);
+	}
+	}
+
+	if (is_digit(pos[0])) {
+		size_t len = 1;
+		while (len < left && is_digit(pos[len])) {
+			len++;
+		}
+
+		if (len + 1 < left && pos[len] == '.' && is_digit(pos[len + 1])) {
+			len += 2;
+			while (len < left && is_digit(pos[len])) {
+				len++;
+			}
+			*type = MCC_TOKEN_FLOAT_LITERAL;
+			return len;
+		}
+
+		*type = MCC_TOKEN_INT_LITERAL;
+		return len;
+	}
+
+	if (is_alpha(pos[0])) {
+		size_t len = 1;
+		while (len < left && is_alpha_num(pos[len])) {
+			len++;
+		}
+		*type = keyword(pos, len);
+		return len;
+	}
+
+	*type = MCC_TOKEN_INVALID;
+	return 1;
+}
+
+void mcc_lexer_next(struct mcc_lexer *lexer, struct mcc_token *token)
+{
+	assert(lexer);
+	assert(token);
+
+	skip_whitespace(lexer);
+
+	token->text = lexer->pos;
+	token->sloc.start_line = lexer->line;
+	token->sloc.start_col = lexer->col;
+
+	token->len = scan(lexer, &token->type);
+
+	if (token->type == MCC_TOKEN_STRING_LITERAL) {
+		skip_lines(lexer, token->len);
+	} else {
+		lexer->pos += token->len;
+		lexer->col += (int)token->len;
+	}
+
+	token->sloc.end_line = lexer->line;
+	token->sloc.end_col = lexer->col;
+}
@@ -0,0 +1,44 @@
+#include "mcc/liveness.h"
+
+#include <assert.h>
+
+bool mcc_liveness_compute(struct mcc_dataflow *dataflow, const struct mcc_cfg *cfg)
+{
+	assert(dataflow);
+	assert(cfg);
+
+	const struct mcc_ir_function *function = cfg->function;
+	if (!mcc_dataflow_init(dataflow, cfg, MCC_DATAFLOW_BACKWARD, MCC_DATAFLOW_UNION, function->vreg_count)) {
+		return false;
+	}
+
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		const struct mcc_cfg_block *block = &cfg->blocks[b];
+		mcc_bitset_word *gen = MCC_DATAFLOW_SET(dataflow, gen, b);
+		mcc_bitset_word *kill = MCC_DATAFLOW_SET(dataflow, kill, b);
+
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			const struct mcc_ir_instruction *instruction = &function->instructions[i];
+
+			// a register read after being written in the same block is not
+			// live on entry
+			mcc_ir_operand uses[MCC_IR_MAX_USES];
+			uint32_t use_count = mcc_ir_used_vregs(instruction, uses);
+			for (uint32_t u = 0; u < use_count; ++u) {
+				uint32_t vreg = MCC_IR_OPERAND_INDEX(uses[u]);
+				if (!MCC_BITSET_TEST(kill, vreg)) {
+					MCC_BITSET_SET(gen, vreg);
+				}
+			}
+
+			mcc_ir_operand def = mcc_ir_defined_vreg(instruction);
+			if (def != MCC_IR_NONE) {
+				MCC_BITSET_SET(kill, MCC_IR_OPERAND_INDEX(def));
+			}
+		}
+	}
+
+	// the boundary stays empty, nothing is live after a return
+	mcc_dataflow_solve(dataflow, cfg);
+	return true;
+}
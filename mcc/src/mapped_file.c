@@ -0,0 +1,111 @@
+#include "mcc/mapped_file.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Reads the whole file into a heap buffer followed by two NUL bytes. Used when
+// the terminating NUL bytes do not fit into the last page of the mapping.
+static bool read_file(struct mcc_mapped_file *file, int fd, size_t len)
+{
+	char *data = malloc(len + 2);
+	if (!data) {
+		return false;
+	}
+
+	size_t done = 0;
+	while (done < len) {
+		ssize_t n = read(fd, data + done, len - done);
+		if (n < 0 && errno == EINTR) {
+			continue;
+		}
+		if (n <= 0) {
+			free(data);
+			if (n == 0) {
+				errno = EIO;
+			}
+			return false;
+		}
+		done += (size_t)n;
+	}
+
+	data[len] = '\0';
+	data[len + 1] = '\0';
+
+	*file = (struct mcc_mapped_file){
+	    .data = data,
+	    .len = len,
+	    .is_mapped = false,
+	};
+	return true;
+}
+
+bool mcc_mapped_file_open(struct mcc_mapped_file *file, const char *path)
+{
+	assert(file);
+	assert(path);
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return false;
+	}
+
+	if (!S_ISREG(st.st_mode)) {
+		close(fd);
+		errno = ENODEV;
+		return false;
+	}
+
+	size_t len = (size_t)st.st_size;
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	// The kernel zero-fills the remainder of the last page of a file mapping.
+	// If at least two bytes remain there, they serve as terminating NUL
+	// bytes. Otherwise, accessing the following page would fault.
+	bool ok;
+	if (len % page != 0 && page - len % page >= 2) {
+		size_t map_len = len + (page - len % page);
+
+		void *data = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		ok = data != MAP_FAILED;
+		if (ok) {
+			*file = (struct mcc_mapped_file){
+			    .data = data,
+			    .len = len,
+			    .map_len = map_len,
+			    .is_mapped = true,
+			};
+		}
+	} else {
+		ok = read_file(file, fd, len);
+	}
+
+	int saved_errno = errno;
+	close(fd);
+	errno = saved_errno;
+
+	return ok;
+}
+
+void mcc_mapped_file_close(struct mcc_mapped_file *file)
+{
+	assert(file);
+
+	if (file->is_mapped) {
+		munmap(file->data, file->map_len);
+	} else {
+		free(file->data);
+	}
+
+	*file = (struct mcc_mapped_file){0};
+}
@@ -0,0 +1,962 @@
+#include "mcc/object.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/reserve.h"
+
+// ------------------------------------------------------------------- Buffers
+
+static bool put(struct mcc_object_buffer *buffer, const void *data, uint32_t size)
+{
+	if (!reserve((void **)&buffer->data, &buffer->capacity, buffer->size, size, 1)) {
+		return false;
+	}
+	if (size) {
+		memcpy(buffer->data + buffer->size, data, size);
+	}
+	buffer->size += size;
+	return true;
+}
+
+static bool put8(struct mcc_object_buffer *buffer, uint8_t value)
+{
+	return put(buffer, &value, 1);
+}
+
+static bool put16(struct mcc_object_buffer *buffer, uint16_t value)
+{
+	uint8_t bytes[] = {(uint8_t)value, (uint8_t)(value >> 8)};
+	return put(buffer, bytes, sizeof(bytes));
+}
+
+static bool put32(struct mcc_object_buffer *buffer, uint32_t value)
+{
+	uint8_t bytes[] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+	return put(buffer, bytes, sizeof(bytes));
+}
+
+// Pads `buffer` with zeros to a multiple of `alignment`.
+static bool align(struct mcc_object_buffer *buffer, uint32_t alignment)
+{
+	bool ok = true;
+	while (ok && buffer->size % alignment != 0) {
+		ok = put8(buffer, 0);
+	}
+	return ok;
+}
+
+static uint32_t get32(const uint8_t *data)
+{
+	return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static void set32(uint8_t *data, uint32_t value)
+{
+	for (int i = 0; i < 4; ++i) {
+		data[i] = (uint8_t)(value >> (8 * i));
+	}
+}
+
+// ------------------------------------------------------------------ Operands
+
+enum operand_kind {
+	OPERAND_REGISTER,
+	OPERAND_IMMEDIATE,
+	OPERAND_MEMORY,
+};
+
+enum register_kind {
+	REGISTER_GENERAL,
+	REGISTER_BYTE,
+	REGISTER_XMM,
+	REGISTER_X87,
+};
+
+#define NO_REGISTER (-1)
+#define REG_ESP 4
+#define REG_EBP 5
+
+struct operand {
+	enum operand_kind kind;
+
+	// number of the register, the base and index of addresses
+	enum register_kind register_kind;
+	int reg;
+	int base;
+	int index;
+	int scale;
+
+	// immediate or displacement, plus the address of `symbol` if not NULL
+	int32_t value;
+	const char *symbol;
+	size_t symbol_length;
+};
+
+static const char *const general_registers[] = {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi"};
+static const char *const byte_registers[] = {"al", "cl", "dl", "bl", "ah", "ch", "dh", "bh"};
+
+// Parses the register named by the `length` characters at `name`.
+static bool parse_register(const char *name, size_t length, enum register_kind *kind, int *reg)
+{
+	for (int r = 0; r < 8; ++r) {
+		if (strlen(general_registers[r]) == length && strncmp(general_registers[r], name, length) == 0) {
+			*kind = REGISTER_GENERAL;
+			*reg = r;
+			return true;
+		}
+		if (strlen(byte_registers[r]) == length && strncmp(byte_registers[r], name, length) == 0) {
+			*kind = REGISTER_BYTE;
+			*reg = r;
+			return true;
+		}
+	}
+	if (length == 4 && strncmp(name, "xmm", 3) == 0 && name[3] >= '0' && name[3] <= '7') {
+		*kind = REGISTER_XMM;
+		*reg = name[3] - '0';
+		return true;
+	}
+	if (length == 2 && strncmp(name, "st", 2) == 0) {
+		*kind = REGISTER_X87;
+		*reg = 0;
+		return true;
+	}
+	if (length == 5 && strncmp(name, "st(", 3) == 0 && name[3] >= '0' && name[3] <= '7' && name[4] == ')') {
+		*kind = REGISTER_X87;
+		*reg = name[3] - '0';
+		return true;
+	}
+	return false;
+}
+
+static bool is_symbol_start(char c)
+{
+	return c == '.' || c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool parse_operand(const char *text, struct operand *operand)
+{
+	*operand = (struct operand){.base = NO_REGISTER, .index = NO_REGISTER, .scale = 1};
+
+	if (text[0] == '%') {
+		operand->kind = OPERAND_REGISTER;
+		return parse_register(text + 1, strlen(text + 1), &operand->register_kind, &operand->reg);
+	}
+
+	if (text[0] == '$') {
+		operand->kind = OPERAND_IMMEDIATE;
+		if (is_symbol_start(text[1])) {
+			operand->symbol = text + 1;
+			operand->symbol_length = strlen(text + 1);
+			return true;
+		}
+		char *end;
+		operand->value = (int32_t)strtol(text + 1, &end, 10);
+		return *end == '\0' && end != text + 1;
+	}
+
+	// displacement or symbol, then (base, index, scale)
+	operand->kind = OPERAND_MEMORY;
+	const char *c = text;
+	if (is_symbol_start(*c)) {
+		operand->symbol = c;
+		operand->symbol_length = strcspn(c, "(");
+		c += operand->symbol_length;
+	} else if (*c != '(') {
+		char *end;
+		operand->value = (int32_t)strtol(c, &end, 10);
+		if (end == c) {
+			return false;
+		}
+		c = end;
+	}
+	if (*c == '\0') {
+		return true;
+	}
+
+	enum register_kind kind;
+	if (*c++ != '(') {
+		return false;
+	}
+	if (*c == '%') {
+		size_t length = strcspn(c + 1, ",)");
+		if (!parse_register(c + 1, length, &kind, &operand->base) || kind != REGISTER_GENERAL) {
+			return false;
+		}
+		c += 1 + length;
+	}
+	if (*c == ',') {
+		size_t length = strcspn(c + 2, ",)");
+		if (c[1] != '%' || !parse_register(c + 2, length, &kind, &operand->index) || kind != REGISTER_GENERAL) {
+			return false;
+		}
+		c += 2 + length;
+		if (*c == ',') {
+			operand->scale = (int)strtol(c + 1, (char **)&c, 10);
+		}
+	}
+	return c[0] == ')' && c[1] == '\0';
+}
+
+// ------------------------------------------------------------------- Encoder
+
+struct label {
+	const char *name;
+	uint32_t offset;
+};
+
+// A 32-bit displacement to a label of the function.
+struct fixup {
+	uint32_t offset;
+	const char *label;
+};
+
+struct encoder {
+	struct mcc_object *object;
+	struct mcc_object_buffer *text;
+
+	struct label *labels;
+	uint32_t label_count;
+	uint32_t label_capacity;
+
+	struct fixup *fixups;
+	uint32_t fixup_count;
+	uint32_t fixup_capacity;
+
+	bool failed;
+};
+
+static void byte(struct encoder *e, uint8_t value)
+{
+	e->failed = e->failed || !put8(e->text, value);
+}
+
+static void bytes(struct encoder *e, const uint8_t *values, uint32_t count)
+{
+	e->failed = e->failed || !put(e->text, values, count);
+}
+
+static void word(struct encoder *e, uint32_t value)
+{
+	e->failed = e->failed || !put32(e->text, value);
+}
+
+static void add_relocation(struct encoder *e, const char *symbol, size_t length, bool relative)
+{
+	struct mcc_object *object = e->object;
+	char *name = strndup(symbol, length);
+	if (!name || !reserve((void **)&object->relocations, &object->relocation_capacity, object->relocation_count, 1,
+	                      sizeof(*object->relocations))) {
+		free(name);
+		e->failed = true;
+		return;
+	}
+	object->relocations[object->relocation_count++] = (struct mcc_object_relocation){
+	    .offset = e->text->size,
+	    .symbol = name,
+	    .relative = relative,
+	};
+}
+
+// Emits the 32-bit value of `operand`, relocated by its symbol.
+static void value(struct encoder *e, const struct operand *operand)
+{
+	if (operand->symbol) {
+		add_relocation(e, operand->symbol, operand->symbol_length, false);
+	}
+	word(e, (uint32_t)operand->value);
+}
+
+static bool fits_byte(const struct operand *operand)
+{
+	return !operand->symbol && operand->value >= INT8_MIN && operand->value <= INT8_MAX;
+}
+
+// Emits the ModRM byte with `reg` in its reg field addressing `rm`, followed
+// by the SIB byte and displacement if needed.
+static void modrm(struct encoder *e, int reg, const struct operand *rm)
+{
+	if (rm->kind == OPERAND_REGISTER) {
+		byte(e, (uint8_t)(0xC0 | reg << 3 | rm->reg));
+		return;
+	}
+	assert(rm->kind == OPERAND_MEMORY);
+
+	if (rm->base == NO_REGISTER && rm->index == NO_REGISTER) {
+		byte(e, (uint8_t)(0x05 | reg << 3));
+		value(e, rm);
+		return;
+	}
+
+	int mod = 2;
+	if (rm->base == NO_REGISTER) {
+		mod = 0;
+	} else if (!rm->symbol && rm->value == 0 && rm->base != REG_EBP) {
+		mod = 0;
+	} else if (fits_byte(rm)) {
+		mod = 1;
+	}
+
+	bool sib = rm->index != NO_REGISTER || rm->base == REG_ESP || rm->base == NO_REGISTER;
+	byte(e, (uint8_t)(mod << 6 | reg << 3 | (sib ? 4 : rm->base)));
+	if (sib) {
+		int scale = rm->scale == 8 ? 3 : rm->scale == 4 ? 2 : rm->scale == 2 ? 1 : 0;
+		int index = rm->index != NO_REGISTER ? rm->index : REG_ESP;
+		int base = rm->base != NO_REGISTER ? rm->base : REG_EBP;
+		byte(e, (uint8_t)(scale << 6 | index << 3 | base));
+	}
+
+	if (mod == 1) {
+		byte(e, (uint8_t)(int8_t)rm->value);
+	} else if (mod == 2 || rm->base == NO_REGISTER) {
+		value(e, rm);
+	}
+}
+
+// Emits a 32-bit displacement to `label`, resolved at the end of the function.
+static void displacement(struct encoder *e, const char *label)
+{
+	if (!reserve((void **)&e->fixups, &e->fixup_capacity, e->fixup_count, 1, sizeof(*e->fixups))) {
+		e->failed = true;
+		return;
+	}
+	e->fixups[e->fixup_count++] = (struct fixup){e->text->size, label};
+	word(e, 0);
+}
+
+// ----------------------------------------------------------------- Encodings
+
+enum form {
+	// opcode extension, immediate or register source or memory source
+	FORM_ARITHMETIC,
+	FORM_MOVE,
+	FORM_MULTIPLY,
+
+	// opcode /r, register source to register or memory
+	FORM_STORE,
+
+	// opcode /r, register or memory source to register
+	FORM_LOAD,
+
+	// opcode with extension, one register or memory operand
+	FORM_UNARY,
+	FORM_FIXED,
+
+	// opcode plus register number
+	FORM_REGISTER,
+	FORM_X87_REGISTER,
+
+	// prefix, opcode /r with the SSE register destination; stores to memory
+	// use the opcode in `extension`
+	FORM_SSE,
+	FORM_SHUFFLE,
+
+	FORM_JUMP,
+	FORM_CALL,
+};
+
+struct encoding {
+	const char *mnemonic;
+	uint8_t form;
+
+	// mandatory prefix, 0 if none
+	uint8_t prefix;
+	uint8_t opcode[2];
+	uint8_t opcode_length;
+	uint8_t extension;
+};
+
+static const struct encoding encodings[] = {
+    {"addl", FORM_ARITHMETIC, 0, {0}, 0, 0},
+    {"orl", FORM_ARITHMETIC, 0, {0}, 0, 1},
+    {"andl", FORM_ARITHMETIC, 0, {0}, 0, 4},
+    {"subl", FORM_ARITHMETIC, 0, {0}, 0, 5},
+    {"xorl", FORM_ARITHMETIC, 0, {0}, 0, 6},
+    {"cmpl", FORM_ARITHMETIC, 0, {0}, 0, 7},
+    {"movl", FORM_MOVE, 0, {0}, 0, 0},
+    {"imull", FORM_MULTIPLY, 0, {0}, 0, 0},
+    {"testl", FORM_STORE, 0, {0x85}, 1, 0},
+    {"andb", FORM_STORE, 0, {0x20}, 1, 0},
+    {"orb", FORM_STORE, 0, {0x08}, 1, 0},
+    {"movzbl", FORM_LOAD, 0, {0x0F, 0xB6}, 2, 0},
+    {"leal", FORM_LOAD, 0, {0x8D}, 1, 0},
+    {"negl", FORM_UNARY, 0, {0xF7}, 1, 3},
+    {"idivl", FORM_UNARY, 0, {0xF7}, 1, 7},
+    {"flds", FORM_UNARY, 0, {0xD9}, 1, 0},
+    {"fstps", FORM_UNARY, 0, {0xD9}, 1, 3},
+    {"fadds", FORM_UNARY, 0, {0xD8}, 1, 0},
+    {"fmuls", FORM_UNARY, 0, {0xD8}, 1, 1},
+    {"fsubs", FORM_UNARY, 0, {0xD8}, 1, 4},
+    {"fdivs", FORM_UNARY, 0, {0xD8}, 1, 6},
+    {"cltd", FORM_FIXED, 0, {0x99}, 1, 0},
+    {"ret", FORM_FIXED, 0, {0xC3}, 1, 0},
+    {"fchs", FORM_FIXED, 0, {0xD9, 0xE0}, 2, 0},
+    {"pushl", FORM_REGISTER, 0, {0x50}, 1, 0},
+    {"popl", FORM_REGISTER, 0, {0x58}, 1, 0},
+    {"fstp", FORM_X87_REGISTER, 0, {0xDD, 0xD8}, 2, 0},
+    {"fucomip", FORM_X87_REGISTER, 0, {0xDF, 0xE8}, 2, 0},
+    {"movss", FORM_SSE, 0xF3, {0x0F, 0x10}, 2, 0x11},
+    {"movaps", FORM_SSE, 0, {0x0F, 0x28}, 2, 0x29},
+    {"movups", FORM_SSE, 0, {0x0F, 0x10}, 2, 0x11},
+    {"movd", FORM_SSE, 0x66, {0x0F, 0x6E}, 2, 0},
+    {"addss", FORM_SSE, 0xF3, {0x0F, 0x58}, 2, 0},
+    {"mulss", FORM_SSE, 0xF3, {0x0F, 0x59}, 2, 0},
+    {"subss", FORM_SSE, 0xF3, {0x0F, 0x5C}, 2, 0},
+    {"divss", FORM_SSE, 0xF3, {0x0F, 0x5E}, 2, 0},
+    {"addps", FORM_SSE, 0, {0x0F, 0x58}, 2, 0},
+    {"mulps", FORM_SSE, 0, {0x0F, 0x59}, 2, 0},
+    {"subps", FORM_SSE, 0, {0x0F, 0x5C}, 2, 0},
+    {"divps", FORM_SSE, 0, {0x0F, 0x5E}, 2, 0},
+    {"xorps", FORM_SSE, 0, {0x0F, 0x57}, 2, 0},
+    {"ucomiss", FORM_SSE, 0, {0x0F, 0x2E}, 2, 0},
+    {"paddd", FORM_SSE, 0x66, {0x0F, 0xFE}, 2, 0},
+    {"psubd", FORM_SSE, 0x66, {0x0F, 0xFA}, 2, 0},
+    {"shufps", FORM_SHUFFLE, 0, {0x0F, 0xC6}, 2, 0},
+    {"pshufd", FORM_SHUFFLE, 0x66, {0x0F, 0x70}, 2, 0},
+    {"jmp", FORM_JUMP, 0, {0xE9}, 1, 0},
+    {"call", FORM_CALL, 0, {0xE8}, 1, 0},
+};
+
+// Condition codes in the order of their encoding.
+static const char *const conditions[] = {"o", "no", "b", "ae", "e", "ne", "be", "a",
+                                         "s", "ns", "p", "np", "l", "ge", "le", "g"};
+
+// Code of the condition of `mnemonic` following `prefix`, or -1.
+static int condition_code(const char *mnemonic, const char *prefix)
+{
+	size_t length = strlen(prefix);
+	if (strncmp(mnemonic, prefix, length) != 0) {
+		return -1;
+	}
+	for (int c = 0; c < (int)(sizeof(conditions) / sizeof(*conditions)); ++c) {
+		if (strcmp(mnemonic + length, conditions[c]) == 0) {
+			return c;
+		}
+	}
+	return -1;
+}
+
+static void encode_arithmetic(struct encoder *e, int extension, const struct operand *src, const struct operand *dest)
+{
+	if (src->kind == OPERAND_IMMEDIATE) {
+		byte(e, fits_byte(src) ? 0x83 : 0x81);
+		modrm(e, extension, dest);
+		if (fits_byte(src)) {
+			byte(e, (uint8_t)(int8_t)src->value);
+		} else {
+			value(e, src);
+		}
+	} else if (src->kind == OPERAND_REGISTER) {
+		byte(e, (uint8_t)(extension << 3 | 0x01));
+		modrm(e, src->reg, dest);
+	} else {
+		assert(dest->kind == OPERAND_REGISTER);
+		byte(e, (uint8_t)(extension << 3 | 0x03));
+		modrm(e, dest->reg, src);
+	}
+}
+
+static void encode_move(struct encoder *e, const struct operand *src, const struct operand *dest)
+{
+	if (src->kind == OPERAND_IMMEDIATE && dest->kind == OPERAND_REGISTER) {
+		byte(e, (uint8_t)(0xB8 + dest->reg));
+		value(e, src);
+	} else if (src->kind == OPERAND_IMMEDIATE) {
+		byte(e, 0xC7);
+		modrm(e, 0, dest);
+		value(e, src);
+	} else if (src->kind == OPERAND_REGISTER) {
+		byte(e, 0x89);
+		modrm(e, src->reg, dest);
+	} else {
+		assert(dest->kind == OPERAND_REGISTER);
+		byte(e, 0x8B);
+		modrm(e, dest->reg, src);
+	}
+}
+
+static void encode_multiply(struct encoder *e, const struct operand *src, const struct operand *dest)
+{
+	assert(dest->kind == OPERAND_REGISTER);
+	if (src->kind == OPERAND_IMMEDIATE) {
+		byte(e, fits_byte(src) ? 0x6B : 0x69);
+		modrm(e, dest->reg, dest);
+		if (fits_byte(src)) {
+			byte(e, (uint8_t)(int8_t)src->value);
+		} else {
+			value(e, src);
+		}
+	} else {
+		bytes(e, (const uint8_t[]){0x0F, 0xAF}, 2);
+		modrm(e, dest->reg, src);
+	}
+}
+
+static void encode_instruction(struct encoder *e, const struct mcc_peephole_instruction *instruction)
+{
+	struct operand operands[MCC_PEEPHOLE_MAX_OPERANDS];
+	uint32_t count = instruction->operand_count;
+	for (uint32_t o = 0; o < count; ++o) {
+		if (!parse_operand(instruction->operands[o], &operands[o])) {
+			// call and jump targets are plain names
+			operands[o] = (struct operand){.kind = OPERAND_IMMEDIATE, .symbol = instruction->operands[o]};
+		}
+	}
+	const struct operand *first = &operands[0];
+	const struct operand *last = &operands[count ? count - 1 : 0];
+
+	int condition = condition_code(instruction->text, "set");
+	if (condition >= 0) {
+		bytes(e, (const uint8_t[]){0x0F, (uint8_t)(0x90 + condition)}, 2);
+		modrm(e, 0, first);
+		return;
+	}
+	condition = condition_code(instruction->text, "j");
+	if (condition >= 0) {
+		bytes(e, (const uint8_t[]){0x0F, (uint8_t)(0x80 + condition)}, 2);
+		displacement(e, instruction->operands[0]);
+		return;
+	}
+
+	const struct encoding *encoding = NULL;
+	for (size_t i = 0; i < sizeof(encodings) / sizeof(*encodings); ++i) {
+		if (strcmp(encodings[i].mnemonic, instruction->text) == 0) {
+			encoding = &encodings[i];
+			break;
+		}
+	}
+	assert(encoding);
+	if (!encoding) {
+		e->failed = true;
+		return;
+	}
+
+	switch ((enum form)encoding->form) {
+	case FORM_ARITHMETIC:
+		encode_arithmetic(e, encoding->extension, first, last);
+		break;
+	case FORM_MOVE:
+		encode_move(e, first, last);
+		break;
+	case FORM_MULTIPLY:
+		encode_multiply(e, first, last);
+		break;
+	case FORM_STORE:
+		bytes(e, encoding->opcode, encoding->opcode_length);
+		modrm(e, first->reg, last);
+		break;
+	case FORM_LOAD:
+		bytes(e, encoding->opcode, encoding->opcode_length);
+		modrm(e, last->reg, first);
+		break;
+	case FORM_UNARY:
+		bytes(e, encoding->opcode, encoding->opcode_length);
+		modrm(e, encoding->extension, first);
+		break;
+	case FORM_FIXED:
+		bytes(e, encoding->opcode, encoding->opcode_length);
+		break;
+	case FORM_REGISTER:
+		byte(e, (uint8_t)(encoding->opcode[0] + first->reg));
+		break;
+	case FORM_X87_REGISTER:
+		bytes(e, (const uint8_t[]){encoding->opcode[0], (uint8_t)(encoding->opcode[1] + first->reg)}, 2);
+		break;
+	case FORM_SSE:
+		if (encoding->prefix) {
+			byte(e, encoding->prefix);
+		}
+		if (last->kind == OPERAND_MEMORY) {
+			assert(encoding->extension);
+			bytes(e, (const uint8_t[]){encoding->opcode[0], encoding->extension}, 2);
+			modrm(e, first->reg, last);
+		} else {
+			bytes(e, encoding->opcode, encoding->opcode_length);
+			modrm(e, last->reg, first);
+		}
+		break;
+	case FORM_SHUFFLE:
+		if (encoding->prefix) {
+			byte(e, encoding->prefix);
+		}
+		bytes(e, encoding->opcode, encoding->opcode_length);
+		modrm(e, last->reg, &operands[1]);
+		byte(e, (uint8_t)first->value);
+		break;
+	case FORM_JUMP:
+		bytes(e, encoding->opcode, encoding->opcode_length);
+		displacement(e, instruction->operands[0]);
+		break;
+	case FORM_CALL:
+		bytes(e, encoding->opcode, encoding->opcode_length);
+		add_relocation(e, instruction->operands[0], strlen(instruction->operands[0]), true);
+		// the displacement is relative to the end of the field
+		word(e, (uint32_t)-4);
+		break;
+	}
+}
+
+static int compare_labels(const void *a, const void *b)
+{
+	return strcmp(((const struct label *)a)->name, ((const struct label *)b)->name);
+}
+
+// Resolves the jumps of the function to its labels.
+static void resolve_fixups(struct encoder *e)
+{
+	if (e->label_count) {
+		qsort(e->labels, e->label_count, sizeof(*e->labels), compare_labels);
+	}
+	for (uint32_t f = 0; f < e->fixup_count; ++f) {
+		struct label key = {.name = e->fixups[f].label};
+		const struct label *label =
+		    bsearch(&key, e->labels, e->label_count, sizeof(*e->labels), compare_labels);
+		assert(label);
+		if (!label) {
+			e->failed = true;
+			return;
+		}
+		uint32_t offset = e->fixups[f].offset;
+		set32(&e->text->data[offset], label->offset - (offset + 4));
+	}
+}
+
+// ---------------------------------------------------------------------- Object
+
+void mcc_object_init(struct mcc_object *object)
+{
+	assert(object);
+	*object = (struct mcc_object){0};
+}
+
+void mcc_object_release(struct mcc_object *object)
+{
+	assert(object);
+
+	for (uint32_t s = 0; s < object->symbol_count; ++s) {
+		free(object->symbols[s].name);
+	}
+	for (uint32_t r = 0; r < object->relocation_count; ++r) {
+		free(object->relocations[r].symbol);
+	}
+	free(object->symbols);
+	free(object->relocations);
+	free(object->text.data);
+	free(object->rodata.data);
+	mcc_object_init(object);
+}
+
+static bool add_symbol(struct mcc_object *object, const char *name, uint32_t offset, bool function)
+{
+	char *copy = strdup(name);
+	if (!copy || !reserve((void **)&object->symbols, &object->symbol_capacity, object->symbol_count, 1,
+	                      sizeof(*object->symbols))) {
+		free(copy);
+		return false;
+	}
+	object->symbols[object->symbol_count++] = (struct mcc_object_symbol){
+	    .name = copy,
+	    .offset = offset,
+	    .function = function,
+	};
+	return true;
+}
+
+bool mcc_object_add_function(struct mcc_object *object, const char *name, const struct mcc_peephole_code *code)
+{
+	assert(object);
+	assert(name);
+	assert(code);
+
+	if (!add_symbol(object, name, object->text.size, true)) {
+		return false;
+	}
+
+	struct encoder e = {.object = object, .text = &object->text};
+	for (uint32_t i = 0; !e.failed && i < code->instruction_count; ++i) {
+		const struct mcc_peephole_instruction *instruction = &code->instructions[i];
+		if (!instruction->label) {
+			encode_instruction(&e, instruction);
+		} else if (reserve((void **)&e.labels, &e.label_capacity, e.label_count, 1, sizeof(*e.labels))) {
+			e.labels[e.label_count++] = (struct label){instruction->text, object->text.size};
+		} else {
+			e.failed = true;
+		}
+	}
+	if (!e.failed) {
+		resolve_fixups(&e);
+	}
+
+	struct mcc_object_symbol *symbol = &object->symbols[object->symbol_count - 1];
+	symbol->size = object->text.size - symbol->offset;
+
+	free(e.labels);
+	free(e.fixups);
+	return !e.failed;
+}
+
+bool mcc_object_add_data(struct mcc_object *object,
+                         const char *label,
+                         const void *data,
+                         uint32_t size,
+                         uint32_t alignment)
+{
+	assert(object);
+	assert(label);
+	assert(data || size == 0);
+	assert(alignment > 0);
+
+	if (!align(&object->rodata, alignment) || !add_symbol(object, label, object->rodata.size, false)) {
+		return false;
+	}
+	object->symbols[object->symbol_count - 1].size = size;
+	return put(&object->rodata, data, size);
+}
+
+// ------------------------------------------------------------------------ ELF
+
+enum {
+	SECTION_NULL,
+	SECTION_TEXT,
+	SECTION_REL_TEXT,
+	SECTION_RODATA,
+	SECTION_NOTE,
+	SECTION_SYMTAB,
+	SECTION_STRTAB,
+	SECTION_SHSTRTAB,
+	SECTION_COUNT,
+};
+
+// Symbols of the sections precede those of the functions.
+enum {
+	SYMBOL_NULL,
+	SYMBOL_TEXT,
+	SYMBOL_RODATA,
+	SYMBOL_FIRST_GLOBAL,
+};
+
+#define ELF_HEADER_SIZE 52
+#define SECTION_HEADER_SIZE 40
+#define SYMBOL_SIZE 16
+#define RELOCATION_SIZE 8
+
+#define SHT_PROGBITS 1
+#define SHT_SYMTAB 2
+#define SHT_STRTAB 3
+#define SHT_REL 9
+#define SHF_ALLOC 0x2
+#define SHF_EXECINSTR 0x4
+#define SHF_INFO_LINK 0x40
+#define STB_LOCAL 0
+#define STB_GLOBAL 1
+#define STT_NOTYPE 0
+#define STT_FUNC 2
+#define STT_SECTION 3
+#define R_386_32 1
+#define R_386_PC32 2
+
+struct section {
+	const char *name;
+	uint32_t type;
+	uint32_t flags;
+	uint32_t link;
+	uint32_t info;
+	uint32_t alignment;
+	uint32_t entry_size;
+	const struct mcc_object_buffer *data;
+};
+
+static bool put_symbol(struct mcc_object_buffer *symtab,
+                       uint32_t name,
+                       uint32_t value,
+                       uint32_t size,
+                       uint8_t info,
+                       uint16_t section)
+{
+	return put32(symtab, name) && put32(symtab, value) && put32(symtab, size) && put8(symtab, info) &&
+	       put8(symtab, 0) && put16(symtab, section);
+}
+
+// Index of the symbol named `name` among `names`, sorted, or UINT32_MAX.
+static uint32_t find_name(const struct mcc_object_symbol *const *names, uint32_t count, const char *name)
+{
+	uint32_t low = 0;
+	uint32_t high = count;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		int order = strcmp(names[middle]->name, name);
+		if (order == 0) {
+			return middle;
+		}
+		if (order < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return UINT32_MAX;
+}
+
+static int compare_symbols(const void *a, const void *b)
+{
+	return strcmp((*(const struct mcc_object_symbol *const *)a)->name,
+	              (*(const struct mcc_object_symbol *const *)b)->name);
+}
+
+// Builds the symbol table and the relocations of .text, patching the
+// addends of references to data into `text`.
+static bool link_symbols(const struct mcc_object *object,
+                         struct mcc_object_buffer *text,
+                         struct mcc_object_buffer *symtab,
+                         struct mcc_object_buffer *strtab,
+                         struct mcc_object_buffer *rel)
+{
+	uint32_t count = object->symbol_count;
+	const struct mcc_object_symbol **sorted = malloc((count + 1) * sizeof(*sorted));
+	uint32_t *indices = malloc((count + 1) * sizeof(*indices));
+	char **undefined = NULL;
+	uint32_t undefined_count = 0;
+	uint32_t undefined_capacity = 0;
+	bool ok = sorted && indices && put8(strtab, 0) &&
+	          put_symbol(symtab, 0, 0, 0, 0, 0) &&
+	          put_symbol(symtab, 0, 0, 0, STB_LOCAL << 4 | STT_SECTION, SECTION_TEXT) &&
+	          put_symbol(symtab, 0, 0, 0, STB_LOCAL << 4 | STT_SECTION, SECTION_RODATA);
+
+	// functions are global, data labels stay local to the file
+	uint32_t next_index = SYMBOL_FIRST_GLOBAL;
+	for (uint32_t s = 0; ok && s < count; ++s) {
+		sorted[s] = &object->symbols[s];
+		const struct mcc_object_symbol *symbol = &object->symbols[s];
+		indices[s] = symbol->function ? next_index++ : UINT32_MAX;
+		if (symbol->function) {
+			ok = put_symbol(symtab, strtab->size, symbol->offset, symbol->size, STB_GLOBAL << 4 | STT_FUNC,
+			                SECTION_TEXT) &&
+			     put(strtab, symbol->name, (uint32_t)strlen(symbol->name) + 1);
+		}
+	}
+	if (ok) {
+		qsort(sorted, count, sizeof(*sorted), compare_symbols);
+	}
+
+	for (uint32_t r = 0; ok && r < object->relocation_count; ++r) {
+		const struct mcc_object_relocation *relocation = &object->relocations[r];
+		uint32_t found = find_name(sorted, count, relocation->symbol);
+		uint32_t symbol;
+		uint32_t type = relocation->relative ? R_386_PC32 : R_386_32;
+		if (found != UINT32_MAX && !sorted[found]->function) {
+			// relative to the start of .rodata
+			uint8_t *field = &text->data[relocation->offset];
+			set32(field, get32(field) + sorted[found]->offset);
+			symbol = SYMBOL_RODATA;
+		} else if (found != UINT32_MAX) {
+			symbol = indices[sorted[found] - object->symbols];
+		} else {
+			uint32_t u = 0;
+			while (u < undefined_count && strcmp(undefined[u], relocation->symbol) != 0) {
+				++u;
+			}
+			if (u == undefined_count) {
+				ok = reserve((void **)&undefined, &undefined_capacity, undefined_count, 1,
+				             sizeof(*undefined)) &&
+				     put_symbol(symtab, strtab->size, 0, 0, STB_GLOBAL << 4 | STT_NOTYPE, 0) &&
+				     put(strtab, relocation->symbol, (uint32_t)strlen(relocation->symbol) + 1);
+				if (ok) {
+					undefined[undefined_count++] = relocation->symbol;
+				}
+			}
+			symbol = next_index + u;
+		}
+		ok = ok && put32(rel, relocation->offset) && put32(rel, symbol << 8 | type);
+	}
+
+	free(sorted);
+	free(indices);
+	free(undefined);
+	return ok;
+}
+
+static bool put_section_header(struct mcc_object_buffer *file,
+                               uint32_t name,
+                               const struct section *section,
+                               uint32_t offset)
+{
+	uint32_t size = section->data ? section->data->size : 0;
+	return put32(file, name) && put32(file, section->type) && put32(file, section->flags) && put32(file, 0) &&
+	       put32(file, offset) && put32(file, size) && put32(file, section->link) && put32(file, section->info) &&
+	       put32(file, section->alignment) && put32(file, section->entry_size);
+}
+
+bool mcc_object_write(FILE *out, const struct mcc_object *object)
+{
+	assert(out);
+	assert(object);
+
+	struct mcc_object_buffer text = {0};
+	struct mcc_object_buffer symtab = {0};
+	struct mcc_object_buffer strtab = {0};
+	struct mcc_object_buffer rel = {0};
+	struct mcc_object_buffer shstrtab = {0};
+	struct mcc_object_buffer file = {0};
+
+	bool ok = put(&text, object->text.data, object->text.size) &&
+	          link_symbols(object, &text, &symtab, &strtab, &rel);
+
+	const struct section sections[SECTION_COUNT] = {
+	    [SECTION_NULL] = {"", 0, 0, 0, 0, 0, 0, NULL},
+	    [SECTION_TEXT] = {".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, 0, 0, 16, 0, &text},
+	    [SECTION_REL_TEXT] = {".rel.text", SHT_REL, SHF_INFO_LINK, SECTION_SYMTAB, SECTION_TEXT, 4, RELOCATION_SIZE,
+	                          &rel},
+	    [SECTION_RODATA] = {".rodata", SHT_PROGBITS, SHF_ALLOC, 0, 0, 16, 0, &object->rodata},
+	    [SECTION_NOTE] = {".note.GNU-stack", SHT_PROGBITS, 0, 0, 0, 1, 0, NULL},
+	    [SECTION_SYMTAB] = {".symtab", SHT_SYMTAB, 0, SECTION_STRTAB, SYMBOL_FIRST_GLOBAL, 4, SYMBOL_SIZE, &symtab},
+	    [SECTION_STRTAB] = {".strtab", SHT_STRTAB, 0, 0, 0, 1, 0, &strtab},
+	    [SECTION_SHSTRTAB] = {".shstrtab", SHT_STRTAB, 0, 0, 0, 1, 0, &shstrtab},
+	};
+
+	uint32_t names[SECTION_COUNT];
+	for (int s = 0; ok && s < SECTION_COUNT; ++s) {
+		names[s] = shstrtab.size;
+		ok = put(&shstrtab, sections[s].name, (uint32_t)strlen(sections[s].name) + 1);
+	}
+
+	// ELF header, filled in below
+	uint8_t header[ELF_HEADER_SIZE] = {0x7F, 'E', 'L', 'F', 1, 1, 1};
+	ok = ok && put(&file, header, sizeof(header));
+
+	uint32_t offsets[SECTION_COUNT] = {0};
+	for (int s = 1; ok && s < SECTION_COUNT; ++s) {
+		ok = align(&file, sections[s].alignment);
+		offsets[s] = file.size;
+		if (ok && sections[s].data) {
+			ok = put(&file, sections[s].data->data, sections[s].data->size);
+		}
+	}
+
+	ok = ok && align(&file, 4);
+	uint32_t section_headers = file.size;
+	for (int s = 0; ok && s < SECTION_COUNT; ++s) {
+		ok = put_section_header(&file, names[s], &sections[s], offsets[s]);
+	}
+
+	if (ok) {
+		uint8_t *h = file.data;
+		h[16] = 1; // ET_REL
+		h[18] = 3; // EM_386
+		set32(&h[20], 1);
+		set32(&h[32], section_headers);
+		h[40] = ELF_HEADER_SIZE;
+		h[46] = SECTION_HEADER_SIZE;
+		h[48] = SECTION_COUNT;
+		h[50] = SECTION_SHSTRTAB;
+		ok = fwrite(file.data, 1, file.size, out) == file.size;
+	}
+
+	free(text.data);
+	free(symtab.data);
+	free(strtab.data);
+	free(rel.data);
+	free(shstrtab.data);
+	free(file.data);
+	return ok;
+}
@@ -0,0 +1,41 @@
+#include "mcc/optimize.h"
+
+#include <assert.h>
+
+#include "mcc/ssa.h"
+#include "mcc/tail_call.h"
+#include "mcc/vectorize.h"
+
+bool mcc_optimize(struct mcc_ir_module *module,
+                  const struct mcc_optimize_options *options,
+                  struct mcc_optimize_stats *stats)
+{
+	assert(module);
+
+	struct mcc_optimize_stats totals = {0};
+	uint32_t inline_limit = options ? options->inline_limit : MCC_INLINE_DEFAULT_LIMIT;
+	bool ok = mcc_inline(module, inline_limit, &totals.inlining);
+	for (uint32_t i = 0; ok && i < module->function_count; ++i) {
+		struct mcc_ir_function *function = &module->functions[i];
+		if (function->builtin) {
+			continue;
+		}
+
+		if (!mcc_tail_call_eliminate(module, i, &totals.tail_calls)) {
+			ok = false;
+			break;
+		}
+
+		struct mcc_ssa ssa;
+		ok = mcc_ssa_construct(&ssa, function) && mcc_sccp(module, &ssa, &totals.sccp) &&
+		     mcc_ssa_destruct(&ssa);
+		mcc_ssa_release(&ssa);
+
+		ok = ok && mcc_vectorize(module, function, &totals.vectorize);
+	}
+
+	if (stats) {
+		*stats = totals;
+	}
+	return ok;
+}
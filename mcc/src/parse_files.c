@@ -0,0 +1,153 @@
+#include "mcc/parser.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#include "mcc/ast_cache.h"
+
+// Shared state of all workers. Each worker repeatedly claims the next
+// unparsed file; results are stored by index, so the outcome does not depend
+// on scheduling.
+struct work {
+	const char *const *paths;
+	size_t count;
+	const char *cache_dir;
+
+	struct mcc_mapped_file *inputs;
+	struct mcc_parser_result *results;
+
+	atomic_size_t next;
+};
+
+static void parse_input(struct work *work, size_t i)
+{
+	if (mcc_mapped_file_open(&work->inputs[i], work->paths[i])) {
+		work->results[i] =
+		    mcc_ast_cache_parse_buffer(work->cache_dir, work->inputs[i].data, work->inputs[i].len);
+		return;
+	}
+
+	// Inputs which cannot be mapped, like pipes, are read as a stream.
+	FILE *in = errno == ENODEV ? fopen(work->paths[i], "r") : NULL;
+	if (!in) {
+		work->results[i] = (struct mcc_parser_result){
+		    .status = MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM,
+		};
+		return;
+	}
+
+	work->results[i] = mcc_parse_file(in);
+	fclose(in);
+}
+
+static void *worker(void *arg)
+{
+	struct work *work = arg;
+
+	size_t i;
+	while ((i = atomic_fetch_add(&work->next, 1)) < work->count) {
+		parse_input(work, i);
+	}
+
+	return NULL;
+}
+
+// Runs `worker` on `jobs` threads, including the calling one. If threads
+// cannot be created, the remaining work is done by fewer threads.
+static void run_workers(struct work *work, unsigned jobs)
+{
+	pthread_t *threads = NULL;
+	unsigned started = 0;
+
+	if (jobs > 1) {
+		threads = malloc((jobs - 1) * sizeof(*threads));
+	}
+
+	if (threads) {
+		for (; started < jobs - 1; ++started) {
+			if (pthread_create(&threads[started], NULL, worker, work) != 0) {
+				break;
+			}
+		}
+	}
+
+	worker(work);
+
+	for (unsigned t = 0; t < started; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+	free(threads);
+}
+
+struct mcc_parser_result
+mcc_parse_files(const char *const *paths, size_t count, unsigned jobs, const char *cache_dir, size_t *failed_input)
+{
+	assert(paths || count == 0);
+	assert(jobs > 0);
+
+	struct mcc_parser_result merged = {
+	    .status = MCC_PARSER_STATUS_OK,
+	};
+	mcc_arena_init(&merged.arena);
+
+	struct work work = {
+	    .paths = paths,
+	    .count = count,
+	    .cache_dir = cache_dir,
+	    .inputs = calloc(count ? count : 1, sizeof(*work.inputs)),
+	    .results = calloc(count ? count : 1, sizeof(*work.results)),
+	};
+	atomic_init(&work.next, 0);
+
+	merged.program = mcc_ast_new_program(&merged.arena, NULL);
+
+	if (!work.inputs || !work.results || !merged.program) {
+		free(work.inputs);
+		free(work.results);
+		mcc_arena_release(&merged.arena);
+		merged.program = NULL;
+		merged.status = MCC_PARSER_STATUS_UNKNOWN_ERROR;
+		return merged;
+	}
+
+	run_workers(&work, jobs < count ? jobs : (unsigned)count);
+
+	// merge in input order
+	for (size_t i = 0; i < count; ++i) {
+		struct mcc_parser_result *result = &work.results[i];
+
+		if (result->status == MCC_PARSER_STATUS_OK && !result->program) {
+			mcc_parser_delete_result(result);
+			result->status = MCC_PARSER_STATUS_NOT_A_PROGRAM;
+		}
+
+		if (result->status != MCC_PARSER_STATUS_OK) {
+			if (merged.status == MCC_PARSER_STATUS_OK) {
+				merged.status = result->status;
+				if (failed_input) {
+					*failed_input = i;
+				}
+			}
+			continue;
+		}
+
+		mcc_ast_merge_programs(merged.program, result->program);
+		mcc_arena_merge(&merged.arena, &result->arena);
+	}
+
+	free(work.results);
+
+	merged.inputs = work.inputs;
+	merged.input_count = count;
+
+	if (merged.status != MCC_PARSER_STATUS_OK) {
+		enum mcc_parser_status status = merged.status;
+		mcc_parser_delete_result(&merged);
+		merged.status = status;
+	}
+
+	return merged;
+}
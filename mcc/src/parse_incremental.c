@@ -0,0 +1,454 @@
+#include "mcc/parser.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/reserve.h"
+
+struct position {
+	int line;
+	int col;
+};
+
+static int compare(struct position a, struct position b)
+{
+	if (a.line != b.line) {
+		return a.line < b.line ? -1 : 1;
+	}
+	return a.col < b.col ? -1 : a.col > b.col;
+}
+
+static struct position start_of(const struct mcc_ast_function_def *def)
+{
+	return (struct position){def->node.sloc.start_line, def->node.sloc.start_col};
+}
+
+static struct position end_of(const struct mcc_ast_function_def *def)
+{
+	return (struct position){def->node.sloc.end_line, def->node.sloc.end_col};
+}
+
+// Locates `pos` in `input`. Fails if `input` has no such position, i.e. the
+// edit does not match the text.
+static bool offset_of(const char *input, struct position pos, size_t *offset)
+{
+	const char *line = input;
+	for (int l = 1; l < pos.line; ++l) {
+		line = strchr(line, '\n');
+		if (!line) {
+			return false;
+		}
+		line++;
+	}
+
+	if (pos.line < 1 || pos.col < 1 || (size_t)(pos.col - 1) > strcspn(line, "\n")) {
+		return false;
+	}
+
+	*offset = (size_t)(line - input) + (size_t)(pos.col - 1);
+	return true;
+}
+
+// ---------------------------------------------------------------- Shifting
+
+// Moves positions at or after `from` so that `from` ends up at `to`. Columns
+// only change on the line of `from`, the other lines move as a whole.
+struct shift {
+	struct position from;
+	struct position to;
+};
+
+static void shift_position(const struct shift *shift, int *line, int *col)
+{
+	if (*line == shift->from.line) {
+		*col += shift->to.col - shift->from.col;
+	}
+	*line += shift->to.line - shift->from.line;
+}
+
+enum kind {
+	KIND_FUNCTION_DEF,
+	KIND_PARAMETER,
+	KIND_DECLARATION,
+	KIND_IDENTIFIER,
+	KIND_STATEMENT,
+	KIND_STATEMENT_LIST,
+	KIND_EXPRESSION,
+	KIND_ARGUMENT,
+	KIND_LITERAL,
+};
+
+// Every node type starts with its `mcc_ast_node`, which is what gets shifted.
+struct pending {
+	enum kind kind;
+	void *node;
+};
+
+// Work list of a shift, the tree is walked without recursion.
+struct walk {
+	struct pending *stack;
+	uint32_t count;
+	uint32_t capacity;
+	bool failed;
+};
+
+static void push(struct walk *walk, enum kind kind, void *node)
+{
+	if (!node || walk->failed) {
+		return;
+	}
+
+	if (!reserve((void **)&walk->stack, &walk->capacity, walk->count, 1, sizeof(*walk->stack))) {
+		walk->failed = true;
+		return;
+	}
+
+	walk->stack[walk->count++] = (struct pending){
+	    .kind = kind,
+	    .node = node,
+	};
+}
+
+static void push_children(struct walk *walk, const struct pending *p)
+{
+	switch (p->kind) {
+	case KIND_FUNCTION_DEF: {
+		struct mcc_ast_function_def *def = p->node;
+		push(walk, KIND_IDENTIFIER, def->identifier);
+		push(walk, KIND_PARAMETER, def->parameter);
+		push(walk, KIND_STATEMENT, def->compund_statement);
+		break;
+	}
+
+	case KIND_PARAMETER: {
+		struct mcc_ast_parameter *parameter = p->node;
+		push(walk, KIND_PARAMETER, parameter->next);
+		push(walk, KIND_DECLARATION, parameter->declaration);
+		break;
+	}
+
+	case KIND_DECLARATION: {
+		struct mcc_ast_declaration *declaration = p->node;
+		push(walk, KIND_LITERAL, declaration->array_size);
+		push(walk, KIND_IDENTIFIER, declaration->identifier);
+		break;
+	}
+
+	case KIND_STATEMENT: {
+		struct mcc_ast_statement *statement = p->node;
+		switch (statement->type) {
+		case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+			push(walk, KIND_EXPRESSION, statement->expression);
+			break;
+		case MCC_AST_STATEMENT_TYPE_IF:
+			push(walk, KIND_EXPRESSION, statement->if_condition);
+			push(walk, KIND_STATEMENT, statement->if_stmt);
+			push(walk, KIND_STATEMENT, statement->else_stmt);
+			break;
+		case MCC_AST_STATEMENT_TYPE_WHILE:
+			push(walk, KIND_EXPRESSION, statement->while_condition);
+			push(walk, KIND_STATEMENT, statement->while_stmt);
+			break;
+		case MCC_AST_STATEMENT_TYPE_DECL:
+			push(walk, KIND_DECLARATION, statement->declaration);
+			break;
+		case MCC_AST_STATEMENT_TYPE_ASSGN:
+			push(walk, KIND_IDENTIFIER, statement->id_assgn);
+			push(walk, KIND_EXPRESSION, statement->lhs_assgn);
+			push(walk, KIND_EXPRESSION, statement->rhs_assgn);
+			break;
+		case MCC_AST_STATEMENT_TYPE_COMPOUND:
+			push(walk, KIND_STATEMENT_LIST, statement->compound_statement);
+			break;
+		case MCC_AST_STATEMENT_TYPE_RETURN:
+			push(walk, KIND_EXPRESSION, statement->return_value);
+			break;
+		}
+		break;
+	}
+
+	case KIND_STATEMENT_LIST: {
+		struct mcc_ast_statement_list *list = p->node;
+		push(walk, KIND_STATEMENT_LIST, list->next);
+		push(walk, KIND_STATEMENT, list->statement);
+		break;
+	}
+
+	case KIND_EXPRESSION: {
+		struct mcc_ast_expression *expression = p->node;
+		switch (expression->type) {
+		case MCC_AST_STATEMENT_TYPE_EXPR:
+			break;
+		case MCC_AST_EXPRESSION_TYPE_LITERAL:
+			push(walk, KIND_LITERAL, expression->literal);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+			push(walk, KIND_EXPRESSION, expression->lhs);
+			push(walk, KIND_EXPRESSION, expression->rhs);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+			push(walk, KIND_EXPRESSION, expression->rhs);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_PARENTH:
+			push(walk, KIND_EXPRESSION, expression->expression);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+			push(walk, KIND_IDENTIFIER, expression->identifier);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+			push(walk, KIND_IDENTIFIER, expression->array);
+			push(walk, KIND_EXPRESSION, expression->index);
+			break;
+		case MCC_AST_EXPRESSION_TYPE_CALL:
+			push(walk, KIND_IDENTIFIER, expression->function);
+			push(walk, KIND_ARGUMENT, expression->arguments);
+			break;
+		}
+		break;
+	}
+
+	case KIND_ARGUMENT: {
+		struct mcc_ast_argument *argument = p->node;
+		push(walk, KIND_ARGUMENT, argument->next);
+		push(walk, KIND_EXPRESSION, argument->expression);
+		break;
+	}
+
+	case KIND_IDENTIFIER:
+	case KIND_LITERAL:
+		break;
+	}
+}
+
+// Shifts the source locations of `def`, the function definitions following it
+// and all their descendants. Returns false if the work list could not be
+// grown, leaving the locations partly shifted.
+static bool shift_function_defs(struct walk *walk, struct mcc_ast_function_def *def, const struct shift *shift)
+{
+	for (; def && !walk->failed; def = def->next) {
+		// Definitions starting below the line of `from` only move if lines do.
+		if (shift->from.line == shift->to.line &&
+		    (shift->from.col == shift->to.col || def->node.sloc.start_line > shift->from.line)) {
+			break;
+		}
+
+		push(walk, KIND_FUNCTION_DEF, def);
+
+		while (walk->count > 0 && !walk->failed) {
+			struct pending p = walk->stack[--walk->count];
+
+			struct mcc_ast_node *node = p.node;
+			shift_position(shift, &node->sloc.start_line, &node->sloc.start_col);
+			shift_position(shift, &node->sloc.end_line, &node->sloc.end_col);
+
+			push_children(walk, &p);
+		}
+	}
+
+	return !walk->failed;
+}
+
+// Bytes the arena holds for the node of `p`, not counting alignment padding.
+static size_t node_size(const struct pending *p)
+{
+	switch (p->kind) {
+	case KIND_FUNCTION_DEF:
+		return sizeof(struct mcc_ast_function_def);
+	case KIND_PARAMETER:
+		return sizeof(struct mcc_ast_parameter);
+	case KIND_DECLARATION:
+		return sizeof(struct mcc_ast_declaration);
+	case KIND_IDENTIFIER:
+		// the name is interned, not held by the arena
+		return sizeof(struct mcc_ast_identifier);
+	case KIND_STATEMENT:
+		return sizeof(struct mcc_ast_statement);
+	case KIND_STATEMENT_LIST:
+		return sizeof(struct mcc_ast_statement_list);
+	case KIND_EXPRESSION:
+		return sizeof(struct mcc_ast_expression);
+	case KIND_ARGUMENT:
+		return sizeof(struct mcc_ast_argument);
+	case KIND_LITERAL: {
+		const struct mcc_ast_literal *literal = p->node;
+		if (literal->type == MCC_AST_LITERAL_TYPE_STRING) {
+			return sizeof(*literal) + strlen(literal->s_value) + 1;
+		}
+		return sizeof(*literal);
+	}
+	}
+	return 0;
+}
+
+// Adds the bytes held by the function definitions from `def` up to `end`,
+// exclusive, and all their descendants to `*bytes`. Returns false if the work
+// list could not be grown.
+static bool measure_function_defs(struct walk *walk,
+                                  struct mcc_ast_function_def *def,
+                                  const struct mcc_ast_function_def *end,
+                                  size_t *bytes)
+{
+	for (; def != end && !walk->failed; def = def->next) {
+		push(walk, KIND_FUNCTION_DEF, def);
+
+		while (walk->count > 0 && !walk->failed) {
+			struct pending p = walk->stack[--walk->count];
+			*bytes += node_size(&p);
+			push_children(walk, &p);
+		}
+	}
+
+	return !walk->failed;
+}
+
+// ---------------------------------------------------------------- Reparsing
+
+static bool is_identifier_char(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// Parses the text between the function definitions `before` and `after` of
+// the old program, both unaffected by the edit and possibly NULL, and splices
+// the result in between. Returns false if the text has to be parsed as a
+// whole instead; the old tree is then only fit for deleting.
+static bool reparse(struct mcc_parser_result *result,
+                    const char *input,
+                    const struct mcc_parser_edit *edit,
+                    struct mcc_ast_function_def *before,
+                    struct mcc_ast_function_def *after)
+{
+	struct mcc_ast_program *program = result->program;
+
+	// definitions preceding the edit keep their position
+	struct position region_start = before ? end_of(before) : (struct position){1, 1};
+	struct shift following = {
+	    .from = {edit->old_end_line, edit->old_end_col},
+	    .to = {edit->new_end_line, edit->new_end_col},
+	};
+
+	size_t start;
+	size_t end = strlen(input);
+	if (!offset_of(input, region_start, &start)) {
+		return false;
+	}
+	if (after) {
+		struct position region_end = start_of(after);
+		shift_position(&following, &region_end.line, &region_end.col);
+		if (!offset_of(input, region_end, &end) || end < start) {
+			return false;
+		}
+
+		// A definition starts with a type keyword, which the full scan would
+		// merge with an identifier or number directly in front of it.
+		if (end > start && is_identifier_char(input[end - 1])) {
+			return false;
+		}
+	}
+
+	char *text = malloc(end - start + 1);
+	if (!text) {
+		return false;
+	}
+	memcpy(text, input + start, end - start);
+	text[end - start] = '\0';
+
+	// Anything left open at the end of the region, like a comment or string
+	// literal, fails to scan here.
+	struct mcc_parser_result region = mcc_parse_string(text);
+	free(text);
+
+	if (region.status != MCC_PARSER_STATUS_OK || !region.program) {
+		mcc_parser_delete_result(&region);
+		return false;
+	}
+
+	struct walk walk = {0};
+	struct shift into_place = {
+	    .from = {1, 1},
+	    .to = region_start,
+	};
+	size_t replaced = 0;
+	bool shifted = measure_function_defs(&walk, before ? before->next : program->function_def, after, &replaced) &&
+	               shift_function_defs(&walk, region.program->function_def, &into_place) &&
+	               shift_function_defs(&walk, after, &following);
+	free(walk.stack);
+
+	if (!shifted) {
+		mcc_parser_delete_result(&region);
+		return false;
+	}
+
+	struct mcc_ast_function_def *first = region.program->function_def;
+	struct mcc_ast_function_def *last = region.program->last_function_def;
+	if (!first) {
+		first = after;
+		last = before;
+	} else {
+		last->next = after;
+	}
+
+	if (before) {
+		before->next = first;
+	} else {
+		program->function_def = first;
+	}
+	if (!after) {
+		program->last_function_def = last;
+	}
+
+	mcc_arena_merge(&result->arena, &region.arena);
+	mcc_parser_delete_result(&region);
+	result->dead_bytes += replaced;
+	return true;
+}
+
+struct mcc_parser_result
+mcc_parse_incremental(struct mcc_parser_result *previous, const char *input, const struct mcc_parser_edit *edit)
+{
+	assert(previous);
+	assert(input);
+	assert(edit);
+
+	struct position start = {edit->start_line, edit->start_col};
+	struct position old_end = {edit->old_end_line, edit->old_end_col};
+	assert(compare(start, old_end) <= 0);
+	assert(compare(start, (struct position){edit->new_end_line, edit->new_end_col}) <= 0);
+
+	struct mcc_parser_result result = *previous;
+	*previous = (struct mcc_parser_result){
+	    .status = MCC_PARSER_STATUS_OK,
+	};
+	mcc_arena_init(&previous->arena);
+
+	// Locations of merged inputs refer to different files.
+	if (result.status == MCC_PARSER_STATUS_OK && result.program && result.input_count == 0) {
+		struct mcc_ast_function_def *before = NULL;
+		struct mcc_ast_function_def *after = result.program->function_def;
+		while (after && compare(end_of(after), start) <= 0) {
+			before = after;
+			after = after->next;
+		}
+
+		// Text inserted right in front of a definition may join its first
+		// token, hence it only counts as unaffected if it starts later.
+		while (after && compare(start_of(after), old_end) <= 0) {
+			after = after->next;
+		}
+
+		// Replaced definitions stay in the arena; start over once they take
+		// up more of it than the tree does.
+		if (reparse(&result, input, edit, before, after)) {
+			struct mcc_arena_stats stats;
+			mcc_arena_stats(&result.arena, &stats);
+			if (result.dead_bytes <= stats.used / 2) {
+				return result;
+			}
+		}
+	}
+
+	mcc_parser_delete_result(&result);
+	return mcc_parse_string(input);
+}
@@ -0,0 +1,80 @@
+#include "mcc/parser.h"
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "parser_engines.h"
+
+static atomic_int engine = MCC_PARSER_ENGINE_BISON;
+
+void mcc_parser_set_engine(enum mcc_parser_engine value)
+{
+	atomic_store(&engine, value);
+}
+
+enum mcc_parser_engine mcc_parser_get_engine(void)
+{
+	return (enum mcc_parser_engine)atomic_load(&engine);
+}
+
+bool mcc_parser_engine_from_name(const char *name, enum mcc_parser_engine *value)
+{
+	assert(name);
+	assert(value);
+
+	if (strcmp(name, "bison") == 0) {
+		*value = MCC_PARSER_ENGINE_BISON;
+		return true;
+	}
+	if (strcmp(name, "descent") == 0) {
+		*value = MCC_PARSER_ENGINE_DESCENT;
+		return true;
+	}
+	return false;
+}
+
+struct mcc_parser_result mcc_parse_string(const char *input)
+{
+	if (mcc_parser_get_engine() == MCC_PARSER_ENGINE_DESCENT) {
+		return mcc_parser_descent_parse_string(input);
+	}
+	return mcc_parser_bison_parse_string(input);
+}
+
+struct mcc_parser_result mcc_parse_buffer(char *data, size_t len)
+{
+	if (mcc_parser_get_engine() == MCC_PARSER_ENGINE_DESCENT) {
+		return mcc_parser_descent_parse_buffer(data, len);
+	}
+	return mcc_parser_bison_parse_buffer(data, len);
+}
+
+struct mcc_parser_result mcc_parse_file(FILE *input)
+{
+	if (mcc_parser_get_engine() == MCC_PARSER_ENGINE_DESCENT) {
+		return mcc_parser_descent_parse_file(input);
+	}
+	return mcc_parser_bison_parse_file(input);
+}
+
+void mcc_parser_delete_result(struct mcc_parser_result *result)
+{
+	assert(result);
+
+	mcc_arena_release(&result->arena);
+
+	result->expression = NULL;
+	result->literal = NULL;
+	result->declaration = NULL;
+	result->statement = NULL;
+	result->program = NULL;
+
+	for (size_t i = 0; i < result->input_count; ++i) {
+		mcc_mapped_file_close(&result->inputs[i]);
+	}
+	free(result->inputs);
+	result->inputs = NULL;
+	result->input_count = 0;
+}
@@ -2,13 +2,24 @@
 
 %define api.pure full
 %lex-param   {void *scanner}
-%parse-param {void *scanner} {struct mcc_ast_expression** result_expression}{ struct mcc_ast_function** result_function}{struct mcc_ast_declaration** result_declaration}
+%parse-param {void *scanner} {struct mcc_arena *arena} {struct mcc_parser_result *result}
 
 %define parse.trace
 %define parse.error verbose
 
 %code requires {
+#include <stdbool.h>
+
 #include "mcc/parser.h"
+
+// Scanner state, accessible via `yyextra`.
+struct mcc_parser_scanner_extra {
+	struct mcc_arena *arena;
+
+	// Set if the input buffer outlives the AST. Tokens may then refer to the
+	// input directly instead of copying their text.
+	bool borrow_input;
+};
 }
 
 %{
@@ -17,24 +28,49 @@
 int mcc_parser_lex();
 void mcc_parser_error();
 
+// Attaches the location `ast_sloc` to `ast_node`. Constructors only fail when
+// running out of memory, which aborts the parse.
 #define loc(ast_node, ast_sloc) \
-	(ast_node)->node.sloc.start_col = (ast_sloc).first_column;
-
+	do { \
+		if (!(ast_node)) { \
+			YYABORT; \
+		} \
+		(ast_node)->node.sloc.start_line = (ast_sloc).first_line; \
+		(ast_node)->node.sloc.start_col = (ast_sloc).first_column; \
+		(ast_node)->node.sloc.end_line = (ast_sloc).last_line; \
+		(ast_node)->node.sloc.end_col = (ast_sloc).last_column; \
+	} while (0)
 %}
 
+%code {
+// Statement lists are built back to front, as left recursion keeps the parser
+// stack flat. This restores the source order.
+static struct mcc_ast_statement_list *reverse_statement_list(struct mcc_ast_statement_list *list)
+{
+	struct mcc_ast_statement_list *reversed = NULL;
+	while (list) {
+		struct mcc_ast_statement_list *next = list->next;
+		list->next = reversed;
+		reversed = list;
+		list = next;
+	}
+	return reversed;
+}
+}
+
 %define api.value.type union
 %define api.token.prefix {TK_}
 
 %locations
 
 %token END 0 "EOF"
-%token <char*>   INT_LITERAL   "integer literal"
-%token <char*> FLOAT_LITERAL "float literal"
-%token <char*>   STRING_LITERAL   "string literal"
-%token <char*> IDENTIFIER "identifier"
-%token <char*> BOOL_LITERAL "bool literal"
+%token INVALID "invalid character"
 
-%token <char*>  TYPE            "type"
+%token <long>   INT_LITERAL    "integer literal"
+%token <double> FLOAT_LITERAL  "float literal"
+%token <char *> STRING_LITERAL "string literal"
+%token <bool>   BOOL_LITERAL   "bool literal"
+%token <struct mcc_ast_identifier *> IDENTIFIER "identifier"
 
 %token LPARENTH "("
 %token RPARENTH ")"
@@ -79,171 +115,303 @@ void mcc_parser_error();
 %token FOR "for"
 %token RETURN "return"
 
+// lowest precedence first, `parser_descent.c` mirrors these levels
+%left OR
+%left AND
+%left EQUALS NOT_EQUALS
+%left LESS GREATER LESS_EQ GREATER_EQ
+%left PLUS MINUS
+%left ASTER SLASH
+%precedence UNARY
+
+// a dangling else belongs to the innermost if
+%precedence THEN
+%precedence ELSE
+
 %type <struct mcc_ast_literal *> literal
 %type <struct mcc_ast_expression *> expression
 %type <struct mcc_ast_identifier *> identifier
+%type <struct mcc_ast_argument *> arguments
 %type <struct mcc_ast_declaration *> declaration
-%type <struct mcc_ast_statement *> statement if_statement while_statement compound_statement assignment //compound_block 
+%type <struct mcc_ast_statement *> statement if_statement while_statement return_statement compound_statement assignment
+%type <struct mcc_ast_statement_list *> statement_list
 
-//%type <enum mcc_ast_data_type> type VOID_TYPE
-%type <enum mcc_ast_binary_op> binary_op
-//%type <enum mcc_ast_unary_op> unary_op
-%type <enum mcc_ast_literal_type> type VOID_TYPE
+%type <enum mcc_ast_data_type> type
 
 %type <struct mcc_ast_function_def *> function_def
-%type <struct mcc_ast_function *> function
 %type <struct mcc_ast_parameter *> parameters
-//%type <struct mcc_ast_program *> program
-
+%type <struct mcc_ast_program *> program
 
 %start toplevel
 
 %%
 
-toplevel :  function { *result_function  = $1; }
-         | declaration { *result_declaration = $1; }
-          | expression {*result_expression = $1;}
+toplevel : %empty      { result->program = mcc_ast_new_program(arena, NULL); if (!result->program) YYABORT; }
+         | program     { result->program = $1; }
+         | declaration { result->declaration = $1; }
+         | expression  { result->expression = $1; }
+         | statement   { result->statement = $1; }
          ;
 
-expression : literal                      		{ $$ = mcc_ast_new_expression_literal($1); loc($$, @1); }
-           | LPARENTH expression RPARENTH	 	{ $$ = mcc_ast_new_expression_parenth($2); loc($$, @1); }
-		   |expression binary_op expression  	{ $$ = mcc_ast_new_expression_binary_op($1, $2, $3); loc($$, @1); }
-		   | identifier 			{ $$ = mcc_ast_new_expression_identifier($1); loc($$, @1); }
-
+expression : literal                           { $$ = mcc_ast_new_expression_literal(arena, $1);                               loc($$, @$); }
+           | identifier                        { $$ = mcc_ast_new_expression_identifier(arena, $1);                            loc($$, @$); }
+           | identifier LBRACKET expression RBRACKET
+                                               { $$ = mcc_ast_new_expression_array_element(arena, $1, $3);                     loc($$, @$); }
+           | identifier LPARENTH RPARENTH      { $$ = mcc_ast_new_expression_call(arena, $1, NULL);                            loc($$, @$); }
+           | identifier LPARENTH arguments RPARENTH
+                                               { $$ = mcc_ast_new_expression_call(arena, $1, $3);                              loc($$, @$); }
+           | LPARENTH expression RPARENTH      { $$ = mcc_ast_new_expression_parenth(arena, $2);                               loc($$, @$); }
+           | MINUS expression %prec UNARY      { $$ = mcc_ast_new_expression_unary_op(arena, MCC_AST_UNARY_OP_MINUS, $2);      loc($$, @$); }
+           | NOT expression %prec UNARY        { $$ = mcc_ast_new_expression_unary_op(arena, MCC_AST_UNARY_OP_NOT, $2);        loc($$, @$); }
+           | expression PLUS expression        { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_ADD, $1, $3);  loc($$, @$); }
+           | expression MINUS expression       { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_SUB, $1, $3);  loc($$, @$); }
+           | expression ASTER expression       { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_MUL, $1, $3);  loc($$, @$); }
+           | expression SLASH expression       { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_DIV, $1, $3);  loc($$, @$); }
+           | expression LESS expression        { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_LESS, $1, $3); loc($$, @$); }
+           | expression GREATER expression     { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_GREATER, $1, $3);        loc($$, @$); }
+           | expression LESS_EQ expression     { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_LESS_EQUALS, $1, $3);    loc($$, @$); }
+           | expression GREATER_EQ expression  { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_GREATER_EQUALS, $1, $3); loc($$, @$); }
+           | expression EQUALS expression      { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_EQUALS, $1, $3);         loc($$, @$); }
+           | expression NOT_EQUALS expression  { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_NOT_EQUALS, $1, $3);     loc($$, @$); }
+           | expression AND expression         { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_AND, $1, $3);  loc($$, @$); }
+           | expression OR expression          { $$ = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_OR, $1, $3);   loc($$, @$); }
            ;
 
-literal : INT_LITERAL       { $$ = mcc_ast_new_literal_int($1);     loc($$, @1); }
-        | FLOAT_LITERAL     { $$ = mcc_ast_new_literal_float($1);   loc($$, @1); }
-		| STRING_LITERAL    { $$ = mcc_ast_new_literal_string($1);  loc($$,@1);  }
-		| BOOL_LITERAL      { $$ = mcc_ast_new_literal_bool($1);    loc($$,@1);  }
-		;
-
-//unary_op : NOT { $$ = MCC_AST_UNARY_OP_NOT; }
-		 | MINUS  {$$ = MCC_AST_UNARY_OP_MINUS; }
-		 ;
-
-binary_op : PLUS { $$= MCC_AST_BINARY_OP_ADD; }
-			//| MINUS { $$ = MCC_AST_BINARY_OP_SUB; }
-			| ASTER { $$ = MCC_AST_BINARY_OP_MUL; }
-			| SLASH { $$ = MCC_AST_BINARY_OP_DIV; }
-			| EQUALS { $$ = MCC_AST_BINARY_OP_EQUALS; }
-			//| NOT_EQUALS { $$ = MCC_AST_BINARY_OP_NOT_EQUALS; }
-			| LESS { $$ = MCC_AST_BINARY_OP_LESS; }
-			| GREATER { $$ = MCC_AST_BINARY_OP_GREATER; }
-			| LESS_EQ { $$ = MCC_AST_BINARY_OP_LESS_EQUALS; }
-			| GREATER_EQ { $$ = MCC_AST_BINARY_OP_GREATER_EQUALS; }
-			;
-
-type : INT_TYPE { $$ = MCC_AST_DATA_TYPE_INT; }
-     | FLOAT_TYPE { $$ = MCC_AST_DATA_TYPE_FLOAT; }
+arguments : expression                 { $$ = mcc_ast_new_argument(arena, $1);                loc($$, @1); }
+          | expression COMMA arguments { $$ = mcc_ast_new_argument(arena, $1); loc($$, @1); $$->next = $3; }
+          ;
+
+literal : INT_LITERAL    { $$ = mcc_ast_new_literal_int(arena, $1);    loc($$, @1); }
+        | FLOAT_LITERAL  { $$ = mcc_ast_new_literal_float(arena, $1);  loc($$, @1); }
+        | STRING_LITERAL { $$ = mcc_ast_new_literal_string(arena, $1); loc($$, @1); }
+        | BOOL_LITERAL   { $$ = mcc_ast_new_literal_bool(arena, $1);   loc($$, @1); }
+        ;
+
+type : INT_TYPE    { $$ = MCC_AST_DATA_TYPE_INT; }
+     | FLOAT_TYPE  { $$ = MCC_AST_DATA_TYPE_FLOAT; }
      | STRING_TYPE { $$ = MCC_AST_DATA_TYPE_STRING; }
-	 | BOOL_TYPE { $$ = MCC_AST_DATA_TYPE_BOOL; }
-	 | VOID_TYPE { $$ = MCC_AST_DATA_TYPE_VOID;}
+     | BOOL_TYPE   { $$ = MCC_AST_DATA_TYPE_BOOL; }
      ;
 
-
-identifier : IDENTIFIER { $$ = mcc_ast_new_identifier($1); loc($$, @1); }
+identifier : IDENTIFIER { $$ = $1; loc($$, @1); }
            ;
 
-statement : expression SEMICOLON    { $$ = mcc_ast_new_statement_expression($1); loc($$, @1); }
-          | if_statement            { $$= $1;  loc($$, @1); }
-		  | while_statement         { $$ = $1; loc($$, @1); }
-		 | compound_statement      { $$ = $1; loc($$, @1); }
-          | assignment SEMICOLON    { $$ = $1; loc($$, @1); }
-          | declaration SEMICOLON   { $$ = $1; loc($$, @1); }
-		  ;
-
-if_statement: IF LPARENTH expression RPARENTH statement { $$ = mcc_ast_new_statment_if($3, $5);                     loc($$, @1); }
-            | IF LPARENTH expression RPARENTH statement ELSE statement { $$ = mcc_ast_new_statment_if($3, $5, $7);  loc($$, @1); }
+declaration : type identifier                              { $$ = mcc_ast_new_declaration(arena, $1, NULL, $2); loc($$, @$); }
+            | type LBRACKET INT_LITERAL RBRACKET identifier { struct mcc_ast_literal *size = mcc_ast_new_literal_int(arena, $3); loc(size, @3);
+                                                               $$ = mcc_ast_new_declaration(arena, $1, size, $5); loc($$, @$); }
             ;
 
-declaration: type IDENTIFIER SEMICOLON { $$ = mcc_ast_new_declaration($1, $2); loc($$, @1); }
-		   ;
-
-while_statement: WHILE LPARENTH expression RPARENTH statement { $$ = mcc_ast_new_statement_while($3, $5); loc($$, @1); }
-			   ;
-
-compound_statement: statement { $$ = mcc_ast_new_statement_compound($1); loc($$, @1); }
-                   | compound_statement statement { $$ = mcc_ast_add_compound_statement($1, $2);loc($$, @1); }
-                   ;
+statement : if_statement
+          | while_statement
+          | return_statement
+          | compound_statement
+          | expression SEMICOLON  { $$ = mcc_ast_new_statement_expression(arena, $1);  loc($$, @$); }
+          | assignment SEMICOLON  { $$ = $1;                                           loc($$, @$); }
+          | declaration SEMICOLON { $$ = mcc_ast_new_statement_declaration(arena, $1); loc($$, @$); }
+          ;
 
-/* Took this idea from : https://norasandler.com/2018/02/25/Write-a-Compiler-6.html */
+if_statement : IF LPARENTH expression RPARENTH statement %prec THEN     { $$ = mcc_ast_new_statement_if(arena, $3, $5, NULL); loc($$, @$); }
+             | IF LPARENTH expression RPARENTH statement ELSE statement { $$ = mcc_ast_new_statement_if(arena, $3, $5, $7);   loc($$, @$); }
+             ;
 
-/*compound_block : statement { $$ = mcc_ast_new_statement_compound_block($1, $1); loc($$, @1); }
-		   	  | compound_block statement { $$ = mcc_ast_add_compound_statement($1, $2); loc($$, @1); }
-		   	  ;*/
+while_statement : WHILE LPARENTH expression RPARENTH statement { $$ = mcc_ast_new_statement_while(arena, $3, $5); loc($$, @$); }
+                ;
 
+return_statement : RETURN SEMICOLON            { $$ = mcc_ast_new_statement_return(arena, NULL); loc($$, @$); }
+                 | RETURN expression SEMICOLON { $$ = mcc_ast_new_statement_return(arena, $2);   loc($$, @$); }
+                 ;
 
-assignment:  IDENTIFIER ASSIGNMENT expression 					            { $$ = mcc_ast_new_statement_assignment($1, 0, $3); 	loc($$, @1); };
-          |  IDENTIFIER LBRACKET expression RBRACKET ASSIGNMENT expression  { $$ = mcc_ast_new_statement_assignment($1, $3, $6); 	loc($$, @1); };
-          ;
+compound_statement : LBRACE RBRACE                { $$ = mcc_ast_new_statement_compound(arena, NULL);                       loc($$, @$); }
+                   | LBRACE statement_list RBRACE { $$ = mcc_ast_new_statement_compound(arena, reverse_statement_list($2)); loc($$, @$); }
+                   ;
 
-parameters  : declaration COMMA parameters { $$ = mcc_ast_new_parameter($1); $$->next = $3; loc($$, @1); }
-			| declaration                  { $$ = mcc_ast_new_parameter($1);                loc($$, @1); }
-			;
+statement_list : statement                { $$ = mcc_ast_new_statement_list(arena, $1); loc($$, @1); }
+               | statement_list statement { $$ = mcc_ast_new_statement_list(arena, $2); loc($$, @2); $$->next = $1; }
+               ;
 
+assignment : identifier ASSIGNMENT expression                            { $$ = mcc_ast_new_statement_assignment(arena, $1, NULL, $3); loc($$, @$); }
+           | identifier LBRACKET expression RBRACKET ASSIGNMENT expression { $$ = mcc_ast_new_statement_assignment(arena, $1, $3, $6);   loc($$, @$); }
+           ;
 
-function_def     :  VOID_TYPE identifier
-                    LPARENTH parameters RPARENTH LBRACKET compound_statement RBRACKET    { $$ = mcc_ast_void_function_def ($2, $4, $7); loc($$, @2); }
+parameters : declaration                  { $$ = mcc_ast_new_parameter(arena, $1);                loc($$, @1); }
+           | declaration COMMA parameters { $$ = mcc_ast_new_parameter(arena, $1); loc($$, @1); $$->next = $3; }
+           ;
 
-function : function function_def  { $$ = mcc_ast_new_function($1, $2); }
-         | function_def     { $$ = mCc_ast_new_function_def($1); }
-	 ;
+function_def : type identifier LPARENTH RPARENTH compound_statement                 { $$ = mcc_ast_new_function_def(arena, $1, $2, NULL, $5);                    loc($$, @$); }
+             | type identifier LPARENTH parameters RPARENTH compound_statement      { $$ = mcc_ast_new_function_def(arena, $1, $2, $4, $6);                      loc($$, @$); }
+             | VOID_TYPE identifier LPARENTH RPARENTH compound_statement            { $$ = mcc_ast_new_function_def(arena, MCC_AST_DATA_TYPE_VOID, $2, NULL, $5); loc($$, @$); }
+             | VOID_TYPE identifier LPARENTH parameters RPARENTH compound_statement { $$ = mcc_ast_new_function_def(arena, MCC_AST_DATA_TYPE_VOID, $2, $4, $6);   loc($$, @$); }
+             ;
 
-//program : function_def { $$ = mcc_ast_new_program($1); loc($$, @1);}
-		;
+// Programs have no location, merged programs span several inputs.
+program : function_def         { $$ = mcc_ast_new_program(arena, $1); if (!$$) YYABORT; }
+        | program function_def { mcc_ast_add_function_def($1, $2); $$ = $1; }
+        ;
 
 %%
 
 #include <assert.h>
+#include <stdlib.h>
 
+#include "parser_engines.h"
 #include "scanner.h"
 #include "utils/unused.h"
 
-void mcc_parser_error(struct MCC_PARSER_LTYPE *yylloc, yyscan_t *scanner, const char *msg)
+void mcc_parser_error(struct MCC_PARSER_LTYPE *yylloc,
+                      yyscan_t *scanner,
+                      struct mcc_arena *arena,
+                      struct mcc_parser_result *result,
+                      const char *msg)
 {
 	// TODO
 	UNUSED(yylloc);
 	UNUSED(scanner);
+	UNUSED(arena);
+	UNUSED(result);
 	UNUSED(msg);
 }
 
-struct mcc_parser_result mcc_parse_string(const char *input)
+// Runs the parser on a scanner whose input has already been set up.
+static void parse(yyscan_t scanner, struct mcc_parser_result *result)
+{
+	if (yyparse(scanner, &result->arena, result) != 0) {
+		mcc_parser_delete_result(result);
+		result->status = MCC_PARSER_STATUS_UNKNOWN_ERROR;
+	}
+}
+
+struct mcc_parser_result mcc_parser_bison_parse_string(const char *input)
 {
 	assert(input);
 
-	FILE *in = fmemopen((void *)input, strlen(input), "r");
-	if (!in) {
-		return (struct mcc_parser_result){
-		    .status = MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM,
-		};
+	struct mcc_parser_result result = {
+	    .status = MCC_PARSER_STATUS_OK,
+	};
+	mcc_arena_init(&result.arena);
+
+	// The scanner works on its own copy of the input.
+	struct mcc_parser_scanner_extra extra = {
+	    .arena = &result.arena,
+	    .borrow_input = false,
+	};
+
+	yyscan_t scanner;
+	if (mcc_parser_lex_init_extra(&extra, &scanner) != 0) {
+		result.status = MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM;
+		return result;
 	}
 
-	struct mcc_parser_result result = mcc_parse_file(in);
+	YY_BUFFER_STATE buffer = mcc_parser__scan_bytes(input, strlen(input), scanner);
+	if (!buffer) {
+		result.status = MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM;
+	} else {
+		parse(scanner, &result);
+		mcc_parser__delete_buffer(buffer, scanner);
+	}
 
-	fclose(in);
+	mcc_parser_lex_destroy(scanner);
 
 	return result;
 }
 
-struct mcc_parser_result mcc_parse_file(FILE *input)
+struct mcc_parser_result mcc_parser_bison_parse_buffer(char *data, size_t len)
 {
-    printf("Parse file \n");
-	assert(input);
+	assert(data);
+	assert(data[len] == '\0' && data[len + 1] == '\0');
+
+	struct mcc_parser_result result = {
+	    .status = MCC_PARSER_STATUS_OK,
+	};
+	mcc_arena_init(&result.arena);
+
+	struct mcc_parser_scanner_extra extra = {
+	    .arena = &result.arena,
+	    .borrow_input = true,
+	};
 
 	yyscan_t scanner;
-	mcc_parser_lex_init(&scanner);
-	mcc_parser_set_in(input, scanner);
+	if (mcc_parser_lex_init_extra(&extra, &scanner) != 0) {
+		result.status = MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM;
+		return result;
+	}
+
+	// Scans the buffer in place, no copy is made.
+	YY_BUFFER_STATE buffer = mcc_parser__scan_buffer(data, len + 2, scanner);
+	if (!buffer) {
+		result.status = MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM;
+	} else {
+		parse(scanner, &result);
+		mcc_parser__delete_buffer(buffer, scanner);
+	}
+
+	mcc_parser_lex_destroy(scanner);
+
+	return result;
+}
+
+struct mcc_parser_result mcc_parser_bison_parse_file(FILE *input)
+{
+	assert(input);
 
 	struct mcc_parser_result result = {
 	    .status = MCC_PARSER_STATUS_OK,
 	};
+	mcc_arena_init(&result.arena);
+
+	struct mcc_parser_scanner_extra extra = {
+	    .arena = &result.arena,
+	    .borrow_input = false,
+	};
 
-	if (yyparse(scanner, &result.literal, &result.declaration) != 0) {
-		result.status = MCC_PARSER_STATUS_UNKNOWN_ERROR;
+	yyscan_t scanner;
+	if (mcc_parser_lex_init_extra(&extra, &scanner) != 0) {
+		result.status = MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM;
+		return result;
 	}
+	mcc_parser_set_in(input, scanner);
+
+	parse(scanner, &result);
 
 	mcc_parser_lex_destroy(scanner);
 
 	return result;
 }
+
+long mcc_parser_bison_lex_buffer(char *data, size_t len)
+{
+	assert(data);
+	assert(data[len] == '\0' && data[len + 1] == '\0');
+
+	// identifiers are created by the scanner
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_parser_scanner_extra extra = {
+	    .arena = &arena,
+	    .borrow_input = true,
+	};
+
+	yyscan_t scanner;
+	if (mcc_parser_lex_init_extra(&extra, &scanner) != 0) {
+		return -1;
+	}
+
+	long count = -1;
+
+	YY_BUFFER_STATE buffer = mcc_parser__scan_buffer(data, len + 2, scanner);
+	if (buffer) {
+		MCC_PARSER_STYPE value;
+		MCC_PARSER_LTYPE location = {1, 1, 1, 1};
+
+		count = 0;
+		while (mcc_parser_lex(&value, &location, scanner) != TK_END) {
+			count++;
+		}
+		mcc_parser__delete_buffer(buffer, scanner);
+	}
+
+	mcc_parser_lex_destroy(scanner);
+	mcc_arena_release(&arena);
+
+	return count;
+}
@@ -0,0 +1,1017 @@
+// Recursive Descent Parser
+//
+// A hand-written alternative to the bison grammar in `parser.y`. Statements
+// and definitions are parsed by plain recursive descent, expressions by
+// precedence climbing (Pratt parsing). The precedence levels and the
+// associativity of operators, as well as the source locations attached to
+// nodes, mirror the declarations in `parser.y`; both parsers thus build
+// identical ASTs.
+//
+// Tokens come from the hand-written lexer (`mcc/lexer.h`) which works on the
+// input in place. At most two tokens of lookahead are needed: for telling
+// function definitions from declarations at the toplevel, and for telling
+// assignments from expressions.
+
+#include "parser_engines.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/lexer.h"
+#include "utils/reserve.h"
+
+// Limits the nesting of statements and expressions, such that deeply nested
+// inputs are rejected instead of exhausting the stack. The bison parser has a
+// similar limit on its stack depth.
+#define MAX_DEPTH 10000
+
+struct parser {
+	struct mcc_lexer lexer;
+
+	// tokens[0] is the current token, followed by up to two lookahead tokens
+	struct mcc_token tokens[3];
+	unsigned buffered;
+
+	// end of the most recently consumed token
+	int prev_end_line;
+	int prev_end_col;
+
+	struct mcc_arena *arena;
+
+	// Set if the input buffer outlives the AST and is writable. String
+	// literals are then terminated in place instead of being copied.
+	bool borrow_input;
+
+	unsigned depth;
+	bool failed;
+};
+
+// ------------------------------------------------------------------- Tokens
+
+static const struct mcc_token *current(const struct parser *p)
+{
+	return &p->tokens[0];
+}
+
+static const struct mcc_token *peek(struct parser *p, unsigned n)
+{
+	assert(n < sizeof(p->tokens) / sizeof(p->tokens[0]));
+
+	while (p->buffered <= n) {
+		mcc_lexer_next(&p->lexer, &p->tokens[p->buffered++]);
+	}
+	return &p->tokens[n];
+}
+
+static void advance(struct parser *p)
+{
+	p->prev_end_line = p->tokens[0].sloc.end_line;
+	p->prev_end_col = p->tokens[0].sloc.end_col;
+
+	if (p->buffered > 1) {
+		memmove(&p->tokens[0], &p->tokens[1], (p->buffered - 1) * sizeof(p->tokens[0]));
+		p->buffered--;
+	} else {
+		mcc_lexer_next(&p->lexer, &p->tokens[0]);
+	}
+}
+
+static bool accept(struct parser *p, enum mcc_token_type type)
+{
+	if (current(p)->type != type) {
+		return false;
+	}
+	advance(p);
+	return true;
+}
+
+static void *fail(struct parser *p)
+{
+	p->failed = true;
+	return NULL;
+}
+
+static bool expect(struct parser *p, enum mcc_token_type type)
+{
+	if (!accept(p, type)) {
+		p->failed = true;
+		return false;
+	}
+	return true;
+}
+
+static bool enter(struct parser *p)
+{
+	if (++p->depth > MAX_DEPTH) {
+		p->failed = true;
+		return false;
+	}
+	return true;
+}
+
+static void leave(struct parser *p)
+{
+	p->depth--;
+}
+
+// Sets `sloc` to span from `start` to the end of the last consumed token.
+static void span(struct mcc_ast_source_location *sloc, const struct mcc_ast_source_location *start,
+                 const struct parser *p)
+{
+	sloc->start_line = start->start_line;
+	sloc->start_col = start->start_col;
+	sloc->end_line = p->prev_end_line;
+	sloc->end_col = p->prev_end_col;
+}
+
+// ------------------------------------------------------------------- Terminals
+
+static bool is_type(enum mcc_token_type type)
+{
+	switch (type) {
+	case MCC_TOKEN_BOOL_TYPE:
+	case MCC_TOKEN_INT_TYPE:
+	case MCC_TOKEN_FLOAT_TYPE:
+	case MCC_TOKEN_STRING_TYPE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static enum mcc_ast_data_type parse_type(struct parser *p)
+{
+	enum mcc_ast_data_type type = MCC_AST_DATA_TYPE_VOID;
+
+	switch (current(p)->type) {
+	case MCC_TOKEN_BOOL_TYPE:
+		type = MCC_AST_DATA_TYPE_BOOL;
+		break;
+	case MCC_TOKEN_INT_TYPE:
+		type = MCC_AST_DATA_TYPE_INT;
+		break;
+	case MCC_TOKEN_FLOAT_TYPE:
+		type = MCC_AST_DATA_TYPE_FLOAT;
+		break;
+	case MCC_TOKEN_STRING_TYPE:
+		type = MCC_AST_DATA_TYPE_STRING;
+		break;
+	case MCC_TOKEN_VOID_TYPE:
+		type = MCC_AST_DATA_TYPE_VOID;
+		break;
+	default:
+		p->failed = true;
+		return type;
+	}
+
+	advance(p);
+	return type;
+}
+
+static struct mcc_ast_identifier *parse_identifier(struct parser *p)
+{
+	const struct mcc_token *token = current(p);
+	if (token->type != MCC_TOKEN_IDENTIFIER) {
+		return fail(p);
+	}
+
+	struct mcc_ast_identifier *identifier = mcc_ast_new_identifier_n(p->arena, token->text, token->len);
+	if (!identifier) {
+		return fail(p);
+	}
+
+	identifier->node.sloc = token->sloc;
+	advance(p);
+	return identifier;
+}
+
+// Converts like `strtod`, but stops at the end of the token. The token alone
+// is a valid float literal, the following characters might extend it though
+// (e.g. `1.5e3` is scanned as `1.5` followed by `e3`).
+static double token_to_double(const struct mcc_token *token)
+{
+	char buffer[64];
+	char *copy = token->len < sizeof(buffer) ? buffer : malloc(token->len + 1);
+	if (!copy) {
+		return 0.0;
+	}
+
+	memcpy(copy, token->text, token->len);
+	copy[token->len] = '\0';
+
+	double value = strtod(copy, NULL);
+
+	if (copy != buffer) {
+		free(copy);
+	}
+	return value;
+}
+
+static char *token_to_string(struct parser *p, const struct mcc_token *token)
+{
+	// without the surrounding quotes
+	const char *text = token->text + 1;
+	size_t len = token->len - 2;
+
+	if (p->borrow_input) {
+		// The closing quote is overwritten; the lexer never revisits it.
+		char *content = (char *)text;
+		content[len] = '\0';
+		return content;
+	}
+
+	char *copy = mcc_arena_alloc(p->arena, len + 1);
+	if (!copy) {
+		return NULL;
+	}
+
+	memcpy(copy, text, len);
+	copy[len] = '\0';
+	return copy;
+}
+
+static struct mcc_ast_literal *parse_literal(struct parser *p)
+{
+	const struct mcc_token *token = current(p);
+	struct mcc_ast_literal *literal = NULL;
+
+	switch (token->type) {
+	case MCC_TOKEN_INT_LITERAL:
+		// digits are followed by a non-digit, the input is NUL-terminated
+		literal = mcc_ast_new_literal_int(p->arena, strtol(token->text, NULL, 10));
+		break;
+
+	case MCC_TOKEN_FLOAT_LITERAL:
+		literal = mcc_ast_new_literal_float(p->arena, token_to_double(token));
+		break;
+
+	case MCC_TOKEN_BOOL_LITERAL:
+		literal = mcc_ast_new_literal_bool(p->arena, token->text[0] == 't');
+		break;
+
+	case MCC_TOKEN_STRING_LITERAL: {
+		char *value = token_to_string(p, token);
+		if (value) {
+			literal = mcc_ast_new_literal_string(p->arena, value);
+		}
+		break;
+	}
+
+	default:
+		break;
+	}
+
+	if (!literal) {
+		return fail(p);
+	}
+
+	literal->node.sloc = token->sloc;
+	advance(p);
+	return literal;
+}
+
+// ------------------------------------------------------------------- Expressions
+
+static struct mcc_ast_expression *parse_expression(struct parser *p);
+
+// Returns 0 if `type` is not a binary operator. Higher values bind tighter;
+// all binary operators are left-associative.
+static int binary_precedence(enum mcc_token_type type, enum mcc_ast_binary_op *op)
+{
+	switch (type) {
+	case MCC_TOKEN_OR:
+		*op = MCC_AST_BINARY_OP_OR;
+		return 1;
+	case MCC_TOKEN_AND:
+		*op = MCC_AST_BINARY_OP_AND;
+		return 2;
+	case MCC_TOKEN_EQUALS:
+		*op = MCC_AST_BINARY_OP_EQUALS;
+		return 3;
+	case MCC_TOKEN_NOT_EQUALS:
+		*op = MCC_AST_BINARY_OP_NOT_EQUALS;
+		return 3;
+	case MCC_TOKEN_LESS:
+		*op = MCC_AST_BINARY_OP_LESS;
+		return 4;
+	case MCC_TOKEN_GREATER:
+		*op = MCC_AST_BINARY_OP_GREATER;
+		return 4;
+	case MCC_TOKEN_LESS_EQ:
+		*op = MCC_AST_BINARY_OP_LESS_EQUALS;
+		return 4;
+	case MCC_TOKEN_GREATER_EQ:
+		*op = MCC_AST_BINARY_OP_GREATER_EQUALS;
+		return 4;
+	case MCC_TOKEN_PLUS:
+		*op = MCC_AST_BINARY_OP_ADD;
+		return 5;
+	case MCC_TOKEN_MINUS:
+		*op = MCC_AST_BINARY_OP_SUB;
+		return 5;
+	case MCC_TOKEN_ASTER:
+		*op = MCC_AST_BINARY_OP_MUL;
+		return 6;
+	case MCC_TOKEN_SLASH:
+		*op = MCC_AST_BINARY_OP_DIV;
+		return 6;
+	default:
+		return 0;
+	}
+}
+
+// `(` has already been consumed. Returns NULL for an empty argument list.
+static struct mcc_ast_argument *parse_arguments(struct parser *p)
+{
+	struct mcc_ast_argument *head = NULL;
+	struct mcc_ast_argument **tail = &head;
+
+	if (current(p)->type == MCC_TOKEN_RPARENTH) {
+		return NULL;
+	}
+
+	do {
+		struct mcc_ast_expression *expression = parse_expression(p);
+		if (!expression) {
+			return NULL;
+		}
+
+		struct mcc_ast_argument *argument = mcc_ast_new_argument(p->arena, expression);
+		if (!argument) {
+			return fail(p);
+		}
+
+		argument->node.sloc = expression->node.sloc;
+		*tail = argument;
+		tail = &argument->next;
+	} while (accept(p, MCC_TOKEN_COMMA));
+
+	return head;
+}
+
+// Parses the remainder of an expression starting with `identifier`.
+static struct mcc_ast_expression *parse_identifier_expression(struct parser *p, struct mcc_ast_identifier *identifier)
+{
+	struct mcc_ast_expression *expression;
+
+	if (accept(p, MCC_TOKEN_LBRACKET)) {
+		struct mcc_ast_expression *index = parse_expression(p);
+		if (!index || !expect(p, MCC_TOKEN_RBRACKET)) {
+			return fail(p);
+		}
+		expression = mcc_ast_new_expression_array_element(p->arena, identifier, index);
+
+	} else if (accept(p, MCC_TOKEN_LPARENTH)) {
+		struct mcc_ast_argument *arguments = parse_arguments(p);
+		if (p->failed || !expect(p, MCC_TOKEN_RPARENTH)) {
+			return fail(p);
+		}
+		expression = mcc_ast_new_expression_call(p->arena, identifier, arguments);
+
+	} else {
+		expression = mcc_ast_new_expression_identifier(p->arena, identifier);
+	}
+
+	if (!expression) {
+		return fail(p);
+	}
+
+	span(&expression->node.sloc, &identifier->node.sloc, p);
+	return expression;
+}
+
+static struct mcc_ast_expression *parse_primary(struct parser *p)
+{
+	struct mcc_ast_source_location start = current(p)->sloc;
+	struct mcc_ast_expression *expression = NULL;
+
+	switch (current(p)->type) {
+	case MCC_TOKEN_INT_LITERAL:
+	case MCC_TOKEN_FLOAT_LITERAL:
+	case MCC_TOKEN_BOOL_LITERAL:
+	case MCC_TOKEN_STRING_LITERAL: {
+		struct mcc_ast_literal *literal = parse_literal(p);
+		if (!literal) {
+			return NULL;
+		}
+		expression = mcc_ast_new_expression_literal(p->arena, literal);
+		break;
+	}
+
+	case MCC_TOKEN_IDENTIFIER: {
+		struct mcc_ast_identifier *identifier = parse_identifier(p);
+		if (!identifier) {
+			return NULL;
+		}
+		return parse_identifier_expression(p, identifier);
+	}
+
+	case MCC_TOKEN_LPARENTH: {
+		advance(p);
+		struct mcc_ast_expression *inner = parse_expression(p);
+		if (!inner || !expect(p, MCC_TOKEN_RPARENTH)) {
+			return fail(p);
+		}
+		expression = mcc_ast_new_expression_parenth(p->arena, inner);
+		break;
+	}
+
+	default:
+		return fail(p);
+	}
+
+	if (!expression) {
+		return fail(p);
+	}
+
+	span(&expression->node.sloc, &start, p);
+	return expression;
+}
+
+// Unary operators bind tighter than any binary operator.
+static struct mcc_ast_expression *parse_unary(struct parser *p)
+{
+	enum mcc_ast_unary_op op;
+
+	switch (current(p)->type) {
+	case MCC_TOKEN_MINUS:
+		op = MCC_AST_UNARY_OP_MINUS;
+		break;
+	case MCC_TOKEN_NOT:
+		op = MCC_AST_UNARY_OP_NOT;
+		break;
+	default:
+		return parse_primary(p);
+	}
+
+	struct mcc_ast_source_location start = current(p)->sloc;
+	advance(p);
+
+	if (!enter(p)) {
+		return NULL;
+	}
+	struct mcc_ast_expression *operand = parse_unary(p);
+	leave(p);
+
+	if (!operand) {
+		return NULL;
+	}
+
+	struct mcc_ast_expression *expression = mcc_ast_new_expression_unary_op(p->arena, op, operand);
+	if (!expression) {
+		return fail(p);
+	}
+
+	span(&expression->node.sloc, &start, p);
+	return expression;
+}
+
+// Extends `lhs` by binary operators of at least `min_precedence`.
+static struct mcc_ast_expression *
+parse_binary(struct parser *p, struct mcc_ast_expression *lhs, int min_precedence)
+{
+	enum mcc_ast_binary_op op = MCC_AST_BINARY_OP_ADD;
+	int precedence;
+
+	while (lhs && (precedence = binary_precedence(current(p)->type, &op)) >= min_precedence) {
+		advance(p);
+
+		struct mcc_ast_expression *rhs = parse_unary(p);
+
+		// operators binding tighter than `op` belong to its right operand
+		enum mcc_ast_binary_op next_op;
+		while (rhs && binary_precedence(current(p)->type, &next_op) > precedence) {
+			rhs = parse_binary(p, rhs, precedence + 1);
+		}
+
+		if (!rhs) {
+			return NULL;
+		}
+
+		struct mcc_ast_expression *expression = mcc_ast_new_expression_binary_op(p->arena, op, lhs, rhs);
+		if (!expression) {
+			return fail(p);
+		}
+
+		span(&expression->node.sloc, &lhs->node.sloc, p);
+		lhs = expression;
+	}
+
+	return lhs;
+}
+
+static struct mcc_ast_expression *parse_expression(struct parser *p)
+{
+	if (!enter(p)) {
+		return NULL;
+	}
+
+	struct mcc_ast_expression *expression = parse_binary(p, parse_unary(p), 1);
+
+	leave(p);
+	return expression;
+}
+
+// ------------------------------------------------------------------- Declarations
+
+static struct mcc_ast_declaration *parse_declaration(struct parser *p)
+{
+	struct mcc_ast_source_location start = current(p)->sloc;
+
+	if (!is_type(current(p)->type)) {
+		return fail(p);
+	}
+	enum mcc_ast_data_type type = parse_type(p);
+
+	struct mcc_ast_literal *array_size = NULL;
+	if (accept(p, MCC_TOKEN_LBRACKET)) {
+		if (current(p)->type != MCC_TOKEN_INT_LITERAL) {
+			return fail(p);
+		}
+		array_size = parse_literal(p);
+		if (!array_size || !expect(p, MCC_TOKEN_RBRACKET)) {
+			return fail(p);
+		}
+	}
+
+	struct mcc_ast_identifier *identifier = parse_identifier(p);
+	if (!identifier) {
+		return NULL;
+	}
+
+	struct mcc_ast_declaration *declaration = mcc_ast_new_declaration(p->arena, type, array_size, identifier);
+	if (!declaration) {
+		return fail(p);
+	}
+
+	span(&declaration->node.sloc, &start, p);
+	return declaration;
+}
+
+// ------------------------------------------------------------------- Statements
+
+static struct mcc_ast_statement *parse_statement(struct parser *p);
+
+// Assignments and expressions share a common prefix: `a[i] = 1` and `a[i] + 1`
+// only differ after the subscript. Sets either `*assignment` (without the
+// terminating `;`) or `*expression`.
+static void parse_assignment_or_expression(struct parser *p,
+                                           struct mcc_ast_statement **assignment,
+                                           struct mcc_ast_expression **expression)
+{
+	*assignment = NULL;
+	*expression = NULL;
+
+	if (current(p)->type != MCC_TOKEN_IDENTIFIER || (peek(p, 1)->type != MCC_TOKEN_ASSIGNMENT &&
+	                                                 peek(p, 1)->type != MCC_TOKEN_LBRACKET)) {
+		*expression = parse_expression(p);
+		return;
+	}
+
+	struct mcc_ast_source_location start = current(p)->sloc;
+
+	struct mcc_ast_identifier *identifier = parse_identifier(p);
+	if (!identifier) {
+		return;
+	}
+
+	struct mcc_ast_expression *index = NULL;
+	if (accept(p, MCC_TOKEN_LBRACKET)) {
+		index = parse_expression(p);
+		if (!index || !expect(p, MCC_TOKEN_RBRACKET)) {
+			return;
+		}
+
+		if (current(p)->type != MCC_TOKEN_ASSIGNMENT) {
+			// an expression starting with an array element
+			struct mcc_ast_expression *element =
+			    mcc_ast_new_expression_array_element(p->arena, identifier, index);
+			if (!element) {
+				fail(p);
+				return;
+			}
+			span(&element->node.sloc, &start, p);
+
+			*expression = parse_binary(p, element, 1);
+			return;
+		}
+	}
+
+	if (!expect(p, MCC_TOKEN_ASSIGNMENT)) {
+		return;
+	}
+
+	struct mcc_ast_expression *rhs = parse_expression(p);
+	if (!rhs) {
+		return;
+	}
+
+	*assignment = mcc_ast_new_statement_assignment(p->arena, identifier, index, rhs);
+	if (!*assignment) {
+		fail(p);
+	}
+}
+
+// Completes an assignment or expression statement by its terminating `;`.
+static struct mcc_ast_statement *finish_simple_statement(struct parser *p,
+                                                         const struct mcc_ast_source_location *start,
+                                                         struct mcc_ast_statement *assignment,
+                                                         struct mcc_ast_expression *expression)
+{
+	if (p->failed || !expect(p, MCC_TOKEN_SEMICOLON)) {
+		return fail(p);
+	}
+
+	struct mcc_ast_statement *statement = assignment;
+	if (!statement) {
+		statement = mcc_ast_new_statement_expression(p->arena, expression);
+		if (!statement) {
+			return fail(p);
+		}
+	}
+
+	span(&statement->node.sloc, start, p);
+	return statement;
+}
+
+// Completes a declaration statement by its terminating `;`.
+static struct mcc_ast_statement *finish_declaration_statement(struct parser *p,
+                                                              const struct mcc_ast_source_location *start,
+                                                              struct mcc_ast_declaration *declaration)
+{
+	if (!expect(p, MCC_TOKEN_SEMICOLON)) {
+		return NULL;
+	}
+
+	struct mcc_ast_statement *statement = mcc_ast_new_statement_declaration(p->arena, declaration);
+	if (!statement) {
+		return fail(p);
+	}
+
+	span(&statement->node.sloc, start, p);
+	return statement;
+}
+
+static struct mcc_ast_statement *parse_compound_statement(struct parser *p)
+{
+	struct mcc_ast_source_location start = current(p)->sloc;
+
+	if (!expect(p, MCC_TOKEN_LBRACE)) {
+		return NULL;
+	}
+
+	struct mcc_ast_statement_list *head = NULL;
+	struct mcc_ast_statement_list **tail = &head;
+
+	while (!accept(p, MCC_TOKEN_RBRACE)) {
+		struct mcc_ast_statement *statement = parse_statement(p);
+		if (!statement) {
+			return NULL;
+		}
+
+		struct mcc_ast_statement_list *list = mcc_ast_new_statement_list(p->arena, statement);
+		if (!list) {
+			return fail(p);
+		}
+
+		list->node.sloc = statement->node.sloc;
+		*tail = list;
+		tail = &list->next;
+	}
+
+	struct mcc_ast_statement *statement = mcc_ast_new_statement_compound(p->arena, head);
+	if (!statement) {
+		return fail(p);
+	}
+
+	span(&statement->node.sloc, &start, p);
+	return statement;
+}
+
+// Parses `( condition ) statement` of if and while statements.
+static bool parse_condition_and_body(struct parser *p,
+                                     struct mcc_ast_expression **condition,
+                                     struct mcc_ast_statement **body)
+{
+	if (!expect(p, MCC_TOKEN_LPARENTH)) {
+		return false;
+	}
+
+	*condition = parse_expression(p);
+	if (!*condition || !expect(p, MCC_TOKEN_RPARENTH)) {
+		return false;
+	}
+
+	*body = parse_statement(p);
+	return *body != NULL;
+}
+
+static struct mcc_ast_statement *parse_statement_unchecked(struct parser *p)
+{
+	struct mcc_ast_source_location start = current(p)->sloc;
+	struct mcc_ast_statement *statement = NULL;
+
+	switch (current(p)->type) {
+	case MCC_TOKEN_IF: {
+		advance(p);
+
+		struct mcc_ast_expression *condition;
+		struct mcc_ast_statement *if_stmt;
+		if (!parse_condition_and_body(p, &condition, &if_stmt)) {
+			return fail(p);
+		}
+
+		// a dangling else belongs to the innermost if
+		struct mcc_ast_statement *else_stmt = NULL;
+		if (accept(p, MCC_TOKEN_ELSE)) {
+			else_stmt = parse_statement(p);
+			if (!else_stmt) {
+				return NULL;
+			}
+		}
+
+		statement = mcc_ast_new_statement_if(p->arena, condition, if_stmt, else_stmt);
+		break;
+	}
+
+	case MCC_TOKEN_WHILE: {
+		advance(p);
+
+		struct mcc_ast_expression *condition;
+		struct mcc_ast_statement *body;
+		if (!parse_condition_and_body(p, &condition, &body)) {
+			return fail(p);
+		}
+
+		statement = mcc_ast_new_statement_while(p->arena, condition, body);
+		break;
+	}
+
+	case MCC_TOKEN_RETURN: {
+		advance(p);
+
+		struct mcc_ast_expression *value = NULL;
+		if (current(p)->type != MCC_TOKEN_SEMICOLON) {
+			value = parse_expression(p);
+			if (!value) {
+				return NULL;
+			}
+		}
+
+		if (!expect(p, MCC_TOKEN_SEMICOLON)) {
+			return NULL;
+		}
+
+		statement = mcc_ast_new_statement_return(p->arena, value);
+		break;
+	}
+
+	case MCC_TOKEN_LBRACE:
+		return parse_compound_statement(p);
+
+	case MCC_TOKEN_BOOL_TYPE:
+	case MCC_TOKEN_INT_TYPE:
+	case MCC_TOKEN_FLOAT_TYPE:
+	case MCC_TOKEN_STRING_TYPE: {
+		struct mcc_ast_declaration *declaration = parse_declaration(p);
+		if (!declaration) {
+			return NULL;
+		}
+		return finish_declaration_statement(p, &start, declaration);
+	}
+
+	default: {
+		struct mcc_ast_statement *assignment;
+		struct mcc_ast_expression *expression;
+		parse_assignment_or_expression(p, &assignment, &expression);
+		return finish_simple_statement(p, &start, assignment, expression);
+	}
+	}
+
+	if (!statement) {
+		return fail(p);
+	}
+
+	span(&statement->node.sloc, &start, p);
+	return statement;
+}
+
+static struct mcc_ast_statement *parse_statement(struct parser *p)
+{
+	if (!enter(p)) {
+		return NULL;
+	}
+
+	struct mcc_ast_statement *statement = parse_statement_unchecked(p);
+
+	leave(p);
+	return statement;
+}
+
+// ------------------------------------------------------------------- Function Definitions
+
+// Returns NULL for an empty parameter list.
+static struct mcc_ast_parameter *parse_parameters(struct parser *p)
+{
+	struct mcc_ast_parameter *head = NULL;
+	struct mcc_ast_parameter **tail = &head;
+
+	if (current(p)->type == MCC_TOKEN_RPARENTH) {
+		return NULL;
+	}
+
+	do {
+		struct mcc_ast_declaration *declaration = parse_declaration(p);
+		if (!declaration) {
+			return NULL;
+		}
+
+		struct mcc_ast_parameter *parameter = mcc_ast_new_parameter(p->arena, declaration);
+		if (!parameter) {
+			return fail(p);
+		}
+
+		parameter->node.sloc = declaration->node.sloc;
+		*tail = parameter;
+		tail = &parameter->next;
+	} while (accept(p, MCC_TOKEN_COMMA));
+
+	return head;
+}
+
+static struct mcc_ast_function_def *parse_function_def(struct parser *p)
+{
+	struct mcc_ast_source_location start = current(p)->sloc;
+
+	if (current(p)->type != MCC_TOKEN_VOID_TYPE && !is_type(current(p)->type)) {
+		return fail(p);
+	}
+	enum mcc_ast_data_type type = parse_type(p);
+
+	struct mcc_ast_identifier *identifier = parse_identifier(p);
+	if (!identifier || !expect(p, MCC_TOKEN_LPARENTH)) {
+		return fail(p);
+	}
+
+	struct mcc_ast_parameter *parameters = parse_parameters(p);
+	if (p->failed || !expect(p, MCC_TOKEN_RPARENTH)) {
+		return fail(p);
+	}
+
+	struct mcc_ast_statement *body = parse_compound_statement(p);
+	if (!body) {
+		return NULL;
+	}
+
+	struct mcc_ast_function_def *function_def =
+	    mcc_ast_new_function_def(p->arena, type, identifier, parameters, body);
+	if (!function_def) {
+		return fail(p);
+	}
+
+	span(&function_def->node.sloc, &start, p);
+	return function_def;
+}
+
+// ------------------------------------------------------------------- Toplevel
+
+// Like the bison grammar, this accepts a program, or alternatively a single
+// declaration, statement, or expression.
+static void parse_toplevel(struct parser *p, struct mcc_parser_result *result)
+{
+	const struct mcc_token *token = current(p);
+	struct mcc_ast_source_location start = token->sloc;
+
+	if (token->type == MCC_TOKEN_EOF || token->type == MCC_TOKEN_VOID_TYPE ||
+	    (is_type(token->type) && peek(p, 1)->type == MCC_TOKEN_IDENTIFIER &&
+	     peek(p, 2)->type == MCC_TOKEN_LPARENTH)) {
+		struct mcc_ast_program *program = mcc_ast_new_program(p->arena, NULL);
+		if (!program) {
+			fail(p);
+			return;
+		}
+
+		while (current(p)->type != MCC_TOKEN_EOF) {
+			struct mcc_ast_function_def *function_def = parse_function_def(p);
+			if (!function_def) {
+				return;
+			}
+			mcc_ast_add_function_def(program, function_def);
+		}
+
+		result->program = program;
+		return;
+	}
+
+	if (is_type(token->type)) {
+		struct mcc_ast_declaration *declaration = parse_declaration(p);
+		if (!declaration) {
+			return;
+		}
+
+		if (current(p)->type == MCC_TOKEN_EOF) {
+			result->declaration = declaration;
+		} else {
+			result->statement = finish_declaration_statement(p, &start, declaration);
+		}
+		return;
+	}
+
+	switch (token->type) {
+	case MCC_TOKEN_IF:
+	case MCC_TOKEN_WHILE:
+	case MCC_TOKEN_RETURN:
+	case MCC_TOKEN_LBRACE:
+		result->statement = parse_statement(p);
+		return;
+
+	default:
+		break;
+	}
+
+	struct mcc_ast_statement *assignment;
+	struct mcc_ast_expression *expression;
+	parse_assignment_or_expression(p, &assignment, &expression);
+
+	if (expression && current(p)->type == MCC_TOKEN_EOF) {
+		result->expression = expression;
+	} else {
+		result->statement = finish_simple_statement(p, &start, assignment, expression);
+	}
+}
+
+static struct mcc_parser_result parse(const char *data, size_t len, bool borrow_input)
+{
+	struct mcc_parser_result result = {
+	    .status = MCC_PARSER_STATUS_OK,
+	};
+	mcc_arena_init(&result.arena);
+
+	struct parser p = {
+	    .arena = &result.arena,
+	    .borrow_input = borrow_input,
+	};
+	mcc_lexer_init(&p.lexer, data, len);
+	mcc_lexer_next(&p.lexer, &p.tokens[0]);
+	p.buffered = 1;
+
+	parse_toplevel(&p, &result);
+
+	if (p.failed || current(&p)->type != MCC_TOKEN_EOF) {
+		mcc_parser_delete_result(&result);
+		result.status = MCC_PARSER_STATUS_UNKNOWN_ERROR;
+	}
+
+	return result;
+}
+
+// ------------------------------------------------------------------- Entry Points
+
+struct mcc_parser_result mcc_parser_descent_parse_string(const char *input)
+{
+	assert(input);
+
+	return parse(input, strlen(input), false);
+}
+
+struct mcc_parser_result mcc_parser_descent_parse_buffer(char *data, size_t len)
+{
+	assert(data);
+	assert(data[len] == '\0' && data[len + 1] == '\0');
+
+	return parse(data, len, true);
+}
+
+struct mcc_parser_result mcc_parser_descent_parse_file(FILE *input)
+{
+	assert(input);
+
+	// The lexer needs the whole input at once, read it into a NUL-terminated
+	// buffer.
+	char *data = NULL;
+	size_t len = 0;
+	size_t capacity = 0;
+	bool failed = false;
+
+	do {
+		if (!reserve_wide((void **)&data, &capacity, len, 2, 1)) {
+			failed = true;
+			break;
+		}
+		len += fread(data + len, 1, capacity - len - 1, input);
+	} while (len == capacity - 1);
+
+	if (failed || ferror(input)) {
+		free(data);
+		return (struct mcc_parser_result){
+		    .status = MCC_PARSER_STATUS_UNABLE_TO_OPEN_STREAM,
+		};
+	}
+
+	data[len] = '\0';
+
+	struct mcc_parser_result result = parse(data, len, false);
+	free(data);
+	return result;
+}
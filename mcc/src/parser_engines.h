@@ -0,0 +1,35 @@
+// Parser Engines
+//
+// Entry points of the two parser implementations behind `mcc/parser.h`. Both
+// follow the contracts of the corresponding `mcc_parse_*` functions and build
+// identical ASTs.
+
+#ifndef MCC_PARSER_ENGINES_H
+#define MCC_PARSER_ENGINES_H
+
+#include <stdio.h>
+
+#include "mcc/parser.h"
+
+// ------------------------------------------------------------------- Bison (parser.y)
+
+struct mcc_parser_result mcc_parser_bison_parse_string(const char *input);
+
+struct mcc_parser_result mcc_parser_bison_parse_buffer(char *data, size_t len);
+
+struct mcc_parser_result mcc_parser_bison_parse_file(FILE *input);
+
+// Runs the scanner alone over a buffer prepared as for `mcc_parse_buffer` and
+// returns the number of tokens, excluding the end of input. Returns -1 if the
+// scanner could not be set up. Used for benchmarking.
+long mcc_parser_bison_lex_buffer(char *data, size_t len);
+
+// ------------------------------------------------------------------- Recursive Descent (parser_descent.c)
+
+struct mcc_parser_result mcc_parser_descent_parse_string(const char *input);
+
+struct mcc_parser_result mcc_parser_descent_parse_buffer(char *data, size_t len);
+
+struct mcc_parser_result mcc_parser_descent_parse_file(FILE *input);
+
+#endif // MCC_PARSER_ENGINES_H
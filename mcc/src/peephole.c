@@ -0,0 +1,960 @@
+#include "mcc/peephole.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/reserve.h"
+
+// ------------------------------------------------------------------ Registers
+
+// Sets of registers and the flags, one bit each.
+typedef uint32_t register_set;
+
+enum {
+	REG_EAX,
+	REG_ECX,
+	REG_EDX,
+	REG_EBX,
+	REG_ESP,
+	REG_EBP,
+	REG_ESI,
+	REG_EDI,
+	REG_XMM0,
+	REG_FLAGS = REG_XMM0 + 8,
+};
+
+#define BIT(r) ((register_set)1 << (r))
+#define ALL_REGISTERS (BIT(REG_FLAGS + 1) - 1)
+
+// The stack and frame pointers are used implicitly, they are never dead.
+#define FRAME_REGISTERS (BIT(REG_ESP) | BIT(REG_EBP))
+
+// Registers which may be changed by called functions.
+#define CALL_CLOBBERED \
+	(BIT(REG_EAX) | BIT(REG_ECX) | BIT(REG_EDX) | (BIT(REG_XMM0 + 8) - BIT(REG_XMM0)) | BIT(REG_FLAGS))
+
+struct register_name {
+	const char *name;
+	uint8_t reg;
+	bool full;
+};
+
+static const struct register_name register_names[] = {
+    {"eax", REG_EAX, true},   {"ax", REG_EAX, false},   {"al", REG_EAX, false},   {"ah", REG_EAX, false},
+    {"ecx", REG_ECX, true},   {"cx", REG_ECX, false},   {"cl", REG_ECX, false},   {"ch", REG_ECX, false},
+    {"edx", REG_EDX, true},   {"dx", REG_EDX, false},   {"dl", REG_EDX, false},   {"dh", REG_EDX, false},
+    {"ebx", REG_EBX, true},   {"bx", REG_EBX, false},   {"bl", REG_EBX, false},   {"bh", REG_EBX, false},
+    {"esp", REG_ESP, true},   {"ebp", REG_EBP, true},   {"esi", REG_ESI, true},   {"edi", REG_EDI, true},
+    {"xmm0", REG_XMM0, true}, {"xmm1", REG_XMM0 + 1, true}, {"xmm2", REG_XMM0 + 2, true},
+    {"xmm3", REG_XMM0 + 3, true}, {"xmm4", REG_XMM0 + 4, true}, {"xmm5", REG_XMM0 + 5, true},
+    {"xmm6", REG_XMM0 + 6, true}, {"xmm7", REG_XMM0 + 7, true},
+};
+
+// Looks up the register named by the `length` characters at `name`.
+static const struct register_name *find_register(const char *name, size_t length)
+{
+	for (size_t r = 0; r < sizeof(register_names) / sizeof(*register_names); ++r) {
+		if (strlen(register_names[r].name) == length && strncmp(register_names[r].name, name, length) == 0) {
+			return &register_names[r];
+		}
+	}
+	return NULL;
+}
+
+// Registers named anywhere in `operand`, including addresses.
+static register_set registers_in(const char *operand)
+{
+	register_set set = 0;
+	for (const char *c = operand; *c; ++c) {
+		if (*c != '%') {
+			continue;
+		}
+		size_t length = strspn(c + 1, "abcdefghijklmnopqrstuvwxyz0123456789");
+		const struct register_name *reg = find_register(c + 1, length);
+		if (reg) {
+			set |= BIT(reg->reg);
+		}
+		c += length;
+	}
+	return set;
+}
+
+static bool is_register(const char *operand)
+{
+	return operand[0] == '%';
+}
+
+static bool is_immediate(const char *operand)
+{
+	return operand[0] == '$';
+}
+
+static bool is_memory(const char *operand)
+{
+	return !is_register(operand) && !is_immediate(operand);
+}
+
+// The register if `operand` names all of a general purpose or SSE register,
+// otherwise 0.
+static register_set full_register(const char *operand)
+{
+	if (!is_register(operand)) {
+		return 0;
+	}
+	const struct register_name *reg = find_register(operand + 1, strlen(operand + 1));
+	return reg && reg->full ? BIT(reg->reg) : 0;
+}
+
+// A full general purpose register other than the stack and frame pointers.
+static register_set general_register(const char *operand)
+{
+	return full_register(operand) & (BIT(REG_XMM0) - 1) & ~FRAME_REGISTERS;
+}
+
+// ------------------------------------------------------------------ Mnemonics
+
+enum effect {
+	// reads all operands
+	EFFECT_READ,
+
+	// reads all operands but the last one, which is overwritten
+	EFFECT_MOVE,
+
+	// reads all operands, writes the last one
+	EFFECT_UPDATE,
+
+	EFFECT_JUMP,
+	EFFECT_BRANCH,
+	EFFECT_CALL,
+	EFFECT_RETURN,
+	EFFECT_EXTEND,
+	EFFECT_DIVIDE,
+};
+
+#define FLAGS_READ 1
+#define FLAGS_WRITTEN 2
+
+struct mnemonic {
+	const char *name;
+	uint8_t effect;
+	uint8_t flags;
+
+	// without effects beyond the written registers and operand
+	bool pure;
+};
+
+static const struct mnemonic mnemonics[] = {
+    {"movl", EFFECT_MOVE, 0, true},
+    {"movzbl", EFFECT_MOVE, 0, true},
+    {"leal", EFFECT_MOVE, 0, true},
+    {"movd", EFFECT_MOVE, 0, true},
+    {"movss", EFFECT_MOVE, 0, true},
+    {"movaps", EFFECT_MOVE, 0, true},
+    {"movups", EFFECT_MOVE, 0, true},
+    {"pshufd", EFFECT_MOVE, 0, true},
+    {"popl", EFFECT_MOVE, 0, false},
+    {"addl", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"subl", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"imull", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"andl", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"orl", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"xorl", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"andb", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"orb", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"negl", EFFECT_UPDATE, FLAGS_WRITTEN, true},
+    {"addss", EFFECT_UPDATE, 0, true},
+    {"subss", EFFECT_UPDATE, 0, true},
+    {"mulss", EFFECT_UPDATE, 0, true},
+    {"divss", EFFECT_UPDATE, 0, true},
+    {"xorps", EFFECT_UPDATE, 0, true},
+    {"shufps", EFFECT_UPDATE, 0, true},
+    {"addps", EFFECT_UPDATE, 0, true},
+    {"subps", EFFECT_UPDATE, 0, true},
+    {"mulps", EFFECT_UPDATE, 0, true},
+    {"divps", EFFECT_UPDATE, 0, true},
+    {"paddd", EFFECT_UPDATE, 0, true},
+    {"psubd", EFFECT_UPDATE, 0, true},
+    {"cmpl", EFFECT_READ, FLAGS_WRITTEN, true},
+    {"testl", EFFECT_READ, FLAGS_WRITTEN, true},
+    {"ucomiss", EFFECT_READ, FLAGS_WRITTEN, true},
+    {"pushl", EFFECT_READ, 0, false},
+    {"jmp", EFFECT_JUMP, 0, false},
+    {"call", EFFECT_CALL, FLAGS_WRITTEN, false},
+    {"ret", EFFECT_RETURN, 0, false},
+    {"cltd", EFFECT_EXTEND, 0, true},
+    {"idivl", EFFECT_DIVIDE, FLAGS_WRITTEN, false},
+};
+
+// Conditions of jcc and setcc, each next to its negation.
+static const char *const conditions[] = {"e", "ne", "l", "ge", "g", "le", "a", "be", "ae", "b", "p", "np"};
+
+#define NO_CONDITION UINT32_MAX
+
+// Index of the condition of `mnemonic` if it starts with `prefix`.
+static uint32_t condition_of(const char *mnemonic, const char *prefix)
+{
+	size_t length = strlen(prefix);
+	if (strncmp(mnemonic, prefix, length) != 0) {
+		return NO_CONDITION;
+	}
+	for (uint32_t c = 0; c < sizeof(conditions) / sizeof(*conditions); ++c) {
+		if (strcmp(mnemonic + length, conditions[c]) == 0) {
+			return c;
+		}
+	}
+	return NO_CONDITION;
+}
+
+static const struct mnemonic *find_mnemonic(const char *name)
+{
+	static const struct mnemonic set = {"set", EFFECT_UPDATE, FLAGS_READ, true};
+	static const struct mnemonic branch = {"j", EFFECT_BRANCH, FLAGS_READ, false};
+
+	for (size_t m = 0; m < sizeof(mnemonics) / sizeof(*mnemonics); ++m) {
+		if (strcmp(mnemonics[m].name, name) == 0) {
+			return &mnemonics[m];
+		}
+	}
+	if (condition_of(name, "set") != NO_CONDITION) {
+		return &set;
+	}
+	if (condition_of(name, "j") != NO_CONDITION) {
+		return &branch;
+	}
+	return NULL;
+}
+
+// ---------------------------------------------------------------- Instructions
+
+void mcc_peephole_code_init(struct mcc_peephole_code *code)
+{
+	assert(code);
+	*code = (struct mcc_peephole_code){0};
+}
+
+void mcc_peephole_code_clear(struct mcc_peephole_code *code)
+{
+	assert(code);
+	for (uint32_t i = 0; i < code->instruction_count; ++i) {
+		free(code->instructions[i].text);
+	}
+	code->instruction_count = 0;
+}
+
+void mcc_peephole_code_release(struct mcc_peephole_code *code)
+{
+	assert(code);
+	mcc_peephole_code_clear(code);
+	free(code->instructions);
+	mcc_peephole_code_init(code);
+}
+
+// Joins `mnemonic` and `operands` to the text of an instruction.
+static char *make_text(const char *mnemonic, uint32_t count, const char *const *operands)
+{
+	size_t size = strlen(mnemonic) + 1;
+	for (uint32_t o = 0; o < count; ++o) {
+		size += strlen(operands[o]) + 1;
+	}
+
+	char *text = malloc(size);
+	if (!text) {
+		return NULL;
+	}
+	char *end = stpcpy(text, mnemonic) + 1;
+	for (uint32_t o = 0; o < count; ++o) {
+		end = stpcpy(end, operands[o]) + 1;
+	}
+	return text;
+}
+
+// Makes `text` with `count` operands the text of `instruction`.
+static void set_text(struct mcc_peephole_instruction *instruction, char *text, uint32_t count)
+{
+	assert(count <= MCC_PEEPHOLE_MAX_OPERANDS);
+	free(instruction->text);
+	instruction->text = text;
+	instruction->operand_count = (uint8_t)count;
+
+	const char *c = text;
+	for (uint32_t o = 0; o < count; ++o) {
+		c += strlen(c) + 1;
+		instruction->operands[o] = c;
+	}
+}
+
+bool mcc_peephole_append(struct mcc_peephole_code *code, const char *line)
+{
+	assert(code);
+	assert(line);
+
+	if (!reserve((void **)&code->instructions, &code->instruction_capacity, code->instruction_count, 1,
+	             sizeof(*code->instructions))) {
+		return false;
+	}
+
+	// the line is split into the mnemonic and operands separated by commas
+	// outside of parentheses
+	char *copy = strdup(line);
+	if (!copy) {
+		return false;
+	}
+	struct mcc_peephole_instruction instruction = {0};
+	size_t length = strlen(copy);
+	if (length && copy[length - 1] == ':') {
+		copy[length - 1] = '\0';
+		instruction.label = true;
+		instruction.text = copy;
+		code->instructions[code->instruction_count++] = instruction;
+		return true;
+	}
+
+	const char *operands[MCC_PEEPHOLE_MAX_OPERANDS];
+	uint32_t count = 0;
+	char *c = strchr(copy, ' ');
+	if (c) {
+		*c++ = '\0';
+		int depth = 0;
+		operands[count++] = c;
+		for (; *c; ++c) {
+			depth += *c == '(';
+			depth -= *c == ')';
+			if (*c == ',' && depth == 0) {
+				assert(count < MCC_PEEPHOLE_MAX_OPERANDS);
+				*c = '\0';
+				operands[count++] = c + 1 + strspn(c + 1, " ");
+			}
+		}
+	}
+
+	char *text = make_text(copy, count, operands);
+	free(copy);
+	if (!text) {
+		return false;
+	}
+	set_text(&instruction, text, count);
+	code->instructions[code->instruction_count++] = instruction;
+	return true;
+}
+
+void mcc_peephole_print(FILE *out, const struct mcc_peephole_code *code)
+{
+	assert(out);
+	assert(code);
+
+	for (uint32_t i = 0; i < code->instruction_count; ++i) {
+		const struct mcc_peephole_instruction *instruction = &code->instructions[i];
+		if (instruction->label) {
+			fprintf(out, "%s:\n", instruction->text);
+			continue;
+		}
+		fprintf(out, "\t%s", instruction->text);
+		for (uint32_t o = 0; o < instruction->operand_count; ++o) {
+			fprintf(out, "%s%s", o ? ", " : " ", instruction->operands[o]);
+		}
+		fputc('\n', out);
+	}
+}
+
+// ------------------------------------------------------------------- Liveness
+
+struct label {
+	const char *name;
+	uint32_t index;
+};
+
+struct peephole {
+	struct mcc_peephole_code *code;
+
+	// registers read and written by each instruction, and those live before
+	// and after it
+	register_set *uses;
+	register_set *defs;
+	register_set *live_in;
+	register_set *live_out;
+
+	// labels sorted by name
+	struct label *labels;
+	uint32_t label_count;
+
+	// instructions removed by this pass
+	bool *removed;
+	bool failed;
+};
+
+static int compare_labels(const void *a, const void *b)
+{
+	return strcmp(((const struct label *)a)->name, ((const struct label *)b)->name);
+}
+
+// Index of the instruction defining label `name`, UINT32_MAX if there is none.
+static uint32_t find_label(const struct peephole *p, const char *name)
+{
+	struct label key = {.name = name};
+	const struct label *label = bsearch(&key, p->labels, p->label_count, sizeof(*p->labels), compare_labels);
+	return label ? label->index : UINT32_MAX;
+}
+
+static void compute_effects(const struct mcc_peephole_instruction *instruction, register_set *uses, register_set *defs)
+{
+	*uses = 0;
+	*defs = 0;
+	if (instruction->label) {
+		return;
+	}
+
+	const struct mnemonic *mnemonic = find_mnemonic(instruction->text);
+	uint32_t count = instruction->operand_count;
+	if (!mnemonic) {
+		for (uint32_t o = 0; o < count; ++o) {
+			*uses |= registers_in(instruction->operands[o]);
+		}
+		*uses |= BIT(REG_FLAGS);
+		return;
+	}
+
+	enum effect effect = (enum effect)mnemonic->effect;
+	const char *last = count ? instruction->operands[count - 1] : NULL;
+	if (effect == EFFECT_MOVE && count == 2 && !strcmp(mnemonic->name, "movss") && is_register(last) &&
+	    is_register(instruction->operands[0])) {
+		// only the low part of the destination is replaced
+		effect = EFFECT_UPDATE;
+	}
+
+	switch (effect) {
+	case EFFECT_MOVE:
+		for (uint32_t o = 0; o + 1 < count; ++o) {
+			*uses |= registers_in(instruction->operands[o]);
+		}
+		if (is_register(last)) {
+			*defs |= registers_in(last);
+			if (!full_register(last)) {
+				*uses |= registers_in(last);
+			}
+		} else {
+			*uses |= registers_in(last);
+		}
+		break;
+	case EFFECT_UPDATE:
+		for (uint32_t o = 0; o < count; ++o) {
+			*uses |= registers_in(instruction->operands[o]);
+		}
+		if (is_register(last)) {
+			*defs |= registers_in(last);
+		}
+		break;
+	case EFFECT_READ:
+		for (uint32_t o = 0; o < count; ++o) {
+			*uses |= registers_in(instruction->operands[o]);
+		}
+		break;
+	case EFFECT_JUMP:
+	case EFFECT_BRANCH:
+		break;
+	case EFFECT_CALL:
+		*defs |= CALL_CLOBBERED;
+		break;
+	case EFFECT_RETURN:
+		*uses |= BIT(REG_EAX) | BIT(REG_EBX) | BIT(REG_ESI) | BIT(REG_EDI) | FRAME_REGISTERS;
+		break;
+	case EFFECT_EXTEND:
+		*uses |= BIT(REG_EAX);
+		*defs |= BIT(REG_EDX);
+		break;
+	case EFFECT_DIVIDE:
+		*uses |= BIT(REG_EAX) | BIT(REG_EDX) | registers_in(last);
+		*defs |= BIT(REG_EAX) | BIT(REG_EDX);
+		break;
+	}
+
+	if (mnemonic->flags & FLAGS_READ) {
+		*uses |= BIT(REG_FLAGS);
+	}
+	if (mnemonic->flags & FLAGS_WRITTEN) {
+		*defs |= BIT(REG_FLAGS);
+	}
+}
+
+static bool is_jump(const struct mcc_peephole_instruction *instruction)
+{
+	const struct mnemonic *mnemonic = instruction->label ? NULL : find_mnemonic(instruction->text);
+	return mnemonic && (mnemonic->effect == EFFECT_JUMP || mnemonic->effect == EFFECT_BRANCH);
+}
+
+static bool falls_through(const struct mcc_peephole_instruction *instruction)
+{
+	const struct mnemonic *mnemonic = instruction->label ? NULL : find_mnemonic(instruction->text);
+	return !mnemonic || (mnemonic->effect != EFFECT_JUMP && mnemonic->effect != EFFECT_RETURN);
+}
+
+// Computes the registers live after each instruction by iterating to a fixed
+// point; all registers are live at the end of the list and at unknown labels.
+static void compute_liveness(struct peephole *p)
+{
+	const struct mcc_peephole_code *code = p->code;
+	uint32_t count = code->instruction_count;
+
+	p->label_count = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		compute_effects(&code->instructions[i], &p->uses[i], &p->defs[i]);
+		if (code->instructions[i].label) {
+			p->labels[p->label_count++] = (struct label){code->instructions[i].text, i};
+		}
+	}
+	qsort(p->labels, p->label_count, sizeof(*p->labels), compare_labels);
+
+	register_set *live_in = p->live_in;
+	for (uint32_t i = 0; i < count; ++i) {
+		live_in[i] = 0;
+	}
+
+	bool changed = true;
+	while (changed) {
+		changed = false;
+		for (uint32_t i = count; i-- > 0;) {
+			const struct mcc_peephole_instruction *instruction = &code->instructions[i];
+			register_set out = 0;
+			if (falls_through(instruction)) {
+				out |= i + 1 < count ? live_in[i + 1] : ALL_REGISTERS;
+			}
+			if (is_jump(instruction)) {
+				uint32_t target = find_label(p, instruction->operands[0]);
+				out |= target != UINT32_MAX ? live_in[target] : ALL_REGISTERS;
+			}
+			p->live_out[i] = out | FRAME_REGISTERS;
+
+			register_set in = p->uses[i] | (out & ~p->defs[i]);
+			if (in != live_in[i]) {
+				live_in[i] = in;
+				changed = true;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------- Rules
+
+static const struct mcc_peephole_instruction *at(const struct peephole *p, uint32_t index)
+{
+	return index < p->code->instruction_count ? &p->code->instructions[index] : NULL;
+}
+
+// Whether the instruction at `index` exists and has `mnemonic` and `count`
+// operands.
+static bool is(const struct peephole *p, uint32_t index, const char *mnemonic, uint32_t count)
+{
+	const struct mcc_peephole_instruction *instruction = at(p, index);
+	return instruction && !instruction->label && instruction->operand_count == count &&
+	       strcmp(instruction->text, mnemonic) == 0;
+}
+
+static const char *operand(const struct peephole *p, uint32_t index, uint32_t o)
+{
+	return p->code->instructions[index].operands[o];
+}
+
+static bool is_dead(const struct peephole *p, uint32_t index, register_set set)
+{
+	return (p->live_out[index] & set) == 0;
+}
+
+// Replaces the instruction at `index`; on failure, the pass is aborted.
+static bool replace(struct peephole *p, uint32_t index, const char *mnemonic, uint32_t count, ...)
+{
+	const char *operands[MCC_PEEPHOLE_MAX_OPERANDS];
+	va_list args;
+	va_start(args, count);
+	for (uint32_t o = 0; o < count; ++o) {
+		operands[o] = va_arg(args, const char *);
+	}
+	va_end(args);
+
+	char *text = make_text(mnemonic, count, operands);
+	if (!text) {
+		p->failed = true;
+		return false;
+	}
+	set_text(&p->code->instructions[index], text, count);
+	return true;
+}
+
+static void remove_instruction(struct peephole *p, uint32_t index)
+{
+	p->removed[index] = true;
+}
+
+// setCC %al; movzbl %al, %eax; [movl %eax, R;] testl R, R; je/jne L
+//   -> jNCC/jCC L
+static uint32_t compare_branch(struct peephole *p, uint32_t index)
+{
+	const struct mcc_peephole_instruction *set = at(p, index);
+	uint32_t condition = set->label ? NO_CONDITION : condition_of(set->text, "set");
+	if (condition == NO_CONDITION || set->operand_count != 1 || strcmp(set->operands[0], "%al") != 0 ||
+	    !is(p, index + 1, "movzbl", 2) || strcmp(operand(p, index + 1, 0), "%al") != 0 ||
+	    strcmp(operand(p, index + 1, 1), "%eax") != 0) {
+		return 0;
+	}
+
+	uint32_t test = index + 2;
+	const char *result = "%eax";
+	if (is(p, test, "movl", 2) && !strcmp(operand(p, test, 0), "%eax") && general_register(operand(p, test, 1))) {
+		result = operand(p, test, 1);
+		++test;
+	}
+	uint32_t jump = test + 1;
+	if (!is(p, test, "testl", 2) || strcmp(operand(p, test, 0), result) != 0 ||
+	    strcmp(operand(p, test, 1), result) != 0) {
+		return 0;
+	}
+	bool on_false = is(p, jump, "je", 1);
+	if (!on_false && !is(p, jump, "jne", 1)) {
+		return 0;
+	}
+	if (!is_dead(p, jump, BIT(REG_EAX) | registers_in(result) | BIT(REG_FLAGS))) {
+		return 0;
+	}
+
+	char mnemonic[8];
+	snprintf(mnemonic, sizeof(mnemonic), "j%s", conditions[on_false ? condition ^ 1 : condition]);
+	if (!replace(p, index, mnemonic, 1, operand(p, jump, 0))) {
+		return 0;
+	}
+	for (uint32_t i = index + 1; i <= jump; ++i) {
+		remove_instruction(p, i);
+	}
+	return jump - index + 1;
+}
+
+// movl X, R; cmpl Y, R -> cmpl Y, X
+static uint32_t compare_operand(struct peephole *p, uint32_t index)
+{
+	if (!is(p, index, "movl", 2) || !is(p, index + 1, "cmpl", 2)) {
+		return 0;
+	}
+	const char *x = operand(p, index, 0);
+	const char *y = operand(p, index + 1, 0);
+	register_set reg = general_register(operand(p, index, 1));
+	if (!reg || strcmp(operand(p, index, 1), operand(p, index + 1, 1)) != 0 || is_immediate(x) ||
+	    (is_memory(x) && is_memory(y)) || (registers_in(y) & reg) || !is_dead(p, index + 1, reg)) {
+		return 0;
+	}
+
+	if (!replace(p, index + 1, "cmpl", 2, y, x)) {
+		return 0;
+	}
+	remove_instruction(p, index);
+	return 2;
+}
+
+// cmpl $0, R -> testl R, R
+static uint32_t compare_zero(struct peephole *p, uint32_t index)
+{
+	if (!is(p, index, "cmpl", 2) || strcmp(operand(p, index, 0), "$0") != 0 ||
+	    !general_register(operand(p, index, 1))) {
+		return 0;
+	}
+	const char *reg = operand(p, index, 1);
+	return replace(p, index, "testl", 2, reg, reg) ? 1 : 0;
+}
+
+// mov X, Y; mov Y, X -> mov X, Y
+static uint32_t move_back(struct peephole *p, uint32_t index)
+{
+	static const char *const moves[] = {"movl", "movaps"};
+
+	for (size_t m = 0; m < sizeof(moves) / sizeof(*moves); ++m) {
+		if (!is(p, index, moves[m], 2) || !is(p, index + 1, moves[m], 2)) {
+			continue;
+		}
+		const char *x = operand(p, index, 0);
+		const char *y = operand(p, index, 1);
+		if (strcmp(x, operand(p, index + 1, 1)) != 0 || strcmp(y, operand(p, index + 1, 0)) != 0) {
+			return 0;
+		}
+		// the first move must not change the address of x
+		if (is_register(y) && (registers_in(x) & registers_in(y))) {
+			return 0;
+		}
+		remove_instruction(p, index + 1);
+		return 2;
+	}
+	return 0;
+}
+
+// op ..., R -> (nothing), if the results are overwritten before being read
+static uint32_t dead_result(struct peephole *p, uint32_t index)
+{
+	const struct mcc_peephole_instruction *instruction = at(p, index);
+	const struct mnemonic *mnemonic = instruction->label ? NULL : find_mnemonic(instruction->text);
+	if (!mnemonic || !mnemonic->pure || p->defs[index] == 0 || !is_dead(p, index, p->defs[index])) {
+		return 0;
+	}
+
+	// stores to memory are kept
+	uint32_t count = instruction->operand_count;
+	if (mnemonic->effect != EFFECT_READ && count && is_memory(instruction->operands[count - 1])) {
+		return 0;
+	}
+	remove_instruction(p, index);
+	return 1;
+}
+
+// movl A, T; op B, T; movl T, C -> op B, A if C is A, else movl A, C; op B, C
+static uint32_t fold_operation(struct peephole *p, uint32_t index)
+{
+	static const char *const operations[] = {"addl", "subl", "imull", "andl", "orl", "xorl"};
+
+	if (!is(p, index, "movl", 2) || !is(p, index + 2, "movl", 2)) {
+		return 0;
+	}
+	const char *operation = NULL;
+	for (size_t o = 0; o < sizeof(operations) / sizeof(*operations); ++o) {
+		if (is(p, index + 1, operations[o], 2)) {
+			operation = operations[o];
+		}
+	}
+	if (!operation) {
+		return 0;
+	}
+
+	const char *a = operand(p, index, 0);
+	const char *t = operand(p, index, 1);
+	const char *b = operand(p, index + 1, 0);
+	const char *c = operand(p, index + 2, 1);
+	register_set temporary = general_register(t);
+	if (!temporary || strcmp(t, operand(p, index + 1, 1)) != 0 || strcmp(t, operand(p, index + 2, 0)) != 0 ||
+	    !strcmp(t, c) || (registers_in(a) & temporary) || (registers_in(b) & temporary) ||
+	    !is_dead(p, index + 2, temporary)) {
+		return 0;
+	}
+
+	if (strcmp(a, c) == 0) {
+		if ((is_memory(a) && is_memory(b)) || (!strcmp(operation, "imull") && !is_register(a))) {
+			return 0;
+		}
+		if (!replace(p, index + 2, operation, 2, b, a)) {
+			return 0;
+		}
+		remove_instruction(p, index);
+		remove_instruction(p, index + 1);
+		return 3;
+	}
+
+	if (!general_register(c) || (registers_in(b) & registers_in(c))) {
+		return 0;
+	}
+	char *move = make_text("movl", 2, (const char *const[]){a, c});
+	char *combine = make_text(operation, 2, (const char *const[]){b, c});
+	if (!move || !combine) {
+		free(move);
+		free(combine);
+		p->failed = true;
+		return 0;
+	}
+	set_text(&p->code->instructions[index], move, 2);
+	set_text(&p->code->instructions[index + 1], combine, 2);
+	remove_instruction(p, index + 2);
+	return 3;
+}
+
+// movl $0, R -> xorl R, R
+static uint32_t zero_register(struct peephole *p, uint32_t index)
+{
+	if (!is(p, index, "movl", 2) || strcmp(operand(p, index, 0), "$0") != 0 ||
+	    !general_register(operand(p, index, 1)) || !is_dead(p, index, BIT(REG_FLAGS))) {
+		return 0;
+	}
+	const char *reg = operand(p, index, 1);
+	return replace(p, index, "xorl", 2, reg, reg) ? 1 : 0;
+}
+
+// Reads the bytes added to esp by `addl $n, %esp` or `subl $n, %esp`.
+static bool stack_adjustment(const struct peephole *p, uint32_t index, long *bytes)
+{
+	bool add = is(p, index, "addl", 2);
+	if ((!add && !is(p, index, "subl", 2)) || strcmp(operand(p, index, 1), "%esp") != 0 ||
+	    !is_immediate(operand(p, index, 0))) {
+		return false;
+	}
+	char *end;
+	long value = strtol(operand(p, index, 0) + 1, &end, 10);
+	if (*end != '\0') {
+		return false;
+	}
+	*bytes = add ? value : -value;
+	return true;
+}
+
+// addl/subl $a, %esp; addl/subl $b, %esp -> one adjustment or none
+static uint32_t stack_adjustments(struct peephole *p, uint32_t index)
+{
+	long first, second;
+	if (!stack_adjustment(p, index, &first) || !stack_adjustment(p, index + 1, &second) ||
+	    !is_dead(p, index + 1, BIT(REG_FLAGS))) {
+		return 0;
+	}
+
+	long bytes = first + second;
+	if (bytes != 0) {
+		char immediate[24];
+		snprintf(immediate, sizeof(immediate), "$%ld", bytes < 0 ? -bytes : bytes);
+		if (!replace(p, index, bytes < 0 ? "subl" : "addl", 2, immediate, "%esp")) {
+			return 0;
+		}
+	} else {
+		remove_instruction(p, index);
+	}
+	remove_instruction(p, index + 1);
+	return 2;
+}
+
+// Whether label `name` is among the labels directly following `index`.
+static bool label_follows(const struct peephole *p, uint32_t index, const char *name)
+{
+	for (const struct mcc_peephole_instruction *next = at(p, ++index); next && next->label; next = at(p, ++index)) {
+		if (strcmp(next->text, name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// jmp L; L: -> L:
+static uint32_t jump_next(struct peephole *p, uint32_t index)
+{
+	if (!is(p, index, "jmp", 1) || !label_follows(p, index, operand(p, index, 0))) {
+		return 0;
+	}
+	remove_instruction(p, index);
+	return 1;
+}
+
+// jCC L1; jmp L2; L1: -> jNCC L2; L1:
+static uint32_t branch_over(struct peephole *p, uint32_t index)
+{
+	const struct mcc_peephole_instruction *branch = at(p, index);
+	uint32_t condition = branch->label ? NO_CONDITION : condition_of(branch->text, "j");
+	if (condition == NO_CONDITION || branch->operand_count != 1 || !is(p, index + 1, "jmp", 1) ||
+	    !label_follows(p, index + 1, branch->operands[0])) {
+		return 0;
+	}
+
+	char mnemonic[8];
+	snprintf(mnemonic, sizeof(mnemonic), "j%s", conditions[condition ^ 1]);
+	if (!replace(p, index, mnemonic, 1, operand(p, index + 1, 0))) {
+		return 0;
+	}
+	remove_instruction(p, index + 1);
+	return 2;
+}
+
+struct rule {
+	const char *name;
+	const char *description;
+
+	// applies the rule at an instruction, returning the number of
+	// instructions matched or 0
+	uint32_t (*apply)(struct peephole *p, uint32_t index);
+};
+
+static const struct rule rules[MCC_PEEPHOLE_RULE_COUNT] = {
+    [MCC_PEEPHOLE_COMPARE_BRANCH] = {"compare-branch", "branch on a comparison instead of testing its bool",
+                                     compare_branch},
+    [MCC_PEEPHOLE_COMPARE_OPERAND] = {"compare-operand", "compare an operand instead of its copy", compare_operand},
+    [MCC_PEEPHOLE_COMPARE_ZERO] = {"compare-zero", "test a register instead of comparing it with 0", compare_zero},
+    [MCC_PEEPHOLE_MOVE_BACK] = {"move-back", "drop a move undoing the preceding one", move_back},
+    [MCC_PEEPHOLE_DEAD_RESULT] = {"dead-result", "drop an instruction whose results are never read", dead_result},
+    [MCC_PEEPHOLE_FOLD_OPERATION] = {"fold-operation", "compute in the destination instead of a scratch register",
+                                     fold_operation},
+    [MCC_PEEPHOLE_ZERO_REGISTER] = {"zero-register", "clear a register by xor instead of moving 0", zero_register},
+    [MCC_PEEPHOLE_STACK_ADJUSTMENT] = {"stack-adjustment", "merge adjacent adjustments of the stack pointer",
+                                       stack_adjustments},
+    [MCC_PEEPHOLE_JUMP_NEXT] = {"jump-next", "drop a jump to the following label", jump_next},
+    [MCC_PEEPHOLE_BRANCH_OVER] = {"branch-over", "invert a branch over a jump", branch_over},
+};
+
+const char *mcc_peephole_rule_name(enum mcc_peephole_rule rule)
+{
+	assert(rule < MCC_PEEPHOLE_RULE_COUNT);
+	return rules[rule].name;
+}
+
+const char *mcc_peephole_rule_description(enum mcc_peephole_rule rule)
+{
+	assert(rule < MCC_PEEPHOLE_RULE_COUNT);
+	return rules[rule].description;
+}
+
+// ---------------------------------------------------------------- Optimizer
+
+// Drops the instructions removed by the last pass.
+static void compact(struct peephole *p)
+{
+	struct mcc_peephole_code *code = p->code;
+	uint32_t kept = 0;
+	for (uint32_t i = 0; i < code->instruction_count; ++i) {
+		if (p->removed[i]) {
+			free(code->instructions[i].text);
+			p->removed[i] = false;
+		} else {
+			code->instructions[kept++] = code->instructions[i];
+		}
+	}
+	code->instruction_count = kept;
+}
+
+// Applies the rules once at every instruction. Instructions matched by a
+// rule are not matched again in the same pass, so that the liveness, which
+// rewrites only ever shrink, stays valid. Returns the number of hits.
+static uint32_t run_pass(struct peephole *p, struct mcc_peephole_stats *stats)
+{
+	compute_liveness(p);
+
+	uint32_t hits = 0;
+	for (uint32_t i = 0; !p->failed && i < p->code->instruction_count;) {
+		uint32_t matched = 0;
+		for (uint32_t r = 0; !matched && !p->failed && r < MCC_PEEPHOLE_RULE_COUNT; ++r) {
+			matched = rules[r].apply(p, i);
+			if (matched) {
+				++hits;
+				if (stats) {
+					++stats->hits[r];
+				}
+			}
+		}
+		i += matched ? matched : 1;
+	}
+
+	compact(p);
+	return hits;
+}
+
+bool mcc_peephole_optimize(struct mcc_peephole_code *code, struct mcc_peephole_stats *stats)
+{
+	assert(code);
+
+	uint32_t count = code->instruction_count;
+	struct peephole p = {
+	    .code = code,
+	    .uses = malloc((count + 1) * sizeof(*p.uses)),
+	    .defs = malloc((count + 1) * sizeof(*p.defs)),
+	    .live_in = malloc((count + 1) * sizeof(*p.live_in)),
+	    .live_out = malloc((count + 1) * sizeof(*p.live_out)),
+	    .labels = malloc((count + 1) * sizeof(*p.labels)),
+	    .removed = calloc(count + 1, sizeof(*p.removed)),
+	};
+	p.failed = !p.uses || !p.defs || !p.live_in || !p.live_out || !p.labels || !p.removed;
+
+	while (!p.failed && run_pass(&p, stats) != 0) {
+	}
+
+	free(p.uses);
+	free(p.defs);
+	free(p.live_in);
+	free(p.live_out);
+	free(p.labels);
+	free(p.removed);
+	return !p.failed;
+}
@@ -0,0 +1,120 @@
+#include "mcc/reaching_definitions.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+// Numbers the definitions and groups them by register, a counting sort.
+static bool number_definitions(struct mcc_reaching_definitions *definitions, const struct mcc_ir_function *function)
+{
+	uint32_t count = function->parameter_count;
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		count += mcc_ir_defined_vreg(&function->instructions[i]) != MCC_IR_NONE;
+	}
+
+	definitions->instructions = malloc(count * sizeof(*definitions->instructions));
+	definitions->vregs = malloc(count * sizeof(*definitions->vregs));
+	definitions->vreg_first = calloc(function->vreg_count + 1, sizeof(*definitions->vreg_first));
+	definitions->vreg_definitions = malloc(count * sizeof(*definitions->vreg_definitions));
+	if (!definitions->vreg_first ||
+	    (count && (!definitions->instructions || !definitions->vregs || !definitions->vreg_definitions))) {
+		return false;
+	}
+
+	for (uint32_t p = 0; p < function->parameter_count; ++p) {
+		definitions->instructions[definitions->definition_count] = MCC_REACHING_DEFINITIONS_PARAMETER;
+		definitions->vregs[definitions->definition_count++] = p;
+	}
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		mcc_ir_operand def = mcc_ir_defined_vreg(&function->instructions[i]);
+		if (def != MCC_IR_NONE) {
+			definitions->instructions[definitions->definition_count] = i;
+			definitions->vregs[definitions->definition_count++] = MCC_IR_OPERAND_INDEX(def);
+		}
+	}
+
+	// vreg_first[v + 1] counts the definitions of v, then the prefix sums
+	// give the start of each group
+	for (uint32_t d = 0; d < count; ++d) {
+		++definitions->vreg_first[definitions->vregs[d] + 1];
+	}
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		definitions->vreg_first[v + 1] += definitions->vreg_first[v];
+	}
+
+	// fill the groups using vreg_first[v] as cursor, which shifts every
+	// entry one group up; shift it back afterwards
+	for (uint32_t d = 0; d < count; ++d) {
+		definitions->vreg_definitions[definitions->vreg_first[definitions->vregs[d]]++] = d;
+	}
+	for (uint32_t v = function->vreg_count; v > 0; --v) {
+		definitions->vreg_first[v] = definitions->vreg_first[v - 1];
+	}
+	definitions->vreg_first[0] = 0;
+	return true;
+}
+
+// Adds all definitions of register `vreg` to `set`.
+static void add_all(const struct mcc_reaching_definitions *definitions, mcc_bitset_word *set, uint32_t vreg)
+{
+	for (uint32_t i = definitions->vreg_first[vreg]; i < definitions->vreg_first[vreg + 1]; ++i) {
+		MCC_BITSET_SET(set, definitions->vreg_definitions[i]);
+	}
+}
+
+static void remove_all(const struct mcc_reaching_definitions *definitions, mcc_bitset_word *set, uint32_t vreg)
+{
+	for (uint32_t i = definitions->vreg_first[vreg]; i < definitions->vreg_first[vreg + 1]; ++i) {
+		MCC_BITSET_CLEAR(set, definitions->vreg_definitions[i]);
+	}
+}
+
+bool mcc_reaching_definitions_compute(struct mcc_reaching_definitions *definitions, const struct mcc_cfg *cfg)
+{
+	assert(definitions);
+	assert(cfg);
+
+	*definitions = (struct mcc_reaching_definitions){0};
+
+	const struct mcc_ir_function *function = cfg->function;
+	if (!number_definitions(definitions, function) ||
+	    !mcc_dataflow_init(&definitions->dataflow, cfg, MCC_DATAFLOW_FORWARD, MCC_DATAFLOW_UNION,
+	                       definitions->definition_count)) {
+		return false;
+	}
+	struct mcc_dataflow *dataflow = &definitions->dataflow;
+
+	// definitions are visited in program order, hence block by block
+	uint32_t d = function->parameter_count;
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		const struct mcc_cfg_block *block = &cfg->blocks[b];
+		mcc_bitset_word *gen = MCC_DATAFLOW_SET(dataflow, gen, b);
+		mcc_bitset_word *kill = MCC_DATAFLOW_SET(dataflow, kill, b);
+
+		for (; d < definitions->definition_count && definitions->instructions[d] < block->end; ++d) {
+			// the last definition of a register in the block survives
+			uint32_t vreg = definitions->vregs[d];
+			add_all(definitions, kill, vreg);
+			remove_all(definitions, gen, vreg);
+			MCC_BITSET_SET(gen, d);
+		}
+	}
+
+	for (uint32_t p = 0; p < function->parameter_count; ++p) {
+		MCC_BITSET_SET(dataflow->boundary, p);
+	}
+
+	mcc_dataflow_solve(dataflow, cfg);
+	return true;
+}
+
+void mcc_reaching_definitions_release(struct mcc_reaching_definitions *definitions)
+{
+	assert(definitions);
+
+	mcc_dataflow_release(&definitions->dataflow);
+	free(definitions->instructions);
+	free(definitions->vregs);
+	free(definitions->vreg_first);
+	free(definitions->vreg_definitions);
+	*definitions = (struct mcc_reaching_definitions){0};
+}
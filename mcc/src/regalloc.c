@@ -0,0 +1,257 @@
+#include "mcc/regalloc.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "mcc/liveness.h"
+
+// Positions interleave reads and writes: instruction i reads at 2i+1 and
+// writes at 2i+2, so a register read for the last time may be reused for the
+// result. Registers live on entry of a block start at 2*first, those live on
+// exit end at 2*end.
+#define READ_POSITION(i) (2 * (i) + 1)
+#define WRITE_POSITION(i) (2 * (i) + 2)
+
+struct interval {
+	uint32_t vreg;
+	uint32_t start;
+	uint32_t end;
+};
+
+// Intervals currently holding a register of one class, by increasing end.
+struct active {
+	struct interval *intervals[MCC_REGALLOC_MAX_REGISTERS];
+	uint32_t count;
+
+	// bit r is set if register r is held
+	uint32_t busy;
+};
+
+static void extend(uint32_t *starts, uint32_t *ends, uint32_t vreg, uint32_t position)
+{
+	if (position < starts[vreg]) {
+		starts[vreg] = position;
+	}
+	if (position > ends[vreg]) {
+		ends[vreg] = position;
+	}
+}
+
+// Computes the interval bounds of each register; registers never occurring
+// keep a start of UINT32_MAX.
+static bool compute_bounds(const struct mcc_cfg *cfg, uint32_t *starts, uint32_t *ends)
+{
+	const struct mcc_ir_function *function = cfg->function;
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		starts[v] = UINT32_MAX;
+		ends[v] = 0;
+	}
+
+	struct mcc_dataflow live;
+	if (!mcc_liveness_compute(&live, cfg)) {
+		mcc_dataflow_release(&live);
+		return false;
+	}
+
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		const struct mcc_cfg_block *block = &cfg->blocks[b];
+		const mcc_bitset_word *in = MCC_DATAFLOW_SET(&live, in, b);
+		const mcc_bitset_word *out = MCC_DATAFLOW_SET(&live, out, b);
+
+		for (uint32_t v = mcc_bitset_next(in, live.word_count, 0); v != MCC_BITSET_END;
+		     v = mcc_bitset_next(in, live.word_count, v + 1)) {
+			extend(starts, ends, v, 2 * block->first);
+		}
+		for (uint32_t v = mcc_bitset_next(out, live.word_count, 0); v != MCC_BITSET_END;
+		     v = mcc_bitset_next(out, live.word_count, v + 1)) {
+			extend(starts, ends, v, 2 * block->end);
+		}
+
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			const struct mcc_ir_instruction *instruction = &function->instructions[i];
+
+			mcc_ir_operand uses[MCC_IR_MAX_USES];
+			uint32_t use_count = mcc_ir_used_vregs(instruction, uses);
+			for (uint32_t u = 0; u < use_count; ++u) {
+				extend(starts, ends, MCC_IR_OPERAND_INDEX(uses[u]), READ_POSITION(i));
+			}
+
+			mcc_ir_operand def = mcc_ir_defined_vreg(instruction);
+			if (def != MCC_IR_NONE) {
+				extend(starts, ends, MCC_IR_OPERAND_INDEX(def), WRITE_POSITION(i));
+			}
+		}
+	}
+
+	mcc_dataflow_release(&live);
+	return true;
+}
+
+// Lists the intervals by increasing start, a counting sort.
+static struct interval *sort_intervals(const struct mcc_ir_function *function,
+                                       const uint32_t *starts,
+                                       const uint32_t *ends,
+                                       uint32_t *count)
+{
+	uint32_t position_count = 2 * function->instruction_count + 3;
+	uint32_t *first = calloc(position_count + 1, sizeof(*first));
+	struct interval *intervals = malloc((function->vreg_count + 1) * sizeof(*intervals));
+	if (!first || !intervals) {
+		free(first);
+		free(intervals);
+		return NULL;
+	}
+
+	*count = 0;
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		if (starts[v] != UINT32_MAX) {
+			++first[starts[v] + 1];
+			++*count;
+		}
+	}
+	for (uint32_t i = 0; i < position_count; ++i) {
+		first[i + 1] += first[i];
+	}
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		if (starts[v] != UINT32_MAX) {
+			struct interval *interval = &intervals[first[starts[v]]++];
+			*interval = (struct interval){.vreg = v, .start = starts[v], .end = ends[v]};
+		}
+	}
+
+	free(first);
+	return intervals;
+}
+
+static void insert_active(struct active *active, struct interval *interval, uint32_t reg)
+{
+	uint32_t i = active->count++;
+	while (i > 0 && active->intervals[i - 1]->end > interval->end) {
+		active->intervals[i] = active->intervals[i - 1];
+		--i;
+	}
+	active->intervals[i] = interval;
+	active->busy |= UINT32_C(1) << reg;
+}
+
+static void remove_active(struct active *active, uint32_t index, const uint8_t *locations)
+{
+	active->busy &= ~(UINT32_C(1) << locations[active->intervals[index]->vreg]);
+	--active->count;
+	for (uint32_t i = index; i < active->count; ++i) {
+		active->intervals[i] = active->intervals[i + 1];
+	}
+}
+
+static void allocate(struct mcc_regalloc *allocation,
+                     const struct mcc_regalloc_target *target,
+                     const struct mcc_ir_function *function,
+                     struct interval *intervals,
+                     uint32_t interval_count,
+                     const uint32_t *calls_before)
+{
+	struct active active[MCC_REGALLOC_MAX_CLASSES] = {0};
+
+	for (uint32_t n = 0; n < interval_count; ++n) {
+		struct interval *interval = &intervals[n];
+		uint32_t class = target->type_classes[function->vreg_types[interval->vreg]];
+		const struct mcc_regalloc_class *registers = &target->classes[class];
+		if (registers->register_count == 0) {
+			allocation->locations[interval->vreg] = MCC_REGALLOC_STACK;
+			continue;
+		}
+		++allocation->interval_count;
+
+		struct active *current = &active[class];
+		while (current->count && current->intervals[0]->end < interval->start) {
+			remove_active(current, 0, allocation->locations);
+		}
+
+		// live before and after the call at p: start <= 2p and end >= 2p+3
+		uint32_t first_call = (interval->start + 1) / 2;
+		uint32_t end_call = interval->end >= 3 ? (interval->end - 3) / 2 + 1 : 0;
+		bool spans_call = end_call > first_call && calls_before[end_call] != calls_before[first_call];
+		uint32_t all = (UINT32_C(1) << registers->register_count) - 1;
+		uint32_t allowed = spans_call ? registers->call_preserved & all : all;
+
+		uint32_t free_registers = allowed & ~current->busy;
+		if (free_registers) {
+			uint32_t reg = 0;
+			while (!(free_registers & (UINT32_C(1) << reg))) {
+				++reg;
+			}
+			allocation->locations[interval->vreg] = (uint8_t)reg;
+			allocation->used_registers[class] |= UINT32_C(1) << reg;
+			insert_active(current, interval, reg);
+			continue;
+		}
+
+		// spill whichever of the intervals ends last
+		++allocation->spill_count;
+		allocation->locations[interval->vreg] = MCC_REGALLOC_STACK;
+		for (uint32_t i = current->count; i-- > 0;) {
+			struct interval *candidate = current->intervals[i];
+			uint8_t reg = allocation->locations[candidate->vreg];
+			if (!(allowed & (UINT32_C(1) << reg))) {
+				continue;
+			}
+			if (candidate->end > interval->end) {
+				remove_active(current, i, allocation->locations);
+				allocation->locations[candidate->vreg] = MCC_REGALLOC_STACK;
+				allocation->locations[interval->vreg] = reg;
+				insert_active(current, interval, reg);
+			}
+			break;
+		}
+	}
+}
+
+bool mcc_regalloc_compute(struct mcc_regalloc *allocation,
+                          const struct mcc_cfg *cfg,
+                          const struct mcc_regalloc_target *target)
+{
+	assert(allocation);
+	assert(cfg);
+	assert(target);
+
+	const struct mcc_ir_function *function = cfg->function;
+	*allocation = (struct mcc_regalloc){0};
+	allocation->locations = malloc((function->vreg_count + 1) * sizeof(*allocation->locations));
+
+	uint32_t *starts = malloc((function->vreg_count + 1) * sizeof(*starts));
+	uint32_t *ends = malloc((function->vreg_count + 1) * sizeof(*ends));
+	uint32_t *calls_before = malloc((function->instruction_count + 2) * sizeof(*calls_before));
+	struct interval *intervals = NULL;
+	uint32_t interval_count = 0;
+
+	bool ok = allocation->locations && starts && ends && calls_before && compute_bounds(cfg, starts, ends) &&
+	          (intervals = sort_intervals(function, starts, ends, &interval_count));
+	if (ok) {
+		for (uint32_t v = 0; v < function->vreg_count; ++v) {
+			allocation->locations[v] = MCC_REGALLOC_UNUSED;
+		}
+
+		// calls_before[i] counts the calls at positions below i
+		calls_before[0] = 0;
+		for (uint32_t i = 0; i <= function->instruction_count; ++i) {
+			bool call = i < function->instruction_count && function->instructions[i].opcode == MCC_IR_CALL;
+			calls_before[i + 1] = calls_before[i] + call;
+		}
+
+		allocate(allocation, target, function, intervals, interval_count, calls_before);
+	}
+
+	free(starts);
+	free(ends);
+	free(calls_before);
+	free(intervals);
+	return ok;
+}
+
+void mcc_regalloc_release(struct mcc_regalloc *allocation)
+{
+	assert(allocation);
+
+	free(allocation->locations);
+	*allocation = (struct mcc_regalloc){0};
+}
@@ -0,0 +1,606 @@
+#include "mcc/sccp.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Lattice values besides constant pool indices.
+#define TOP UINT32_MAX
+#define BOTTOM (UINT32_MAX - 1)
+
+// No copy source.
+#define NONE UINT32_MAX
+
+struct sccp {
+	struct mcc_ir_module *module;
+	struct mcc_ssa *ssa;
+	bool ok;
+
+	// lattice value of each register
+	uint32_t *values;
+
+	// register copied by the instruction writing each register, or NONE
+	uint32_t *copy_sources;
+
+	// block of each instruction
+	uint32_t *instruction_blocks;
+
+	// instructions reading register v are uses[use_first[v] .. use_first[v + 1]-1]
+	uint32_t *use_first;
+	uint32_t *uses;
+
+	mcc_bitset_word *visited_blocks;
+	mcc_bitset_word *taken_edges;
+
+	// edges taken for the first time, as MCC_SSA_EDGE
+	uint32_t *edge_worklist;
+	uint32_t edge_worklist_size;
+
+	// registers whose value was lowered; a register is queued at most twice
+	uint32_t *vreg_worklist;
+	uint32_t vreg_worklist_size;
+};
+
+// ---------------------------------------------------------------- Use Lists
+
+// Calls `add` for each register read by `instruction`, phi operands included.
+#define FOR_EACH_USE(function, instruction, add)                                                                       \
+	do {                                                                                                           \
+		mcc_ir_operand uses_[MCC_IR_MAX_USES];                                                                 \
+		uint32_t use_count_ = mcc_ir_used_vregs(instruction, uses_);                                           \
+		for (uint32_t u_ = 0; u_ < use_count_; ++u_) {                                                         \
+			add(uses_[u_]);                                                                                \
+		}                                                                                                      \
+		if ((instruction)->opcode == MCC_IR_PHI) {                                                             \
+			for (uint32_t o_ = 0; o_ < MCC_IR_OPERAND_INDEX((instruction)->b); ++o_) {                     \
+				add((function)->phi_operands[MCC_IR_OPERAND_INDEX((instruction)->a) + o_]);            \
+			}                                                                                              \
+		}                                                                                                      \
+	} while (0)
+
+// Groups the instructions by the registers they read, a counting sort. An
+// instruction reading a register twice is listed twice.
+static bool collect_uses(struct sccp *sccp)
+{
+	const struct mcc_ir_function *function = sccp->ssa->function;
+	uint32_t vreg_count = function->vreg_count;
+
+	sccp->use_first = calloc(vreg_count + 2, sizeof(*sccp->use_first));
+	if (!sccp->use_first) {
+		return false;
+	}
+	uint32_t *first = sccp->use_first;
+
+#define COUNT_USE(operand)                                                                                             \
+	if (MCC_IR_IS_VREG(operand)) {                                                                                 \
+		++first[MCC_IR_OPERAND_INDEX(operand) + 2];                                                            \
+	}
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		FOR_EACH_USE(function, &function->instructions[i], COUNT_USE);
+	}
+#undef COUNT_USE
+
+	for (uint32_t v = 0; v < vreg_count; ++v) {
+		first[v + 2] += first[v + 1];
+	}
+	sccp->uses = malloc((first[vreg_count + 1] + 1) * sizeof(*sccp->uses));
+	if (!sccp->uses) {
+		return false;
+	}
+
+#define ADD_USE(operand)                                                                                               \
+	if (MCC_IR_IS_VREG(operand)) {                                                                                 \
+		sccp->uses[first[MCC_IR_OPERAND_INDEX(operand) + 1]++] = i;                                            \
+	}
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		FOR_EACH_USE(function, &function->instructions[i], ADD_USE);
+	}
+#undef ADD_USE
+
+	return true;
+}
+
+// ------------------------------------------------------------------- Lattice
+
+static uint32_t meet(uint32_t a, uint32_t b)
+{
+	if (a == TOP) {
+		return b;
+	}
+	if (b == TOP || a == b) {
+		return a;
+	}
+	return BOTTOM;
+}
+
+static uint32_t value_of(const struct sccp *sccp, mcc_ir_operand operand)
+{
+	switch (MCC_IR_OPERAND_KIND(operand)) {
+	case MCC_IR_OPERAND_VREG:
+		return sccp->values[MCC_IR_OPERAND_INDEX(operand)];
+	case MCC_IR_OPERAND_CONST:
+		return MCC_IR_OPERAND_INDEX(operand);
+	default:
+		return BOTTOM;
+	}
+}
+
+static uint32_t constant(struct sccp *sccp, struct mcc_ir_constant value)
+{
+	uint32_t index = mcc_ir_add_constant(sccp->module, &value);
+	if (index == MCC_IR_OPERAND_MAX) {
+		sccp->ok = false;
+		return BOTTOM;
+	}
+	return index;
+}
+
+static uint32_t int_constant(struct sccp *sccp, uint32_t value)
+{
+	return constant(sccp, (struct mcc_ir_constant){.type = MCC_IR_TYPE_INT, .i_value = (int32_t)value});
+}
+
+static uint32_t float_constant(struct sccp *sccp, float value)
+{
+	// infinities and NaNs are left to run time
+	if (!isfinite(value)) {
+		return BOTTOM;
+	}
+	return constant(sccp, (struct mcc_ir_constant){.type = MCC_IR_TYPE_FLOAT, .f_value = value});
+}
+
+static uint32_t bool_constant(struct sccp *sccp, bool value)
+{
+	return constant(sccp, (struct mcc_ir_constant){.type = MCC_IR_TYPE_BOOL, .b_value = value});
+}
+
+// ------------------------------------------------------------------- Folding
+
+// int is 32 bits wide on the target, arithmetic wraps around.
+static uint32_t fold_int(struct sccp *sccp, enum mcc_ir_opcode opcode, int32_t x, int32_t y)
+{
+	switch (opcode) {
+	case MCC_IR_ADD:
+		return int_constant(sccp, (uint32_t)x + (uint32_t)y);
+	case MCC_IR_SUB:
+		return int_constant(sccp, (uint32_t)x - (uint32_t)y);
+	case MCC_IR_MUL:
+		return int_constant(sccp, (uint32_t)x * (uint32_t)y);
+	case MCC_IR_DIV:
+		// trapping divisions are left to run time
+		if (y == 0 || (x == INT32_MIN && y == -1)) {
+			return BOTTOM;
+		}
+		return int_constant(sccp, (uint32_t)(x / y));
+	case MCC_IR_NEG:
+		return int_constant(sccp, -(uint32_t)x);
+	case MCC_IR_EQ:
+		return bool_constant(sccp, x == y);
+	case MCC_IR_NE:
+		return bool_constant(sccp, x != y);
+	case MCC_IR_LT:
+		return bool_constant(sccp, x < y);
+	case MCC_IR_GT:
+		return bool_constant(sccp, x > y);
+	case MCC_IR_LE:
+		return bool_constant(sccp, x <= y);
+	case MCC_IR_GE:
+		return bool_constant(sccp, x >= y);
+	default:
+		return BOTTOM;
+	}
+}
+
+// float is single precision on the target, every step is rounded to it.
+static uint32_t fold_float(struct sccp *sccp, enum mcc_ir_opcode opcode, float x, float y)
+{
+	switch (opcode) {
+	case MCC_IR_ADD:
+		return float_constant(sccp, x + y);
+	case MCC_IR_SUB:
+		return float_constant(sccp, x - y);
+	case MCC_IR_MUL:
+		return float_constant(sccp, x * y);
+	case MCC_IR_DIV:
+		return float_constant(sccp, x / y);
+	case MCC_IR_NEG:
+		return float_constant(sccp, -x);
+	case MCC_IR_EQ:
+		return bool_constant(sccp, x == y);
+	case MCC_IR_NE:
+		return bool_constant(sccp, x != y);
+	case MCC_IR_LT:
+		return bool_constant(sccp, x < y);
+	case MCC_IR_GT:
+		return bool_constant(sccp, x > y);
+	case MCC_IR_LE:
+		return bool_constant(sccp, x <= y);
+	case MCC_IR_GE:
+		return bool_constant(sccp, x >= y);
+	default:
+		return BOTTOM;
+	}
+}
+
+static uint32_t fold_bool(struct sccp *sccp, enum mcc_ir_opcode opcode, bool x, bool y)
+{
+	switch (opcode) {
+	case MCC_IR_AND:
+		return bool_constant(sccp, x && y);
+	case MCC_IR_OR:
+		return bool_constant(sccp, x || y);
+	case MCC_IR_NOT:
+		return bool_constant(sccp, !x);
+	case MCC_IR_EQ:
+		return bool_constant(sccp, x == y);
+	case MCC_IR_NE:
+		return bool_constant(sccp, x != y);
+	default:
+		return BOTTOM;
+	}
+}
+
+static bool is_bool_constant(const struct sccp *sccp, uint32_t value, bool b_value)
+{
+	if (value == TOP || value == BOTTOM) {
+		return false;
+	}
+	const struct mcc_ir_constant *constant = &sccp->module->constants[value];
+	return constant->type == MCC_IR_TYPE_BOOL && constant->b_value == b_value;
+}
+
+static uint32_t evaluate_phi(const struct sccp *sccp, uint32_t b, const struct mcc_ir_instruction *phi)
+{
+	const struct mcc_cfg *cfg = &sccp->ssa->cfg;
+	const struct mcc_cfg_block *block = &cfg->blocks[b];
+	const mcc_ir_operand *operands = &sccp->ssa->function->phi_operands[MCC_IR_OPERAND_INDEX(phi->a)];
+
+	// only operands of edges known to be taken count
+	uint32_t value = TOP;
+	for (uint32_t p = 0; p < block->predecessor_count; ++p) {
+		uint32_t predecessor = cfg->predecessors[block->predecessor_first + p];
+		uint32_t s = cfg->blocks[predecessor].successors[0] == b ? 0 : 1;
+		if (MCC_BITSET_TEST(sccp->taken_edges, MCC_SSA_EDGE(predecessor, s))) {
+			value = meet(value, value_of(sccp, operands[p]));
+		}
+	}
+	return value;
+}
+
+static uint32_t evaluate(struct sccp *sccp, uint32_t b, const struct mcc_ir_instruction *instruction)
+{
+	enum mcc_ir_opcode opcode = instruction->opcode;
+	if (opcode == MCC_IR_PHI) {
+		return evaluate_phi(sccp, b, instruction);
+	}
+	if (opcode == MCC_IR_COPY) {
+		return value_of(sccp, instruction->a);
+	}
+
+	uint32_t x = value_of(sccp, instruction->a);
+	uint32_t y = instruction->b == MCC_IR_NONE ? TOP : value_of(sccp, instruction->b);
+	bool unary = opcode == MCC_IR_NEG || opcode == MCC_IR_NOT;
+
+	switch (opcode) {
+	case MCC_IR_ADD:
+	case MCC_IR_SUB:
+	case MCC_IR_MUL:
+	case MCC_IR_DIV:
+	case MCC_IR_NEG:
+	case MCC_IR_EQ:
+	case MCC_IR_NE:
+	case MCC_IR_LT:
+	case MCC_IR_GT:
+	case MCC_IR_LE:
+	case MCC_IR_GE:
+	case MCC_IR_NOT:
+		break;
+
+	// one false or true operand decides, whatever the other one is
+	case MCC_IR_AND:
+	case MCC_IR_OR:
+		if (is_bool_constant(sccp, x, opcode == MCC_IR_OR) || is_bool_constant(sccp, y, opcode == MCC_IR_OR)) {
+			return bool_constant(sccp, opcode == MCC_IR_OR);
+		}
+		break;
+
+	default:
+		return BOTTOM;
+	}
+
+	if (x == BOTTOM || (!unary && y == BOTTOM)) {
+		return BOTTOM;
+	}
+	if (x == TOP || (!unary && y == TOP)) {
+		return TOP;
+	}
+
+	const struct mcc_ir_constant *cx = &sccp->module->constants[x];
+	const struct mcc_ir_constant *cy = unary ? cx : &sccp->module->constants[y];
+	if (cx->type != cy->type) {
+		return BOTTOM;
+	}
+
+	switch (cx->type) {
+	case MCC_IR_TYPE_INT:
+		return fold_int(sccp, opcode, (int32_t)cx->i_value, (int32_t)cy->i_value);
+	case MCC_IR_TYPE_FLOAT:
+		return fold_float(sccp, opcode, (float)cx->f_value, (float)cy->f_value);
+	case MCC_IR_TYPE_BOOL:
+		return fold_bool(sccp, opcode, cx->b_value, cy->b_value);
+	default:
+		return BOTTOM;
+	}
+}
+
+// -------------------------------------------------------------- Propagation
+
+static void take_edge(struct sccp *sccp, uint32_t b, uint32_t s)
+{
+	uint32_t edge = MCC_SSA_EDGE(b, s);
+	if (!MCC_BITSET_TEST(sccp->ssa->executable_edges, edge) || MCC_BITSET_TEST(sccp->taken_edges, edge)) {
+		return;
+	}
+	MCC_BITSET_SET(sccp->taken_edges, edge);
+	sccp->edge_worklist[sccp->edge_worklist_size++] = edge;
+}
+
+static void visit_instruction(struct sccp *sccp, uint32_t b, uint32_t i)
+{
+	const struct mcc_ir_function *function = sccp->ssa->function;
+	const struct mcc_ir_instruction *instruction = &function->instructions[i];
+	const struct mcc_cfg_block *block = &sccp->ssa->cfg.blocks[b];
+
+	mcc_ir_operand def = mcc_ir_defined_vreg(instruction);
+	if (def != MCC_IR_NONE) {
+		uint32_t vreg = MCC_IR_OPERAND_INDEX(def);
+		uint32_t value = meet(sccp->values[vreg], evaluate(sccp, b, instruction));
+		if (value != sccp->values[vreg]) {
+			sccp->values[vreg] = value;
+			sccp->vreg_worklist[sccp->vreg_worklist_size++] = vreg;
+		}
+	}
+
+	if (i != block->end - 1) {
+		return;
+	}
+
+	if ((instruction->opcode == MCC_IR_JUMP_IF_FALSE || instruction->opcode == MCC_IR_JUMP_IF_TRUE) &&
+	    block->successor_count == 2) {
+		uint32_t condition = value_of(sccp, instruction->a);
+		if (condition == TOP) {
+			return;
+		}
+		if (condition != BOTTOM) {
+			bool value = sccp->module->constants[condition].b_value;
+			bool taken = value == (instruction->opcode == MCC_IR_JUMP_IF_TRUE);
+			take_edge(sccp, b, taken ? 1 : 0);
+			return;
+		}
+	}
+
+	for (uint32_t s = 0; s < block->successor_count; ++s) {
+		take_edge(sccp, b, s);
+	}
+}
+
+static void visit_block(struct sccp *sccp, uint32_t b)
+{
+	const struct mcc_cfg_block *block = &sccp->ssa->cfg.blocks[b];
+
+	// blocks are evaluated in full once, later arrivals only change phis
+	if (MCC_BITSET_TEST(sccp->visited_blocks, b)) {
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			if (sccp->ssa->function->instructions[i].opcode == MCC_IR_PHI) {
+				visit_instruction(sccp, b, i);
+			}
+		}
+		return;
+	}
+
+	MCC_BITSET_SET(sccp->visited_blocks, b);
+	for (uint32_t i = block->first; i < block->end; ++i) {
+		visit_instruction(sccp, b, i);
+	}
+}
+
+static void propagate(struct sccp *sccp)
+{
+	visit_block(sccp, 0);
+
+	while (sccp->edge_worklist_size || sccp->vreg_worklist_size) {
+		if (sccp->edge_worklist_size) {
+			uint32_t edge = sccp->edge_worklist[--sccp->edge_worklist_size];
+			const struct mcc_cfg_block *block = &sccp->ssa->cfg.blocks[edge / 2];
+			visit_block(sccp, block->successors[edge % 2]);
+			continue;
+		}
+
+		uint32_t vreg = sccp->vreg_worklist[--sccp->vreg_worklist_size];
+		for (uint32_t u = sccp->use_first[vreg]; u < sccp->use_first[vreg + 1]; ++u) {
+			uint32_t b = sccp->instruction_blocks[sccp->uses[u]];
+			if (MCC_BITSET_TEST(sccp->visited_blocks, b)) {
+				visit_instruction(sccp, b, sccp->uses[u]);
+			}
+		}
+	}
+}
+
+// ------------------------------------------------------------------ Rewrite
+
+// Records the varying registers which are plain copies of another register.
+// In SSA form, the source is defined before every read of the copy and never
+// changes, so reads of the copy may read the source instead.
+static void collect_copies(struct sccp *sccp)
+{
+	const struct mcc_ir_function *function = sccp->ssa->function;
+
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		sccp->copy_sources[v] = NONE;
+	}
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		if (instruction->opcode != MCC_IR_COPY || !MCC_IR_IS_VREG(instruction->a) ||
+		    !MCC_BITSET_TEST(sccp->visited_blocks, sccp->instruction_blocks[i])) {
+			continue;
+		}
+
+		uint32_t dest = MCC_IR_OPERAND_INDEX(instruction->dest);
+		uint32_t src = MCC_IR_OPERAND_INDEX(instruction->a);
+		if (sccp->values[dest] == BOTTOM && function->vreg_types[dest] == function->vreg_types[src]) {
+			sccp->copy_sources[dest] = src;
+		}
+	}
+}
+
+static mcc_ir_operand substitute(const struct sccp *sccp, mcc_ir_operand operand)
+{
+	if (!MCC_IR_IS_VREG(operand)) {
+		return operand;
+	}
+
+	// chains of copies end at their first source, SSA form rules out cycles
+	uint32_t vreg = MCC_IR_OPERAND_INDEX(operand);
+	while (sccp->copy_sources[vreg] != NONE) {
+		vreg = sccp->copy_sources[vreg];
+	}
+
+	uint32_t value = sccp->values[vreg];
+	return value == TOP || value == BOTTOM ? MCC_IR_VREG(vreg) : MCC_IR_CONST(value);
+}
+
+static void rewrite_instruction(struct sccp *sccp, struct mcc_ir_instruction *instruction, struct mcc_sccp_stats *stats)
+{
+	struct mcc_ir_function *function = sccp->ssa->function;
+
+	mcc_ir_operand def = mcc_ir_defined_vreg(instruction);
+	if (def != MCC_IR_NONE && instruction->opcode != MCC_IR_CALL && substitute(sccp, def) != def) {
+		if (instruction->opcode == MCC_IR_COPY && MCC_IR_IS_VREG(instruction->a) &&
+		    sccp->values[MCC_IR_OPERAND_INDEX(def)] == BOTTOM) {
+			++stats->propagated_copies;
+		} else {
+			++stats->folded_constants;
+		}
+		*instruction = (struct mcc_ir_instruction){.opcode = MCC_IR_NOP};
+		return;
+	}
+
+	if (instruction->opcode == MCC_IR_PHI) {
+		mcc_ir_operand *operands = &function->phi_operands[MCC_IR_OPERAND_INDEX(instruction->a)];
+		for (uint32_t o = 0; o < MCC_IR_OPERAND_INDEX(instruction->b); ++o) {
+			operands[o] = substitute(sccp, operands[o]);
+		}
+		return;
+	}
+
+	if (instruction->opcode == MCC_IR_STORE) {
+		instruction->dest = substitute(sccp, instruction->dest);
+	}
+	instruction->a = substitute(sccp, instruction->a);
+	instruction->b = substitute(sccp, instruction->b);
+
+	if ((instruction->opcode == MCC_IR_JUMP_IF_FALSE || instruction->opcode == MCC_IR_JUMP_IF_TRUE) &&
+	    MCC_IR_OPERAND_KIND(instruction->a) == MCC_IR_OPERAND_CONST) {
+		bool taken = sccp->module->constants[MCC_IR_OPERAND_INDEX(instruction->a)].b_value ==
+		             (instruction->opcode == MCC_IR_JUMP_IF_TRUE);
+		*instruction = taken ? (struct mcc_ir_instruction){.opcode = MCC_IR_JUMP, .a = instruction->b}
+		                     : (struct mcc_ir_instruction){.opcode = MCC_IR_NOP};
+		++stats->removed_branches;
+	}
+}
+
+static void rewrite(struct sccp *sccp, struct mcc_sccp_stats *stats)
+{
+	struct mcc_ssa *ssa = sccp->ssa;
+	struct mcc_ir_function *function = ssa->function;
+
+	collect_copies(sccp);
+	for (uint32_t b = 0; b < ssa->cfg.block_count; ++b) {
+		const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+
+		// labels stay, jumps in dead code may still name them
+		if (!MCC_BITSET_TEST(sccp->visited_blocks, b)) {
+			for (uint32_t i = block->first; i < block->end; ++i) {
+				if (function->instructions[i].opcode != MCC_IR_LABEL) {
+					function->instructions[i] = (struct mcc_ir_instruction){.opcode = MCC_IR_NOP};
+				}
+			}
+			++stats->unreachable_blocks;
+			continue;
+		}
+
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			rewrite_instruction(sccp, &function->instructions[i], stats);
+		}
+	}
+
+	// edges never taken are gone for good
+	uint32_t words = MCC_BITSET_WORDS(2 * ssa->cfg.block_count);
+	mcc_bitset_intersect(ssa->executable_edges, sccp->taken_edges, words);
+}
+
+bool mcc_sccp(struct mcc_ir_module *module, struct mcc_ssa *ssa, struct mcc_sccp_stats *stats)
+{
+	assert(module);
+	assert(ssa);
+
+	const struct mcc_ir_function *function = ssa->function;
+	const struct mcc_cfg *cfg = &ssa->cfg;
+	if (cfg->block_count == 0) {
+		return true;
+	}
+
+	uint32_t vreg_count = function->vreg_count;
+	uint32_t edge_words = MCC_BITSET_WORDS(2 * cfg->block_count);
+	struct sccp sccp = {
+	    .module = module,
+	    .ssa = ssa,
+	    .ok = true,
+	    .values = malloc((vreg_count + 1) * sizeof(*sccp.values)),
+	    .copy_sources = malloc((vreg_count + 1) * sizeof(*sccp.copy_sources)),
+	    .instruction_blocks = malloc((function->instruction_count + 1) * sizeof(*sccp.instruction_blocks)),
+	    .visited_blocks = calloc(MCC_BITSET_WORDS(cfg->block_count) + 1, sizeof(*sccp.visited_blocks)),
+	    .taken_edges = calloc(edge_words + 1, sizeof(*sccp.taken_edges)),
+	    .edge_worklist = malloc((2 * cfg->block_count + 1) * sizeof(*sccp.edge_worklist)),
+	    .vreg_worklist = malloc((2 * vreg_count + 1) * sizeof(*sccp.vreg_worklist)),
+	};
+
+	bool ok = sccp.values && sccp.copy_sources && sccp.instruction_blocks && sccp.visited_blocks &&
+	          sccp.taken_edges && sccp.edge_worklist && sccp.vreg_worklist && collect_uses(&sccp);
+	if (ok) {
+		// the values on function entry are unknown
+		for (uint32_t v = 0; v < vreg_count; ++v) {
+			sccp.values[v] = v < ssa->entry_vreg_count ? BOTTOM : TOP;
+		}
+		for (uint32_t b = 0; b < cfg->block_count; ++b) {
+			for (uint32_t i = cfg->blocks[b].first; i < cfg->blocks[b].end; ++i) {
+				sccp.instruction_blocks[i] = b;
+			}
+		}
+
+		propagate(&sccp);
+		ok = sccp.ok;
+	}
+
+	if (ok) {
+		struct mcc_sccp_stats run = {0};
+		rewrite(&sccp, &run);
+		if (stats) {
+			stats->folded_constants += run.folded_constants;
+			stats->removed_branches += run.removed_branches;
+			stats->unreachable_blocks += run.unreachable_blocks;
+			stats->propagated_copies += run.propagated_copies;
+		}
+	}
+
+	free(sccp.values);
+	free(sccp.copy_sources);
+	free(sccp.instruction_blocks);
+	free(sccp.use_first);
+	free(sccp.uses);
+	free(sccp.visited_blocks);
+	free(sccp.taken_edges);
+	free(sccp.edge_worklist);
+	free(sccp.vreg_worklist);
+	return ok;
+}
@@ -0,0 +1,1189 @@
+#include "mcc/ssa.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/dominance.h"
+#include "mcc/liveness.h"
+#include "utils/reserve.h"
+
+// Replaces the instructions of `function` with the `count` instructions of
+// `instructions`, which are taken over.
+static void replace_instructions(struct mcc_ir_function *function,
+                                 struct mcc_ir_instruction *instructions,
+                                 uint32_t count)
+{
+	free(function->instructions);
+	function->instructions = instructions;
+	function->instruction_count = count;
+	function->instruction_capacity = count;
+}
+
+static bool is_terminator(enum mcc_ir_opcode opcode)
+{
+	return opcode == MCC_IR_JUMP || opcode == MCC_IR_JUMP_IF_FALSE || opcode == MCC_IR_JUMP_IF_TRUE ||
+	       opcode == MCC_IR_RETURN;
+}
+
+// ------------------------------------------------------------- Preparation
+
+// Removes NOPs and unreachable blocks and makes sure that the entry has no
+// predecessors, then builds the graph.
+static bool prepare(struct mcc_ssa *ssa)
+{
+	struct mcc_ir_function *function = ssa->function;
+	if (!mcc_cfg_build(&ssa->cfg, function)) {
+		return false;
+	}
+
+	uint32_t count = 0;
+	for (uint32_t b = 0; b < ssa->cfg.block_count; ++b) {
+		const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+		if (block->rpo_index == MCC_CFG_UNREACHABLE) {
+			continue;
+		}
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			if (function->instructions[i].opcode != MCC_IR_NOP) {
+				function->instructions[count++] = function->instructions[i];
+			}
+		}
+	}
+	function->instruction_count = count;
+
+	mcc_cfg_release(&ssa->cfg);
+	if (!mcc_cfg_build(&ssa->cfg, function)) {
+		return false;
+	}
+	if (ssa->cfg.block_count == 0 || ssa->cfg.blocks[0].predecessor_count == 0) {
+		return true;
+	}
+
+	// a NOP in front forms a block of its own, the loop header follows
+	struct mcc_ir_instruction nop = {.opcode = MCC_IR_NOP};
+	if (!mcc_ir_emit(function, &nop)) {
+		return false;
+	}
+	memmove(&function->instructions[1], &function->instructions[0],
+	        (function->instruction_count - 1) * sizeof(*function->instructions));
+	function->instructions[0] = nop;
+
+	mcc_cfg_release(&ssa->cfg);
+	return mcc_cfg_build(&ssa->cfg, function);
+}
+
+// ------------------------------------------------------------ Phi Placement
+
+struct placement {
+	const struct mcc_cfg *cfg;
+	const struct mcc_dominance *dominance;
+	const struct mcc_dataflow *live;
+
+	// blocks writing register v are
+	// def_blocks[def_block_first[v] .. def_block_first[v + 1]-1]
+	uint32_t *def_block_first;
+	uint32_t *def_blocks;
+
+	// per block: last register a phi was placed for, last register the
+	// block was queued for
+	uint32_t *has_phi;
+	uint32_t *queued;
+	uint32_t *worklist;
+
+	// number of phis per block, then their registers grouped by block
+	uint32_t *phi_first;
+	uint32_t *phi_vregs;
+	uint32_t phi_count;
+};
+
+// Collects the blocks writing each register, a counting sort. As
+// instructions are visited in order, the blocks of a register are sorted and
+// duplicates are adjacent.
+static bool collect_def_blocks(struct placement *placement, const struct mcc_ir_function *function)
+{
+	const struct mcc_cfg *cfg = placement->cfg;
+	uint32_t vreg_count = function->vreg_count;
+
+	placement->def_block_first = calloc(vreg_count + 2, sizeof(*placement->def_block_first));
+	uint32_t *last = malloc((vreg_count + 1) * sizeof(*last));
+	if (!placement->def_block_first || !last) {
+		free(last);
+		return false;
+	}
+
+	uint32_t *first = placement->def_block_first;
+	for (int pass = 0; pass < 2; ++pass) {
+		for (uint32_t v = 0; v < vreg_count; ++v) {
+			last[v] = MCC_CFG_UNREACHABLE;
+		}
+		for (uint32_t b = 0; b < cfg->block_count; ++b) {
+			for (uint32_t i = cfg->blocks[b].first; i < cfg->blocks[b].end; ++i) {
+				mcc_ir_operand def = mcc_ir_defined_vreg(&function->instructions[i]);
+				if (def == MCC_IR_NONE || last[MCC_IR_OPERAND_INDEX(def)] == b) {
+					continue;
+				}
+
+				uint32_t vreg = MCC_IR_OPERAND_INDEX(def);
+				last[vreg] = b;
+				if (pass) {
+					placement->def_blocks[first[vreg + 1]++] = b;
+				} else {
+					++first[vreg + 2];
+				}
+			}
+		}
+
+		if (pass == 0) {
+			for (uint32_t v = 0; v < vreg_count; ++v) {
+				first[v + 2] += first[v + 1];
+			}
+			placement->def_blocks = malloc((first[vreg_count + 1] + 1) * sizeof(*placement->def_blocks));
+			if (!placement->def_blocks) {
+				free(last);
+				return false;
+			}
+		}
+	}
+
+	free(last);
+	return true;
+}
+
+// Visits the iterated dominance frontier of the blocks writing `vreg`. Calls
+// with `phi_vregs` NULL count the phis per block, otherwise they are stored.
+static void place_vreg(struct placement *placement, uint32_t vreg)
+{
+	const struct mcc_dominance *dominance = placement->dominance;
+
+	uint32_t size = 0;
+	for (uint32_t i = placement->def_block_first[vreg]; i < placement->def_block_first[vreg + 1]; ++i) {
+		uint32_t b = placement->def_blocks[i];
+		placement->queued[b] = vreg;
+		placement->worklist[size++] = b;
+	}
+
+	while (size) {
+		uint32_t x = placement->worklist[--size];
+		for (uint32_t i = dominance->frontier_first[x]; i < dominance->frontier_first[x + 1]; ++i) {
+			uint32_t y = dominance->frontiers[i];
+			if (placement->has_phi[y] == vreg) {
+				continue;
+			}
+			placement->has_phi[y] = vreg;
+
+			// pruned: no phi where the register is dead, which also holds
+			// for the blocks reached from there
+			if (!MCC_BITSET_TEST(MCC_DATAFLOW_SET(placement->live, in, y), vreg)) {
+				continue;
+			}
+
+			if (placement->phi_vregs) {
+				placement->phi_vregs[placement->phi_first[y + 1]++] = vreg;
+			} else {
+				++placement->phi_first[y + 2];
+				++placement->phi_count;
+			}
+
+			if (placement->queued[y] != vreg) {
+				placement->queued[y] = vreg;
+				placement->worklist[size++] = y;
+			}
+		}
+	}
+}
+
+static bool place_phis(struct placement *placement, const struct mcc_ir_function *function)
+{
+	uint32_t block_count = placement->cfg->block_count;
+
+	placement->has_phi = malloc(block_count * sizeof(*placement->has_phi));
+	placement->queued = malloc(block_count * sizeof(*placement->queued));
+	placement->worklist = malloc(block_count * sizeof(*placement->worklist));
+	placement->phi_first = calloc(block_count + 2, sizeof(*placement->phi_first));
+	if (!placement->has_phi || !placement->queued || !placement->worklist || !placement->phi_first ||
+	    !collect_def_blocks(placement, function)) {
+		return false;
+	}
+
+	// counting pass, then the registers are grouped by block
+	for (int pass = 0; pass < 2; ++pass) {
+		for (uint32_t b = 0; b < block_count; ++b) {
+			placement->has_phi[b] = MCC_IR_OPERAND_MAX;
+			placement->queued[b] = MCC_IR_OPERAND_MAX;
+		}
+		for (uint32_t v = 0; v < function->vreg_count; ++v) {
+			place_vreg(placement, v);
+		}
+
+		if (pass == 0) {
+			for (uint32_t b = 0; b < block_count; ++b) {
+				placement->phi_first[b + 2] += placement->phi_first[b + 1];
+			}
+			placement->phi_vregs = malloc((placement->phi_count + 1) * sizeof(*placement->phi_vregs));
+			if (!placement->phi_vregs) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static void release_placement(struct placement *placement)
+{
+	free(placement->def_block_first);
+	free(placement->def_blocks);
+	free(placement->has_phi);
+	free(placement->queued);
+	free(placement->worklist);
+	free(placement->phi_first);
+	free(placement->phi_vregs);
+}
+
+// Inserts the phis after the label starting each block; their operands are
+// initialised with the register of the phi. The graph is rebuilt.
+static bool insert_phis(struct mcc_ssa *ssa, const struct placement *placement)
+{
+	struct mcc_ir_function *function = ssa->function;
+	const struct mcc_cfg *cfg = &ssa->cfg;
+
+	uint32_t count = function->instruction_count + placement->phi_count;
+	struct mcc_ir_instruction *instructions = malloc((count + 1) * sizeof(*instructions));
+	if (!instructions) {
+		return false;
+	}
+
+	uint32_t n = 0;
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		const struct mcc_cfg_block *block = &cfg->blocks[b];
+		uint32_t i = block->first;
+		if (function->instructions[i].opcode == MCC_IR_LABEL) {
+			instructions[n++] = function->instructions[i++];
+		}
+
+		for (uint32_t p = placement->phi_first[b]; p < placement->phi_first[b + 1]; ++p) {
+			uint32_t vreg = placement->phi_vregs[p];
+			uint32_t first = mcc_ir_add_phi_operands(function, block->predecessor_count);
+			if (first == MCC_IR_OPERAND_MAX) {
+				free(instructions);
+				return false;
+			}
+			for (uint32_t o = 0; o < block->predecessor_count; ++o) {
+				function->phi_operands[first + o] = MCC_IR_VREG(vreg);
+			}
+
+			instructions[n++] = (struct mcc_ir_instruction){
+			    .opcode = MCC_IR_PHI,
+			    .type = function->vreg_types[vreg],
+			    .dest = MCC_IR_VREG(vreg),
+			    .a = MCC_IR_IMM(first),
+			    .b = MCC_IR_IMM(block->predecessor_count),
+			};
+		}
+
+		for (; i < block->end; ++i) {
+			instructions[n++] = function->instructions[i];
+		}
+	}
+	assert(n == count);
+
+	replace_instructions(function, instructions, count);
+	ssa->phi_count = placement->phi_count;
+
+	// the phis do not change the blocks, only their ranges
+	uint32_t block_count = cfg->block_count;
+	mcc_cfg_release(&ssa->cfg);
+	if (!mcc_cfg_build(&ssa->cfg, function)) {
+		return false;
+	}
+	assert(ssa->cfg.block_count == block_count);
+	(void)block_count;
+	return true;
+}
+
+// ----------------------------------------------------------------- Renaming
+
+struct renaming {
+	struct mcc_ssa *ssa;
+	const struct mcc_dominance *dominance;
+
+	// current name of each original register
+	uint32_t *current;
+
+	// previous names of the registers renamed in the blocks being visited
+	uint32_t *log_vregs;
+	uint32_t *log_names;
+	uint32_t log_size;
+};
+
+static mcc_ir_operand rename_use(const struct renaming *renaming, mcc_ir_operand operand)
+{
+	if (!MCC_IR_IS_VREG(operand)) {
+		return operand;
+	}
+	assert(MCC_IR_OPERAND_INDEX(operand) < renaming->ssa->entry_vreg_count);
+	return MCC_IR_VREG(renaming->current[MCC_IR_OPERAND_INDEX(operand)]);
+}
+
+static bool rename_def(struct renaming *renaming, struct mcc_ir_instruction *instruction)
+{
+	struct mcc_ir_function *function = renaming->ssa->function;
+
+	uint32_t vreg = MCC_IR_OPERAND_INDEX(instruction->dest);
+	uint32_t name = mcc_ir_new_vreg(function, function->vreg_types[vreg]);
+	if (name == MCC_IR_OPERAND_MAX) {
+		return false;
+	}
+
+	renaming->log_vregs[renaming->log_size] = vreg;
+	renaming->log_names[renaming->log_size++] = renaming->current[vreg];
+	renaming->current[vreg] = name;
+	instruction->dest = MCC_IR_VREG(name);
+	return true;
+}
+
+static bool rename_block(struct renaming *renaming, uint32_t b)
+{
+	struct mcc_ssa *ssa = renaming->ssa;
+	struct mcc_ir_function *function = ssa->function;
+	const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+
+	for (uint32_t i = block->first; i < block->end; ++i) {
+		struct mcc_ir_instruction *instruction = &function->instructions[i];
+		if (instruction->opcode != MCC_IR_PHI) {
+			if (instruction->opcode == MCC_IR_STORE) {
+				instruction->dest = rename_use(renaming, instruction->dest);
+			}
+			instruction->a = rename_use(renaming, instruction->a);
+			instruction->b = rename_use(renaming, instruction->b);
+		}
+
+		if (mcc_ir_defined_vreg(instruction) != MCC_IR_NONE && !rename_def(renaming, instruction)) {
+			return false;
+		}
+	}
+
+	// fill in the operands of the phis in the successors; unfilled operands
+	// still hold the original register
+	for (uint32_t s = 0; s < block->successor_count; ++s) {
+		const struct mcc_cfg_block *successor = &ssa->cfg.blocks[block->successors[s]];
+
+		uint32_t edge = 0;
+		while (ssa->cfg.predecessors[successor->predecessor_first + edge] != b) {
+			++edge;
+		}
+
+		for (uint32_t i = successor->first; i < successor->end; ++i) {
+			const struct mcc_ir_instruction *phi = &function->instructions[i];
+			if (phi->opcode == MCC_IR_LABEL) {
+				continue;
+			}
+			if (phi->opcode != MCC_IR_PHI) {
+				break;
+			}
+
+			mcc_ir_operand *operand = &function->phi_operands[MCC_IR_OPERAND_INDEX(phi->a) + edge];
+			*operand = rename_use(renaming, *operand);
+		}
+	}
+	return true;
+}
+
+// Preorder walk of the dominator tree with an explicit stack. Each entry
+// holds a block, the number of its children visited so far and the size of
+// the log when the block was entered.
+static bool rename_vregs(struct renaming *renaming)
+{
+	const struct mcc_cfg *cfg = &renaming->ssa->cfg;
+	const struct mcc_dominance *dominance = renaming->dominance;
+
+	uint32_t *stack = malloc((3 * cfg->block_count + 1) * sizeof(*stack));
+	if (!stack) {
+		return false;
+	}
+
+	uint32_t depth = 0;
+	stack[depth++] = 0;
+	stack[depth++] = 0;
+	stack[depth++] = 0;
+	if (!rename_block(renaming, 0)) {
+		free(stack);
+		return false;
+	}
+
+	while (depth) {
+		uint32_t b = stack[depth - 3];
+		uint32_t next = stack[depth - 2];
+
+		if (dominance->children_first[b] + next == dominance->children_first[b + 1]) {
+			// restore the names of the block's parent
+			uint32_t mark = stack[depth - 1];
+			while (renaming->log_size > mark) {
+				--renaming->log_size;
+				renaming->current[renaming->log_vregs[renaming->log_size]] =
+				    renaming->log_names[renaming->log_size];
+			}
+			depth -= 3;
+			continue;
+		}
+
+		stack[depth - 2] = next + 1;
+		uint32_t child = dominance->children[dominance->children_first[b] + next];
+		stack[depth++] = child;
+		stack[depth++] = 0;
+		stack[depth++] = renaming->log_size;
+		if (!rename_block(renaming, child)) {
+			free(stack);
+			return false;
+		}
+	}
+
+	free(stack);
+	return true;
+}
+
+// ------------------------------------------------------------- Construction
+
+static bool rename(struct mcc_ssa *ssa, const struct mcc_dominance *dominance)
+{
+	struct mcc_ir_function *function = ssa->function;
+
+	struct renaming renaming = {
+	    .ssa = ssa,
+	    .dominance = dominance,
+	    .current = malloc((function->vreg_count + 1) * sizeof(*renaming.current)),
+	    .log_vregs = malloc((function->instruction_count + 1) * sizeof(*renaming.log_vregs)),
+	    .log_names = malloc((function->instruction_count + 1) * sizeof(*renaming.log_names)),
+	};
+
+	bool ok = renaming.current && renaming.log_vregs && renaming.log_names;
+	if (ok) {
+		for (uint32_t v = 0; v < function->vreg_count; ++v) {
+			renaming.current[v] = v;
+		}
+		ok = rename_vregs(&renaming);
+	}
+
+	free(renaming.current);
+	free(renaming.log_vregs);
+	free(renaming.log_names);
+	return ok;
+}
+
+bool mcc_ssa_construct(struct mcc_ssa *ssa, struct mcc_ir_function *function)
+{
+	assert(ssa);
+	assert(function);
+	assert(function->phi_operand_count == 0);
+
+	*ssa = (struct mcc_ssa){
+	    .function = function,
+	    .entry_vreg_count = function->vreg_count,
+	};
+
+	if (!prepare(ssa)) {
+		return false;
+	}
+
+	// every edge may be taken until proven otherwise
+	const struct mcc_cfg *cfg = &ssa->cfg;
+	ssa->executable_edges = calloc(MCC_BITSET_WORDS(2 * cfg->block_count) + 1, sizeof(*ssa->executable_edges));
+	if (!ssa->executable_edges) {
+		return false;
+	}
+	for (uint32_t b = 0; b < cfg->block_count; ++b) {
+		for (uint32_t s = 0; s < cfg->blocks[b].successor_count; ++s) {
+			MCC_BITSET_SET(ssa->executable_edges, MCC_SSA_EDGE(b, s));
+		}
+	}
+	if (cfg->block_count == 0) {
+		return true;
+	}
+
+	struct mcc_dominance dominance = {0};
+	struct mcc_dataflow live = {0};
+	struct placement placement = {.cfg = cfg, .dominance = &dominance, .live = &live};
+	bool ok = mcc_dominance_compute(&dominance, cfg) && mcc_liveness_compute(&live, cfg) &&
+	          place_phis(&placement, function) && insert_phis(ssa, &placement);
+	release_placement(&placement);
+	mcc_dataflow_release(&live);
+
+	// the rebuilt graph has the same blocks, the dominator tree still holds
+	ok = ok && rename(ssa, &dominance);
+	mcc_dominance_release(&dominance);
+	return ok;
+}
+
+// --------------------------------------------------------------- Coalescing
+
+// Registers connected through phis are merged into one register wherever
+// their values are never live at the same time, turning the copies of
+// destruction into no-ops. Liveness follows the semantics of phis: operands
+// are read at the end of the predecessors, destinations are written on entry
+// of their block. Only edges which may be taken are considered.
+
+// Largest phi web whose registers are considered; the interference matrix of
+// a web grows with the square of its size.
+#define MAX_WEB_SIZE 1024
+
+struct coalescing {
+	const struct mcc_ssa *ssa;
+
+	// phi webs, the registers which may end up merged: union-find forest
+	// whose roots are the lowest registers
+	uint32_t *webs;
+
+	// registers of webs small enough, with at least two registers
+	mcc_bitset_word *candidates;
+
+	// position of each register in its web, size of each web at its root
+	uint32_t *positions;
+	uint32_t *sizes;
+
+	// interference matrix of each web, starting at the bit offset of its root
+	size_t *offsets;
+	mcc_bitset_word *interference;
+
+	// registers merged so far: union-find forest whose roots are the lowest
+	// registers; the members of a class form a circular list
+	uint32_t *classes;
+	uint32_t *members;
+
+	struct mcc_dataflow live;
+};
+
+static uint32_t find_root(uint32_t *parents, uint32_t vreg)
+{
+	while (parents[vreg] != vreg) {
+		parents[vreg] = parents[parents[vreg]];
+		vreg = parents[vreg];
+	}
+	return vreg;
+}
+
+static void unite(uint32_t *parents, uint32_t a, uint32_t b)
+{
+	a = find_root(parents, a);
+	b = find_root(parents, b);
+	if (a < b) {
+		parents[b] = a;
+	} else {
+		parents[a] = b;
+	}
+}
+
+// Index of the edge from `b` among the predecessors of `target`.
+static uint32_t edge_index(const struct mcc_ssa *ssa, uint32_t b, uint32_t target)
+{
+	const uint32_t *predecessors = &ssa->cfg.predecessors[ssa->cfg.blocks[target].predecessor_first];
+	uint32_t edge = 0;
+	while (predecessors[edge] != b) {
+		++edge;
+	}
+	return edge;
+}
+
+// Whether the edge from predecessor `p` of block `b` may be taken.
+static bool is_executable(const struct mcc_ssa *ssa, uint32_t b, uint32_t p)
+{
+	uint32_t predecessor = ssa->cfg.predecessors[ssa->cfg.blocks[b].predecessor_first + p];
+	uint32_t s = ssa->cfg.blocks[predecessor].successors[0] == b ? 0 : 1;
+	return MCC_BITSET_TEST(ssa->executable_edges, MCC_SSA_EDGE(predecessor, s));
+}
+
+// Adds the candidates read by the phis along the edges leaving `b` which may
+// be taken to `set`, except for those in `except`.
+static void add_phi_reads(const struct coalescing *coalescing,
+                          uint32_t b,
+                          mcc_bitset_word *set,
+                          const mcc_bitset_word *except)
+{
+	const struct mcc_ssa *ssa = coalescing->ssa;
+	const struct mcc_ir_function *function = ssa->function;
+	const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+
+	for (uint32_t s = 0; s < block->successor_count; ++s) {
+		if (!MCC_BITSET_TEST(ssa->executable_edges, MCC_SSA_EDGE(b, s))) {
+			continue;
+		}
+
+		const struct mcc_cfg_block *target = &ssa->cfg.blocks[block->successors[s]];
+		uint32_t edge = edge_index(ssa, b, block->successors[s]);
+		for (uint32_t i = target->first; i < target->end; ++i) {
+			const struct mcc_ir_instruction *phi = &function->instructions[i];
+			if (phi->opcode != MCC_IR_PHI) {
+				continue;
+			}
+
+			mcc_ir_operand src = function->phi_operands[MCC_IR_OPERAND_INDEX(phi->a) + edge];
+			if (MCC_IR_IS_VREG(src) && MCC_BITSET_TEST(coalescing->candidates, MCC_IR_OPERAND_INDEX(src)) &&
+			    !(except && MCC_BITSET_TEST(except, MCC_IR_OPERAND_INDEX(src)))) {
+				MCC_BITSET_SET(set, MCC_IR_OPERAND_INDEX(src));
+			}
+		}
+	}
+}
+
+// Groups the registers into phi webs and lays out their interference
+// matrices.
+static bool collect_webs(struct coalescing *coalescing)
+{
+	const struct mcc_ssa *ssa = coalescing->ssa;
+	const struct mcc_ir_function *function = ssa->function;
+	uint32_t vreg_count = function->vreg_count;
+
+	for (uint32_t v = 0; v < vreg_count; ++v) {
+		coalescing->webs[v] = v;
+		coalescing->sizes[v] = 0;
+	}
+	for (uint32_t b = 0; b < ssa->cfg.block_count; ++b) {
+		const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			const struct mcc_ir_instruction *phi = &function->instructions[i];
+			if (phi->opcode != MCC_IR_PHI) {
+				continue;
+			}
+			for (uint32_t p = 0; p < block->predecessor_count; ++p) {
+				mcc_ir_operand src = function->phi_operands[MCC_IR_OPERAND_INDEX(phi->a) + p];
+				if (MCC_IR_IS_VREG(src) && is_executable(ssa, b, p)) {
+					unite(coalescing->webs, MCC_IR_OPERAND_INDEX(phi->dest),
+					      MCC_IR_OPERAND_INDEX(src));
+				}
+			}
+		}
+	}
+
+	for (uint32_t v = 0; v < vreg_count; ++v) {
+		uint32_t web = find_root(coalescing->webs, v);
+		coalescing->positions[v] = coalescing->sizes[web]++;
+	}
+
+	size_t bits = 0;
+	for (uint32_t v = 0; v < vreg_count; ++v) {
+		uint32_t web = coalescing->webs[v];
+		uint32_t size = coalescing->sizes[web];
+		if (size < 2 || size > MAX_WEB_SIZE) {
+			continue;
+		}
+		MCC_BITSET_SET(coalescing->candidates, v);
+		if (web == v) {
+			coalescing->offsets[v] = bits;
+			bits += (size_t)size * size;
+		}
+	}
+
+	coalescing->interference = calloc(bits / MCC_BITSET_WORD_BITS + 1, sizeof(*coalescing->interference));
+	return coalescing->interference != NULL;
+}
+
+static bool compute_liveness(struct coalescing *coalescing)
+{
+	const struct mcc_ssa *ssa = coalescing->ssa;
+	const struct mcc_ir_function *function = ssa->function;
+	struct mcc_dataflow *live = &coalescing->live;
+	if (!mcc_dataflow_init(live, &ssa->cfg, MCC_DATAFLOW_BACKWARD, MCC_DATAFLOW_UNION, function->vreg_count)) {
+		return false;
+	}
+
+	for (uint32_t b = 0; b < ssa->cfg.block_count; ++b) {
+		const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+		mcc_bitset_word *gen = MCC_DATAFLOW_SET(live, gen, b);
+		mcc_bitset_word *kill = MCC_DATAFLOW_SET(live, kill, b);
+
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			const struct mcc_ir_instruction *instruction = &function->instructions[i];
+			mcc_ir_operand uses[MCC_IR_MAX_USES];
+			uint32_t use_count = mcc_ir_used_vregs(instruction, uses);
+			for (uint32_t u = 0; u < use_count; ++u) {
+				uint32_t vreg = MCC_IR_OPERAND_INDEX(uses[u]);
+				if (MCC_BITSET_TEST(coalescing->candidates, vreg) && !MCC_BITSET_TEST(kill, vreg)) {
+					MCC_BITSET_SET(gen, vreg);
+				}
+			}
+
+			mcc_ir_operand def = mcc_ir_defined_vreg(instruction);
+			if (def != MCC_IR_NONE && MCC_BITSET_TEST(coalescing->candidates, MCC_IR_OPERAND_INDEX(def))) {
+				MCC_BITSET_SET(kill, MCC_IR_OPERAND_INDEX(def));
+			}
+		}
+		add_phi_reads(coalescing, b, gen, kill);
+	}
+
+	mcc_dataflow_solve(live, &ssa->cfg);
+	return true;
+}
+
+// Records that `vreg` is written while the registers of `live` are live.
+static void interfere(struct coalescing *coalescing, uint32_t vreg, const mcc_bitset_word *live)
+{
+	if (!MCC_BITSET_TEST(coalescing->candidates, vreg)) {
+		return;
+	}
+
+	uint32_t web = coalescing->webs[vreg];
+	size_t offset = coalescing->offsets[web];
+	uint32_t size = coalescing->sizes[web];
+	const uint32_t *positions = coalescing->positions;
+	uint32_t words = coalescing->live.word_count;
+	mcc_bitset_word *matrix = coalescing->interference;
+	for (uint32_t v = mcc_bitset_next(live, words, 0); v != MCC_BITSET_END;
+	     v = mcc_bitset_next(live, words, v + 1)) {
+		if (v != vreg && coalescing->webs[v] == web) {
+			MCC_BITSET_SET(matrix, offset + (size_t)positions[vreg] * size + positions[v]);
+			MCC_BITSET_SET(matrix, offset + (size_t)positions[v] * size + positions[vreg]);
+		}
+	}
+}
+
+// Walks each block backwards from its live out set, recording the registers
+// live at each write.
+static bool build_interference(struct coalescing *coalescing)
+{
+	const struct mcc_ssa *ssa = coalescing->ssa;
+	const struct mcc_ir_function *function = ssa->function;
+	uint32_t words = coalescing->live.word_count;
+	mcc_bitset_word *live = malloc((words + 1) * sizeof(*live));
+	if (!live) {
+		return false;
+	}
+
+	for (uint32_t b = 0; b < ssa->cfg.block_count; ++b) {
+		const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+		mcc_bitset_copy(live, MCC_DATAFLOW_SET(&coalescing->live, out, b), words);
+		add_phi_reads(coalescing, b, live, NULL);
+
+		for (uint32_t i = block->end; i-- > block->first;) {
+			const struct mcc_ir_instruction *instruction = &function->instructions[i];
+			if (instruction->opcode == MCC_IR_PHI) {
+				continue;
+			}
+
+			mcc_ir_operand def = mcc_ir_defined_vreg(instruction);
+			if (def != MCC_IR_NONE) {
+				interfere(coalescing, MCC_IR_OPERAND_INDEX(def), live);
+				MCC_BITSET_CLEAR(live, MCC_IR_OPERAND_INDEX(def));
+			}
+
+			mcc_ir_operand uses[MCC_IR_MAX_USES];
+			uint32_t use_count = mcc_ir_used_vregs(instruction, uses);
+			for (uint32_t u = 0; u < use_count; ++u) {
+				if (MCC_BITSET_TEST(coalescing->candidates, MCC_IR_OPERAND_INDEX(uses[u]))) {
+					MCC_BITSET_SET(live, MCC_IR_OPERAND_INDEX(uses[u]));
+				}
+			}
+		}
+
+		// the phis write at once, after all their reads
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			const struct mcc_ir_instruction *phi = &function->instructions[i];
+			if (phi->opcode == MCC_IR_PHI) {
+				interfere(coalescing, MCC_IR_OPERAND_INDEX(phi->dest), live);
+			}
+		}
+	}
+
+	free(live);
+	return true;
+}
+
+static bool interferes(const struct coalescing *coalescing, uint32_t a, uint32_t b)
+{
+	uint32_t web = coalescing->webs[a];
+	size_t bit = coalescing->offsets[web] + (size_t)coalescing->positions[a] * coalescing->sizes[web] +
+	             coalescing->positions[b];
+	return MCC_BITSET_TEST(coalescing->interference, bit);
+}
+
+// Merges the classes of `a` and `b` unless two of their registers interfere
+// or both hold a value on function entry.
+static void merge(struct coalescing *coalescing, uint32_t a, uint32_t b)
+{
+	if (!MCC_BITSET_TEST(coalescing->candidates, a) || !MCC_BITSET_TEST(coalescing->candidates, b)) {
+		return;
+	}
+
+	uint32_t *members = coalescing->members;
+	a = find_root(coalescing->classes, a);
+	b = find_root(coalescing->classes, b);
+	if (a == b || (a < coalescing->ssa->entry_vreg_count && b < coalescing->ssa->entry_vreg_count)) {
+		return;
+	}
+
+	uint32_t u = a;
+	do {
+		uint32_t v = b;
+		do {
+			if (interferes(coalescing, u, v)) {
+				return;
+			}
+			v = members[v];
+		} while (v != b);
+		u = members[u];
+	} while (u != a);
+
+	unite(coalescing->classes, a, b);
+	uint32_t next = members[a];
+	members[a] = members[b];
+	members[b] = next;
+}
+
+static mcc_ir_operand class_of(struct coalescing *coalescing, mcc_ir_operand operand)
+{
+	return MCC_IR_IS_VREG(operand) ? MCC_IR_VREG(find_root(coalescing->classes, MCC_IR_OPERAND_INDEX(operand)))
+	                               : operand;
+}
+
+static void coalesce_phis(struct coalescing *coalescing)
+{
+	const struct mcc_ssa *ssa = coalescing->ssa;
+	struct mcc_ir_function *function = ssa->function;
+
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		coalescing->classes[v] = v;
+		coalescing->members[v] = v;
+	}
+	for (uint32_t b = 0; b < ssa->cfg.block_count; ++b) {
+		const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+		for (uint32_t i = block->first; i < block->end; ++i) {
+			const struct mcc_ir_instruction *phi = &function->instructions[i];
+			if (phi->opcode != MCC_IR_PHI) {
+				continue;
+			}
+			for (uint32_t p = 0; p < block->predecessor_count; ++p) {
+				mcc_ir_operand src = function->phi_operands[MCC_IR_OPERAND_INDEX(phi->a) + p];
+				if (MCC_IR_IS_VREG(src) && is_executable(ssa, b, p)) {
+					merge(coalescing, MCC_IR_OPERAND_INDEX(phi->dest), MCC_IR_OPERAND_INDEX(src));
+				}
+			}
+		}
+	}
+
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		struct mcc_ir_instruction *instruction = &function->instructions[i];
+		instruction->dest = class_of(coalescing, instruction->dest);
+		instruction->a = class_of(coalescing, instruction->a);
+		instruction->b = class_of(coalescing, instruction->b);
+	}
+	for (uint32_t o = 0; o < function->phi_operand_count; ++o) {
+		function->phi_operands[o] = class_of(coalescing, function->phi_operands[o]);
+	}
+}
+
+// Merges phi operands into the register of their phi where possible.
+static bool coalesce(const struct mcc_ssa *ssa)
+{
+	uint32_t vreg_count = ssa->function->vreg_count;
+	struct coalescing coalescing = {
+	    .ssa = ssa,
+	    .webs = malloc((vreg_count + 1) * sizeof(*coalescing.webs)),
+	    .candidates = calloc(MCC_BITSET_WORDS(vreg_count) + 1, sizeof(*coalescing.candidates)),
+	    .positions = malloc((vreg_count + 1) * sizeof(*coalescing.positions)),
+	    .sizes = malloc((vreg_count + 1) * sizeof(*coalescing.sizes)),
+	    .offsets = malloc((vreg_count + 1) * sizeof(*coalescing.offsets)),
+	    .classes = malloc((vreg_count + 1) * sizeof(*coalescing.classes)),
+	    .members = malloc((vreg_count + 1) * sizeof(*coalescing.members)),
+	};
+
+	bool ok = coalescing.webs && coalescing.candidates && coalescing.positions && coalescing.sizes &&
+	          coalescing.offsets && coalescing.classes && coalescing.members && collect_webs(&coalescing) &&
+	          compute_liveness(&coalescing) && build_interference(&coalescing);
+	if (ok) {
+		coalesce_phis(&coalescing);
+	}
+
+	free(coalescing.webs);
+	free(coalescing.candidates);
+	free(coalescing.positions);
+	free(coalescing.sizes);
+	free(coalescing.offsets);
+	free(coalescing.interference);
+	free(coalescing.classes);
+	free(coalescing.members);
+	mcc_dataflow_release(&coalescing.live);
+	return ok;
+}
+
+// --------------------------------------------------------------- Destruction
+
+struct copy {
+	uint32_t dest;
+	mcc_ir_operand src;
+};
+
+struct destruction {
+	struct mcc_ssa *ssa;
+
+	// the function's new instructions
+	struct mcc_ir_instruction *instructions;
+	uint32_t count;
+	uint32_t capacity;
+
+	// blocks split off critical edges, appended to the function
+	struct mcc_ir_instruction *tail;
+	uint32_t tail_count;
+	uint32_t tail_capacity;
+
+	struct copy *copies;
+	uint32_t copy_count;
+	uint32_t copy_capacity;
+};
+
+static bool append(struct mcc_ir_instruction **instructions,
+                   uint32_t *count,
+                   uint32_t *capacity,
+                   struct mcc_ir_instruction instruction)
+{
+	if (!reserve((void **)instructions, capacity, *count, 1, sizeof(**instructions))) {
+		return false;
+	}
+
+	(*instructions)[(*count)++] = instruction;
+	return true;
+}
+
+// Collects the copies replacing the phis of `target` on its edge from `b`.
+static bool collect_copies(struct destruction *destruction, uint32_t b, uint32_t target)
+{
+	const struct mcc_ssa *ssa = destruction->ssa;
+	const struct mcc_ir_function *function = ssa->function;
+	const struct mcc_cfg_block *block = &ssa->cfg.blocks[target];
+
+	uint32_t edge = edge_index(ssa, b, target);
+
+	destruction->copy_count = 0;
+	for (uint32_t i = block->first; i < block->end; ++i) {
+		const struct mcc_ir_instruction *phi = &function->instructions[i];
+		if (phi->opcode != MCC_IR_PHI) {
+			continue;
+		}
+
+		mcc_ir_operand src = function->phi_operands[MCC_IR_OPERAND_INDEX(phi->a) + edge];
+		if (src == phi->dest) {
+			continue;
+		}
+
+		if (!reserve((void **)&destruction->copies, &destruction->copy_capacity, destruction->copy_count, 1,
+		             sizeof(*destruction->copies))) {
+			return false;
+		}
+		destruction->copies[destruction->copy_count++] = (struct copy){
+		    .dest = MCC_IR_OPERAND_INDEX(phi->dest),
+		    .src = src,
+		};
+	}
+	return true;
+}
+
+static bool is_read(const struct destruction *destruction, uint32_t vreg)
+{
+	for (uint32_t i = 0; i < destruction->copy_count; ++i) {
+		if (destruction->copies[i].src == MCC_IR_VREG(vreg)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Emits the collected copies as if all were executed at once: a copy is only
+// emitted once its destination is not read by another pending copy. Cycles
+// are broken by saving one destination in a fresh register.
+static bool emit_copies(struct destruction *destruction,
+                        struct mcc_ir_instruction **instructions,
+                        uint32_t *count,
+                        uint32_t *capacity)
+{
+	struct mcc_ir_function *function = destruction->ssa->function;
+
+	while (destruction->copy_count) {
+		uint32_t ready = 0;
+		while (ready < destruction->copy_count && is_read(destruction, destruction->copies[ready].dest)) {
+			++ready;
+		}
+
+		if (ready == destruction->copy_count) {
+			uint32_t dest = destruction->copies[0].dest;
+			uint32_t saved = mcc_ir_new_vreg(function, function->vreg_types[dest]);
+			if (saved == MCC_IR_OPERAND_MAX ||
+			    !append(instructions, count, capacity,
+			            (struct mcc_ir_instruction){.opcode = MCC_IR_COPY,
+			                                        .type = function->vreg_types[dest],
+			                                        .dest = MCC_IR_VREG(saved),
+			                                        .a = MCC_IR_VREG(dest)})) {
+				return false;
+			}
+			for (uint32_t i = 0; i < destruction->copy_count; ++i) {
+				if (destruction->copies[i].src == MCC_IR_VREG(dest)) {
+					destruction->copies[i].src = MCC_IR_VREG(saved);
+				}
+			}
+			continue;
+		}
+
+		struct copy copy = destruction->copies[ready];
+		destruction->copies[ready] = destruction->copies[--destruction->copy_count];
+		if (!append(instructions, count, capacity,
+		            (struct mcc_ir_instruction){.opcode = MCC_IR_COPY,
+		                                        .type = function->vreg_types[copy.dest],
+		                                        .dest = MCC_IR_VREG(copy.dest),
+		                                        .a = copy.src})) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Whether block `target` starts with phis.
+static bool has_phis(const struct mcc_ssa *ssa, uint32_t target)
+{
+	const struct mcc_cfg_block *block = &ssa->cfg.blocks[target];
+	for (uint32_t i = block->first; i < block->end; ++i) {
+		enum mcc_ir_opcode opcode = ssa->function->instructions[i].opcode;
+		if (opcode == MCC_IR_PHI) {
+			return true;
+		}
+		if (opcode != MCC_IR_LABEL && opcode != MCC_IR_NOP) {
+			return false;
+		}
+	}
+	return false;
+}
+
+static uint32_t label_of(const struct mcc_ssa *ssa, uint32_t target)
+{
+	const struct mcc_ir_instruction *label = &ssa->function->instructions[ssa->cfg.blocks[target].first];
+	assert(label->opcode == MCC_IR_LABEL);
+	return MCC_IR_OPERAND_INDEX(label->a);
+}
+
+// Appends a block with the copies of the edge from `b` to `target` to the
+// tail and returns its label, or MCC_IR_OPERAND_MAX.
+static uint32_t split_edge(struct destruction *destruction, uint32_t b, uint32_t target)
+{
+	uint32_t label = mcc_ir_new_label(destruction->ssa->function);
+	if (label == MCC_IR_OPERAND_MAX || !collect_copies(destruction, b, target) ||
+	    !append(&destruction->tail, &destruction->tail_count, &destruction->tail_capacity,
+	            (struct mcc_ir_instruction){.opcode = MCC_IR_LABEL, .a = MCC_IR_IMM(label)}) ||
+	    !emit_copies(destruction, &destruction->tail, &destruction->tail_count, &destruction->tail_capacity) ||
+	    !append(&destruction->tail, &destruction->tail_count, &destruction->tail_capacity,
+	            (struct mcc_ir_instruction){.opcode = MCC_IR_JUMP,
+	                                        .a = MCC_IR_IMM(label_of(destruction->ssa, target))})) {
+		return MCC_IR_OPERAND_MAX;
+	}
+	return label;
+}
+
+static bool emit(struct destruction *destruction, struct mcc_ir_instruction instruction)
+{
+	return append(&destruction->instructions, &destruction->count, &destruction->capacity, instruction);
+}
+
+static bool emit_block_copies(struct destruction *destruction)
+{
+	return emit_copies(destruction, &destruction->instructions, &destruction->count, &destruction->capacity);
+}
+
+static bool destruct_block(struct destruction *destruction, uint32_t b)
+{
+	const struct mcc_ssa *ssa = destruction->ssa;
+	const struct mcc_cfg_block *block = &ssa->cfg.blocks[b];
+	const struct mcc_ir_instruction *instructions = ssa->function->instructions;
+
+	// successors reached along executable edges which need copies
+	uint32_t executable = 0;
+	uint32_t needs_copies[2];
+	uint32_t needs_copies_count = 0;
+	for (uint32_t s = 0; s < block->successor_count; ++s) {
+		if (MCC_BITSET_TEST(ssa->executable_edges, MCC_SSA_EDGE(b, s))) {
+			++executable;
+			if (has_phis(ssa, block->successors[s])) {
+				needs_copies[needs_copies_count++] = s;
+			}
+		}
+	}
+
+	uint32_t end = block->end;
+	bool terminated = is_terminator(instructions[end - 1].opcode);
+	if (terminated) {
+		--end;
+	}
+	for (uint32_t i = block->first; i < end; ++i) {
+		if (instructions[i].opcode != MCC_IR_PHI && instructions[i].opcode != MCC_IR_NOP &&
+		    !emit(destruction, instructions[i])) {
+			return false;
+		}
+	}
+
+	// a single way out: the copies go in front of the jump
+	if (executable == 1 && needs_copies_count == 1) {
+		if (!collect_copies(destruction, b, block->successors[needs_copies[0]]) ||
+		    !emit_block_copies(destruction)) {
+			return false;
+		}
+		needs_copies_count = 0;
+	}
+	if (!terminated) {
+		assert(needs_copies_count == 0);
+		return true;
+	}
+
+	// a conditional jump to blocks with phis: split the critical edges, the
+	// fall-through continues with a jump to its split block
+	struct mcc_ir_instruction terminator = instructions[block->end - 1];
+	uint32_t fall_through = MCC_IR_OPERAND_MAX;
+	for (uint32_t i = 0; i < needs_copies_count; ++i) {
+		uint32_t s = needs_copies[i];
+		uint32_t label = split_edge(destruction, b, block->successors[s]);
+		if (label == MCC_IR_OPERAND_MAX) {
+			return false;
+		}
+
+		assert(terminator.opcode == MCC_IR_JUMP_IF_FALSE || terminator.opcode == MCC_IR_JUMP_IF_TRUE);
+		if (s == 1) {
+			terminator.b = MCC_IR_IMM(label);
+		} else {
+			fall_through = label;
+		}
+	}
+
+	if (!emit(destruction, terminator)) {
+		return false;
+	}
+	return fall_through == MCC_IR_OPERAND_MAX ||
+	       emit(destruction, (struct mcc_ir_instruction){.opcode = MCC_IR_JUMP, .a = MCC_IR_IMM(fall_through)});
+}
+
+bool mcc_ssa_destruct(struct mcc_ssa *ssa)
+{
+	assert(ssa);
+	assert(ssa->function);
+
+	struct destruction destruction = {.ssa = ssa};
+	bool ok = coalesce(ssa);
+	for (uint32_t b = 0; ok && b < ssa->cfg.block_count; ++b) {
+		ok = destruct_block(&destruction, b);
+	}
+	for (uint32_t i = 0; ok && i < destruction.tail_count; ++i) {
+		ok = emit(&destruction, destruction.tail[i]);
+	}
+
+	if (ok) {
+		replace_instructions(ssa->function, destruction.instructions, destruction.count);
+		ssa->function->instruction_capacity = destruction.capacity;
+		ssa->function->phi_operand_count = 0;
+	} else {
+		free(destruction.instructions);
+	}
+	free(destruction.tail);
+	free(destruction.copies);
+
+	mcc_ssa_release(ssa);
+	return ok;
+}
+
+void mcc_ssa_release(struct mcc_ssa *ssa)
+{
+	assert(ssa);
+
+	mcc_cfg_release(&ssa->cfg);
+	free(ssa->executable_edges);
+	*ssa = (struct mcc_ssa){0};
+}
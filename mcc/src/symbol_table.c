@@ -0,0 +1,308 @@
+#include "mcc/symbol_table.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "utils/reserve.h"
+
+#define INITIAL_ENTRIES 64
+
+// Names are interned, so the pointer identifies the name. The low bits of the
+// address carry little information due to alignment, Fibonacci hashing mixes
+// the upper ones in.
+static size_t hash_name(const char *name)
+{
+	uint64_t h = (uint64_t)(uintptr_t)name * UINT64_C(11400714819323198485);
+	return (size_t)(h >> 32);
+}
+
+static bool grow_entries(struct mcc_symbol_table *table)
+{
+	size_t capacity = table->entry_capacity ? table->entry_capacity * 2 : INITIAL_ENTRIES;
+
+	struct mcc_symbol_table_entry *entries = calloc(capacity, sizeof(*entries));
+	if (!entries) {
+		return false;
+	}
+
+	for (size_t i = 0; i < table->entry_capacity; ++i) {
+		struct mcc_symbol_table_entry *old = &table->entries[i];
+		if (!old->name) {
+			continue;
+		}
+
+		size_t slot = hash_name(old->name) & (capacity - 1);
+		while (entries[slot].name) {
+			slot = (slot + 1) & (capacity - 1);
+		}
+		entries[slot] = *old;
+	}
+
+	free(table->entries);
+	table->entries = entries;
+	table->entry_capacity = capacity;
+	return true;
+}
+
+// Entries are never removed; once all symbols of a name went out of scope the
+// entry just refers to no symbol. The number of entries is thus bounded by the
+// number of distinct names, not by the number of declarations.
+static struct mcc_symbol_table_entry *find_entry(const struct mcc_symbol_table *table, const char *name)
+{
+	if (table->entry_capacity == 0) {
+		return NULL;
+	}
+
+	size_t slot = hash_name(name) & (table->entry_capacity - 1);
+	for (;;) {
+		struct mcc_symbol_table_entry *entry = &table->entries[slot];
+		if (entry->name == name) {
+			return entry;
+		}
+		if (!entry->name) {
+			return NULL;
+		}
+		slot = (slot + 1) & (table->entry_capacity - 1);
+	}
+}
+
+static struct mcc_symbol_table_entry *find_or_add_entry(struct mcc_symbol_table *table, const char *name)
+{
+	struct mcc_symbol_table_entry *entry = find_entry(table, name);
+	if (entry) {
+		return entry;
+	}
+
+	// keep the load factor below 3/4
+	if ((table->entry_count + 1) * 4 > table->entry_capacity * 3 && !grow_entries(table)) {
+		return NULL;
+	}
+
+	size_t slot = hash_name(name) & (table->entry_capacity - 1);
+	while (table->entries[slot].name) {
+		slot = (slot + 1) & (table->entry_capacity - 1);
+	}
+
+	entry = &table->entries[slot];
+	*entry = (struct mcc_symbol_table_entry){.name = name};
+	table->entry_count++;
+	return entry;
+}
+
+// ------------------------------------------------------------------- Scopes
+
+void mcc_symbol_table_init(struct mcc_symbol_table *table)
+{
+	assert(table);
+
+	*table = (struct mcc_symbol_table){0};
+	mcc_arena_init(&table->arena);
+}
+
+void mcc_symbol_table_release(struct mcc_symbol_table *table)
+{
+	assert(table);
+
+	mcc_arena_release(&table->arena);
+	free(table->entries);
+	free(table->log);
+	free(table->scopes);
+	mcc_symbol_table_init(table);
+}
+
+bool mcc_symbol_table_push_scope(struct mcc_symbol_table *table)
+{
+	assert(table);
+
+	// `scopes` holds the start of each scope but the outermost one.
+	if (!reserve_wide((void **)&table->scopes, &table->scope_capacity, table->depth, 1, sizeof(*table->scopes))) {
+		return false;
+	}
+
+	table->scopes[table->depth++] = table->log_count;
+	return true;
+}
+
+void mcc_symbol_table_pop_scope(struct mcc_symbol_table *table)
+{
+	assert(table);
+	assert(table->depth > 0);
+
+	size_t start = table->scopes[--table->depth];
+
+	while (table->log_count > start) {
+		const struct mcc_symbol *symbol = table->log[--table->log_count];
+		struct mcc_symbol_table_entry *entry = find_entry(table, symbol->name);
+		assert(entry && entry->symbol == symbol);
+		entry->symbol = symbol->shadowed;
+	}
+}
+
+const struct mcc_symbol *const *mcc_symbol_table_scope(const struct mcc_symbol_table *table, size_t *count)
+{
+	assert(table);
+	assert(count);
+
+	size_t start = table->depth > 0 ? table->scopes[table->depth - 1] : 0;
+	*count = table->log_count - start;
+	return table->log ? &table->log[start] : NULL;
+}
+
+// ------------------------------------------------------------------- Declarations
+
+static enum mcc_symbol_table_status
+declare(struct mcc_symbol_table *table, struct mcc_symbol *proto, const struct mcc_symbol **result)
+{
+	struct mcc_symbol_table_entry *entry = find_or_add_entry(table, proto->name);
+	if (!entry) {
+		return MCC_SYMBOL_TABLE_NO_MEMORY;
+	}
+
+	if (entry->symbol && entry->symbol->depth == table->depth) {
+		if (result) {
+			*result = entry->symbol;
+		}
+		return MCC_SYMBOL_TABLE_DUPLICATE;
+	}
+
+	if (!reserve_wide((void **)&table->log, &table->log_capacity, table->log_count, 1, sizeof(*table->log))) {
+		return MCC_SYMBOL_TABLE_NO_MEMORY;
+	}
+
+	struct mcc_symbol *symbol = mcc_arena_alloc(&table->arena, sizeof(*symbol));
+	if (!symbol) {
+		return MCC_SYMBOL_TABLE_NO_MEMORY;
+	}
+
+	*symbol = *proto;
+	symbol->depth = table->depth;
+	symbol->shadowed = entry->symbol;
+
+	entry->symbol = symbol;
+	table->log[table->log_count++] = symbol;
+
+	if (result) {
+		*result = symbol;
+	}
+	return MCC_SYMBOL_TABLE_OK;
+}
+
+enum mcc_symbol_table_status mcc_symbol_table_declare_variable(struct mcc_symbol_table *table,
+                                                               enum mcc_symbol_kind kind,
+                                                               struct mcc_ast_declaration *declaration,
+                                                               const struct mcc_symbol **symbol)
+{
+	assert(table);
+	assert(kind == MCC_SYMBOL_KIND_VARIABLE || kind == MCC_SYMBOL_KIND_PARAMETER);
+	assert(declaration);
+
+	struct mcc_symbol proto = {
+	    .kind = kind,
+	    .name = declaration->identifier->i_value,
+	    .declaration = declaration,
+	};
+	return declare(table, &proto, symbol);
+}
+
+enum mcc_symbol_table_status mcc_symbol_table_declare_function(struct mcc_symbol_table *table,
+                                                               enum mcc_symbol_kind kind,
+                                                               struct mcc_ast_function_def *function_def,
+                                                               const struct mcc_symbol **symbol)
+{
+	assert(table);
+	assert(kind == MCC_SYMBOL_KIND_FUNCTION || kind == MCC_SYMBOL_KIND_BUILTIN);
+	assert(function_def);
+
+	struct mcc_symbol proto = {
+	    .kind = kind,
+	    .name = function_def->identifier->i_value,
+	    .function_def = function_def,
+	};
+	return declare(table, &proto, symbol);
+}
+
+const struct mcc_symbol *mcc_symbol_table_lookup(const struct mcc_symbol_table *table, const char *name)
+{
+	assert(table);
+	assert(name);
+
+	const struct mcc_symbol_table_entry *entry = find_entry(table, name);
+	return entry ? entry->symbol : NULL;
+}
+
+// ------------------------------------------------------------------- Built-ins
+
+static const struct builtin {
+	const char *name;
+	enum mcc_ast_data_type type;
+
+	// single parameter, unless `has_parameter` is false
+	bool has_parameter;
+	enum mcc_ast_data_type parameter_type;
+} builtins[] = {
+    {"print", MCC_AST_DATA_TYPE_VOID, true, MCC_AST_DATA_TYPE_STRING},
+    {"print_nl", MCC_AST_DATA_TYPE_VOID, false, MCC_AST_DATA_TYPE_VOID},
+    {"print_int", MCC_AST_DATA_TYPE_VOID, true, MCC_AST_DATA_TYPE_INT},
+    {"print_float", MCC_AST_DATA_TYPE_VOID, true, MCC_AST_DATA_TYPE_FLOAT},
+    {"read_int", MCC_AST_DATA_TYPE_INT, false, MCC_AST_DATA_TYPE_VOID},
+    {"read_float", MCC_AST_DATA_TYPE_FLOAT, false, MCC_AST_DATA_TYPE_VOID},
+};
+
+static struct mcc_ast_identifier *new_identifier(struct mcc_arena *arena, const char *name)
+{
+	struct mcc_ast_identifier *identifier = mcc_ast_new_identifier(arena, name);
+	if (identifier) {
+		identifier->node.sloc = (struct mcc_ast_source_location){0};
+	}
+	return identifier;
+}
+
+static struct mcc_ast_function_def *new_builtin(struct mcc_arena *arena, const struct builtin *builtin)
+{
+	struct mcc_ast_parameter *parameter = NULL;
+	if (builtin->has_parameter) {
+		struct mcc_ast_identifier *identifier = new_identifier(arena, "value");
+		struct mcc_ast_declaration *declaration =
+		    identifier ? mcc_ast_new_declaration(arena, builtin->parameter_type, NULL, identifier) : NULL;
+		parameter = declaration ? mcc_ast_new_parameter(arena, declaration) : NULL;
+		if (!parameter) {
+			return NULL;
+		}
+		declaration->node.sloc = (struct mcc_ast_source_location){0};
+		parameter->node.sloc = (struct mcc_ast_source_location){0};
+	}
+
+	struct mcc_ast_identifier *identifier = new_identifier(arena, builtin->name);
+	struct mcc_ast_statement *body = mcc_ast_new_statement_compound(arena, NULL);
+	if (!identifier || !body) {
+		return NULL;
+	}
+	body->node.sloc = (struct mcc_ast_source_location){0};
+
+	struct mcc_ast_function_def *function_def =
+	    mcc_ast_new_function_def(arena, builtin->type, identifier, parameter, body);
+	if (function_def) {
+		function_def->node.sloc = (struct mcc_ast_source_location){0};
+	}
+	return function_def;
+}
+
+enum mcc_symbol_table_status mcc_symbol_table_declare_builtins(struct mcc_symbol_table *table)
+{
+	assert(table);
+
+	for (size_t i = 0; i < sizeof(builtins) / sizeof(*builtins); ++i) {
+		struct mcc_ast_function_def *function_def = new_builtin(&table->arena, &builtins[i]);
+		if (!function_def) {
+			return MCC_SYMBOL_TABLE_NO_MEMORY;
+		}
+
+		enum mcc_symbol_table_status status =
+		    mcc_symbol_table_declare_function(table, MCC_SYMBOL_KIND_BUILTIN, function_def, NULL);
+		if (status != MCC_SYMBOL_TABLE_OK) {
+			return status;
+		}
+	}
+	return MCC_SYMBOL_TABLE_OK;
+}
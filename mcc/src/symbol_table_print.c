@@ -0,0 +1,244 @@
+#include "mcc/symbol_table_print.h"
+
+#include <assert.h>
+#include <string.h>
+
+static const char *data_type_name(enum mcc_ast_data_type type)
+{
+	switch (type) {
+	case MCC_AST_DATA_TYPE_INT:
+		return "int";
+	case MCC_AST_DATA_TYPE_STRING:
+		return "string";
+	case MCC_AST_DATA_TYPE_BOOL:
+		return "bool";
+	case MCC_AST_DATA_TYPE_FLOAT:
+		return "float";
+	case MCC_AST_DATA_TYPE_VOID:
+		return "void";
+	}
+	return "?";
+}
+
+static const char *symbol_kind_name(enum mcc_symbol_kind kind)
+{
+	switch (kind) {
+	case MCC_SYMBOL_KIND_VARIABLE:
+		return "variable";
+	case MCC_SYMBOL_KIND_PARAMETER:
+		return "parameter";
+	case MCC_SYMBOL_KIND_FUNCTION:
+		return "function";
+	case MCC_SYMBOL_KIND_BUILTIN:
+		return "builtin";
+	}
+	return "?";
+}
+
+struct print_data {
+	FILE *out;
+	struct mcc_symbol_table table;
+
+	// output is suppressed while false
+	bool enabled;
+
+	struct mcc_ast_identifier *duplicate;
+};
+
+static void print_indent(struct print_data *data)
+{
+	for (unsigned i = 0; i < data->table.depth; ++i) {
+		fputs("  ", data->out);
+	}
+}
+
+static void print_declaration_type(FILE *out, const struct mcc_ast_declaration *declaration)
+{
+	if (declaration->array_size) {
+		fprintf(out, "%s[%ld]", data_type_name(declaration->type), declaration->array_size->i_value);
+	} else {
+		fputs(data_type_name(declaration->type), out);
+	}
+}
+
+static void print_symbol(struct print_data *data, const struct mcc_symbol *symbol)
+{
+	if (!data->enabled) {
+		return;
+	}
+
+	FILE *out = data->out;
+	const struct mcc_ast_source_location *sloc;
+
+	print_indent(data);
+	fprintf(out, "  %-9s ", symbol_kind_name(symbol->kind));
+
+	if (symbol->kind == MCC_SYMBOL_KIND_FUNCTION || symbol->kind == MCC_SYMBOL_KIND_BUILTIN) {
+		const struct mcc_ast_function_def *function_def = symbol->function_def;
+		fprintf(out, "%s %s(", data_type_name(function_def->type), symbol->name);
+		for (const struct mcc_ast_parameter *p = function_def->parameter; p; p = p->next) {
+			print_declaration_type(out, p->declaration);
+			fputs(p->next ? ", " : "", out);
+		}
+		fputs(")", out);
+		sloc = &function_def->identifier->node.sloc;
+	} else {
+		print_declaration_type(out, symbol->declaration);
+		fprintf(out, " %s", symbol->name);
+		sloc = &symbol->declaration->identifier->node.sloc;
+	}
+
+	if (symbol->kind != MCC_SYMBOL_KIND_BUILTIN) {
+		fprintf(out, " at %d:%d", sloc->start_line, sloc->start_col);
+	}
+
+	const struct mcc_symbol *shadowed = symbol->shadowed;
+	if (shadowed && shadowed->kind != MCC_SYMBOL_KIND_FUNCTION && shadowed->kind != MCC_SYMBOL_KIND_BUILTIN) {
+		const struct mcc_ast_source_location *other = &shadowed->declaration->identifier->node.sloc;
+		fprintf(out, ", shadows %d:%d", other->start_line, other->start_col);
+	} else if (shadowed) {
+		fprintf(out, ", shadows %s %s", symbol_kind_name(shadowed->kind), shadowed->name);
+	}
+
+	fputs("\n", out);
+}
+
+static bool
+declare_variable(struct print_data *data, enum mcc_symbol_kind kind, struct mcc_ast_declaration *declaration)
+{
+	const struct mcc_symbol *symbol = NULL;
+	switch (mcc_symbol_table_declare_variable(&data->table, kind, declaration, &symbol)) {
+	case MCC_SYMBOL_TABLE_OK:
+		print_symbol(data, symbol);
+		return true;
+	case MCC_SYMBOL_TABLE_DUPLICATE:
+		data->duplicate = declaration->identifier;
+		return false;
+	case MCC_SYMBOL_TABLE_NO_MEMORY:
+		break;
+	}
+	return false;
+}
+
+static bool print_statement(struct print_data *data, struct mcc_ast_statement *statement);
+
+static bool print_statement_list(struct print_data *data, struct mcc_ast_statement_list *list)
+{
+	for (; list; list = list->next) {
+		if (!print_statement(data, list->statement)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool print_statement(struct print_data *data, struct mcc_ast_statement *statement)
+{
+	switch (statement->type) {
+	case MCC_AST_STATEMENT_TYPE_DECL:
+		return declare_variable(data, MCC_SYMBOL_KIND_VARIABLE, statement->declaration);
+
+	case MCC_AST_STATEMENT_TYPE_IF:
+		return print_statement(data, statement->if_stmt) &&
+		       (!statement->else_stmt || print_statement(data, statement->else_stmt));
+
+	case MCC_AST_STATEMENT_TYPE_WHILE:
+		return print_statement(data, statement->while_stmt);
+
+	case MCC_AST_STATEMENT_TYPE_COMPOUND: {
+		if (!mcc_symbol_table_push_scope(&data->table)) {
+			return false;
+		}
+		if (data->enabled) {
+			print_indent(data);
+			fprintf(data->out, "block at %d:%d\n", statement->node.sloc.start_line, statement->node.sloc.start_col);
+		}
+		bool ok = print_statement_list(data, statement->compound_statement);
+		mcc_symbol_table_pop_scope(&data->table);
+		return ok;
+	}
+
+	case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+	case MCC_AST_STATEMENT_TYPE_ASSGN:
+	case MCC_AST_STATEMENT_TYPE_RETURN:
+		break;
+	}
+	return true;
+}
+
+static bool print_function(struct print_data *data, struct mcc_ast_function_def *function_def)
+{
+	if (!mcc_symbol_table_push_scope(&data->table)) {
+		return false;
+	}
+
+	if (data->enabled) {
+		const struct mcc_ast_source_location *sloc = &function_def->node.sloc;
+		print_indent(data);
+		fprintf(data->out, "function %s at %d:%d\n", function_def->identifier->i_value, sloc->start_line,
+		        sloc->start_col);
+	}
+
+	bool ok = true;
+	for (struct mcc_ast_parameter *p = function_def->parameter; ok && p; p = p->next) {
+		ok = declare_variable(data, MCC_SYMBOL_KIND_PARAMETER, p->declaration);
+	}
+
+	// The outermost block shares the scope of the parameters.
+	if (ok) {
+		ok = print_statement_list(data, function_def->compund_statement->compound_statement);
+	}
+
+	mcc_symbol_table_pop_scope(&data->table);
+	return ok;
+}
+
+enum mcc_symbol_table_status mcc_symbol_table_print(FILE *out,
+                                                    struct mcc_ast_program *program,
+                                                    const char *function,
+                                                    struct mcc_ast_identifier **duplicate)
+{
+	assert(out);
+	assert(program);
+
+	struct print_data data = {
+	    .out = out,
+	    .enabled = !function,
+	};
+	mcc_symbol_table_init(&data.table);
+
+	enum mcc_symbol_table_status status = mcc_symbol_table_declare_builtins(&data.table);
+
+	// Functions may be called before their definition, hence all of them are
+	// declared up front.
+	for (struct mcc_ast_function_def *f = program->function_def; f && status == MCC_SYMBOL_TABLE_OK; f = f->next) {
+		status = mcc_symbol_table_declare_function(&data.table, MCC_SYMBOL_KIND_FUNCTION, f, NULL);
+		if (status == MCC_SYMBOL_TABLE_DUPLICATE) {
+			data.duplicate = f->identifier;
+		}
+	}
+
+	if (status == MCC_SYMBOL_TABLE_OK && data.enabled) {
+		fputs("global\n", out);
+
+		size_t count;
+		const struct mcc_symbol *const *symbols = mcc_symbol_table_scope(&data.table, &count);
+		for (size_t i = 0; i < count; ++i) {
+			print_symbol(&data, symbols[i]);
+		}
+	}
+
+	for (struct mcc_ast_function_def *f = program->function_def; f && status == MCC_SYMBOL_TABLE_OK; f = f->next) {
+		data.enabled = !function || strcmp(function, f->identifier->i_value) == 0;
+		if (!print_function(&data, f)) {
+			status = data.duplicate ? MCC_SYMBOL_TABLE_DUPLICATE : MCC_SYMBOL_TABLE_NO_MEMORY;
+		}
+	}
+
+	if (duplicate) {
+		*duplicate = data.duplicate;
+	}
+
+	mcc_symbol_table_release(&data.table);
+	return status;
+}
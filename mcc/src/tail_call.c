@@ -0,0 +1,316 @@
+#include "mcc/tail_call.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+enum site_kind {
+	SITE_NONE,
+	SITE_TAIL,
+	SITE_ACCUMULATED,
+};
+
+struct eliminator {
+	struct mcc_ir_module *module;
+	struct mcc_ir_function *function;
+	uint32_t function_index;
+
+	// the instructions before the rewrite
+	struct mcc_ir_instruction *instructions;
+	uint32_t instruction_count;
+
+	// number of reads of each register
+	uint32_t *use_counts;
+
+	// kind of each call and the operand accumulated by it
+	uint8_t *kinds;
+	mcc_ir_operand *operands;
+
+	// operation of the accumulated calls, MCC_IR_NOP until one is found
+	enum mcc_ir_opcode operation;
+	mcc_ir_operand accumulator;
+};
+
+// Returns the index of the next instruction after `index` other than no-ops,
+// and labels if `labels` is set.
+static uint32_t next_instruction(const struct eliminator *e, uint32_t index, bool labels)
+{
+	for (++index; index < e->instruction_count; ++index) {
+		uint8_t opcode = e->instructions[index].opcode;
+		if (opcode != MCC_IR_NOP && (!labels || opcode != MCC_IR_LABEL)) {
+			break;
+		}
+	}
+	return index;
+}
+
+static bool is_temporary(const struct eliminator *e, mcc_ir_operand operand)
+{
+	return MCC_IR_IS_VREG(operand) && e->use_counts[MCC_IR_OPERAND_INDEX(operand)] == 1;
+}
+
+// Operations which may be reordered with the type of their operands.
+static bool is_accumulating(enum mcc_ir_opcode opcode, enum mcc_ir_type type)
+{
+	switch (opcode) {
+	case MCC_IR_ADD:
+	case MCC_IR_MUL:
+		return type == MCC_IR_TYPE_INT;
+	case MCC_IR_AND:
+	case MCC_IR_OR:
+		return type == MCC_IR_TYPE_BOOL;
+	default:
+		return false;
+	}
+}
+
+// Whether the call at `index` may receive the address of a local array. The
+// jump would hand the array over to the next iteration, which reuses its
+// storage for its own arrays.
+static bool passes_local_array(const struct eliminator *e, uint32_t index)
+{
+	if (e->function->array_count == 0) {
+		return false;
+	}
+
+	const struct mcc_ir_instruction *arguments = &e->instructions[index - e->function->parameter_count];
+	for (uint32_t p = 0; p < e->function->parameter_count; ++p) {
+		if (arguments[p].type == MCC_IR_TYPE_ADDRESS) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// Classifies the call at `index`.
+static void classify(struct eliminator *e, uint32_t index)
+{
+	const struct mcc_ir_instruction *call = &e->instructions[index];
+	if (call->opcode != MCC_IR_CALL || MCC_IR_OPERAND_INDEX(call->a) != e->function_index ||
+	    passes_local_array(e, index)) {
+		return;
+	}
+
+	// the result is returned, possibly after labels
+	uint32_t next = next_instruction(e, index, true);
+	const struct mcc_ir_instruction *ret = next < e->instruction_count ? &e->instructions[next] : NULL;
+	if (ret && ret->opcode == MCC_IR_RETURN &&
+	    (call->dest == MCC_IR_NONE ? ret->a == MCC_IR_NONE : ret->a == call->dest && is_temporary(e, call->dest))) {
+		e->kinds[index] = SITE_TAIL;
+		return;
+	}
+
+	// the result is combined with another operand, then returned
+	next = next_instruction(e, index, false);
+	if (next == e->instruction_count || call->dest == MCC_IR_NONE || !is_temporary(e, call->dest)) {
+		return;
+	}
+	const struct mcc_ir_instruction *combine = &e->instructions[next];
+	next = next_instruction(e, next, false);
+	ret = next < e->instruction_count ? &e->instructions[next] : NULL;
+	if (!ret || ret->opcode != MCC_IR_RETURN || ret->a != combine->dest || !is_temporary(e, combine->dest)) {
+		return;
+	}
+	if (!is_accumulating(combine->opcode, combine->type) || combine->type != e->function->return_type ||
+	    (e->operation != MCC_IR_NOP && combine->opcode != e->operation)) {
+		return;
+	}
+
+	mcc_ir_operand operand;
+	if (combine->a == call->dest && combine->b != call->dest) {
+		operand = combine->b;
+	} else if (combine->b == call->dest && combine->a != call->dest) {
+		operand = combine->a;
+	} else {
+		return;
+	}
+
+	e->operation = combine->opcode;
+	e->kinds[index] = SITE_ACCUMULATED;
+	e->operands[index] = operand;
+}
+
+// ------------------------------------------------------------------ Rewrite
+
+static bool emit(struct mcc_ir_function *function, struct mcc_ir_instruction instruction)
+{
+	return mcc_ir_emit(function, &instruction);
+}
+
+static mcc_ir_operand identity(struct eliminator *e)
+{
+	struct mcc_ir_constant constant = {.type = e->function->return_type};
+	switch (e->operation) {
+	case MCC_IR_ADD:
+		constant.i_value = 0;
+		break;
+	case MCC_IR_MUL:
+		constant.i_value = 1;
+		break;
+	case MCC_IR_AND:
+		constant.b_value = true;
+		break;
+	default:
+		constant.b_value = false;
+	}
+
+	uint32_t index = mcc_ir_add_constant(e->module, &constant);
+	return index == MCC_IR_OPERAND_MAX ? MCC_IR_NONE : MCC_IR_CONST(index);
+}
+
+// Emits the jump replacing the call at `index`, its arguments being the
+// preceding instructions.
+static bool emit_jump(struct eliminator *e, uint32_t index, uint32_t start)
+{
+	struct mcc_ir_function *function = e->function;
+	const struct mcc_ir_instruction *arguments = &e->instructions[index - function->parameter_count];
+	bool ok = true;
+
+	if (e->kinds[index] == SITE_ACCUMULATED) {
+		ok = emit(function, (struct mcc_ir_instruction){.opcode = (uint8_t)e->operation,
+		                                                .type = function->return_type,
+		                                                .dest = e->accumulator,
+		                                                .a = e->accumulator,
+		                                                .b = e->operands[index]});
+	}
+
+	// parameters passed as other arguments are saved before being assigned
+	mcc_ir_operand *values = malloc((function->parameter_count + 1) * sizeof(*values));
+	ok = ok && values;
+	for (uint32_t p = 0; ok && p < function->parameter_count; ++p) {
+		values[p] = arguments[p].a;
+		if (!MCC_IR_IS_VREG(values[p]) || MCC_IR_OPERAND_INDEX(values[p]) >= function->parameter_count ||
+		    MCC_IR_OPERAND_INDEX(values[p]) == p) {
+			continue;
+		}
+		uint32_t saved = mcc_ir_new_vreg(function, function->vreg_types[p]);
+		ok = saved != MCC_IR_OPERAND_MAX &&
+		     emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_COPY,
+		                                                .type = arguments[p].type,
+		                                                .dest = MCC_IR_VREG(saved),
+		                                                .a = values[p]});
+		values[p] = MCC_IR_VREG(saved);
+	}
+	for (uint32_t p = 0; ok && p < function->parameter_count; ++p) {
+		if (values[p] != MCC_IR_VREG(p)) {
+			ok = emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_COPY,
+			                                                .type = arguments[p].type,
+			                                                .dest = MCC_IR_VREG(p),
+			                                                .a = values[p]});
+		}
+	}
+	free(values);
+
+	return ok && emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_JUMP, .a = MCC_IR_IMM(start)});
+}
+
+static bool rewrite(struct eliminator *e)
+{
+	struct mcc_ir_function *function = e->function;
+	uint32_t start = mcc_ir_new_label(function);
+	bool ok = start != MCC_IR_OPERAND_MAX;
+
+	// the entry block stays free of predecessors
+	struct mcc_ir_instruction entry = {.opcode = MCC_IR_NOP};
+	if (ok && e->operation != MCC_IR_NOP) {
+		uint32_t accumulator = mcc_ir_new_vreg(function, function->return_type);
+		entry = (struct mcc_ir_instruction){
+		    .opcode = MCC_IR_COPY,
+		    .type = function->return_type,
+		    .dest = MCC_IR_VREG(accumulator),
+		    .a = identity(e),
+		};
+		e->accumulator = entry.dest;
+		ok = accumulator != MCC_IR_OPERAND_MAX && entry.a != MCC_IR_NONE;
+	}
+
+	function->instructions = NULL;
+	function->instruction_count = 0;
+	function->instruction_capacity = 0;
+	ok = ok && emit(function, entry) &&
+	     emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_LABEL, .a = MCC_IR_IMM(start)});
+
+	for (uint32_t i = 0; ok && i < e->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &e->instructions[i];
+		if (instruction->opcode == MCC_IR_ARG) {
+			// arguments directly precede their call
+			uint32_t call = i;
+			while (e->instructions[call].opcode == MCC_IR_ARG) {
+				++call;
+			}
+			if (e->kinds[call] != SITE_NONE) {
+				i = call - 1;
+				continue;
+			}
+		}
+
+		if (e->kinds[i] != SITE_NONE) {
+			ok = emit_jump(e, i, start);
+		} else if (instruction->opcode == MCC_IR_RETURN && e->operation != MCC_IR_NOP) {
+			uint32_t result = mcc_ir_new_vreg(function, function->return_type);
+			ok = result != MCC_IR_OPERAND_MAX &&
+			     emit(function, (struct mcc_ir_instruction){.opcode = (uint8_t)e->operation,
+			                                                .type = function->return_type,
+			                                                .dest = MCC_IR_VREG(result),
+			                                                .a = e->accumulator,
+			                                                .b = instruction->a}) &&
+			     emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_RETURN,
+			                                                .type = instruction->type,
+			                                                .a = MCC_IR_VREG(result)});
+		} else {
+			ok = emit(function, *instruction);
+		}
+	}
+	return ok;
+}
+
+bool mcc_tail_call_eliminate(struct mcc_ir_module *module, uint32_t function, struct mcc_tail_call_stats *stats)
+{
+	assert(module);
+	assert(function < module->function_count);
+
+	struct mcc_ir_function *f = &module->functions[function];
+	struct eliminator e = {
+	    .module = module,
+	    .function = f,
+	    .function_index = function,
+	    .instructions = f->instructions,
+	    .instruction_count = f->instruction_count,
+	    .use_counts = calloc(f->vreg_count + 1, sizeof(*e.use_counts)),
+	    .kinds = calloc(f->instruction_count + 1, sizeof(*e.kinds)),
+	    .operands = malloc((f->instruction_count + 1) * sizeof(*e.operands)),
+	    .operation = MCC_IR_NOP,
+	};
+	bool ok = e.use_counts && e.kinds && e.operands;
+
+	for (uint32_t i = 0; ok && i < e.instruction_count; ++i) {
+		assert(e.instructions[i].opcode != MCC_IR_PHI);
+		mcc_ir_operand uses[MCC_IR_MAX_USES];
+		uint32_t use_count = mcc_ir_used_vregs(&e.instructions[i], uses);
+		for (uint32_t u = 0; u < use_count; ++u) {
+			++e.use_counts[MCC_IR_OPERAND_INDEX(uses[u])];
+		}
+	}
+
+	uint32_t tail_calls = 0;
+	uint32_t accumulated_calls = 0;
+	for (uint32_t i = 0; ok && i < e.instruction_count; ++i) {
+		classify(&e, i);
+		tail_calls += e.kinds[i] == SITE_TAIL;
+		accumulated_calls += e.kinds[i] == SITE_ACCUMULATED;
+	}
+
+	if (ok && tail_calls + accumulated_calls) {
+		ok = rewrite(&e);
+		free(e.instructions);
+
+		if (stats) {
+			stats->tail_calls += tail_calls;
+			stats->accumulated_calls += accumulated_calls;
+		}
+	}
+
+	free(e.use_counts);
+	free(e.kinds);
+	free(e.operands);
+	return ok;
+}
@@ -0,0 +1,721 @@
+#include "mcc/type_check.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ast_visit.h"
+#include "mcc/symbol_table.h"
+#include "utils/reserve.h"
+
+#define SCALAR(base_type) ((struct mcc_type){.base = (base_type), .array_size = -1})
+
+static const char *data_type_name(enum mcc_ast_data_type type)
+{
+	switch (type) {
+	case MCC_AST_DATA_TYPE_INT:
+		return "int";
+	case MCC_AST_DATA_TYPE_STRING:
+		return "string";
+	case MCC_AST_DATA_TYPE_BOOL:
+		return "bool";
+	case MCC_AST_DATA_TYPE_FLOAT:
+		return "float";
+	case MCC_AST_DATA_TYPE_VOID:
+		return "void";
+	}
+	return "?";
+}
+
+static const char *binary_op_name(enum mcc_ast_binary_op op)
+{
+	switch (op) {
+	case MCC_AST_BINARY_OP_ADD:
+		return "+";
+	case MCC_AST_BINARY_OP_SUB:
+		return "-";
+	case MCC_AST_BINARY_OP_MUL:
+		return "*";
+	case MCC_AST_BINARY_OP_DIV:
+		return "/";
+	case MCC_AST_BINARY_OP_AND:
+		return "&&";
+	case MCC_AST_BINARY_OP_OR:
+		return "||";
+	case MCC_AST_BINARY_OP_EQUALS:
+		return "==";
+	case MCC_AST_BINARY_OP_NOT_EQUALS:
+		return "!=";
+	case MCC_AST_BINARY_OP_LESS:
+		return "<";
+	case MCC_AST_BINARY_OP_GREATER:
+		return ">";
+	case MCC_AST_BINARY_OP_LESS_EQUALS:
+		return "<=";
+	case MCC_AST_BINARY_OP_GREATER_EQUALS:
+		return ">=";
+	}
+	return "?";
+}
+
+static const char *unary_op_name(enum mcc_ast_unary_op op)
+{
+	switch (op) {
+	case MCC_AST_UNARY_OP_NOT:
+		return "!";
+	case MCC_AST_UNARY_OP_MINUS:
+		return "-";
+	}
+	return "?";
+}
+
+int mcc_type_format(char *buf, size_t size, const struct mcc_type *type)
+{
+	assert(type);
+
+	if (type->array_size < 0) {
+		return snprintf(buf, size, "%s", data_type_name(type->base));
+	}
+	return snprintf(buf, size, "%s[%ld]", data_type_name(type->base), type->array_size);
+}
+
+static struct mcc_type declaration_type(const struct mcc_ast_declaration *declaration)
+{
+	struct mcc_type type = SCALAR(declaration->type);
+	if (declaration->array_size) {
+		type.array_size = declaration->array_size->i_value;
+	}
+	return type;
+}
+
+static bool is_scalar(const struct mcc_type *type, enum mcc_ast_data_type base)
+{
+	return type->array_size < 0 && type->base == base;
+}
+
+static bool is_numeric(const struct mcc_type *type)
+{
+	return is_scalar(type, MCC_AST_DATA_TYPE_INT) || is_scalar(type, MCC_AST_DATA_TYPE_FLOAT);
+}
+
+static bool type_equals(const struct mcc_type *a, const struct mcc_type *b)
+{
+	return a->base == b->base && a->array_size == b->array_size;
+}
+
+// ------------------------------------------------------------------- Checker
+
+struct checker {
+	struct mcc_type_check_result *result;
+	struct mcc_symbol_table table;
+
+	// shared by the traversals of all expression trees
+	struct mcc_ast_visit_stack stack;
+	struct mcc_ast_visitor visitor;
+
+	struct mcc_ast_function_def *function_def;
+};
+
+static bool ok(const struct checker *checker)
+{
+	return checker->result->status == MCC_TYPE_CHECK_OK;
+}
+
+static bool fail(struct checker *checker, const struct mcc_ast_source_location *sloc, const char *format, ...)
+{
+	struct mcc_type_check_result *result = checker->result;
+	if (result->status != MCC_TYPE_CHECK_OK) {
+		return false;
+	}
+
+	result->status = MCC_TYPE_CHECK_ERROR;
+	result->error_sloc = *sloc;
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(result->error, sizeof(result->error), format, args);
+	va_end(args);
+	return false;
+}
+
+static bool out_of_memory(struct checker *checker)
+{
+	if (ok(checker)) {
+		checker->result->status = MCC_TYPE_CHECK_NO_MEMORY;
+	}
+	return false;
+}
+
+// Formats up to two types for use in one error message.
+struct type_names {
+	char a[32];
+	char b[32];
+};
+
+static struct type_names type_names(const struct mcc_type *a, const struct mcc_type *b)
+{
+	struct type_names names = {0};
+	mcc_type_format(names.a, sizeof(names.a), a);
+	if (b) {
+		mcc_type_format(names.b, sizeof(names.b), b);
+	}
+	return names;
+}
+
+static const struct mcc_type *type_of(const struct checker *checker, const struct mcc_ast_expression *expression)
+{
+	return &checker->result->entries[expression->type_index].type;
+}
+
+static bool append(struct checker *checker, struct mcc_ast_expression *expression, struct mcc_type type)
+{
+	struct mcc_type_check_result *result = checker->result;
+
+	// entries are referred to by a 32-bit index
+	if (result->entry_count > UINT32_MAX ||
+	    !reserve_wide((void **)&result->entries, &result->entry_capacity, result->entry_count, 1,
+	                  sizeof(*result->entries))) {
+		return out_of_memory(checker);
+	}
+
+	expression->type_index = (uint32_t)result->entry_count;
+	result->entries[result->entry_count++] = (struct mcc_type_check_entry){
+	    .expression = expression,
+	    .type = type,
+	};
+	return true;
+}
+
+// Resolves `identifier` to a variable or parameter.
+static const struct mcc_ast_declaration *lookup_variable(struct checker *checker,
+                                                         const struct mcc_ast_identifier *identifier)
+{
+	const struct mcc_symbol *symbol = mcc_symbol_table_lookup(&checker->table, identifier->i_value);
+	if (!symbol) {
+		fail(checker, &identifier->node.sloc, "use of undeclared identifier '%s'", identifier->i_value);
+		return NULL;
+	}
+	if (symbol->kind == MCC_SYMBOL_KIND_FUNCTION || symbol->kind == MCC_SYMBOL_KIND_BUILTIN) {
+		fail(checker, &identifier->node.sloc, "function '%s' used as a variable", identifier->i_value);
+		return NULL;
+	}
+	return symbol->declaration;
+}
+
+// ------------------------------------------------------------------- Expressions
+
+static bool check_binary_op(struct checker *checker, struct mcc_ast_expression *expression, struct mcc_type *type)
+{
+	const struct mcc_type *lhs = type_of(checker, expression->lhs);
+	const struct mcc_type *rhs = type_of(checker, expression->rhs);
+
+	bool valid = false;
+	switch (expression->op) {
+	case MCC_AST_BINARY_OP_ADD:
+	case MCC_AST_BINARY_OP_SUB:
+	case MCC_AST_BINARY_OP_MUL:
+	case MCC_AST_BINARY_OP_DIV:
+		valid = is_numeric(lhs) && type_equals(lhs, rhs);
+		*type = *lhs;
+		break;
+
+	case MCC_AST_BINARY_OP_LESS:
+	case MCC_AST_BINARY_OP_GREATER:
+	case MCC_AST_BINARY_OP_LESS_EQUALS:
+	case MCC_AST_BINARY_OP_GREATER_EQUALS:
+		valid = is_numeric(lhs) && type_equals(lhs, rhs);
+		*type = SCALAR(MCC_AST_DATA_TYPE_BOOL);
+		break;
+
+	case MCC_AST_BINARY_OP_EQUALS:
+	case MCC_AST_BINARY_OP_NOT_EQUALS:
+		valid = (is_numeric(lhs) || is_scalar(lhs, MCC_AST_DATA_TYPE_BOOL)) && type_equals(lhs, rhs);
+		*type = SCALAR(MCC_AST_DATA_TYPE_BOOL);
+		break;
+
+	case MCC_AST_BINARY_OP_AND:
+	case MCC_AST_BINARY_OP_OR:
+		valid = is_scalar(lhs, MCC_AST_DATA_TYPE_BOOL) && is_scalar(rhs, MCC_AST_DATA_TYPE_BOOL);
+		*type = SCALAR(MCC_AST_DATA_TYPE_BOOL);
+		break;
+	}
+
+	if (!valid) {
+		struct type_names names = type_names(lhs, rhs);
+		return fail(checker, &expression->node.sloc, "invalid operands to binary '%s' (have '%s' and '%s')",
+		            binary_op_name(expression->op), names.a, names.b);
+	}
+	return true;
+}
+
+static bool check_unary_op(struct checker *checker, struct mcc_ast_expression *expression, struct mcc_type *type)
+{
+	const struct mcc_type *operand = type_of(checker, expression->rhs);
+
+	bool valid = expression->up == MCC_AST_UNARY_OP_NOT ? is_scalar(operand, MCC_AST_DATA_TYPE_BOOL)
+	                                                     : is_numeric(operand);
+	if (!valid) {
+		struct type_names names = type_names(operand, NULL);
+		return fail(checker, &expression->node.sloc, "invalid operand to unary '%s' (have '%s')",
+		            unary_op_name(expression->up), names.a);
+	}
+
+	*type = *operand;
+	return true;
+}
+
+static bool check_array_element(struct checker *checker, struct mcc_ast_expression *expression, struct mcc_type *type)
+{
+	const struct mcc_ast_declaration *declaration = lookup_variable(checker, expression->array);
+	if (!declaration) {
+		return false;
+	}
+	if (!declaration->array_size) {
+		return fail(checker, &expression->node.sloc, "subscripted value '%s' is not an array",
+		            expression->array->i_value);
+	}
+
+	const struct mcc_type *index = type_of(checker, expression->index);
+	if (!is_scalar(index, MCC_AST_DATA_TYPE_INT)) {
+		struct type_names names = type_names(index, NULL);
+		return fail(checker, &expression->index->node.sloc, "array index must be 'int' (have '%s')", names.a);
+	}
+
+	*type = SCALAR(declaration->type);
+	return true;
+}
+
+static bool check_call(struct checker *checker, struct mcc_ast_expression *expression, struct mcc_type *type)
+{
+	const char *name = expression->function->i_value;
+
+	const struct mcc_symbol *symbol = mcc_symbol_table_lookup(&checker->table, name);
+	if (!symbol) {
+		return fail(checker, &expression->node.sloc, "call to undeclared function '%s'", name);
+	}
+	if (symbol->kind != MCC_SYMBOL_KIND_FUNCTION && symbol->kind != MCC_SYMBOL_KIND_BUILTIN) {
+		return fail(checker, &expression->node.sloc, "called object '%s' is not a function", name);
+	}
+
+	const struct mcc_ast_parameter *parameter = symbol->function_def->parameter;
+	const struct mcc_ast_argument *argument = expression->arguments;
+	for (int i = 1; parameter && argument; ++i, parameter = parameter->next, argument = argument->next) {
+		struct mcc_type expected = declaration_type(parameter->declaration);
+		const struct mcc_type *actual = type_of(checker, argument->expression);
+		if (!type_equals(&expected, actual)) {
+			struct type_names names = type_names(&expected, actual);
+			return fail(checker, &argument->expression->node.sloc,
+			            "argument %d of '%s' must be '%s' (have '%s')", i, name, names.a, names.b);
+		}
+	}
+	if (parameter) {
+		return fail(checker, &expression->node.sloc, "too few arguments to function '%s'", name);
+	}
+	if (argument) {
+		return fail(checker, &expression->node.sloc, "too many arguments to function '%s'", name);
+	}
+
+	*type = SCALAR(symbol->function_def->type);
+	return true;
+}
+
+// Post-order callback: the types of all operands are known at this point.
+static void check_expression(struct mcc_ast_expression *expression, void *data)
+{
+	struct checker *checker = data;
+	if (!ok(checker)) {
+		return;
+	}
+
+	struct mcc_type type = SCALAR(MCC_AST_DATA_TYPE_VOID);
+	bool valid = false;
+
+	switch (expression->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		switch (expression->literal->type) {
+		case MCC_AST_LITERAL_TYPE_INT:
+			type.base = MCC_AST_DATA_TYPE_INT;
+			break;
+		case MCC_AST_LITERAL_TYPE_FLOAT:
+			type.base = MCC_AST_DATA_TYPE_FLOAT;
+			break;
+		case MCC_AST_LITERAL_TYPE_STRING:
+			type.base = MCC_AST_DATA_TYPE_STRING;
+			break;
+		case MCC_AST_LITERAL_TYPE_BOOL:
+			type.base = MCC_AST_DATA_TYPE_BOOL;
+			break;
+		}
+		valid = true;
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		valid = check_binary_op(checker, expression, &type);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		valid = check_unary_op(checker, expression, &type);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		type = *type_of(checker, expression->expression);
+		valid = true;
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER: {
+		const struct mcc_ast_declaration *declaration = lookup_variable(checker, expression->identifier);
+		if (declaration) {
+			type = declaration_type(declaration);
+			valid = true;
+		}
+		break;
+	}
+
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+		valid = check_array_element(checker, expression, &type);
+		break;
+
+	case MCC_AST_EXPRESSION_TYPE_CALL:
+		valid = check_call(checker, expression, &type);
+		break;
+
+	case MCC_AST_STATEMENT_TYPE_EXPR:
+		valid = fail(checker, &expression->node.sloc, "invalid expression");
+		break;
+	}
+
+	if (valid) {
+		append(checker, expression, type);
+	}
+}
+
+// Types the tree rooted at `expression`, returns its type or NULL on error.
+static const struct mcc_type *check_expression_tree(struct checker *checker, struct mcc_ast_expression *expression)
+{
+	if (!mcc_ast_visit(expression, &checker->visitor)) {
+		out_of_memory(checker);
+	}
+	return ok(checker) ? type_of(checker, expression) : NULL;
+}
+
+// ------------------------------------------------------------------- Statements
+
+static bool check_condition(struct checker *checker, struct mcc_ast_expression *condition)
+{
+	const struct mcc_type *type = check_expression_tree(checker, condition);
+	if (!type) {
+		return false;
+	}
+	if (!is_scalar(type, MCC_AST_DATA_TYPE_BOOL)) {
+		struct type_names names = type_names(type, NULL);
+		return fail(checker, &condition->node.sloc, "condition must be 'bool' (have '%s')", names.a);
+	}
+	return true;
+}
+
+static bool
+declare_variable(struct checker *checker, enum mcc_symbol_kind kind, struct mcc_ast_declaration *declaration)
+{
+	switch (mcc_symbol_table_declare_variable(&checker->table, kind, declaration, NULL)) {
+	case MCC_SYMBOL_TABLE_OK:
+		return true;
+	case MCC_SYMBOL_TABLE_DUPLICATE:
+		return fail(checker, &declaration->identifier->node.sloc, "redeclaration of '%s'",
+		            declaration->identifier->i_value);
+	case MCC_SYMBOL_TABLE_NO_MEMORY:
+		break;
+	}
+	return out_of_memory(checker);
+}
+
+static bool check_assignment(struct checker *checker, struct mcc_ast_statement *statement)
+{
+	const struct mcc_ast_declaration *declaration = lookup_variable(checker, statement->id_assgn);
+	if (!declaration) {
+		return false;
+	}
+
+	struct mcc_type target = declaration_type(declaration);
+	if (statement->lhs_assgn) {
+		if (target.array_size < 0) {
+			return fail(checker, &statement->node.sloc, "subscripted value '%s' is not an array",
+			            statement->id_assgn->i_value);
+		}
+
+		const struct mcc_type *index = check_expression_tree(checker, statement->lhs_assgn);
+		if (!index) {
+			return false;
+		}
+		if (!is_scalar(index, MCC_AST_DATA_TYPE_INT)) {
+			struct type_names names = type_names(index, NULL);
+			return fail(checker, &statement->lhs_assgn->node.sloc, "array index must be 'int' (have '%s')",
+			            names.a);
+		}
+		target.array_size = -1;
+	} else if (target.array_size >= 0) {
+		return fail(checker, &statement->node.sloc, "assignment to array '%s'", statement->id_assgn->i_value);
+	}
+
+	const struct mcc_type *value = check_expression_tree(checker, statement->rhs_assgn);
+	if (!value) {
+		return false;
+	}
+	if (!type_equals(&target, value)) {
+		struct type_names names = type_names(value, &target);
+		return fail(checker, &statement->rhs_assgn->node.sloc, "cannot assign '%s' to '%s' of type '%s'", names.a,
+		            statement->id_assgn->i_value, names.b);
+	}
+	return true;
+}
+
+static bool check_return(struct checker *checker, struct mcc_ast_statement *statement)
+{
+	const struct mcc_ast_function_def *function_def = checker->function_def;
+	const char *name = function_def->identifier->i_value;
+
+	if (!statement->return_value) {
+		if (function_def->type != MCC_AST_DATA_TYPE_VOID) {
+			return fail(checker, &statement->node.sloc, "non-void function '%s' should return a value", name);
+		}
+		return true;
+	}
+
+	const struct mcc_type *value = check_expression_tree(checker, statement->return_value);
+	if (!value) {
+		return false;
+	}
+	if (function_def->type == MCC_AST_DATA_TYPE_VOID) {
+		return fail(checker, &statement->return_value->node.sloc, "void function '%s' should not return a value",
+		            name);
+	}
+
+	struct mcc_type expected = SCALAR(function_def->type);
+	if (!type_equals(&expected, value)) {
+		struct type_names names = type_names(value, &expected);
+		return fail(checker, &statement->return_value->node.sloc,
+		            "returning '%s' from function '%s' with return type '%s'", names.a, name, names.b);
+	}
+	return true;
+}
+
+static bool check_statement(struct checker *checker, struct mcc_ast_statement *statement);
+
+static bool check_statement_list(struct checker *checker, struct mcc_ast_statement_list *list)
+{
+	for (; list; list = list->next) {
+		if (!check_statement(checker, list->statement)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool check_statement(struct checker *checker, struct mcc_ast_statement *statement)
+{
+	switch (statement->type) {
+	case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+		return check_expression_tree(checker, statement->expression) != NULL;
+
+	case MCC_AST_STATEMENT_TYPE_IF:
+		return check_condition(checker, statement->if_condition) && check_statement(checker, statement->if_stmt) &&
+		       (!statement->else_stmt || check_statement(checker, statement->else_stmt));
+
+	case MCC_AST_STATEMENT_TYPE_WHILE:
+		return check_condition(checker, statement->while_condition) &&
+		       check_statement(checker, statement->while_stmt);
+
+	case MCC_AST_STATEMENT_TYPE_DECL:
+		return declare_variable(checker, MCC_SYMBOL_KIND_VARIABLE, statement->declaration);
+
+	case MCC_AST_STATEMENT_TYPE_ASSGN:
+		return check_assignment(checker, statement);
+
+	case MCC_AST_STATEMENT_TYPE_COMPOUND: {
+		if (!mcc_symbol_table_push_scope(&checker->table)) {
+			return out_of_memory(checker);
+		}
+		bool valid = check_statement_list(checker, statement->compound_statement);
+		mcc_symbol_table_pop_scope(&checker->table);
+		return valid;
+	}
+
+	case MCC_AST_STATEMENT_TYPE_RETURN:
+		return check_return(checker, statement);
+	}
+	return true;
+}
+
+// ------------------------------------------------------------------- Functions
+
+static bool add_function(struct checker *checker, struct mcc_ast_function_def *function_def)
+{
+	struct mcc_type_check_result *result = checker->result;
+
+	if (!reserve_wide((void **)&result->functions, &result->function_capacity, result->function_count, 1,
+	                  sizeof(*result->functions))) {
+		return out_of_memory(checker);
+	}
+
+	result->functions[result->function_count++] = (struct mcc_type_check_function){
+	    .function_def = function_def,
+	    .first = result->entry_count,
+	};
+	return true;
+}
+
+static bool check_function(struct checker *checker, struct mcc_ast_function_def *function_def)
+{
+	if (!add_function(checker, function_def)) {
+		return false;
+	}
+	if (!mcc_symbol_table_push_scope(&checker->table)) {
+		return out_of_memory(checker);
+	}
+	checker->function_def = function_def;
+
+	bool valid = true;
+	for (struct mcc_ast_parameter *p = function_def->parameter; valid && p; p = p->next) {
+		valid = declare_variable(checker, MCC_SYMBOL_KIND_PARAMETER, p->declaration);
+	}
+
+	// The outermost block shares the scope of the parameters.
+	if (valid) {
+		valid = check_statement_list(checker, function_def->compund_statement->compound_statement);
+	}
+
+	mcc_symbol_table_pop_scope(&checker->table);
+
+	struct mcc_type_check_function *function = &checker->result->functions[checker->result->function_count - 1];
+	function->count = checker->result->entry_count - function->first;
+	return valid;
+}
+
+struct mcc_type_check_result mcc_type_check(struct mcc_ast_program *program)
+{
+	assert(program);
+
+	struct mcc_type_check_result result = {.status = MCC_TYPE_CHECK_OK};
+
+	struct checker checker = {
+	    .result = &result,
+	    .visitor =
+	        {
+	            .traversal = MCC_AST_VISIT_DEPTH_FIRST,
+	            .order = MCC_AST_VISIT_POST_ORDER,
+	            .expression = check_expression,
+	        },
+	};
+	checker.visitor.stack = &checker.stack;
+	checker.visitor.userdata = &checker;
+	mcc_symbol_table_init(&checker.table);
+
+	if (mcc_symbol_table_declare_builtins(&checker.table) != MCC_SYMBOL_TABLE_OK) {
+		out_of_memory(&checker);
+	}
+
+	// Functions may be called before their definition, hence all of them are
+	// declared up front.
+	for (struct mcc_ast_function_def *f = program->function_def; f && ok(&checker); f = f->next) {
+		switch (mcc_symbol_table_declare_function(&checker.table, MCC_SYMBOL_KIND_FUNCTION, f, NULL)) {
+		case MCC_SYMBOL_TABLE_OK:
+			break;
+		case MCC_SYMBOL_TABLE_DUPLICATE:
+			fail(&checker, &f->identifier->node.sloc, "redefinition of function '%s'", f->identifier->i_value);
+			break;
+		case MCC_SYMBOL_TABLE_NO_MEMORY:
+			out_of_memory(&checker);
+			break;
+		}
+	}
+
+	for (struct mcc_ast_function_def *f = program->function_def; f && ok(&checker); f = f->next) {
+		check_function(&checker, f);
+	}
+
+	mcc_ast_visit_stack_release(&checker.stack);
+	mcc_symbol_table_release(&checker.table);
+	return result;
+}
+
+void mcc_type_check_delete_result(struct mcc_type_check_result *result)
+{
+	assert(result);
+
+	free(result->entries);
+	free(result->functions);
+	*result = (struct mcc_type_check_result){0};
+}
+
+const struct mcc_type *mcc_type_check_type_of(const struct mcc_type_check_result *result,
+                                              const struct mcc_ast_expression *expression)
+{
+	assert(result);
+	assert(expression);
+	assert(expression->type_index < result->entry_count);
+	assert(result->entries[expression->type_index].expression == expression);
+
+	return &result->entries[expression->type_index].type;
+}
+
+// ------------------------------------------------------------------- Trace
+
+static void print_entry(FILE *out, const struct mcc_type_check_entry *entry)
+{
+	const struct mcc_ast_expression *expression = entry->expression;
+
+	char location[32];
+	snprintf(location, sizeof(location), "%d:%d", expression->node.sloc.start_line,
+	         expression->node.sloc.start_col);
+
+	char type[32];
+	mcc_type_format(type, sizeof(type), &entry->type);
+
+	fprintf(out, "  %-7s %-10s ", location, type);
+
+	switch (expression->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		fputs("literal\n", out);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		fprintf(out, "binary %s\n", binary_op_name(expression->op));
+		break;
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		fprintf(out, "unary %s\n", unary_op_name(expression->up));
+		break;
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		fputs("parenthesis\n", out);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+		fprintf(out, "identifier %s\n", expression->identifier->i_value);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+		fprintf(out, "element %s\n", expression->array->i_value);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_CALL:
+		fprintf(out, "call %s\n", expression->function->i_value);
+		break;
+	case MCC_AST_STATEMENT_TYPE_EXPR:
+		fputs("?\n", out);
+		break;
+	}
+}
+
+void mcc_type_check_trace(FILE *out, const struct mcc_type_check_result *result, const char *function)
+{
+	assert(out);
+	assert(result);
+
+	for (size_t i = 0; i < result->function_count; ++i) {
+		const struct mcc_type_check_function *f = &result->functions[i];
+		const char *name = f->function_def->identifier->i_value;
+		if (function && strcmp(function, name) != 0) {
+			continue;
+		}
+
+		fprintf(out, "function %s\n", name);
+		for (size_t j = f->first; j < f->first + f->count; ++j) {
+			print_entry(out, &result->entries[j]);
+		}
+	}
+}
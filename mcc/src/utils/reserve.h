@@ -0,0 +1,87 @@
+#ifndef MCC_UTILS_RESERVE_H
+#define MCC_UTILS_RESERVE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Growable arrays are a pointer, a count, and a capacity, all in elements.
+// These functions grow `*array` (of `*capacity` elements of `size` bytes) so
+// that it can hold at least `count + extra` elements, doubling the capacity,
+// starting at RESERVE_INITIAL_CAPACITY, as often as needed. They fail if that
+// takes more elements than the capacity can express or memory runs out;
+// `*array` and `*capacity` are left untouched in that case.
+
+#define RESERVE_INITIAL_CAPACITY 16
+
+// Returns the capacity `capacity` grows to for holding `needed` elements, or 0
+// if that exceeds `limit`.
+static inline uint64_t reserve_grown_capacity(uint64_t capacity, uint64_t needed, uint64_t limit)
+{
+	uint64_t grown = capacity ? capacity : RESERVE_INITIAL_CAPACITY;
+	while (grown < needed && grown <= limit / 2) {
+		grown *= 2;
+	}
+	return grown >= needed && grown <= limit ? grown : 0;
+}
+
+static inline bool reserve_realloc(void **array, uint64_t capacity, size_t size)
+{
+	if (capacity == 0) {
+		return false;
+	}
+
+	void *new_array = realloc(*array, (size_t)capacity * size);
+	if (!new_array) {
+		return false;
+	}
+
+	*array = new_array;
+	return true;
+}
+
+// As reserve, for capacities of type size_t.
+static inline bool reserve_wide(void **array, size_t *capacity, size_t count, size_t extra, size_t size)
+{
+	if (extra <= *capacity - count) {
+		return true;
+	}
+	if (extra > SIZE_MAX - count) {
+		return false;
+	}
+
+	uint64_t grown = reserve_grown_capacity(*capacity, (uint64_t)count + extra, SIZE_MAX / size);
+	if (!reserve_realloc(array, grown, size)) {
+		return false;
+	}
+
+	*capacity = (size_t)grown;
+	return true;
+}
+
+// As reserve, but keeps the capacity at or below `limit`, so that indices
+// into the array fit in a narrower field.
+static inline bool
+reserve_bounded(void **array, uint32_t *capacity, uint32_t count, uint32_t extra, size_t size, uint32_t limit)
+{
+	if (extra <= *capacity - count) {
+		return true;
+	}
+
+	uint64_t grown = reserve_grown_capacity(*capacity, (uint64_t)count + extra,
+	                                        limit < SIZE_MAX / size ? limit : SIZE_MAX / size);
+	if (!reserve_realloc(array, grown, size)) {
+		return false;
+	}
+
+	*capacity = (uint32_t)grown;
+	return true;
+}
+
+static inline bool reserve(void **array, uint32_t *capacity, uint32_t count, uint32_t extra, size_t size)
+{
+	return reserve_bounded(array, capacity, count, extra, size, UINT32_MAX);
+}
+
+#endif // MCC_UTILS_RESERVE_H
@@ -0,0 +1,455 @@
+#include "mcc/vectorize.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "mcc/bitset.h"
+
+// A loop of the shape given in the header, by instruction indices.
+struct loop {
+	uint32_t header;
+
+	// first instruction of the increment of the counter, up to the back jump
+	uint32_t increment;
+	uint32_t back_jump;
+
+	mcc_ir_operand counter;
+	int32_t bound;
+};
+
+struct splat {
+	mcc_ir_operand scalar;
+	mcc_ir_operand vector;
+};
+
+struct vectorizer {
+	struct mcc_ir_module *module;
+	struct mcc_ir_function *function;
+
+	// the instructions before vectorization
+	struct mcc_ir_instruction *instructions;
+	uint32_t instruction_count;
+	uint32_t vreg_count;
+
+	// registers written in the loop, and those written so far in its body
+	mcc_bitset_word *loop_defined;
+	mcc_bitset_word *body_defined;
+	uint32_t words;
+
+	// vector register of each register of the body being emitted, and the
+	// splats of its loop-invariant operands
+	uint32_t *vectors;
+	struct splat *splats;
+	uint32_t splat_count;
+};
+
+static bool is_int_constant(const struct vectorizer *v, mcc_ir_operand operand, long value)
+{
+	if (MCC_IR_OPERAND_KIND(operand) != MCC_IR_OPERAND_CONST) {
+		return false;
+	}
+	const struct mcc_ir_constant *constant = &v->module->constants[MCC_IR_OPERAND_INDEX(operand)];
+	return constant->type == MCC_IR_TYPE_INT && constant->i_value == value;
+}
+
+static bool has_vector_type(enum mcc_ir_type type)
+{
+	return type == MCC_IR_TYPE_INT || type == MCC_IR_TYPE_FLOAT;
+}
+
+static enum mcc_ir_type vector_type(enum mcc_ir_type type)
+{
+	return type == MCC_IR_TYPE_INT ? MCC_IR_TYPE_INT4 : MCC_IR_TYPE_FLOAT4;
+}
+
+// ------------------------------------------------------------------ Analysis
+
+// Matches the loop with the header label at `header`.
+static bool match_loop(const struct vectorizer *v, uint32_t header, struct loop *loop)
+{
+	const struct mcc_ir_instruction *instructions = v->instructions;
+	if (header + 3 >= v->instruction_count) {
+		return false;
+	}
+
+	const struct mcc_ir_instruction *compare = &instructions[header + 1];
+	const struct mcc_ir_instruction *branch = &instructions[header + 2];
+	if (compare->opcode != MCC_IR_LT || compare->type != MCC_IR_TYPE_INT || !MCC_IR_IS_VREG(compare->a) ||
+	    MCC_IR_OPERAND_KIND(compare->b) != MCC_IR_OPERAND_CONST) {
+		return false;
+	}
+	const struct mcc_ir_constant *bound = &v->module->constants[MCC_IR_OPERAND_INDEX(compare->b)];
+	if (bound->type != MCC_IR_TYPE_INT || bound->i_value < MCC_IR_VECTOR_LANES || bound->i_value > INT32_MAX) {
+		return false;
+	}
+	if (branch->opcode != MCC_IR_JUMP_IF_FALSE || branch->a != compare->dest) {
+		return false;
+	}
+
+	// a straight-line body up to the jump back
+	uint32_t back_jump = header + 3;
+	for (;; ++back_jump) {
+		if (back_jump == v->instruction_count) {
+			return false;
+		}
+		const struct mcc_ir_instruction *instruction = &instructions[back_jump];
+		if (instruction->opcode == MCC_IR_JUMP && instruction->a == instructions[header].a) {
+			break;
+		}
+		switch (instruction->opcode) {
+		case MCC_IR_PHI:
+		case MCC_IR_LABEL:
+		case MCC_IR_JUMP:
+		case MCC_IR_JUMP_IF_FALSE:
+		case MCC_IR_JUMP_IF_TRUE:
+		case MCC_IR_ARG:
+		case MCC_IR_CALL:
+		case MCC_IR_RETURN:
+			return false;
+		default:
+			break;
+		}
+	}
+
+	*loop = (struct loop){
+	    .header = header,
+	    .back_jump = back_jump,
+	    .counter = compare->a,
+	    .bound = (int32_t)bound->i_value,
+	};
+
+	// the increment ends the body, going back through the copies
+	mcc_ir_operand expected = loop->counter;
+	for (uint32_t i = back_jump; i-- > header + 3;) {
+		const struct mcc_ir_instruction *instruction = &instructions[i];
+		if (instruction->dest != expected) {
+			return false;
+		}
+		if (instruction->opcode == MCC_IR_COPY && MCC_IR_IS_VREG(instruction->a) &&
+		    instruction->a != loop->counter) {
+			expected = instruction->a;
+			continue;
+		}
+		if (instruction->opcode == MCC_IR_ADD && instruction->type == MCC_IR_TYPE_INT &&
+		    instruction->a == loop->counter && is_int_constant(v, instruction->b, 1)) {
+			loop->increment = i;
+			return true;
+		}
+		return false;
+	}
+	return false;
+}
+
+// Constants and registers not written in the loop.
+static bool is_invariant(const struct vectorizer *v, mcc_ir_operand operand)
+{
+	switch (MCC_IR_OPERAND_KIND(operand)) {
+	case MCC_IR_OPERAND_CONST:
+		return has_vector_type(v->module->constants[MCC_IR_OPERAND_INDEX(operand)].type);
+	case MCC_IR_OPERAND_VREG:
+		return !MCC_BITSET_TEST(v->loop_defined, MCC_IR_OPERAND_INDEX(operand));
+	default:
+		return false;
+	}
+}
+
+static bool is_invariant_address(const struct vectorizer *v, mcc_ir_operand operand)
+{
+	return MCC_IR_IS_VREG(operand) && is_invariant(v, operand);
+}
+
+// Loop-invariant operands or values computed earlier in the same iteration.
+static bool is_value(const struct vectorizer *v, const struct loop *loop, mcc_ir_operand operand)
+{
+	if (operand == loop->counter) {
+		return false;
+	}
+	return is_invariant(v, operand) ||
+	       (MCC_IR_IS_VREG(operand) && MCC_BITSET_TEST(v->body_defined, MCC_IR_OPERAND_INDEX(operand)));
+}
+
+static bool check_instruction(const struct vectorizer *v,
+                              const struct loop *loop,
+                              const struct mcc_ir_instruction *instruction)
+{
+	enum mcc_ir_type type = instruction->type;
+
+	switch (instruction->opcode) {
+	case MCC_IR_NOP:
+		return true;
+	case MCC_IR_LOAD:
+		return has_vector_type(type) && is_invariant_address(v, instruction->a) &&
+		       instruction->b == loop->counter;
+	case MCC_IR_STORE:
+		return has_vector_type(type) && is_invariant_address(v, instruction->dest) &&
+		       instruction->a == loop->counter && is_value(v, loop, instruction->b);
+	case MCC_IR_COPY:
+		return has_vector_type(type) && is_value(v, loop, instruction->a);
+	case MCC_IR_ADD:
+	case MCC_IR_SUB:
+		return has_vector_type(type) && is_value(v, loop, instruction->a) && is_value(v, loop, instruction->b);
+	case MCC_IR_MUL:
+	case MCC_IR_DIV:
+		return type == MCC_IR_TYPE_FLOAT && is_value(v, loop, instruction->a) &&
+		       is_value(v, loop, instruction->b);
+	default:
+		return false;
+	}
+}
+
+static bool check_loop(struct vectorizer *v, const struct loop *loop)
+{
+	const struct mcc_ir_instruction *instructions = v->instructions;
+
+	mcc_bitset_clear_all(v->loop_defined, v->words);
+	mcc_bitset_clear_all(v->body_defined, v->words);
+	for (uint32_t i = loop->header; i < loop->back_jump; ++i) {
+		mcc_ir_operand def = mcc_ir_defined_vreg(&instructions[i]);
+		if (def != MCC_IR_NONE) {
+			MCC_BITSET_SET(v->loop_defined, MCC_IR_OPERAND_INDEX(def));
+		}
+	}
+
+	bool stores = false;
+	for (uint32_t i = loop->header + 3; i < loop->increment; ++i) {
+		const struct mcc_ir_instruction *instruction = &instructions[i];
+		if (!check_instruction(v, loop, instruction)) {
+			return false;
+		}
+		stores |= instruction->opcode == MCC_IR_STORE;
+
+		mcc_ir_operand def = mcc_ir_defined_vreg(instruction);
+		if (def == loop->counter) {
+			return false;
+		}
+		if (def != MCC_IR_NONE) {
+			MCC_BITSET_SET(v->body_defined, MCC_IR_OPERAND_INDEX(def));
+		}
+	}
+
+	// the values of the body are not read anywhere else
+	for (uint32_t i = 0; i < v->instruction_count; ++i) {
+		if (i == loop->header + 3) {
+			i = loop->increment;
+		}
+		mcc_ir_operand uses[MCC_IR_MAX_USES];
+		uint32_t use_count = mcc_ir_used_vregs(&instructions[i], uses);
+		for (uint32_t u = 0; u < use_count; ++u) {
+			if (MCC_BITSET_TEST(v->body_defined, MCC_IR_OPERAND_INDEX(uses[u]))) {
+				return false;
+			}
+		}
+	}
+	return stores;
+}
+
+// ------------------------------------------------------------------ Emission
+
+static bool emit(struct vectorizer *v, struct mcc_ir_instruction instruction)
+{
+	return mcc_ir_emit(v->function, &instruction);
+}
+
+static mcc_ir_operand new_vreg(struct vectorizer *v, enum mcc_ir_type type)
+{
+	uint32_t vreg = mcc_ir_new_vreg(v->function, type);
+	return vreg == MCC_IR_OPERAND_MAX ? MCC_IR_NONE : MCC_IR_VREG(vreg);
+}
+
+static mcc_ir_operand int_constant(struct vectorizer *v, int32_t value)
+{
+	struct mcc_ir_constant constant = {.type = MCC_IR_TYPE_INT, .i_value = value};
+	uint32_t index = mcc_ir_add_constant(v->module, &constant);
+	return index == MCC_IR_OPERAND_MAX ? MCC_IR_NONE : MCC_IR_CONST(index);
+}
+
+// Emits the splat of a loop-invariant operand, once per loop.
+static bool emit_splat(struct vectorizer *v, mcc_ir_operand operand, enum mcc_ir_type type)
+{
+	for (uint32_t i = 0; i < v->splat_count; ++i) {
+		if (v->splats[i].scalar == operand) {
+			return true;
+		}
+	}
+
+	mcc_ir_operand vector = new_vreg(v, vector_type(type));
+	v->splats[v->splat_count++] = (struct splat){.scalar = operand, .vector = vector};
+	return vector != MCC_IR_NONE &&
+	       emit(v, (struct mcc_ir_instruction){
+	                   .opcode = MCC_IR_SPLAT, .type = vector_type(type), .dest = vector, .a = operand});
+}
+
+// Returns the vector holding `operand`, creating one for registers written.
+static mcc_ir_operand vector_of(struct vectorizer *v, mcc_ir_operand operand, enum mcc_ir_type type)
+{
+	if (is_invariant(v, operand)) {
+		for (uint32_t i = 0; i < v->splat_count; ++i) {
+			if (v->splats[i].scalar == operand) {
+				return v->splats[i].vector;
+			}
+		}
+		assert(false);
+	}
+
+	uint32_t index = MCC_IR_OPERAND_INDEX(operand);
+	if (v->vectors[index] == MCC_IR_OPERAND_MAX) {
+		mcc_ir_operand vector = new_vreg(v, vector_type(type));
+		if (vector == MCC_IR_NONE) {
+			return MCC_IR_NONE;
+		}
+		v->vectors[index] = MCC_IR_OPERAND_INDEX(vector);
+	}
+	return MCC_IR_VREG(v->vectors[index]);
+}
+
+// Emits the vector form of an instruction of the body.
+static bool emit_vector(struct vectorizer *v, const struct mcc_ir_instruction *instruction)
+{
+	enum mcc_ir_type type = instruction->type;
+	struct mcc_ir_instruction vector = {.opcode = instruction->opcode, .type = vector_type(type)};
+
+	switch (instruction->opcode) {
+	case MCC_IR_NOP:
+		return true;
+	case MCC_IR_LOAD:
+		vector.opcode = MCC_IR_VLOAD;
+		vector.dest = vector_of(v, instruction->dest, type);
+		vector.a = instruction->a;
+		vector.b = instruction->b;
+		return vector.dest != MCC_IR_NONE && emit(v, vector);
+	case MCC_IR_STORE:
+		vector.opcode = MCC_IR_VSTORE;
+		vector.dest = instruction->dest;
+		vector.a = instruction->a;
+		vector.b = vector_of(v, instruction->b, type);
+		return vector.b != MCC_IR_NONE && emit(v, vector);
+	default:
+		vector.dest = vector_of(v, instruction->dest, type);
+		vector.a = vector_of(v, instruction->a, type);
+		vector.b = instruction->b == MCC_IR_NONE ? MCC_IR_NONE : vector_of(v, instruction->b, type);
+		return vector.dest != MCC_IR_NONE && vector.a != MCC_IR_NONE && vector.b != MCC_IR_NONE &&
+		       emit(v, vector);
+	}
+}
+
+// Emits the vector loop in front of `loop`.
+static bool emit_loop(struct vectorizer *v, const struct loop *loop)
+{
+	const struct mcc_ir_instruction *body = &v->instructions[loop->header + 3];
+	uint32_t body_count = loop->increment - loop->header - 3;
+
+	v->splats = malloc((2 * body_count + 1) * sizeof(*v->splats));
+	v->splat_count = 0;
+	if (!v->splats) {
+		return false;
+	}
+	for (uint32_t i = 0; i < v->vreg_count; ++i) {
+		v->vectors[i] = MCC_IR_OPERAND_MAX;
+	}
+
+	// the splats go in front of the loop
+	bool ok = true;
+	for (uint32_t i = 0; ok && i < body_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &body[i];
+		mcc_ir_operand values[2] = {instruction->a, instruction->b};
+		if (instruction->opcode == MCC_IR_LOAD) {
+			continue;
+		}
+		if (instruction->opcode == MCC_IR_STORE) {
+			values[0] = instruction->b;
+			values[1] = MCC_IR_NONE;
+		}
+		for (uint32_t k = 0; ok && k < 2; ++k) {
+			if (values[k] != MCC_IR_NONE && is_invariant(v, values[k])) {
+				ok = emit_splat(v, values[k], instruction->type);
+			}
+		}
+	}
+
+	uint32_t label = mcc_ir_new_label(v->function);
+	mcc_ir_operand condition = new_vreg(v, MCC_IR_TYPE_BOOL);
+	mcc_ir_operand bound = int_constant(v, loop->bound - (MCC_IR_VECTOR_LANES - 1));
+	mcc_ir_operand step = int_constant(v, MCC_IR_VECTOR_LANES);
+	ok = ok && label != MCC_IR_OPERAND_MAX && condition != MCC_IR_NONE && bound != MCC_IR_NONE &&
+	     step != MCC_IR_NONE;
+
+	ok = ok && emit(v, (struct mcc_ir_instruction){.opcode = MCC_IR_LABEL, .a = MCC_IR_IMM(label)}) &&
+	     emit(v, (struct mcc_ir_instruction){.opcode = MCC_IR_LT,
+	                                         .type = MCC_IR_TYPE_INT,
+	                                         .dest = condition,
+	                                         .a = loop->counter,
+	                                         .b = bound}) &&
+	     emit(v, (struct mcc_ir_instruction){.opcode = MCC_IR_JUMP_IF_FALSE,
+	                                         .a = condition,
+	                                         .b = v->instructions[loop->header].a});
+	for (uint32_t i = 0; ok && i < body_count; ++i) {
+		ok = emit_vector(v, &body[i]);
+	}
+	ok = ok &&
+	     emit(v, (struct mcc_ir_instruction){.opcode = MCC_IR_ADD,
+	                                         .type = MCC_IR_TYPE_INT,
+	                                         .dest = loop->counter,
+	                                         .a = loop->counter,
+	                                         .b = step}) &&
+	     emit(v, (struct mcc_ir_instruction){.opcode = MCC_IR_JUMP, .a = MCC_IR_IMM(label)});
+
+	free(v->splats);
+	v->splats = NULL;
+	return ok;
+}
+
+bool mcc_vectorize(struct mcc_ir_module *module, struct mcc_ir_function *function, struct mcc_vectorize_stats *stats)
+{
+	assert(module);
+	assert(function);
+
+	struct vectorizer v = {
+	    .module = module,
+	    .function = function,
+	    .instructions = function->instructions,
+	    .instruction_count = function->instruction_count,
+	    .vreg_count = function->vreg_count,
+	    .words = MCC_BITSET_WORDS(function->vreg_count),
+	};
+	v.loop_defined = calloc(v.words + 1, sizeof(*v.loop_defined));
+	v.body_defined = calloc(v.words + 1, sizeof(*v.body_defined));
+	v.vectors = malloc((v.vreg_count + 1) * sizeof(*v.vectors));
+
+	// find the loops first, the function is only rebuilt if there are any
+	struct loop *loops = malloc((v.instruction_count / 4 + 1) * sizeof(*loops));
+	uint32_t loop_count = 0;
+	bool ok = v.loop_defined && v.body_defined && v.vectors && loops;
+	for (uint32_t i = 0; ok && i < v.instruction_count; ++i) {
+		if (v.instructions[i].opcode == MCC_IR_LABEL && match_loop(&v, i, &loops[loop_count]) &&
+		    check_loop(&v, &loops[loop_count])) {
+			i = loops[loop_count++].back_jump;
+		}
+	}
+
+	if (ok && loop_count) {
+		function->instructions = NULL;
+		function->instruction_count = 0;
+		function->instruction_capacity = 0;
+
+		uint32_t next = 0;
+		for (uint32_t i = 0; ok && i < v.instruction_count; ++i) {
+			if (next < loop_count && loops[next].header == i) {
+				// the bitsets describe the loop being emitted
+				ok = check_loop(&v, &loops[next]) && emit_loop(&v, &loops[next]);
+				++next;
+			}
+			ok = ok && emit(&v, v.instructions[i]);
+		}
+		free(v.instructions);
+
+		if (stats) {
+			stats->vectorized_loops += loop_count;
+		}
+	}
+
+	free(loops);
+	free(v.loop_defined);
+	free(v.body_defined);
+	free(v.vectors);
+	return ok;
+}
@@ -0,0 +1,173 @@
+// Bytecode Interpreter Benchmark
+//
+// Interprets a synthesized program and reports the throughput in executed
+// bytecode instructions per second, both for the unoptimized and the
+// optimized module.
+//
+// The program runs a number of rounds over int and float arrays of 64
+// elements, doing arithmetic, loads, stores and branches, followed by a
+// recursive Fibonacci computation dominated by calls. The fastest of several
+// runs is reported as a single JSON object on one line.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mcc/bytecode.h"
+#include "mcc/ir.h"
+#include "mcc/ir_lower.h"
+#include "mcc/optimize.h"
+#include "mcc/parser.h"
+#include "mcc/type_check.h"
+
+#define DEFAULT_ROUNDS 20000
+#define DEFAULT_REPETITIONS 5
+
+#define FIBONACCI 24
+
+static const char program_format[] =
+    "int fib(int n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }"
+    "int main() {"
+    "  int[64] a; float[64] f; int i; int r; int s; s = 0; r = 0;"
+    "  while (r < %ld) {"
+    "    i = 0;"
+    "    while (i < 64) { a[i] = i * r + s; f[i] = 0.5 * f[i] + 1.0; i = i + 1; }"
+    "    i = 0;"
+    "    while (i < 64) { s = s + a[i] / 3; i = i + 1; }"
+    "    if (s > 1000000) { s = s - 1000000; }"
+    "    r = r + 1;"
+    "  }"
+    "  return s + fib(%d);"
+    "}";
+
+// Parses, checks and lowers the program, exiting on failure.
+static void build_module(struct mcc_ir_module *module, long rounds, bool optimize)
+{
+	char source[sizeof(program_format) + 64];
+	snprintf(source, sizeof(source), program_format, rounds, FIBONACCI);
+
+	struct mcc_parser_result result = mcc_parse_string(source);
+	if (result.status != MCC_PARSER_STATUS_OK) {
+		fprintf(stderr, "unable to parse the benchmark program\n");
+		exit(EXIT_FAILURE);
+	}
+	struct mcc_type_check_result check = mcc_type_check(result.program);
+	if (check.status != MCC_TYPE_CHECK_OK) {
+		fprintf(stderr, "unable to check the benchmark program\n");
+		exit(EXIT_FAILURE);
+	}
+
+	mcc_ir_module_init(module);
+	if (!mcc_ir_lower(module, result.program, &check) || (optimize && !mcc_optimize(module, NULL, NULL))) {
+		perror("mcc_ir_lower");
+		exit(EXIT_FAILURE);
+	}
+
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Returns the fastest time of interpreting main of `module`, storing the
+// number of instructions executed in `instructions`.
+static double measure(const struct mcc_ir_module *module, long repetitions, uint64_t *instructions)
+{
+	struct mcc_bytecode bytecode;
+	if (mcc_bytecode_compile(&bytecode, module) != MCC_BYTECODE_OK) {
+		perror("mcc_bytecode_compile");
+		exit(EXIT_FAILURE);
+	}
+
+	double best = 0;
+	for (long r = 0; r < repetitions; ++r) {
+		struct mcc_bytecode_result result;
+		double start = now();
+		enum mcc_bytecode_status status = mcc_bytecode_call(&bytecode, module, "main", stdin, stdout, &result);
+		double elapsed = now() - start;
+
+		if (status != MCC_BYTECODE_OK) {
+			fprintf(stderr, "mcc_bytecode_call: failed with status %d\n", (int)status);
+			exit(EXIT_FAILURE);
+		}
+		*instructions = result.instructions;
+
+		if (r == 0 || elapsed < best) {
+			best = elapsed;
+		}
+	}
+
+	mcc_bytecode_release(&bytecode);
+	return best;
+}
+
+static void print_usage(const char *prg)
+{
+	printf("usage: %s [OPTIONS]\n\n", prg);
+	printf("OPTIONS:\n");
+	printf("  -h            display this help message\n");
+	printf("  -n <N>        rounds over the arrays (defaults to %d)\n", DEFAULT_ROUNDS);
+	printf("  -r <N>        repetitions (defaults to %d)\n", DEFAULT_REPETITIONS);
+}
+
+static long parse_count(const char *prg, const char *arg)
+{
+	char *end;
+	long value = strtol(arg, &end, 10);
+	if (*end != '\0' || value < 1 || value > 1000000000) {
+		fprintf(stderr, "%s: invalid count '%s'\n", prg, arg);
+		exit(EXIT_FAILURE);
+	}
+	return value;
+}
+
+int main(int argc, char *argv[])
+{
+	long rounds = DEFAULT_ROUNDS;
+	long repetitions = DEFAULT_REPETITIONS;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "hn:r:")) != -1) {
+		switch (opt) {
+		case 'n':
+			rounds = parse_count(argv[0], optarg);
+			break;
+
+		case 'r':
+			repetitions = parse_count(argv[0], optarg);
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	static const char *const names[] = {"unoptimized", "optimized"};
+
+	printf("{\"rounds\": %ld", rounds);
+	for (int optimize = 0; optimize <= 1; ++optimize) {
+		struct mcc_ir_module module;
+		build_module(&module, rounds, optimize);
+
+		uint64_t instructions = 0;
+		double seconds = measure(&module, repetitions, &instructions);
+		printf(", \"%s\": {\"instructions\": %llu, \"seconds\": %.6f, \"instructions_per_second\": %.0f}",
+		       names[optimize], (unsigned long long)instructions, seconds, (double)instructions / seconds);
+
+		mcc_ir_module_release(&module);
+	}
+	printf("}\n");
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+// Dataflow Benchmark
+//
+// Builds the control flow graph of functions with a growing number of virtual
+// registers and solves liveness and reaching definitions on it. Reports the
+// time spent per register.
+//
+// Each function consists of a loop over a fixed number of blocks. Every block
+// defines its share of the registers, all of which are summed up in the last
+// block; hence most registers are live across most blocks and the sets are
+// densely populated. The function sizes are 1/8, 1/4, 1/2 and all of the
+// requested number of registers. The fastest of several runs is reported as a
+// single JSON object on one line.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mcc/cfg.h"
+#include "mcc/dataflow.h"
+#include "mcc/ir.h"
+#include "mcc/liveness.h"
+#include "mcc/reaching_definitions.h"
+
+#define DEFAULT_VREGS 20000
+#define DEFAULT_REPETITIONS 5
+
+#define BLOCKS 64
+#define STEPS 4
+
+static void emit(struct mcc_ir_function *function, struct mcc_ir_instruction instruction)
+{
+	if (!mcc_ir_emit(function, &instruction)) {
+		perror("mcc_ir_emit");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static uint32_t new_vreg(struct mcc_ir_function *function, enum mcc_ir_type type)
+{
+	uint32_t vreg = mcc_ir_new_vreg(function, type);
+	if (vreg == MCC_IR_OPERAND_MAX) {
+		perror("mcc_ir_new_vreg");
+		exit(EXIT_FAILURE);
+	}
+	return vreg;
+}
+
+// Builds `int f(int t0)` defining about `vregs` registers.
+static void build_function(struct mcc_ir_function *function, uint32_t vregs)
+{
+	*function = (struct mcc_ir_function){.name = "f", .return_type = MCC_IR_TYPE_INT, .parameter_count = 1};
+	mcc_ir_operand parameter = MCC_IR_VREG(new_vreg(function, MCC_IR_TYPE_INT));
+	uint32_t loop = mcc_ir_new_label(function);
+
+	// half of the registers are defined in the blocks, the other half sums
+	// them up
+	uint32_t values = vregs / 2;
+	uint32_t first = function->vreg_count;
+	for (uint32_t b = 0; b < BLOCKS; ++b) {
+		uint32_t label = b == 0 ? loop : mcc_ir_new_label(function);
+		emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_LABEL, .a = MCC_IR_IMM(label)});
+
+		for (uint32_t i = b * values / BLOCKS; i < (b + 1) * values / BLOCKS; ++i) {
+			mcc_ir_operand value = MCC_IR_VREG(new_vreg(function, MCC_IR_TYPE_INT));
+			emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_ADD,
+			                                           .type = MCC_IR_TYPE_INT,
+			                                           .dest = value,
+			                                           .a = parameter,
+			                                           .b = parameter});
+		}
+	}
+
+	mcc_ir_operand sum = parameter;
+	for (uint32_t i = 0; i < values; ++i) {
+		mcc_ir_operand next = MCC_IR_VREG(new_vreg(function, MCC_IR_TYPE_INT));
+		emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_ADD,
+		                                           .type = MCC_IR_TYPE_INT,
+		                                           .dest = next,
+		                                           .a = sum,
+		                                           .b = MCC_IR_VREG(first + i)});
+		sum = next;
+	}
+
+	mcc_ir_operand condition = MCC_IR_VREG(new_vreg(function, MCC_IR_TYPE_BOOL));
+	emit(function, (struct mcc_ir_instruction){
+	                   .opcode = MCC_IR_LT, .type = MCC_IR_TYPE_INT, .dest = condition, .a = sum, .b = parameter});
+	emit(function, (struct mcc_ir_instruction){
+	                   .opcode = MCC_IR_JUMP_IF_TRUE, .dest = MCC_IR_NONE, .a = condition, .b = MCC_IR_IMM(loop)});
+	emit(function, (struct mcc_ir_instruction){.opcode = MCC_IR_RETURN, .type = MCC_IR_TYPE_INT, .a = sum});
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Returns the fastest time of analysing `function`.
+static double measure(const struct mcc_ir_function *function, long repetitions)
+{
+	double best = 0;
+	for (long r = 0; r < repetitions; ++r) {
+		double start = now();
+
+		struct mcc_cfg cfg;
+		struct mcc_dataflow live;
+		struct mcc_reaching_definitions reaching;
+		bool ok = mcc_cfg_build(&cfg, function) && mcc_liveness_compute(&live, &cfg) &&
+		          mcc_reaching_definitions_compute(&reaching, &cfg);
+		double elapsed = now() - start;
+
+		if (!ok) {
+			perror("dataflow");
+			exit(EXIT_FAILURE);
+		}
+		mcc_reaching_definitions_release(&reaching);
+		mcc_dataflow_release(&live);
+		mcc_cfg_release(&cfg);
+
+		if (r == 0 || elapsed < best) {
+			best = elapsed;
+		}
+	}
+	return best;
+}
+
+static void print_usage(const char *prg)
+{
+	printf("usage: %s [OPTIONS]\n\n", prg);
+	printf("OPTIONS:\n");
+	printf("  -h            display this help message\n");
+	printf("  -n <N>        registers of the largest function (defaults to %d)\n", DEFAULT_VREGS);
+	printf("  -r <N>        repetitions (defaults to %d)\n", DEFAULT_REPETITIONS);
+}
+
+static uint32_t parse_count(const char *prg, const char *arg)
+{
+	char *end;
+	long value = strtol(arg, &end, 10);
+	if (*end != '\0' || value < 1 || value > (long)MCC_IR_OPERAND_MAX / 2) {
+		fprintf(stderr, "%s: invalid count '%s'\n", prg, arg);
+		exit(EXIT_FAILURE);
+	}
+	return (uint32_t)value;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t vregs = DEFAULT_VREGS;
+	long repetitions = DEFAULT_REPETITIONS;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "hn:r:")) != -1) {
+		switch (opt) {
+		case 'n':
+			vregs = parse_count(argv[0], optarg);
+			break;
+
+		case 'r':
+			repetitions = (long)parse_count(argv[0], optarg);
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	uint32_t counts[STEPS];
+	double seconds[STEPS];
+
+	for (int step = 0; step < STEPS; ++step) {
+		struct mcc_ir_function function;
+		build_function(&function, vregs >> (STEPS - 1 - step));
+		counts[step] = function.vreg_count;
+		seconds[step] = measure(&function, repetitions);
+
+		free(function.instructions);
+		free(function.vreg_types);
+	}
+
+	printf("{");
+	for (int step = 0; step < STEPS; ++step) {
+		printf("%s\"%u\": {\"seconds\": %.6f, \"ns_per_vreg\": %.2f}", step ? ", " : "", counts[step],
+		       seconds[step], seconds[step] * 1e9 / (double)counts[step]);
+	}
+	printf("}\n");
+
+	return EXIT_SUCCESS;
+}
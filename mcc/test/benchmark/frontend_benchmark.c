@@ -0,0 +1,454 @@
+// Front-End Benchmark
+//
+// Synthesizes an mC input of the requested shape and size, then times the
+// scanner alone and the full parse of the selected engine separately. The
+// scanner of the bison engine is the one flex generates from `scanner.l`, the
+// descent engine uses the hand-written lexer. Either phase can be run on its
+// own. Each phase runs several times, the fastest run is reported.
+//
+// The result is printed as a single JSON object on one line:
+//
+//   engine, input, bytes, tokens, nodes   configuration and input metrics
+//   scanner                               flex or lexer, depending on engine
+//   lex_seconds, parse_seconds            fastest run of each phase
+//   lex_tokens_per_second                 scanner throughput
+//   parse_tokens_per_second               parser throughput, scanner included
+//   parse_nodes_per_second                AST nodes built per second
+//   peak_rss_kib                          peak resident set size of the process
+//   allocs_per_node                       heap allocations of the AST arena
+//   arena_bytes_per_node                  arena memory handed out per node
+//
+// The metrics of a phase which was not run are null.
+//
+// The bison scanner creates (and interns) identifiers while scanning, the
+// hand-written lexer of the descent engine does not.
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mcc/lexer.h"
+#include "mcc/parser.h"
+#include "parser_engines.h"
+
+#define DEFAULT_SIZE (4 * 1024 * 1024)
+#define DEFAULT_REPETITIONS 5
+
+// Nesting depth of synthesized expressions, well below the depth limits of
+// both engines.
+#define EXPRESSION_DEPTH 64
+
+// ------------------------------------------------------------------- Input Synthesis
+
+struct buffer {
+	char *data;
+	size_t len;
+	size_t capacity;
+};
+
+static void append(struct buffer *buffer, const char *format, ...)
+{
+	for (;;) {
+		va_list args;
+		va_start(args, format);
+		int len = vsnprintf(buffer->data + buffer->len, buffer->capacity - buffer->len, format, args);
+		va_end(args);
+
+		if (len < 0) {
+			perror("vsnprintf");
+			exit(EXIT_FAILURE);
+		}
+
+		// two spare bytes for the terminators required by `mcc_parse_buffer`
+		if (buffer->len + (size_t)len + 2 < buffer->capacity) {
+			buffer->len += (size_t)len;
+			return;
+		}
+
+		buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 4096;
+		buffer->data = realloc(buffer->data, buffer->capacity);
+		if (!buffer->data) {
+			perror("realloc");
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+// One function whose statements are assignments of deeply nested expressions.
+static void synthesize_expressions(struct buffer *buffer, size_t size)
+{
+	append(buffer, "int f(int a, int b)\n{\n\tint x;\n");
+
+	while (buffer->len < size) {
+		append(buffer, "\tx = ");
+		for (int i = 0; i < EXPRESSION_DEPTH; ++i) {
+			append(buffer, "(a * %d + ", i);
+		}
+		append(buffer, "-b");
+		for (int i = 0; i < EXPRESSION_DEPTH; ++i) {
+			append(buffer, i % 2 ? ") / x" : ") - 1.5");
+		}
+		append(buffer, ";\n");
+	}
+
+	append(buffer, "\treturn x;\n}\n");
+}
+
+// One function with a long, flat list of mixed statements.
+static void synthesize_statements(struct buffer *buffer, size_t size)
+{
+	append(buffer, "void f()\n{\n\tint[16] a;\n\tbool flag;\n");
+
+	for (unsigned i = 0; buffer->len < size; ++i) {
+		append(buffer,
+		       "\tint v%u;\n"
+		       "\tv%u = a[%u] + 1;\n"
+		       "\tif (v%u < 10 && !flag) a[%u] = v%u; else flag = true;\n"
+		       "\twhile (v%u > 0) { v%u = v%u - 1; }\n"
+		       "\tprint(\"statement %u\");\n",
+		       i, i, i % 16, i, i % 16, i, i, i, i, i);
+	}
+
+	append(buffer, "}\n");
+}
+
+// Many small functions calling each other.
+static void synthesize_functions(struct buffer *buffer, size_t size)
+{
+	append(buffer, "int f0(int n) { return n; }\n");
+
+	for (unsigned i = 1; buffer->len < size; ++i) {
+		append(buffer,
+		       "int f%u(int n, float[4] x)\n"
+		       "{\n"
+		       "\tif (n <= 0) return 0;\n"
+		       "\treturn f%u(n - 1) + %u;\n"
+		       "}\n",
+		       i, i - 1, i);
+	}
+}
+
+static const struct {
+	const char *name;
+	void (*synthesize)(struct buffer *buffer, size_t size);
+} inputs[] = {
+    {"expressions", synthesize_expressions},
+    {"statements", synthesize_statements},
+    {"functions", synthesize_functions},
+};
+
+// ------------------------------------------------------------------- Node Counting
+
+static size_t count_expression(const struct mcc_ast_expression *expression);
+
+static size_t count_literal(const struct mcc_ast_literal *literal)
+{
+	return literal ? 1 : 0;
+}
+
+static size_t count_identifier(const struct mcc_ast_identifier *identifier)
+{
+	return identifier ? 1 : 0;
+}
+
+static size_t count_expression(const struct mcc_ast_expression *expression)
+{
+	if (!expression) {
+		return 0;
+	}
+
+	size_t count = 1;
+
+	switch (expression->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		count += count_literal(expression->literal);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		count += count_expression(expression->lhs) + count_expression(expression->rhs);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		count += count_expression(expression->rhs);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		count += count_expression(expression->expression);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+		count += count_identifier(expression->identifier);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+		count += count_identifier(expression->array) + count_expression(expression->index);
+		break;
+	case MCC_AST_EXPRESSION_TYPE_CALL:
+		count += count_identifier(expression->function);
+		for (const struct mcc_ast_argument *argument = expression->arguments; argument; argument = argument->next) {
+			count += 1 + count_expression(argument->expression);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return count;
+}
+
+static size_t count_declaration(const struct mcc_ast_declaration *declaration)
+{
+	if (!declaration) {
+		return 0;
+	}
+	return 1 + count_literal(declaration->array_size) + count_identifier(declaration->identifier);
+}
+
+static size_t count_statement(const struct mcc_ast_statement *statement)
+{
+	if (!statement) {
+		return 0;
+	}
+
+	size_t count = 1;
+
+	switch (statement->type) {
+	case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+		count += count_expression(statement->expression);
+		break;
+	case MCC_AST_STATEMENT_TYPE_IF:
+		count += count_expression(statement->if_condition) + count_statement(statement->if_stmt) +
+		         count_statement(statement->else_stmt);
+		break;
+	case MCC_AST_STATEMENT_TYPE_WHILE:
+		count += count_expression(statement->while_condition) + count_statement(statement->while_stmt);
+		break;
+	case MCC_AST_STATEMENT_TYPE_DECL:
+		count += count_declaration(statement->declaration);
+		break;
+	case MCC_AST_STATEMENT_TYPE_ASSGN:
+		count += count_identifier(statement->id_assgn) + count_expression(statement->lhs_assgn) +
+		         count_expression(statement->rhs_assgn);
+		break;
+	case MCC_AST_STATEMENT_TYPE_COMPOUND:
+		for (const struct mcc_ast_statement_list *list = statement->compound_statement; list; list = list->next) {
+			count += 1 + count_statement(list->statement);
+		}
+		break;
+	case MCC_AST_STATEMENT_TYPE_RETURN:
+		count += count_expression(statement->return_value);
+		break;
+	}
+
+	return count;
+}
+
+static size_t count_program(const struct mcc_ast_program *program)
+{
+	size_t count = 1;
+
+	for (const struct mcc_ast_function_def *function = program->function_def; function; function = function->next) {
+		count += 1 + count_identifier(function->identifier) + count_statement(function->compund_statement);
+		for (const struct mcc_ast_parameter *parameter = function->parameter; parameter;
+		     parameter = parameter->next) {
+			count += 1 + count_declaration(parameter->declaration);
+		}
+	}
+
+	return count;
+}
+
+// ------------------------------------------------------------------- Measurement
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static long lex(enum mcc_parser_engine engine, char *data, size_t len)
+{
+	if (engine == MCC_PARSER_ENGINE_BISON) {
+		return mcc_parser_bison_lex_buffer(data, len);
+	}
+
+	struct mcc_lexer lexer;
+	mcc_lexer_init(&lexer, data, len);
+
+	long count = 0;
+	struct mcc_token token;
+	for (mcc_lexer_next(&lexer, &token); token.type != MCC_TOKEN_EOF; mcc_lexer_next(&lexer, &token)) {
+		count++;
+	}
+	return count;
+}
+
+// Prints the metric `name` with `precision` decimals as a member of the JSON
+// object, null unless it was `measured`.
+static void print_metric(const char *name, int precision, bool measured, double value)
+{
+	printf(", \"%s\": ", name);
+	if (measured) {
+		printf("%.*f", precision, value);
+	} else {
+		printf("null");
+	}
+}
+
+static void print_usage(const char *prg)
+{
+	printf("usage: %s [OPTIONS]\n\n", prg);
+	printf("OPTIONS:\n");
+	printf("  -h            display this help message\n");
+	printf("  -e <ENGINE>   parser engine, bison (default) or descent\n");
+	printf("  -i <INPUT>    input shape: expressions (default), statements, or functions\n");
+	printf("  -p <PHASE>    phases to time: lex, parse, or all (default)\n");
+	printf("  -s <BYTES>    approximate input size (defaults to %d)\n", DEFAULT_SIZE);
+	printf("  -r <N>        repetitions of each phase (defaults to %d)\n", DEFAULT_REPETITIONS);
+}
+
+int main(int argc, char *argv[])
+{
+	enum mcc_parser_engine engine = MCC_PARSER_ENGINE_BISON;
+	const char *engine_name = "bison";
+	size_t input = 0;
+	bool time_lex = true;
+	bool time_parse = true;
+	size_t size = DEFAULT_SIZE;
+	long repetitions = DEFAULT_REPETITIONS;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "he:i:p:s:r:")) != -1) {
+		switch (opt) {
+		case 'e':
+			if (!mcc_parser_engine_from_name(optarg, &engine)) {
+				fprintf(stderr, "%s: unknown parser engine '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			engine_name = optarg;
+			break;
+
+		case 'i':
+			for (input = 0; input < sizeof(inputs) / sizeof(inputs[0]); ++input) {
+				if (strcmp(inputs[input].name, optarg) == 0) {
+					break;
+				}
+			}
+			if (input == sizeof(inputs) / sizeof(inputs[0])) {
+				fprintf(stderr, "%s: unknown input shape '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'p':
+			if (strcmp(optarg, "lex") == 0) {
+				time_parse = false;
+			} else if (strcmp(optarg, "parse") == 0) {
+				time_lex = false;
+			} else if (strcmp(optarg, "all") != 0) {
+				fprintf(stderr, "%s: unknown phase '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 's':
+			size = strtoul(optarg, NULL, 10);
+			break;
+
+		case 'r':
+			repetitions = strtol(optarg, NULL, 10);
+			if (repetitions < 1) {
+				fprintf(stderr, "%s: invalid number of repetitions '%s'\n", argv[0], optarg);
+				return EXIT_FAILURE;
+			}
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	mcc_parser_set_engine(engine);
+
+	struct buffer source = {0};
+	inputs[input].synthesize(&source, size);
+
+	// Both engines work on the buffer in place, each run gets a fresh copy.
+	char *data = malloc(source.len + 2);
+	if (!data) {
+		perror("malloc");
+		return EXIT_FAILURE;
+	}
+
+	// the tokens are counted even if the scanner is not timed
+	long tokens = 0;
+	double lex_seconds = 0.0;
+	for (long i = 0; i < (time_lex ? repetitions : 1); ++i) {
+		memcpy(data, source.data, source.len);
+		data[source.len] = data[source.len + 1] = '\0';
+
+		double start = now();
+		tokens = lex(engine, data, source.len);
+		double seconds = now() - start;
+
+		if (tokens < 0) {
+			fprintf(stderr, "%s: unable to set up the scanner\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (i == 0 || seconds < lex_seconds) {
+			lex_seconds = seconds;
+		}
+	}
+
+	size_t nodes = 0;
+	struct mcc_arena_stats arena = {0};
+	double parse_seconds = 0.0;
+	for (long i = 0; time_parse && i < repetitions; ++i) {
+		memcpy(data, source.data, source.len);
+		data[source.len] = data[source.len + 1] = '\0';
+
+		double start = now();
+		struct mcc_parser_result result = mcc_parse_buffer(data, source.len);
+		double seconds = now() - start;
+
+		if (result.status != MCC_PARSER_STATUS_OK) {
+			fprintf(stderr, "%s: unable to parse the synthesized input\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (i == 0 || seconds < parse_seconds) {
+			parse_seconds = seconds;
+		}
+
+		nodes = count_program(result.program);
+		mcc_arena_stats(&result.arena, &arena);
+		mcc_parser_delete_result(&result);
+	}
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	printf("{\"engine\": \"%s\", \"scanner\": \"%s\", \"input\": \"%s\", \"bytes\": %zu, \"tokens\": %ld",
+	       engine_name, engine == MCC_PARSER_ENGINE_BISON ? "flex" : "lexer", inputs[input].name, source.len,
+	       tokens);
+	print_metric("nodes", 0, time_parse, (double)nodes);
+	print_metric("lex_seconds", 6, time_lex, lex_seconds);
+	print_metric("parse_seconds", 6, time_parse, parse_seconds);
+	print_metric("lex_tokens_per_second", 0, time_lex, (double)tokens / lex_seconds);
+	print_metric("parse_tokens_per_second", 0, time_parse, (double)tokens / parse_seconds);
+	print_metric("parse_nodes_per_second", 0, time_parse, (double)nodes / parse_seconds);
+	printf(", \"peak_rss_kib\": %ld", usage.ru_maxrss);
+	print_metric("allocs_per_node", 6, time_parse, (double)arena.chunks / (double)nodes);
+	print_metric("arena_bytes_per_node", 2, time_parse, (double)arena.used / (double)nodes);
+	printf("}\n");
+
+	free(data);
+	free(source.data);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,287 @@
+// Symbol Table Benchmark
+//
+// Compares `mcc_symbol_table` against a naive baseline which keeps one linked
+// list of symbols per scope and chains the scopes, as found in many textbook
+// compilers. Lookups in the baseline walk every scope from the innermost one
+// outwards.
+//
+// The workload opens `depth` nested scopes. Each declares `names` variables,
+// one of which shadows a variable of the enclosing scope, then looks up
+// `lookups` names declared in the enclosing scopes. All scopes are left at the
+// end. Both implementations run the same sequence of operations; the fastest
+// of several runs is reported as a single JSON object on one line.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mcc/arena.h"
+#include "mcc/ast.h"
+#include "mcc/symbol_table.h"
+
+#define DEFAULT_DEPTH 1000
+#define DEFAULT_NAMES 8
+#define DEFAULT_LOOKUPS 64
+#define DEFAULT_REPETITIONS 5
+
+struct workload {
+	size_t depth;
+	size_t names;
+	size_t lookups;
+
+	// declarations[scope * names + i]
+	struct mcc_ast_declaration **declarations;
+
+	// names looked up in each scope, `lookups` per scope
+	const char **queries;
+};
+
+// ------------------------------------------------------------------- Baseline
+
+struct naive_symbol {
+	const char *name;
+	struct mcc_ast_declaration *declaration;
+	struct naive_symbol *next;
+};
+
+struct naive_scope {
+	struct naive_symbol *symbols;
+	struct naive_scope *parent;
+};
+
+static struct mcc_ast_declaration *naive_lookup(const struct naive_scope *scope, const char *name)
+{
+	for (; scope; scope = scope->parent) {
+		for (const struct naive_symbol *symbol = scope->symbols; symbol; symbol = symbol->next) {
+			if (symbol->name == name) {
+				return symbol->declaration;
+			}
+		}
+	}
+	return NULL;
+}
+
+static uintptr_t run_naive(const struct workload *w)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	uintptr_t checksum = 0;
+	struct naive_scope *scope = NULL;
+
+	for (size_t d = 0; d < w->depth; ++d) {
+		struct naive_scope *inner = mcc_arena_alloc(&arena, sizeof(*inner));
+		*inner = (struct naive_scope){.parent = scope};
+		scope = inner;
+
+		for (size_t i = 0; i < w->names; ++i) {
+			struct mcc_ast_declaration *declaration = w->declarations[d * w->names + i];
+			struct naive_symbol *symbol = mcc_arena_alloc(&arena, sizeof(*symbol));
+			*symbol = (struct naive_symbol){
+			    .name = declaration->identifier->i_value,
+			    .declaration = declaration,
+			    .next = scope->symbols,
+			};
+			scope->symbols = symbol;
+		}
+
+		for (size_t q = 0; q < w->lookups; ++q) {
+			checksum += (uintptr_t)naive_lookup(scope, w->queries[d * w->lookups + q]);
+		}
+	}
+
+	// Leaving a scope just drops it, its nodes are reclaimed with the arena.
+	mcc_arena_release(&arena);
+	return checksum;
+}
+
+// ------------------------------------------------------------------- Symbol Table
+
+static uintptr_t run_table(const struct workload *w)
+{
+	struct mcc_symbol_table table;
+	mcc_symbol_table_init(&table);
+
+	uintptr_t checksum = 0;
+
+	for (size_t d = 0; d < w->depth; ++d) {
+		if (!mcc_symbol_table_push_scope(&table)) {
+			perror("mcc_symbol_table_push_scope");
+			exit(EXIT_FAILURE);
+		}
+
+		for (size_t i = 0; i < w->names; ++i) {
+			if (mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_VARIABLE,
+			                                      w->declarations[d * w->names + i], NULL) != MCC_SYMBOL_TABLE_OK) {
+				fprintf(stderr, "mcc_symbol_table_declare_variable failed\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		for (size_t q = 0; q < w->lookups; ++q) {
+			const struct mcc_symbol *symbol = mcc_symbol_table_lookup(&table, w->queries[d * w->lookups + q]);
+			checksum += symbol ? (uintptr_t)symbol->declaration : 0;
+		}
+	}
+
+	for (size_t d = 0; d < w->depth; ++d) {
+		mcc_symbol_table_pop_scope(&table);
+	}
+
+	mcc_symbol_table_release(&table);
+	return checksum;
+}
+
+// ------------------------------------------------------------------- Workload
+
+static struct mcc_ast_identifier *new_identifier(struct mcc_arena *arena, size_t scope, size_t i)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "v%zu_%zu", scope, i);
+
+	struct mcc_ast_identifier *identifier = mcc_ast_new_identifier(arena, name);
+	if (!identifier) {
+		perror("mcc_ast_new_identifier");
+		exit(EXIT_FAILURE);
+	}
+	return identifier;
+}
+
+static void build_workload(struct workload *w, struct mcc_arena *arena)
+{
+	w->declarations = malloc(w->depth * w->names * sizeof(*w->declarations));
+	w->queries = malloc(w->depth * w->lookups * sizeof(*w->queries));
+	if (!w->declarations || !w->queries) {
+		perror("malloc");
+		exit(EXIT_FAILURE);
+	}
+
+	for (size_t d = 0; d < w->depth; ++d) {
+		for (size_t i = 0; i < w->names; ++i) {
+			// the first name of each scope shadows the one of the enclosing scope
+			struct mcc_ast_identifier *identifier = new_identifier(arena, i == 0 ? 0 : d, i);
+			w->declarations[d * w->names + i] =
+			    mcc_ast_new_declaration(arena, MCC_AST_DATA_TYPE_INT, NULL, identifier);
+		}
+	}
+
+	// Query names of enclosing scopes, spread evenly over the nesting depth.
+	for (size_t d = 0; d < w->depth; ++d) {
+		for (size_t q = 0; q < w->lookups; ++q) {
+			size_t scope = (d * 7919 + q * 104729) % (d + 1);
+			size_t i = q % w->names;
+			w->queries[d * w->lookups + q] = w->declarations[scope * w->names + i]->identifier->i_value;
+		}
+	}
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double measure(uintptr_t (*run)(const struct workload *), const struct workload *w, long repetitions,
+                      uintptr_t *checksum)
+{
+	double best = 0;
+	for (long r = 0; r < repetitions; ++r) {
+		double start = now();
+		*checksum = run(w);
+		double elapsed = now() - start;
+		if (r == 0 || elapsed < best) {
+			best = elapsed;
+		}
+	}
+	return best;
+}
+
+static void print_usage(const char *prg)
+{
+	printf("usage: %s [OPTIONS]\n\n", prg);
+	printf("OPTIONS:\n");
+	printf("  -h            display this help message\n");
+	printf("  -d <N>        nesting depth (defaults to %d)\n", DEFAULT_DEPTH);
+	printf("  -n <N>        names declared per scope (defaults to %d)\n", DEFAULT_NAMES);
+	printf("  -q <N>        lookups per scope (defaults to %d)\n", DEFAULT_LOOKUPS);
+	printf("  -r <N>        repetitions (defaults to %d)\n", DEFAULT_REPETITIONS);
+}
+
+static size_t parse_count(const char *prg, const char *arg)
+{
+	char *end;
+	long value = strtol(arg, &end, 10);
+	if (*end != '\0' || value < 1) {
+		fprintf(stderr, "%s: invalid count '%s'\n", prg, arg);
+		exit(EXIT_FAILURE);
+	}
+	return (size_t)value;
+}
+
+int main(int argc, char *argv[])
+{
+	struct workload w = {
+	    .depth = DEFAULT_DEPTH,
+	    .names = DEFAULT_NAMES,
+	    .lookups = DEFAULT_LOOKUPS,
+	};
+	long repetitions = DEFAULT_REPETITIONS;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "hd:n:q:r:")) != -1) {
+		switch (opt) {
+		case 'd':
+			w.depth = parse_count(argv[0], optarg);
+			break;
+
+		case 'n':
+			w.names = parse_count(argv[0], optarg);
+			break;
+
+		case 'q':
+			w.lookups = parse_count(argv[0], optarg);
+			break;
+
+		case 'r':
+			repetitions = (long)parse_count(argv[0], optarg);
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+	build_workload(&w, &arena);
+
+	uintptr_t naive_checksum, table_checksum;
+	double naive_seconds = measure(run_naive, &w, repetitions, &naive_checksum);
+	double table_seconds = measure(run_table, &w, repetitions, &table_checksum);
+
+	if (naive_checksum != table_checksum) {
+		fprintf(stderr, "%s: implementations disagree\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	double lookups = (double)(w.depth * w.lookups);
+	printf("{\"depth\": %zu, \"names_per_scope\": %zu, \"lookups\": %zu, "
+	       "\"naive_seconds\": %.6f, \"table_seconds\": %.6f, "
+	       "\"naive_lookups_per_second\": %.0f, \"table_lookups_per_second\": %.0f, \"speedup\": %.2f}\n",
+	       w.depth, w.names, w.depth * w.lookups, naive_seconds, table_seconds, lookups / naive_seconds,
+	       lookups / table_seconds, naive_seconds / table_seconds);
+
+	free(w.declarations);
+	free(w.queries);
+	mcc_arena_release(&arena);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+// Type Checker Benchmark
+//
+// Checks programs of growing size and reports the time spent per expression.
+// The type checker runs in linear time, hence the per-expression cost is
+// expected to stay flat as the program grows.
+//
+// Each program consists of a single function which declares `int x` and
+// assigns it a chain `x + 1 + x + 1 + ...`, so identifier lookups and
+// literals alternate. The program sizes are 1/8, 1/4, 1/2 and all of the
+// requested number of expressions. The fastest of several runs is reported as
+// a single JSON object on one line.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "mcc/arena.h"
+#include "mcc/ast.h"
+#include "mcc/type_check.h"
+
+#define DEFAULT_EXPRESSIONS 1000000
+#define DEFAULT_REPETITIONS 5
+
+#define STEPS 4
+
+static void *check_alloc(void *ptr)
+{
+	if (!ptr) {
+		perror("mcc_ast_new");
+		exit(EXIT_FAILURE);
+	}
+	return ptr;
+}
+
+// Builds a program of about `expressions` expressions.
+static struct mcc_ast_program *build_program(struct mcc_arena *arena, size_t expressions)
+{
+	struct mcc_ast_identifier *x = check_alloc(mcc_ast_new_identifier(arena, "x"));
+
+	struct mcc_ast_expression *chain = check_alloc(mcc_ast_new_expression_identifier(arena, x));
+	for (size_t i = 1; i + 1 < expressions; i += 2) {
+		struct mcc_ast_expression *operand =
+		    i % 4 == 1 ? mcc_ast_new_expression_literal(arena, check_alloc(mcc_ast_new_literal_int(arena, 1)))
+		               : mcc_ast_new_expression_identifier(arena, x);
+		chain = check_alloc(mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_ADD, chain,
+		                                                     check_alloc(operand)));
+	}
+
+	struct mcc_ast_statement_list *body = check_alloc(mcc_ast_new_statement_list(
+	    arena, check_alloc(mcc_ast_new_statement_declaration(
+	               arena, check_alloc(mcc_ast_new_declaration(arena, MCC_AST_DATA_TYPE_INT, NULL, x))))));
+	body->next = check_alloc(
+	    mcc_ast_new_statement_list(arena, check_alloc(mcc_ast_new_statement_assignment(arena, x, NULL, chain))));
+
+	struct mcc_ast_identifier *name = check_alloc(mcc_ast_new_identifier(arena, "main"));
+	struct mcc_ast_statement *compound = check_alloc(mcc_ast_new_statement_compound(arena, body));
+	struct mcc_ast_function_def *function_def =
+	    check_alloc(mcc_ast_new_function_def(arena, MCC_AST_DATA_TYPE_VOID, name, NULL, compound));
+	return check_alloc(mcc_ast_new_program(arena, function_def));
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Returns the fastest time of checking `program`; `count` receives the number
+// of typed expressions.
+static double measure(struct mcc_ast_program *program, long repetitions, size_t *count)
+{
+	double best = 0;
+	for (long r = 0; r < repetitions; ++r) {
+		double start = now();
+		struct mcc_type_check_result result = mcc_type_check(program);
+		double elapsed = now() - start;
+
+		if (result.status != MCC_TYPE_CHECK_OK) {
+			fprintf(stderr, "type check failed: %s\n", result.error);
+			exit(EXIT_FAILURE);
+		}
+		*count = result.entry_count;
+		mcc_type_check_delete_result(&result);
+
+		if (r == 0 || elapsed < best) {
+			best = elapsed;
+		}
+	}
+	return best;
+}
+
+static void print_usage(const char *prg)
+{
+	printf("usage: %s [OPTIONS]\n\n", prg);
+	printf("OPTIONS:\n");
+	printf("  -h            display this help message\n");
+	printf("  -n <N>        expressions of the largest program (defaults to %d)\n", DEFAULT_EXPRESSIONS);
+	printf("  -r <N>        repetitions (defaults to %d)\n", DEFAULT_REPETITIONS);
+}
+
+static size_t parse_count(const char *prg, const char *arg)
+{
+	char *end;
+	long value = strtol(arg, &end, 10);
+	if (*end != '\0' || value < 1) {
+		fprintf(stderr, "%s: invalid count '%s'\n", prg, arg);
+		exit(EXIT_FAILURE);
+	}
+	return (size_t)value;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t expressions = DEFAULT_EXPRESSIONS;
+	long repetitions = DEFAULT_REPETITIONS;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "hn:r:")) != -1) {
+		switch (opt) {
+		case 'n':
+			expressions = parse_count(argv[0], optarg);
+			break;
+
+		case 'r':
+			repetitions = (long)parse_count(argv[0], optarg);
+			break;
+
+		case 'h':
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+
+		default:
+			print_usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+
+	size_t counts[STEPS];
+	double seconds[STEPS];
+
+	for (int step = 0; step < STEPS; ++step) {
+		struct mcc_arena arena;
+		mcc_arena_init(&arena);
+
+		struct mcc_ast_program *program = build_program(&arena, expressions >> (STEPS - 1 - step));
+		seconds[step] = measure(program, repetitions, &counts[step]);
+
+		mcc_arena_release(&arena);
+	}
+
+	printf("{");
+	for (int step = 0; step < STEPS; ++step) {
+		printf("%s\"%zu\": {\"seconds\": %.6f, \"ns_per_expression\": %.2f}", step ? ", " : "", counts[step],
+		       seconds[step], seconds[step] * 1e9 / (double)counts[step]);
+	}
+	printf("}\n");
+
+	return EXIT_SUCCESS;
+}
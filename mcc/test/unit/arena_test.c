@@ -0,0 +1,114 @@
+#include <CuTest.h>
+
+#include <stdalign.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mcc/arena.h"
+
+void Alloc_Alignment(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	for (size_t size = 1; size < 100; ++size) {
+		void *ptr = mcc_arena_alloc(&arena, size);
+		CuAssertPtrNotNull(tc, ptr);
+		CuAssertTrue(tc, (uintptr_t)ptr % alignof(max_align_t) == 0);
+		memset(ptr, 0xAB, size);
+	}
+
+	mcc_arena_release(&arena);
+	CuAssertPtrEquals(tc, NULL, arena.head);
+}
+
+void Alloc_Oversized(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	char *small = mcc_arena_alloc(&arena, 16);
+	char *large = mcc_arena_alloc(&arena, 1024 * 1024);
+	char *after = mcc_arena_alloc(&arena, 16);
+
+	CuAssertPtrNotNull(tc, small);
+	CuAssertPtrNotNull(tc, large);
+	CuAssertPtrNotNull(tc, after);
+
+	// the chunk holding `small` is still used for subsequent small requests
+	CuAssertTrue(tc, after > small && after - small < 1024);
+
+	memset(large, 0, 1024 * 1024);
+
+	mcc_arena_release(&arena);
+}
+
+void Strdup(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	const char input[] = "hello";
+	char *copy = mcc_arena_strdup(&arena, input);
+
+	CuAssertPtrNotNull(tc, copy);
+	CuAssertTrue(tc, copy != input);
+	CuAssertStrEquals(tc, input, copy);
+
+	mcc_arena_release(&arena);
+}
+
+void Merge(CuTest *tc)
+{
+	struct mcc_arena dst, src;
+	mcc_arena_init(&dst);
+	mcc_arena_init(&src);
+
+	char *a = mcc_arena_strdup(&dst, "dst");
+	char *b = mcc_arena_strdup(&src, "src");
+	mcc_arena_alloc(&src, 1024 * 1024);
+
+	mcc_arena_merge(&dst, &src);
+
+	CuAssertPtrEquals(tc, NULL, src.head);
+	CuAssertStrEquals(tc, "dst", a);
+	CuAssertStrEquals(tc, "src", b);
+
+	// dst keeps allocating from its own chunk
+	char *c = mcc_arena_alloc(&dst, 16);
+	CuAssertTrue(tc, c > a && c - a < 1024);
+
+	mcc_arena_release(&dst);
+}
+
+void Stats(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_arena_stats stats;
+	mcc_arena_stats(&arena, &stats);
+	CuAssertIntEquals(tc, 0, stats.chunks);
+	CuAssertIntEquals(tc, 0, stats.used);
+
+	mcc_arena_alloc(&arena, 1);
+	mcc_arena_alloc(&arena, 1024 * 1024);
+
+	mcc_arena_stats(&arena, &stats);
+	CuAssertIntEquals(tc, 2, stats.chunks);
+	CuAssertIntEquals(tc, 1024 * 1024 + alignof(max_align_t), stats.used);
+	CuAssertTrue(tc, stats.reserved > stats.used);
+
+	mcc_arena_release(&arena);
+}
+
+#define TESTS \
+	TEST(Alloc_Alignment) \
+	TEST(Alloc_Oversized) \
+	TEST(Strdup) \
+	TEST(Merge) \
+	TEST(Stats)
+
+#include "main_stub.inc"
+#undef TESTS
@@ -0,0 +1,218 @@
+#include <CuTest.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mcc/ast.h"
+#include "mcc/ast_cache.h"
+#include "mcc/intern.h"
+
+// Builds the program
+//
+//   int f(int a, float b) { while (a < 1.5) if (-x) a[3] = "str"; }
+//   void g() { bool[4] flag; return g(flag, 2); }
+static struct mcc_ast_program *build_program(struct mcc_arena *arena)
+{
+	struct mcc_ast_parameter *params = mcc_ast_new_parameter(
+	    arena, mcc_ast_new_declaration(arena, MCC_AST_DATA_TYPE_INT, NULL, mcc_ast_new_identifier(arena, "a")));
+	params->next = mcc_ast_new_parameter(
+	    arena, mcc_ast_new_declaration(arena, MCC_AST_DATA_TYPE_FLOAT, NULL, mcc_ast_new_identifier(arena, "b")));
+
+	struct mcc_ast_expression *cond = mcc_ast_new_expression_binary_op(
+	    arena, MCC_AST_BINARY_OP_LESS, mcc_ast_new_expression_identifier(arena, mcc_ast_new_identifier(arena, "a")),
+	    mcc_ast_new_expression_literal(arena, mcc_ast_new_literal_float(arena, 1.5)));
+
+	struct mcc_ast_statement *assign = mcc_ast_new_statement_assignment(
+	    arena, mcc_ast_new_identifier(arena, "a"),
+	    mcc_ast_new_expression_literal(arena, mcc_ast_new_literal_int(arena, 3)),
+	    mcc_ast_new_expression_literal(arena, mcc_ast_new_literal_string(arena, "str")));
+
+	struct mcc_ast_statement *if_stmt = mcc_ast_new_statement_if(
+	    arena,
+	    mcc_ast_new_expression_unary_op(arena, MCC_AST_UNARY_OP_MINUS,
+	                                    mcc_ast_new_expression_identifier(arena, mcc_ast_new_identifier(arena, "x"))),
+	    assign, NULL);
+
+	struct mcc_ast_function_def *f = mcc_ast_new_function_def(
+	    arena, MCC_AST_DATA_TYPE_INT, mcc_ast_new_identifier(arena, "f"), params,
+	    mcc_ast_new_statement_compound(
+	        arena, mcc_ast_new_statement_list(arena, mcc_ast_new_statement_while(arena, cond, if_stmt))));
+
+	struct mcc_ast_expression *flag = mcc_ast_new_expression_identifier(arena, mcc_ast_new_identifier(arena, "flag"));
+	struct mcc_ast_argument *args = mcc_ast_new_argument(arena, flag);
+	args->next =
+	    mcc_ast_new_argument(arena, mcc_ast_new_expression_literal(arena, mcc_ast_new_literal_int(arena, 2)));
+
+	struct mcc_ast_statement_list *body = mcc_ast_new_statement_list(
+	    arena, mcc_ast_new_statement_declaration(
+	               arena, mcc_ast_new_declaration(arena, MCC_AST_DATA_TYPE_BOOL, mcc_ast_new_literal_int(arena, 4),
+	                                              mcc_ast_new_identifier(arena, "flag"))));
+	body->next = mcc_ast_new_statement_list(
+	    arena, mcc_ast_new_statement_return(
+	               arena, mcc_ast_new_expression_call(arena, mcc_ast_new_identifier(arena, "g"), args)));
+
+	struct mcc_ast_function_def *g = mcc_ast_new_function_def(arena, MCC_AST_DATA_TYPE_VOID,
+	                                                          mcc_ast_new_identifier(arena, "g"), NULL,
+	                                                          mcc_ast_new_statement_compound(arena, body));
+
+	struct mcc_ast_program *program = mcc_ast_new_program(arena, f);
+	mcc_ast_add_function_def(program, g);
+	return program;
+}
+
+static void remove_dir(const char *path)
+{
+	DIR *dir = opendir(path);
+	if (dir) {
+		struct dirent *entry;
+		while ((entry = readdir(dir))) {
+			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+				continue;
+			}
+			char file[512];
+			snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+			unlink(file);
+		}
+		closedir(dir);
+	}
+	rmdir(path);
+}
+
+void RoundTrip(CuTest *tc)
+{
+	char dir[] = "/tmp/mcc_ast_cache_XXXXXX";
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+
+	const char source[] = "int f(int a, float b) { ... }";
+	struct mcc_ast_cache_key key;
+	mcc_ast_cache_compute_key(&key, source, sizeof(source) - 1);
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+	CuAssertTrue(tc, mcc_ast_cache_store(dir, &key, build_program(&arena)));
+	mcc_arena_release(&arena);
+
+	struct mcc_parser_result result = {0};
+	mcc_arena_init(&result.arena);
+	CuAssertTrue(tc, mcc_ast_cache_load(dir, &key, &result));
+
+	struct mcc_ast_program *program = result.program;
+	CuAssertPtrNotNull(tc, program);
+
+	struct mcc_ast_function_def *f = program->function_def;
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_INT, f->type);
+	CuAssertPtrEquals(tc, (void *)mcc_intern("f"), (void *)f->identifier->i_value);
+
+	struct mcc_ast_parameter *param = f->parameter;
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_INT, param->declaration->type);
+	CuAssertPtrEquals(tc, (void *)mcc_intern("a"), (void *)param->declaration->identifier->i_value);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_FLOAT, param->next->declaration->type);
+	CuAssertPtrEquals(tc, NULL, param->next->next);
+
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_COMPOUND, f->compund_statement->type);
+	CuAssertPtrEquals(tc, NULL, f->compund_statement->compound_statement->next);
+
+	struct mcc_ast_statement *loop = f->compund_statement->compound_statement->statement;
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_WHILE, loop->type);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_LESS, loop->while_condition->op);
+	CuAssertDblEquals(tc, 1.5, loop->while_condition->rhs->literal->f_value, 0.0);
+
+	struct mcc_ast_statement *if_stmt = loop->while_stmt;
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_IF, if_stmt->type);
+	CuAssertIntEquals(tc, MCC_AST_UNARY_OP_MINUS, if_stmt->if_condition->up);
+	CuAssertPtrEquals(tc, NULL, if_stmt->else_stmt);
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_ASSGN, if_stmt->if_stmt->type);
+	CuAssertIntEquals(tc, 3, if_stmt->if_stmt->lhs_assgn->literal->i_value);
+	CuAssertStrEquals(tc, "str", if_stmt->if_stmt->rhs_assgn->literal->s_value);
+
+	struct mcc_ast_function_def *g = f->next;
+	CuAssertPtrEquals(tc, g, program->last_function_def);
+	CuAssertPtrEquals(tc, NULL, g->parameter);
+
+	struct mcc_ast_statement_list *body = g->compund_statement->compound_statement;
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_DECL, body->statement->type);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_BOOL, body->statement->declaration->type);
+	CuAssertIntEquals(tc, 4, body->statement->declaration->array_size->i_value);
+	CuAssertPtrEquals(tc, (void *)mcc_intern("flag"), (void *)body->statement->declaration->identifier->i_value);
+
+	struct mcc_ast_statement *ret = body->next->statement;
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_RETURN, ret->type);
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_CALL, ret->return_value->type);
+	CuAssertPtrEquals(tc, (void *)mcc_intern("g"), (void *)ret->return_value->function->i_value);
+	struct mcc_ast_argument *args = ret->return_value->arguments;
+	CuAssertPtrEquals(tc, (void *)mcc_intern("flag"), (void *)args->expression->identifier->i_value);
+	CuAssertIntEquals(tc, 2, args->next->expression->literal->i_value);
+	CuAssertPtrEquals(tc, NULL, args->next->next);
+
+	mcc_arena_release(&result.arena);
+	remove_dir(dir);
+}
+
+void Miss(CuTest *tc)
+{
+	char dir[] = "/tmp/mcc_ast_cache_XXXXXX";
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+
+	struct mcc_ast_cache_key key, other;
+	mcc_ast_cache_compute_key(&key, "a", 1);
+	mcc_ast_cache_compute_key(&other, "b", 1);
+	CuAssertTrue(tc, key.hash[0] != other.hash[0] || key.hash[1] != other.hash[1]);
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+	CuAssertTrue(tc, mcc_ast_cache_store(dir, &key, build_program(&arena)));
+	mcc_arena_release(&arena);
+
+	struct mcc_parser_result result = {0};
+	mcc_arena_init(&result.arena);
+	CuAssertTrue(tc, !mcc_ast_cache_load(dir, &other, &result));
+	CuAssertPtrEquals(tc, NULL, result.program);
+	CuAssertPtrEquals(tc, NULL, result.arena.head);
+
+	remove_dir(dir);
+}
+
+void Corrupted(CuTest *tc)
+{
+	char dir[] = "/tmp/mcc_ast_cache_XXXXXX";
+	CuAssertPtrNotNull(tc, mkdtemp(dir));
+
+	struct mcc_ast_cache_key key;
+	mcc_ast_cache_compute_key(&key, "a", 1);
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+	CuAssertTrue(tc, mcc_ast_cache_store(dir, &key, build_program(&arena)));
+	mcc_arena_release(&arena);
+
+	// truncate the only entry
+	DIR *d = opendir(dir);
+	CuAssertPtrNotNull(tc, d);
+	struct dirent *entry;
+	while ((entry = readdir(d))) {
+		if (entry->d_name[0] != '.') {
+			char file[512];
+			snprintf(file, sizeof(file), "%s/%s", dir, entry->d_name);
+			CuAssertIntEquals(tc, 0, truncate(file, 100));
+		}
+	}
+	closedir(d);
+
+	struct mcc_parser_result result = {0};
+	mcc_arena_init(&result.arena);
+	CuAssertTrue(tc, !mcc_ast_cache_load(dir, &key, &result));
+	CuAssertPtrEquals(tc, NULL, result.program);
+
+	remove_dir(dir);
+}
+
+#define TESTS \
+	TEST(RoundTrip) \
+	TEST(Miss) \
+	TEST(Corrupted)
+
+#include "main_stub.inc"
+#undef TESTS
@@ -0,0 +1,271 @@
+#include <CuTest.h>
+
+#include "mcc/arena.h"
+#include "mcc/ast.h"
+#include "mcc/ast_flat.h"
+
+// Builds `-(x) * (1 + 2.5)` with distinct source columns.
+static struct mcc_ast_expression *build_expression(struct mcc_arena *arena)
+{
+	struct mcc_ast_expression *x = mcc_ast_new_expression_identifier(arena, mcc_ast_new_identifier(arena, "x"));
+	struct mcc_ast_expression *neg = mcc_ast_new_expression_unary_op(arena, MCC_AST_UNARY_OP_MINUS, x);
+
+	struct mcc_ast_expression *one = mcc_ast_new_expression_literal(arena, mcc_ast_new_literal_int(arena, 1));
+	struct mcc_ast_expression *two = mcc_ast_new_expression_literal(arena, mcc_ast_new_literal_float(arena, 2.5));
+	struct mcc_ast_expression *add = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_ADD, one, two);
+	struct mcc_ast_expression *par = mcc_ast_new_expression_parenth(arena, add);
+
+	struct mcc_ast_expression *mul = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_MUL, neg, par);
+
+	struct mcc_ast_expression *nodes[] = {x, neg, one, two, add, par, mul};
+	for (int i = 0; i < 7; ++i) {
+		nodes[i]->node.sloc = (struct mcc_ast_source_location){1, i + 1, 1, i + 1};
+	}
+	one->literal->node.sloc = (struct mcc_ast_source_location){2, 1, 2, 1};
+	two->literal->node.sloc = (struct mcc_ast_source_location){2, 2, 2, 2};
+
+	return mul;
+}
+
+void FromExpression_Layout(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_ast_flat flat;
+	mcc_ast_flat_init(&flat);
+
+	mcc_ast_flat_ref root = mcc_ast_flat_from_expression(&flat, build_expression(&arena));
+
+	CuAssertIntEquals(tc, 7, flat.expression_count);
+	CuAssertIntEquals(tc, 2, flat.literal_count);
+	CuAssertIntEquals(tc, 1, flat.identifier_count);
+
+	// post-order: root comes last
+	CuAssertIntEquals(tc, 6, root);
+
+	const struct mcc_ast_flat_expression *mul = &flat.expressions[root];
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_BINARY_OP, mul->type);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_MUL, mul->op);
+	CuAssertTrue(tc, mul->a < root && mul->b < root);
+
+	const struct mcc_ast_flat_expression *neg = &flat.expressions[mul->a];
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_UNARY_OP, neg->type);
+	CuAssertIntEquals(tc, MCC_AST_UNARY_OP_MINUS, neg->op);
+	CuAssertStrEquals(tc, "x", flat.identifiers[flat.expressions[neg->a].a]);
+
+	const struct mcc_ast_flat_expression *add = &flat.expressions[flat.expressions[mul->b].a];
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_BINARY_OP, add->type);
+	CuAssertIntEquals(tc, 1, flat.literals[flat.expressions[add->a].a].i_value);
+	CuAssertDblEquals(tc, 2.5, flat.literals[flat.expressions[add->b].a].f_value, 1e-9);
+
+	// source locations live in the side table
+	CuAssertIntEquals(tc, 7, flat.expression_slocs[root].start_col);
+	CuAssertIntEquals(tc, 2, flat.literal_slocs[flat.expressions[add->b].a].start_col);
+
+	mcc_ast_flat_delete(&flat);
+	mcc_arena_release(&arena);
+}
+
+void ToExpression_RoundTrip(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_ast_flat flat;
+	mcc_ast_flat_init(&flat);
+
+	mcc_ast_flat_ref root = mcc_ast_flat_from_expression(&flat, build_expression(&arena));
+	struct mcc_ast_expression *expr = mcc_ast_flat_to_expression(&flat, root, &arena);
+
+	CuAssertPtrNotNull(tc, expr);
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_BINARY_OP, expr->type);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_MUL, expr->op);
+	CuAssertIntEquals(tc, 7, expr->node.sloc.start_col);
+
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_UNARY_OP, expr->lhs->type);
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_IDENTIFIER, expr->lhs->rhs->type);
+	CuAssertStrEquals(tc, "x", expr->lhs->rhs->identifier->i_value);
+
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_PARENTH, expr->rhs->type);
+	struct mcc_ast_expression *add = expr->rhs->expression;
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_ADD, add->op);
+	CuAssertIntEquals(tc, 1, add->lhs->literal->i_value);
+	CuAssertDblEquals(tc, 2.5, add->rhs->literal->f_value, 1e-9);
+	CuAssertIntEquals(tc, 2, add->rhs->literal->node.sloc.start_col);
+
+	mcc_ast_flat_delete(&flat);
+	mcc_arena_release(&arena);
+}
+
+static void record(const struct mcc_ast_flat *flat, mcc_ast_flat_ref ref, void *userdata)
+{
+	(void)flat;
+
+	mcc_ast_flat_ref **cursor = userdata;
+	*(*cursor)++ = ref;
+}
+
+void Visit_Order(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_ast_flat flat;
+	mcc_ast_flat_init(&flat);
+
+	mcc_ast_flat_ref root = mcc_ast_flat_from_expression(&flat, build_expression(&arena));
+
+	mcc_ast_flat_ref order[7];
+	mcc_ast_flat_ref *cursor = order;
+	struct mcc_ast_flat_visitor visitor = {
+	    .order = MCC_AST_VISIT_POST_ORDER,
+	    .userdata = &cursor,
+	    .expression = record,
+	};
+
+	// post-order equals storage order
+	CuAssertTrue(tc, mcc_ast_flat_visit(&flat, root, &visitor));
+	for (int i = 0; i < 7; ++i) {
+		CuAssertIntEquals(tc, i, order[i]);
+	}
+
+	// pre-order starts at the root and visits lhs before rhs
+	cursor = order;
+	visitor.order = MCC_AST_VISIT_PRE_ORDER;
+	CuAssertTrue(tc, mcc_ast_flat_visit(&flat, root, &visitor));
+	CuAssertIntEquals(tc, root, order[0]);
+	CuAssertIntEquals(tc, flat.expressions[root].a, order[1]);
+	CuAssertIntEquals(tc, flat.expressions[root].b, order[3]);
+
+	mcc_ast_flat_delete(&flat);
+	mcc_arena_release(&arena);
+}
+
+// Builds `f(a[i + 1], g())` with distinct source columns; identifiers start
+// at column 10.
+static struct mcc_ast_expression *build_call(struct mcc_arena *arena)
+{
+	struct mcc_ast_identifier *names[] = {
+	    mcc_ast_new_identifier(arena, "i"),
+	    mcc_ast_new_identifier(arena, "a"),
+	    mcc_ast_new_identifier(arena, "g"),
+	    mcc_ast_new_identifier(arena, "f"),
+	};
+	for (int i = 0; i < 4; ++i) {
+		names[i]->node.sloc = (struct mcc_ast_source_location){1, i + 10, 1, i + 10};
+	}
+
+	struct mcc_ast_expression *i = mcc_ast_new_expression_identifier(arena, names[0]);
+	struct mcc_ast_expression *one = mcc_ast_new_expression_literal(arena, mcc_ast_new_literal_int(arena, 1));
+	struct mcc_ast_expression *add = mcc_ast_new_expression_binary_op(arena, MCC_AST_BINARY_OP_ADD, i, one);
+	struct mcc_ast_expression *element = mcc_ast_new_expression_array_element(arena, names[1], add);
+	struct mcc_ast_expression *g = mcc_ast_new_expression_call(arena, names[2], NULL);
+
+	struct mcc_ast_argument *first = mcc_ast_new_argument(arena, element);
+	first->next = mcc_ast_new_argument(arena, g);
+	struct mcc_ast_expression *f = mcc_ast_new_expression_call(arena, names[3], first);
+
+	struct mcc_ast_expression *nodes[] = {i, one, add, element, g, f};
+	for (int n = 0; n < 6; ++n) {
+		nodes[n]->node.sloc = (struct mcc_ast_source_location){1, n + 1, 1, n + 1};
+	}
+	first->node.sloc = element->node.sloc;
+	first->next->node.sloc = g->node.sloc;
+
+	return f;
+}
+
+void FromExpression_Calls(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_ast_flat flat;
+	mcc_ast_flat_init(&flat);
+
+	mcc_ast_flat_ref root = mcc_ast_flat_from_expression(&flat, build_call(&arena));
+	CuAssertIntEquals(tc, 6, flat.expression_count);
+	CuAssertIntEquals(tc, 5, root);
+
+	const struct mcc_ast_flat_expression *f = &flat.expressions[root];
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_CALL, f->type);
+	CuAssertStrEquals(tc, "f", flat.identifiers[f->a]);
+	CuAssertIntEquals(tc, 13, flat.identifier_slocs[f->a].start_col);
+	CuAssertIntEquals(tc, 2, (int)flat.arguments[f->b]);
+
+	const struct mcc_ast_flat_expression *element = &flat.expressions[flat.arguments[f->b + 1]];
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT, element->type);
+	CuAssertStrEquals(tc, "a", flat.identifiers[element->a]);
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_BINARY_OP, flat.expressions[element->b].type);
+
+	const struct mcc_ast_flat_expression *g = &flat.expressions[flat.arguments[f->b + 2]];
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_CALL, g->type);
+	CuAssertStrEquals(tc, "g", flat.identifiers[g->a]);
+	CuAssertIntEquals(tc, MCC_AST_FLAT_NONE, g->b);
+
+	// post-order equals storage order
+	mcc_ast_flat_ref order[6];
+	mcc_ast_flat_ref *cursor = order;
+	struct mcc_ast_flat_visitor visitor = {
+	    .order = MCC_AST_VISIT_POST_ORDER,
+	    .userdata = &cursor,
+	    .expression = record,
+	};
+	CuAssertTrue(tc, mcc_ast_flat_visit(&flat, root, &visitor));
+	for (int i = 0; i < 6; ++i) {
+		CuAssertIntEquals(tc, i, order[i]);
+	}
+
+	mcc_ast_flat_delete(&flat);
+	mcc_arena_release(&arena);
+}
+
+void ToExpression_Calls(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_ast_flat flat;
+	mcc_ast_flat_init(&flat);
+
+	mcc_ast_flat_ref root = mcc_ast_flat_from_expression(&flat, build_call(&arena));
+	struct mcc_ast_expression *f = mcc_ast_flat_to_expression(&flat, root, &arena);
+
+	CuAssertPtrNotNull(tc, f);
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_CALL, f->type);
+	CuAssertStrEquals(tc, "f", f->function->i_value);
+	CuAssertIntEquals(tc, 13, f->function->node.sloc.start_col);
+	CuAssertIntEquals(tc, 6, f->node.sloc.start_col);
+
+	struct mcc_ast_argument *first = f->arguments;
+	CuAssertPtrNotNull(tc, first);
+	CuAssertIntEquals(tc, 4, first->node.sloc.start_col);
+	struct mcc_ast_expression *element = first->expression;
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT, element->type);
+	CuAssertStrEquals(tc, "a", element->array->i_value);
+	CuAssertIntEquals(tc, 11, element->array->node.sloc.start_col);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_ADD, element->index->op);
+	CuAssertStrEquals(tc, "i", element->index->lhs->identifier->i_value);
+	CuAssertIntEquals(tc, 10, element->index->lhs->identifier->node.sloc.start_col);
+
+	struct mcc_ast_argument *second = first->next;
+	CuAssertPtrNotNull(tc, second);
+	CuAssertPtrEquals(tc, NULL, second->next);
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_CALL, second->expression->type);
+	CuAssertStrEquals(tc, "g", second->expression->function->i_value);
+	CuAssertPtrEquals(tc, NULL, second->expression->arguments);
+
+	mcc_ast_flat_delete(&flat);
+	mcc_arena_release(&arena);
+}
+
+#define TESTS \
+	TEST(FromExpression_Layout) \
+	TEST(ToExpression_RoundTrip) \
+	TEST(Visit_Order) \
+	TEST(FromExpression_Calls) \
+	TEST(ToExpression_Calls)
+
+#include "main_stub.inc"
+#undef TESTS
@@ -0,0 +1,338 @@
+#include <CuTest.h>
+
+#include <string.h>
+
+#include "mcc/ast.h"
+#include "mcc/ast_visit.h"
+#include "mcc/parser.h"
+
+// Records the visited nodes as a string: operators of binary operations,
+// values of int literals, and names of identifiers.
+struct trace {
+	char text[64];
+	size_t len;
+	size_t nodes;
+};
+
+static void trace_append(struct trace *trace, char c)
+{
+	if (trace->len + 1 < sizeof(trace->text)) {
+		trace->text[trace->len++] = c;
+		trace->text[trace->len] = '\0';
+	}
+}
+
+static void trace_binary_op(struct mcc_ast_expression *expression, void *data)
+{
+	static const char ops[] = {
+	    [MCC_AST_BINARY_OP_ADD] = '+',
+	    [MCC_AST_BINARY_OP_SUB] = '-',
+	    [MCC_AST_BINARY_OP_MUL] = '*',
+	    [MCC_AST_BINARY_OP_DIV] = '/',
+	};
+	trace_append(data, expression->op < sizeof(ops) ? ops[expression->op] : '?');
+}
+
+static void trace_literal_int(struct mcc_ast_literal *literal, void *data)
+{
+	trace_append(data, (char)('0' + literal->i_value % 10));
+}
+
+static void trace_identifier(struct mcc_ast_identifier *identifier, void *data)
+{
+	trace_append(data, identifier->i_value[0]);
+}
+
+static void count_expression(struct mcc_ast_expression *expression, void *data)
+{
+	(void)expression;
+	struct trace *trace = data;
+	trace->nodes++;
+}
+
+static struct mcc_ast_visitor trace_visitor(struct trace *trace,
+                                            enum mcc_ast_visit_traversal traversal,
+                                            enum mcc_ast_visit_order order)
+{
+	memset(trace, 0, sizeof(*trace));
+
+	return (struct mcc_ast_visitor){
+	    .traversal = traversal,
+	    .order = order,
+	    .userdata = trace,
+	    .expression = count_expression,
+	    .expression_binary_op = trace_binary_op,
+	    .literal_int = trace_literal_int,
+	    .identifier = trace_identifier,
+	};
+}
+
+void Order(CuTest *tc)
+{
+	struct mcc_parser_result result = mcc_parse_string("1 + 2 * 3 - f(4, a[5])");
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct trace trace;
+	struct mcc_ast_visitor visitor;
+
+	visitor = trace_visitor(&trace, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_PRE_ORDER);
+	CuAssertTrue(tc, mcc_ast_visit(result.expression, &visitor));
+	CuAssertStrEquals(tc, "-+1*23f4a5", trace.text);
+	CuAssertIntEquals(tc, 10, (int)trace.nodes);
+
+	visitor = trace_visitor(&trace, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_POST_ORDER);
+	CuAssertTrue(tc, mcc_ast_visit(result.expression, &visitor));
+	CuAssertStrEquals(tc, "123*+f4a5-", trace.text);
+	CuAssertIntEquals(tc, 10, (int)trace.nodes);
+
+	visitor = trace_visitor(&trace, MCC_AST_VISIT_BREADTH_FIRST, MCC_AST_VISIT_PRE_ORDER);
+	CuAssertTrue(tc, mcc_ast_visit(result.expression, &visitor));
+	CuAssertStrEquals(tc, "-+*f14a235", trace.text);
+	CuAssertIntEquals(tc, 10, (int)trace.nodes);
+
+	mcc_parser_delete_result(&result);
+}
+
+void DeepChain(CuTest *tc)
+{
+	// Deep enough to overflow the native stack of a recursive traversal.
+	const size_t operands = 1000000;
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_ast_expression *chain = mcc_ast_new_expression_literal(&arena, mcc_ast_new_literal_int(&arena, 1));
+	for (size_t i = 1; i < operands; ++i) {
+		struct mcc_ast_expression *rhs =
+		    mcc_ast_new_expression_literal(&arena, mcc_ast_new_literal_int(&arena, (long)i));
+		chain = mcc_ast_new_expression_binary_op(&arena, MCC_AST_BINARY_OP_ADD, chain, rhs);
+		CuAssertPtrNotNull(tc, chain);
+	}
+
+	const enum mcc_ast_visit_traversal traversals[] = {
+	    MCC_AST_VISIT_DEPTH_FIRST,
+	    MCC_AST_VISIT_DEPTH_FIRST,
+	    MCC_AST_VISIT_BREADTH_FIRST,
+	};
+	const enum mcc_ast_visit_order orders[] = {
+	    MCC_AST_VISIT_PRE_ORDER,
+	    MCC_AST_VISIT_POST_ORDER,
+	    MCC_AST_VISIT_PRE_ORDER,
+	};
+
+	for (size_t i = 0; i < sizeof(orders) / sizeof(*orders); ++i) {
+		struct trace trace;
+		struct mcc_ast_visitor visitor = trace_visitor(&trace, traversals[i], orders[i]);
+		CuAssertTrue(tc, mcc_ast_visit(chain, &visitor));
+		CuAssertIntEquals(tc, (int)(2 * operands - 1), (int)trace.nodes);
+	}
+
+	mcc_arena_release(&arena);
+}
+
+struct nested {
+	struct mcc_ast_visitor *visitor;
+	struct mcc_ast_expression *inner;
+	struct trace trace;
+	bool ok;
+};
+
+static void visit_nested(struct mcc_ast_expression *expression, void *data)
+{
+	(void)expression;
+	struct nested *nested = data;
+	struct mcc_ast_visitor inner = trace_visitor(&nested->trace, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_PRE_ORDER);
+	inner.stack = nested->visitor->stack;
+	nested->ok = mcc_ast_visit(nested->inner, &inner) && nested->ok;
+}
+
+void SharedStack(CuTest *tc)
+{
+	struct mcc_parser_result outer = mcc_parse_string("(1 + 2) * (3 + 4)");
+	struct mcc_parser_result inner = mcc_parse_string("5 - 6");
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, outer.status);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, inner.status);
+
+	struct mcc_ast_visit_stack stack = {0};
+	struct nested nested = {.inner = inner.expression, .ok = true};
+
+	const enum mcc_ast_visit_traversal traversals[] = {MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_BREADTH_FIRST};
+
+	for (size_t i = 0; i < sizeof(traversals) / sizeof(*traversals); ++i) {
+		struct mcc_ast_visitor visitor = {
+		    .traversal = traversals[i],
+		    .order = MCC_AST_VISIT_POST_ORDER,
+		    .stack = &stack,
+		    .userdata = &nested,
+		    .expression_literal = visit_nested,
+		};
+		nested.visitor = &visitor;
+
+		CuAssertTrue(tc, mcc_ast_visit(outer.expression, &visitor));
+		CuAssertTrue(tc, nested.ok);
+		CuAssertStrEquals(tc, "-56", nested.trace.text);
+		CuAssertIntEquals(tc, 0, (int)stack.count);
+		CuAssertTrue(tc, stack.capacity > 0);
+	}
+
+	mcc_ast_visit_stack_release(&stack);
+	CuAssertPtrEquals(tc, NULL, stack.frames);
+
+	mcc_parser_delete_result(&inner);
+	mcc_parser_delete_result(&outer);
+}
+
+void Fused(CuTest *tc)
+{
+	struct mcc_parser_result result = mcc_parse_string("1 + 2 * 3 - f(4, a[5])");
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct trace pre, post, literals;
+	struct mcc_ast_visitor pre_visitor = trace_visitor(&pre, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_PRE_ORDER);
+	struct mcc_ast_visitor post_visitor = trace_visitor(&post, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_POST_ORDER);
+	struct mcc_ast_visitor literal_visitor = {
+	    .traversal = MCC_AST_VISIT_DEPTH_FIRST,
+	    .order = MCC_AST_VISIT_POST_ORDER,
+	    .userdata = &literals,
+	    .literal_int = trace_literal_int,
+	};
+	memset(&literals, 0, sizeof(literals));
+
+	struct mcc_ast_visitor *visitors[] = {&pre_visitor, &post_visitor, &literal_visitor};
+	CuAssertTrue(tc, mcc_ast_visit_fused(result.expression, visitors, 3));
+
+	// each visitor sees what it would see on its own
+	CuAssertStrEquals(tc, "-+1*23f4a5", pre.text);
+	CuAssertIntEquals(tc, 10, (int)pre.nodes);
+	CuAssertStrEquals(tc, "123*+f4a5-", post.text);
+	CuAssertIntEquals(tc, 10, (int)post.nodes);
+	CuAssertStrEquals(tc, "12345", literals.text);
+
+	struct trace first, second;
+	struct mcc_ast_visitor bfs[] = {
+	    trace_visitor(&first, MCC_AST_VISIT_BREADTH_FIRST, MCC_AST_VISIT_PRE_ORDER),
+	    trace_visitor(&second, MCC_AST_VISIT_BREADTH_FIRST, MCC_AST_VISIT_POST_ORDER),
+	};
+	struct mcc_ast_visitor *bfs_visitors[] = {&bfs[0], &bfs[1]};
+	CuAssertTrue(tc, mcc_ast_visit_fused(result.expression, bfs_visitors, 2));
+	CuAssertStrEquals(tc, "-+*f14a235", first.text);
+	CuAssertStrEquals(tc, "-+*f14a235", second.text);
+
+	mcc_parser_delete_result(&result);
+}
+
+// Records programs, function definitions, declarations and statements, the
+// latter by their type.
+static void trace_program(struct mcc_ast_program *program, void *data)
+{
+	(void)program;
+	trace_append(data, 'P');
+}
+
+static void trace_function_def(struct mcc_ast_function_def *function_def, void *data)
+{
+	(void)function_def;
+	trace_append(data, 'F');
+}
+
+static void trace_declaration(struct mcc_ast_declaration *declaration, void *data)
+{
+	(void)declaration;
+	trace_append(data, 'D');
+}
+
+static void trace_statement(struct mcc_ast_statement *statement, void *data)
+{
+	static const char types[] = {
+	    [MMC_AST_STATEMENT_TYPE_EXPRESSION] = 'e',
+	    [MCC_AST_STATEMENT_TYPE_IF] = 'i',
+	    [MCC_AST_STATEMENT_TYPE_WHILE] = 'w',
+	    [MCC_AST_STATEMENT_TYPE_DECL] = 'd',
+	    [MCC_AST_STATEMENT_TYPE_ASSGN] = 'a',
+	    [MCC_AST_STATEMENT_TYPE_COMPOUND] = 'c',
+	    [MCC_AST_STATEMENT_TYPE_RETURN] = 'r',
+	};
+	trace_append(data, types[statement->type]);
+}
+
+static void trace_if(struct mcc_ast_statement *statement, void *data)
+{
+	(void)statement;
+	trace_append(data, 'I');
+}
+
+static struct mcc_ast_visitor statement_visitor(struct trace *trace,
+                                                enum mcc_ast_visit_traversal traversal,
+                                                enum mcc_ast_visit_order order)
+{
+	memset(trace, 0, sizeof(*trace));
+
+	return (struct mcc_ast_visitor){
+	    .traversal = traversal,
+	    .order = order,
+	    .userdata = trace,
+	    .expression = count_expression,
+	    .statement = trace_statement,
+	    .declaration = trace_declaration,
+	    .function_def = trace_function_def,
+	    .program = trace_program,
+	};
+}
+
+void Statements(CuTest *tc)
+{
+	struct mcc_parser_result result =
+	    mcc_parse_string("void f(int x) { int y; if (x < 1) y = 2; else return; while (true) f(y); }");
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct trace trace;
+	struct mcc_ast_visitor visitor;
+
+	visitor = statement_visitor(&trace, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_PRE_ORDER);
+	CuAssertTrue(tc, mcc_ast_visit(result.program, &visitor));
+	CuAssertStrEquals(tc, "PFDcdDiarwe", trace.text);
+	CuAssertIntEquals(tc, 7, (int)trace.nodes);
+
+	visitor = statement_visitor(&trace, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_POST_ORDER);
+	CuAssertTrue(tc, mcc_ast_visit(result.program, &visitor));
+	CuAssertStrEquals(tc, "DDdariewcFP", trace.text);
+	CuAssertIntEquals(tc, 7, (int)trace.nodes);
+
+	visitor = statement_visitor(&trace, MCC_AST_VISIT_BREADTH_FIRST, MCC_AST_VISIT_PRE_ORDER);
+	CuAssertTrue(tc, mcc_ast_visit(result.program, &visitor));
+	CuAssertStrEquals(tc, "PFDcdiwDare", trace.text);
+	CuAssertIntEquals(tc, 7, (int)trace.nodes);
+
+	// fused, the specific callback only fires for if statements with else
+	struct trace pre, post, ifs;
+	struct mcc_ast_visitor pre_visitor =
+	    statement_visitor(&pre, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_PRE_ORDER);
+	struct mcc_ast_visitor post_visitor =
+	    statement_visitor(&post, MCC_AST_VISIT_DEPTH_FIRST, MCC_AST_VISIT_POST_ORDER);
+	struct mcc_ast_visitor if_visitor = {
+	    .traversal = MCC_AST_VISIT_DEPTH_FIRST,
+	    .order = MCC_AST_VISIT_PRE_ORDER,
+	    .userdata = &ifs,
+	    .statement_if = trace_statement,
+	    .statement_if_else = trace_if,
+	    .identifier = trace_identifier,
+	};
+	memset(&ifs, 0, sizeof(ifs));
+
+	struct mcc_ast_visitor *visitors[] = {&pre_visitor, &post_visitor, &if_visitor};
+	CuAssertTrue(tc, mcc_ast_visit_fused(result.program->function_def, visitors, 3));
+	CuAssertStrEquals(tc, "FDcdDiarwe", pre.text);
+	CuAssertStrEquals(tc, "DDdariewcF", post.text);
+	CuAssertStrEquals(tc, "fxyIxyfy", ifs.text);
+
+	mcc_parser_delete_result(&result);
+}
+
+#define TESTS \
+	TEST(Order) \
+	TEST(DeepChain) \
+	TEST(SharedStack) \
+	TEST(Fused) \
+	TEST(Statements)
+
+#include "main_stub.inc"
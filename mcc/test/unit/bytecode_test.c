@@ -0,0 +1,224 @@
+#include <CuTest.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/bytecode.h"
+#include "mcc/ir.h"
+#include "mcc/optimize.h"
+#include "mcc/parser.h"
+
+#include "ir_fixture.inc"
+
+// Lowers the program read from `in` into `module`, optimized if `optimize` is
+// set.
+static void lower_file(CuTest *tc, struct mcc_ir_module *module, FILE *in, bool optimize)
+{
+	struct mcc_parser_result result = mcc_parse_file(in);
+	lower_result(tc, module, &result);
+	if (optimize) {
+		CuAssertTrue(tc, mcc_optimize(module, NULL, NULL));
+	}
+}
+
+// Interprets main of `module` with `in` as its input; returns the status and
+// stores the output, to be freed by the caller, in `output`.
+static enum mcc_bytecode_status
+run(CuTest *tc, const struct mcc_ir_module *module, FILE *in, struct mcc_bytecode_result *result, char **output)
+{
+	struct mcc_bytecode bytecode;
+	CuAssertIntEquals(tc, MCC_BYTECODE_OK, mcc_bytecode_compile(&bytecode, module));
+
+	size_t output_size = 0;
+	FILE *out = open_memstream(output, &output_size);
+	CuAssertPtrNotNull(tc, out);
+	enum mcc_bytecode_status status = mcc_bytecode_call(&bytecode, module, "main", in, out, result);
+	fclose(out);
+
+	mcc_bytecode_release(&bytecode);
+	return status;
+}
+
+// Interprets `input` with and without optimizations, checking the result of
+// main and the output.
+static void assert_run(CuTest *tc, const char *input, const char *stdin_text, int expected_result,
+                       const char *expected_output)
+{
+	for (int optimize = 0; optimize <= 1; ++optimize) {
+		FILE *source = fmemopen((void *)input, strlen(input), "r");
+		CuAssertPtrNotNull(tc, source);
+		struct mcc_ir_module module;
+		lower_file(tc, &module, source, optimize);
+		fclose(source);
+
+		FILE *in = fmemopen((void *)stdin_text, strlen(stdin_text) + 1, "r");
+		CuAssertPtrNotNull(tc, in);
+		struct mcc_bytecode_result result;
+		char *output = NULL;
+		CuAssertIntEquals(tc, MCC_BYTECODE_OK, run(tc, &module, in, &result, &output));
+		fclose(in);
+
+		CuAssertIntEquals(tc, expected_result, result.value);
+		CuAssertStrEquals(tc, expected_output, output);
+		CuAssertTrue(tc, result.instructions > 0);
+
+		free(output);
+		mcc_ir_module_release(&module);
+	}
+}
+
+// Interprets `input` without optimizations and returns the status.
+static enum mcc_bytecode_status run_failing(CuTest *tc, const char *input)
+{
+	FILE *source = fmemopen((void *)input, strlen(input), "r");
+	CuAssertPtrNotNull(tc, source);
+	struct mcc_ir_module module;
+	lower_file(tc, &module, source, false);
+	fclose(source);
+
+	struct mcc_bytecode_result result;
+	char *output = NULL;
+	enum mcc_bytecode_status status = run(tc, &module, stdin, &result, &output);
+
+	free(output);
+	mcc_ir_module_release(&module);
+	return status;
+}
+
+// ---------------------------------------------------------------------- Tests
+
+void Arithmetic(CuTest *tc)
+{
+	assert_run(tc, "int main() { int a; a = read_int(); return (a * 6 - 2) / 4 + -a; }", "7", 3, "");
+
+	// ints wrap around at 32 bits
+	assert_run(tc, "int main() { int a; a = 2147483647; print_int(a + 1); return 0; }", "", 0, "-2147483648");
+
+	assert_run(tc, "int main() { float f; f = read_float(); if (f * 2.0 > 4.9 && !(f < 0.0)) return 1; return 0; }",
+	           "2.5", 1, "");
+}
+
+void Builtins(CuTest *tc)
+{
+	assert_run(tc, "int main() { print(\"n=\\t\"); print_int(-42); print_nl(); print_float(1.5 / 3.0); return 0; }",
+	           "", 0, "n=\t-42\n0.50");
+}
+
+void Calls(CuTest *tc)
+{
+	assert_run(tc,
+	           "int fib(int n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }"
+	           "float scale(float x, int n, float y) { return x * y; }"
+	           "void greet(string s) { print(s); }"
+	           "int main() { greet(\"hi \"); print_float(scale(1.5, 3, 4.0)); return fib(20); }",
+	           "", 6765, "hi 6.00");
+}
+
+void Arrays(CuTest *tc)
+{
+	// long enough for the vectorizer to apply in the optimized run
+	assert_run(tc,
+	           "int sum(int[16] a) { int i; int s; s = 0; i = 0;"
+	           "  while (i < 16) { s = s + a[i]; i = i + 1; } return s; }"
+	           "int main() { int[16] a; int[16] b; float[16] f; int i; i = 0;"
+	           "  while (i < 16) { b[i] = i; f[i] = 0.5; i = i + 1; }"
+	           "  i = 0; while (i < 16) { a[i] = b[i] * 2 + 1; f[i] = f[i] * 3.0 - 1.0; i = i + 1; }"
+	           "  print_float(f[15]); return sum(a); }",
+	           "", 256, "0.50");
+
+	// a local array passed to a recursive tail call
+	assert_run(tc,
+	           "void f(int[2] a, int n) { int[2] b; b[0] = a[0] + 1; b[1] = a[0] * 10 + a[1];"
+	           "  if (n == 0) { print_int(b[0]); print(\" \"); print_int(b[1]); return; } f(b, n - 1); }"
+	           "int main() { int[2] x; x[0] = 1; x[1] = 2; f(x, 3); return 0; }",
+	           "", 0, "5 102");
+}
+
+void Errors(CuTest *tc)
+{
+	CuAssertIntEquals(tc, MCC_BYTECODE_DIVISION_ERROR,
+	                  run_failing(tc, "int main() { int a; a = 0; return 1 / a; }"));
+	CuAssertIntEquals(tc, MCC_BYTECODE_OUT_OF_BOUNDS,
+	                  run_failing(tc, "int main() { int[4] a; int i; i = 100000; a[i] = 1; return 0; }"));
+
+	// recursion without end
+	CuAssertIntEquals(tc, MCC_BYTECODE_STACK_OVERFLOW,
+	                  run_failing(tc, "int f(int n) { int[1000] a; return f(n + 1); }"
+	                                  "int main() { return f(0); }"));
+	CuAssertIntEquals(tc, MCC_BYTECODE_NO_FUNCTION, run_failing(tc, "float main() { return 1.0; }"));
+}
+
+// The interpreter serves as the reference of the optimizer: every example
+// prints the expected output both unoptimized and optimized.
+void Examples(CuTest *tc)
+{
+	DIR *examples = opendir(MCC_EXAMPLES_DIR);
+	CuAssertPtrNotNull(tc, examples);
+
+	unsigned count = 0;
+
+	struct dirent *example;
+	while ((example = readdir(examples))) {
+		if (example->d_name[0] == '.') {
+			continue;
+		}
+
+		// examples/<name>/<name>.mc, .stdin.txt and .stdout.txt
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s/%s.stdout.txt", MCC_EXAMPLES_DIR, example->d_name, example->d_name);
+		FILE *expected_file = fopen(path, "r");
+		if (!expected_file) {
+			continue;
+		}
+		char expected[4096];
+		size_t expected_size = fread(expected, 1, sizeof(expected) - 1, expected_file);
+		expected[expected_size] = '\0';
+		fclose(expected_file);
+
+		int results[2];
+		for (int optimize = 0; optimize <= 1; ++optimize) {
+			snprintf(path, sizeof(path), "%s/%s/%s.mc", MCC_EXAMPLES_DIR, example->d_name, example->d_name);
+			FILE *source = fopen(path, "r");
+			CuAssertPtrNotNull(tc, source);
+			struct mcc_ir_module module;
+			lower_file(tc, &module, source, optimize);
+			fclose(source);
+
+			snprintf(path, sizeof(path), "%s/%s/%s.stdin.txt", MCC_EXAMPLES_DIR, example->d_name,
+			         example->d_name);
+			FILE *in = fopen(path, "r");
+			if (!in) {
+				in = fopen("/dev/null", "r");
+			}
+			CuAssertPtrNotNull(tc, in);
+
+			struct mcc_bytecode_result result;
+			char *output = NULL;
+			CuAssertIntEquals(tc, MCC_BYTECODE_OK, run(tc, &module, in, &result, &output));
+			fclose(in);
+
+			CuAssertStrEquals_Msg(tc, example->d_name, expected, output);
+			results[optimize] = result.value;
+
+			free(output);
+			mcc_ir_module_release(&module);
+		}
+		CuAssertIntEquals_Msg(tc, example->d_name, results[0], results[1]);
+		count++;
+	}
+	closedir(examples);
+
+	CuAssertTrue(tc, count > 0);
+}
+
+#define TESTS \
+	TEST(Arithmetic) \
+	TEST(Builtins) \
+	TEST(Calls) \
+	TEST(Arrays) \
+	TEST(Errors) \
+	TEST(Examples)
+
+#include "main_stub.inc"
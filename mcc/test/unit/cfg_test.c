@@ -0,0 +1,167 @@
+#include <CuTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/cfg.h"
+#include "mcc/cfg_print.h"
+#include "mcc/ir.h"
+
+#include "ir_fixture.inc"
+
+static uint32_t predecessor(const struct mcc_cfg *cfg, uint32_t block, uint32_t i)
+{
+	return cfg->predecessors[cfg->blocks[block].predecessor_first + i];
+}
+
+void Blocks(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower_string(tc, &module,
+	      "int f(int n)\n"
+	      "{\n"
+	      "\tint s;\n"
+	      "\ts = 0;\n"
+	      "\twhile (n > 0) {\n"
+	      "\t\tif (n == 3) { return s; }\n"
+	      "\t\ts = s + n;\n"
+	      "\t\tn = n - 1;\n"
+	      "\t}\n"
+	      "\treturn s;\n"
+	      "}\n"
+	      "int main() { return f(5); }\n");
+
+	// B0:  s = 0
+	// B1:  L0: n > 0, ifz goto L1
+	// B2:  n == 3, ifz goto L2
+	// B3:  return s
+	// B4:  L2: s += n, n -= 1, goto L0
+	// B5:  L1: return s
+	const struct mcc_ir_function *function = find(tc, &module, "f");
+	struct mcc_cfg cfg;
+	CuAssertTrue(tc, mcc_cfg_build(&cfg, function));
+	CuAssertIntEquals(tc, 6, (int)cfg.block_count);
+	CuAssertIntEquals(tc, 0, (int)cfg.blocks[0].first);
+	CuAssertIntEquals(tc, (int)function->instruction_count, (int)cfg.blocks[5].end);
+	for (uint32_t b = 1; b < cfg.block_count; ++b) {
+		CuAssertIntEquals(tc, (int)cfg.blocks[b - 1].end, (int)cfg.blocks[b].first);
+	}
+
+	CuAssertIntEquals(tc, 1, (int)cfg.blocks[0].successor_count);
+	CuAssertIntEquals(tc, 1, (int)cfg.blocks[0].successors[0]);
+
+	// fall-through first, then the jump target
+	CuAssertIntEquals(tc, 2, (int)cfg.blocks[1].successor_count);
+	CuAssertIntEquals(tc, 2, (int)cfg.blocks[1].successors[0]);
+	CuAssertIntEquals(tc, 5, (int)cfg.blocks[1].successors[1]);
+	CuAssertIntEquals(tc, 3, (int)cfg.blocks[2].successors[0]);
+	CuAssertIntEquals(tc, 4, (int)cfg.blocks[2].successors[1]);
+	CuAssertIntEquals(tc, 0, (int)cfg.blocks[3].successor_count);
+	CuAssertIntEquals(tc, 1, (int)cfg.blocks[4].successor_count);
+	CuAssertIntEquals(tc, 1, (int)cfg.blocks[4].successors[0]);
+	CuAssertIntEquals(tc, 0, (int)cfg.blocks[5].successor_count);
+
+	// the loop header is entered from the entry and the back edge
+	CuAssertIntEquals(tc, 0, (int)cfg.blocks[0].predecessor_count);
+	CuAssertIntEquals(tc, 2, (int)cfg.blocks[1].predecessor_count);
+	CuAssertIntEquals(tc, 0, (int)predecessor(&cfg, 1, 0));
+	CuAssertIntEquals(tc, 4, (int)predecessor(&cfg, 1, 1));
+	CuAssertIntEquals(tc, 1, (int)cfg.blocks[5].predecessor_count);
+	CuAssertIntEquals(tc, 1, (int)predecessor(&cfg, 5, 0));
+
+	CuAssertIntEquals(tc, 1, (int)cfg.label_blocks[0]);
+	CuAssertIntEquals(tc, 5, (int)cfg.label_blocks[1]);
+	CuAssertIntEquals(tc, 4, (int)cfg.label_blocks[2]);
+
+	// every block precedes its successors in reverse postorder, except
+	// along back edges
+	CuAssertIntEquals(tc, 6, (int)cfg.rpo_count);
+	CuAssertIntEquals(tc, 0, (int)cfg.rpo[0]);
+	for (uint32_t b = 0; b < cfg.block_count; ++b) {
+		CuAssertIntEquals(tc, (int)b, (int)cfg.rpo[cfg.blocks[b].rpo_index]);
+		for (uint32_t s = 0; s < cfg.blocks[b].successor_count; ++s) {
+			uint32_t successor = cfg.blocks[b].successors[s];
+			CuAssertTrue(tc, successor == 1 || cfg.blocks[successor].rpo_index > cfg.blocks[b].rpo_index);
+		}
+	}
+
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		uint32_t b = mcc_cfg_block_of(&cfg, i);
+		CuAssertTrue(tc, cfg.blocks[b].first <= i && i < cfg.blocks[b].end);
+	}
+
+	mcc_cfg_release(&cfg);
+
+	// built-ins have no blocks
+	CuAssertTrue(tc, mcc_cfg_build(&cfg, find(tc, &module, "print")));
+	CuAssertIntEquals(tc, 0, (int)cfg.block_count);
+	CuAssertIntEquals(tc, 0, (int)cfg.rpo_count);
+	mcc_cfg_release(&cfg);
+
+	mcc_ir_module_release(&module);
+}
+
+void Unreachable(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower_string(tc, &module, "int f(int n) { if (n < 0) { return 1; } else { return 2; } }");
+
+	// the `goto` after the `return` of the then-branch and the implicit
+	// `return` at the end cannot be reached
+	const struct mcc_ir_function *function = find(tc, &module, "f");
+	struct mcc_cfg cfg;
+	CuAssertTrue(tc, mcc_cfg_build(&cfg, function));
+	CuAssertIntEquals(tc, 5, (int)cfg.block_count);
+	CuAssertIntEquals(tc, 3, (int)cfg.rpo_count);
+	CuAssertIntEquals(tc, MCC_CFG_UNREACHABLE, (int)cfg.blocks[2].rpo_index);
+	CuAssertIntEquals(tc, MCC_CFG_UNREACHABLE, (int)cfg.blocks[4].rpo_index);
+
+	// unreachable blocks keep their edges
+	CuAssertIntEquals(tc, 1, (int)cfg.blocks[4].predecessor_count);
+	CuAssertIntEquals(tc, 2, (int)predecessor(&cfg, 4, 0));
+
+	mcc_cfg_release(&cfg);
+	mcc_ir_module_release(&module);
+}
+
+void Dot(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower_string(tc, &module, "void f(int n) { while (n > 0) n = n - 1; print(\"a\\b\"); }");
+
+	char *text = NULL;
+	size_t len = 0;
+	FILE *out = open_memstream(&text, &len);
+	CuAssertPtrNotNull(tc, out);
+	CuAssertTrue(tc, mcc_cfg_print_dot(out, &module, "f"));
+	fclose(out);
+
+	CuAssertStrEquals(tc,
+	                  "digraph \"CFG\" {\n"
+	                  "\tnodesep=0.6\n"
+	                  "\tnode [shape=box, fontname=monospace];\n"
+	                  "\tsubgraph \"cluster_f\" {\n"
+	                  "\t\tlabel=\"f\";\n"
+	                  "\t\t\"f.B0\" [label=\"B0\\lL0:\\l    t1 = gt int t0, 0\\l    ifz t1 goto L1\\l\"];\n"
+	                  "\t\t\"f.B1\" [label=\"B1\\l    t2 = sub int t0, 1\\l    t0 = copy int t2\\l"
+	                  "    goto L0\\l\"];\n"
+	                  "\t\t\"f.B2\" [label=\"B2\\lL1:\\l    arg string \\\"a\\\\\\\\b\\\"\\l"
+	                  "    call void print, 1\\l    return\\l\"];\n"
+	                  "\t\t\"f.B0\" -> \"f.B1\" [label=\"true\"];\n"
+	                  "\t\t\"f.B0\" -> \"f.B2\" [label=\"false\"];\n"
+	                  "\t\t\"f.B1\" -> \"f.B0\";\n"
+	                  "\t}\n"
+	                  "}\n",
+	                  text);
+	free(text);
+
+	mcc_ir_module_release(&module);
+}
+
+#define TESTS \
+	TEST(Blocks) \
+	TEST(Unreachable) \
+	TEST(Dot)
+
+#include "main_stub.inc"
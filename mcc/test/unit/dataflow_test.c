@@ -0,0 +1,277 @@
+#include <CuTest.h>
+
+#include <stdlib.h>
+
+#include "mcc/bitset.h"
+#include "mcc/cfg.h"
+#include "mcc/dataflow.h"
+#include "mcc/ir.h"
+#include "mcc/ir_lower.h"
+#include "mcc/liveness.h"
+#include "mcc/parser.h"
+#include "mcc/reaching_definitions.h"
+#include "mcc/type_check.h"
+
+void Bitset(CuTest *tc)
+{
+	// three words, the last one partially used
+	const uint32_t bits = 150;
+	const uint32_t words = MCC_BITSET_WORDS(bits);
+	CuAssertIntEquals(tc, 3, (int)words);
+
+	mcc_bitset_word a[3] = {0};
+	mcc_bitset_word b[3] = {0};
+	MCC_BITSET_SET(a, 0);
+	MCC_BITSET_SET(a, 63);
+	MCC_BITSET_SET(a, 64);
+	MCC_BITSET_SET(a, 149);
+	CuAssertTrue(tc, MCC_BITSET_TEST(a, 63));
+	CuAssertTrue(tc, !MCC_BITSET_TEST(a, 62));
+	CuAssertIntEquals(tc, 4, (int)mcc_bitset_count(a, words));
+
+	CuAssertIntEquals(tc, 0, (int)mcc_bitset_next(a, words, 0));
+	CuAssertIntEquals(tc, 63, (int)mcc_bitset_next(a, words, 1));
+	CuAssertIntEquals(tc, 64, (int)mcc_bitset_next(a, words, 64));
+	CuAssertIntEquals(tc, 149, (int)mcc_bitset_next(a, words, 65));
+	CuAssertIntEquals(tc, MCC_BITSET_END, (int)mcc_bitset_next(a, words, 150));
+	CuAssertIntEquals(tc, MCC_BITSET_END, (int)mcc_bitset_next(a, words, 1000));
+
+	mcc_bitset_fill(b, bits);
+	CuAssertIntEquals(tc, 150, (int)mcc_bitset_count(b, words));
+	MCC_BITSET_CLEAR(b, 64);
+	mcc_bitset_intersect(b, a, words);
+	CuAssertIntEquals(tc, 3, (int)mcc_bitset_count(b, words));
+	CuAssertTrue(tc, !mcc_bitset_equal(a, b, words));
+	mcc_bitset_union(b, a, words);
+	CuAssertTrue(tc, mcc_bitset_equal(a, b, words));
+	mcc_bitset_difference(b, a, words);
+	CuAssertIntEquals(tc, 0, (int)mcc_bitset_count(b, words));
+
+	// dst = gen | (src & ~kill)
+	mcc_bitset_word gen[3] = {0};
+	mcc_bitset_word kill[3] = {0};
+	mcc_bitset_word dst[3] = {0};
+	MCC_BITSET_SET(gen, 100);
+	MCC_BITSET_SET(kill, 63);
+	CuAssertTrue(tc, mcc_bitset_transfer(dst, gen, a, kill, words));
+	CuAssertIntEquals(tc, 4, (int)mcc_bitset_count(dst, words));
+	CuAssertTrue(tc, MCC_BITSET_TEST(dst, 100));
+	CuAssertTrue(tc, !MCC_BITSET_TEST(dst, 63));
+	CuAssertTrue(tc, !mcc_bitset_transfer(dst, gen, a, kill, words));
+}
+
+// Lowers `input` and builds the graph of its function `f`.
+static void build(CuTest *tc, struct mcc_ir_module *module, struct mcc_cfg *cfg, const char *input)
+{
+	struct mcc_parser_result result = mcc_parse_string(input);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_type_check_result check = mcc_type_check(result.program);
+	CuAssertIntEquals(tc, MCC_TYPE_CHECK_OK, check.status);
+
+	mcc_ir_module_init(module);
+	CuAssertTrue(tc, mcc_ir_lower(module, result.program, &check));
+
+	uint32_t index = mcc_ir_find_function(module, "f");
+	CuAssertTrue(tc, index != MCC_IR_OPERAND_MAX);
+	CuAssertTrue(tc, mcc_cfg_build(cfg, &module->functions[index]));
+
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
+}
+
+// Sum of 1 .. n:
+//
+// B0:  t1 = copy int 0            s = 0
+//      t2 = copy int 1            i = 1
+// B1:  L0: t3 = le int t2, t0     while (i <= n)
+//      ifz t3 goto L1
+// B2:  t4 = add int t1, t2        s = s + i
+//      t1 = copy int t4
+//      t5 = add int t2, 1         i = i + 1
+//      t2 = copy int t5
+//      goto L0
+// B3:  L1: return int t1
+static const char sum[] = "int f(int n)\n"
+                          "{\n"
+                          "\tint s; int i;\n"
+                          "\ts = 0; i = 1;\n"
+                          "\twhile (i <= n) { s = s + i; i = i + 1; }\n"
+                          "\treturn s;\n"
+                          "}\n";
+
+static uint32_t set_of(const uint32_t *elements, uint32_t count)
+{
+	uint32_t set = 0;
+	for (uint32_t i = 0; i < count; ++i) {
+		set |= 1u << elements[i];
+	}
+	return set;
+}
+
+#define AssertSet(tc, set, ...) \
+	CuAssertIntEquals(tc, (int)set_of((const uint32_t[]){__VA_ARGS__}, sizeof((uint32_t[]){__VA_ARGS__}) / 4), \
+	                  (int)(uint32_t)(set)[0])
+
+void Liveness(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	struct mcc_cfg cfg;
+	build(tc, &module, &cfg, sum);
+	CuAssertIntEquals(tc, 4, (int)cfg.block_count);
+	CuAssertIntEquals(tc, 6, (int)cfg.function->vreg_count);
+
+	struct mcc_dataflow live;
+	CuAssertTrue(tc, mcc_liveness_compute(&live, &cfg));
+
+	// n, s and i are live around the loop, temporaries only within blocks
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, in, 0), 0);
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, out, 0), 0, 1, 2);
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, in, 1), 0, 1, 2);
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, out, 1), 0, 1, 2);
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, in, 2), 0, 1, 2);
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, out, 2), 0, 1, 2);
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, in, 3), 1);
+	CuAssertIntEquals(tc, 0, (int)mcc_bitset_count(MCC_DATAFLOW_SET(&live, out, 3), live.word_count));
+
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, gen, 2), 1, 2);
+	AssertSet(tc, MCC_DATAFLOW_SET(&live, kill, 2), 1, 2, 4, 5);
+
+	// one pass in postorder plus one to confirm the loop
+	CuAssertTrue(tc, live.visits <= 2 * cfg.block_count);
+
+	mcc_dataflow_release(&live);
+	mcc_cfg_release(&cfg);
+	mcc_ir_module_release(&module);
+}
+
+void ReachingDefinitions(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	struct mcc_cfg cfg;
+	build(tc, &module, &cfg, sum);
+
+	// d0: parameter n, d1: s = 0, d2: i = 1, d3: t3, d4: t4, d5: s = t4,
+	// d6: t5, d7: i = t5
+	struct mcc_reaching_definitions reaching;
+	CuAssertTrue(tc, mcc_reaching_definitions_compute(&reaching, &cfg));
+	CuAssertIntEquals(tc, 8, (int)reaching.definition_count);
+	CuAssertIntEquals(tc, MCC_REACHING_DEFINITIONS_PARAMETER, (int)reaching.instructions[0]);
+	CuAssertIntEquals(tc, 0, (int)reaching.instructions[1]);
+	CuAssertIntEquals(tc, 1, (int)reaching.vregs[1]);
+
+	// definitions grouped by register
+	CuAssertIntEquals(tc, 2, (int)(reaching.vreg_first[2] - reaching.vreg_first[1]));
+	CuAssertIntEquals(tc, 1, (int)reaching.vreg_definitions[reaching.vreg_first[1]]);
+	CuAssertIntEquals(tc, 5, (int)reaching.vreg_definitions[reaching.vreg_first[1] + 1]);
+	CuAssertIntEquals(tc, 8, (int)reaching.vreg_first[cfg.function->vreg_count]);
+
+	const struct mcc_dataflow *dataflow = &reaching.dataflow;
+	AssertSet(tc, MCC_DATAFLOW_SET(dataflow, in, 0), 0);
+	AssertSet(tc, MCC_DATAFLOW_SET(dataflow, out, 0), 0, 1, 2);
+
+	// both definitions of s and i reach the loop header, so does the
+	// condition along the back edge
+	AssertSet(tc, MCC_DATAFLOW_SET(dataflow, in, 1), 0, 1, 2, 3, 4, 5, 6, 7);
+	AssertSet(tc, MCC_DATAFLOW_SET(dataflow, out, 1), 0, 1, 2, 3, 4, 5, 6, 7);
+	AssertSet(tc, MCC_DATAFLOW_SET(dataflow, out, 2), 0, 3, 4, 5, 6, 7);
+	AssertSet(tc, MCC_DATAFLOW_SET(dataflow, in, 3), 0, 1, 2, 3, 4, 5, 6, 7);
+
+	mcc_reaching_definitions_release(&reaching);
+	mcc_cfg_release(&cfg);
+	mcc_ir_module_release(&module);
+}
+
+void Intersection(CuTest *tc)
+{
+	// a diamond with a loop at its bottom:
+	//
+	//   B0:  ifz t0 goto L0
+	//   B1:  t1 = copy int 1; t2 = copy int 2; goto L1
+	//   B2:  L0: t1 = copy int 3
+	//   B3:  L1:
+	//   B4:  L2: ifz t0 goto L3
+	//   B5:  goto L2
+	//   B6:  L3: return
+	struct mcc_ir_module module;
+	struct mcc_cfg cfg;
+	build(tc, &module, &cfg,
+	      "void f(bool b) { int x; int y; if (b) { x = 1; y = 2; } else { x = 3; } while (b) { } }");
+
+	// "must be assigned" with gen = registers written in the block
+	struct mcc_dataflow assigned;
+	CuAssertTrue(tc, mcc_dataflow_init(&assigned, &cfg, MCC_DATAFLOW_FORWARD, MCC_DATAFLOW_INTERSECTION,
+	                                   cfg.function->vreg_count));
+	for (uint32_t b = 0; b < cfg.block_count; ++b) {
+		for (uint32_t i = cfg.blocks[b].first; i < cfg.blocks[b].end; ++i) {
+			mcc_ir_operand def = mcc_ir_defined_vreg(&cfg.function->instructions[i]);
+			if (def != MCC_IR_NONE) {
+				MCC_BITSET_SET(MCC_DATAFLOW_SET(&assigned, gen, b), MCC_IR_OPERAND_INDEX(def));
+			}
+		}
+	}
+	MCC_BITSET_SET(assigned.boundary, 0);
+	mcc_dataflow_solve(&assigned, &cfg);
+
+	// y is only assigned on one path, the loop does not change the result
+	AssertSet(tc, MCC_DATAFLOW_SET(&assigned, out, 1), 0, 1, 2);
+	AssertSet(tc, MCC_DATAFLOW_SET(&assigned, out, 2), 0, 1);
+	AssertSet(tc, MCC_DATAFLOW_SET(&assigned, in, 3), 0, 1);
+	AssertSet(tc, MCC_DATAFLOW_SET(&assigned, in, 4), 0, 1);
+	AssertSet(tc, MCC_DATAFLOW_SET(&assigned, in, 6), 0, 1);
+
+	mcc_dataflow_release(&assigned);
+	mcc_cfg_release(&cfg);
+	mcc_ir_module_release(&module);
+}
+
+void ManyTemporaries(CuTest *tc)
+{
+	// `while (b) { x = x + 1 + ... + 1; }` creates a temporary per `+`,
+	// thousands of registers spread over many words
+	const int operands = 5000;
+
+	struct mcc_ir_module module;
+	struct mcc_cfg cfg;
+	size_t size = (size_t)operands * 4 + 128;
+	char *input = malloc(size);
+	CuAssertPtrNotNull(tc, input);
+	char *p = input + sprintf(input, "int f(bool b, int x) { while (b) { x = x");
+	for (int i = 0; i < operands; ++i) {
+		p += sprintf(p, " + 1");
+	}
+	sprintf(p, "; } return x; }");
+	build(tc, &module, &cfg, input);
+	free(input);
+
+	uint32_t vreg_count = cfg.function->vreg_count;
+	CuAssertTrue(tc, vreg_count > (uint32_t)operands);
+
+	struct mcc_dataflow live;
+	CuAssertTrue(tc, mcc_liveness_compute(&live, &cfg));
+	CuAssertIntEquals(tc, (int)MCC_BITSET_WORDS(vreg_count), (int)live.word_count);
+
+	// only the parameters are live around the loop
+	for (uint32_t b = 0; b < cfg.block_count; ++b) {
+		CuAssertIntEquals(tc, b == cfg.block_count - 1 ? 1 : 2,
+		                  (int)mcc_bitset_count(MCC_DATAFLOW_SET(&live, in, b), live.word_count));
+	}
+	mcc_dataflow_release(&live);
+
+	struct mcc_reaching_definitions reaching;
+	CuAssertTrue(tc, mcc_reaching_definitions_compute(&reaching, &cfg));
+	CuAssertIntEquals(tc, (int)vreg_count + 1, (int)reaching.definition_count);
+	mcc_reaching_definitions_release(&reaching);
+
+	mcc_cfg_release(&cfg);
+	mcc_ir_module_release(&module);
+}
+
+#define TESTS \
+	TEST(Bitset) \
+	TEST(Liveness) \
+	TEST(ReachingDefinitions) \
+	TEST(Intersection) \
+	TEST(ManyTemporaries)
+
+#include "main_stub.inc"
@@ -0,0 +1,161 @@
+#include <CuTest.h>
+
+#include <stdlib.h>
+
+#include "mcc/inline.h"
+#include "mcc/ir.h"
+#include "mcc/optimize.h"
+
+#include "ir_fixture.inc"
+
+// Lowers `input` into `module` and inlines with `limit`, returning the count
+// of calls inlined.
+static uint32_t lower(CuTest *tc, struct mcc_ir_module *module, const char *input, uint32_t limit)
+{
+	lower_string(tc, module, input);
+
+	struct mcc_inline_stats stats = {0};
+	CuAssertTrue(tc, mcc_inline(module, limit, &stats));
+	return stats.inlined_calls;
+}
+
+// Every label is placed once and every jump goes to a placed label.
+static void assert_labels_valid(CuTest *tc, const struct mcc_ir_function *function)
+{
+	uint32_t *placed = calloc(function->label_count + 1, sizeof(*placed));
+	CuAssertPtrNotNull(tc, placed);
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		if (instruction->opcode == MCC_IR_LABEL) {
+			CuAssertTrue(tc, MCC_IR_OPERAND_INDEX(instruction->a) < function->label_count);
+			CuAssertIntEquals(tc, 0, (int)placed[MCC_IR_OPERAND_INDEX(instruction->a)]++);
+		}
+	}
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		if (instruction->opcode == MCC_IR_JUMP) {
+			CuAssertIntEquals(tc, 1, (int)placed[MCC_IR_OPERAND_INDEX(instruction->a)]);
+		} else if (instruction->opcode == MCC_IR_JUMP_IF_FALSE || instruction->opcode == MCC_IR_JUMP_IF_TRUE) {
+			CuAssertIntEquals(tc, 1, (int)placed[MCC_IR_OPERAND_INDEX(instruction->b)]);
+		}
+	}
+	free(placed);
+}
+
+// ---------------------------------------------------------------------- Tests
+
+void Inlined(CuTest *tc)
+{
+	const char input[] = "int square(int x) { return x * x; }\n"
+	                     "int main() { return square(3); }";
+
+	struct mcc_ir_module module;
+	CuAssertIntEquals(tc, 1, (int)lower(tc, &module, input, MCC_INLINE_DEFAULT_LIMIT));
+
+	struct mcc_ir_function *main = find(tc, &module, "main");
+	CuAssertIntEquals(tc, 0, (int)count_opcode(main, MCC_IR_CALL));
+	CuAssertIntEquals(tc, 0, (int)count_opcode(main, MCC_IR_ARG));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(main, MCC_IR_MUL));
+
+	// the callee stays for other callers
+	CuAssertIntEquals(tc, 1, (int)count_opcode(find(tc, &module, "square"), MCC_IR_MUL));
+	mcc_ir_module_release(&module);
+
+	// constants propagate through the inlined body
+	struct mcc_optimize_stats stats;
+	CuAssertIntEquals(tc, 0, (int)lower(tc, &module, input, 0));
+	CuAssertTrue(tc, mcc_optimize(&module, NULL, &stats));
+	CuAssertIntEquals(tc, 1, (int)stats.inlining.inlined_calls);
+
+	main = find(tc, &module, "main");
+	const struct mcc_ir_instruction *ret = &main->instructions[main->instruction_count - 1];
+	CuAssertIntEquals(tc, MCC_IR_RETURN, ret->opcode);
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_CONST, MCC_IR_OPERAND_KIND(ret->a));
+	CuAssertIntEquals(tc, 9, (int)module.constants[MCC_IR_OPERAND_INDEX(ret->a)].i_value);
+	mcc_ir_module_release(&module);
+}
+
+void Body(CuTest *tc)
+{
+	const char input[] = "int pick(int[3] a, int i) { int[2] b; if (i < 0) { return 0; } "
+	                     "b[1] = a[i]; return b[1]; }\n"
+	                     "int main() { int[3] a; a[0] = 1; return pick(a, 0) + pick(a, 2); }";
+
+	struct mcc_ir_module module;
+	CuAssertIntEquals(tc, 2, (int)lower(tc, &module, input, MCC_INLINE_DEFAULT_LIMIT));
+
+	// each copy gets its own arrays and labels
+	struct mcc_ir_function *main = find(tc, &module, "main");
+	CuAssertIntEquals(tc, 0, (int)count_opcode(main, MCC_IR_CALL));
+	CuAssertIntEquals(tc, 3, (int)main->array_count);
+	CuAssertIntEquals(tc, 3, (int)count_opcode(main, MCC_IR_ARRAY));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(main, MCC_IR_RETURN));
+	assert_labels_valid(tc, main);
+
+	mcc_ir_module_release(&module);
+}
+
+void Recursion(CuTest *tc)
+{
+	const char input[] = "int fib(int n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+	                     "bool even(int n) { if (n == 0) return true; return odd(n - 1); }\n"
+	                     "bool odd(int n) { if (n == 0) return false; return even(n - 1); }\n"
+	                     "int twice(int n) { return fib(n) * 2; }\n"
+	                     "int main() { print_int(twice(10)); if (even(4)) return 1; return 0; }";
+
+	struct mcc_ir_module module;
+	CuAssertIntEquals(tc, 1, (int)lower(tc, &module, input, MCC_INLINE_DEFAULT_LIMIT));
+
+	// only twice is inlined, its call of fib is kept
+	struct mcc_ir_function *main = find(tc, &module, "main");
+	CuAssertIntEquals(tc, 3, (int)count_opcode(main, MCC_IR_CALL));
+	CuAssertIntEquals(tc, 2, (int)count_opcode(find(tc, &module, "fib"), MCC_IR_CALL));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(find(tc, &module, "even"), MCC_IR_CALL));
+
+	mcc_ir_module_release(&module);
+}
+
+void Limit(CuTest *tc)
+{
+	// sum costs 6, the loop doubles the limit
+	const char input[] = "int sum(int a, int b, int c) { int s; s = a + b; s = s + c; return s * s; }\n"
+	                     "int main() { int i; i = sum(1, 2, 3); while (i < 10) { i = sum(i, 1, 2); } return i; }";
+
+	struct mcc_ir_module module;
+	CuAssertIntEquals(tc, 0, (int)lower(tc, &module, input, 0));
+	mcc_ir_module_release(&module);
+
+	CuAssertIntEquals(tc, 0, (int)lower(tc, &module, input, 2));
+	mcc_ir_module_release(&module);
+
+	// only the call in the loop
+	CuAssertIntEquals(tc, 1, (int)lower(tc, &module, input, 3));
+	struct mcc_ir_function *main = find(tc, &module, "main");
+	CuAssertIntEquals(tc, 1, (int)count_opcode(main, MCC_IR_CALL));
+	mcc_ir_module_release(&module);
+
+	CuAssertIntEquals(tc, 2, (int)lower(tc, &module, input, 6));
+	mcc_ir_module_release(&module);
+}
+
+void Growth(CuTest *tc)
+{
+	// each call costs the whole limit
+	const char input[] = "int one() { return 1; }\n"
+	                     "int main() { return one() + one() + one() + one() + one() "
+	                     "+ one() + one() + one() + one() + one(); }";
+
+	struct mcc_ir_module module;
+	CuAssertIntEquals(tc, MCC_INLINE_GROWTH, (int)lower(tc, &module, input, 1));
+	CuAssertIntEquals(tc, 10 - MCC_INLINE_GROWTH, (int)count_opcode(find(tc, &module, "main"), MCC_IR_CALL));
+	mcc_ir_module_release(&module);
+}
+
+#define TESTS \
+	TEST(Inlined) \
+	TEST(Body) \
+	TEST(Recursion) \
+	TEST(Limit) \
+	TEST(Growth)
+
+#include "main_stub.inc"
@@ -0,0 +1,99 @@
+#include <CuTest.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mcc/intern.h"
+
+void Intern_SamePointer(CuTest *tc)
+{
+	char a[] = "counter";
+	char b[] = "counter";
+
+	const char *x = mcc_intern(a);
+	const char *y = mcc_intern(b);
+
+	CuAssertPtrNotNull(tc, x);
+	CuAssertPtrEquals(tc, (void *)x, (void *)y);
+	CuAssertStrEquals(tc, "counter", x);
+
+	// the pool keeps its own copy
+	CuAssertTrue(tc, x != a && x != b);
+}
+
+void Intern_Distinct(CuTest *tc)
+{
+	const char *x = mcc_intern("foo");
+	const char *y = mcc_intern("bar");
+	const char *z = mcc_intern("fo");
+
+	CuAssertTrue(tc, x != y);
+	CuAssertTrue(tc, x != z);
+	CuAssertStrEquals(tc, "fo", z);
+}
+
+void Intern_Length(CuTest *tc)
+{
+	const char *x = mcc_intern_n("foobar", 3);
+
+	CuAssertStrEquals(tc, "foo", x);
+	CuAssertPtrEquals(tc, (void *)mcc_intern("foo"), (void *)x);
+}
+
+#define THREAD_COUNT 8
+#define NAME_COUNT 2000
+
+static void *intern_names(void *arg)
+{
+	const char **results = arg;
+
+	char name[32];
+	for (int i = 0; i < NAME_COUNT; ++i) {
+		snprintf(name, sizeof(name), "name_%d", i);
+		results[i] = mcc_intern(name);
+	}
+
+	return NULL;
+}
+
+void Intern_Threads(CuTest *tc)
+{
+	static const char *results[THREAD_COUNT][NAME_COUNT];
+	pthread_t threads[THREAD_COUNT];
+
+	for (int t = 0; t < THREAD_COUNT; ++t) {
+		CuAssertIntEquals(tc, 0, pthread_create(&threads[t], NULL, intern_names, results[t]));
+	}
+	for (int t = 0; t < THREAD_COUNT; ++t) {
+		pthread_join(threads[t], NULL);
+	}
+
+	for (int i = 0; i < NAME_COUNT; ++i) {
+		CuAssertPtrNotNull(tc, results[0][i]);
+		for (int t = 1; t < THREAD_COUNT; ++t) {
+			CuAssertPtrEquals(tc, (void *)results[0][i], (void *)results[t][i]);
+		}
+	}
+}
+
+void Intern_Release(CuTest *tc)
+{
+	mcc_intern_release();
+
+	const char *x = mcc_intern("after_release");
+	CuAssertStrEquals(tc, "after_release", x);
+	CuAssertPtrEquals(tc, (void *)x, (void *)mcc_intern("after_release"));
+
+	mcc_intern_release();
+}
+
+#define TESTS \
+	TEST(Intern_SamePointer) \
+	TEST(Intern_Distinct) \
+	TEST(Intern_Length) \
+	TEST(Intern_Threads) \
+	TEST(Intern_Release)
+
+#include "main_stub.inc"
+#undef TESTS
@@ -0,0 +1,240 @@
+#include <CuTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ast.h"
+#include "mcc/ir.h"
+#include "mcc/ir_lower.h"
+#include "mcc/ir_print.h"
+#include "mcc/type_check.h"
+
+#include "ir_fixture.inc"
+
+void Layout(CuTest *tc)
+{
+	CuAssertIntEquals(tc, 16, (int)sizeof(struct mcc_ir_instruction));
+
+	mcc_ir_operand vreg = MCC_IR_VREG(42);
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_VREG, MCC_IR_OPERAND_KIND(vreg));
+	CuAssertIntEquals(tc, 42, (int)MCC_IR_OPERAND_INDEX(vreg));
+	CuAssertTrue(tc, MCC_IR_IS_VREG(vreg));
+
+	mcc_ir_operand constant = MCC_IR_CONST(MCC_IR_OPERAND_MAX);
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_CONST, MCC_IR_OPERAND_KIND(constant));
+	CuAssertIntEquals(tc, (int)MCC_IR_OPERAND_MAX, (int)MCC_IR_OPERAND_INDEX(constant));
+
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_NONE, MCC_IR_OPERAND_KIND(MCC_IR_NONE));
+	CuAssertTrue(tc, MCC_IR_IMM(0) != MCC_IR_NONE);
+}
+
+void ConstantPool(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	mcc_ir_module_init(&module);
+
+	char text[] = "hello";
+	struct mcc_ir_constant string = {.type = MCC_IR_TYPE_STRING, .s_value = text};
+	uint32_t first = mcc_ir_add_constant(&module, &string);
+
+	// strings are copied and compared by value
+	text[0] = 'j';
+	CuAssertTrue(tc, first != mcc_ir_add_constant(&module, &string));
+	text[0] = 'h';
+	CuAssertIntEquals(tc, (int)first, (int)mcc_ir_add_constant(&module, &string));
+	CuAssertTrue(tc, module.constants[first].s_value != text);
+
+	// enough constants to grow the pool several times
+	for (long i = 0; i < 1000; ++i) {
+		struct mcc_ir_constant value = {.type = MCC_IR_TYPE_INT, .i_value = i};
+		CuAssertIntEquals(tc, (int)(i + 2), (int)mcc_ir_add_constant(&module, &value));
+	}
+	struct mcc_ir_constant value = {.type = MCC_IR_TYPE_INT, .i_value = 7};
+	CuAssertIntEquals(tc, 9, (int)mcc_ir_add_constant(&module, &value));
+
+	// equal bit patterns of different types are distinct
+	struct mcc_ir_constant zero = {.type = MCC_IR_TYPE_FLOAT, .f_value = 0.0};
+	struct mcc_ir_constant negative_zero = {.type = MCC_IR_TYPE_FLOAT, .f_value = -0.0};
+	uint32_t float_zero = mcc_ir_add_constant(&module, &zero);
+	CuAssertTrue(tc, float_zero != 2);
+	CuAssertTrue(tc, float_zero != mcc_ir_add_constant(&module, &negative_zero));
+	CuAssertIntEquals(tc, 1004, (int)module.constant_count);
+
+	mcc_ir_module_release(&module);
+}
+
+void PhiOperands(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	mcc_ir_module_init(&module);
+	uint32_t index = mcc_ir_add_function(&module, "f", MCC_IR_TYPE_VOID);
+	CuAssertIntEquals(tc, 0, (int)index);
+	struct mcc_ir_function *function = &module.functions[index];
+
+	// more operands than the initial capacity in one go
+	CuAssertIntEquals(tc, 0, (int)mcc_ir_add_phi_operands(function, 100));
+	CuAssertIntEquals(tc, 100, (int)mcc_ir_add_phi_operands(function, 3));
+	CuAssertIntEquals(tc, 103, (int)function->phi_operand_count);
+	CuAssertTrue(tc, function->phi_operand_capacity >= 103);
+	for (uint32_t i = 0; i < function->phi_operand_count; ++i) {
+		CuAssertTrue(tc, function->phi_operands[i] == MCC_IR_NONE);
+	}
+
+	// too many to be indexed by an operand, nothing is added
+	uint32_t capacity = function->phi_operand_capacity;
+	uint32_t first = mcc_ir_add_phi_operands(function, MCC_IR_OPERAND_MAX - 200);
+	CuAssertIntEquals(tc, (int)MCC_IR_OPERAND_MAX, (int)first);
+	CuAssertIntEquals(tc, 103, (int)function->phi_operand_count);
+	CuAssertIntEquals(tc, (int)capacity, (int)function->phi_operand_capacity);
+
+	mcc_ir_module_release(&module);
+}
+
+// Lowers `input` and returns the printout of `function`.
+static char *lower(CuTest *tc, const char *input, const char *function)
+{
+	struct mcc_ir_module module;
+	lower_string(tc, &module, input);
+
+	char *text = NULL;
+	size_t len = 0;
+	FILE *out = open_memstream(&text, &len);
+	CuAssertPtrNotNull(tc, out);
+	mcc_ir_print(out, &module, function);
+	fclose(out);
+
+	mcc_ir_module_release(&module);
+	return text;
+}
+
+void Lower(CuTest *tc)
+{
+	const char input[] = "int fib(int n)\n"
+	                     "{\n"
+	                     "\tif (n < 2) return n;\n"
+	                     "\treturn fib(n - 1) + fib(n - 2);\n"
+	                     "}\n"
+	                     "void fill(float[4] a, float x)\n"
+	                     "{\n"
+	                     "\tint i;\n"
+	                     "\ti = 0;\n"
+	                     "\twhile (i < 4) { a[i] = -x; i = i + 1; }\n"
+	                     "}\n"
+	                     "int main()\n"
+	                     "{\n"
+	                     "\tfloat[4] b;\n"
+	                     "\tfill(b, 1.5);\n"
+	                     "\tprint(\"a\n\tb\");\n"
+	                     "\tif (b[0] == 2.0) { } else { print_nl(); }\n"
+	                     "}\n";
+
+	char *text = lower(tc, input, NULL);
+	CuAssertStrEquals(tc,
+	                  "function int fib(int t0)\n"
+	                  "    t1 = lt int t0, 2\n"
+	                  "    ifz t1 goto L0\n"
+	                  "    return int t0\n"
+	                  "L0:\n"
+	                  "    t2 = sub int t0, 1\n"
+	                  "    arg int t2\n"
+	                  "    t3 = call int fib, 1\n"
+	                  "    t4 = sub int t0, 2\n"
+	                  "    arg int t4\n"
+	                  "    t5 = call int fib, 1\n"
+	                  "    t6 = add int t3, t5\n"
+	                  "    return int t6\n"
+	                  "\n"
+	                  "function void fill(address t0, float t1)\n"
+	                  "    t2 = copy int 0\n"
+	                  "L0:\n"
+	                  "    t3 = lt int t2, 4\n"
+	                  "    ifz t3 goto L1\n"
+	                  "    t4 = neg float t1\n"
+	                  "    store float t0[t2], t4\n"
+	                  "    t5 = add int t2, 1\n"
+	                  "    t2 = copy int t5\n"
+	                  "    goto L0\n"
+	                  "L1:\n"
+	                  "    return\n"
+	                  "\n"
+	                  "function int main()\n"
+	                  "    array #0: float[4]\n"
+	                  "    t0 = array float #0\n"
+	                  "    arg address t0\n"
+	                  "    arg float 1.5\n"
+	                  "    call void fill, 2\n"
+	                  "    arg string \"a\\n\\tb\"\n"
+	                  "    call void print, 1\n"
+	                  "    t1 = load float t0[0]\n"
+	                  "    t2 = eq float t1, 2.0\n"
+	                  "    ifz t2 goto L0\n"
+	                  "    goto L1\n"
+	                  "L0:\n"
+	                  "    call void print_nl, 0\n"
+	                  "L1:\n"
+	                  "    return int 0\n",
+	                  text);
+	free(text);
+}
+
+void Shadowing(CuTest *tc)
+{
+	char *text = lower(tc, "void f(int x) { { bool x; x = true; } x = 1; }", "f");
+	CuAssertStrEquals(tc,
+	                  "function void f(int t0)\n"
+	                  "    t1 = copy bool true\n"
+	                  "    t0 = copy int 1\n"
+	                  "    return\n",
+	                  text);
+	free(text);
+}
+
+void DeepChain(CuTest *tc)
+{
+	// `return 1 + 1 + ... + 1;` of one million operands
+	const size_t operands = 1000000;
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_ast_expression *chain = mcc_ast_new_expression_literal(&arena, mcc_ast_new_literal_int(&arena, 1));
+	for (size_t i = 1; i < operands; ++i) {
+		struct mcc_ast_expression *rhs = mcc_ast_new_expression_literal(&arena, mcc_ast_new_literal_int(&arena, 1));
+		chain = mcc_ast_new_expression_binary_op(&arena, MCC_AST_BINARY_OP_ADD, chain, rhs);
+		CuAssertPtrNotNull(tc, chain);
+	}
+
+	struct mcc_ast_statement *body = mcc_ast_new_statement_compound(
+	    &arena, mcc_ast_new_statement_list(&arena, mcc_ast_new_statement_return(&arena, chain)));
+	struct mcc_ast_function_def *main_def =
+	    mcc_ast_new_function_def(&arena, MCC_AST_DATA_TYPE_INT, mcc_ast_new_identifier(&arena, "main"), NULL, body);
+	struct mcc_ast_program *program = mcc_ast_new_program(&arena, main_def);
+	CuAssertPtrNotNull(tc, program);
+
+	struct mcc_type_check_result check = mcc_type_check(program);
+	CuAssertIntEquals(tc, MCC_TYPE_CHECK_OK, check.status);
+
+	struct mcc_ir_module module;
+	mcc_ir_module_init(&module);
+	CuAssertTrue(tc, mcc_ir_lower(&module, program, &check));
+
+	const struct mcc_ir_function *function = find(tc, &module, "main");
+	CuAssertIntEquals(tc, (int)operands, (int)function->instruction_count);
+	CuAssertIntEquals(tc, MCC_IR_RETURN, function->instructions[function->instruction_count - 1].opcode);
+	CuAssertIntEquals(tc, 1, (int)module.constant_count);
+
+	mcc_ir_module_release(&module);
+	mcc_type_check_delete_result(&check);
+	mcc_arena_release(&arena);
+}
+
+#define TESTS \
+	TEST(Layout) \
+	TEST(ConstantPool) \
+	TEST(PhiOperands) \
+	TEST(Lower) \
+	TEST(Shadowing) \
+	TEST(DeepChain)
+
+#include "main_stub.inc"
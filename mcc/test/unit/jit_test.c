@@ -0,0 +1,184 @@
+#include <CuTest.h>
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ir.h"
+#include "mcc/jit.h"
+#include "mcc/optimize.h"
+
+#include "ir_fixture.inc"
+
+// Output of the built-in functions below.
+static char output[256];
+
+static void append(const char *format, ...)
+{
+	size_t length = strlen(output);
+	va_list args;
+	va_start(args, format);
+	vsnprintf(output + length, sizeof(output) - length, format, args);
+	va_end(args);
+}
+
+static void test_print(const char *msg)
+{
+	append("%s", msg);
+}
+
+static void test_print_nl(void)
+{
+	append("\n");
+}
+
+static void test_print_int(long x)
+{
+	append("%ld", x);
+}
+
+static void test_print_float(float x)
+{
+	append("%.2f", x);
+}
+
+static long test_read_int(void)
+{
+	return 7;
+}
+
+#define SYMBOL(name, function) {name, (void (*)(void))function}
+
+static const struct mcc_jit_symbol symbols[] = {
+	SYMBOL("print", test_print),
+	SYMBOL("print_nl", test_print_nl),
+	SYMBOL("print_int", test_print_int),
+	SYMBOL("print_float", test_print_float),
+	SYMBOL("read_int", test_read_int),
+};
+
+// Lowers `input` into `module`, optimized if `optimize` is set.
+static void lower(CuTest *tc, struct mcc_ir_module *module, const char *input, bool optimize)
+{
+	lower_string(tc, module, input);
+	if (optimize) {
+		CuAssertTrue(tc, mcc_optimize(module, NULL, NULL));
+	}
+}
+
+// Compiles and runs `input` with and without optimizations, checking the
+// result of main and the output.
+static void assert_run(CuTest *tc, const char *input, int expected_result, const char *expected_output)
+{
+	for (int optimize = 0; optimize <= 1; ++optimize) {
+		struct mcc_ir_module module;
+		lower(tc, &module, input, optimize);
+
+		struct mcc_jit jit;
+		uint32_t symbol_count = sizeof(symbols) / sizeof(*symbols);
+		CuAssertIntEquals(tc, MCC_JIT_OK, mcc_jit_compile(&jit, &module, symbols, symbol_count));
+
+		output[0] = '\0';
+		int result = -1;
+		CuAssertTrue(tc, mcc_jit_call(&jit, &module, "main", &result));
+		CuAssertIntEquals(tc, expected_result, result);
+		CuAssertStrEquals(tc, expected_output, output);
+
+		mcc_jit_release(&jit);
+		mcc_ir_module_release(&module);
+	}
+}
+
+// ---------------------------------------------------------------------- Tests
+
+void Arithmetic(CuTest *tc)
+{
+	assert_run(tc, "int main() { int a; a = read_int(); return (a * 6 - 2) / 4 + -a; }", 3, "");
+	assert_run(tc, "int main() { float f; f = 2.5; if (f * 2.0 > 4.9 && !(f < 0.0)) return 1; return 0; }", 1, "");
+}
+
+void Builtins(CuTest *tc)
+{
+	assert_run(tc,
+	           "int main() { print(\"n=\\t\"); print_int(-42); print_nl(); print_float(1.5 / 3.0); return 0; }", 0,
+	           "n=\t-42\n0.50");
+}
+
+void Calls(CuTest *tc)
+{
+	assert_run(tc,
+	           "int fib(int n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }"
+	           "float scale(float x, int n, float y) { return x * y; }"
+	           "int main() { print_float(scale(1.5, 3, 4.0)); return fib(20); }",
+	           6765, "6.00");
+}
+
+void Arrays(CuTest *tc)
+{
+	// long enough for the vectorizer to apply in the optimized run
+	assert_run(tc,
+	           "int sum(int[16] a) { int i; int s; s = 0; i = 0;"
+	           "  while (i < 16) { s = s + a[i]; i = i + 1; } return s; }"
+	           "int main() { int[16] a; int[16] b; int i; i = 0;"
+	           "  while (i < 16) { b[i] = i; i = i + 1; }"
+	           "  i = 0; while (i < 16) { a[i] = b[i] * 2 + 1; i = i + 1; }"
+	           "  return sum(a); }",
+	           256, "");
+}
+
+void UndefinedSymbol(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower(tc, &module, "int main() { print_int(1); return 0; }", false);
+
+	struct mcc_jit jit;
+	CuAssertIntEquals(tc, MCC_JIT_UNDEFINED_SYMBOL, mcc_jit_compile(&jit, &module, symbols, 2));
+	CuAssertStrEquals(tc, "print_int", jit.undefined_symbol);
+	CuAssertTrue(tc, jit.code == NULL);
+
+	mcc_jit_release(&jit);
+	mcc_ir_module_release(&module);
+}
+
+void Empty(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower(tc, &module, "", false);
+
+	struct mcc_jit jit;
+	uint32_t symbol_count = sizeof(symbols) / sizeof(*symbols);
+	CuAssertIntEquals(tc, MCC_JIT_OK, mcc_jit_compile(&jit, &module, symbols, symbol_count));
+
+	int result;
+	CuAssertTrue(tc, !mcc_jit_call(&jit, &module, "main", &result));
+
+	mcc_jit_release(&jit);
+	mcc_ir_module_release(&module);
+}
+
+void Unsupported(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower(tc, &module, "int main() { return 0; }", false);
+
+	struct mcc_jit jit;
+	CuAssertIntEquals(tc, MCC_JIT_UNSUPPORTED, mcc_jit_compile(&jit, &module, symbols, 0));
+
+	mcc_jit_release(&jit);
+	mcc_ir_module_release(&module);
+}
+
+#ifdef __x86_64__
+#define TESTS \
+	TEST(Arithmetic) \
+	TEST(Builtins) \
+	TEST(Calls) \
+	TEST(Arrays) \
+	TEST(UndefinedSymbol) \
+	TEST(Empty)
+#else
+#define TESTS TEST(Unsupported)
+#endif
+
+#include "main_stub.inc"
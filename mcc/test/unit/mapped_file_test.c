@@ -0,0 +1,80 @@
+#include <CuTest.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "mcc/mapped_file.h"
+
+// Creates a temporary file of `len` bytes and maps it.
+static void check_size(CuTest *tc, size_t len)
+{
+	char path[] = "/tmp/mcc_mapped_file_XXXXXX";
+	int fd = mkstemp(path);
+	CuAssertTrue(tc, fd >= 0);
+
+	char *content = malloc(len + 1);
+	CuAssertPtrNotNull(tc, content);
+	for (size_t i = 0; i < len; ++i) {
+		content[i] = 'a' + i % 26;
+	}
+	CuAssertTrue(tc, write(fd, content, len) == (ssize_t)len);
+	close(fd);
+
+	struct mcc_mapped_file file;
+	CuAssertTrue(tc, mcc_mapped_file_open(&file, path));
+	CuAssertTrue(tc, file.len == len);
+	CuAssertTrue(tc, memcmp(file.data, content, len) == 0);
+	CuAssertIntEquals(tc, '\0', file.data[len]);
+	CuAssertIntEquals(tc, '\0', file.data[len + 1]);
+
+	// the mapping is writable but private
+	if (len > 0) {
+		file.data[0] = '#';
+	}
+	mcc_mapped_file_close(&file);
+
+	FILE *in = fopen(path, "r");
+	CuAssertPtrNotNull(tc, in);
+	if (len > 0) {
+		CuAssertIntEquals(tc, 'a', fgetc(in));
+	}
+	fclose(in);
+
+	unlink(path);
+	free(content);
+}
+
+void Open_Sizes(CuTest *tc)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	size_t sizes[] = {0, 1, 100, page - 2, page - 1, page, page + 1, 3 * page - 1};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+		check_size(tc, sizes[i]);
+	}
+}
+
+void Open_Missing(CuTest *tc)
+{
+	struct mcc_mapped_file file;
+	CuAssertTrue(tc, !mcc_mapped_file_open(&file, "/nonexistent/input.mc"));
+	CuAssertIntEquals(tc, ENOENT, errno);
+}
+
+void Open_NotRegular(CuTest *tc)
+{
+	struct mcc_mapped_file file;
+	CuAssertTrue(tc, !mcc_mapped_file_open(&file, "/tmp"));
+	CuAssertIntEquals(tc, ENODEV, errno);
+}
+
+#define TESTS \
+	TEST(Open_Sizes) \
+	TEST(Open_Missing) \
+	TEST(Open_NotRegular)
+
+#include "main_stub.inc"
+#undef TESTS
@@ -0,0 +1,173 @@
+#include <CuTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/object.h"
+
+// Encodes the lines of `input` as the function `f` of `object`.
+static void add_function(CuTest *tc, struct mcc_object *object, const char *const *input)
+{
+	struct mcc_peephole_code code;
+	mcc_peephole_code_init(&code);
+	for (const char *const *line = input; *line; ++line) {
+		CuAssertTrue(tc, mcc_peephole_append(&code, *line));
+	}
+	CuAssertTrue(tc, mcc_object_add_function(object, "f", &code));
+	mcc_peephole_code_release(&code);
+}
+
+// Encodes `line` and compares the code with the `size` bytes of `expected`.
+static void assert_encoding(CuTest *tc, const char *line, const uint8_t *expected, uint32_t size)
+{
+	const char *const input[] = {line, NULL};
+	struct mcc_object object;
+	mcc_object_init(&object);
+	add_function(tc, &object, input);
+
+	char message[256];
+	snprintf(message, sizeof(message), "encoding of '%s'", line);
+	CuAssertIntEquals_Msg(tc, message, (int)size, (int)object.text.size);
+	CuAssert(tc, message, memcmp(expected, object.text.data, size) == 0);
+	mcc_object_release(&object);
+}
+
+#define ASSERT_ENCODING(tc, line, ...) \
+	assert_encoding(tc, line, (const uint8_t[]){__VA_ARGS__}, sizeof((const uint8_t[]){__VA_ARGS__}))
+
+static uint32_t get32(const uint8_t *data)
+{
+	return (uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+// ---------------------------------------------------------------------- Tests
+
+void Integer(CuTest *tc)
+{
+	ASSERT_ENCODING(tc, "pushl %ebp", 0x55);
+	ASSERT_ENCODING(tc, "movl %esp, %ebp", 0x89, 0xE5);
+	ASSERT_ENCODING(tc, "movl $7, %eax", 0xB8, 0x07, 0x00, 0x00, 0x00);
+	ASSERT_ENCODING(tc, "movl 8(%ebp), %ecx", 0x8B, 0x4D, 0x08);
+	ASSERT_ENCODING(tc, "movl %eax, -260(%ebp)", 0x89, 0x85, 0xFC, 0xFE, 0xFF, 0xFF);
+	ASSERT_ENCODING(tc, "movl %edx, 4(%esp)", 0x89, 0x54, 0x24, 0x04);
+	ASSERT_ENCODING(tc, "movl (%eax,%ecx,4), %edx", 0x8B, 0x14, 0x88);
+	ASSERT_ENCODING(tc, "movl $1, (%esp)", 0xC7, 0x04, 0x24, 0x01, 0x00, 0x00, 0x00);
+	ASSERT_ENCODING(tc, "leal -40(%ebp), %eax", 0x8D, 0x45, 0xD8);
+	ASSERT_ENCODING(tc, "subl $16, %esp", 0x83, 0xEC, 0x10);
+	ASSERT_ENCODING(tc, "addl $1000, %esp", 0x81, 0xC4, 0xE8, 0x03, 0x00, 0x00);
+	ASSERT_ENCODING(tc, "cmpl %edi, %esi", 0x39, 0xFE);
+	ASSERT_ENCODING(tc, "xorl -4(%ebp), %eax", 0x33, 0x45, 0xFC);
+	ASSERT_ENCODING(tc, "imull $3, %ebx", 0x6B, 0xDB, 0x03);
+	ASSERT_ENCODING(tc, "imull %ecx, %eax", 0x0F, 0xAF, 0xC1);
+	ASSERT_ENCODING(tc, "idivl %ecx", 0xF7, 0xF9);
+	ASSERT_ENCODING(tc, "setle %al", 0x0F, 0x9E, 0xC0);
+	ASSERT_ENCODING(tc, "movzbl %al, %eax", 0x0F, 0xB6, 0xC0);
+	ASSERT_ENCODING(tc, "andb %cl, %al", 0x20, 0xC8);
+	ASSERT_ENCODING(tc, "cltd", 0x99);
+	ASSERT_ENCODING(tc, "ret", 0xC3);
+}
+
+void Float(CuTest *tc)
+{
+	ASSERT_ENCODING(tc, "flds -8(%ebp)", 0xD9, 0x45, 0xF8);
+	ASSERT_ENCODING(tc, "fdivs -4(%ebp)", 0xD8, 0x75, 0xFC);
+	ASSERT_ENCODING(tc, "fucomip %st(1), %st", 0xDF, 0xE9);
+	ASSERT_ENCODING(tc, "fstp %st(0)", 0xDD, 0xD8);
+	ASSERT_ENCODING(tc, "movss -8(%ebp), %xmm2", 0xF3, 0x0F, 0x10, 0x55, 0xF8);
+	ASSERT_ENCODING(tc, "movss %xmm2, -8(%ebp)", 0xF3, 0x0F, 0x11, 0x55, 0xF8);
+	ASSERT_ENCODING(tc, "movaps %xmm3, %xmm0", 0x0F, 0x28, 0xC3);
+	ASSERT_ENCODING(tc, "subss %xmm1, %xmm0", 0xF3, 0x0F, 0x5C, 0xC1);
+	ASSERT_ENCODING(tc, "ucomiss %xmm0, %xmm1", 0x0F, 0x2E, 0xC8);
+	ASSERT_ENCODING(tc, "movups (%eax,%ecx,4), %xmm0", 0x0F, 0x10, 0x04, 0x88);
+	ASSERT_ENCODING(tc, "paddd %xmm1, %xmm0", 0x66, 0x0F, 0xFE, 0xC1);
+	ASSERT_ENCODING(tc, "movd %eax, %xmm0", 0x66, 0x0F, 0x6E, 0xC0);
+	ASSERT_ENCODING(tc, "pshufd $0, %xmm0, %xmm1", 0x66, 0x0F, 0x70, 0xC8, 0x00);
+}
+
+void Jumps(CuTest *tc)
+{
+	static const char *const input[] = {".L0:", "testl %eax, %eax", "je .L1", "jmp .L0", ".L1:", "ret", NULL};
+
+	struct mcc_object object;
+	mcc_object_init(&object);
+	add_function(tc, &object, input);
+
+	static const uint8_t expected[] = {0x85, 0xC0, 0x0F, 0x84, 0x05, 0x00, 0x00, 0x00,
+	                                   0xE9, 0xF3, 0xFF, 0xFF, 0xFF, 0xC3};
+	CuAssertIntEquals(tc, sizeof(expected), object.text.size);
+	CuAssertTrue(tc, memcmp(expected, object.text.data, sizeof(expected)) == 0);
+	CuAssertIntEquals(tc, 0, object.relocation_count);
+	mcc_object_release(&object);
+}
+
+void References(CuTest *tc)
+{
+	static const char *const input[] = {"movl $.LC0, (%esp)", "call print", "movss .LC1, %xmm0", NULL};
+
+	struct mcc_object object;
+	mcc_object_init(&object);
+	add_function(tc, &object, input);
+	CuAssertTrue(tc, mcc_object_add_data(&object, ".LC0", "hi", 3, 1));
+	CuAssertTrue(tc, mcc_object_add_data(&object, ".LC1", "\0\0\x80\x3f", 4, 4));
+
+	CuAssertIntEquals(tc, 3, object.relocation_count);
+	CuAssertStrEquals(tc, ".LC0", object.relocations[0].symbol);
+	CuAssertIntEquals(tc, 3, object.relocations[0].offset);
+	CuAssertStrEquals(tc, "print", object.relocations[1].symbol);
+	CuAssertTrue(tc, object.relocations[1].relative);
+	CuAssertStrEquals(tc, ".LC1", object.relocations[2].symbol);
+
+	// the float is aligned
+	CuAssertIntEquals(tc, 8, object.rodata.size);
+	CuAssertIntEquals(tc, 4, object.symbols[2].offset);
+	mcc_object_release(&object);
+}
+
+void ElfFile(CuTest *tc)
+{
+	static const char *const input[] = {"movl $.LC0, (%esp)", "call print", "call f", "ret", NULL};
+
+	struct mcc_object object;
+	mcc_object_init(&object);
+	add_function(tc, &object, input);
+	CuAssertTrue(tc, mcc_object_add_data(&object, ".LC0", "hi", 3, 1));
+
+	char *file = NULL;
+	size_t file_size = 0;
+	FILE *out = open_memstream(&file, &file_size);
+	CuAssertPtrNotNull(tc, out);
+	CuAssertTrue(tc, mcc_object_write(out, &object));
+	fclose(out);
+
+	// ELF32, little endian, relocatable, i386
+	const uint8_t *data = (const uint8_t *)file;
+	CuAssertTrue(tc, file_size > 52);
+	CuAssertTrue(tc, memcmp(data, "\x7f" "ELF\x01\x01\x01", 7) == 0);
+	CuAssertIntEquals(tc, 1, data[16]);
+	CuAssertIntEquals(tc, 3, data[18]);
+
+	// the relocations of .text, section 2
+	uint32_t section_headers = get32(&data[32]);
+	const uint8_t *rel_header = &data[section_headers + 2 * 40];
+	CuAssertIntEquals(tc, 9, get32(&rel_header[4]));
+	CuAssertIntEquals(tc, 3 * 8, get32(&rel_header[20]));
+
+	// .rodata by its section symbol, print undefined after f
+	const uint8_t *rel = &data[get32(&rel_header[16])];
+	CuAssertIntEquals(tc, 2 << 8 | 1, get32(&rel[4]));
+	CuAssertIntEquals(tc, 4 << 8 | 2, get32(&rel[12]));
+	CuAssertIntEquals(tc, 3 << 8 | 2, get32(&rel[20]));
+
+	free(file);
+	mcc_object_release(&object);
+}
+
+#define TESTS \
+	TEST(Integer) \
+	TEST(Float) \
+	TEST(Jumps) \
+	TEST(References) \
+	TEST(ElfFile)
+
+#include "main_stub.inc"
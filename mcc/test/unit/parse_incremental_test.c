@@ -0,0 +1,457 @@
+#include <CuTest.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ast.h"
+#include "mcc/parser.h"
+
+// An incremental parse has to build the same tree as parsing the edited text
+// from scratch: same node types, values, and source locations. Identifiers
+// are interned, hence compared by pointer.
+
+#define SAME_SLOC(a, b) (memcmp(&(a)->node.sloc, &(b)->node.sloc, sizeof((a)->node.sloc)) == 0)
+
+static bool same_expression(const struct mcc_ast_expression *a, const struct mcc_ast_expression *b);
+
+static bool same_identifier(const struct mcc_ast_identifier *a, const struct mcc_ast_identifier *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	return SAME_SLOC(a, b) && a->i_value == b->i_value;
+}
+
+static bool same_literal(const struct mcc_ast_literal *a, const struct mcc_ast_literal *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	if (!SAME_SLOC(a, b) || a->type != b->type) {
+		return false;
+	}
+
+	switch (a->type) {
+	case MCC_AST_LITERAL_TYPE_INT:
+		return a->i_value == b->i_value;
+	case MCC_AST_LITERAL_TYPE_FLOAT:
+		return a->f_value == b->f_value;
+	case MCC_AST_LITERAL_TYPE_STRING:
+		return strcmp(a->s_value, b->s_value) == 0;
+	case MCC_AST_LITERAL_TYPE_BOOL:
+		return a->b_value == b->b_value;
+	}
+	return false;
+}
+
+static bool same_arguments(const struct mcc_ast_argument *a, const struct mcc_ast_argument *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (!SAME_SLOC(a, b) || !same_expression(a->expression, b->expression)) {
+			return false;
+		}
+	}
+	return a == b;
+}
+
+static bool same_expression(const struct mcc_ast_expression *a, const struct mcc_ast_expression *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	if (!SAME_SLOC(a, b) || a->type != b->type) {
+		return false;
+	}
+
+	switch (a->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		return same_literal(a->literal, b->literal);
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		return a->op == b->op && same_expression(a->lhs, b->lhs) && same_expression(a->rhs, b->rhs);
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		return a->up == b->up && same_expression(a->rhs, b->rhs);
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		return same_expression(a->expression, b->expression);
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+		return same_identifier(a->identifier, b->identifier);
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+		return same_identifier(a->array, b->array) && same_expression(a->index, b->index);
+	case MCC_AST_EXPRESSION_TYPE_CALL:
+		return same_identifier(a->function, b->function) && same_arguments(a->arguments, b->arguments);
+	default:
+		return false;
+	}
+}
+
+static bool same_declaration(const struct mcc_ast_declaration *a, const struct mcc_ast_declaration *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	return SAME_SLOC(a, b) && a->type == b->type && same_literal(a->array_size, b->array_size) &&
+	       same_identifier(a->identifier, b->identifier);
+}
+
+static bool same_statement(const struct mcc_ast_statement *a, const struct mcc_ast_statement *b);
+
+static bool same_statement_list(const struct mcc_ast_statement_list *a, const struct mcc_ast_statement_list *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (!SAME_SLOC(a, b) || !same_statement(a->statement, b->statement)) {
+			return false;
+		}
+	}
+	return a == b;
+}
+
+static bool same_statement(const struct mcc_ast_statement *a, const struct mcc_ast_statement *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	if (!SAME_SLOC(a, b) || a->type != b->type) {
+		return false;
+	}
+
+	switch (a->type) {
+	case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+		return same_expression(a->expression, b->expression);
+	case MCC_AST_STATEMENT_TYPE_IF:
+		return same_expression(a->if_condition, b->if_condition) && same_statement(a->if_stmt, b->if_stmt) &&
+		       same_statement(a->else_stmt, b->else_stmt);
+	case MCC_AST_STATEMENT_TYPE_WHILE:
+		return same_expression(a->while_condition, b->while_condition) &&
+		       same_statement(a->while_stmt, b->while_stmt);
+	case MCC_AST_STATEMENT_TYPE_DECL:
+		return same_declaration(a->declaration, b->declaration);
+	case MCC_AST_STATEMENT_TYPE_ASSGN:
+		return same_identifier(a->id_assgn, b->id_assgn) && same_expression(a->lhs_assgn, b->lhs_assgn) &&
+		       same_expression(a->rhs_assgn, b->rhs_assgn);
+	case MCC_AST_STATEMENT_TYPE_COMPOUND:
+		return same_statement_list(a->compound_statement, b->compound_statement);
+	case MCC_AST_STATEMENT_TYPE_RETURN:
+		return same_expression(a->return_value, b->return_value);
+	}
+	return false;
+}
+
+static bool same_parameters(const struct mcc_ast_parameter *a, const struct mcc_ast_parameter *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (!SAME_SLOC(a, b) || !same_declaration(a->declaration, b->declaration)) {
+			return false;
+		}
+	}
+	return a == b;
+}
+
+static bool same_program(const struct mcc_ast_program *a, const struct mcc_ast_program *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	if (!SAME_SLOC(a, b)) {
+		return false;
+	}
+
+	const struct mcc_ast_function_def *fa = a->function_def;
+	const struct mcc_ast_function_def *fb = b->function_def;
+	const struct mcc_ast_function_def *last = NULL;
+	for (; fa && fb; fa = fa->next, fb = fb->next) {
+		if (!SAME_SLOC(fa, fb) || fa->type != fb->type || !same_identifier(fa->identifier, fb->identifier) ||
+		    !same_parameters(fa->parameter, fb->parameter) ||
+		    !same_statement(fa->compund_statement, fb->compund_statement)) {
+			return false;
+		}
+		last = fa;
+	}
+
+	// appending has to keep working
+	return fa == fb && a->last_function_def == last;
+}
+
+// Returns the line and column of `offset` in `text`.
+static void position_of(const char *text, size_t offset, int *line, int *col)
+{
+	*line = 1;
+	*col = 1;
+	for (size_t i = 0; i < offset; ++i) {
+		if (text[i] == '\n') {
+			++*line;
+			*col = 1;
+		} else {
+			++*col;
+		}
+	}
+}
+
+// Replaces `removed` bytes of `*text` at `offset` by `inserted`, updating
+// `result` incrementally. Checks that this yields the tree of a full parse.
+static void edit(CuTest *tc, struct mcc_parser_result *result, char **text, size_t offset, size_t removed,
+                 const char *inserted)
+{
+	size_t len = strlen(*text);
+	CuAssertTrue(tc, offset + removed <= len);
+
+	size_t inserted_len = strlen(inserted);
+	char *edited = malloc(len - removed + inserted_len + 1);
+	CuAssertPtrNotNull(tc, edited);
+	memcpy(edited, *text, offset);
+	memcpy(edited + offset, inserted, inserted_len);
+	strcpy(edited + offset + inserted_len, *text + offset + removed);
+
+	struct mcc_parser_edit e;
+	position_of(*text, offset, &e.start_line, &e.start_col);
+	position_of(*text, offset + removed, &e.old_end_line, &e.old_end_col);
+	position_of(edited, offset + inserted_len, &e.new_end_line, &e.new_end_col);
+
+	*result = mcc_parse_incremental(result, edited, &e);
+	struct mcc_parser_result full = mcc_parse_string(edited);
+
+	CuAssertIntEquals_Msg(tc, edited, full.status, result->status);
+	CuAssert(tc, edited, same_program(full.program, result->program));
+
+	mcc_parser_delete_result(&full);
+	free(*text);
+	*text = edited;
+}
+
+static struct mcc_ast_function_def *function_def(struct mcc_parser_result *result, int index)
+{
+	struct mcc_ast_function_def *def = result->program->function_def;
+	for (int i = 0; i < index && def; ++i) {
+		def = def->next;
+	}
+	return def;
+}
+
+static char *copy(const char *text)
+{
+	char *text_copy = malloc(strlen(text) + 1);
+	return text_copy ? strcpy(text_copy, text) : NULL;
+}
+
+// ---------------------------------------------------------------------- Tests
+
+static const char program[] = "int f() {\n"
+                              "\treturn 1;\n"
+                              "}\n"
+                              "\n"
+                              "/* g */ int g(int a) { return a; } float h() { return 1.5; }\n"
+                              "void main() {\n"
+                              "\tprint_int(f() + g(2));\n"
+                              "}\n";
+
+void EditBody(CuTest *tc)
+{
+	char *text = copy(program);
+	struct mcc_parser_result result = mcc_parse_string(text);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_ast_function_def *f = function_def(&result, 0);
+	struct mcc_ast_function_def *h = function_def(&result, 2);
+	struct mcc_ast_function_def *main = function_def(&result, 3);
+
+	// `return a;` becomes `return a * 3;`, shifting h on the same line
+	const char *a = strstr(text, "a; }");
+	edit(tc, &result, &text, (size_t)(a - text) + 1, 0, " * 3");
+
+	CuAssertPtrEquals(tc, f, function_def(&result, 0));
+	CuAssertPtrEquals(tc, h, function_def(&result, 2));
+	CuAssertPtrEquals(tc, main, function_def(&result, 3));
+
+	// spread the body of f over several lines, shifting all others
+	const char *one = strstr(text, "1;");
+	edit(tc, &result, &text, (size_t)(one - text), 1, "\n\t\t1 +\n\t\t2");
+
+	CuAssertPtrEquals(tc, h, function_def(&result, 2));
+	CuAssertPtrEquals(tc, main, function_def(&result, 3));
+
+	mcc_parser_delete_result(&result);
+	free(text);
+}
+
+void AddAndRemove(CuTest *tc)
+{
+	char *text = copy(program);
+	struct mcc_parser_result result = mcc_parse_string(text);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_ast_function_def *f = function_def(&result, 0);
+	struct mcc_ast_function_def *g = function_def(&result, 1);
+
+	// between f and g
+	edit(tc, &result, &text, strlen("int f() {\n\treturn 1;\n}\n"), 0, "bool b() { return true; }\n");
+	CuAssertPtrEquals(tc, f, function_def(&result, 0));
+	CuAssertPtrEquals(tc, g, function_def(&result, 2));
+
+	// remove h
+	const char *h = strstr(text, " float h");
+	edit(tc, &result, &text, (size_t)(h - text), strlen(" float h() { return 1.5; }"), "");
+	CuAssertPtrEquals(tc, g, function_def(&result, 2));
+	CuAssertPtrEquals(tc, NULL, function_def(&result, 4));
+
+	// append
+	edit(tc, &result, &text, strlen(text), 0, "void last() { }");
+	CuAssertPtrEquals(tc, f, function_def(&result, 0));
+	// f is parsed again, as the insertion might join its first token
+	edit(tc, &result, &text, 0, 0, "void first() { }\n");
+	CuAssertPtrEquals(tc, g, function_def(&result, 3));
+
+	// remove everything
+	edit(tc, &result, &text, 0, strlen(text), " ");
+	CuAssertPtrEquals(tc, NULL, result.program->function_def);
+	edit(tc, &result, &text, 0, 0, "void again() { }");
+
+	mcc_parser_delete_result(&result);
+	free(text);
+}
+
+// Edits whose effect reaches beyond the enclosing definitions.
+void Fallback(CuTest *tc)
+{
+	char *text = copy(program);
+	struct mcc_parser_result result = mcc_parse_string(text);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	// comment out g and h, closed in main
+	const char *g = strstr(text, "int g");
+	edit(tc, &result, &text, (size_t)(g - text), 0, "/*");
+	size_t main = (size_t)(strstr(text, "void main") - text);
+	edit(tc, &result, &text, main, 0, "*/");
+
+	// an identifier joining the type of main
+	edit(tc, &result, &text, main + 2, 0, "x");
+	CuAssertTrue(tc, MCC_PARSER_STATUS_OK != result.status);
+	edit(tc, &result, &text, main + 2, 1, "");
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	// not a program
+	edit(tc, &result, &text, 0, strlen(text), "1 + 2");
+	edit(tc, &result, &text, 0, strlen(text), "void f() { }");
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	mcc_parser_delete_result(&result);
+	free(text);
+}
+
+// Replaced nodes pile up in the arena until a full parse releases them,
+// hence the memory held stays bounded however long the editing goes on.
+void Reclaim(CuTest *tc)
+{
+	char *text = copy(program);
+	struct mcc_parser_result result = mcc_parse_string(text);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_arena_stats fresh;
+	mcc_arena_stats(&result.arena, &fresh);
+
+	const size_t offset = (size_t)(strstr(text, "1;") - text);
+	struct mcc_ast_function_def *g = function_def(&result, 1);
+	int full_parses = 0;
+	size_t peak_used = 0;
+	size_t peak_chunks = 0;
+
+	for (int i = 0; i < 1000; ++i) {
+		edit(tc, &result, &text, offset, 1, i % 2 ? "1" : "2");
+
+		struct mcc_arena_stats stats;
+		mcc_arena_stats(&result.arena, &stats);
+		CuAssertTrue(tc, result.dead_bytes <= stats.used / 2);
+
+		// g is only parsed again by a full parse, which starts a new arena
+		if (function_def(&result, 1) != g) {
+			CuAssertIntEquals(tc, 0, (int)result.dead_bytes);
+			CuAssertIntEquals(tc, (int)fresh.used, (int)stats.used);
+			CuAssertIntEquals(tc, (int)fresh.chunks, (int)stats.chunks);
+			g = function_def(&result, 1);
+			++full_parses;
+		}
+
+		peak_used = stats.used > peak_used ? stats.used : peak_used;
+		peak_chunks = stats.chunks > peak_chunks ? stats.chunks : peak_chunks;
+	}
+
+	// without resetting, every edit would add a chunk for the reparsed region
+	CuAssertTrue(tc, full_parses > 50);
+	CuAssertTrue(tc, peak_used <= 3 * fresh.used);
+	CuAssertTrue(tc, peak_chunks <= 16);
+
+	mcc_parser_delete_result(&result);
+	free(text);
+}
+
+static char *read_file(const char *path)
+{
+	FILE *in = fopen(path, "rb");
+	if (!in) {
+		return NULL;
+	}
+
+	fseek(in, 0, SEEK_END);
+	long len = ftell(in);
+	fseek(in, 0, SEEK_SET);
+
+	char *data = len >= 0 ? malloc((size_t)len + 1) : NULL;
+	if (data) {
+		data[fread(data, 1, (size_t)len, in)] = '\0';
+	}
+
+	fclose(in);
+	return data;
+}
+
+// Edits spread over each example, one after the other on the same tree. Some
+// of them break the program, which the next one repairs.
+void Examples(CuTest *tc)
+{
+	DIR *examples = opendir(MCC_EXAMPLES_DIR);
+	CuAssertPtrNotNull(tc, examples);
+
+	unsigned count = 0;
+
+	struct dirent *example;
+	while ((example = readdir(examples))) {
+		if (example->d_name[0] == '.') {
+			continue;
+		}
+
+		// examples/<name>/<name>.mc
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s/%s.mc", MCC_EXAMPLES_DIR, example->d_name, example->d_name);
+
+		char *text = read_file(path);
+		if (!text) {
+			continue;
+		}
+
+		struct mcc_parser_result result = mcc_parse_string(text);
+		CuAssertIntEquals_Msg(tc, path, MCC_PARSER_STATUS_OK, result.status);
+
+		for (size_t offset = 0; offset < strlen(text); offset += 37) {
+			edit(tc, &result, &text, offset, 0, "\n");
+			edit(tc, &result, &text, offset, 1, "");
+			edit(tc, &result, &text, offset, 0, " ");
+			edit(tc, &result, &text, offset, 1, "");
+		}
+		edit(tc, &result, &text, strlen(text), 0, "\nvoid appended() { }\n");
+
+		mcc_parser_delete_result(&result);
+		free(text);
+		count++;
+	}
+	closedir(examples);
+
+	CuAssertTrue(tc, count > 0);
+}
+
+#define TESTS \
+	TEST(EditBody) \
+	TEST(AddAndRemove) \
+	TEST(Fallback) \
+	TEST(Reclaim) \
+	TEST(Examples)
+
+#include "main_stub.inc"
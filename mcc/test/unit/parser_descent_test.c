@@ -0,0 +1,401 @@
+#include <CuTest.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ast.h"
+#include "mcc/parser.h"
+
+// Both parser engines have to build identical trees: same node types, values,
+// and source locations. Identifiers are interned, hence compared by pointer.
+
+#define SAME_SLOC(a, b) (memcmp(&(a)->node.sloc, &(b)->node.sloc, sizeof((a)->node.sloc)) == 0)
+
+static bool same_expression(const struct mcc_ast_expression *a, const struct mcc_ast_expression *b);
+
+static bool same_identifier(const struct mcc_ast_identifier *a, const struct mcc_ast_identifier *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	return SAME_SLOC(a, b) && a->i_value == b->i_value;
+}
+
+static bool same_literal(const struct mcc_ast_literal *a, const struct mcc_ast_literal *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	if (!SAME_SLOC(a, b) || a->type != b->type) {
+		return false;
+	}
+
+	switch (a->type) {
+	case MCC_AST_LITERAL_TYPE_INT:
+		return a->i_value == b->i_value;
+	case MCC_AST_LITERAL_TYPE_FLOAT:
+		return a->f_value == b->f_value;
+	case MCC_AST_LITERAL_TYPE_STRING:
+		return strcmp(a->s_value, b->s_value) == 0;
+	case MCC_AST_LITERAL_TYPE_BOOL:
+		return a->b_value == b->b_value;
+	}
+	return false;
+}
+
+static bool same_arguments(const struct mcc_ast_argument *a, const struct mcc_ast_argument *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (!SAME_SLOC(a, b) || !same_expression(a->expression, b->expression)) {
+			return false;
+		}
+	}
+	return a == b;
+}
+
+static bool same_expression(const struct mcc_ast_expression *a, const struct mcc_ast_expression *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	if (!SAME_SLOC(a, b) || a->type != b->type) {
+		return false;
+	}
+
+	switch (a->type) {
+	case MCC_AST_EXPRESSION_TYPE_LITERAL:
+		return same_literal(a->literal, b->literal);
+	case MCC_AST_EXPRESSION_TYPE_BINARY_OP:
+		return a->op == b->op && same_expression(a->lhs, b->lhs) && same_expression(a->rhs, b->rhs);
+	case MCC_AST_EXPRESSION_TYPE_UNARY_OP:
+		return a->up == b->up && same_expression(a->rhs, b->rhs);
+	case MCC_AST_EXPRESSION_TYPE_PARENTH:
+		return same_expression(a->expression, b->expression);
+	case MCC_AST_EXPRESSION_TYPE_IDENTIFIER:
+		return same_identifier(a->identifier, b->identifier);
+	case MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT:
+		return same_identifier(a->array, b->array) && same_expression(a->index, b->index);
+	case MCC_AST_EXPRESSION_TYPE_CALL:
+		return same_identifier(a->function, b->function) && same_arguments(a->arguments, b->arguments);
+	default:
+		return false;
+	}
+}
+
+static bool same_declaration(const struct mcc_ast_declaration *a, const struct mcc_ast_declaration *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	return SAME_SLOC(a, b) && a->type == b->type && same_literal(a->array_size, b->array_size) &&
+	       same_identifier(a->identifier, b->identifier);
+}
+
+static bool same_statement(const struct mcc_ast_statement *a, const struct mcc_ast_statement *b);
+
+static bool same_statement_list(const struct mcc_ast_statement_list *a, const struct mcc_ast_statement_list *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (!SAME_SLOC(a, b) || !same_statement(a->statement, b->statement)) {
+			return false;
+		}
+	}
+	return a == b;
+}
+
+static bool same_statement(const struct mcc_ast_statement *a, const struct mcc_ast_statement *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	if (!SAME_SLOC(a, b) || a->type != b->type) {
+		return false;
+	}
+
+	switch (a->type) {
+	case MMC_AST_STATEMENT_TYPE_EXPRESSION:
+		return same_expression(a->expression, b->expression);
+	case MCC_AST_STATEMENT_TYPE_IF:
+		return same_expression(a->if_condition, b->if_condition) && same_statement(a->if_stmt, b->if_stmt) &&
+		       same_statement(a->else_stmt, b->else_stmt);
+	case MCC_AST_STATEMENT_TYPE_WHILE:
+		return same_expression(a->while_condition, b->while_condition) &&
+		       same_statement(a->while_stmt, b->while_stmt);
+	case MCC_AST_STATEMENT_TYPE_DECL:
+		return same_declaration(a->declaration, b->declaration);
+	case MCC_AST_STATEMENT_TYPE_ASSGN:
+		return same_identifier(a->id_assgn, b->id_assgn) && same_expression(a->lhs_assgn, b->lhs_assgn) &&
+		       same_expression(a->rhs_assgn, b->rhs_assgn);
+	case MCC_AST_STATEMENT_TYPE_COMPOUND:
+		return same_statement_list(a->compound_statement, b->compound_statement);
+	case MCC_AST_STATEMENT_TYPE_RETURN:
+		return same_expression(a->return_value, b->return_value);
+	}
+	return false;
+}
+
+static bool same_parameters(const struct mcc_ast_parameter *a, const struct mcc_ast_parameter *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (!SAME_SLOC(a, b) || !same_declaration(a->declaration, b->declaration)) {
+			return false;
+		}
+	}
+	return a == b;
+}
+
+static bool same_program(const struct mcc_ast_program *a, const struct mcc_ast_program *b)
+{
+	if (!a || !b) {
+		return a == b;
+	}
+	if (!SAME_SLOC(a, b)) {
+		return false;
+	}
+
+	const struct mcc_ast_function_def *fa = a->function_def;
+	const struct mcc_ast_function_def *fb = b->function_def;
+	for (; fa && fb; fa = fa->next, fb = fb->next) {
+		if (!SAME_SLOC(fa, fb) || fa->type != fb->type || !same_identifier(fa->identifier, fb->identifier) ||
+		    !same_parameters(fa->parameter, fb->parameter) ||
+		    !same_statement(fa->compund_statement, fb->compund_statement)) {
+			return false;
+		}
+	}
+	return fa == fb;
+}
+
+static bool same_result(const struct mcc_parser_result *a, const struct mcc_parser_result *b)
+{
+	return a->status == b->status && same_expression(a->expression, b->expression) &&
+	       same_declaration(a->declaration, b->declaration) && same_statement(a->statement, b->statement) &&
+	       same_program(a->program, b->program);
+}
+
+// Parses `input` with both engines and compares the results.
+static void assert_same_tree(CuTest *tc, const char *name, const char *input, bool valid)
+{
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_BISON);
+	struct mcc_parser_result bison = mcc_parse_string(input);
+
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_DESCENT);
+	struct mcc_parser_result descent = mcc_parse_string(input);
+
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_BISON);
+
+	char message[512];
+	snprintf(message, sizeof(message), "%s: bison status %d, descent status %d", name, bison.status,
+	         descent.status);
+	CuAssert(tc, message, (bison.status == MCC_PARSER_STATUS_OK) == valid);
+	CuAssert(tc, message, same_result(&bison, &descent));
+
+	mcc_parser_delete_result(&bison);
+	mcc_parser_delete_result(&descent);
+}
+
+// Parses `input` with both engines from a writable copy, as mmapped files are,
+// and compares each result to parsing the string. String literals are then
+// terminated in place and borrowed from the buffer instead of copied.
+static void assert_same_tree_in_place(CuTest *tc, const char *name, const char *input)
+{
+	size_t len = strlen(input);
+	char *buffer = malloc(len + 2);
+	CuAssertPtrNotNull(tc, buffer);
+
+	const enum mcc_parser_engine engines[] = {MCC_PARSER_ENGINE_BISON, MCC_PARSER_ENGINE_DESCENT};
+	for (size_t i = 0; i < sizeof(engines) / sizeof(engines[0]); ++i) {
+		mcc_parser_set_engine(engines[i]);
+		struct mcc_parser_result copied = mcc_parse_string(input);
+
+		memcpy(buffer, input, len);
+		buffer[len] = buffer[len + 1] = '\0';
+		struct mcc_parser_result in_place = mcc_parse_buffer(buffer, len);
+
+		char message[512];
+		snprintf(message, sizeof(message), "%s: engine %zu parsing in place", name, i);
+		CuAssert(tc, message, same_result(&copied, &in_place));
+
+		mcc_parser_delete_result(&copied);
+		mcc_parser_delete_result(&in_place);
+	}
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_BISON);
+
+	free(buffer);
+}
+
+static char *read_file(const char *path)
+{
+	FILE *in = fopen(path, "rb");
+	if (!in) {
+		return NULL;
+	}
+
+	fseek(in, 0, SEEK_END);
+	long len = ftell(in);
+	fseek(in, 0, SEEK_SET);
+
+	char *data = len >= 0 ? malloc((size_t)len + 1) : NULL;
+	if (data) {
+		data[fread(data, 1, (size_t)len, in)] = '\0';
+	}
+
+	fclose(in);
+	return data;
+}
+
+void Examples(CuTest *tc)
+{
+	DIR *examples = opendir(MCC_EXAMPLES_DIR);
+	CuAssertPtrNotNull(tc, examples);
+
+	unsigned count = 0;
+
+	struct dirent *example;
+	while ((example = readdir(examples))) {
+		if (example->d_name[0] == '.') {
+			continue;
+		}
+
+		// examples/<name>/<name>.mc
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s/%s.mc", MCC_EXAMPLES_DIR, example->d_name, example->d_name);
+
+		char *input = read_file(path);
+		CuAssert(tc, path, input != NULL);
+
+		assert_same_tree(tc, path, input, true);
+		assert_same_tree_in_place(tc, path, input);
+		free(input);
+		count++;
+	}
+	closedir(examples);
+
+	CuAssertTrue(tc, count > 0);
+}
+
+void Snippets(CuTest *tc)
+{
+	static const char *const valid[] = {
+	    "",
+	    "42",
+	    "-a + b * c < d || !e && f == g != h",
+	    "a - b - c / d / e",
+	    "- - -x",
+	    "((1)) + f() * g(1, a[2], \"s\")",
+	    "int x",
+	    "string[10] names",
+	    "int x;",
+	    "x = 1;",
+	    "a[i + 1] = a[i] * 2;",
+	    "a[i] + 1;",
+	    "return;",
+	    "{ }",
+	    "if (a) if (b) x = 1; else x = 2;",
+	    "while (true) { float f; f = 1.5; }",
+	    "/* comment\n spanning */ void f() { }\n\nint g(int a, bool[2] b) { return a; }",
+	    "void main() { print(\"multi\nline\"); }",
+	};
+
+	static const char *const invalid[] = {
+	    "(42",
+	    "1 +",
+	    "x = 1",
+	    "int",
+	    "int[x] a;",
+	    "void x",
+	    "void f()",
+	    "int f() { return 1 }",
+	    "a & b",
+	    "\"unterminated",
+	    "f(1,)",
+	    "1 2",
+	    "int f() { } x = 1;",
+	};
+
+	for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); ++i) {
+		assert_same_tree(tc, valid[i], valid[i], true);
+	}
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+		assert_same_tree(tc, invalid[i], invalid[i], false);
+	}
+}
+
+void Buffer(CuTest *tc)
+{
+	char data[] = "void f() { print(\"in place\"); }\0";
+	size_t len = sizeof(data) - 2;
+
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_DESCENT);
+	struct mcc_parser_result result = mcc_parse_buffer(data, len);
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_BISON);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	// string literals refer to the buffer
+	struct mcc_ast_literal *literal = result.program->function_def->compund_statement->compound_statement
+	                                      ->statement->expression->arguments->expression->literal;
+	CuAssertStrEquals(tc, "in place", literal->s_value);
+	CuAssertTrue(tc, literal->s_value > data && literal->s_value < data + len);
+
+	mcc_parser_delete_result(&result);
+}
+
+void File(CuTest *tc)
+{
+	FILE *in = tmpfile();
+	CuAssertPtrNotNull(tc, in);
+	fputs("int f(int a) { return a * 2; }", in);
+	rewind(in);
+
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_DESCENT);
+	struct mcc_parser_result result = mcc_parse_file(in);
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_BISON);
+	fclose(in);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+	CuAssertStrEquals(tc, "f", result.program->function_def->identifier->i_value);
+
+	mcc_parser_delete_result(&result);
+}
+
+void DeepNesting(CuTest *tc)
+{
+	// rejected instead of overflowing the stack
+	size_t depth = 100000;
+	char *input = malloc(2 * depth + 2);
+	CuAssertPtrNotNull(tc, input);
+	memset(input, '(', depth);
+	input[depth] = '1';
+	memset(input + depth + 1, ')', depth);
+	input[2 * depth + 1] = '\0';
+
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_DESCENT);
+	struct mcc_parser_result result = mcc_parse_string(input);
+	mcc_parser_set_engine(MCC_PARSER_ENGINE_BISON);
+
+	CuAssertTrue(tc, MCC_PARSER_STATUS_OK != result.status);
+	free(input);
+}
+
+void EngineFromName(CuTest *tc)
+{
+	enum mcc_parser_engine engine;
+	CuAssertTrue(tc, mcc_parser_engine_from_name("descent", &engine));
+	CuAssertIntEquals(tc, MCC_PARSER_ENGINE_DESCENT, engine);
+	CuAssertTrue(tc, mcc_parser_engine_from_name("bison", &engine));
+	CuAssertIntEquals(tc, MCC_PARSER_ENGINE_BISON, engine);
+	CuAssertTrue(tc, !mcc_parser_engine_from_name("yacc", &engine));
+}
+
+#define TESTS \
+	TEST(Examples) \
+	TEST(Snippets) \
+	TEST(Buffer) \
+	TEST(File) \
+	TEST(DeepNesting) \
+	TEST(EngineFromName)
+
+#include "main_stub.inc"
+#undef TESTS
@@ -1,5 +1,9 @@
 #include <CuTest.h>
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
 #include "mcc/ast.h"
 #include "mcc/parser.h"
 
@@ -33,7 +37,7 @@ void BinaryOp_1(CuTest *tc)
 	CuAssertIntEquals(tc, MCC_AST_LITERAL_TYPE_FLOAT, expr->rhs->literal->type);
 	CuAssertDblEquals(tc, 3.14, expr->rhs->literal->f_value, EPS);
 
-	mcc_ast_delete(expr);
+	mcc_parser_delete_result(&result);
 }
 
 void NestedExpression_1(CuTest *tc)
@@ -79,13 +83,11 @@ void NestedExpression_1(CuTest *tc)
 	CuAssertIntEquals(tc, MCC_AST_LITERAL_TYPE_FLOAT, subexpr->rhs->literal->type);
 	CuAssertIntEquals(tc, 3.14, subexpr->rhs->literal->f_value);
 
-	mcc_ast_delete(expr);
+	mcc_parser_delete_result(&result);
 }
 
 void MissingClosingParenthesis_1(CuTest *tc)
 {
-	//TODO: fix memory leak
-
 	const char input[] = "(42";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
@@ -93,137 +95,255 @@ void MissingClosingParenthesis_1(CuTest *tc)
 	CuAssertTrue(tc, NULL == result.expression);
 }
 
-void StatementWhile (CuTest *tc)
+void StatementWhile(CuTest *tc)
 {
-
-	  const char input[] = "while (i <= 2) { i = i + 1}" ;
-
+	const char input[] = "while (i <= 2) { i = i + 1; }";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
 	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
 	struct mcc_ast_statement *stmt = result.statement;
 
-     CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_WHILE, stmt -> type );
-	 CuAssertTrue(tc, NULL == result.statement);
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_WHILE, stmt->type);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_LESS_EQUALS, stmt->while_condition->op);
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_COMPOUND, stmt->while_stmt->type);
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_ASSGN, stmt->while_stmt->compound_statement->statement->type);
+	CuAssertTrue(tc, NULL == stmt->while_stmt->compound_statement->next);
 
+	mcc_parser_delete_result(&result);
 }
-void StatementIf (CuTest *tc)
-{
-
-	const char input[] = "if (i == 2) { i = i + 1}" ;
 
+void StatementIf(CuTest *tc)
+{
+	const char input[] = "if (i == 2) { i = i + 1; }";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
 	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+	CuAssertTrue(tc, NULL == result.expression);
 
 	struct mcc_ast_statement *stmt = result.statement;
 
-	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_IF, stmt -> type );
-	CuAssertTrue(tc, NULL == result.statement);
-
-	struct mcc_ast_statement *expr = result.expression;
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_IF, stmt->type);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_EQUALS, stmt->if_condition->op);
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_COMPOUND, stmt->if_stmt->type);
+	CuAssertTrue(tc, NULL == stmt->else_stmt);
 
-	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_IF, expr -> type );
-	CuAssertTrue(tc, NULL == result.expression);
+	mcc_parser_delete_result(&result);
 }
 
+void StatementIfElse(CuTest *tc)
+{
+	const char input[] = "if (i != 2) i = i + 1; else i == 0;";
+	struct mcc_parser_result result = mcc_parse_string(input);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
-void StatementIfElse(CuTest *tc){
+	struct mcc_ast_statement *stmt = result.statement;
 
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_IF, stmt->type);
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_ASSGN, stmt->if_stmt->type);
+	CuAssertIntEquals(tc, MMC_AST_STATEMENT_TYPE_EXPRESSION, stmt->else_stmt->type);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_EQUALS, stmt->else_stmt->expression->op);
 
-	const char input[] = "if (i != 2) i = i + 1; else i==0;" ;
+	mcc_parser_delete_result(&result);
+}
 
+void StatementDanglingElse(CuTest *tc)
+{
+	const char input[] = "if (a) if (b) x = 1; else x = 2;";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
-	struct mcc_ast_statement *stmt = result.statement;
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
-	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_IF, stmt -> type );
+	struct mcc_ast_statement *stmt = result.statement;
 
-	CuAssertTrue(tc, NULL == result.statement);
+	// the else belongs to the inner if
+	CuAssertTrue(tc, NULL == stmt->else_stmt);
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_IF, stmt->if_stmt->type);
+	CuAssertTrue(tc, NULL != stmt->if_stmt->else_stmt);
 
+	mcc_parser_delete_result(&result);
 }
 
-void StatementDeclarationInt(CuTest *tc){
-
-	const char input[] = "int name" ;
-
+void StatementDeclarationInt(CuTest *tc)
+{
+	const char input[] = "int name";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
 	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
 	struct mcc_ast_declaration *decl = result.declaration;
 
-	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_DECL, decl -> type );
-	CuAssertIntEquals(tc, decl -> type, MCC_AST_LITERAL_TYPE_INT );
-	CuAssertIntEquals(tc, decl ->identifier , "name");
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_INT, decl->type);
+	CuAssertTrue(tc, NULL == decl->array_size);
+	CuAssertStrEquals(tc, "name", decl->identifier->i_value);
 
+	mcc_parser_delete_result(&result);
 }
 
-void StatementDeclarationFloat(CuTest *tc){
+void StatementDeclarationFloat(CuTest *tc)
+{
+	const char input[] = "float bar";
+	struct mcc_parser_result result = mcc_parse_string(input);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_ast_declaration *decl = result.declaration;
+
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_FLOAT, decl->type);
+	CuAssertStrEquals(tc, "bar", decl->identifier->i_value);
 
-	const char input[] = "float bar" ;
+	mcc_parser_delete_result(&result);
+}
 
+void StatementDeclarationString(CuTest *tc)
+{
+	const char input[] = "string hello";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
 	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
 	struct mcc_ast_declaration *decl = result.declaration;
 
-	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_DECL, decl -> type );
-	CuAssertIntEquals(tc, decl -> type, MCC_AST_LITERAL_TYPE_FLOAT);
-	CuAssertIntEquals(tc, decl ->identifier , "bar");
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_STRING, decl->type);
+	CuAssertStrEquals(tc, "hello", decl->identifier->i_value);
 
+	mcc_parser_delete_result(&result);
 }
-void StatementDeclarationString(CuTest *tc){
-
-	const char input[] = "string hello" ;
 
+void StatementDeclarationArray(CuTest *tc)
+{
+	const char input[] = "bool[8] flags;";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
 	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
-	struct mcc_ast_declaration *decl = result.declaration;
+	struct mcc_ast_statement *stmt = result.statement;
 
-	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_DECL, decl -> type );
-	CuAssertIntEquals(tc, decl -> type, MCC_AST_LITERAL_TYPE_STRING);
-	CuAssertIntEquals(tc, decl ->identifier , "string");
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_DECL, stmt->type);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_BOOL, stmt->declaration->type);
+	CuAssertIntEquals(tc, 8, stmt->declaration->array_size->i_value);
+	CuAssertStrEquals(tc, "flags", stmt->declaration->identifier->i_value);
 
+	mcc_parser_delete_result(&result);
 }
 
-void StatementRet(CuTest *tc){
+void StatementRet(CuTest *tc)
+{
+	const char input[] = "return 1;";
+	struct mcc_parser_result result = mcc_parse_string(input);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_ast_statement *stmt = result.statement;
+
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_RETURN, stmt->type);
+	CuAssertIntEquals(tc, MCC_AST_LITERAL_TYPE_INT, stmt->return_value->literal->type);
+	CuAssertIntEquals(tc, 1, stmt->return_value->literal->i_value);
 
-	const char input[] = "return 1" ;
+	mcc_parser_delete_result(&result);
+}
 
+void StatementAssignment(CuTest *tc)
+{
+	const char input[] = " a = 12;";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
 	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
 	struct mcc_ast_statement *stmt = result.statement;
 
-	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_DECL, stmt -> type );
-	CuAssertIntEquals(tc, stmt -> type, MCC_AST_LITERAL_TYPE_INT);
-	CuAssertTrue(tc, NULL == result.statement);
+	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_ASSGN, stmt->type);
+	CuAssertStrEquals(tc, "a", stmt->id_assgn->i_value);
+	CuAssertTrue(tc, NULL == stmt->lhs_assgn);
+	CuAssertIntEquals(tc, 12, stmt->rhs_assgn->literal->i_value);
 
+	mcc_parser_delete_result(&result);
 }
 
-void StatementAssignment(CuTest *tc){
+void Precedence(CuTest *tc)
+{
+	const char input[] = "-a + b * c < d || !e && f";
+	struct mcc_parser_result result = mcc_parse_string(input);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
-	const char input[] = " a = 12" ;
+	// ((-a + (b * c)) < d) || ((!e) && f)
+	struct mcc_ast_expression *expr = result.expression;
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_OR, expr->op);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_LESS, expr->lhs->op);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_ADD, expr->lhs->lhs->op);
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_UNARY_OP, expr->lhs->lhs->lhs->type);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_MUL, expr->lhs->lhs->rhs->op);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_AND, expr->rhs->op);
+	CuAssertIntEquals(tc, MCC_AST_UNARY_OP_NOT, expr->rhs->lhs->up);
+
+	mcc_parser_delete_result(&result);
+}
 
+void LeftAssociativity(CuTest *tc)
+{
+	const char input[] = "a - b - c";
 	struct mcc_parser_result result = mcc_parse_string(input);
 
 	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
 
-	struct mcc_ast_statement *stmt = result.statement;
+	// (a - b) - c
+	struct mcc_ast_expression *expr = result.expression;
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_SUB, expr->op);
+	CuAssertIntEquals(tc, MCC_AST_BINARY_OP_SUB, expr->lhs->op);
+	CuAssertStrEquals(tc, "c", expr->rhs->identifier->i_value);
 
-	CuAssertIntEquals(tc, MCC_AST_STATEMENT_TYPE_ASSGN, stmt -> type );
+	mcc_parser_delete_result(&result);
+}
 
-	CuAssertTrue(tc, NULL == result.statement);
+void Program(CuTest *tc)
+{
+	const char input[] = "int f(int a, float[2] b) { return g(a, b[1]); }\n"
+	                     "void main() { }";
+	struct mcc_parser_result result = mcc_parse_string(input);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_ast_function_def *f = result.program->function_def;
+	CuAssertStrEquals(tc, "f", f->identifier->i_value);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_FLOAT, f->parameter->next->declaration->type);
+	CuAssertIntEquals(tc, 2, f->parameter->next->declaration->array_size->i_value);
+
+	struct mcc_ast_expression *call = f->compund_statement->compound_statement->statement->return_value;
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_CALL, call->type);
+	CuAssertStrEquals(tc, "g", call->function->i_value);
+	CuAssertIntEquals(tc, MCC_AST_EXPRESSION_TYPE_ARRAY_ELEMENT, call->arguments->next->expression->type);
+
+	struct mcc_ast_function_def *main = f->next;
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_VOID, main->type);
+	CuAssertTrue(tc, NULL == main->parameter);
+	CuAssertTrue(tc, NULL == main->compund_statement->compound_statement);
+	CuAssertTrue(tc, NULL == main->next);
 
+	mcc_parser_delete_result(&result);
 }
 
+void EmptyProgram(CuTest *tc)
+{
+	const char input[] = " /* nothing */ ";
+	struct mcc_parser_result result = mcc_parse_string(input);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+	CuAssertTrue(tc, NULL != result.program);
+	CuAssertTrue(tc, NULL == result.program->function_def);
 
+	mcc_parser_delete_result(&result);
+}
+
+void MissingSemicolon(CuTest *tc)
+{
+	const char input[] = "while (i <= 2) { i = i + 1 }";
+	struct mcc_parser_result result = mcc_parse_string(input);
+
+	CuAssertTrue(tc, MCC_PARSER_STATUS_OK != result.status);
+	CuAssertTrue(tc, NULL == result.statement);
+}
 
 void SourceLocation_SingleLineColumn(CuTest *tc)
 {
@@ -246,22 +366,87 @@ void SourceLocation_SingleLineColumn(CuTest *tc)
 	CuAssertIntEquals(tc, MCC_AST_LITERAL_TYPE_INT, expr->expression->rhs->literal->type);
 	CuAssertIntEquals(tc, 7, expr->expression->rhs->literal->node.sloc.start_col);
 
-	mcc_ast_delete(expr);
+	mcc_parser_delete_result(&result);
+}
+
+void SourceLocation_MultiLine(CuTest *tc)
+{
+	const char input[] = "/* a\n comment */ x =\n\t\"two\nlines\";";
+	struct mcc_parser_result result = mcc_parse_string(input);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_ast_statement *stmt = result.statement;
+
+	// statements include their semicolon, end positions are exclusive
+	CuAssertIntEquals(tc, 2, stmt->node.sloc.start_line);
+	CuAssertIntEquals(tc, 13, stmt->node.sloc.start_col);
+	CuAssertIntEquals(tc, 4, stmt->node.sloc.end_line);
+	CuAssertIntEquals(tc, 8, stmt->node.sloc.end_col);
+
+	struct mcc_ast_literal *literal = stmt->rhs_assgn->literal;
+	CuAssertIntEquals(tc, 3, literal->node.sloc.start_line);
+	CuAssertIntEquals(tc, 2, literal->node.sloc.start_col);
+	CuAssertIntEquals(tc, 4, literal->node.sloc.end_line);
+	CuAssertIntEquals(tc, 7, literal->node.sloc.end_col);
+	CuAssertStrEquals(tc, "two\nlines", literal->s_value);
+
+	mcc_parser_delete_result(&result);
+}
+
+// Writes `content` to a new temporary file, whose path is stored in `path`.
+static void write_temporary(CuTest *tc, char *path, const char *content)
+{
+	int fd = mkstemp(path);
+	CuAssertTrue(tc, fd >= 0);
+	FILE *out = fdopen(fd, "w");
+	CuAssertPtrNotNull(tc, out);
+	fputs(content, out);
+	CuAssertIntEquals(tc, 0, fclose(out));
+}
+
+void ParseFiles_NotAProgram(CuTest *tc)
+{
+	char program[] = "/tmp/mcc_parser_XXXXXX";
+	char expression[] = "/tmp/mcc_parser_XXXXXX";
+	write_temporary(tc, program, "int main() { return 0; }");
+	write_temporary(tc, expression, "1 + 2");
+
+	const char *const paths[] = {program, expression, program};
+	size_t failed_input = 0;
+	struct mcc_parser_result result = mcc_parse_files(paths, 3, 2, NULL, &failed_input);
+
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_NOT_A_PROGRAM, result.status);
+	CuAssertIntEquals(tc, 1, (int)failed_input);
+	CuAssertPtrEquals(tc, NULL, result.program);
+
+	mcc_parser_delete_result(&result);
+	unlink(program);
+	unlink(expression);
 }
 
 #define TESTS \
 	TEST(BinaryOp_1) \
 	TEST(NestedExpression_1) \
 	TEST(MissingClosingParenthesis_1) \
-	TEST(SourceLocation_SingleLineColumn)\
-	TEST(StatementWhile)\
-	TEST(StatementIf)\
-	TEST(StatementIfElse)\
-    TEST(StatementAssignment)\
-    TEST(StatementRet)\
-    TEST(StatementDeclarationString)\
-    TEST(StatementDeclarationFloat)\
-    TEST(StatementDeclarationInt)\
+	TEST(SourceLocation_SingleLineColumn) \
+	TEST(SourceLocation_MultiLine) \
+	TEST(StatementWhile) \
+	TEST(StatementIf) \
+	TEST(StatementIfElse) \
+	TEST(StatementDanglingElse) \
+	TEST(StatementAssignment) \
+	TEST(StatementRet) \
+	TEST(StatementDeclarationString) \
+	TEST(StatementDeclarationFloat) \
+	TEST(StatementDeclarationInt) \
+	TEST(StatementDeclarationArray) \
+	TEST(Precedence) \
+	TEST(LeftAssociativity) \
+	TEST(Program) \
+	TEST(EmptyProgram) \
+	TEST(MissingSemicolon) \
+	TEST(ParseFiles_NotAProgram)
 
 #include "main_stub.inc"
 #undef TESTS
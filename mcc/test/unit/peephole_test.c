@@ -0,0 +1,162 @@
+#include <CuTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/peephole.h"
+
+// Optimizes the lines of `input` and compares the result with `expected`.
+static struct mcc_peephole_stats optimize(CuTest *tc, const char *const *input, const char *expected)
+{
+	struct mcc_peephole_code code;
+	mcc_peephole_code_init(&code);
+	for (const char *const *line = input; *line; ++line) {
+		CuAssertTrue(tc, mcc_peephole_append(&code, *line));
+	}
+
+	struct mcc_peephole_stats stats = {0};
+	CuAssertTrue(tc, mcc_peephole_optimize(&code, &stats));
+
+	char *text = NULL;
+	size_t text_size = 0;
+	FILE *out = open_memstream(&text, &text_size);
+	CuAssertPtrNotNull(tc, out);
+	mcc_peephole_print(out, &code);
+	fclose(out);
+	CuAssertStrEquals(tc, expected, text);
+
+	free(text);
+	mcc_peephole_code_release(&code);
+	return stats;
+}
+
+static uint32_t total_hits(const struct mcc_peephole_stats *stats)
+{
+	uint32_t hits = 0;
+	for (int r = 0; r < MCC_PEEPHOLE_RULE_COUNT; ++r) {
+		hits += stats->hits[r];
+	}
+	return hits;
+}
+
+// ---------------------------------------------------------------------- Tests
+
+void Unchanged(CuTest *tc)
+{
+	static const char *const input[] = {"f:", "pushl %ebp", "movl %esp, %ebp", "movl (%eax,%ecx,4), %edx",
+	                                    "movl %edx, -4(%ebp)", "fucomip %st(1), %st", "ret", NULL};
+
+	struct mcc_peephole_stats stats = optimize(tc, input,
+	                                           "f:\n\tpushl %ebp\n\tmovl %esp, %ebp\n\tmovl (%eax,%ecx,4), %edx\n"
+	                                           "\tmovl %edx, -4(%ebp)\n\tfucomip %st(1), %st\n\tret\n");
+	CuAssertIntEquals(tc, 0, (int)total_hits(&stats));
+}
+
+void CompareBranch(CuTest *tc)
+{
+	static const char *const input[] = {".L0:",
+	                                    "movl %esi, %eax",
+	                                    "cmpl %edi, %eax",
+	                                    "setl %al",
+	                                    "movzbl %al, %eax",
+	                                    "movl %eax, %ebx",
+	                                    "testl %ebx, %ebx",
+	                                    "je .L1",
+	                                    "addl $1, %esi",
+	                                    "jmp .L0",
+	                                    ".L1:",
+	                                    "movl %esi, %eax",
+	                                    "popl %ebx",
+	                                    "ret",
+	                                    NULL};
+
+	struct mcc_peephole_stats stats = optimize(tc, input,
+	                                           ".L0:\n\tcmpl %edi, %esi\n\tjge .L1\n\taddl $1, %esi\n\tjmp .L0\n"
+	                                           ".L1:\n\tmovl %esi, %eax\n\tpopl %ebx\n\tret\n");
+	CuAssertIntEquals(tc, 1, (int)stats.hits[MCC_PEEPHOLE_COMPARE_BRANCH]);
+	CuAssertIntEquals(tc, 1, (int)stats.hits[MCC_PEEPHOLE_COMPARE_OPERAND]);
+}
+
+void LiveBool(CuTest *tc)
+{
+	// the bool is read at the target of the branch
+	static const char *const input[] = {"cmpl %edi, %esi", "sete %al", "movzbl %al, %eax", "movl %eax, %ebx",
+	                                    "testl %ebx, %ebx", "jne .L1",  "ret",              ".L1:",
+	                                    "movl %ebx, %eax", "ret",      NULL};
+
+	struct mcc_peephole_stats stats =
+	    optimize(tc, input,
+	             "\tcmpl %edi, %esi\n\tsete %al\n\tmovzbl %al, %eax\n\tmovl %eax, %ebx\n\ttestl %ebx, %ebx\n"
+	             "\tjne .L1\n\tret\n.L1:\n\tmovl %ebx, %eax\n\tret\n");
+	CuAssertIntEquals(tc, 0, (int)total_hits(&stats));
+}
+
+void Moves(CuTest *tc)
+{
+	static const char *const input[] = {"movl %ebx, %eax", "subl %edi, %eax", "movl %eax, %edi", "movl %edi, %eax",
+	                                    "movl %esi, %ecx", "addl $1, %ecx",   "movl %ecx, %esi", "movl $0, %edx",
+	                                    "movl 8(%ebp), %ecx", "ret",          NULL};
+
+	// edi and edx are preserved, ecx is not
+	struct mcc_peephole_stats stats =
+	    optimize(tc, input,
+	             "\tmovl %ebx, %eax\n\tsubl %edi, %eax\n\tmovl %eax, %edi\n\taddl $1, %esi\n\tret\n");
+	CuAssertIntEquals(tc, 1, (int)stats.hits[MCC_PEEPHOLE_MOVE_BACK]);
+	CuAssertIntEquals(tc, 1, (int)stats.hits[MCC_PEEPHOLE_FOLD_OPERATION]);
+	CuAssertIntEquals(tc, 2, (int)stats.hits[MCC_PEEPHOLE_DEAD_RESULT]);
+}
+
+void MovedAddress(CuTest *tc)
+{
+	// the second move reads from another address
+	static const char *const input[] = {"movl 4(%ebx), %ebx", "movl %ebx, 4(%ebx)", "ret", NULL};
+
+	struct mcc_peephole_stats stats = optimize(tc, input, "\tmovl 4(%ebx), %ebx\n\tmovl %ebx, 4(%ebx)\n\tret\n");
+	CuAssertIntEquals(tc, 0, (int)total_hits(&stats));
+}
+
+void StackAdjustments(CuTest *tc)
+{
+	static const char *const input[] = {"subl $12, %esp", "subl $16, %esp", "call f", "addl $16, %esp",
+	                                    "subl $16, %esp", "call g",         "addl $16, %esp", "ret",
+	                                    NULL};
+
+	struct mcc_peephole_stats stats =
+	    optimize(tc, input, "\tsubl $28, %esp\n\tcall f\n\tcall g\n\taddl $16, %esp\n\tret\n");
+	CuAssertIntEquals(tc, 2, (int)stats.hits[MCC_PEEPHOLE_STACK_ADJUSTMENT]);
+}
+
+void Jumps(CuTest *tc)
+{
+	static const char *const input[] = {"testl %eax, %eax", "je .L1", "jmp .L2", ".L1:", "call f", "jmp .L3",
+	                                    ".L2:", ".L3:",      "ret",     NULL};
+
+	struct mcc_peephole_stats stats =
+	    optimize(tc, input, "\ttestl %eax, %eax\n\tjne .L2\n.L1:\n\tcall f\n.L2:\n.L3:\n\tret\n");
+	CuAssertIntEquals(tc, 1, (int)stats.hits[MCC_PEEPHOLE_BRANCH_OVER]);
+	CuAssertIntEquals(tc, 1, (int)stats.hits[MCC_PEEPHOLE_JUMP_NEXT]);
+}
+
+void Rules(CuTest *tc)
+{
+	for (int r = 0; r < MCC_PEEPHOLE_RULE_COUNT; ++r) {
+		CuAssertPtrNotNull(tc, mcc_peephole_rule_name(r));
+		CuAssertTrue(tc, strlen(mcc_peephole_rule_description(r)) > 0);
+		for (int other = 0; other < r; ++other) {
+			CuAssertTrue(tc, strcmp(mcc_peephole_rule_name(r), mcc_peephole_rule_name(other)) != 0);
+		}
+	}
+}
+
+#define TESTS \
+	TEST(Unchanged) \
+	TEST(CompareBranch) \
+	TEST(LiveBool) \
+	TEST(Moves) \
+	TEST(MovedAddress) \
+	TEST(StackAdjustments) \
+	TEST(Jumps) \
+	TEST(Rules)
+
+#include "main_stub.inc"
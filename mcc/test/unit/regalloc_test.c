@@ -0,0 +1,309 @@
+#include <CuTest.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/asm.h"
+#include "mcc/bitset.h"
+#include "mcc/cfg.h"
+#include "mcc/ir.h"
+#include "mcc/liveness.h"
+#include "mcc/optimize.h"
+#include "mcc/parser.h"
+#include "mcc/regalloc.h"
+
+#include "ir_fixture.inc"
+
+// Three registers of which the first is not preserved across calls, and two
+// float registers.
+static const struct mcc_regalloc_target target = {
+    .classes =
+        {
+            {.register_count = 3, .call_preserved = 0x6},
+            {.register_count = 2, .call_preserved = 0x3},
+        },
+    .type_classes = {[MCC_IR_TYPE_FLOAT] = 1, [MCC_IR_TYPE_INT4] = 1, [MCC_IR_TYPE_FLOAT4] = 1},
+};
+
+// Lowers and optimizes `input` into `module`, keeping the calls.
+static void lower(CuTest *tc, struct mcc_ir_module *module, const char *input)
+{
+	static const struct mcc_optimize_options options = {.inline_limit = 0};
+
+	lower_string(tc, module, input);
+	CuAssertTrue(tc, mcc_optimize(module, &options, NULL));
+}
+
+static void allocate(CuTest *tc, struct mcc_regalloc *allocation, const struct mcc_ir_function *function)
+{
+	struct mcc_cfg cfg;
+	CuAssertTrue(tc, mcc_cfg_build(&cfg, function));
+	CuAssertTrue(tc, mcc_regalloc_compute(allocation, &cfg, &target));
+	mcc_cfg_release(&cfg);
+}
+
+static bool share_register(const struct mcc_ir_function *function,
+                           const struct mcc_regalloc *allocation,
+                           uint32_t a,
+                           uint32_t b)
+{
+	return a != b && allocation->locations[a] < MCC_REGALLOC_UNUSED &&
+	       allocation->locations[a] == allocation->locations[b] &&
+	       target.type_classes[function->vreg_types[a]] == target.type_classes[function->vreg_types[b]];
+}
+
+// No two registers live at the same point, or written while the other is
+// live, share a register; registers live across calls are preserved.
+static void assert_valid(CuTest *tc, const struct mcc_ir_function *function, const struct mcc_regalloc *allocation)
+{
+	struct mcc_cfg cfg;
+	CuAssertTrue(tc, mcc_cfg_build(&cfg, function));
+	struct mcc_dataflow live;
+	CuAssertTrue(tc, mcc_liveness_compute(&live, &cfg));
+
+	mcc_bitset_word *set = calloc(live.word_count + 1, sizeof(*set));
+	CuAssertPtrNotNull(tc, set);
+
+	for (uint32_t b = 0; b < cfg.block_count; ++b) {
+		const struct mcc_cfg_block *block = &cfg.blocks[b];
+		mcc_bitset_copy(set, MCC_DATAFLOW_SET(&live, out, b), live.word_count);
+
+		for (uint32_t i = block->end; i-- > block->first;) {
+			const struct mcc_ir_instruction *instruction = &function->instructions[i];
+
+			mcc_ir_operand def = mcc_ir_defined_vreg(instruction);
+			for (uint32_t v = mcc_bitset_next(set, live.word_count, 0); v != MCC_BITSET_END;
+			     v = mcc_bitset_next(set, live.word_count, v + 1)) {
+				if (def != MCC_IR_NONE) {
+					uint32_t written = MCC_IR_OPERAND_INDEX(def);
+					CuAssertTrue(tc, !share_register(function, allocation, written, v));
+				}
+
+				uint8_t location = allocation->locations[v];
+				CuAssertTrue(tc, location != MCC_REGALLOC_UNUSED);
+				if (instruction->opcode == MCC_IR_CALL && v != MCC_IR_OPERAND_INDEX(def) &&
+				    location != MCC_REGALLOC_STACK) {
+					uint32_t class = target.type_classes[function->vreg_types[v]];
+					uint32_t preserved = target.classes[class].call_preserved;
+					CuAssertTrue(tc, preserved & (UINT32_C(1) << location));
+				}
+			}
+			if (def != MCC_IR_NONE) {
+				MCC_BITSET_CLEAR(set, MCC_IR_OPERAND_INDEX(def));
+			}
+
+			mcc_ir_operand uses[MCC_IR_MAX_USES];
+			uint32_t use_count = mcc_ir_used_vregs(instruction, uses);
+			for (uint32_t u = 0; u < use_count; ++u) {
+				MCC_BITSET_SET(set, MCC_IR_OPERAND_INDEX(uses[u]));
+			}
+
+			for (uint32_t v = mcc_bitset_next(set, live.word_count, 0); v != MCC_BITSET_END;
+			     v = mcc_bitset_next(set, live.word_count, v + 1)) {
+				for (uint32_t w = mcc_bitset_next(set, live.word_count, v + 1); w != MCC_BITSET_END;
+				     w = mcc_bitset_next(set, live.word_count, w + 1)) {
+					CuAssertTrue(tc, !share_register(function, allocation, v, w));
+				}
+			}
+		}
+	}
+
+	free(set);
+	mcc_dataflow_release(&live);
+	mcc_cfg_release(&cfg);
+}
+
+void Allocation(CuTest *tc)
+{
+	const char input[] = "int f(int a, int b) { int c; c = a + b; return c * a; }\n"
+	                     "int main() { return f(1, 2); }";
+
+	struct mcc_ir_module module;
+	lower(tc, &module, input);
+	struct mcc_ir_function *function = find(tc, &module, "f");
+
+	struct mcc_regalloc allocation;
+	allocate(tc, &allocation, function);
+	assert_valid(tc, function, &allocation);
+
+	// few values, nothing spilled
+	CuAssertTrue(tc, allocation.interval_count >= 2);
+	CuAssertIntEquals(tc, 0, (int)allocation.spill_count);
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		CuAssertTrue(tc, allocation.locations[v] != MCC_REGALLOC_STACK);
+	}
+
+	mcc_regalloc_release(&allocation);
+	mcc_ir_module_release(&module);
+}
+
+void Pressure(CuTest *tc)
+{
+	const char input[] = "int f(int a, int b, int c, int d, int e) { return a * b + c * d + e * (a - b); }\n"
+	                     "int main() { return f(1, 2, 3, 4, 5); }";
+
+	struct mcc_ir_module module;
+	lower(tc, &module, input);
+	struct mcc_ir_function *function = find(tc, &module, "f");
+
+	struct mcc_regalloc allocation;
+	allocate(tc, &allocation, function);
+	assert_valid(tc, function, &allocation);
+
+	uint32_t spilled = 0;
+	for (uint32_t v = 0; v < function->vreg_count; ++v) {
+		spilled += allocation.locations[v] == MCC_REGALLOC_STACK;
+	}
+	CuAssertTrue(tc, allocation.spill_count > 0);
+	CuAssertIntEquals(tc, (int)allocation.spill_count, (int)spilled);
+	CuAssertIntEquals(tc, 0x7, (int)allocation.used_registers[0]);
+
+	mcc_regalloc_release(&allocation);
+	mcc_ir_module_release(&module);
+}
+
+void Calls(CuTest *tc)
+{
+	const char input[] = "int g(int x) { return x; }\n"
+	                     "int f(int a) { int b; b = g(a); return a + b; }\n"
+	                     "int main() { return f(1); }";
+
+	struct mcc_ir_module module;
+	lower(tc, &module, input);
+	struct mcc_ir_function *function = find(tc, &module, "f");
+
+	struct mcc_regalloc allocation;
+	allocate(tc, &allocation, function);
+	assert_valid(tc, function, &allocation);
+
+	// a is live across the call and kept in a preserved register
+	CuAssertTrue(tc, allocation.locations[0] == 1 || allocation.locations[0] == 2);
+
+	mcc_regalloc_release(&allocation);
+	mcc_ir_module_release(&module);
+}
+
+void Assembly(CuTest *tc)
+{
+	const char input[] = "float half(float x) { return x / 2.0; }\n"
+	                     "int main() { int[4] a; a[1] = 3; print(\"x\\n\"); print_float(half(1.0)); return a[1]; }";
+
+	struct mcc_ir_module module;
+	lower(tc, &module, input);
+
+	char *code = NULL;
+	size_t code_size = 0;
+	FILE *out = open_memstream(&code, &code_size);
+	CuAssertPtrNotNull(tc, out);
+	char *report = NULL;
+	size_t report_size = 0;
+	FILE *spills = open_memstream(&report, &report_size);
+	CuAssertPtrNotNull(tc, spills);
+
+	struct mcc_asm_options options = {.spill_report = spills, .float_mode = MCC_ASM_FLOAT_X87};
+	CuAssertTrue(tc, mcc_asm_print(out, &module, &options));
+	fclose(out);
+	fclose(spills);
+
+	CuAssertPtrNotNull(tc, strstr(code, "\t.globl main\n"));
+	CuAssertPtrNotNull(tc, strstr(code, "main:\n\tpushl %ebp\n\tmovl %esp, %ebp\n"));
+	CuAssertPtrNotNull(tc, strstr(code, "\tcall print_float\n"));
+	CuAssertPtrNotNull(tc, strstr(code, "\tfdivs .LC"));
+	CuAssertPtrNotNull(tc, strstr(code, "\t.string \"x\\n\"\n"));
+	CuAssertPtrEquals(tc, NULL, strstr(code, "print_nl:"));
+
+	CuAssertPtrNotNull(tc, strstr(report, "half: 0 of 0 intervals spilled\n"));
+	CuAssertPtrNotNull(tc, strstr(report, "main: 0 of "));
+
+	free(code);
+	free(report);
+	mcc_ir_module_release(&module);
+}
+
+void SseAssembly(CuTest *tc)
+{
+	const char input[] = "float scale(float x, float y) { float z; z = -(x * y); return z / 2.0 + scale(z, x); }\n"
+	                     "int main() { print_float(scale(1.0, 2.0)); return 0; }";
+
+	struct mcc_ir_module module;
+	lower(tc, &module, input);
+
+	char *code = NULL;
+	size_t code_size = 0;
+	FILE *out = open_memstream(&code, &code_size);
+	CuAssertPtrNotNull(tc, out);
+	CuAssertTrue(tc, mcc_asm_print(out, &module, NULL));
+	fclose(out);
+
+	// no x87 arithmetic, only transfers of results
+	CuAssertPtrNotNull(tc, strstr(code, "\tmulss "));
+	CuAssertPtrNotNull(tc, strstr(code, "\tdivss .LC"));
+	CuAssertPtrNotNull(tc, strstr(code, "\txorps .Lsign_mask, %xmm"));
+	CuAssertPtrNotNull(tc, strstr(code, ".Lsign_mask:\n"));
+	CuAssertPtrNotNull(tc, strstr(code, "\tfstps "));
+	CuAssertPtrNotNull(tc, strstr(code, "\tflds "));
+	CuAssertPtrEquals(tc, NULL, strstr(code, "\tfadd"));
+	CuAssertPtrEquals(tc, NULL, strstr(code, "\tfmul"));
+	CuAssertPtrEquals(tc, NULL, strstr(code, "\tfchs"));
+
+	free(code);
+	mcc_ir_module_release(&module);
+}
+
+void Examples(CuTest *tc)
+{
+	DIR *examples = opendir(MCC_EXAMPLES_DIR);
+	CuAssertPtrNotNull(tc, examples);
+
+	unsigned count = 0;
+
+	struct dirent *example;
+	while ((example = readdir(examples))) {
+		if (example->d_name[0] == '.') {
+			continue;
+		}
+
+		// examples/<name>/<name>.mc
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s/%s.mc", MCC_EXAMPLES_DIR, example->d_name, example->d_name);
+
+		FILE *in = fopen(path, "r");
+		if (!in) {
+			continue;
+		}
+		struct mcc_parser_result result = mcc_parse_file(in);
+		fclose(in);
+
+		struct mcc_ir_module module;
+		lower_result(tc, &module, &result);
+		CuAssertTrue(tc, mcc_optimize(&module, NULL, NULL));
+
+		for (uint32_t i = 0; i < module.function_count; ++i) {
+			if (module.functions[i].builtin) {
+				continue;
+			}
+			struct mcc_regalloc allocation;
+			allocate(tc, &allocation, &module.functions[i]);
+			assert_valid(tc, &module.functions[i], &allocation);
+			mcc_regalloc_release(&allocation);
+		}
+
+		mcc_ir_module_release(&module);
+		count++;
+	}
+	closedir(examples);
+
+	CuAssertTrue(tc, count > 0);
+}
+
+#define TESTS \
+	TEST(Allocation) \
+	TEST(Pressure) \
+	TEST(Calls) \
+	TEST(Assembly) \
+	TEST(SseAssembly) \
+	TEST(Examples)
+
+#include "main_stub.inc"
@@ -0,0 +1,495 @@
+#include <CuTest.h>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ir.h"
+#include "mcc/optimize.h"
+#include "mcc/parser.h"
+#include "mcc/sccp.h"
+#include "mcc/ssa.h"
+
+#include "ir_fixture.inc"
+
+// Every register is written at most once.
+static void assert_single_assignment(CuTest *tc, const struct mcc_ir_function *function)
+{
+	uint32_t *defs = calloc(function->vreg_count + 1, sizeof(*defs));
+	CuAssertPtrNotNull(tc, defs);
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		mcc_ir_operand def = mcc_ir_defined_vreg(&function->instructions[i]);
+		if (def != MCC_IR_NONE) {
+			CuAssertIntEquals(tc, 0, (int)defs[MCC_IR_OPERAND_INDEX(def)]++);
+		}
+	}
+	free(defs);
+}
+
+// ------------------------------------------------------------------ Evaluator
+
+// Runs a function on int and bool registers without calls or arrays; returns
+// the value returned.
+static int32_t run(CuTest *tc, const struct mcc_ir_module *module, const struct mcc_ir_function *function,
+                   const int32_t *arguments)
+{
+	int32_t *registers = calloc(function->vreg_count + 1, sizeof(*registers));
+	CuAssertPtrNotNull(tc, registers);
+	for (uint32_t p = 0; p < function->parameter_count; ++p) {
+		registers[p] = arguments[p];
+	}
+
+#define VALUE(operand)                                                                                                 \
+	(MCC_IR_IS_VREG(operand) ? registers[MCC_IR_OPERAND_INDEX(operand)]                                            \
+	 : module->constants[MCC_IR_OPERAND_INDEX(operand)].type == MCC_IR_TYPE_BOOL                                   \
+	     ? module->constants[MCC_IR_OPERAND_INDEX(operand)].b_value                                                \
+	     : (int32_t)module->constants[MCC_IR_OPERAND_INDEX(operand)].i_value)
+
+	uint32_t pc = 0;
+	uint32_t steps = 0;
+	for (;;) {
+		CuAssertTrue(tc, pc < function->instruction_count && ++steps < 1000000);
+		const struct mcc_ir_instruction *instruction = &function->instructions[pc++];
+		int32_t *dest = MCC_IR_IS_VREG(instruction->dest) ? &registers[MCC_IR_OPERAND_INDEX(instruction->dest)]
+		                                                  : NULL;
+
+		uint32_t target = MCC_IR_OPERAND_MAX;
+		switch (instruction->opcode) {
+		case MCC_IR_NOP:
+		case MCC_IR_LABEL:
+			break;
+		case MCC_IR_COPY:
+			*dest = VALUE(instruction->a);
+			break;
+		case MCC_IR_ADD:
+			*dest = (int32_t)((uint32_t)VALUE(instruction->a) + (uint32_t)VALUE(instruction->b));
+			break;
+		case MCC_IR_SUB:
+			*dest = (int32_t)((uint32_t)VALUE(instruction->a) - (uint32_t)VALUE(instruction->b));
+			break;
+		case MCC_IR_MUL:
+			*dest = (int32_t)((uint32_t)VALUE(instruction->a) * (uint32_t)VALUE(instruction->b));
+			break;
+		case MCC_IR_DIV:
+			*dest = VALUE(instruction->a) / VALUE(instruction->b);
+			break;
+		case MCC_IR_NEG:
+			*dest = -VALUE(instruction->a);
+			break;
+		case MCC_IR_EQ:
+			*dest = VALUE(instruction->a) == VALUE(instruction->b);
+			break;
+		case MCC_IR_NE:
+			*dest = VALUE(instruction->a) != VALUE(instruction->b);
+			break;
+		case MCC_IR_LT:
+			*dest = VALUE(instruction->a) < VALUE(instruction->b);
+			break;
+		case MCC_IR_GT:
+			*dest = VALUE(instruction->a) > VALUE(instruction->b);
+			break;
+		case MCC_IR_LE:
+			*dest = VALUE(instruction->a) <= VALUE(instruction->b);
+			break;
+		case MCC_IR_GE:
+			*dest = VALUE(instruction->a) >= VALUE(instruction->b);
+			break;
+		case MCC_IR_AND:
+			*dest = VALUE(instruction->a) && VALUE(instruction->b);
+			break;
+		case MCC_IR_OR:
+			*dest = VALUE(instruction->a) || VALUE(instruction->b);
+			break;
+		case MCC_IR_NOT:
+			*dest = !VALUE(instruction->a);
+			break;
+		case MCC_IR_JUMP:
+			target = MCC_IR_OPERAND_INDEX(instruction->a);
+			break;
+		case MCC_IR_JUMP_IF_FALSE:
+			if (!VALUE(instruction->a)) {
+				target = MCC_IR_OPERAND_INDEX(instruction->b);
+			}
+			break;
+		case MCC_IR_JUMP_IF_TRUE:
+			if (VALUE(instruction->a)) {
+				target = MCC_IR_OPERAND_INDEX(instruction->b);
+			}
+			break;
+		case MCC_IR_RETURN: {
+			int32_t value = VALUE(instruction->a);
+			free(registers);
+			return value;
+		}
+		default:
+			CuFail(tc, "unsupported instruction");
+		}
+
+		if (target != MCC_IR_OPERAND_MAX) {
+			pc = 0;
+			while (function->instructions[pc].opcode != MCC_IR_LABEL ||
+			       MCC_IR_OPERAND_INDEX(function->instructions[pc].a) != target) {
+				CuAssertTrue(tc, ++pc < function->instruction_count);
+			}
+		}
+	}
+#undef VALUE
+}
+
+// Checks that `mcc_optimize` keeps the results of `name` in `input` for all
+// argument lists.
+static void assert_same_results(CuTest *tc,
+                                const char *input,
+                                const char *name,
+                                const int32_t (*arguments)[3],
+                                uint32_t argument_count)
+{
+	struct mcc_ir_module original;
+	struct mcc_ir_module optimized;
+	lower_string(tc, &original, input);
+	lower_string(tc, &optimized, input);
+	CuAssertTrue(tc, mcc_optimize(&optimized, NULL, NULL));
+
+	const struct mcc_ir_function *function = find(tc, &optimized, name);
+	CuAssertIntEquals(tc, 0, (int)count_opcode(function, MCC_IR_PHI));
+	CuAssertIntEquals(tc, 0, (int)count_opcode(function, MCC_IR_NOP));
+
+	for (uint32_t i = 0; i < argument_count; ++i) {
+		CuAssertIntEquals(tc, run(tc, &original, find(tc, &original, name), arguments[i]),
+		                  run(tc, &optimized, function, arguments[i]));
+	}
+
+	mcc_ir_module_release(&original);
+	mcc_ir_module_release(&optimized);
+}
+
+// ------------------------------------------------------------------- Tests
+
+void Construction(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower_string(tc, &module,
+	      "int f(int n)\n"
+	      "{\n"
+	      "\tint s;\n"
+	      "\tint t;\n"
+	      "\ts = 0;\n"
+	      "\twhile (n > 0) {\n"
+	      "\t\tt = n * 2;\n"
+	      "\t\ts = s + t;\n"
+	      "\t\tn = n - 1;\n"
+	      "\t}\n"
+	      "\treturn s;\n"
+	      "}\n");
+
+	struct mcc_ir_function *function = find(tc, &module, "f");
+	uint32_t vreg_count = function->vreg_count;
+
+	struct mcc_ssa ssa;
+	CuAssertTrue(tc, mcc_ssa_construct(&ssa, function));
+	assert_single_assignment(tc, function);
+
+	// s and n meet at the loop header; t is dead there and gets no phi
+	CuAssertIntEquals(tc, 2, (int)ssa.phi_count);
+	CuAssertIntEquals(tc, 2, (int)count_opcode(function, MCC_IR_PHI));
+	CuAssertIntEquals(tc, (int)vreg_count, (int)ssa.entry_vreg_count);
+
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *phi = &function->instructions[i];
+		if (phi->opcode != MCC_IR_PHI) {
+			continue;
+		}
+
+		// the entry value of n flows in unchanged, s starts as 0
+		CuAssertIntEquals(tc, 2, (int)MCC_IR_OPERAND_INDEX(phi->b));
+		CuAssertTrue(tc, MCC_IR_OPERAND_INDEX(phi->dest) >= vreg_count);
+		const mcc_ir_operand *operands = &function->phi_operands[MCC_IR_OPERAND_INDEX(phi->a)];
+		for (uint32_t o = 0; o < 2; ++o) {
+			CuAssertTrue(tc, MCC_IR_IS_VREG(operands[o]));
+			CuAssertTrue(tc, MCC_IR_OPERAND_INDEX(operands[o]) != MCC_IR_OPERAND_INDEX(phi->dest));
+		}
+		CuAssertTrue(tc, MCC_IR_OPERAND_INDEX(operands[0]) == 0 ||
+		                     MCC_IR_OPERAND_INDEX(operands[0]) >= vreg_count);
+	}
+
+	CuAssertTrue(tc, mcc_ssa_destruct(&ssa));
+	CuAssertIntEquals(tc, 0, (int)count_opcode(function, MCC_IR_PHI));
+	CuAssertIntEquals(tc, 0, (int)function->phi_operand_count);
+
+	mcc_ssa_release(&ssa);
+	mcc_ir_module_release(&module);
+}
+
+void Constants(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower_string(tc, &module,
+	      "int f()\n"
+	      "{\n"
+	      "\tint x;\n"
+	      "\tint y;\n"
+	      "\tx = 3;\n"
+	      "\tif (x > 2) { y = x * 2; } else { y = 0; }\n"
+	      "\twhile (y < 0) { y = y + 1; }\n"
+	      "\treturn y + 1;\n"
+	      "}\n");
+
+	struct mcc_ir_function *function = find(tc, &module, "f");
+	struct mcc_ssa ssa;
+	CuAssertTrue(tc, mcc_ssa_construct(&ssa, function));
+
+	struct mcc_sccp_stats stats = {0};
+	CuAssertTrue(tc, mcc_sccp(&module, &ssa, &stats));
+	CuAssertTrue(tc, mcc_ssa_destruct(&ssa));
+
+	// x > 2, x * 2, y < 0 and y + 1 fold; the else branch and the loop body
+	// are never executed
+	CuAssertIntEquals(tc, 2, (int)stats.removed_branches);
+	CuAssertIntEquals(tc, 2, (int)stats.unreachable_blocks);
+	CuAssertTrue(tc, stats.folded_constants >= 4);
+
+	CuAssertIntEquals(tc, 0, (int)count_opcode(function, MCC_IR_JUMP_IF_FALSE));
+	CuAssertIntEquals(tc, 0, (int)count_opcode(function, MCC_IR_MUL));
+	CuAssertIntEquals(tc, 0, (int)count_opcode(function, MCC_IR_ADD));
+
+	const struct mcc_ir_instruction *ret = &function->instructions[function->instruction_count - 1];
+	CuAssertIntEquals(tc, MCC_IR_RETURN, ret->opcode);
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_CONST, MCC_IR_OPERAND_KIND(ret->a));
+	CuAssertIntEquals(tc, 7, (int)module.constants[MCC_IR_OPERAND_INDEX(ret->a)].i_value);
+
+	mcc_ssa_release(&ssa);
+	mcc_ir_module_release(&module);
+}
+
+void LoopConstants(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower_string(tc, &module,
+	      "int f(int n)\n"
+	      "{\n"
+	      "\tint k;\n"
+	      "\tint i;\n"
+	      "\tk = 1;\n"
+	      "\ti = 0;\n"
+	      "\twhile (i < n) {\n"
+	      "\t\tk = k * 1;\n"
+	      "\t\ti = i + 1;\n"
+	      "\t}\n"
+	      "\treturn k;\n"
+	      "}\n");
+
+	struct mcc_optimize_stats stats;
+	CuAssertTrue(tc, mcc_optimize(&module, NULL, &stats));
+
+	// k is 1 on every iteration, only the loop on i remains
+	struct mcc_ir_function *function = find(tc, &module, "f");
+	CuAssertIntEquals(tc, 0, (int)count_opcode(function, MCC_IR_MUL));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(function, MCC_IR_ADD));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(function, MCC_IR_JUMP_IF_FALSE));
+	CuAssertIntEquals(tc, 0, (int)stats.sccp.removed_branches);
+
+	const struct mcc_ir_instruction *ret = &function->instructions[function->instruction_count - 1];
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_CONST, MCC_IR_OPERAND_KIND(ret->a));
+	CuAssertIntEquals(tc, 1, (int)module.constants[MCC_IR_OPERAND_INDEX(ret->a)].i_value);
+
+	mcc_ir_module_release(&module);
+}
+
+void Folding(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	lower_string(tc, &module,
+	      "int f() { return 2147483647 + 1; }\n"
+	      "int g() { return 1 / 0; }\n"
+	      "float h() { return 0.1 + 0.2; }\n"
+	      "bool b(bool x) { return x && false; }\n");
+	CuAssertTrue(tc, mcc_optimize(&module, NULL, NULL));
+
+	// int wraps at 32 bits
+	const struct mcc_ir_function *f = find(tc, &module, "f");
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_CONST, MCC_IR_OPERAND_KIND(f->instructions[0].a));
+	CuAssertTrue(tc, module.constants[MCC_IR_OPERAND_INDEX(f->instructions[0].a)].i_value == INT32_MIN);
+
+	// division by zero is left to run time
+	CuAssertIntEquals(tc, 1, (int)count_opcode(find(tc, &module, "g"), MCC_IR_DIV));
+
+	// float arithmetic is single precision
+	const struct mcc_ir_function *h = find(tc, &module, "h");
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_CONST, MCC_IR_OPERAND_KIND(h->instructions[0].a));
+	CuAssertTrue(tc, module.constants[MCC_IR_OPERAND_INDEX(h->instructions[0].a)].f_value == 0.1f + 0.2f);
+
+	const struct mcc_ir_function *b = find(tc, &module, "b");
+	CuAssertIntEquals(tc, MCC_IR_RETURN, b->instructions[0].opcode);
+	CuAssertIntEquals(tc, MCC_IR_OPERAND_CONST, MCC_IR_OPERAND_KIND(b->instructions[0].a));
+
+	mcc_ir_module_release(&module);
+}
+
+void Destruction(CuTest *tc)
+{
+	// critical edge into the join of the if, lost copy on the loop exit and
+	// a swap of a and b on the back edge
+	static const char input[] = "int f(int n, int a, int b)\n"
+	                            "{\n"
+	                            "\tint x;\n"
+	                            "\tx = 0;\n"
+	                            "\tif (n > 2) { x = n; }\n"
+	                            "\twhile (n > 0) {\n"
+	                            "\t\tint t;\n"
+	                            "\t\tt = a;\n"
+	                            "\t\ta = b;\n"
+	                            "\t\tb = t;\n"
+	                            "\t\tx = x + a;\n"
+	                            "\t\tif (x > 10) { return a * 100 + b; }\n"
+	                            "\t\tn = n - 1;\n"
+	                            "\t}\n"
+	                            "\treturn (a * 10 + b) * 100 + x;\n"
+	                            "}\n";
+
+	static const int32_t arguments[][3] = {
+	    {0, 1, 2}, {1, 1, 2}, {2, 3, 4}, {3, 1, 2}, {4, 5, 1}, {7, 1, 2}, {-1, 2, 3},
+	};
+	assert_same_results(tc, input, "f", arguments, sizeof(arguments) / sizeof(*arguments));
+}
+
+void Cycles(CuTest *tc)
+{
+	static const char input[] = "int f(int n, int a, int b)\n"
+	                            "{\n"
+	                            "\twhile (n > 0) {\n"
+	                            "\t\tint t;\n"
+	                            "\t\tt = a;\n"
+	                            "\t\ta = b;\n"
+	                            "\t\tb = t;\n"
+	                            "\t\tn = n - 1;\n"
+	                            "\t}\n"
+	                            "\treturn a * 10 + b;\n"
+	                            "}\n";
+
+	struct mcc_ir_module module;
+	lower_string(tc, &module, input);
+	struct mcc_ir_function *function = find(tc, &module, "f");
+
+	struct mcc_ssa ssa;
+	CuAssertTrue(tc, mcc_ssa_construct(&ssa, function));
+
+	// propagate the copies into the phis: the phis of a and b then read each
+	// other on the back edge and their copies form a cycle
+	mcc_ir_operand *sources = calloc(function->vreg_count, sizeof(*sources));
+	CuAssertPtrNotNull(tc, sources);
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *copy = &function->instructions[i];
+		if (copy->opcode == MCC_IR_COPY && MCC_IR_IS_VREG(copy->a)) {
+			sources[MCC_IR_OPERAND_INDEX(copy->dest)] = copy->a;
+		}
+	}
+	for (uint32_t o = 0; o < function->phi_operand_count; ++o) {
+		while (MCC_IR_IS_VREG(function->phi_operands[o]) &&
+		       sources[MCC_IR_OPERAND_INDEX(function->phi_operands[o])] != MCC_IR_NONE) {
+			function->phi_operands[o] = sources[MCC_IR_OPERAND_INDEX(function->phi_operands[o])];
+		}
+	}
+	free(sources);
+
+	uint32_t vreg_count = function->vreg_count;
+	CuAssertTrue(tc, mcc_ssa_destruct(&ssa));
+
+	// one register saves a value of the cycle
+	CuAssertIntEquals(tc, (int)vreg_count + 1, (int)function->vreg_count);
+
+	static const int32_t arguments[][3] = {{0, 1, 2}, {1, 1, 2}, {2, 1, 2}, {5, 3, 4}};
+	for (uint32_t i = 0; i < sizeof(arguments) / sizeof(*arguments); ++i) {
+		int32_t swapped = arguments[i][0] > 0 && arguments[i][0] % 2;
+		int32_t expected = swapped ? arguments[i][2] * 10 + arguments[i][1]
+		                           : arguments[i][1] * 10 + arguments[i][2];
+		CuAssertIntEquals(tc, expected, run(tc, &module, function, arguments[i]));
+	}
+
+	mcc_ssa_release(&ssa);
+	mcc_ir_module_release(&module);
+}
+
+void Coalescing(CuTest *tc)
+{
+	static const char input[] = "int f(int n)\n"
+	                            "{\n"
+	                            "\tint i;\n"
+	                            "\tint s;\n"
+	                            "\ti = 0;\n"
+	                            "\ts = 0;\n"
+	                            "\twhile (i < n) {\n"
+	                            "\t\ts = s + i;\n"
+	                            "\t\ti = i + 1;\n"
+	                            "\t}\n"
+	                            "\treturn s;\n"
+	                            "}\n";
+
+	static const int32_t arguments[][3] = {{0}, {1}, {5}, {-3}};
+	assert_same_results(tc, input, "f", arguments, sizeof(arguments) / sizeof(*arguments));
+
+	struct mcc_ir_module module;
+	lower_string(tc, &module, input);
+	struct mcc_optimize_stats stats;
+	CuAssertTrue(tc, mcc_optimize(&module, NULL, &stats));
+	CuAssertTrue(tc, stats.sccp.propagated_copies >= 2);
+
+	// the additions write the registers of their phis, only the copies of
+	// the initial values remain
+	CuAssertIntEquals(tc, 2, (int)count_opcode(find(tc, &module, "f"), MCC_IR_COPY));
+
+	mcc_ir_module_release(&module);
+}
+
+void Examples(CuTest *tc)
+{
+	DIR *examples = opendir(MCC_EXAMPLES_DIR);
+	CuAssertPtrNotNull(tc, examples);
+
+	unsigned count = 0;
+
+	struct dirent *example;
+	while ((example = readdir(examples))) {
+		if (example->d_name[0] == '.') {
+			continue;
+		}
+
+		// examples/<name>/<name>.mc
+		char path[1024];
+		snprintf(path, sizeof(path), "%s/%s/%s.mc", MCC_EXAMPLES_DIR, example->d_name, example->d_name);
+
+		FILE *in = fopen(path, "r");
+		if (!in) {
+			continue;
+		}
+		struct mcc_parser_result result = mcc_parse_file(in);
+		fclose(in);
+
+		struct mcc_ir_module module;
+		lower_result(tc, &module, &result);
+		CuAssertTrue(tc, mcc_optimize(&module, NULL, NULL));
+
+		for (uint32_t i = 0; i < module.function_count; ++i) {
+			CuAssertIntEquals(tc, 0, (int)count_opcode(&module.functions[i], MCC_IR_PHI));
+			CuAssertIntEquals(tc, 0, (int)count_opcode(&module.functions[i], MCC_IR_NOP));
+		}
+
+		mcc_ir_module_release(&module);
+		count++;
+	}
+	closedir(examples);
+
+	CuAssertTrue(tc, count > 0);
+}
+
+#define TESTS \
+	TEST(Construction) \
+	TEST(Constants) \
+	TEST(LoopConstants) \
+	TEST(Folding) \
+	TEST(Destruction) \
+	TEST(Cycles) \
+	TEST(Coalescing) \
+	TEST(Examples)
+
+#include "main_stub.inc"
@@ -0,0 +1,250 @@
+#include <CuTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ast.h"
+#include "mcc/parser.h"
+#include "mcc/symbol_table.h"
+#include "mcc/symbol_table_print.h"
+
+static struct mcc_ast_declaration *new_declaration(struct mcc_arena *arena, const char *name)
+{
+	return mcc_ast_new_declaration(arena, MCC_AST_DATA_TYPE_INT, NULL, mcc_ast_new_identifier(arena, name));
+}
+
+void Shadowing(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_symbol_table table;
+	mcc_symbol_table_init(&table);
+
+	struct mcc_ast_declaration *outer = new_declaration(&arena, "x");
+	struct mcc_ast_declaration *inner = new_declaration(&arena, "x");
+	struct mcc_ast_declaration *other = new_declaration(&arena, "y");
+	const char *x = outer->identifier->i_value;
+	const char *y = other->identifier->i_value;
+
+	CuAssertPtrEquals(tc, NULL, (void *)mcc_symbol_table_lookup(&table, x));
+
+	const struct mcc_symbol *outer_symbol;
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK,
+	                  mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_VARIABLE, outer, &outer_symbol));
+	CuAssertPtrEquals(tc, outer, outer_symbol->declaration);
+	CuAssertIntEquals(tc, 0, (int)outer_symbol->depth);
+
+	CuAssertTrue(tc, mcc_symbol_table_push_scope(&table));
+
+	const struct mcc_symbol *inner_symbol;
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK,
+	                  mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_VARIABLE, inner, &inner_symbol));
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK,
+	                  mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_VARIABLE, other, NULL));
+	CuAssertPtrEquals(tc, (void *)outer_symbol, (void *)inner_symbol->shadowed);
+	CuAssertPtrEquals(tc, (void *)inner_symbol, (void *)mcc_symbol_table_lookup(&table, x));
+	CuAssertPtrNotNull(tc, (void *)mcc_symbol_table_lookup(&table, y));
+
+	size_t count;
+	const struct mcc_symbol *const *scope = mcc_symbol_table_scope(&table, &count);
+	CuAssertIntEquals(tc, 2, (int)count);
+	CuAssertPtrEquals(tc, (void *)inner_symbol, (void *)scope[0]);
+
+	mcc_symbol_table_pop_scope(&table);
+
+	CuAssertPtrEquals(tc, (void *)outer_symbol, (void *)mcc_symbol_table_lookup(&table, x));
+	CuAssertPtrEquals(tc, NULL, (void *)mcc_symbol_table_lookup(&table, y));
+
+	// symbols of left scopes stay valid
+	CuAssertPtrEquals(tc, inner, inner_symbol->declaration);
+
+	mcc_symbol_table_release(&table);
+	mcc_arena_release(&arena);
+}
+
+void Duplicate(CuTest *tc)
+{
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_symbol_table table;
+	mcc_symbol_table_init(&table);
+	CuAssertTrue(tc, mcc_symbol_table_push_scope(&table));
+
+	struct mcc_ast_declaration *first = new_declaration(&arena, "x");
+	struct mcc_ast_declaration *second = new_declaration(&arena, "x");
+
+	const struct mcc_symbol *symbol;
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK,
+	                  mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_PARAMETER, first, &symbol));
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_DUPLICATE,
+	                  mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_VARIABLE, second, &symbol));
+	CuAssertPtrEquals(tc, first, symbol->declaration);
+	CuAssertIntEquals(tc, MCC_SYMBOL_KIND_PARAMETER, symbol->kind);
+
+	mcc_symbol_table_pop_scope(&table);
+	CuAssertPtrEquals(tc, NULL, (void *)mcc_symbol_table_lookup(&table, first->identifier->i_value));
+
+	mcc_symbol_table_release(&table);
+	mcc_arena_release(&arena);
+}
+
+void DeepNesting(CuTest *tc)
+{
+	enum { DEPTH = 10000 };
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_symbol_table table;
+	mcc_symbol_table_init(&table);
+
+	struct mcc_ast_declaration *global = new_declaration(&arena, "global");
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK,
+	                  mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_VARIABLE, global, NULL));
+
+	// every scope shadows `x` and declares a name of its own
+	for (int i = 0; i < DEPTH; ++i) {
+		char name[32];
+		snprintf(name, sizeof(name), "v%d", i);
+
+		CuAssertTrue(tc, mcc_symbol_table_push_scope(&table));
+		CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK,
+		                  mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_VARIABLE,
+		                                                    new_declaration(&arena, "x"), NULL));
+		CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK,
+		                  mcc_symbol_table_declare_variable(&table, MCC_SYMBOL_KIND_VARIABLE,
+		                                                    new_declaration(&arena, name), NULL));
+	}
+
+	const struct mcc_symbol *symbol = mcc_symbol_table_lookup(&table, global->identifier->i_value);
+	CuAssertPtrEquals(tc, global, symbol->declaration);
+
+	const char *x = new_declaration(&arena, "x")->identifier->i_value;
+	for (int i = DEPTH; i > 0; --i) {
+		symbol = mcc_symbol_table_lookup(&table, x);
+		CuAssertIntEquals(tc, i, (int)symbol->depth);
+		mcc_symbol_table_pop_scope(&table);
+	}
+
+	CuAssertPtrEquals(tc, NULL, (void *)mcc_symbol_table_lookup(&table, x));
+	CuAssertIntEquals(tc, 1, (int)table.log_count);
+
+	mcc_symbol_table_release(&table);
+	mcc_arena_release(&arena);
+}
+
+void Builtins(CuTest *tc)
+{
+	struct mcc_symbol_table table;
+	mcc_symbol_table_init(&table);
+
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK, mcc_symbol_table_declare_builtins(&table));
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+	const char *name = mcc_ast_new_identifier(&arena, "print_int")->i_value;
+
+	const struct mcc_symbol *symbol = mcc_symbol_table_lookup(&table, name);
+	CuAssertPtrNotNull(tc, (void *)symbol);
+	CuAssertIntEquals(tc, MCC_SYMBOL_KIND_BUILTIN, symbol->kind);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_VOID, symbol->function_def->type);
+	CuAssertPtrNotNull(tc, symbol->function_def->parameter);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_INT, symbol->function_def->parameter->declaration->type);
+	CuAssertPtrEquals(tc, NULL, symbol->function_def->parameter->next);
+
+	mcc_arena_release(&arena);
+	mcc_symbol_table_release(&table);
+}
+
+// The AST is gone once this returns, hence the duplicate identifier (if any)
+// is copied to `duplicate`.
+static char *print_program(CuTest *tc, const char *input, const char *function, enum mcc_symbol_table_status *status,
+                           struct mcc_ast_identifier *duplicate)
+{
+	struct mcc_parser_result result = mcc_parse_string(input);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	char *text = NULL;
+	size_t len = 0;
+	FILE *out = open_memstream(&text, &len);
+	CuAssertPtrNotNull(tc, out);
+
+	struct mcc_ast_identifier *identifier = NULL;
+	*status = mcc_symbol_table_print(out, result.program, function, &identifier);
+	fclose(out);
+
+	if (duplicate && identifier) {
+		*duplicate = *identifier;
+	}
+
+	mcc_parser_delete_result(&result);
+	return text;
+}
+
+void Print(CuTest *tc)
+{
+	const char input[] = "int f(int x)\n"
+	                     "{\n"
+	                     "\tint y;\n"
+	                     "\t{\n"
+	                     "\t\tfloat[4] x;\n"
+	                     "\t}\n"
+	                     "\treturn x;\n"
+	                     "}\n"
+	                     "void main() { }\n";
+
+	enum mcc_symbol_table_status status;
+	char *text = print_program(tc, input, "f", &status, NULL);
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK, status);
+	CuAssertStrEquals(tc,
+	                  "  function f at 1:1\n"
+	                  "    parameter int x at 1:11\n"
+	                  "    variable  int y at 3:6\n"
+	                  "    block at 4:2\n"
+	                  "      variable  float[4] x at 5:12, shadows 1:11\n",
+	                  text);
+	free(text);
+
+	text = print_program(tc, input, NULL, &status, NULL);
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_OK, status);
+	CuAssertTrue(tc, strstr(text, "global\n  builtin   void print(string)\n") == text);
+	CuAssertPtrNotNull(tc, strstr(text, "  function  int f(int) at 1:5\n"));
+	CuAssertPtrNotNull(tc, strstr(text, "  function main at 9:1\n"));
+	free(text);
+}
+
+void PrintDuplicate(CuTest *tc)
+{
+	enum mcc_symbol_table_status status;
+	struct mcc_ast_identifier duplicate = {0};
+
+	char *text = print_program(tc, "void f(int a) { int b; { int a; } int a; }", NULL, &status, &duplicate);
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_DUPLICATE, status);
+	CuAssertStrEquals(tc, "a", duplicate.i_value);
+	CuAssertIntEquals(tc, 1, duplicate.node.sloc.start_line);
+	CuAssertIntEquals(tc, 39, duplicate.node.sloc.start_col);
+	free(text);
+
+	text = print_program(tc, "void f() { } int f() { return 1; }", NULL, &status, &duplicate);
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_DUPLICATE, status);
+	CuAssertIntEquals(tc, 18, duplicate.node.sloc.start_col);
+	free(text);
+
+	// built-ins cannot be redefined
+	text = print_program(tc, "void print_nl() { }", NULL, &status, &duplicate);
+	CuAssertIntEquals(tc, MCC_SYMBOL_TABLE_DUPLICATE, status);
+	free(text);
+}
+
+#define TESTS \
+	TEST(Shadowing) \
+	TEST(Duplicate) \
+	TEST(DeepNesting) \
+	TEST(Builtins) \
+	TEST(Print) \
+	TEST(PrintDuplicate)
+
+#include "main_stub.inc"
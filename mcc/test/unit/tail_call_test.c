@@ -0,0 +1,159 @@
+#include <CuTest.h>
+
+#include "mcc/ir.h"
+#include "mcc/optimize.h"
+#include "mcc/tail_call.h"
+
+#include "ir_fixture.inc"
+
+// Lowers `input` into `module` and eliminates the tail calls of all functions.
+static struct mcc_tail_call_stats lower(CuTest *tc, struct mcc_ir_module *module, const char *input)
+{
+	lower_string(tc, module, input);
+
+	struct mcc_tail_call_stats stats = {0};
+	for (uint32_t i = 0; i < module->function_count; ++i) {
+		if (!module->functions[i].builtin) {
+			CuAssertTrue(tc, mcc_tail_call_eliminate(module, i, &stats));
+		}
+	}
+	return stats;
+}
+
+// ---------------------------------------------------------------------- Tests
+
+void TailCalls(CuTest *tc)
+{
+	const char input[] = "int gcd(int a, int b) { if (b == 0) return a; return gcd(b, a - a / b * b); }\n"
+	                     "void count(int n) { if (n == 0) return; print_int(n); count(n - 1); }\n"
+	                     "int main() { count(gcd(12, 8)); return 0; }";
+
+	struct mcc_ir_module module;
+	struct mcc_tail_call_stats stats = lower(tc, &module, input);
+	CuAssertIntEquals(tc, 2, (int)stats.tail_calls);
+	CuAssertIntEquals(tc, 0, (int)stats.accumulated_calls);
+
+	struct mcc_ir_function *gcd = find(tc, &module, "gcd");
+	CuAssertIntEquals(tc, 0, (int)count_opcode(gcd, MCC_IR_CALL));
+	CuAssertIntEquals(tc, 0, (int)count_opcode(gcd, MCC_IR_ARG));
+
+	// the parameters are swapped through a saved copy, then jump to the start
+	CuAssertIntEquals(tc, MCC_IR_NOP, gcd->instructions[0].opcode);
+	CuAssertIntEquals(tc, MCC_IR_LABEL, gcd->instructions[1].opcode);
+	CuAssertIntEquals(tc, 3, (int)count_opcode(gcd, MCC_IR_COPY));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(gcd, MCC_IR_JUMP));
+
+	// calls of other functions stay
+	struct mcc_ir_function *count = find(tc, &module, "count");
+	CuAssertIntEquals(tc, 1, (int)count_opcode(count, MCC_IR_CALL));
+
+	mcc_ir_module_release(&module);
+}
+
+void Accumulated(CuTest *tc)
+{
+	const char input[] = "int factorial(int n) { if (n < 2) return 1; return n * factorial(n - 1); }\n"
+	                     "int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+	                     "bool any(int[4] a, int n) { if (n == 0) return false; "
+	                     "return a[n - 1] > 0 || any(a, n - 1); }\n"
+	                     "int main() { return factorial(5) + fib(10); }";
+
+	struct mcc_ir_module module;
+	struct mcc_tail_call_stats stats = lower(tc, &module, input);
+	CuAssertIntEquals(tc, 0, (int)stats.tail_calls);
+	CuAssertIntEquals(tc, 3, (int)stats.accumulated_calls);
+
+	// the accumulator starts at 1 and is multiplied into the result
+	struct mcc_ir_function *factorial = find(tc, &module, "factorial");
+	CuAssertIntEquals(tc, 0, (int)count_opcode(factorial, MCC_IR_CALL));
+	const struct mcc_ir_instruction *init = &factorial->instructions[0];
+	CuAssertIntEquals(tc, MCC_IR_COPY, init->opcode);
+	CuAssertIntEquals(tc, 1, (int)module.constants[MCC_IR_OPERAND_INDEX(init->a)].i_value);
+	CuAssertIntEquals(tc, 4, (int)count_opcode(factorial, MCC_IR_MUL));
+
+	// one of the two calls remains
+	CuAssertIntEquals(tc, 1, (int)count_opcode(find(tc, &module, "fib"), MCC_IR_CALL));
+
+	// or accumulates bools
+	CuAssertIntEquals(tc, 0, (int)count_opcode(find(tc, &module, "any"), MCC_IR_CALL));
+
+	mcc_ir_module_release(&module);
+}
+
+void Kept(CuTest *tc)
+{
+	static const char *const inputs[] = {
+	    // float arithmetic is not reordered
+	    "float power(int n) { if (n == 0) return 1.0; return 2.0 * power(n - 1); }",
+	    // not commutative
+	    "int alternate(int n) { if (n == 0) return 0; return n - alternate(n - 1); }",
+	    // the result is used otherwise
+	    "int twice(int n) { int r; if (n == 0) return 0; r = twice(n - 1); return r + r; }",
+	    "int more(int n) { if (n == 0) return 0; return (more(n - 1) + 1) * 2; }",
+	    // another function
+	    "int other(int n) { return n; } int call(int n) { return other(n); }",
+	};
+
+	for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i) {
+		struct mcc_ir_module module;
+		struct mcc_tail_call_stats stats = lower(tc, &module, inputs[i]);
+		CuAssertIntEquals(tc, 0, (int)(stats.tail_calls + stats.accumulated_calls));
+		mcc_ir_module_release(&module);
+	}
+}
+
+void LocalArrays(CuTest *tc)
+{
+	// the next iteration would overwrite b while reading it as a
+	const char input[] = "void f(int[2] a, int n) { int[2] b; b[0] = a[0] + 1; b[1] = a[0] * 10 + a[1];"
+	                     "  if (n == 0) { print_int(b[0]); print(\" \"); print_int(b[1]); return; } f(b, n - 1); }";
+
+	struct mcc_ir_module module;
+	struct mcc_tail_call_stats stats = lower(tc, &module, input);
+	CuAssertIntEquals(tc, 0, (int)(stats.tail_calls + stats.accumulated_calls));
+	mcc_ir_module_release(&module);
+
+	// passing on an array of the caller is fine
+	stats = lower(tc, &module, "int sum(int[4] a, int i) { if (i == 4) return 0; return a[i] + sum(a, i + 1); }");
+	CuAssertIntEquals(tc, 1, (int)stats.accumulated_calls);
+	mcc_ir_module_release(&module);
+}
+
+void MixedOperations(CuTest *tc)
+{
+	// only the operation found first is accumulated
+	const char input[] = "int mixed(int n) { if (n == 0) return 1; if (n < 10) return n + mixed(n - 1); "
+	                     "return n * mixed(n - 1); }";
+
+	struct mcc_ir_module module;
+	struct mcc_tail_call_stats stats = lower(tc, &module, input);
+	CuAssertIntEquals(tc, 1, (int)stats.accumulated_calls);
+	CuAssertIntEquals(tc, 1, (int)count_opcode(find(tc, &module, "mixed"), MCC_IR_CALL));
+	mcc_ir_module_release(&module);
+}
+
+void Optimized(CuTest *tc)
+{
+	const char input[] = "int sum(int n) { if (n == 0) return 0; return n + sum(n - 1); }\n"
+	                     "int main() { return sum(3); }";
+
+	struct mcc_ir_module module;
+	lower_string(tc, &module, input);
+
+	struct mcc_optimize_stats stats;
+	CuAssertTrue(tc, mcc_optimize(&module, NULL, &stats));
+	CuAssertIntEquals(tc, 1, (int)stats.tail_calls.accumulated_calls);
+	CuAssertIntEquals(tc, 0, (int)count_opcode(find(tc, &module, "sum"), MCC_IR_CALL));
+
+	mcc_ir_module_release(&module);
+}
+
+#define TESTS \
+	TEST(TailCalls) \
+	TEST(Accumulated) \
+	TEST(Kept) \
+	TEST(LocalArrays) \
+	TEST(MixedOperations) \
+	TEST(Optimized)
+
+#include "main_stub.inc"
@@ -0,0 +1,194 @@
+#include <CuTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/ast.h"
+#include "mcc/parser.h"
+#include "mcc/type_check.h"
+
+void Types(CuTest *tc)
+{
+	const char input[] = "float f(int[3] a, float x)\n"
+	                     "{\n"
+	                     "\tif (a[0] < 2 && !(x == 1.5)) return -x;\n"
+	                     "\treturn x * 2.0;\n"
+	                     "}\n";
+
+	struct mcc_parser_result result = mcc_parse_string(input);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_type_check_result check = mcc_type_check(result.program);
+	CuAssertIntEquals(tc, MCC_TYPE_CHECK_OK, check.status);
+	CuAssertIntEquals(tc, 1, (int)check.function_count);
+	CuAssertIntEquals(tc, 15, (int)check.entry_count);
+
+	// the condition is typed in post-order, its root comes last
+	struct mcc_ast_statement *if_stmt = result.program->function_def->compund_statement->compound_statement->statement;
+	struct mcc_ast_expression *condition = if_stmt->if_condition;
+	CuAssertIntEquals(tc, 9, (int)condition->type_index);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_BOOL, mcc_type_check_type_of(&check, condition)->base);
+
+	const struct mcc_type *element = mcc_type_check_type_of(&check, condition->lhs->lhs);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_INT, element->base);
+	CuAssertIntEquals(tc, -1, (int)element->array_size);
+
+	// every entry refers back to its expression
+	for (size_t i = 0; i < check.entry_count; ++i) {
+		CuAssertIntEquals(tc, (int)i, (int)check.entries[i].expression->type_index);
+	}
+
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
+}
+
+void Trace(CuTest *tc)
+{
+	const char input[] = "int f(int[3] a) { return a[1] + g(a); }\n"
+	                     "int g(int[3] b) { print_int(b[0]); return 0; }\n";
+
+	struct mcc_parser_result result = mcc_parse_string(input);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_type_check_result check = mcc_type_check(result.program);
+	CuAssertIntEquals(tc, MCC_TYPE_CHECK_OK, check.status);
+
+	char *text = NULL;
+	size_t len = 0;
+	FILE *out = open_memstream(&text, &len);
+	CuAssertPtrNotNull(tc, out);
+	mcc_type_check_trace(out, &check, "f");
+	fclose(out);
+
+	CuAssertStrEquals(tc,
+	                  "function f\n"
+	                  "  1:28    int        literal\n"
+	                  "  1:26    int        element a\n"
+	                  "  1:35    int[3]     identifier a\n"
+	                  "  1:33    int        call g\n"
+	                  "  1:26    int        binary +\n",
+	                  text);
+	free(text);
+
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
+}
+
+// Returns the error message of checking `input` and stores its location in
+// `line` and `col`.
+static char *check_error(CuTest *tc, const char *input, int *line, int *col)
+{
+	struct mcc_parser_result result = mcc_parse_string(input);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_type_check_result check = mcc_type_check(result.program);
+	CuAssertIntEquals(tc, MCC_TYPE_CHECK_ERROR, check.status);
+
+	char *error = strdup(check.error);
+	*line = check.error_sloc.start_line;
+	*col = check.error_sloc.start_col;
+
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
+	return error;
+}
+
+void Errors(CuTest *tc)
+{
+	static const struct {
+		const char *input;
+		const char *error;
+		int col;
+	} cases[] = {
+	    {"void f() { 1 + 1.0; }", "invalid operands to binary '+' (have 'int' and 'float')", 12},
+	    {"void f() { -true; }", "invalid operand to unary '-' (have 'bool')", 12},
+	    {"void f() { \"a\" == \"b\"; }", "invalid operands to binary '==' (have 'string' and 'string')", 12},
+	    {"void f(int[2] a) { a + a; }", "invalid operands to binary '+' (have 'int[2]' and 'int[2]')", 20},
+	    {"void f() { if (1) return; }", "condition must be 'bool' (have 'int')", 16},
+	    {"void f() { while (print_nl()) { } }", "condition must be 'bool' (have 'void')", 19},
+	    {"void f() { int x; x = 1.0; }", "cannot assign 'float' to 'x' of type 'int'", 23},
+	    {"void f() { int[2] a; a = 1; }", "assignment to array 'a'", 22},
+	    {"void f() { int[2] a; a[true] = 1; }", "array index must be 'int' (have 'bool')", 24},
+	    {"void f() { int a; a[0]; }", "subscripted value 'a' is not an array", 19},
+	    {"int f() { return; }", "non-void function 'f' should return a value", 11},
+	    {"void f() { return 1; }", "void function 'f' should not return a value", 19},
+	    {"int f() { return 1.0; }", "returning 'float' from function 'f' with return type 'int'", 18},
+	    {"void f() { y; }", "use of undeclared identifier 'y'", 12},
+	    {"void f() { f; }", "function 'f' used as a variable", 12},
+	    {"void f() { g(); }", "call to undeclared function 'g'", 12},
+	    {"void f(int x) { x(); }", "called object 'x' is not a function", 17},
+	    {"void f() { print_int(); }", "too few arguments to function 'print_int'", 12},
+	    {"void f() { print_nl(1); }", "too many arguments to function 'print_nl'", 12},
+	    {"void f() { print(1); }", "argument 1 of 'print' must be 'string' (have 'int')", 18},
+	    {"void f(int[2] a) { } void g() { int[3] b; f(b); }", "argument 1 of 'f' must be 'int[2]' (have 'int[3]')",
+	     45},
+	    {"void f(int x) { float x; }", "redeclaration of 'x'", 23},
+	    {"void f() { } void f() { }", "redefinition of function 'f'", 19},
+	};
+
+	for (size_t i = 0; i < sizeof(cases) / sizeof(*cases); ++i) {
+		int line, col;
+		char *error = check_error(tc, cases[i].input, &line, &col);
+		CuAssertStrEquals_Msg(tc, cases[i].input, cases[i].error, error);
+		CuAssertIntEquals_Msg(tc, cases[i].input, 1, line);
+		CuAssertIntEquals_Msg(tc, cases[i].input, cases[i].col, col);
+		free(error);
+	}
+}
+
+void Scopes(CuTest *tc)
+{
+	const char input[] = "bool f(int x) { { float x; x = 1.0; } { bool x; x = true; return x; } }";
+
+	struct mcc_parser_result result = mcc_parse_string(input);
+	CuAssertIntEquals(tc, MCC_PARSER_STATUS_OK, result.status);
+
+	struct mcc_type_check_result check = mcc_type_check(result.program);
+	CuAssertIntEquals(tc, MCC_TYPE_CHECK_OK, check.status);
+	CuAssertIntEquals(tc, 3, (int)check.entry_count);
+
+	mcc_type_check_delete_result(&check);
+	mcc_parser_delete_result(&result);
+}
+
+void DeepChain(CuTest *tc)
+{
+	// `return 1 + 1 + ... + 1;` of one million operands
+	const size_t operands = 1000000;
+
+	struct mcc_arena arena;
+	mcc_arena_init(&arena);
+
+	struct mcc_ast_expression *chain = mcc_ast_new_expression_literal(&arena, mcc_ast_new_literal_int(&arena, 1));
+	for (size_t i = 1; i < operands; ++i) {
+		struct mcc_ast_expression *rhs = mcc_ast_new_expression_literal(&arena, mcc_ast_new_literal_int(&arena, 1));
+		chain = mcc_ast_new_expression_binary_op(&arena, MCC_AST_BINARY_OP_ADD, chain, rhs);
+		CuAssertPtrNotNull(tc, chain);
+	}
+
+	struct mcc_ast_statement *body = mcc_ast_new_statement_compound(
+	    &arena, mcc_ast_new_statement_list(&arena, mcc_ast_new_statement_return(&arena, chain)));
+	struct mcc_ast_function_def *main_def =
+	    mcc_ast_new_function_def(&arena, MCC_AST_DATA_TYPE_INT, mcc_ast_new_identifier(&arena, "main"), NULL, body);
+	struct mcc_ast_program *program = mcc_ast_new_program(&arena, main_def);
+	CuAssertPtrNotNull(tc, program);
+
+	struct mcc_type_check_result check = mcc_type_check(program);
+	CuAssertIntEquals(tc, MCC_TYPE_CHECK_OK, check.status);
+	CuAssertIntEquals(tc, (int)(2 * operands - 1), (int)check.entry_count);
+	CuAssertIntEquals(tc, (int)(2 * operands - 2), (int)chain->type_index);
+	CuAssertIntEquals(tc, MCC_AST_DATA_TYPE_INT, mcc_type_check_type_of(&check, chain)->base);
+
+	mcc_type_check_delete_result(&check);
+	mcc_arena_release(&arena);
+}
+
+#define TESTS \
+	TEST(Types) \
+	TEST(Trace) \
+	TEST(Errors) \
+	TEST(Scopes) \
+	TEST(DeepChain)
+
+#include "main_stub.inc"
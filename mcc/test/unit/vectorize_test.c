@@ -0,0 +1,138 @@
+#include <CuTest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mcc/asm.h"
+#include "mcc/ir.h"
+#include "mcc/optimize.h"
+
+#include "ir_fixture.inc"
+
+// Lowers and optimizes `input` into `module`, returning the count of loops
+// vectorized.
+static uint32_t lower(CuTest *tc, struct mcc_ir_module *module, const char *input)
+{
+	lower_string(tc, module, input);
+
+	struct mcc_optimize_stats stats;
+	CuAssertTrue(tc, mcc_optimize(module, NULL, &stats));
+	return stats.vectorize.vectorized_loops;
+}
+
+// Wraps a loop body over the arrays `a`, `b` and `c` of 10 elements in a
+// function with the parameter `x`.
+#define FUNCTION(name, type, body)                                                                                     \
+	"void " name "(" type " x) { " type "[10] a; " type "[10] b; " type "[10] c; int i; i = 0; "                \
+	"while (i < 10) { " body " i = i + 1; } }"
+
+#define LOOP(type, body) FUNCTION("f", type, body)
+
+// ---------------------------------------------------------------------- Tests
+
+void ElementWise(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	CuAssertIntEquals(tc, 1, (int)lower(tc, &module, LOOP("int", "c[i] = a[i] + b[i] - 3;")));
+
+	struct mcc_ir_function *function = find(tc, &module, "f");
+	CuAssertIntEquals(tc, 2, (int)count_opcode(function, MCC_IR_VLOAD));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(function, MCC_IR_VSTORE));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(function, MCC_IR_SPLAT));
+
+	// the scalar loop stays for the remaining iterations
+	CuAssertIntEquals(tc, 2, (int)count_opcode(function, MCC_IR_LOAD));
+	CuAssertIntEquals(tc, 1, (int)count_opcode(function, MCC_IR_STORE));
+
+	// the vector loop runs while four elements remain
+	bool bound = false;
+	for (uint32_t i = 0; i < function->instruction_count; ++i) {
+		const struct mcc_ir_instruction *instruction = &function->instructions[i];
+		if (instruction->opcode == MCC_IR_LT && MCC_IR_OPERAND_KIND(instruction->b) == MCC_IR_OPERAND_CONST) {
+			bound |= module.constants[MCC_IR_OPERAND_INDEX(instruction->b)].i_value == 7;
+		}
+	}
+	CuAssertTrue(tc, bound);
+
+	mcc_ir_module_release(&module);
+}
+
+void Invariants(CuTest *tc)
+{
+	struct mcc_ir_module module;
+	CuAssertIntEquals(tc, 1, (int)lower(tc, &module, LOOP("float", "c[i] = a[i] * x / 2.0 + x; b[i] = x;")));
+
+	// each invariant is splat once
+	struct mcc_ir_function *function = find(tc, &module, "f");
+	CuAssertIntEquals(tc, 2, (int)count_opcode(function, MCC_IR_SPLAT));
+	CuAssertIntEquals(tc, 2, (int)count_opcode(function, MCC_IR_VSTORE));
+
+	mcc_ir_module_release(&module);
+}
+
+void Rejected(CuTest *tc)
+{
+	static const char *const inputs[] = {
+	    // no packed int multiply
+	    LOOP("int", "c[i] = a[i] * b[i];"),
+	    // values carried between iterations
+	    LOOP("int", "x = x + a[i]; c[i] = x;"),
+	    LOOP("int", "c[i] = a[i + 1];"),
+	    LOOP("int", "c[i] = i;"),
+	    // no stores
+	    LOOP("int", "x = a[i];"),
+	    // calls and branches
+	    LOOP("int", "print_int(a[i]);"),
+	    LOOP("int", "if (a[i] < 0) c[i] = 0;"),
+	    // loops too short or without a constant bound
+	    "void f(int[3] a) { int i; i = 0; while (i < 3) { a[i] = 0; i = i + 1; } }",
+	    "void f(int n) { int[10] a; int i; i = 0; while (i < n) { a[i] = 0; i = i + 1; } }",
+	    // another step
+	    "void f() { int[10] a; int i; i = 0; while (i < 10) { a[i] = 0; i = i + 2; } }",
+	};
+
+	for (size_t i = 0; i < sizeof(inputs) / sizeof(*inputs); ++i) {
+		struct mcc_ir_module module;
+		CuAssertIntEquals(tc, 0, (int)lower(tc, &module, inputs[i]));
+		CuAssertIntEquals(tc, 0, (int)count_opcode(find(tc, &module, "f"), MCC_IR_VSTORE));
+		mcc_ir_module_release(&module);
+	}
+}
+
+void Assembly(CuTest *tc)
+{
+	const char input[] =
+	    FUNCTION("f", "int", "c[i] = a[i] - b[i] + x;") FUNCTION("g", "float", "c[i] = a[i] / b[i];");
+
+	struct mcc_ir_module module;
+	CuAssertIntEquals(tc, 2, (int)lower(tc, &module, input));
+
+	static const struct mcc_asm_options x87 = {.float_mode = MCC_ASM_FLOAT_X87};
+	const struct mcc_asm_options *modes[] = {NULL, &x87};
+	for (size_t m = 0; m < sizeof(modes) / sizeof(*modes); ++m) {
+		char *code = NULL;
+		size_t code_size = 0;
+		FILE *out = open_memstream(&code, &code_size);
+		CuAssertPtrNotNull(tc, out);
+		CuAssertTrue(tc, mcc_asm_print(out, &module, modes[m]));
+		fclose(out);
+
+		CuAssertPtrNotNull(tc, strstr(code, "\tpshufd $0, "));
+		CuAssertPtrNotNull(tc, strstr(code, "\tpsubd "));
+		CuAssertPtrNotNull(tc, strstr(code, "\tpaddd "));
+		CuAssertPtrNotNull(tc, strstr(code, "\tdivps "));
+		CuAssertPtrNotNull(tc, strstr(code, "\tmovups ("));
+		free(code);
+	}
+
+	mcc_ir_module_release(&module);
+}
+
+#define TESTS \
+	TEST(ElementWise) \
+	TEST(Invariants) \
+	TEST(Rejected) \
+	TEST(Assembly)
+
+#include "main_stub.inc"